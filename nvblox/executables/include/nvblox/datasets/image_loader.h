@@ -17,10 +17,12 @@ limitations under the License.
 
 #include <deque>
 #include <future>
+#include <memory>
 #include <string>
 
 #include "nvblox/core/types.h"
 #include "nvblox/sensors/image.h"
+#include "nvblox/utils/thread_pool.h"
 
 namespace nvblox {
 namespace datasets {
@@ -81,8 +83,11 @@ class MultiThreadedImageLoader : public ImageLoader<ImageType> {
   ImageOptional<ImageType> getImageAsOptional(int image_idx,
                                               MemoryType memory_type);
 
+  // The number of images loaded ahead.
   const int num_threads_;
   std::deque<std::future<ImageOptional<ImageType>>> load_queue_;
+  // Loads the queued images.
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::getDefault();
 };
 
 // Factory Function
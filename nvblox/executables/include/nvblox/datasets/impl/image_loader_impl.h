@@ -62,7 +62,10 @@ void MultiThreadedImageLoader<ImageType>::initLoadQueue() {
 
 template <typename ImageType>
 void MultiThreadedImageLoader<ImageType>::emptyLoadQueue() {
+  // Unlike those of std::async, the futures of the pool don't block on
+  // destruction, so wait for the loads still referencing this loader.
   while (!load_queue_.empty()) {
+    load_queue_.front().wait();
     load_queue_.pop_front();
   }
 }
@@ -70,10 +73,10 @@ void MultiThreadedImageLoader<ImageType>::emptyLoadQueue() {
 template <typename ImageType>
 void MultiThreadedImageLoader<ImageType>::addNextImageToQueue(
     MemoryType memory_type) {
-  load_queue_.push_back(
-      std::async(std::launch::async,
-                 &MultiThreadedImageLoader<ImageType>::getImageAsOptional, this,
-                 this->image_idx_, memory_type));
+  const int image_idx = this->image_idx_;
+  load_queue_.push_back(thread_pool_->submit([this, image_idx, memory_type]() {
+    return getImageAsOptional(image_idx, memory_type);
+  }));
   ++this->image_idx_;
 }
 
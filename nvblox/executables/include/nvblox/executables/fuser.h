@@ -26,6 +26,7 @@ limitations under the License.
 #include "nvblox/integrators/esdf_integrator.h"
 #include "nvblox/integrators/projective_color_integrator.h"
 #include "nvblox/integrators/projective_tsdf_integrator.h"
+#include "nvblox/io/async_output_writer.h"
 #include "nvblox/io/image_io.h"
 #include "nvblox/map/blox.h"
 #include "nvblox/map/layer.h"
@@ -68,6 +69,11 @@ class Fuser {
   bool outputTimingsToFile();
   // Output the serialized map to a file
   bool outputMapToFile();
+  // Block until all outputs queued on the output writer are written.
+  void flushOutputs();
+  // The name of the timer of an output: "fuser/<output>/queue" when the
+  // output is queued on the output writer, "fuser/<output>/write" otherwise.
+  std::string outputTimerName(const std::string& output) const;
 
   // Get the static mapper (useful for experiments where we modify mapper
   // settings)
@@ -103,6 +109,16 @@ class Fuser {
   std::string mesh_output_path_;
   std::string map_output_path_;
   std::string dynamic_overlay_path_;
+
+  // Output writing. If async_output_ is set, the outputs are queued on
+  // output_writer_ and written on background threads. Off by default, such
+  // that the outputs are written before the writing functions return.
+  bool async_output_ = false;
+  int output_num_threads_ = AsyncOutputWriter::kDefaultNumThreads;
+  int output_queue_size_ = AsyncOutputWriter::kDefaultMaxQueueSize;
+  OutputQueueFullPolicy output_queue_full_policy_ =
+      OutputQueueFullPolicy::kBlock;
+  std::unique_ptr<AsyncOutputWriter> output_writer_;
 };
 
 }  //  namespace nvblox
@@ -77,6 +77,19 @@ DEFINE_double(
     "The frame rate of the input depth frames in Hz. Only used if running "
     "dynamic detection.");
 
+// Output writing
+DEFINE_bool(async_output, false,
+            "Write the outputs on background threads, such that writing does "
+            "not stall the integration. By default, the outputs are written "
+            "synchronously.");
+DEFINE_int32(output_num_threads, AsyncOutputWriter::kDefaultNumThreads,
+             "The number of threads writing the outputs.");
+DEFINE_int32(output_queue_size, AsyncOutputWriter::kDefaultMaxQueueSize,
+             "The maximum number of outputs waiting to be written.");
+DEFINE_bool(drop_outputs_when_queue_full, false,
+            "Drop the oldest queued output when the output queue is full, "
+            "instead of waiting for space.");
+
 // ============================ GET THE PARAMS ============================
 
 inline void get_multi_mapper_params_from_gflags(float* voxel_size,
@@ -198,6 +211,30 @@ inline void set_fuser_params_from_gflags(Fuser* fuser_ptr) {
               << FLAGS_esdf_frame_subsampling;
     fuser_ptr->esdf_frame_subsampling_ = FLAGS_esdf_frame_subsampling;
   }
+  // Output writing flags
+  if (!gflags::GetCommandLineFlagInfoOrDie("async_output").is_default) {
+    LOG(INFO) << "Command line parameter found: async_output = "
+              << FLAGS_async_output;
+    fuser_ptr->async_output_ = FLAGS_async_output;
+  }
+  if (!gflags::GetCommandLineFlagInfoOrDie("output_num_threads").is_default) {
+    LOG(INFO) << "Command line parameter found: output_num_threads = "
+              << FLAGS_output_num_threads;
+    fuser_ptr->output_num_threads_ = FLAGS_output_num_threads;
+  }
+  if (!gflags::GetCommandLineFlagInfoOrDie("output_queue_size").is_default) {
+    LOG(INFO) << "Command line parameter found: output_queue_size = "
+              << FLAGS_output_queue_size;
+    fuser_ptr->output_queue_size_ = FLAGS_output_queue_size;
+  }
+  if (!gflags::GetCommandLineFlagInfoOrDie("drop_outputs_when_queue_full")
+           .is_default) {
+    LOG(INFO) << "Command line parameter found: drop_outputs_when_queue_full = "
+              << FLAGS_drop_outputs_when_queue_full;
+    fuser_ptr->output_queue_full_policy_ =
+        FLAGS_drop_outputs_when_queue_full ? OutputQueueFullPolicy::kDropOldest
+                                           : OutputQueueFullPolicy::kBlock;
+  }
   if (!gflags::GetCommandLineFlagInfoOrDie("frame_rate").is_default) {
     LOG(INFO) << "command line parameter found: "
                  "frame_rate = "
@@ -50,6 +50,10 @@ Fuser::Fuser(std::unique_ptr<datasets::RgbdDataLoaderInterface>&& data_loader)
 
   // Init fuser params
   set_fuser_params_from_gflags(this);
+  if (async_output_) {
+    output_writer_ = std::make_unique<AsyncOutputWriter>(
+        output_num_threads_, output_queue_size_, output_queue_full_policy_);
+  }
 
   // Init mapper params (for the two mapper held by the multi mapper)
   MapperParams mapper_params = get_mapper_params_from_gflags();
@@ -133,6 +137,9 @@ int Fuser::run() {
     outputMapToFile();
   }
 
+  // Wait for the outputs, such that their timings are included below.
+  flushOutputs();
+
   LOG(INFO) << nvblox::timing::Timing::Print() << "\n";
   LOG(INFO) << nvblox::timing::Rates::Print() << "\n";
 
@@ -227,39 +234,64 @@ Mapper& Fuser::static_mapper() {
 }
 
 bool Fuser::outputDynamicOverlayImage(int frame_number) {
-  timing::Timer timer_write("fuser/dynamic_mask/write");
+  timing::Timer timer_write(outputTimerName("dynamic_mask"));
   std::string full_path = dynamic_overlay_path_ + "/overlay_" +
                           std::to_string(frame_number) + ".png";
+  if (output_writer_) {
+    return output_writer_->writePngAsync(
+        full_path, multi_mapper_->getLastDynamicFrameMaskOverlay());
+  }
   return io::writeToPng(full_path,
                         multi_mapper_->getLastDynamicFrameMaskOverlay());
 }
 
 bool Fuser::outputTsdfPointcloudPly() {
-  timing::Timer timer_write("fuser/tsdf/write");
+  timing::Timer timer_write(outputTimerName("tsdf"));
+  if (output_writer_) {
+    return static_mapper().saveTsdfAsPlyAsync(tsdf_output_path_,
+                                              output_writer_.get());
+  }
   return static_mapper().saveTsdfAsPly(tsdf_output_path_);
 }
 
 bool Fuser::outputOccupancyPointcloudPly() {
-  timing::Timer timer_write("fuser/occupancy/write");
+  timing::Timer timer_write(outputTimerName("occupancy"));
+  if (output_writer_) {
+    return static_mapper().saveOccupancyAsPlyAsync(occupancy_output_path_,
+                                                   output_writer_.get());
+  }
   return static_mapper().saveOccupancyAsPly(occupancy_output_path_);
 }
 
 bool Fuser::outputFreespacePointcloudPly() {
-  timing::Timer timer_write("fuser/freespace/write");
+  timing::Timer timer_write(outputTimerName("freespace"));
+  if (output_writer_) {
+    return static_mapper().saveFreespaceAsPlyAsync(freespace_output_path_,
+                                                   output_writer_.get());
+  }
   return static_mapper().saveFreespaceAsPly(freespace_output_path_);
 }
 
 bool Fuser::outputESDFPointcloudPly() {
-  timing::Timer timer_write("fuser/esdf/write");
+  timing::Timer timer_write(outputTimerName("esdf"));
+  if (output_writer_) {
+    return static_mapper().saveEsdfAsPlyAsync(esdf_output_path_,
+                                              output_writer_.get());
+  }
   return static_mapper().saveEsdfAsPly(esdf_output_path_);
 }
 
 bool Fuser::outputMeshPly() {
-  timing::Timer timer_write("fuser/mesh/write");
+  timing::Timer timer_write(outputTimerName("mesh"));
+  if (output_writer_) {
+    return static_mapper().saveMeshAsPlyAsync(mesh_output_path_,
+                                              output_writer_.get());
+  }
   return static_mapper().saveMeshAsPly(mesh_output_path_);
 }
 
 bool Fuser::outputTimingsToFile() {
+  // Written synchronously: it's the last output, written after the flush.
   LOG(INFO) << "Writing timing to: " << timing_output_path_;
   std::ofstream timing_file(timing_output_path_);
   timing_file << nvblox::timing::Timing::Print();
@@ -272,4 +304,23 @@ bool Fuser::outputMapToFile() {
   return static_mapper().saveLayerCake(map_output_path_);
 }
 
+std::string Fuser::outputTimerName(const std::string& output) const {
+  // With the output writer, the outputs are only queued here. The writes are
+  // timed by the writer.
+  return "fuser/" + output + (output_writer_ ? "/queue" : "/write");
+}
+
+void Fuser::flushOutputs() {
+  if (!output_writer_) {
+    return;
+  }
+  timing::Timer timer_flush("fuser/flush_outputs");
+  output_writer_->flush();
+  const AsyncOutputWriterStats stats = output_writer_->getStats();
+  LOG(INFO) << "Outputs written: " << stats.num_written
+            << ", failed: " << stats.num_failed
+            << ", dropped: " << stats.num_dropped
+            << ", max queue depth: " << stats.max_queue_depth;
+}
+
 }  //  namespace nvblox
@@ -0,0 +1,60 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cuda_runtime.h>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __CUDACC__
+#include <cuda_fp16.h>
+#endif
+
+namespace nvblox {
+
+/// Convert a float to the bits of an IEEE 754 half precision number, rounding
+/// to the nearest representable value.
+__host__ __device__ inline uint16_t floatToHalfBits(float value);
+
+/// Convert the bits of an IEEE 754 half precision number to a float.
+__host__ __device__ inline float halfBitsToFloat(uint16_t bits);
+
+/// A 16 bit floating point number for storing voxel values compactly.
+///
+/// Float16 only stores values. It converts implicitly to and from float, such
+/// that all arithmetic happens in single precision, and code written against
+/// float members (e.g. voxel.distance * weight) compiles unchanged. Values
+/// have 11 significant bits (a relative precision of ~5e-4) and a range of
+/// +-65504.
+class Float16 {
+ public:
+  Float16() = default;
+  __host__ __device__ Float16(float value) : bits_(floatToHalfBits(value)) {}
+
+  __host__ __device__ operator float() const { return halfBitsToFloat(bits_); }
+
+  /// The raw bits.
+  __host__ __device__ uint16_t bits() const { return bits_; }
+
+ private:
+  uint16_t bits_;
+};
+
+static_assert(sizeof(Float16) == 2, "Float16 must be 2 bytes.");
+
+}  // namespace nvblox
+
+#include "nvblox/core/internal/impl/float16_impl.h"
@@ -0,0 +1,95 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+namespace nvblox {
+
+__host__ __device__ inline uint16_t floatToHalfBits(float value) {
+#ifdef __CUDA_ARCH__
+  return __half_as_ushort(__float2half_rn(value));
+#else
+  uint32_t float_bits;
+  std::memcpy(&float_bits, &value, sizeof(float_bits));
+  const uint32_t sign = (float_bits >> 16) & 0x8000u;
+  const uint32_t abs_bits = float_bits & 0x7FFFFFFFu;
+
+  // Inf and NaN (keeping NaNs NaN).
+  if (abs_bits >= 0x7F800000u) {
+    return sign | 0x7C00u | (abs_bits > 0x7F800000u ? 0x200u : 0u);
+  }
+  // Values from 65520 on round to infinity.
+  if (abs_bits >= 0x477FF000u) {
+    return sign | 0x7C00u;
+  }
+  // Values below 2^-14 are subnormal halfs. Below 2^-25 they round to zero.
+  if (abs_bits < 0x38800000u) {
+    if (abs_bits < 0x33000000u) {
+      return sign;
+    }
+    const uint32_t exponent = abs_bits >> 23;
+    const uint32_t mantissa = (abs_bits & 0x7FFFFFu) | 0x800000u;
+    const uint32_t shift = 126 - exponent;
+    uint32_t half_bits = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    // Round to nearest, ties to even. A carry into the exponent is correct.
+    if (remainder > halfway || (remainder == halfway && (half_bits & 1u))) {
+      half_bits++;
+    }
+    return sign | half_bits;
+  }
+  // Normal numbers: re-bias the exponent from 127 to 15 and round the
+  // mantissa from 23 to 10 bits.
+  uint32_t half_bits = (abs_bits - 0x38000000u) >> 13;
+  const uint32_t remainder = abs_bits & 0x1FFFu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half_bits & 1u))) {
+    half_bits++;
+  }
+  return sign | half_bits;
+#endif
+}
+
+__host__ __device__ inline float halfBitsToFloat(uint16_t bits) {
+#ifdef __CUDA_ARCH__
+  return __half2float(__ushort_as_half(bits));
+#else
+  const uint32_t sign = static_cast<uint32_t>(bits & 0x8000u) << 16;
+  uint32_t exponent = (bits >> 10) & 0x1Fu;
+  uint32_t mantissa = bits & 0x3FFu;
+  uint32_t float_bits;
+  if (exponent == 0x1Fu) {
+    // Inf and NaN.
+    float_bits = sign | 0x7F800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    float_bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    float_bits = sign;
+  } else {
+    // Subnormal half: normalize.
+    exponent = 113;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    float_bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+  }
+  float value;
+  std::memcpy(&value, &float_bits, sizeof(value));
+  return value;
+#endif
+}
+
+}  // namespace nvblox
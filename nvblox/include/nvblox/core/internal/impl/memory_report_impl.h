@@ -0,0 +1,40 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+namespace nvblox {
+
+template <typename T>
+void MemoryUsage::addVector(const unified_vector<T>& vector) {
+  add(vector.memory_type(), vector.capacity() * sizeof(T));
+}
+
+template <typename ImageType>
+void MemoryUsage::addImage(const ImageType& image) {
+  add(image.memory_type(),
+      static_cast<size_t>(image.numel()) *
+          sizeof(typename ImageType::ElementType));
+}
+
+template <typename HashMapType>
+size_t estimateHashMapBytes(const HashMapType& hash_map) {
+  constexpr size_t kNodeBytes = sizeof(typename HashMapType::value_type) +
+                                sizeof(void*) + sizeof(size_t);
+  return hash_map.bucket_count() * sizeof(void*) +
+         hash_map.size() * kNodeBytes;
+}
+
+}  // namespace nvblox
@@ -0,0 +1,88 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+
+__host__ __device__ inline uint64_t spreadBitsBy3(uint32_t value) {
+  uint64_t x = value & 0x1FFFFFu;
+  x = (x | x << 32) & 0x1F00000000FFFFull;
+  x = (x | x << 16) & 0x1F0000FF0000FFull;
+  x = (x | x << 8) & 0x100F00F00F00F00Full;
+  x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+__host__ __device__ inline uint32_t compactBitsBy3(uint64_t value) {
+  uint64_t x = value & 0x1249249249249249ull;
+  x = (x | x >> 2) & 0x10C30C30C30C30C3ull;
+  x = (x | x >> 4) & 0x100F00F00F00F00Full;
+  x = (x | x >> 8) & 0x1F0000FF0000FFull;
+  x = (x | x >> 16) & 0x1F00000000FFFFull;
+  x = (x | x >> 32) & 0x1FFFFFull;
+  return static_cast<uint32_t>(x);
+}
+
+__host__ __device__ inline int mortonIndexInBlock(int x, int y, int z) {
+  return static_cast<int>(spreadBitsBy3(x) << 2 | spreadBitsBy3(y) << 1 |
+                          spreadBitsBy3(z));
+}
+
+__host__ __device__ inline int mortonIndexInBlock(const Index3D& voxel_index) {
+  return mortonIndexInBlock(voxel_index.x(), voxel_index.y(), voxel_index.z());
+}
+
+__host__ __device__ inline Index3D voxelIndexFromMortonIndexInBlock(
+    int morton_index) {
+  const uint64_t code = static_cast<uint64_t>(morton_index);
+  return Index3D(compactBitsBy3(code >> 2), compactBitsBy3(code >> 1),
+                 compactBitsBy3(code));
+}
+
+__host__ __device__ inline uint64_t mortonCodeFromBlockIndex(
+    const Index3D& block_index) {
+  constexpr int32_t kOffset = 1 << (kMortonBitsPerCoordinate - 1);
+  const auto biased = [](int32_t coordinate) {
+    return static_cast<uint32_t>(coordinate + kOffset);
+  };
+  return spreadBitsBy3(biased(block_index.x())) << 2 |
+         spreadBitsBy3(biased(block_index.y())) << 1 |
+         spreadBitsBy3(biased(block_index.z()));
+}
+
+inline void sortBlockIndicesInMortonOrder(std::vector<Index3D>* block_indices) {
+  CHECK_NOTNULL(block_indices);
+  // Compute the codes once rather than in each comparison.
+  std::vector<std::pair<uint64_t, Index3D>> codes_and_indices;
+  codes_and_indices.reserve(block_indices->size());
+  for (const Index3D& block_index : *block_indices) {
+    codes_and_indices.emplace_back(mortonCodeFromBlockIndex(block_index),
+                                   block_index);
+  }
+  std::sort(codes_and_indices.begin(), codes_and_indices.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  for (size_t i = 0; i < codes_and_indices.size(); i++) {
+    (*block_indices)[i] = codes_and_indices[i].second;
+  }
+}
+
+}  // namespace nvblox
@@ -172,8 +172,9 @@ struct Deleter<T[]> {
 template <typename T>
 unified_ptr<T>::~unified_ptr() {
   if (ptr_ != nullptr) {
-    (*ref_counter_)--;
-    if (*ref_counter_ <= 0) {
+    // Decrement and test in a single atomic operation, such that pointers
+    // shared across threads are released exactly once.
+    if (--(*ref_counter_) <= 0) {
       Deleter<T>::destroy(ptr_, memory_type_);
       delete ref_counter_;
       ptr_ = nullptr;
@@ -296,8 +297,7 @@ const typename unified_ptr<T>::T_noextent* unified_ptr<T>::get() const {
 template <typename T>
 void unified_ptr<T>::reset() {
   if (ptr_ != nullptr) {
-    (*ref_counter_)--;
-    if (*ref_counter_ <= 0) {
+    if (--(*ref_counter_) <= 0) {
       Deleter<T>::destroy(ptr_, memory_type_);
       delete ref_counter_;
     }
@@ -0,0 +1,123 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "nvblox/core/types.h"
+#include "nvblox/core/unified_vector.h"
+
+namespace nvblox {
+
+/// Bytes of memory, broken down by where the memory lives.
+struct MemoryUsage {
+  /// Memory allocated with cudaMalloc (MemoryType::kDevice).
+  size_t device_bytes = 0;
+  /// Memory allocated with cudaMallocManaged (MemoryType::kUnified).
+  size_t unified_bytes = 0;
+  /// Page-locked memory allocated with cudaMallocHost (MemoryType::kHost).
+  size_t host_pinned_bytes = 0;
+  /// Regular heap memory, such as that of the std containers.
+  size_t host_bytes = 0;
+
+  /// Add bytes allocated as the passed memory type.
+  /// @param memory_type Where the memory lives.
+  /// @param num_bytes The number of bytes.
+  void add(MemoryType memory_type, size_t num_bytes);
+
+  /// Add the memory reserved by a vector, ie. its capacity rather than its
+  /// size.
+  /// @param vector The vector.
+  template <typename T>
+  void addVector(const unified_vector<T>& vector);
+
+  /// Add the memory held by an Image.
+  /// @param image The image.
+  template <typename ImageType>
+  void addImage(const ImageType& image);
+
+  /// The sum over all kinds of memory.
+  size_t total_bytes() const {
+    return device_bytes + unified_bytes + host_pinned_bytes + host_bytes;
+  }
+
+  MemoryUsage& operator+=(const MemoryUsage& other);
+
+  /// Element-wise maximum. Used to track high watermarks.
+  /// @param other The usage to compare to.
+  /// @return The maximum of this and other for each kind of memory.
+  MemoryUsage cwiseMax(const MemoryUsage& other) const;
+};
+
+/// An entry of a MemoryReport.
+struct MemoryReportItem {
+  /// Where the memory is held, e.g. "tsdf_layer/blocks".
+  std::string name;
+  /// The number of objects (e.g. blocks or images) holding the memory.
+  size_t count = 0;
+  MemoryUsage usage;
+};
+
+/// A breakdown of the memory held by a component, such as the Mapper, into
+/// named items.
+class MemoryReport {
+ public:
+  MemoryReport() = default;
+
+  /// Add an item to the report.
+  /// @param name The name of the item.
+  /// @param usage The memory held.
+  /// @param count The number of objects holding the memory.
+  void add(const std::string& name, const MemoryUsage& usage,
+           size_t count = 0);
+
+  /// Add all items of another report, with their names prefixed.
+  /// @param prefix Prepended to the names of the items, e.g. "foreground/".
+  /// @param other The report to add.
+  void add(const std::string& prefix, const MemoryReport& other);
+
+  /// The items in the order in which they were added.
+  const std::vector<MemoryReportItem>& items() const { return items_; }
+
+  /// The memory held by all items.
+  MemoryUsage total() const;
+
+  /// The report as a table with one item per row, in megabytes.
+  std::string toString() const;
+
+ private:
+  std::vector<MemoryReportItem> items_;
+};
+
+/// The current memory usage together with its maximum since tracking started.
+struct MemorySnapshot {
+  MemoryUsage current;
+  MemoryUsage high_watermark;
+};
+
+/// Estimate of the heap memory held by a std::unordered_map or
+/// std::unordered_set: the bucket array plus one node (value, next pointer and
+/// cached hash) per element.
+/// @param hash_map The container.
+/// @return The estimated number of bytes.
+template <typename HashMapType>
+size_t estimateHashMapBytes(const HashMapType& hash_map);
+
+}  // namespace nvblox
+
+#include "nvblox/core/internal/impl/memory_report_impl.h"
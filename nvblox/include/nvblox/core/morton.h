@@ -0,0 +1,67 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "nvblox/core/types.h"
+
+namespace nvblox {
+
+/// Morton (Z-order) codes interleave the bits of the x, y and z coordinates,
+/// such that indices which are close in 3D are mostly close in the code order.
+/// The x bit is the most significant of each bit triplet, so the order agrees
+/// with the x-major order of VoxelBlock on 2x2x2 cubes: neighbours along z are
+/// adjacent.
+
+/// The number of bits per coordinate in the Morton code of a block index.
+constexpr int kMortonBitsPerCoordinate = 21;
+
+/// Spread the lowest 21 bits of a value such that there are two zero bits
+/// between each of them.
+__host__ __device__ inline uint64_t spreadBitsBy3(uint32_t value);
+
+/// The inverse of spreadBitsBy3(). Reads every third bit.
+__host__ __device__ inline uint32_t compactBitsBy3(uint64_t value);
+
+/// The Morton index of a voxel within a block of 8x8x8 voxels.
+/// @param voxel_index The voxel index in the block, in [0, 8) on each axis.
+/// @return The index in [0, 512).
+__host__ __device__ inline int mortonIndexInBlock(const Index3D& voxel_index);
+__host__ __device__ inline int mortonIndexInBlock(int x, int y, int z);
+
+/// The inverse of mortonIndexInBlock().
+__host__ __device__ inline Index3D voxelIndexFromMortonIndexInBlock(
+    int morton_index);
+
+/// The Morton code of a block index. Each coordinate is offset by 2^20, such
+/// that indices in [-2^20, 2^20) on each axis are ordered spatially. Indices
+/// outside of that range wrap around: they still get a code, but may be
+/// ordered far from their neighbours.
+/// @param block_index The block index.
+/// @return The 63 bit Morton code.
+__host__ __device__ inline uint64_t mortonCodeFromBlockIndex(
+    const Index3D& block_index);
+
+/// Sort block indices by their Morton code. Iterating over the sorted
+/// indices visits neighbouring blocks close together in time.
+/// @param block_indices The indices to sort in place.
+inline void sortBlockIndicesInMortonOrder(std::vector<Index3D>* block_indices);
+
+}  // namespace nvblox
+
+#include "nvblox/core/internal/impl/morton_impl.h"
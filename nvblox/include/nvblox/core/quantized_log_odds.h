@@ -0,0 +1,85 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cuda_runtime.h>
+#include <cmath>
+#include <cstdint>
+
+namespace nvblox {
+
+/// Log odds stored as a 16 bit fixed point number.
+///
+/// The resolution is 1/kScale (~2.4e-4) and the range is +-8. This covers the
+/// log odds of the probabilities [1e-3, 1 - 1e-3] that logOddsFromProbability()
+/// clamps to. Like Float16, QuantizedLogOdds converts implicitly to and from
+/// float (rounding to the nearest value and saturating at the ends of the
+/// range), such that code written against float log odds compiles unchanged.
+/// Integrators can instead update the raw value with addSaturating() to avoid
+/// the conversions.
+class QuantizedLogOdds {
+ public:
+  /// Fixed point units per unit of log odds.
+  static constexpr float kScale = 4096.0f;
+  /// The extreme raw values. The range is symmetric around zero.
+  static constexpr int32_t kMaxValue = INT16_MAX;
+  static constexpr int32_t kMinValue = -INT16_MAX;
+
+  QuantizedLogOdds() = default;
+  __host__ __device__ QuantizedLogOdds(float log_odds)
+      : value_(quantize(log_odds)) {}
+
+  __host__ __device__ operator float() const {
+    return static_cast<float>(value_) / kScale;
+  }
+
+  /// The raw fixed point value.
+  __host__ __device__ int16_t value() const { return value_; }
+
+  /// Convert log odds to the nearest fixed point value, saturating at the ends
+  /// of the range. NaN maps to zero.
+  /// @param log_odds The log odds.
+  /// @return The fixed point value.
+  __host__ __device__ static int16_t quantize(float log_odds) {
+    const float scaled = rintf(log_odds * kScale);
+    if (!(scaled == scaled)) {
+      return 0;
+    }
+    return static_cast<int16_t>(fmaxf(static_cast<float>(kMinValue),
+                                      fminf(scaled, kMaxValue)));
+  }
+
+  /// Add a fixed point increment, clamping the result to [min_value,
+  /// max_value].
+  /// @param increment The increment in fixed point units (see quantize()).
+  /// @param min_value The lower bound of the result in fixed point units.
+  /// @param max_value The upper bound of the result in fixed point units.
+  __host__ __device__ void addSaturating(int32_t increment, int32_t min_value,
+                                         int32_t max_value) {
+    const int32_t sum = static_cast<int32_t>(value_) + increment;
+    value_ = static_cast<int16_t>(sum < min_value   ? min_value
+                                  : sum > max_value ? max_value
+                                                    : sum);
+  }
+
+ private:
+  int16_t value_;
+};
+
+static_assert(sizeof(QuantizedLogOdds) == 2,
+              "QuantizedLogOdds must be 2 bytes.");
+
+}  // namespace nvblox
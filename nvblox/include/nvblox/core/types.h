@@ -65,7 +65,19 @@ inline bool isGpuMemory(const MemoryType memory_type) {
 }
 
 // Which type of mapping to do.
-enum class ProjectiveLayerType { kTsdf, kTsdfWithFreespace, kOccupancy, kNone };
+// kCompactTsdf maintains a CompactTsdfLayer, which stores the TSDF in half
+// precision. kQuantizedOccupancy maintains a QuantizedOccupancyLayer, which
+// stores the log odds in 16 bit fixed point. kTsdfWithCompactFreespace
+// maintains a CompactFreespaceLayer next to the TsdfLayer.
+enum class ProjectiveLayerType {
+  kTsdf,
+  kTsdfWithFreespace,
+  kOccupancy,
+  kCompactTsdf,
+  kQuantizedOccupancy,
+  kTsdfWithCompactFreespace,
+  kNone
+};
 template <>
 inline std::string toString(const ProjectiveLayerType& layer_type) {
   switch (layer_type) {
@@ -78,6 +90,15 @@ inline std::string toString(const ProjectiveLayerType& layer_type) {
     case ProjectiveLayerType::kOccupancy:
       return "kOccupancy";
       break;
+    case ProjectiveLayerType::kCompactTsdf:
+      return "kCompactTsdf";
+      break;
+    case ProjectiveLayerType::kQuantizedOccupancy:
+      return "kQuantizedOccupancy";
+      break;
+    case ProjectiveLayerType::kTsdfWithCompactFreespace:
+      return "kTsdfWithCompactFreespace";
+      break;
     case ProjectiveLayerType::kNone:
       return "kNone";
       break;
@@ -91,20 +112,37 @@ inline std::string toString(const ProjectiveLayerType& layer_type) {
 /// Whether we are maintaining a tsdf layer.
 inline bool hasTsdfLayer(ProjectiveLayerType layer_type) {
   if (layer_type == ProjectiveLayerType::kTsdf ||
-      layer_type == ProjectiveLayerType::kTsdfWithFreespace) {
+      layer_type == ProjectiveLayerType::kTsdfWithFreespace ||
+      layer_type == ProjectiveLayerType::kTsdfWithCompactFreespace) {
     return true;
   }
   return false;
 }
 
-/// Whether we are maintaining a freespace layer.
+/// Whether we are maintaining a compact (half precision) tsdf layer.
+inline bool hasCompactTsdfLayer(ProjectiveLayerType layer_type) {
+  return layer_type == ProjectiveLayerType::kCompactTsdf;
+}
+
+/// Whether we are maintaining a quantized (fixed point) occupancy layer.
+inline bool hasQuantizedOccupancyLayer(ProjectiveLayerType layer_type) {
+  return layer_type == ProjectiveLayerType::kQuantizedOccupancy;
+}
+
+/// Whether we are maintaining a freespace layer (full or compact).
 inline bool hasFreespaceLayer(ProjectiveLayerType layer_type) {
-  if (layer_type == ProjectiveLayerType::kTsdfWithFreespace) {
+  if (layer_type == ProjectiveLayerType::kTsdfWithFreespace ||
+      layer_type == ProjectiveLayerType::kTsdfWithCompactFreespace) {
     return true;
   }
   return false;
 }
 
+/// Whether the freespace layer we are maintaining is compact.
+inline bool hasCompactFreespaceLayer(ProjectiveLayerType layer_type) {
+  return layer_type == ProjectiveLayerType::kTsdfWithCompactFreespace;
+}
+
 typedef Eigen::Vector3i Index3D;
 typedef Eigen::Vector2i Index2D;
 
@@ -135,6 +135,10 @@ class unified_ptr {
 
   MemoryType memory_type() const { return memory_type_; }
 
+  /// The number of unified_ptrs sharing ownership of the memory (including
+  /// this one). Zero for a null pointer.
+  int use_count() const { return ref_counter_ ? ref_counter_->load() : 0; }
+
   /// Helper function to memset all the memory to 0.
   void setZeroAsync(const CudaStream cuda_stream);
   void setZero();
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #pragma once
 
+#include "nvblox/core/hash.h"
 #include "nvblox/core/types.h"
 
 namespace nvblox {
@@ -31,4 +32,47 @@ std::vector<Index3D> getBlocksWithinRadiusOfAABB(
     const std::vector<Index3D>& input_blocks, float block_size,
     const AxisAlignedBoundingBox& aabb, float radius);
 
+/// Get all block indices (allocated or not) within a radius, by enumerating
+/// the blocks in the bounding cube of the sphere. The cost scales with the
+/// volume of the sphere, not with the size of the map.
+std::vector<Index3D> getBlockIndicesWithinRadius(float block_size,
+                                                 const Vector3f& center,
+                                                 float radius);
+
+/// The number of blocks in the bounding cube of a sphere, ie. the number of
+/// blocks checked by getBlockIndicesWithinRadius().
+size_t getNumBlocksInBoundingCube(float block_size, const Vector3f& center,
+                                  float radius);
+
+/// Get the blocks of a set which are within a radius. Either the members of
+/// the set or the blocks in the bounding cube of the sphere are checked,
+/// whichever are fewer.
+std::vector<Index3D> getBlocksWithinRadius(const Index3DSet& blocks,
+                                           float block_size,
+                                           const Vector3f& center,
+                                           float radius);
+
+/// Get the allocated blocks of a layer which are within a radius. Either the
+/// allocated blocks or the blocks in the bounding cube of the sphere are
+/// checked, whichever are fewer.
+template <typename LayerType>
+std::vector<Index3D> getAllocatedBlocksWithinRadius(const LayerType& layer,
+                                                    const Vector3f& center,
+                                                    float radius) {
+  const float block_size = layer.block_size();
+  if (getNumBlocksInBoundingCube(block_size, center, radius) >=
+      layer.numAllocatedBlocks()) {
+    return getBlocksWithinRadius(layer.getAllBlockIndices(), block_size,
+                                 center, radius);
+  }
+  std::vector<Index3D> allocated_blocks;
+  for (const Index3D& block_index :
+       getBlockIndicesWithinRadius(block_size, center, radius)) {
+    if (layer.isBlockAllocated(block_index)) {
+      allocated_blocks.push_back(block_index);
+    }
+  }
+  return allocated_blocks;
+}
+
 }  // namespace nvblox
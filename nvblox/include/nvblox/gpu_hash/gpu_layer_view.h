@@ -40,7 +40,7 @@ class GPULayerView {
 
   GPULayerView() = default;
   GPULayerView(size_t max_num_blocks);
-  GPULayerView(LayerType* layer_ptr);
+  GPULayerView(const LayerType* layer_ptr);
 
   GPULayerView(const GPULayerView& other);
   GPULayerView(GPULayerView&& other);
@@ -49,9 +49,11 @@ class GPULayerView {
 
   ~GPULayerView();
 
-  // Creates a new GPULayerView from a layer
-  void reset(LayerType* layer_ptr, const CudaStream& cuda_stream);
-  void reset(LayerType* layer_ptr);
+  // Creates a new GPULayerView from a layer. Doesn't modify the layer, in
+  // particular doesn't copy the blocks it shares with a snapshot. Writers
+  // have to get the view through BlockLayer::getWritableGpuLayerView().
+  void reset(const LayerType* layer_ptr, const CudaStream& cuda_stream);
+  void reset(const LayerType* layer_ptr);
 
   // Resizes the underlying GPU hash as well as deleting its contents
   void reset(size_t new_max_num_blocks);
@@ -62,6 +64,12 @@ class GPULayerView {
 
   size_t size() const;
 
+  /// The device memory held by the view: the GPU hash, whose size is given
+  /// by size() rather than the number of blocks it contains, and the buffer
+  /// used to stage its transfer.
+  /// @return The number of bytes.
+  size_t sizeInBytes() const;
+
   // Accessors
   float max_load_factor() const { return max_load_factor_; }
   float size_expansion_factor() const { return size_expansion_factor_; }
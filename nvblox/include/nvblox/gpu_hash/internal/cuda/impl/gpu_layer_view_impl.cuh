@@ -23,7 +23,7 @@ limitations under the License.
 namespace nvblox {
 
 template <typename BlockType>
-GPULayerView<BlockType>::GPULayerView(LayerType* layer_ptr)
+GPULayerView<BlockType>::GPULayerView(const LayerType* layer_ptr)
     : gpu_hash_ptr_(std::make_shared<GPUHashImpl<BlockType>>()) {
   reset(layer_ptr);
 }
@@ -65,12 +65,12 @@ GPULayerView<BlockType>& GPULayerView<BlockType>::operator=(
 }
 
 template <typename BlockType>
-void GPULayerView<BlockType>::reset(LayerType* layer_ptr) {
+void GPULayerView<BlockType>::reset(const LayerType* layer_ptr) {
   reset(layer_ptr, CudaStreamOwning());
 }
 
 template <typename BlockType>
-void GPULayerView<BlockType>::reset(LayerType* layer_ptr,
+void GPULayerView<BlockType>::reset(const LayerType* layer_ptr,
                                     const CudaStream& cuda_stream) {
   CHECK_NOTNULL(layer_ptr);
   timing::Timer timer("gpu_hash/transfer");
@@ -110,12 +110,15 @@ void GPULayerView<BlockType>::reset(LayerType* layer_ptr,
 
   block_size_ = layer_ptr->block_size();
 
-  // Arange blocks in continuous host memory for transfer
+  // Arange blocks in continuous host memory for transfer. The hash stores
+  // mutable pointers, but only views of blocks that were unshared first are
+  // written to.
   host_vector<IndexBlockPair<BlockType>> host_block_vector;
   host_block_vector.reserve(layer_ptr->numAllocatedBlocks());
   for (const auto& index : layer_ptr->getAllBlockIndices()) {
     host_block_vector.push_back(IndexBlockPair<BlockType>(
-        index, layer_ptr->getBlockAtIndex(index).get()));
+        index,
+        const_cast<BlockType*>(layer_ptr->getBlockAtIndex(index).get())));
   }
 
   // CPU -> GPU
@@ -144,4 +147,21 @@ size_t GPULayerView<BlockType>::size() const {
   return gpu_hash_ptr_->size();
 }
 
+template <typename BlockType>
+size_t GPULayerView<BlockType>::sizeInBytes() const {
+  size_t num_bytes = scratch_block_vector_device_.capacity() *
+                     sizeof(IndexBlockPair<BlockType>);
+  if (gpu_hash_ptr_) {
+    // Per slot, stdgpu stores the value, an offset into the excess list, its
+    // index in the occupied range and the excess list position, plus bitsets
+    // for occupancy and locks.
+    using ValueType = typename Index3DDeviceHashMapType<BlockType>::value_type;
+    constexpr size_t kBytesPerSlot =
+        sizeof(ValueType) + 3 * sizeof(stdgpu::index_t);
+    num_bytes += static_cast<size_t>(gpu_hash_ptr_->impl_.max_size()) *
+                 kBytesPerSlot;
+  }
+  return num_bytes;
+}
+
 }  // namespace nvblox
\ No newline at end of file
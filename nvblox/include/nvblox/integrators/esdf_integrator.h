@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "nvblox/core/cuda_stream.h"
 #include "nvblox/core/log_odds.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/core/types.h"
 #include "nvblox/core/unified_vector.h"
@@ -69,6 +70,27 @@ class EsdfIntegrator {
                                const std::vector<Index3D>& block_indices,
                                EsdfLayer* esdf_layer);
 
+  /// Build an EsdfLayer from a TsdfLayer and a CompactFreespaceLayer
+  /// (incremental) (on GPU). See the FreespaceLayer overload above.
+  /// @param tsdf_layer The input TsdfLayer
+  /// @param freespace_layer The input compact freespace layer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the TSDF at these indices has changed).
+  /// @param[out] esdf_layer The output EsdfLayer
+  virtual void integrateBlocks(const TsdfLayer& tsdf_layer,
+                               const CompactFreespaceLayer& freespace_layer,
+                               const std::vector<Index3D>& block_indices,
+                               EsdfLayer* esdf_layer);
+
+  /// Build an EsdfLayer from a CompactTsdfLayer (incremental) (on GPU)
+  /// @param tsdf_layer The input CompactTsdfLayer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the TSDF at these indices has changed).
+  /// @param[out] esdf_layer The output EsdfLayer
+  virtual void integrateBlocks(const CompactTsdfLayer& tsdf_layer,
+                               const std::vector<Index3D>& block_indices,
+                               EsdfLayer* esdf_layer);
+
   /// @brief Build an EsdfLayer from an OccupancyLayer(incremental) (on GPU)
   /// @param occupancy_layer The input OccupancyLayer
   /// @param block_indices The indices of the EsdfLayer which should be updated
@@ -78,6 +100,16 @@ class EsdfIntegrator {
                                const std::vector<Index3D>& block_indices,
                                EsdfLayer* esdf_layer);
 
+  /// @brief Build an EsdfLayer from a QuantizedOccupancyLayer (incremental)
+  /// (on GPU)
+  /// @param occupancy_layer The input QuantizedOccupancyLayer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the Occupancy at these indices has changed).
+  /// @param[out] esdf_layer The output EsdfLayer
+  virtual void integrateBlocks(const QuantizedOccupancyLayer& occupancy_layer,
+                               const std::vector<Index3D>& block_indices,
+                               EsdfLayer* esdf_layer);
+
   /// Build an EsdfLayer slice from a TsdfLayer (incremental) (on GPU)
   /// This function takes the voxels between z_min and z_max in the TsdfLayer.
   /// Any obstacle in this z range generates an obstacle in the ESDF output
@@ -120,6 +152,40 @@ class EsdfIntegrator {
                       const std::vector<Index3D>& block_indices, float z_min,
                       float z_max, float z_output, EsdfLayer* esdf_layer);
 
+  /// Build an EsdfLayer slice from a TsdfLayer and a CompactFreespaceLayer
+  /// (incremental) (on GPU). See the FreespaceLayer overload above.
+  /// @param tsdf_layer The input TsdfLayer
+  /// @param freespace_layer The input compact freespace layer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the TSDF at these indices has changed).
+  /// @param z_min The minimum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param z_max The maximum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param  z_output The height (in meters) (in the layer frame) where the
+  /// ESDF slice is written to.
+  /// @param[out] esdf_layer The output EsdfLayer
+  void integrateSlice(const TsdfLayer& tsdf_layer,
+                      const CompactFreespaceLayer& freespace_layer,
+                      const std::vector<Index3D>& block_indices, float z_min,
+                      float z_max, float z_output, EsdfLayer* esdf_layer);
+
+  /// Build an EsdfLayer slice from a CompactTsdfLayer (incremental) (on GPU)
+  /// See integrateSlice() for TsdfLayers above.
+  /// @param tsdf_layer The input CompactTsdfLayer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the TSDF at these indices has changed).
+  /// @param z_min The minimum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param z_max The maximum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param  z_output The height (in meters) (in the layer frame) where the
+  /// ESDF slice is written to.
+  /// @param[out] esdf_layer The output EsdfLayer
+  void integrateSlice(const CompactTsdfLayer& tsdf_layer,
+                      const std::vector<Index3D>& block_indices, float z_min,
+                      float z_max, float z_output, EsdfLayer* esdf_layer);
+
   /// Build an EsdfLayer slice from a OccupancyLayer (incremental) (on GPU)
   /// This function takes the voxels between z_min and z_max in the TsdfLayer.
   /// Any obstacle in this z range generates an obstacle in the ESDF output
@@ -139,6 +205,22 @@ class EsdfIntegrator {
                       const std::vector<Index3D>& block_indices, float z_min,
                       float z_max, float z_output, EsdfLayer* esdf_layer);
 
+  /// Build an EsdfLayer slice from a QuantizedOccupancyLayer (incremental)
+  /// (on GPU). See integrateSlice() for OccupancyLayers above.
+  /// @param occupancy_layer The input QuantizedOccupancyLayer
+  /// @param block_indices The indices of the EsdfLayer which should be updated
+  /// (usually because the Occupancy at these indices has changed).
+  /// @param z_min The minimum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param z_max The maximum height (in meters) (in the layer frame) at which
+  /// an obstacle is considered.
+  /// @param  z_output The height (in meters) (in the layer frame) where the
+  /// ESDF slice is written to.
+  /// @param[out] esdf_layer The output EsdfLayer
+  void integrateSlice(const QuantizedOccupancyLayer& occupancy_layer,
+                      const std::vector<Index3D>& block_indices, float z_min,
+                      float z_max, float z_output, EsdfLayer* esdf_layer);
+
   /// A parameter getter
   /// The maximum distance in meters out to which to calculate the ESDF.
   /// @returns the maximum distance
@@ -185,24 +267,49 @@ class EsdfIntegrator {
   /// @param occupied_threshold the minimum probability.
   void occupied_threshold(float occupied_threshold);
 
+  /// A parameter getter
+  /// Whether to record the ESDF blocks modified by each integration call. See
+  /// getLastUpdatedBlockIndices().
+  /// @returns whether updated blocks are tracked
+  bool track_updated_blocks() const;
+
+  /// A parameter setter
+  /// See track_updated_blocks().
+  /// @param track_updated_blocks whether to track updated blocks.
+  void track_updated_blocks(bool track_updated_blocks);
+
+  /// Get the ESDF blocks modified by the last call to integrateBlocks() or
+  /// integrateSlice(). Note that, because distances propagate, this is
+  /// generally a superset of the blocks passed to the call. Only populated if
+  /// track_updated_blocks() is set.
+  /// @return The (unique) indices of the modified blocks.
+  const std::vector<Index3D>& getLastUpdatedBlockIndices() const {
+    return last_updated_block_indices_;
+  }
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during integration. The buffers
+  /// grow to fit the largest update so far and are never shrunk.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const;
+
  protected:
   /// Templated version of the public functions above, used internally.
-  template <typename LayerType>
+  template <typename LayerType, typename FreespaceLayerType = FreespaceLayer>
   void integrateBlocksTemplate(
       const LayerType& layer, const std::vector<Index3D>& block_indices,
       EsdfLayer* esdf_layer,
-      const FreespaceLayer* freespace_layer_ptr = nullptr);
+      const FreespaceLayerType* freespace_layer_ptr = nullptr);
 
-  template <typename LayerType>
+  template <typename LayerType, typename FreespaceLayerType = FreespaceLayer>
   void integrateSliceTemplate(
       const LayerType& layer, const std::vector<Index3D>& block_indices,
       float z_min, float z_max, float z_output, EsdfLayer* esdf_layer,
-      const FreespaceLayer* freespace_layer_ptr = nullptr);
+      const FreespaceLayerType* freespace_layer_ptr = nullptr);
 
   /// Allocate all blocks in the given block indices list.
   void allocateBlocksOnCPU(const std::vector<Index3D>& block_indices,
@@ -210,12 +317,14 @@ class EsdfIntegrator {
 
   /// Gets the site-finding functors for a specific layer type.
   OccupancySiteFunctor getSiteFunctor(const OccupancyLayer& layer);
+  OccupancySiteFunctor getSiteFunctor(const QuantizedOccupancyLayer& layer);
   TsdfSiteFunctor getSiteFunctor(const TsdfLayer& layer);
+  TsdfSiteFunctor getSiteFunctor(const CompactTsdfLayer& layer);
 
-  template <typename LayerType>
+  template <typename LayerType, typename FreespaceLayerType>
   void markAllSites(const LayerType& layer,
                     const std::vector<Index3D>& block_indices,
-                    const FreespaceLayer* freespace_layer_ptr,
+                    const FreespaceLayerType* freespace_layer_ptr,
                     EsdfLayer* esdf_layer,
                     device_vector<Index3D>* blocks_with_sites,
                     device_vector<Index3D>* cleared_blocks);
@@ -223,11 +332,11 @@ class EsdfIntegrator {
   // Same as the markAllSites function above but basically makes the
   // whole operation in 2D. Considers a min and max z in a bounding box which is
   // compressed down into a single layer.
-  template <typename LayerType>
+  template <typename LayerType, typename FreespaceLayerType>
   void markSitesInSlice(const LayerType& layer,
                         const std::vector<Index3D>& block_indices, float min_z,
                         float max_z, float output_z,
-                        const FreespaceLayer* freespace_layer_ptr,
+                        const FreespaceLayerType* freespace_layer_ptr,
                         EsdfLayer* esdf_layer,
                         device_vector<Index3D>* updated_blocks,
                         device_vector<Index3D>* cleared_blocks);
@@ -250,6 +359,12 @@ class EsdfIntegrator {
   // Helper method to de-dupe block indices.
   void sortAndTakeUniqueIndices(device_vector<Index3D>* block_indices);
 
+  // Record blocks as updated (if tracking is enabled).
+  void recordUpdatedBlocks(const device_vector<Index3D>& block_indices);
+  void recordUpdatedBlocks(const std::vector<Index3D>& block_indices);
+  // Move the recorded blocks to last_updated_block_indices_.
+  void finishRecordingUpdatedBlocks();
+
   /// @brief EsdfLayer related parameter
   /// Maximum distance to compute the ESDF.
   float max_esdf_distance_m_ =
@@ -268,6 +383,15 @@ class EsdfIntegrator {
   /// The log odds value greater than which we consider a voxel occupied
   float occupied_threshold_log_odds_ = logOddsFromProbability(0.5f);
 
+  /// Whether to record the blocks modified by each integration call.
+  bool track_updated_blocks_ = false;
+  Index3DSet updated_block_indices_set_;
+  /// The blocks recorded during distance propagation. Collected on the device
+  /// and moved to the set once per call, such that propagation doesn't wait
+  /// for copies to the host.
+  device_vector<Index3D> updated_block_indices_device_;
+  std::vector<Index3D> last_updated_block_indices_;
+
   // State.
   std::shared_ptr<CudaStream> cuda_stream_;
 
@@ -48,6 +48,19 @@ class FreespaceIntegrator {
                             Time update_time_ms, const TsdfLayer& tsdf_layer,
                             FreespaceLayer* freespace_layer_ptr);
 
+  /// @brief Updates a compact freespace layer according to a tsdf layer.
+  /// The voxels are unpacked, updated as in the overload above and packed
+  /// again. See CompactFreespaceVoxel.
+  /// @param block_indices_to_update The block indices that should be updated.
+  /// @param update_time_ms  The current time in miliseconds.
+  /// @param tsdf_layer The tsdf layer that is used to check wether voxels
+  /// are occupied or not.
+  /// @param freespace_layer_ptr The compact freespace layer that will be
+  /// updated.
+  void updateFreespaceLayer(const std::vector<Index3D>& block_indices_to_update,
+                            Time update_time_ms, const TsdfLayer& tsdf_layer,
+                            CompactFreespaceLayer* freespace_layer_ptr);
+
   /// A parameter getter
   /// Tsdf distance below which we assume a voxel to be occupied.
   /// Note: if set to greater than tsdf truncation distance everything will be
@@ -108,12 +121,26 @@ class FreespaceIntegrator {
   /// @param value whether to check the neighboring voxels
   void check_neighborhood(bool value);
 
+  /// The time of the last update. Used by integrators taking over the updates
+  /// of a layer from this one, see MapperUpdateScheduler.
+  /// @returns the time of the last update in ms
+  Time last_update_time_ms() const;
+
+  /// Set the time of the last update. See last_update_time_ms().
+  /// @param value the time of the last update in ms
+  void last_update_time_ms(Time value);
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
  protected:
+  template <typename FreespaceLayerType>
+  void updateFreespaceLayerTemplate(
+      const std::vector<Index3D>& block_indices_to_update, Time update_time_ms,
+      const TsdfLayer& tsdf_layer, FreespaceLayerType* freespace_layer_ptr);
+
   // Parameters (see getters for description)
   // Note: See comment behind each parameter for corresponding dynablox
   // parameter name
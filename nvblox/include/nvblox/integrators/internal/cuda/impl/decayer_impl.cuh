@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include <nvblox/integrators/internal/decayer.h>
 
+#include <algorithm>
+
 #include "nvblox/integrators/internal/cuda/projective_integrators_common.cuh"
 #include "nvblox/integrators/internal/integrators_common.h"
 #include "nvblox/interpolation/interpolation_2d.h"
@@ -180,6 +182,62 @@ __global__ void decayTsdfExcludeImageKernel(
   decay(block_ptrs, voxel_decayer, do_decay, is_block_fully_decayed);
 }
 
+template <typename BlockType, typename DecayFunctorType>
+__global__ void decayEpochsKernel(BlockType** block_ptrs,                // NOLINT
+                                  const int* num_epochs,                 // NOLINT
+                                  const DecayFunctorType voxel_decayer,  // NOLINT
+                                  bool* is_block_fully_decayed,          // NOLINT
+                                  bool* is_block_changed,                // NOLINT
+                                  int* num_epochs_until_due) {
+  // Initialize the outputs
+  __shared__ bool is_block_fully_decayed_shared;
+  __shared__ bool is_block_changed_shared;
+  __shared__ int num_epochs_until_due_shared;
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    is_block_fully_decayed_shared = true;
+    is_block_changed_shared = false;
+    num_epochs_until_due_shared = DecayEpochTracker::kNeverDue;
+  }
+  __syncthreads();
+
+  typename BlockType::VoxelType* voxel_ptr =
+      &(block_ptrs[blockIdx.x]->voxels[threadIdx.z][threadIdx.y][threadIdx.x]);
+  assert(voxel_ptr != nullptr);
+
+  // Apply all the epochs the block missed. Fully decayed voxels are a fixed
+  // point of the decay, so we stop after the first step applied to them.
+  const bool was_fully_decayed = voxel_decayer.isFullyDecayed(voxel_ptr);
+  const int num_epochs_to_apply = num_epochs[blockIdx.x];
+  for (int i = 0; i < num_epochs_to_apply; i++) {
+    const bool fully_decayed_before_step =
+        voxel_decayer.isFullyDecayed(voxel_ptr);
+    voxel_decayer(voxel_ptr);
+    if (fully_decayed_before_step) {
+      break;
+    }
+  }
+
+  // The block changed if a voxel became fully decayed. It's due again when
+  // the next voxel becomes fully decayed.
+  // NOTE: Several threads may write the same value, which is no issue.
+  const bool is_fully_decayed = voxel_decayer.isFullyDecayed(voxel_ptr);
+  if (!is_fully_decayed) {
+    is_block_fully_decayed_shared = false;
+    atomicMin(&num_epochs_until_due_shared,
+              voxel_decayer.numDecaysUntilFullyDecayed(voxel_ptr));
+  } else if (!was_fully_decayed) {
+    is_block_changed_shared = true;
+  }
+  __syncthreads();
+
+  // One thread writes the output
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    is_block_fully_decayed[blockIdx.x] = is_block_fully_decayed_shared;
+    is_block_changed[blockIdx.x] = is_block_changed_shared;
+    num_epochs_until_due[blockIdx.x] = num_epochs_until_due_shared;
+  }
+}
+
 template <class LayerType>
 template <typename DecayFunctorType>
 std::vector<Index3D> VoxelDecayer<LayerType>::decay(
@@ -306,4 +364,183 @@ std::vector<Index3D> VoxelDecayer<LayerType>::deallocateFullyDecayedBlocks(
   return deallocated_blocks;
 }
 
+template <class LayerType>
+template <typename DecayFunctorType>
+std::vector<Index3D> VoxelDecayer<LayerType>::decayEpoch(
+    LayerType* layer_ptr,                         // NOLINT
+    const DecayFunctorType& voxel_decay_functor,  // NOLINT
+    const bool deallocate_decayed_blocks,         // NOLINT
+    const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+    DecayEpochTracker* epoch_tracker,  // NOLINT
+    const CudaStream cuda_stream,      // NOLINT
+    std::vector<Index3D>* changed_blocks) {
+  CHECK_NOTNULL(layer_ptr);
+  CHECK_NOTNULL(epoch_tracker);
+  epoch_tracker->advanceEpoch();
+
+  // Pick up blocks which were allocated or deallocated without the tracker
+  // being notified (ie. by direct modification of the layer). We only pay for
+  // the full scan when the block counts disagree.
+  if (epoch_tracker->numTrackedBlocks() != layer_ptr->numAllocatedBlocks()) {
+    std::vector<Index3D> untracked_blocks;
+    for (const Index3D& block_index : layer_ptr->getAllBlockIndices()) {
+      if (!epoch_tracker->isTracked(block_index)) {
+        untracked_blocks.push_back(block_index);
+      }
+    }
+    epoch_tracker->trackBlocks(untracked_blocks);
+    std::vector<Index3D> deallocated_blocks;
+    for (const Index3D& block_index :
+         epoch_tracker->getTrackedBlockIndices()) {
+      if (!layer_ptr->isBlockAllocated(block_index)) {
+        deallocated_blocks.push_back(block_index);
+      }
+    }
+    epoch_tracker->forgetBlocks(deallocated_blocks);
+  }
+
+  // Pause the decay of the excluded blocks for this epoch.
+  if (block_exclusion_options) {
+    Index3DSet excluded_blocks(
+        block_exclusion_options->block_indices_to_exclude.begin(),
+        block_exclusion_options->block_indices_to_exclude.end());
+    if (block_exclusion_options->exclusion_center &&
+        block_exclusion_options->exclusion_radius_m) {
+      // Same criterion as getBlockIndicesToDecay().
+      const float exclusion_radius_m_sq =
+          *block_exclusion_options->exclusion_radius_m *
+          *block_exclusion_options->exclusion_radius_m;
+      for (const Index3D& block_index :
+           epoch_tracker->getTrackedBlockIndices()) {
+        const Vector3f block_center =
+            getPositionFromBlockIndex(layer_ptr->block_size(), block_index);
+        if ((block_center - *block_exclusion_options->exclusion_center)
+                .squaredNorm() <= exclusion_radius_m_sq) {
+          excluded_blocks.insert(block_index);
+        }
+      }
+    }
+    epoch_tracker->excludeBlocksFromEpoch(
+        std::vector<Index3D>(excluded_blocks.begin(), excluded_blocks.end()));
+  }
+
+  return decayPendingEpochs(layer_ptr, voxel_decay_functor,
+                            deallocate_decayed_blocks,
+                            epoch_tracker->popDueBlocks(), epoch_tracker,
+                            cuda_stream, changed_blocks);
+}
+
+template <class LayerType>
+template <typename DecayFunctorType>
+std::vector<Index3D> VoxelDecayer<LayerType>::applyPendingDecay(
+    LayerType* layer_ptr,                         // NOLINT
+    const DecayFunctorType& voxel_decay_functor,  // NOLINT
+    const bool deallocate_decayed_blocks,         // NOLINT
+    const std::vector<Index3D>& block_indices,    // NOLINT
+    DecayEpochTracker* epoch_tracker,             // NOLINT
+    const CudaStream cuda_stream,                 // NOLINT
+    std::vector<Index3D>* changed_blocks) {
+  CHECK_NOTNULL(layer_ptr);
+  CHECK_NOTNULL(epoch_tracker);
+  return decayPendingEpochs(layer_ptr, voxel_decay_functor,
+                            deallocate_decayed_blocks, block_indices,
+                            epoch_tracker, cuda_stream, changed_blocks);
+}
+
+template <class LayerType>
+template <typename DecayFunctorType>
+std::vector<Index3D> VoxelDecayer<LayerType>::decayPendingEpochs(
+    LayerType* layer_ptr,                         // NOLINT
+    const DecayFunctorType& voxel_decay_functor,  // NOLINT
+    const bool deallocate_decayed_blocks,         // NOLINT
+    const std::vector<Index3D>& block_indices,    // NOLINT
+    DecayEpochTracker* epoch_tracker,             // NOLINT
+    const CudaStream cuda_stream,                 // NOLINT
+    std::vector<Index3D>* changed_blocks) {
+  if (changed_blocks != nullptr) {
+    changed_blocks->clear();
+  }
+
+  // The blocks which are behind the current epoch.
+  std::vector<Index3D> block_indices_to_decay;
+  std::vector<int> num_epochs;
+  block_indices_to_decay.reserve(block_indices.size());
+  num_epochs.reserve(block_indices.size());
+  std::vector<Index3D> deallocated_blocks;
+  for (const Index3D& block_index : block_indices) {
+    if (!layer_ptr->isBlockAllocated(block_index)) {
+      deallocated_blocks.push_back(block_index);
+      continue;
+    }
+    const int num_pending_epochs = epoch_tracker->numPendingEpochs(block_index);
+    if (num_pending_epochs > 0) {
+      block_indices_to_decay.push_back(block_index);
+      num_epochs.push_back(num_pending_epochs);
+    }
+  }
+  epoch_tracker->forgetBlocks(deallocated_blocks);
+  if (block_indices_to_decay.empty()) {
+    return std::vector<Index3D>();
+  }
+
+  const std::vector<typename LayerType::BlockType*> block_ptrs_to_decay =
+      getBlockPtrsFromIndices(block_indices_to_decay, layer_ptr);
+  const size_t num_blocks = block_ptrs_to_decay.size();
+
+  expandBuffersIfRequired(
+      num_blocks, cuda_stream, &allocated_block_ptrs_host_,
+      &allocated_block_ptrs_device_, &num_epochs_host_, &num_epochs_device_,
+      &block_fully_decayed_device_, &block_fully_decayed_host_,
+      &block_changed_device_, &block_changed_host_,
+      &num_epochs_until_due_device_, &num_epochs_until_due_host_);
+
+  allocated_block_ptrs_host_.copyFromAsync(block_ptrs_to_decay, cuda_stream);
+  allocated_block_ptrs_device_.copyFromAsync(allocated_block_ptrs_host_,
+                                             cuda_stream);
+  num_epochs_host_.copyFromAsync(num_epochs, cuda_stream);
+  num_epochs_device_.copyFromAsync(num_epochs_host_, cuda_stream);
+  block_fully_decayed_device_.resizeAsync(num_blocks, cuda_stream);
+  block_changed_device_.resizeAsync(num_blocks, cuda_stream);
+  num_epochs_until_due_device_.resizeAsync(num_blocks, cuda_stream);
+
+  // Kernel call - One ThreadBlock launched per VoxelBlock
+  constexpr int kVoxelsPerSide = VoxelBlock<bool>::kVoxelsPerSide;
+  const dim3 kThreadsPerBlock(kVoxelsPerSide, kVoxelsPerSide, kVoxelsPerSide);
+  decayEpochsKernel<<<num_blocks, kThreadsPerBlock, 0, cuda_stream>>>(
+      allocated_block_ptrs_device_.data(),  // NOLINT
+      num_epochs_device_.data(),            // NOLINT
+      voxel_decay_functor,                  // NOLINT
+      block_fully_decayed_device_.data(),   // NOLINT
+      block_changed_device_.data(),         // NOLINT
+      num_epochs_until_due_device_.data()   // NOLINT
+  );
+  checkCudaErrors(cudaPeekAtLastError());
+
+  // Copy results back to host and synchronize
+  block_fully_decayed_host_.copyFromAsync(block_fully_decayed_device_,
+                                          cuda_stream);
+  block_changed_host_.copyFromAsync(block_changed_device_, cuda_stream);
+  num_epochs_until_due_host_.copyFromAsync(num_epochs_until_due_device_,
+                                           cuda_stream);
+  cuda_stream.synchronize();
+
+  // Reschedule the blocks and deallocate the fully decayed ones.
+  deallocated_blocks.clear();
+  for (size_t i = 0; i < num_blocks; ++i) {
+    const Index3D& block_index = block_indices_to_decay[i];
+    if (block_changed_host_[i] && changed_blocks != nullptr) {
+      changed_blocks->push_back(block_index);
+    }
+    if (block_fully_decayed_host_[i] && deallocate_decayed_blocks) {
+      layer_ptr->clearBlock(block_index);
+      deallocated_blocks.push_back(block_index);
+    } else {
+      epoch_tracker->markBlockDecayed(
+          block_index, std::max(num_epochs_until_due_host_[i], 1));
+    }
+  }
+  epoch_tracker->forgetBlocks(deallocated_blocks);
+  return deallocated_blocks;
+}
+
 }  // namespace nvblox
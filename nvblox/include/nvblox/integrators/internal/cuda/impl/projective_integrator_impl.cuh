@@ -395,6 +395,14 @@ __device__ inline void setUnobservedVoxel(const TsdfVoxel& voxel_value,
   }
 }
 
+__device__ inline void setUnobservedVoxel(const CompactTsdfVoxel& voxel_value,
+                                          CompactTsdfVoxel* voxel_ptr) {
+  constexpr float kMinObservedWeight = 0.001;
+  if (voxel_ptr->weight < kMinObservedWeight) {
+    *voxel_ptr = voxel_value;
+  }
+}
+
 __device__ inline void setUnobservedVoxel(const OccupancyVoxel& voxel_value,
                                           OccupancyVoxel* voxel_ptr) {
   constexpr float kEps = 1e-4;
@@ -404,6 +412,14 @@ __device__ inline void setUnobservedVoxel(const OccupancyVoxel& voxel_value,
   }
 }
 
+__device__ inline void setUnobservedVoxel(
+    const QuantizedOccupancyVoxel& voxel_value,
+    QuantizedOccupancyVoxel* voxel_ptr) {
+  if (voxel_ptr->log_odds.value() == 0) {
+    *voxel_ptr = voxel_value;
+  }
+}
+
 // Call with:
 // - One threadBlock per VoxelBlock
 // - 8x8x8 threads per threadBlock
@@ -447,12 +463,17 @@ void ProjectiveIntegrator<VoxelType>::markUnobservedFreeInsideRadiusTemplate(
 
   // The value given to "observed" voxels
   VoxelType slightly_observed_voxel;
-  if constexpr (std::is_same<TsdfVoxel, VoxelType>::value) {
+  if constexpr (std::is_same<TsdfVoxel, VoxelType>::value ||
+                std::is_same<CompactTsdfVoxel, VoxelType>::value) {
     constexpr float kSlightlyObservedVoxelWeight = 0.1;
     slightly_observed_voxel.distance =
         get_truncation_distance_m(layer->voxel_size());
     slightly_observed_voxel.weight = kSlightlyObservedVoxelWeight;
-  } else if (std::is_same<OccupancyVoxel, VoxelType>::value) {
+  } else if constexpr (std::is_same<OccupancyVoxel, VoxelType>::value ||
+                       std::is_same<QuantizedOccupancyVoxel,
+                                    VoxelType>::value) {
+    // NOTE: For QuantizedOccupancyVoxels this rounds to the smallest negative
+    // fixed point value.
     constexpr float kSlightlyObservedVoxelLogOdds = -2e-4;
     slightly_observed_voxel.log_odds = kSlightlyObservedVoxelLogOdds;
   }
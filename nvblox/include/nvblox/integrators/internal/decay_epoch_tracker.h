@@ -0,0 +1,123 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "nvblox/core/hash.h"
+#include "nvblox/core/types.h"
+
+namespace nvblox {
+
+/// Bookkeeping for epoch-based (lazy) decay.
+///
+/// Each decay step advances the decay epoch by one. Rather than decaying all
+/// blocks in every epoch, the tracker stores per block:
+/// - the epoch up to which decay was applied to the block, and
+/// - the epoch at which the block is next due, which is when the first of its
+///   voxels becomes fully decayed.
+/// A block which is due is decayed by all epochs it missed at once. Until then
+/// the (observable) state of its voxels doesn't change, so downstream layers
+/// don't need an update. Blocks which are written by integration have to be
+/// brought up to date before the write (see numPendingEpochs()) and are due in
+/// the next epoch after it, since their due epoch is no longer known.
+class DecayEpochTracker {
+ public:
+  /// Returned by the decay kernels for blocks which have no voxel left to
+  /// decay.
+  static constexpr int kNeverDue = std::numeric_limits<int>::max();
+
+  DecayEpochTracker() = default;
+  ~DecayEpochTracker() = default;
+
+  /// Start the next epoch.
+  void advanceEpoch();
+
+  /// The current epoch.
+  uint64_t epoch() const { return epoch_; }
+
+  /// Start tracking blocks which are not yet tracked. They are treated as
+  /// decayed up to the previous epoch and are due in the current one.
+  /// @param block_indices The blocks to track.
+  void trackBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Blocks written by integration. They are decayed up to the current epoch
+  /// (the caller applies the pending epochs before the write) and are due in
+  /// the next epoch.
+  /// @param block_indices The written blocks.
+  void markBlocksUpdated(const std::vector<Index3D>& block_indices);
+
+  /// Records that a block was decayed up to the current epoch.
+  /// @param block_index The block.
+  /// @param num_epochs_until_due The number of epochs after which the block
+  /// has to be decayed next, or kNeverDue.
+  void markBlockDecayed(const Index3D& block_index, int num_epochs_until_due);
+
+  /// Excludes blocks from the current epoch, ie. their decay is paused for one
+  /// epoch.
+  /// @param block_indices The blocks to exclude. Untracked blocks are ignored.
+  void excludeBlocksFromEpoch(const std::vector<Index3D>& block_indices);
+
+  /// Stop tracking blocks (ie. because they were deallocated).
+  /// @param block_indices The blocks to forget.
+  void forgetBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Forget all blocks and restart at epoch zero.
+  void clear();
+
+  /// Returns the blocks which are due in the current epoch. Every block is
+  /// returned once per due epoch.
+  /// @return The indices of the due blocks.
+  std::vector<Index3D> popDueBlocks();
+
+  /// The number of epochs which have not been applied to a block yet.
+  /// @param block_index The block.
+  /// @return The number of epochs. Zero for untracked blocks.
+  int numPendingEpochs(const Index3D& block_index) const;
+
+  /// Whether a block is tracked.
+  bool isTracked(const Index3D& block_index) const;
+
+  /// The number of tracked blocks.
+  size_t numTrackedBlocks() const { return block_states_.size(); }
+
+  /// The indices of the tracked blocks.
+  std::vector<Index3D> getTrackedBlockIndices() const;
+
+ private:
+  struct BlockDecayState {
+    // The epoch up to which the decay was applied.
+    uint64_t last_decayed_epoch;
+    // The epoch at which the block is due. Zero if the block is never due.
+    uint64_t due_epoch;
+  };
+
+  // Sets the epoch at which a block is due and schedules it.
+  void scheduleBlock(const Index3D& block_index, BlockDecayState* state,
+                     uint64_t due_epoch);
+
+  uint64_t epoch_ = 0;
+  Index3DHashMapType<BlockDecayState>::type block_states_;
+  // The blocks due per epoch. Entries are invalidated (rather than removed)
+  // when a block is rescheduled, and are skipped if the block's due epoch
+  // doesn't match.
+  std::map<uint64_t, std::vector<Index3D>> due_blocks_;
+};
+
+}  // namespace nvblox
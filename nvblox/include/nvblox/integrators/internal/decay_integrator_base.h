@@ -21,6 +21,7 @@ limitations under the License.
 #include "nvblox/core/cuda_stream.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/core/types.h"
+#include "nvblox/integrators/internal/decay_epoch_tracker.h"
 #include "nvblox/integrators/internal/decay_integrator_base_params.h"
 #include "nvblox/sensors/camera.h"
 #include "nvblox/sensors/image.h"
@@ -124,6 +125,54 @@ class DecayIntegratorBase {
       const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
       const CudaStream cuda_stream) = 0;
 
+  /// Epoch-based decay. Advances the decay epoch by one and decays only the
+  /// blocks in which a voxel becomes fully decayed, by all epochs they missed.
+  /// Other blocks are decayed lazily, so the cost scales with the number of
+  /// blocks changing rather than with the size of the map. See
+  /// DecayEpochTracker.
+  /// Blocks have to be brought up to date with applyPendingDecay() before
+  /// they are written, and reported with markBlocksUpdated() afterwards.
+  /// @param layer_ptr               Layer to decay
+  /// @param block_exclusion_options Blocks for which the decay is paused in
+  ///                                this epoch.
+  /// @param cuda_stream             Cuda stream for GPU work.
+  /// @param changed_blocks          Optional output. The blocks in which
+  ///                                voxels became fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> decayEpoch(
+      LayerType* layer_ptr,
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) = 0;
+
+  /// Applies the epochs missed by blocks, which brings their voxels up to date
+  /// with the current epoch. Blocks which are not tracked or up to date are
+  /// skipped.
+  /// @param layer_ptr      Layer to decay
+  /// @param block_indices  The blocks to bring up to date.
+  /// @param cuda_stream    Cuda stream for GPU work.
+  /// @param changed_blocks Optional output. The blocks in which voxels became
+  ///                       fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> applyPendingDecay(
+      LayerType* layer_ptr, const std::vector<Index3D>& block_indices,
+      const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) = 0;
+
+  /// Report blocks written by integration to the epoch-based decay. See
+  /// decayEpoch().
+  /// @param block_indices The written blocks.
+  void markBlocksUpdated(const std::vector<Index3D>& block_indices);
+
+  /// Stop tracking blocks in the epoch-based decay (ie. because they were
+  /// cleared).
+  /// @param block_indices The cleared blocks.
+  void forgetBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Reset the epoch-based decay (ie. because the layer was replaced).
+  void resetDecayEpochs();
+
+  /// The epoch-based decay bookkeeping.
+  const DecayEpochTracker& epoch_tracker() const;
+
   /// A parameter getter
   /// The flag that controls if fully decayed block should be deallocated or
   /// not.
@@ -144,6 +193,9 @@ class DecayIntegratorBase {
   // Parameter for the decay step
   bool deallocate_decayed_blocks_{
       kDecayIntegratorBaseDeallocateDecayedBlocks.default_value};
+
+  // Bookkeeping for the epoch-based decay
+  DecayEpochTracker epoch_tracker_;
 };
 
 }  // namespace nvblox
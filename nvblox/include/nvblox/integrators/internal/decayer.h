@@ -20,6 +20,7 @@ limitations under the License.
 #include "nvblox/core/cuda_stream.h"
 #include "nvblox/core/log_odds.h"
 #include "nvblox/core/parameter_tree.h"
+#include "nvblox/integrators/internal/decay_epoch_tracker.h"
 #include "nvblox/map/common_names.h"
 #include "nvblox/map/layer.h"
 #include "nvblox/sensors/camera.h"
@@ -57,6 +58,58 @@ class VoxelDecayer {
       const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
       const CudaStream cuda_stream);
 
+  /// @brief Epoch-based decay. Advances the epoch of the epoch_tracker and
+  /// decays only the blocks which are due, by all epochs they missed. See
+  /// DecayEpochTracker.
+  /// The DecayFunctorType additionally has to implement
+  /// numDecaysUntilFullyDecayed(), returning the number of decay steps after
+  /// which a voxel is fully decayed (zero if it is already).
+  /// @tparam DecayFunctorType The (unnamed) type of the functor.
+  /// @param layer_ptr The layer to run the decay on.
+  /// @param voxel_decay_functor The functor object which does the decay.
+  /// @param deallocate_decayed_blocks If fully decayed blocks should be
+  /// deallocated.
+  /// @param block_exclusion_options Specifies blocks for which the decay is
+  /// paused in this epoch.
+  /// @param epoch_tracker The epoch bookkeeping of the layer.
+  /// @param cuda_stream The stream to do GPU work on.
+  /// @param changed_blocks Optional output. The blocks in which voxels became
+  /// fully decayed, ie. the blocks which need downstream updates.
+  /// @return A vector containing the indices of the blocks deallocated.
+  template <typename DecayFunctorType>
+  std::vector<Index3D> decayEpoch(
+      LayerType* layer_ptr,                         // NOLINT
+      const DecayFunctorType& voxel_decay_functor,  // NOLINT
+      const bool deallocate_decayed_blocks,         // NOLINT
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      DecayEpochTracker* epoch_tracker,  // NOLINT
+      const CudaStream cuda_stream,      // NOLINT
+      std::vector<Index3D>* changed_blocks = nullptr);
+
+  /// @brief Brings blocks up to date with the current epoch, by applying the
+  /// epochs they missed. Call this before writing to the blocks.
+  /// @tparam DecayFunctorType The (unnamed) type of the functor.
+  /// @param layer_ptr The layer to run the decay on.
+  /// @param voxel_decay_functor The functor object which does the decay.
+  /// @param deallocate_decayed_blocks If fully decayed blocks should be
+  /// deallocated.
+  /// @param block_indices The blocks to bring up to date. Blocks which are not
+  /// allocated or are up to date are skipped.
+  /// @param epoch_tracker The epoch bookkeeping of the layer.
+  /// @param cuda_stream The stream to do GPU work on.
+  /// @param changed_blocks Optional output. The blocks in which voxels became
+  /// fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  template <typename DecayFunctorType>
+  std::vector<Index3D> applyPendingDecay(
+      LayerType* layer_ptr,                         // NOLINT
+      const DecayFunctorType& voxel_decay_functor,  // NOLINT
+      const bool deallocate_decayed_blocks,         // NOLINT
+      const std::vector<Index3D>& block_indices,    // NOLINT
+      DecayEpochTracker* epoch_tracker,             // NOLINT
+      const CudaStream cuda_stream,                 // NOLINT
+      std::vector<Index3D>* changed_blocks = nullptr);
+
  protected:
   /// Given a vector of blocks that have been decayed, deallocate the ones that
   /// are *fully* decayed (i.e. having a weight that is close to zero)
@@ -67,6 +120,18 @@ class VoxelDecayer {
   std::vector<Index3D> deallocateFullyDecayedBlocks(
       LayerType* layer_ptr, const std::vector<Index3D>& decayed_block_indices);
 
+  /// Decays each block by its number of pending epochs and updates the
+  /// epoch_tracker.
+  template <typename DecayFunctorType>
+  std::vector<Index3D> decayPendingEpochs(
+      LayerType* layer_ptr,                         // NOLINT
+      const DecayFunctorType& voxel_decay_functor,  // NOLINT
+      const bool deallocate_decayed_blocks,         // NOLINT
+      const std::vector<Index3D>& block_indices,    // NOLINT
+      DecayEpochTracker* epoch_tracker,             // NOLINT
+      const CudaStream cuda_stream,                 // NOLINT
+      std::vector<Index3D>* changed_blocks);
+
   // Internal buffers
   host_vector<typename LayerType::BlockType*> allocated_block_ptrs_host_;
   device_vector<typename LayerType::BlockType*> allocated_block_ptrs_device_;
@@ -74,6 +139,14 @@ class VoxelDecayer {
   device_vector<Index3D> allocated_block_indices_device_;
   device_vector<bool> block_fully_decayed_device_;
   host_vector<bool> block_fully_decayed_host_;
+
+  // Buffers of the epoch-based decay
+  host_vector<int> num_epochs_host_;
+  device_vector<int> num_epochs_device_;
+  device_vector<bool> block_changed_device_;
+  host_vector<bool> block_changed_host_;
+  device_vector<int> num_epochs_until_due_device_;
+  host_vector<int> num_epochs_until_due_host_;
 };
 
 }  // namespace nvblox
@@ -38,6 +38,29 @@ void DecayIntegratorBase<LayerType>::deallocate_decayed_blocks(
   deallocate_decayed_blocks_ = deallocate_decayed_blocks;
 }
 
+template <typename LayerType>
+void DecayIntegratorBase<LayerType>::markBlocksUpdated(
+    const std::vector<Index3D>& block_indices) {
+  epoch_tracker_.markBlocksUpdated(block_indices);
+}
+
+template <typename LayerType>
+void DecayIntegratorBase<LayerType>::forgetBlocks(
+    const std::vector<Index3D>& block_indices) {
+  epoch_tracker_.forgetBlocks(block_indices);
+}
+
+template <typename LayerType>
+void DecayIntegratorBase<LayerType>::resetDecayEpochs() {
+  epoch_tracker_.clear();
+}
+
+template <typename LayerType>
+const DecayEpochTracker& DecayIntegratorBase<LayerType>::epoch_tracker()
+    const {
+  return epoch_tracker_;
+}
+
 template <typename LayerType>
 parameters::ParameterTreeNode DecayIntegratorBase<LayerType>::getParameterTree(
     const std::string& name_remap) const {
@@ -21,6 +21,9 @@ template <typename BlockType>
 __host__ std::vector<BlockType*> getBlockPtrsFromIndices(
     const std::vector<Index3D>& block_indices,
     BlockLayer<BlockType>* layer_ptr) {
+  // The blocks are about to be written. Copy the ones shared with a snapshot
+  // in a single batch.
+  layer_ptr->unshareBlocks(block_indices);
   std::vector<BlockType*> block_ptrs;
   block_ptrs.reserve(block_indices.size());
   for (const Index3D& block_index : block_indices) {
@@ -116,4 +116,14 @@ parameters::ParameterTreeNode ProjectiveIntegrator<VoxelType>::getParameterTree(
        view_calculator_.getParameterTree()});
 }
 
+template <typename VoxelType>
+MemoryUsage ProjectiveIntegrator<VoxelType>::getScratchMemoryUsage() const {
+  MemoryUsage usage = view_calculator_.getScratchMemoryUsage();
+  usage.addVector(block_indices_device_);
+  usage.addVector(block_ptrs_device_);
+  usage.addVector(block_indices_host_);
+  usage.addVector(block_ptrs_host_);
+  return usage;
+}
+
 }  // namespace nvblox
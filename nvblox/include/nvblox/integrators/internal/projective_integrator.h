@@ -16,6 +16,7 @@ limitations under the License.
 #pragma once
 
 #include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/gpu_hash/gpu_layer_view.h"
 #include "nvblox/integrators/projective_integrator_params.h"
@@ -122,6 +123,11 @@ class ProjectiveIntegrator {
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during integration. The buffers
+  /// grow to fit the largest update so far and are never shrunk.
+  /// @return The memory usage.
+  virtual MemoryUsage getScratchMemoryUsage() const;
+
  protected:
   /// For voxels with a radius, allocate memory and give a small weight and
   /// truncation distance, effectively making these voxels free-space. Does not
@@ -87,6 +87,46 @@ class OccupancyDecayIntegrator : public DecayIntegratorBase<OccupancyLayer> {
       const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
       const CudaStream cuda_stream) override;
 
+  /// Decay a quantized occupancy layer. Optional block and voxel view
+  /// exclusion. Epoch-based decay is not supported for quantized layers.
+  /// @param layer_ptr               Layer to decay
+  /// @param block_exclusion_options Specifies blocks to be excluded from decay
+  /// @param view_exclusion_options  Specifies view in which to exclude voxels
+  /// @param cuda_stream             Cuda stream for GPU work.
+  /// @return A vector containing the indices of the blocks deallocated.
+  std::vector<Index3D> decay(
+      QuantizedOccupancyLayer* layer_ptr,
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
+      const CudaStream cuda_stream);
+
+  /// Epoch-based decay. See DecayIntegratorBase::decayEpoch().
+  /// @param layer_ptr               Layer to decay
+  /// @param block_exclusion_options Blocks for which the decay is paused in
+  ///                                this epoch.
+  /// @param cuda_stream             Cuda stream for GPU work.
+  /// @param changed_blocks          Optional output. The blocks in which
+  ///                                voxels became fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> decayEpoch(
+      OccupancyLayer* layer_ptr,
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      const CudaStream cuda_stream,
+      std::vector<Index3D>* changed_blocks) override;
+
+  /// Bring blocks up to date with the current decay epoch. See
+  /// DecayIntegratorBase::applyPendingDecay().
+  /// @param layer_ptr      Layer to decay
+  /// @param block_indices  The blocks to bring up to date.
+  /// @param cuda_stream    Cuda stream for GPU work.
+  /// @param changed_blocks Optional output. The blocks in which voxels became
+  ///                       fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> applyPendingDecay(
+      OccupancyLayer* layer_ptr, const std::vector<Index3D>& block_indices,
+      const CudaStream cuda_stream,
+      std::vector<Index3D>* changed_blocks) override;
+
   /// A parameter getter
   /// The decay probability that is applied to the free region on decay.
   /// @returns the free region decay probability
@@ -124,6 +164,7 @@ class OccupancyDecayIntegrator : public DecayIntegratorBase<OccupancyLayer> {
  private:
   // The decayer which performs the decay
   VoxelDecayer<OccupancyLayer> decayer_;
+  VoxelDecayer<QuantizedOccupancyLayer> quantized_decayer_;
 
   // Parameter for the decay step (these control the rate of decay)
   float free_space_decay_log_odds_ = logOddsFromProbability(
@@ -16,6 +16,7 @@ limitations under the License.
 #pragma once
 
 #include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/integrators/internal/projective_integrator.h"
 #include "nvblox/integrators/projective_integrator_params.h"
 #include "nvblox/integrators/view_calculator.h"
@@ -123,6 +124,12 @@ class ProjectiveColorIntegrator : public ProjectiveIntegrator<ColorVoxel> {
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during integration, including the
+  /// cached synthetic depth images. The buffers grow to fit the largest
+  /// update so far and are never shrunk.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const override;
+
  protected:
   std::string getIntegratorName() const override;
 
@@ -15,6 +15,8 @@ limitations under the License.
 */
 #pragma once
 
+#include <memory>
+
 #include "nvblox/integrators/internal/projective_integrator.h"
 #include "nvblox/integrators/weighting_function.h"
 
@@ -24,6 +26,7 @@ limitations under the License.
 namespace nvblox {
 
 struct UpdateOccupancyVoxelFunctor;
+class ProjectiveQuantizedOccupancyIntegrator;
 
 /// A class performing occupancy intregration
 ///
@@ -64,6 +67,36 @@ class ProjectiveOccupancyIntegrator
                       const Lidar& lidar, OccupancyLayer* layer,
                       std::vector<Index3D>* updated_blocks = nullptr);
 
+  /// Integrates a depth image in to the passed quantized occupancy layer,
+  /// which stores log odds in 16 bit fixed point. Voxels are updated by
+  /// saturating fixed point additions, with the parameters of this
+  /// integrator.
+  /// @param depth_frame A depth image.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param camera A the camera (intrinsics) model.
+  /// @param layer A pointer to the layer into which this observation will
+  /// be intergrated.
+  /// @param updated_blocks Optional pointer to a vector which will contain
+  /// the 3D indices of blocks affected by the integration.
+  void integrateFrame(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Camera& camera, QuantizedOccupancyLayer* layer,
+                      std::vector<Index3D>* updated_blocks = nullptr);
+
+  /// Integrates a lidar depth image in to the passed quantized occupancy
+  /// layer.
+  /// @param depth_frame A depth image.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param lidar A the LiDAR model.
+  /// @param layer A pointer to the layer into which this observation will be
+  /// intergrated.
+  /// @param updated_blocks Optional pointer to a vector which will contain
+  /// the 3D indices of blocks affected by the integration.
+  void integrateFrame(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Lidar& lidar, QuantizedOccupancyLayer* layer,
+                      std::vector<Index3D>* updated_blocks = nullptr);
+
   /// A parameter getter
   /// The occupancy probability (inverse sensor model) of the free region
   /// observed on the sensor.
@@ -121,15 +154,29 @@ class ProjectiveOccupancyIntegrator
       const Vector3f& center, float radius, OccupancyLayer* layer,
       std::vector<Index3D>* updated_blocks_ptr = nullptr);
 
+  /// See markUnobservedFreeInsideRadius() above.
+  void markUnobservedFreeInsideRadius(
+      const Vector3f& center, float radius, QuantizedOccupancyLayer* layer,
+      std::vector<Index3D>* updated_blocks_ptr = nullptr);
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during integration, including
+  /// those used for quantized occupancy layers.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const override;
+
  protected:
   void setFunctorParameters(const float block_size);
   std::string getIntegratorName() const override;
 
+  // Returns the integrator for quantized occupancy layers, with the
+  // parameters of this integrator. Created on first use.
+  ProjectiveQuantizedOccupancyIntegrator& getQuantizedIntegrator();
+
   // Sensor model parameters
   float free_region_log_odds_ = logOddsFromProbability(
       kFreeRegionOccupancyProbabilityParamDesc.default_value);
@@ -145,6 +192,10 @@ class ProjectiveOccupancyIntegrator
 
   // Cuda stream
   std::shared_ptr<CudaStream> cuda_stream_;
+
+  // Integrates into QuantizedOccupancyLayers. Null until first used.
+  std::unique_ptr<ProjectiveQuantizedOccupancyIntegrator>
+      quantized_integrator_;
 };
 
 }  // namespace nvblox
@@ -15,6 +15,8 @@ limitations under the License.
 */
 #pragma once
 
+#include <memory>
+
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/integrators/internal/projective_integrator.h"
 #include "nvblox/integrators/projective_integrator_params.h"
@@ -23,6 +25,7 @@ limitations under the License.
 namespace nvblox {
 
 struct UpdateTsdfVoxelFunctor;
+class ProjectiveCompactTsdfIntegrator;
 
 /// A class performing TSDF intregration
 ///
@@ -62,6 +65,34 @@ class ProjectiveTsdfIntegrator : public ProjectiveIntegrator<TsdfVoxel> {
                       const Lidar& lidar, TsdfLayer* layer,
                       std::vector<Index3D>* updated_blocks = nullptr);
 
+  /// Integrates a depth image in to the passed compact TSDF layer, which
+  /// stores distances and weights in half precision. The fusion itself is done
+  /// in single precision, with the parameters of this integrator.
+  /// @param depth_frame A depth image.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param camera A the camera (intrinsics) model.
+  /// @param layer A pointer to the layer into which this observation will be
+  /// intergrated.
+  /// @param updated_blocks Optional pointer to a vector which will contain the
+  /// 3D indices of blocks affected by the integration.
+  void integrateFrame(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Camera& camera, CompactTsdfLayer* layer,
+                      std::vector<Index3D>* updated_blocks = nullptr);
+
+  /// Integrates a lidar depth image in to the passed compact TSDF layer.
+  /// @param depth_frame A depth image.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param lidar A the LiDAR model.
+  /// @param layer A pointer to the layer into which this observation will be
+  /// intergrated.
+  /// @param updated_blocks Optional pointer to a vector which will contain the
+  /// 3D indices of blocks affected by the integration.
+  void integrateFrame(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Lidar& lidar, CompactTsdfLayer* layer,
+                      std::vector<Index3D>* updated_blocks = nullptr);
+
   /// A parameter getter
   /// The maximum weight that voxels can have. The integrator clips the
   /// voxel weight to this value after integration. Note that currently each
@@ -121,14 +152,28 @@ class ProjectiveTsdfIntegrator : public ProjectiveIntegrator<TsdfVoxel> {
       const Vector3f& center, float radius, TsdfLayer* layer,
       std::vector<Index3D>* updated_blocks_ptr = nullptr);
 
+  /// See markUnobservedFreeInsideRadius() above.
+  void markUnobservedFreeInsideRadius(
+      const Vector3f& center, float radius, CompactTsdfLayer* layer,
+      std::vector<Index3D>* updated_blocks_ptr = nullptr);
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during integration, including
+  /// those used for compact TSDF layers.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const override;
+
  protected:
   std::string getIntegratorName() const override;
 
+  // Returns the integrator for compact TSDF layers, with the parameters of
+  // this integrator. Created on first use.
+  ProjectiveCompactTsdfIntegrator& getCompactIntegrator();
+
   // Internally used to move the VoxelUpdateFunctor to the device
   unified_ptr<UpdateTsdfVoxelFunctor> getTsdfUpdateFunctorOnDevice(
       float voxel_size);
@@ -150,6 +195,9 @@ class ProjectiveTsdfIntegrator : public ProjectiveIntegrator<TsdfVoxel> {
   // The weight given to unobserved voxels when markUnobservedFreeInsideRadius()
   // is called.
   float marked_unobserved_voxels_weight_ = 0.1f;
+
+  // Integrates into CompactTsdfLayers. Null until first used.
+  std::unique_ptr<ProjectiveCompactTsdfIntegrator> compact_integrator_;
 };
 
 }  // namespace nvblox
@@ -85,6 +85,46 @@ class TsdfDecayIntegrator : public DecayIntegratorBase<TsdfLayer> {
       const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
       const CudaStream cuda_stream) override;
 
+  /// Decay a compact (half precision) TSDF layer. Optional block and voxel
+  /// view exclusion. Epoch-based decay is not supported for compact layers.
+  /// @param layer_ptr               Layer to decay
+  /// @param block_exclusion_options Specifies blocks to be excluded from decay
+  /// @param view_exclusion_options  Specifies view in which to exclude voxels
+  /// @param cuda_stream             Cuda stream for GPU work.
+  /// @return A vector containing the indices of the blocks deallocated.
+  std::vector<Index3D> decay(
+      CompactTsdfLayer* layer_ptr,
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
+      const CudaStream cuda_stream);
+
+  /// Epoch-based decay. See DecayIntegratorBase::decayEpoch().
+  /// @param layer_ptr               Layer to decay
+  /// @param block_exclusion_options Blocks for which the decay is paused in
+  ///                                this epoch.
+  /// @param cuda_stream             Cuda stream for GPU work.
+  /// @param changed_blocks          Optional output. The blocks in which
+  ///                                voxels became fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> decayEpoch(
+      TsdfLayer* layer_ptr,
+      const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+      const CudaStream cuda_stream,
+      std::vector<Index3D>* changed_blocks) override;
+
+  /// Bring blocks up to date with the current decay epoch. See
+  /// DecayIntegratorBase::applyPendingDecay().
+  /// @param layer_ptr      Layer to decay
+  /// @param block_indices  The blocks to bring up to date.
+  /// @param cuda_stream    Cuda stream for GPU work.
+  /// @param changed_blocks Optional output. The blocks in which voxels became
+  ///                       fully decayed.
+  /// @return A vector containing the indices of the blocks deallocated.
+  virtual std::vector<Index3D> applyPendingDecay(
+      TsdfLayer* layer_ptr, const std::vector<Index3D>& block_indices,
+      const CudaStream cuda_stream,
+      std::vector<Index3D>* changed_blocks) override;
+
   /// A parameter getter for the decay factor used to decay the weights
   /// @returns the occupied region decay probability
   float decay_factor() const;
@@ -132,6 +172,7 @@ class TsdfDecayIntegrator : public DecayIntegratorBase<TsdfLayer> {
  private:
   // The decayer which performs the decay
   VoxelDecayer<TsdfLayer> decayer_;
+  VoxelDecayer<CompactTsdfLayer> compact_decayer_;
 
   // Exponential decay factor
   float decay_factor_{kTsdfDecayFactorParamDesc.default_value};
@@ -18,6 +18,7 @@ limitations under the License.
 #include <memory>
 
 #include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/core/types.h"
 #include "nvblox/core/unified_vector.h"
@@ -136,6 +137,11 @@ class ViewCalculator {
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used for finding the blocks in view. The
+  /// buffers grow to fit the largest view so far and are never shrunk.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const;
+
  private:
   // Raycasts to all corners of all blocks touched by the endpoints of depth
   // rays.
@@ -28,13 +28,16 @@ void interpolateOnCPU(const std::vector<Vector3f>& points_L,
   CHECK(layer.memory_type() == MemoryType::kUnified)
       << "For CPU-based interpolation, the layer must be CPU accessible (ie "
          "MemoryType::kUnified).";
-  distances_ptr->reserve(points_L.size());
-  success_flags_ptr->reserve(points_L.size());
-  for (const Vector3f& p_L : points_L) {
-    float distance;
-    success_flags_ptr->push_back(interpolateOnCPU(p_L, layer, &distance));
-    distances_ptr->push_back(distance);
-  }
+  const size_t distances_offset = distances_ptr->size();
+  distances_ptr->resize(distances_offset + points_L.size());
+  // std::vector<bool> packs bits, so the flags can't be written concurrently.
+  std::vector<uint8_t> success_flags(points_L.size());
+  ThreadPool::getDefault()->parallelFor(points_L.size(), [&](int i) {
+    success_flags[i] = interpolateOnCPU(
+        points_L[i], layer, &(*distances_ptr)[distances_offset + i]);
+  });
+  success_flags_ptr->insert(success_flags_ptr->end(), success_flags.begin(),
+                            success_flags.end());
 }
 
 namespace internal {
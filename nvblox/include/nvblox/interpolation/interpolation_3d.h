@@ -21,6 +21,7 @@ limitations under the License.
 #include "nvblox/map/common_names.h"
 #include "nvblox/map/layer.h"
 #include "nvblox/map/voxels.h"
+#include "nvblox/utils/thread_pool.h"
 
 namespace nvblox {
 namespace interpolation {
@@ -28,12 +29,17 @@ namespace interpolation {
 /// Single points
 bool interpolateOnCPU(const Vector3f& p_L, const TsdfLayer& layer,
                       float* distance);
+bool interpolateOnCPU(const Vector3f& p_L, const CompactTsdfLayer& layer,
+                      float* distance);
 bool interpolateOnCPU(const Vector3f& p_L, const EsdfLayer& layer,
                       float* distance);
 bool interpolateOnCPU(const Vector3f& p_L, const OccupancyLayer& layer,
                       float* distance);
+bool interpolateOnCPU(const Vector3f& p_L, const QuantizedOccupancyLayer& layer,
+                      float* distance);
 
-/// Vectors of points
+/// Vectors of points. The results are appended to the output vectors. The
+/// points are interpolated in parallel on ThreadPool::getDefault().
 template <typename VoxelType>
 void interpolateOnCPU(const std::vector<Vector3f>& points_L,
                       const VoxelBlockLayer<VoxelType>& layer,
@@ -0,0 +1,189 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvblox/map/common_names.h"
+#include "nvblox/sensors/image.h"
+
+namespace nvblox {
+
+/// What an AsyncOutputWriter does with a new output when its queue is full.
+enum class OutputQueueFullPolicy {
+  /// Block the caller until an output has been written (back-pressure).
+  kBlock,
+  /// Drop the new output.
+  kDropNewest,
+  /// Drop the oldest queued output to make space for the new one.
+  kDropOldest,
+};
+
+template <>
+inline std::string toString(const OutputQueueFullPolicy& policy) {
+  switch (policy) {
+    case OutputQueueFullPolicy::kBlock:
+      return "kBlock";
+    case OutputQueueFullPolicy::kDropNewest:
+      return "kDropNewest";
+    default:
+      return "kDropOldest";
+  }
+}
+
+/// Counters of an AsyncOutputWriter.
+struct AsyncOutputWriterStats {
+  /// The number of outputs waiting to be written.
+  int queue_depth = 0;
+  /// The largest queue depth seen.
+  int max_queue_depth = 0;
+  /// The number of outputs accepted into the queue.
+  int64_t num_queued = 0;
+  /// The number of outputs written successfully.
+  int64_t num_written = 0;
+  /// The number of outputs whose writing failed.
+  int64_t num_failed = 0;
+  /// The number of outputs dropped because the queue was full.
+  int64_t num_dropped = 0;
+};
+
+/// Writes diagnostic outputs (images, pointclouds, meshes, text) to disk on a
+/// pool of worker threads, such that encoding and file I/O don't stall the
+/// mapping thread.
+///
+/// The write*Async() functions take ownership of or snapshot their input
+/// before returning, so the caller may modify its data right away. Voxel
+/// layers are passed as copy-on-write snapshots (see
+/// VoxelBlockLayer::createSnapshot()), images and meshes are copied. Outputs
+/// are queued in a bounded queue. When the queue is full, the new output is
+/// handled according to the OutputQueueFullPolicy. With more than one worker
+/// thread, outputs may complete out of order.
+///
+/// The destructor writes all queued outputs.
+class AsyncOutputWriter {
+ public:
+  static constexpr int kDefaultNumThreads = 1;
+  static constexpr int kDefaultMaxQueueSize = 16;
+
+  /// A function writing an output. Has to own all data it reads.
+  /// @return True if the output was written successfully.
+  using WriteFunction = std::function<bool()>;
+
+  /// Constructor. Starts the worker threads.
+  /// @param num_threads The number of worker threads.
+  /// @param max_queue_size The maximum number of outputs waiting to be
+  /// written.
+  /// @param queue_full_policy What to do with new outputs when the queue is
+  /// full.
+  AsyncOutputWriter(
+      int num_threads = kDefaultNumThreads,
+      int max_queue_size = kDefaultMaxQueueSize,
+      OutputQueueFullPolicy queue_full_policy = OutputQueueFullPolicy::kBlock);
+  /// Writes the queued outputs and stops the worker threads.
+  ~AsyncOutputWriter();
+
+  AsyncOutputWriter(const AsyncOutputWriter&) = delete;
+  AsyncOutputWriter& operator=(const AsyncOutputWriter&) = delete;
+
+  /// Queue a generic output.
+  /// @param name A name for the output, used in log messages.
+  /// @param write_function The function writing the output.
+  /// @return True if the output was queued, false if it was dropped.
+  bool writeAsync(const std::string& name, WriteFunction write_function);
+
+  /// Queue a PNG image. The image is copied to host memory before returning.
+  /// See io::writeToPng().
+  /// @param filepath The path of the file to write.
+  /// @param image The image.
+  /// @return True if the output was queued, false if it was dropped.
+  bool writePngAsync(const std::string& filepath, const ColorImage& image);
+  bool writePngAsync(const std::string& filepath, const MonoImage& image);
+
+  /// Queue a voxel layer as a PLY pointcloud. See io::outputVoxelLayerToPly().
+  /// @param filepath The path of the file to write.
+  /// @param layer_snapshot A snapshot of the layer. Must not be modified
+  /// afterwards.
+  /// @return True if the output was queued, false if it was dropped.
+  template <typename VoxelType>
+  bool writeVoxelLayerPlyAsync(
+      const std::string& filepath,
+      std::shared_ptr<const VoxelBlockLayer<VoxelType>> layer_snapshot);
+
+  /// Queue a mesh layer as a PLY mesh. The layer is copied before returning.
+  /// See io::outputMeshLayerToPly().
+  /// @param filepath The path of the file to write.
+  /// @param mesh_layer The mesh layer.
+  /// @return True if the output was queued, false if it was dropped.
+  bool writeMeshPlyAsync(const std::string& filepath,
+                         const MeshLayer& mesh_layer);
+
+  /// Queue a text file (e.g. CSV or timings).
+  /// @param filepath The path of the file to write.
+  /// @param contents The contents of the file.
+  /// @return True if the output was queued, false if it was dropped.
+  bool writeTextAsync(const std::string& filepath, std::string contents);
+
+  /// Blocks until all queued outputs are written.
+  void flush();
+
+  /// The number of outputs waiting to be written.
+  int queueDepth() const;
+
+  /// The counters of the writer.
+  AsyncOutputWriterStats getStats() const;
+
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+  int max_queue_size() const { return max_queue_size_; }
+  OutputQueueFullPolicy queue_full_policy() const {
+    return queue_full_policy_;
+  }
+
+ private:
+  struct Output {
+    std::string name;
+    WriteFunction write_function;
+  };
+
+  // The worker threads.
+  void workerLoop();
+
+  const int max_queue_size_;
+  const OutputQueueFullPolicy queue_full_policy_;
+
+  mutable std::mutex mutex_;
+  // Signalled when an output is queued or the writer stops.
+  std::condition_variable output_queued_condition_;
+  // Signalled when an output is taken from the queue or written.
+  std::condition_variable output_taken_condition_;
+  std::deque<Output> queue_;
+  int num_outputs_in_progress_ = 0;
+  bool stop_ = false;
+  AsyncOutputWriterStats stats_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox/io/internal/impl/async_output_writer_impl.h"
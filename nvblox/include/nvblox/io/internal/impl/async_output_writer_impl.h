@@ -0,0 +1,34 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include "nvblox/io/pointcloud_io.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+template <typename VoxelType>
+bool AsyncOutputWriter::writeVoxelLayerPlyAsync(
+    const std::string& filepath,
+    std::shared_ptr<const VoxelBlockLayer<VoxelType>> layer_snapshot) {
+  CHECK(layer_snapshot);
+  return writeAsync(filepath, [filepath, layer_snapshot]() {
+    timing::Timer timer("async_output_writer/write_layer_ply");
+    return io::outputVoxelLayerToPly(*layer_snapshot, filepath);
+  });
+}
+
+}  // namespace nvblox
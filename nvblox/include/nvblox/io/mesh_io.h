@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "nvblox/map/layer.h"
 #include "nvblox/mesh/mesh_block.h"
+#include "nvblox/mesh/mesh_lod.h"
 
 namespace nvblox {
 namespace io {
@@ -36,5 +37,11 @@ bool outputMeshLayerToPly(const BlockLayer<MeshBlock>& layer,
 bool outputMeshLayerToPly(const BlockLayer<MeshBlock>& layer,
                           const char* filename);
 
+// Outputs the mesh layer with each block at the level of detail selected by
+// its distance to a viewpoint.
+bool outputMeshLayerToPly(const BlockLayer<MeshBlock>& layer,
+                          const MeshLodLayers& lods, const Vector3f& viewpoint,
+                          const std::string& filename);
+
 }  // namespace io
 }  // namespace nvblox
\ No newline at end of file
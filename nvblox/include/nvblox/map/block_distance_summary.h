@@ -0,0 +1,271 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/hash.h"
+#include "nvblox/core/types.h"
+#include "nvblox/core/unified_vector.h"
+#include "nvblox/map/common_names.h"
+
+namespace nvblox {
+
+/// A summary of the distances stored in a voxel block, or, at the higher
+/// levels of a BlockDistanceSummaryPyramid, in a cube of voxel blocks. The
+/// summary bounds the stored distances, which are only conservative distances
+/// to the nearest surface for ESDF layers.
+struct BlockDistanceSummary {
+  /// The minimum distance over all observed voxels (in meters).
+  float min_distance_m = std::numeric_limits<float>::max();
+  /// The maximum distance over all observed voxels (in meters).
+  float max_distance_m = std::numeric_limits<float>::lowest();
+  /// The number of observed voxels in the summarized region.
+  int num_observed_voxels = 0;
+  /// The total number of voxels in the summarized region.
+  int num_voxels = 0;
+
+  /// Whether none of the voxels have been observed.
+  bool isFullyUnknown() const { return num_observed_voxels == 0; }
+  /// Whether all voxels have been observed.
+  bool isFullyObserved() const {
+    return num_voxels > 0 && num_observed_voxels == num_voxels;
+  }
+  /// Whether all voxels have been observed and lie outside of obstacles.
+  bool isFullyFree() const {
+    return isFullyObserved() && min_distance_m > 0.0f;
+  }
+  /// Whether all voxels have been observed and lie inside of obstacles.
+  bool isFullyOccupied() const {
+    return isFullyObserved() && max_distance_m <= 0.0f;
+  }
+
+  /// Combine the observed voxels of another summary into this one. Note that
+  /// num_voxels is left untouched.
+  void mergeObserved(const BlockDistanceSummary& other) {
+    min_distance_m = std::min(min_distance_m, other.min_distance_m);
+    max_distance_m = std::max(max_distance_m, other.max_distance_m);
+    num_observed_voxels += other.num_observed_voxels;
+  }
+};
+
+/// Computes BlockDistanceSummary's for the blocks of an EsdfLayer or a
+/// TsdfLayer. Device layers are summarized on the GPU with one thread block
+/// per voxel block, host layers are summarized on the CPU.
+class BlockDistanceSummarizer {
+ public:
+  static constexpr float kDefaultTsdfMinWeight = 1e-4;
+
+  BlockDistanceSummarizer();
+  BlockDistanceSummarizer(std::shared_ptr<CudaStream> cuda_stream);
+
+  /// Summarize ESDF blocks. A voxel counts as observed if its observed flag
+  /// is set. Distances of voxels inside obstacles are negative.
+  /// @param layer The layer containing the blocks.
+  /// @param block_indices The blocks to summarize. Must be allocated.
+  /// @return One summary per requested block.
+  std::vector<BlockDistanceSummary> summarize(
+      const EsdfLayer& layer, const std::vector<Index3D>& block_indices);
+
+  /// Summarize TSDF blocks. A voxel counts as observed if its weight reaches
+  /// tsdf_min_weight(). Note that the TSDF is truncated, so the summarized
+  /// distances are only meaningful below the truncation distance. The TSDF
+  /// also stores projective distances, which overestimate the distance to the
+  /// nearest surface, so the summaries are not conservative.
+  /// @param layer The layer containing the blocks.
+  /// @param block_indices The blocks to summarize. Must be allocated.
+  /// @return One summary per requested block.
+  std::vector<BlockDistanceSummary> summarize(
+      const TsdfLayer& layer, const std::vector<Index3D>& block_indices);
+
+  /// A parameter getter
+  /// The minimum weight of a TSDF voxel for it to count as observed.
+  /// @returns the minimum weight
+  float tsdf_min_weight() const { return tsdf_min_weight_; }
+  /// A parameter setter
+  /// See tsdf_min_weight().
+  /// @param tsdf_min_weight the minimum weight.
+  void tsdf_min_weight(float tsdf_min_weight);
+
+ private:
+  template <typename VoxelType>
+  std::vector<BlockDistanceSummary> summarizeTemplate(
+      const VoxelBlockLayer<VoxelType>& layer,
+      const std::vector<Index3D>& block_indices,
+      host_vector<const VoxelBlock<VoxelType>*>* block_ptrs_host,
+      device_vector<const VoxelBlock<VoxelType>*>* block_ptrs_device);
+
+  float tsdf_min_weight_ = kDefaultTsdfMinWeight;
+
+  // Internal buffers
+  host_vector<const EsdfBlock*> esdf_block_ptrs_host_;
+  device_vector<const EsdfBlock*> esdf_block_ptrs_device_;
+  host_vector<const TsdfBlock*> tsdf_block_ptrs_host_;
+  device_vector<const TsdfBlock*> tsdf_block_ptrs_device_;
+  device_vector<BlockDistanceSummary> summaries_device_;
+  host_vector<BlockDistanceSummary> summaries_host_;
+
+  std::shared_ptr<CudaStream> cuda_stream_;
+};
+
+/// The outcome of a collision query against a BlockDistanceSummaryPyramid.
+/// Ordered from best to worst.
+enum class CollisionStatus {
+  /// The queried volume is guaranteed to be collision free.
+  kFree,
+  /// The summaries can not decide. The voxels of the blocks returned in
+  /// blocks_to_check have to be checked.
+  kUncertain,
+  /// Parts of the queried volume have never been observed.
+  kUnknown,
+  /// The queried volume is guaranteed to be in collision.
+  kOccupied
+};
+
+/// A pyramid of BlockDistanceSummary's over the blocks of a distance layer,
+/// used to answer collision queries at block level.
+///
+/// Level 0 holds one summary per voxel block. Each higher level halves the
+/// resolution, such that a node at level L summarizes a cube of 2^L blocks
+/// per side. Summaries are updated incrementally through updateBlocks() and
+/// removeBlocks(), which also refresh the affected parents.
+///
+/// Queries descend the pyramid from the coarsest level and prune any node for
+/// which the summary guarantees the answer. Distances are stored at voxel
+/// centers, so a summary bounds the distance of any point in its node from
+/// below by min_distance_m minus half a voxel diagonal. The guarantees only
+/// hold for ESDF layers, see BlockDistanceSummarizer for TSDF layers.
+class BlockDistanceSummaryPyramid {
+ public:
+  static constexpr int kDefaultNumLevels = 4;
+
+  BlockDistanceSummaryPyramid(int num_levels = kDefaultNumLevels);
+  BlockDistanceSummaryPyramid(int num_levels,
+                              std::shared_ptr<CudaStream> cuda_stream);
+
+  /// Re-summarize blocks of a layer. Requested blocks which are not allocated
+  /// in the layer are removed from the pyramid.
+  /// @param layer The layer to summarize.
+  /// @param block_indices The blocks that changed.
+  void updateBlocks(const EsdfLayer& layer,
+                    const std::vector<Index3D>& block_indices);
+  /// See updateBlocks(const EsdfLayer&, ...)
+  void updateBlocks(const TsdfLayer& layer,
+                    const std::vector<Index3D>& block_indices);
+
+  /// Set the summaries of blocks directly (ie. from a custom source).
+  /// @param block_size The block size of the summarized layer.
+  /// @param voxel_size The voxel size of the summarized layer.
+  /// @param block_indices The indices of the summarized blocks.
+  /// @param summaries One summary per block.
+  void setBlockSummaries(float block_size, float voxel_size,
+                         const std::vector<Index3D>& block_indices,
+                         const std::vector<BlockDistanceSummary>& summaries);
+
+  /// Remove blocks from the pyramid (ie. when they're deallocated).
+  void removeBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Remove all summaries.
+  void clear();
+
+  /// Get the summary of a pyramid node.
+  /// @param index The index of the node. At level 0 this is the block index.
+  /// @param level The pyramid level.
+  /// @return A pointer to the summary or nullptr if the node is unknown.
+  const BlockDistanceSummary* getSummary(const Index3D& index,
+                                         int level = 0) const;
+
+  /// Check a sphere for collision.
+  /// @param center The center of the sphere.
+  /// @param radius The radius of the sphere (ie. the robot radius).
+  /// @param blocks_to_check Optional output. The blocks that could not be
+  /// decided at block level.
+  /// @return The collision status.
+  CollisionStatus checkSphere(
+      const Vector3f& center, float radius,
+      std::vector<Index3D>* blocks_to_check = nullptr) const;
+
+  /// Check a capsule (a sphere swept along a line segment) for collision.
+  /// @param p_start Start of the capsule's axis.
+  /// @param p_end End of the capsule's axis.
+  /// @param radius The radius of the capsule.
+  /// @param blocks_to_check Optional output. The blocks that could not be
+  /// decided at block level.
+  /// @return The collision status.
+  CollisionStatus checkCapsule(
+      const Vector3f& p_start, const Vector3f& p_end, float radius,
+      std::vector<Index3D>* blocks_to_check = nullptr) const;
+
+  /// Check the volume swept by a sphere moving along a piecewise linear path.
+  /// @param path The waypoints of the path.
+  /// @param radius The radius of the sphere.
+  /// @param blocks_to_check Optional output. The (unique) blocks that could
+  /// not be decided at block level.
+  /// @return The worst collision status along the path.
+  CollisionStatus checkPath(
+      const std::vector<Vector3f>& path, float radius,
+      std::vector<Index3D>* blocks_to_check = nullptr) const;
+
+  /// Getter
+  /// @return The number of pyramid levels (including level 0).
+  int num_levels() const { return static_cast<int>(levels_.size()); }
+  /// The number of summarized nodes at a level.
+  size_t size(int level = 0) const;
+  /// Whether the pyramid is empty.
+  bool empty() const { return levels_[0].empty(); }
+  /// The block size of the summarized layer. Negative if not yet known.
+  float block_size() const { return block_size_; }
+  /// The voxel size of the summarized layer. Negative if not yet known.
+  float voxel_size() const { return voxel_size_; }
+
+  /// Getter
+  /// @return The summarizer used to compute the block summaries.
+  const BlockDistanceSummarizer& summarizer() const { return summarizer_; }
+  /// Getter
+  /// @return The summarizer used to compute the block summaries.
+  BlockDistanceSummarizer& summarizer() { return summarizer_; }
+
+ private:
+  using SummaryMap = Index3DHashMapType<BlockDistanceSummary>::type;
+
+  template <typename LayerType>
+  void updateBlocksTemplate(const LayerType& layer,
+                            const std::vector<Index3D>& block_indices);
+
+  // Recompute the ancestors of the given level-0 blocks.
+  void updateParents(const std::vector<Index3D>& block_indices);
+
+  // Descend into a node, accumulating the status of the query.
+  void checkNode(const Index3D& index, int level, const Vector3f& p_start,
+                 const Vector3f& p_end, float radius,
+                 CollisionStatus* status,
+                 std::vector<Index3D>* blocks_to_check) const;
+
+  Index3D getParentIndex(const Index3D& index, int levels_up) const;
+  AxisAlignedBoundingBox getNodeAABB(const Index3D& index, int level) const;
+
+  std::vector<SummaryMap> levels_;
+  float block_size_ = -1.0f;
+  float voxel_size_ = -1.0f;
+
+  BlockDistanceSummarizer summarizer_;
+};
+
+}  // namespace nvblox
@@ -0,0 +1,218 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/hash.h"
+#include "nvblox/core/types.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/utils/thread_pool.h"
+
+namespace nvblox {
+
+/// Stores serialized blocks on the local file system, one file per block.
+/// Reads and writes of different blocks may happen concurrently.
+class FileBlockStore {
+ public:
+  FileBlockStore() = delete;
+  /// Constructor. The directory is created if it doesn't exist.
+  /// @param directory The directory holding the block files.
+  FileBlockStore(const std::string& directory);
+  virtual ~FileBlockStore() = default;
+
+  /// Write a block, overwriting a previously written block at the same index.
+  /// @return True on success.
+  bool write(const Index3D& block_index, const std::vector<Byte>& bytes);
+
+  /// Read a block.
+  /// @return True on success, false if the block is not in the store.
+  bool read(const Index3D& block_index, std::vector<Byte>* bytes) const;
+
+  /// Remove a block from the store.
+  /// @return True if the block was in the store.
+  bool erase(const Index3D& block_index);
+
+  /// The path of the file holding a block.
+  std::string getBlockFilePath(const Index3D& block_index) const;
+
+  /// The directory holding the block files.
+  const std::string& directory() const { return directory_; }
+
+ private:
+  std::string directory_;
+};
+
+/// Pages the blocks of a VoxelBlockLayer out to a FileBlockStore and back in.
+///
+/// Evicted blocks are removed from the layer (returning their memory to the
+/// layer's memory pool) and tracked in an evicted-block index, such that
+/// memory use is bounded by the working set while the map is kept. Blocks are
+/// either evicted explicitly, outside a working radius, or in
+/// least-recently-touched order.
+///
+/// Evicted blocks are brought back synchronously with pageInBlocks() or
+/// asynchronously: prefetch*Async() reads the block files on the thread pool
+/// and installPrefetchedBlocks() moves the prefetched blocks into the
+/// layer. The layer itself is only ever modified from the calling thread.
+///
+/// Callers should page in the blocks they are about to update. If an evicted
+/// block is nevertheless re-allocated in the layer before it is paged in, the
+/// stored copy is merged into the resident block when paging in (weighted
+/// averages for TSDF and color, summed log odds for occupancy). Merged weights
+/// are clamped to max_weight(). For other voxel types the resident voxels are
+/// kept.
+template <typename VoxelType>
+class VoxelBlockPager {
+ public:
+  using LayerType = VoxelBlockLayer<VoxelType>;
+  using BlockType = VoxelBlock<VoxelType>;
+
+  VoxelBlockPager() = delete;
+  /// Constructor
+  /// @param layer The layer to page. Must outlive the pager.
+  /// @param block_store_directory The directory where evicted blocks are
+  /// stored.
+  VoxelBlockPager(LayerType* layer, const std::string& block_store_directory);
+  VoxelBlockPager(LayerType* layer, const std::string& block_store_directory,
+                  std::shared_ptr<CudaStream> cuda_stream);
+  /// Waits for outstanding prefetches.
+  ~VoxelBlockPager();
+
+  /// Not movable, as outstanding prefetches refer to the block store.
+  VoxelBlockPager(VoxelBlockPager&&) = delete;
+  VoxelBlockPager& operator=(VoxelBlockPager&&) = delete;
+
+  /// Mark blocks as used (ie. because they were just updated). Used by
+  /// evictLeastRecentlyUsed().
+  void touchBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Evict blocks to the block store. Blocks not allocated in the layer are
+  /// ignored.
+  /// @return The evicted blocks.
+  std::vector<Index3D> evictBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Evict all blocks outside a working radius.
+  /// @return The evicted blocks.
+  std::vector<Index3D> evictOutsideRadius(const Vector3f& center,
+                                          float radius);
+
+  /// Evict the least recently touched blocks until at most
+  /// max_num_resident_blocks remain in the layer.
+  /// @return The evicted blocks.
+  std::vector<Index3D> evictLeastRecentlyUsed(size_t max_num_resident_blocks);
+
+  /// Synchronously page in evicted blocks. Blocks which are not evicted are
+  /// ignored.
+  /// @return The blocks that were installed in the layer.
+  std::vector<Index3D> pageInBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Synchronously page in the evicted blocks within a radius.
+  /// @return The blocks that were installed in the layer.
+  std::vector<Index3D> pageInWithinRadius(const Vector3f& center,
+                                          float radius);
+
+  /// Synchronously page in all evicted blocks.
+  /// @return The blocks that were installed in the layer.
+  std::vector<Index3D> pageInAllBlocks();
+
+  /// Forget all evicted blocks and remove them from the block store. Used when
+  /// the paged layer is replaced.
+  void discardEvictedBlocks();
+
+  /// Start reading evicted blocks from the block store in the background.
+  /// Blocks which are not evicted are ignored.
+  void prefetchBlocksAsync(const std::vector<Index3D>& block_indices);
+
+  /// Start reading the evicted blocks within a radius in the background.
+  void prefetchWithinRadiusAsync(const Vector3f& center, float radius);
+
+  /// Wait for outstanding prefetches and install all prefetched blocks in the
+  /// layer.
+  /// @return The blocks that were installed in the layer.
+  std::vector<Index3D> installPrefetchedBlocks();
+
+  /// Whether a block is currently evicted.
+  bool isEvicted(const Index3D& block_index) const;
+
+  /// The indices of all evicted blocks.
+  std::vector<Index3D> getEvictedBlockIndices() const;
+
+  /// The number of evicted blocks.
+  size_t num_evicted_blocks() const { return evicted_blocks_.size(); }
+
+  /// The number of blocks resident in the layer.
+  size_t num_resident_blocks() const { return layer_->numAllocatedBlocks(); }
+
+  /// The store holding the evicted blocks.
+  const FileBlockStore& block_store() const { return block_store_; }
+
+  /// The maximum weight of merged TSDF and color voxels. Should match the
+  /// max_weight() of the integrator updating the layer. Defaults to no limit.
+  float max_weight() const { return max_weight_; }
+  void max_weight(float max_weight) { max_weight_ = max_weight; }
+
+  /// The pool reading the blocks for prefetches. Defaults to
+  /// ThreadPool::getDefault().
+  std::shared_ptr<ThreadPool> thread_pool() const { return thread_pool_; }
+  void thread_pool(std::shared_ptr<ThreadPool> thread_pool);
+
+ private:
+  using PrefetchedBlocks = std::vector<std::pair<Index3D, std::vector<Byte>>>;
+
+  // Wait for an outstanding prefetch and stage its results.
+  void finishPrefetch();
+
+  // Install serialized blocks in the layer. Returns the installed blocks.
+  std::vector<Index3D> installBlocks(const PrefetchedBlocks& blocks);
+
+  LayerType* layer_;
+  FileBlockStore block_store_;
+
+  // The resident/evicted index. Resident blocks are those allocated in the
+  // layer.
+  Index3DSet evicted_blocks_;
+
+  // Recency of use for LRU eviction.
+  Index3DHashMapType<uint64_t>::type last_touched_;
+  uint64_t touch_count_ = 0;
+
+  // Blocks read from the store but not yet installed.
+  Index3DHashMapType<std::vector<Byte>>::type prefetched_blocks_;
+  std::future<PrefetchedBlocks> prefetch_future_;
+
+  float max_weight_ = std::numeric_limits<float>::max();
+
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::getDefault();
+  std::shared_ptr<CudaStream> cuda_stream_;
+};
+
+using TsdfBlockPager = VoxelBlockPager<TsdfVoxel>;
+using OccupancyBlockPager = VoxelBlockPager<OccupancyVoxel>;
+using ColorBlockPager = VoxelBlockPager<ColorVoxel>;
+using FreespaceBlockPager = VoxelBlockPager<FreespaceVoxel>;
+using EsdfBlockPager = VoxelBlockPager<EsdfVoxel>;
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/block_pager_impl.h"
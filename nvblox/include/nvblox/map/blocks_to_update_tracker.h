@@ -15,22 +15,39 @@ limitations under the License.
 */
 #pragma once
 
+#include <functional>
 #include <future>
+#include <memory>
 
 #include "nvblox/core/hash.h"
 #include "nvblox/core/types.h"
+#include "nvblox/utils/thread_pool.h"
 
 namespace nvblox {
 
 /// @brief Types of blocks being tracked.
-enum class BlocksToUpdateType { kEsdf, kMesh, kFreespace };
+enum class BlocksToUpdateType {
+  kEsdf,
+  kMesh,
+  kFreespace,
+  kTsdfDistanceSummaries
+};
 
 /// @brief Class to keep track of esdf, mesh and freespace blocks that need to
-/// be updated.
+/// be updated. Modifications run asynchronously on a thread pool. A caller
+/// waiting for a modification which no pool thread started yet runs it itself,
+/// such that it never waits behind long tasks queued on a shared pool.
 class BlocksToUpdateTracker {
  public:
   BlocksToUpdateTracker(ProjectiveLayerType projective_layer_type)
       : projective_layer_type_(projective_layer_type){};
+  /// Waits for the pending modification.
+  ~BlocksToUpdateTracker();
+
+  /// Pending modifications reference the tracker they were queued by, so
+  /// moving waits for those of both trackers first.
+  BlocksToUpdateTracker(BlocksToUpdateTracker&& other);
+  BlocksToUpdateTracker& operator=(BlocksToUpdateTracker&& other);
 
   /// @brief Adding blocks that need an update.
   /// @param blocks_to_update Vector of block indices that need an update.
@@ -52,7 +69,26 @@ class BlocksToUpdateTracker {
   /// @param blocks_to_update_type The type of blocks that got updated.
   void markBlocksAsUpdated(BlocksToUpdateType blocks_to_update_type);
 
+  /// @brief The pool running the modifications. Defaults to
+  /// ThreadPool::getDefault().
+  /// @param thread_pool The pool.
+  void thread_pool(std::shared_ptr<ThreadPool> thread_pool);
+  std::shared_ptr<ThreadPool> thread_pool() const { return thread_pool_; }
+
+  /// @brief Whether to track the blocks whose TSDF distance summaries need an
+  /// update (BlocksToUpdateType::kTsdfDistanceSummaries). Off by default.
+  /// @param track_tsdf_distance_summaries Whether to track them.
+  void track_tsdf_distance_summaries(bool track_tsdf_distance_summaries);
+
  private:
+  struct PendingModification;
+
+  // Wait for the pending modification, if any. Runs it on the calling thread
+  // if no pool thread started it yet.
+  void wait() const;
+  // Wait for the pending modification, then queue the next one.
+  void modifyAsync(std::function<void()> modification);
+
   ProjectiveLayerType projective_layer_type_;
 
   /// These collections keep track of the blocks which need to be updated on
@@ -61,9 +97,16 @@ class BlocksToUpdateTracker {
   Index3DSet esdf_blocks_to_update_;
   Index3DSet mesh_blocks_to_update_;
   Index3DSet freespace_blocks_to_update_;
+  Index3DSet tsdf_distance_summary_blocks_to_update_;
+  bool track_tsdf_distance_summaries_ = false;
+
+  // The pool running the async functions.
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::getDefault();
 
-  // Object to synchronize async functions (initialize to valid)
-  mutable std::future<void> future_ = std::async(std::launch::async, []() {});
+  // The modification queued last (nullptr if there is none) and the future of
+  // the pool task running it.
+  mutable std::shared_ptr<PendingModification> pending_modification_;
+  mutable std::future<void> future_;
 };
 
 }  // namespace nvblox
@@ -22,9 +22,22 @@ limitations under the License.
 
 namespace nvblox {
 
+/// Per-block data stored in front of the voxels. Empty by default, such that
+/// it takes up no memory. Can be specialized by voxel type.
+template <typename VoxelType>
+struct VoxelBlockHeader {};
+
+/// CompactFreespaceVoxels store their timestamps relative to the time base of
+/// their block.
+template <>
+struct VoxelBlockHeader<CompactFreespaceVoxel> {
+  /// The time in ms the voxel timestamp offsets are relative to.
+  Time time_base_ms;
+};
+
 /// A block that contains 8x8x8 voxels of a given type.
 template <typename _VoxelType>
-struct VoxelBlock {
+struct VoxelBlock : public VoxelBlockHeader<_VoxelType> {
   typedef unified_ptr<VoxelBlock> Ptr;
   typedef unified_ptr<const VoxelBlock> ConstPtr;
 
@@ -25,10 +25,16 @@ namespace nvblox {
 
 using TsdfBlock = VoxelBlock<TsdfVoxel>;
 using TsdfLayer = VoxelBlockLayer<TsdfVoxel>;
+using CompactTsdfBlock = VoxelBlock<CompactTsdfVoxel>;
+using CompactTsdfLayer = VoxelBlockLayer<CompactTsdfVoxel>;
 using FreespaceBlock = VoxelBlock<FreespaceVoxel>;
 using FreespaceLayer = VoxelBlockLayer<FreespaceVoxel>;
+using CompactFreespaceBlock = VoxelBlock<CompactFreespaceVoxel>;
+using CompactFreespaceLayer = VoxelBlockLayer<CompactFreespaceVoxel>;
 using OccupancyBlock = VoxelBlock<OccupancyVoxel>;
 using OccupancyLayer = VoxelBlockLayer<OccupancyVoxel>;
+using QuantizedOccupancyBlock = VoxelBlock<QuantizedOccupancyVoxel>;
+using QuantizedOccupancyLayer = VoxelBlockLayer<QuantizedOccupancyVoxel>;
 using EsdfBlock = VoxelBlock<EsdfVoxel>;
 using EsdfLayer = VoxelBlockLayer<EsdfVoxel>;
 using ColorBlock = VoxelBlock<ColorVoxel>;
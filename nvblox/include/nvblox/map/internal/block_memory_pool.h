@@ -52,6 +52,17 @@ class BlockMemoryPool {
   /// @param block  Block to push
   void pushBlock(const typename BlockType::Ptr block);
 
+  /// Make sure that at least num_blocks blocks can be popped without
+  /// expanding the pool. Expands in a single step if needed, which avoids
+  /// repeated expansions (and synchronizations) when many blocks are
+  /// allocated at once.
+  /// @param num_blocks  Number of blocks which should be available
+  /// @param cuda_stream Used when allocating memory. Will be synchronized.
+  void reserve(const size_t num_blocks, const CudaStream cuda_stream);
+
+  /// Number of blocks which can be popped without expanding the pool.
+  size_t numAvailableBlocks() const { return blocks_.size(); }
+
  private:
   /// Expand the memory pool and synchronize the stream
   void expand(const size_t num_blocks_to_allocate,
@@ -15,6 +15,8 @@ limitations under the License.
 */
 #pragma once
 
+#include <algorithm>
+
 #include "nvblox/map/internal/block_memory_pool.h"
 
 namespace nvblox {
@@ -30,7 +32,9 @@ template <class BlockType>
 typename BlockType::Ptr BlockMemoryPool<BlockType>::popBlock(
     const CudaStream cuda_stream) {
   if (blocks_.size() == 0) {
-    expand(kExpansionFactor * num_allocated_blocks_, cuda_stream);
+    // Pools created empty (ie. for layer snapshots) expand by a single block.
+    expand(std::max<size_t>(kExpansionFactor * num_allocated_blocks_, 1),
+           cuda_stream);
   }
   typename BlockType::Ptr popped = blocks_.top();
   BlockType::initAsync(popped.get(), memory_type_, cuda_stream);
@@ -44,9 +48,20 @@ void BlockMemoryPool<BlockType>::pushBlock(
   blocks_.push(block);
 }
 
+template <class BlockType>
+void BlockMemoryPool<BlockType>::reserve(const size_t num_blocks,
+                                         const CudaStream cuda_stream) {
+  if (blocks_.size() < num_blocks) {
+    expand(num_blocks - blocks_.size(), cuda_stream);
+  }
+}
+
 template <class BlockType>
 void BlockMemoryPool<BlockType>::expand(const size_t num_blocks_to_allocate,
                                         const CudaStream cuda_stream) {
+  if (num_blocks_to_allocate == 0) {
+    return;
+  }
   for (size_t i = 0; i < num_blocks_to_allocate; ++i) {
     blocks_.push(BlockType::allocateAsync(memory_type_, cuda_stream));
   }
@@ -0,0 +1,408 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+
+#include "nvblox/core/internal/error_check.h"
+#include "nvblox/geometry/bounding_spheres.h"
+#include "nvblox/map_saving/internal/block_serialization.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+namespace internal {
+
+// Merge a voxel read from the block store into the voxel of a block which was
+// re-allocated while it was evicted. By default the resident voxel is kept.
+// Merged weights are clamped to max_weight, as in the integrators.
+template <typename VoxelType>
+inline void mergeStoredVoxel(const VoxelType&, float, VoxelType*) {}
+
+inline void mergeStoredVoxel(const TsdfVoxel& stored, float max_weight,
+                             TsdfVoxel* resident) {
+  const float weight = stored.weight + resident->weight;
+  if (weight > 0.0f) {
+    resident->distance = (stored.distance * stored.weight +
+                          resident->distance * resident->weight) /
+                         weight;
+  }
+  resident->weight = std::min(weight, max_weight);
+}
+
+inline void mergeStoredVoxel(const OccupancyVoxel& stored, float,
+                             OccupancyVoxel* resident) {
+  // Log odds of independent observations add up.
+  resident->log_odds += stored.log_odds;
+}
+
+inline void mergeStoredVoxel(const ColorVoxel& stored, float max_weight,
+                             ColorVoxel* resident) {
+  const float weight = stored.weight + resident->weight;
+  if (weight > 0.0f) {
+    resident->color = Color::blendTwoColors(stored.color, stored.weight,
+                                            resident->color, resident->weight);
+  }
+  resident->weight = std::min(weight, max_weight);
+}
+
+inline void mergeStoredVoxel(const FreespaceVoxel& stored, float,
+                             FreespaceVoxel* resident) {
+  // The resident voxel holds the latest freespace state. Only an occupancy
+  // seen before eviction may be more recent.
+  if (stored.last_occupied_timestamp_ms >
+      resident->last_occupied_timestamp_ms) {
+    resident->last_occupied_timestamp_ms = stored.last_occupied_timestamp_ms;
+  }
+}
+
+}  // namespace internal
+
+template <typename VoxelType>
+VoxelBlockPager<VoxelType>::VoxelBlockPager(
+    LayerType* layer, const std::string& block_store_directory)
+    : VoxelBlockPager(layer, block_store_directory,
+                      std::make_shared<CudaStreamOwning>()) {}
+
+template <typename VoxelType>
+VoxelBlockPager<VoxelType>::VoxelBlockPager(
+    LayerType* layer, const std::string& block_store_directory,
+    std::shared_ptr<CudaStream> cuda_stream)
+    : layer_(CHECK_NOTNULL(layer)),
+      block_store_(block_store_directory),
+      cuda_stream_(cuda_stream) {}
+
+template <typename VoxelType>
+VoxelBlockPager<VoxelType>::~VoxelBlockPager() {
+  thread_pool_->wait(prefetch_future_);
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::thread_pool(
+    std::shared_ptr<ThreadPool> thread_pool) {
+  CHECK(thread_pool);
+  if (thread_pool == thread_pool_) {
+    return;
+  }
+  // An outstanding prefetch runs on the previous pool.
+  finishPrefetch();
+  thread_pool_ = std::move(thread_pool);
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::touchBlocks(
+    const std::vector<Index3D>& block_indices) {
+  ++touch_count_;
+  for (const Index3D& block_index : block_indices) {
+    last_touched_[block_index] = touch_count_;
+  }
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::evictBlocks(
+    const std::vector<Index3D>& block_indices) {
+  timing::Timer timer("block_pager/evict");
+  // A background read of a block we're about to (re-)write would race with
+  // the write.
+  finishPrefetch();
+
+  // Queue the copies of all blocks and synchronize once. Read-only access,
+  // such that blocks shared with a snapshot aren't copied. The block pointers
+  // are kept until the copies are done.
+  std::vector<Index3D> serialized_block_indices;
+  std::vector<typename BlockType::ConstPtr> serialized_block_ptrs;
+  std::vector<std::vector<Byte>> serialized_blocks;
+  serialized_block_indices.reserve(block_indices.size());
+  serialized_block_ptrs.reserve(block_indices.size());
+  serialized_blocks.reserve(block_indices.size());
+  for (const Index3D& block_index : block_indices) {
+    typename BlockType::ConstPtr block_ptr =
+        static_cast<const LayerType*>(layer_)->getBlockAtIndex(block_index);
+    if (!block_ptr) {
+      continue;
+    }
+    serialized_blocks.push_back(serializeBlock(block_ptr, *cuda_stream_));
+    serialized_block_indices.push_back(block_index);
+    serialized_block_ptrs.push_back(std::move(block_ptr));
+  }
+  cuda_stream_->synchronize();
+  serialized_block_ptrs.clear();
+
+  std::vector<Index3D> evicted_blocks;
+  evicted_blocks.reserve(serialized_block_indices.size());
+  for (size_t i = 0; i < serialized_block_indices.size(); i++) {
+    const Index3D& block_index = serialized_block_indices[i];
+    if (!block_store_.write(block_index, serialized_blocks[i])) {
+      LOG(WARNING) << "Failed to write block " << block_index.transpose()
+                   << " to " << block_store_.directory()
+                   << ". Keeping it resident.";
+      continue;
+    }
+    evicted_blocks_.insert(block_index);
+    last_touched_.erase(block_index);
+    prefetched_blocks_.erase(block_index);
+    evicted_blocks.push_back(block_index);
+  }
+  layer_->clearBlocks(evicted_blocks);
+  return evicted_blocks;
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::evictOutsideRadius(
+    const Vector3f& center, float radius) {
+  return evictBlocks(getBlocksOutsideRadius(layer_->getAllBlockIndices(),
+                                            layer_->block_size(), center,
+                                            radius));
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::evictLeastRecentlyUsed(
+    size_t max_num_resident_blocks) {
+  const size_t num_resident_blocks = layer_->numAllocatedBlocks();
+  if (num_resident_blocks <= max_num_resident_blocks) {
+    return std::vector<Index3D>();
+  }
+
+  // Order the resident blocks by the time they were last touched. Blocks that
+  // were never touched come first.
+  std::vector<std::pair<uint64_t, Index3D>> blocks_by_recency;
+  blocks_by_recency.reserve(num_resident_blocks);
+  for (const Index3D& block_index : layer_->getAllBlockIndices()) {
+    const auto it = last_touched_.find(block_index);
+    const uint64_t last_touched = (it != last_touched_.end()) ? it->second : 0;
+    blocks_by_recency.emplace_back(last_touched, block_index);
+  }
+  const size_t num_to_evict = num_resident_blocks - max_num_resident_blocks;
+  std::nth_element(
+      blocks_by_recency.begin(), blocks_by_recency.begin() + num_to_evict,
+      blocks_by_recency.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::vector<Index3D> blocks_to_evict;
+  blocks_to_evict.reserve(num_to_evict);
+  for (size_t i = 0; i < num_to_evict; i++) {
+    blocks_to_evict.push_back(blocks_by_recency[i].second);
+  }
+  return evictBlocks(blocks_to_evict);
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::pageInBlocks(
+    const std::vector<Index3D>& block_indices) {
+  timing::Timer timer("block_pager/page_in");
+  finishPrefetch();
+
+  // Blocks which are already prefetched don't have to be read again.
+  PrefetchedBlocks blocks;
+  blocks.reserve(block_indices.size());
+  for (const Index3D& block_index : block_indices) {
+    if (!isEvicted(block_index)) {
+      continue;
+    }
+    auto prefetched_it = prefetched_blocks_.find(block_index);
+    if (prefetched_it != prefetched_blocks_.end()) {
+      blocks.emplace_back(block_index, std::move(prefetched_it->second));
+      prefetched_blocks_.erase(prefetched_it);
+      continue;
+    }
+    std::vector<Byte> bytes;
+    if (block_store_.read(block_index, &bytes)) {
+      blocks.emplace_back(block_index, std::move(bytes));
+    } else {
+      LOG(WARNING) << "Failed to read evicted block " << block_index.transpose()
+                   << " from " << block_store_.directory();
+    }
+  }
+  return installBlocks(blocks);
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::pageInWithinRadius(
+    const Vector3f& center, float radius) {
+  return pageInBlocks(getBlocksWithinRadius(evicted_blocks_,
+                                            layer_->block_size(), center,
+                                            radius));
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::prefetchBlocksAsync(
+    const std::vector<Index3D>& block_indices) {
+  // Only a single prefetch is in flight at a time.
+  finishPrefetch();
+
+  std::vector<Index3D> blocks_to_read;
+  for (const Index3D& block_index : block_indices) {
+    if (isEvicted(block_index) &&
+        prefetched_blocks_.find(block_index) == prefetched_blocks_.end()) {
+      blocks_to_read.push_back(block_index);
+    }
+  }
+  if (blocks_to_read.empty()) {
+    return;
+  }
+
+  // The pool task only touches the block store. Block files are not written
+  // while the read is in flight, see finishPrefetch() calls.
+  const FileBlockStore* block_store = &block_store_;
+  prefetch_future_ = thread_pool_->submit(
+      [block_store,
+       indices = std::move(blocks_to_read)]() -> PrefetchedBlocks {
+        PrefetchedBlocks blocks;
+        blocks.reserve(indices.size());
+        for (const Index3D& block_index : indices) {
+          std::vector<Byte> bytes;
+          if (block_store->read(block_index, &bytes)) {
+            blocks.emplace_back(block_index, std::move(bytes));
+          }
+        }
+        return blocks;
+      });
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::prefetchWithinRadiusAsync(
+    const Vector3f& center, float radius) {
+  prefetchBlocksAsync(getBlocksWithinRadius(evicted_blocks_,
+                                            layer_->block_size(), center,
+                                            radius));
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::installPrefetchedBlocks() {
+  timing::Timer timer("block_pager/install_prefetched");
+  finishPrefetch();
+  PrefetchedBlocks blocks;
+  blocks.reserve(prefetched_blocks_.size());
+  for (auto& index_bytes_pair : prefetched_blocks_) {
+    blocks.emplace_back(index_bytes_pair.first,
+                        std::move(index_bytes_pair.second));
+  }
+  prefetched_blocks_.clear();
+  return installBlocks(blocks);
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::pageInAllBlocks() {
+  return pageInBlocks(getEvictedBlockIndices());
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::discardEvictedBlocks() {
+  finishPrefetch();
+  for (const Index3D& block_index : evicted_blocks_) {
+    block_store_.erase(block_index);
+  }
+  evicted_blocks_.clear();
+  prefetched_blocks_.clear();
+}
+
+template <typename VoxelType>
+bool VoxelBlockPager<VoxelType>::isEvicted(const Index3D& block_index) const {
+  return evicted_blocks_.count(block_index) > 0;
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::getEvictedBlockIndices()
+    const {
+  return std::vector<Index3D>(evicted_blocks_.begin(), evicted_blocks_.end());
+}
+
+template <typename VoxelType>
+void VoxelBlockPager<VoxelType>::finishPrefetch() {
+  if (!prefetch_future_.valid()) {
+    return;
+  }
+  // Helps with pool tasks while waiting, in case we're on a pool thread.
+  thread_pool_->wait(prefetch_future_);
+  PrefetchedBlocks blocks = prefetch_future_.get();
+  for (auto& index_bytes_pair : blocks) {
+    // Blocks may have been paged in while the read was in flight.
+    if (isEvicted(index_bytes_pair.first)) {
+      prefetched_blocks_[index_bytes_pair.first] =
+          std::move(index_bytes_pair.second);
+    }
+  }
+}
+
+template <typename VoxelType>
+std::vector<Index3D> VoxelBlockPager<VoxelType>::installBlocks(
+    const PrefetchedBlocks& blocks) {
+  std::vector<Index3D> installed_blocks;
+  installed_blocks.reserve(blocks.size());
+  // Blocks which were re-allocated while evicted (ie. because they were
+  // integrated into again) are merged on the host after the copies below.
+  std::vector<std::pair<typename BlockType::Ptr, typename BlockType::Ptr>>
+      blocks_to_merge;
+  for (const auto& index_bytes_pair : blocks) {
+    const Index3D& block_index = index_bytes_pair.first;
+    if (!isEvicted(block_index)) {
+      continue;
+    }
+    // A corrupt block file is dropped.
+    if (index_bytes_pair.second.size() != serializedBlockSize<VoxelType>()) {
+      LOG(WARNING) << "Dropping evicted block " << block_index.transpose()
+                   << " with unexpected size "
+                   << index_bytes_pair.second.size();
+      evicted_blocks_.erase(block_index);
+      block_store_.erase(block_index);
+      continue;
+    }
+    typename BlockType::Ptr block_ptr = layer_->getBlockAtIndex(block_index);
+    if (block_ptr) {
+      typename BlockType::Ptr stored_block_ptr =
+          BlockType::allocateAsync(MemoryType::kHost, *cuda_stream_);
+      deserializeBlock(index_bytes_pair.second, stored_block_ptr,
+                       *cuda_stream_);
+      blocks_to_merge.emplace_back(std::move(block_ptr),
+                                   std::move(stored_block_ptr));
+    } else {
+      block_ptr =
+          layer_->allocateBlockAtIndexAsync(block_index, *cuda_stream_);
+      deserializeBlock(index_bytes_pair.second, block_ptr, *cuda_stream_);
+    }
+    installed_blocks.push_back(block_index);
+    evicted_blocks_.erase(block_index);
+    block_store_.erase(block_index);
+  }
+  // The serialized bytes have to outlive the copies.
+  cuda_stream_->synchronize();
+
+  if (!blocks_to_merge.empty()) {
+    timing::Timer merge_timer("block_pager/merge");
+    std::vector<typename BlockType::Ptr> resident_blocks_host;
+    resident_blocks_host.reserve(blocks_to_merge.size());
+    for (const auto& resident_stored_pair : blocks_to_merge) {
+      resident_blocks_host.push_back(resident_stored_pair.first.cloneAsync(
+          MemoryType::kHost, *cuda_stream_));
+    }
+    cuda_stream_->synchronize();
+    for (size_t i = 0; i < blocks_to_merge.size(); i++) {
+      VoxelType* resident_voxels = &resident_blocks_host[i]->voxels[0][0][0];
+      const VoxelType* stored_voxels =
+          &blocks_to_merge[i].second->voxels[0][0][0];
+      for (int voxel_idx = 0; voxel_idx < BlockType::kNumVoxels; voxel_idx++) {
+        internal::mergeStoredVoxel(stored_voxels[voxel_idx], max_weight_,
+                                   &resident_voxels[voxel_idx]);
+      }
+      blocks_to_merge[i].first.copyFromAsync(resident_blocks_host[i],
+                                             *cuda_stream_);
+    }
+    cuda_stream_->synchronize();
+  }
+  touchBlocks(installed_blocks);
+  return installed_blocks;
+}
+
+}  // namespace nvblox
@@ -15,9 +15,12 @@ limitations under the License.
 */
 #pragma once
 
+#include <algorithm>
+
 #include "nvblox/utils/logging.h"
 
 #include "nvblox/core/indexing.h"
+#include "nvblox/core/morton.h"
 #include "nvblox/core/types.h"
 #include "nvblox/map/accessors.h"
 
@@ -51,7 +54,9 @@ void BlockLayer<BlockType>::copyFromAsync(const BlockLayer& other,
     }
     typename BlockType::Ptr new_block = memory_pool_.popBlock(cuda_stream);
     new_block.copyFromAsync(block, cuda_stream);
-    blocks_.emplace(block_index, new_block);
+    if (blocks_.emplace(block_index, new_block).second) {
+      markBlockUnshared(block_index);
+    }
   }
 }
 
@@ -63,6 +68,12 @@ typename BlockType::Ptr BlockLayer<BlockType>::getBlockAtIndex(
   // And return it.
   auto it = blocks_.find(index);
   if (it != blocks_.end()) {
+    // The caller may write to the block.
+    if (isBlockShared(it)) {
+      CudaStreamOwning cuda_stream;
+      unshareBlockAsync(it, cuda_stream);
+      cuda_stream.synchronize();
+    }
     return it->second;
   } else {
     return typename BlockType::Ptr();
@@ -85,6 +96,7 @@ typename BlockType::Ptr BlockLayer<BlockType>::allocateBlockAtIndexAsync(
     const Index3D& index, const CudaStream& cuda_stream) {
   auto it = blocks_.find(index);
   if (it != blocks_.end()) {
+    unshareBlockAsync(it, cuda_stream);
     return it->second;
   } else {
     // Invalidate the GPU hash
@@ -92,6 +104,7 @@ typename BlockType::Ptr BlockLayer<BlockType>::allocateBlockAtIndexAsync(
 
     auto insert_status =
         blocks_.emplace(index, memory_pool_.popBlock(cuda_stream));
+    markBlockUnshared(index);
     return insert_status.first->second;
   }
 }
@@ -105,6 +118,13 @@ typename BlockType::Ptr BlockLayer<BlockType>::allocateBlockAtIndex(
 template <typename BlockType>
 void BlockLayer<BlockType>::allocateBlocksAtIndices(
     const std::vector<Index3D>& indices, const CudaStream& cuda_stream) {
+  // Grow the pool and the hash map once for all new blocks, rather than
+  // letting them grow block by block.
+  const size_t num_new_blocks = std::count_if(
+      indices.begin(), indices.end(),
+      [this](const Index3D& idx) { return blocks_.count(idx) == 0; });
+  memory_pool_.reserve(num_new_blocks, cuda_stream);
+  blocks_.reserve(blocks_.size() + num_new_blocks);
   for (const Index3D& idx : indices) {
     allocateBlockAtIndexAsync(idx, cuda_stream);
   }
@@ -150,8 +170,23 @@ std::vector<Index3D> BlockLayer<BlockType>::getAllBlockIndices() const {
   return indices;
 }
 
+template <typename BlockType>
+std::vector<Index3D> BlockLayer<BlockType>::getAllBlockIndicesInMortonOrder()
+    const {
+  std::vector<Index3D> indices = getAllBlockIndices();
+  sortBlockIndicesInMortonOrder(&indices);
+  return indices;
+}
+
 template <typename BlockType>
 std::vector<BlockType*> BlockLayer<BlockType>::getAllBlockPointers() {
+  // The caller may write to any of the blocks.
+  if (!all_blocks_unshared_) {
+    CudaStreamOwning cuda_stream;
+    unshareAllBlocksAsync(cuda_stream);
+    cuda_stream.synchronize();
+  }
+
   std::vector<BlockType*> block_ptrs;
   block_ptrs.reserve(blocks_.size());
 
@@ -181,13 +216,76 @@ template <typename BlockType>
 void BlockLayer<BlockType>::clear() {
   gpu_layer_view_up_to_date_ = false;
   blocks_.clear();
+  unshared_blocks_.clear();
+  all_blocks_unshared_ = true;
+}
+
+template <typename BlockType>
+MemoryUsage BlockLayer<BlockType>::getAllocatedBlocksMemoryUsage() const {
+  MemoryUsage usage;
+  usage.add(memory_type_, blocks_.size() * sizeof(BlockType));
+  return usage;
+}
+
+template <typename BlockType>
+MemoryReport BlockLayer<BlockType>::getMemoryReport() const {
+  MemoryReport report;
+  visitMemoryItems(
+      [&report](const char* name, const MemoryUsage& usage, size_t count) {
+        report.add(name, usage, count);
+      });
+  return report;
+}
+
+template <typename BlockType>
+MemoryUsage BlockLayer<BlockType>::getMemoryUsage() const {
+  MemoryUsage total_usage;
+  visitMemoryItems(
+      [&total_usage](const char*, const MemoryUsage& usage, size_t) {
+        total_usage += usage;
+      });
+  return total_usage;
+}
+
+template <typename BlockType>
+template <typename AddItemFunctionType>
+void BlockLayer<BlockType>::visitMemoryItems(
+    AddItemFunctionType&& add_item) const {
+  add_item("blocks", getAllocatedBlocksMemoryUsage(), blocks_.size());
+
+  MemoryUsage pool_usage;
+  pool_usage.add(memory_type_,
+                 memory_pool_.numAvailableBlocks() * sizeof(BlockType));
+  add_item("memory_pool", pool_usage, memory_pool_.numAvailableBlocks());
+
+  MemoryUsage hash_usage;
+  hash_usage.host_bytes =
+      estimateHashMapBytes(blocks_) + estimateHashMapBytes(unshared_blocks_);
+  add_item("block_hash", hash_usage, blocks_.size());
+
+  // The GPU hash is allocated on first request and is not shrunk afterwards.
+  MemoryUsage gpu_view_usage;
+  size_t gpu_hash_capacity = 0;
+  std::unique_lock<std::mutex> lock;
+  if (gpu_layer_view_mutex_) {
+    lock = std::unique_lock<std::mutex>(*gpu_layer_view_mutex_);
+  }
+  if (gpu_layer_view_) {
+    gpu_view_usage.device_bytes = gpu_layer_view_->sizeInBytes();
+    gpu_hash_capacity = gpu_layer_view_->size();
+  }
+  add_item("gpu_layer_view", gpu_view_usage, gpu_hash_capacity);
 }
 
 template <typename BlockType>
 bool BlockLayer<BlockType>::clearBlock(const Index3D& index) {
   auto it = blocks_.find(index);
   if (it != blocks_.end()) {
-    memory_pool_.pushBlock(it->second);
+    // Blocks still in use by a snapshot are not recycled.
+    if (!isBlockShared(it)) {
+      memory_pool_.pushBlock(it->second);
+    }
+    unshared_blocks_.erase(index);
     blocks_.erase(it);
     gpu_layer_view_up_to_date_ = false;
     return true;
@@ -213,20 +311,154 @@ template <typename BlockType>
 typename BlockLayer<BlockType>::GPULayerViewType
 BlockLayer<BlockType>::getGpuLayerViewAsync(
     const CudaStream& cuda_stream) const {
+  // Snapshots are read from several threads, so their view is built under a
+  // lock. It's synchronized before it's handed out, as the other readers use
+  // other streams.
+  std::unique_lock<std::mutex> lock;
+  if (gpu_layer_view_mutex_) {
+    lock = std::unique_lock<std::mutex>(*gpu_layer_view_mutex_);
+  }
   if (!gpu_layer_view_) {
     gpu_layer_view_ = std::make_unique<GPULayerViewType>();
     gpu_layer_view_up_to_date_ = false;
   }
   if (!gpu_layer_view_up_to_date_) {
-    (*gpu_layer_view_)
-        .reset(const_cast<BlockLayer<BlockType>*>(this), cuda_stream);
+    gpu_layer_view_->reset(this, cuda_stream);
     gpu_layer_view_up_to_date_ = true;
+    if (gpu_layer_view_mutex_) {
+      cuda_stream.synchronize();
+    }
   }
   return *gpu_layer_view_;
 }
 
+template <typename BlockType>
+typename BlockLayer<BlockType>::GPULayerViewType
+BlockLayer<BlockType>::getWritableGpuLayerView(
+    const std::vector<Index3D>& blocks_to_write) {
+  CudaStreamOwning cuda_stream;
+  GPULayerViewType gpu_layer_view =
+      getWritableGpuLayerViewAsync(blocks_to_write, cuda_stream);
+  cuda_stream.synchronize();
+  return gpu_layer_view;
+}
+
+template <typename BlockType>
+typename BlockLayer<BlockType>::GPULayerViewType
+BlockLayer<BlockType>::getWritableGpuLayerViewAsync(
+    const std::vector<Index3D>& blocks_to_write,
+    const CudaStream& cuda_stream) {
+  // Copying a block invalidates the GPU hash, so copy before getting it.
+  unshareBlocksAsync(blocks_to_write, cuda_stream);
+  return getGpuLayerViewAsync(cuda_stream);
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::unshareBlocksAsync(
+    const std::vector<Index3D>& indices, const CudaStream& cuda_stream) {
+  if (all_blocks_unshared_) {
+    return;
+  }
+  for (const Index3D& index : indices) {
+    auto it = blocks_.find(index);
+    if (it != blocks_.end()) {
+      unshareBlockAsync(it, cuda_stream);
+    }
+  }
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::unshareBlocks(const std::vector<Index3D>& indices) {
+  if (all_blocks_unshared_) {
+    return;
+  }
+  CudaStreamOwning cuda_stream;
+  unshareBlocksAsync(indices, cuda_stream);
+  cuda_stream.synchronize();
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::unshareAllBlocksAsync(
+    const CudaStream& cuda_stream) {
+  if (all_blocks_unshared_) {
+    return;
+  }
+  for (auto it = blocks_.begin(); it != blocks_.end(); it++) {
+    unshareBlockAsync(it, cuda_stream);
+  }
+  // Every block is now owned by this layer, until the next snapshot.
+  unshared_blocks_.clear();
+  all_blocks_unshared_ = true;
+}
+
+template <typename BlockType>
+bool BlockLayer<BlockType>::isBlockShared(const Index3D& index) const {
+  const auto it = blocks_.find(index);
+  return (it != blocks_.end()) && isBlockShared(it);
+}
+
+template <typename BlockType>
+bool BlockLayer<BlockType>::isBlockShared(
+    const typename BlockHash::const_iterator& it) const {
+  if (all_blocks_unshared_ || unshared_blocks_.count(it->first) > 0) {
+    return false;
+  }
+  // The block was allocated before the last snapshot. It's shared unless all
+  // snapshots referring to it were released.
+  return it->second.use_count() > 1;
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::unshareBlockAsync(
+    const typename BlockHash::iterator& it, const CudaStream& cuda_stream) {
+  if (all_blocks_unshared_ || unshared_blocks_.count(it->first) > 0) {
+    return;
+  }
+  if (it->second.use_count() > 1) {
+    // Copy the block. The snapshot keeps the original.
+    typename BlockType::Ptr block_copy = memory_pool_.popBlock(cuda_stream);
+    block_copy.copyFromAsync(it->second, cuda_stream);
+    it->second = block_copy;
+    // The GPU hash points to the original.
+    gpu_layer_view_up_to_date_ = false;
+  }
+  unshared_blocks_.insert(it->first);
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::markBlockUnshared(const Index3D& index) {
+  if (!all_blocks_unshared_) {
+    unshared_blocks_.insert(index);
+  }
+}
+
+template <typename BlockType>
+void BlockLayer<BlockType>::shareBlocksWithSnapshot(BlockLayer* snapshot) {
+  CHECK_NOTNULL(snapshot);
+  CHECK(snapshot->blocks_.empty());
+  // Copying the hash shares the blocks.
+  snapshot->blocks_ = blocks_;
+  snapshot->gpu_layer_view_up_to_date_ = false;
+  snapshot->gpu_layer_view_mutex_ = std::make_unique<std::mutex>();
+  // From now on all blocks have to be copied before they're written.
+  ++snapshot_generation_;
+  unshared_blocks_.clear();
+  all_blocks_unshared_ = false;
+  snapshot->snapshot_generation_ = snapshot_generation_;
+}
+
 // VoxelBlockLayer
 
+template <typename VoxelType>
+std::shared_ptr<const VoxelBlockLayer<VoxelType>>
+VoxelBlockLayer<VoxelType>::createSnapshot() {
+  // The snapshot never allocates blocks, so its memory pool starts empty.
+  std::shared_ptr<VoxelBlockLayer> snapshot(
+      new VoxelBlockLayer(voxel_size_, this->memory_type_, 0));
+  this->shareBlocksWithSnapshot(snapshot.get());
+  return snapshot;
+}
+
 template <typename VoxelType>
 void VoxelBlockLayer<VoxelType>::getVoxels(
     const std::vector<Vector3f>& positions_L,
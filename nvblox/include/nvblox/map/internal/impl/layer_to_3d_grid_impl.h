@@ -0,0 +1,198 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "nvblox/utils/thread_pool.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+namespace internal {
+
+// Copies the part of a single block which lies inside the grid. A null
+// block_ptr writes the default value.
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+inline void copyBlockToDenseGridOnHost(
+    const VoxelBlock<InputVoxelType>* block_ptr, const Index3D& block_idx,
+    const OutputCellType& default_value, const ConversionFunctor& conversion_op,
+    Unified3DGrid<OutputCellType>* grid) {
+  constexpr int kVoxelsPerSide = VoxelBlock<InputVoxelType>::kVoxelsPerSide;
+  const Index3D block_min_vox = block_idx * kVoxelsPerSide;
+
+  // The range of voxels of this block inside the grid.
+  const Index3D grid_max_vox = grid->min_index() + grid->aabb_size();
+  const Index3D start =
+      (grid->min_index() - block_min_vox).cwiseMax(Index3D::Zero());
+  const Index3D end = (grid_max_vox - block_min_vox)
+                          .cwiseMin(Index3D::Constant(kVoxelsPerSide));
+  if ((start.array() >= end.array()).any()) {
+    return;
+  }
+
+  // The grid is z-major, and so are the voxels in a block. We therefore
+  // iterate z in the inner loop and write runs of contiguous memory.
+  for (int x = start.x(); x < end.x(); x++) {
+    for (int y = start.y(); y < end.y(); y++) {
+      OutputCellType* row_ptr =
+          &(*grid)(block_min_vox + Index3D(x, y, start.z()));
+      if (block_ptr != nullptr) {
+        for (int z = start.z(); z < end.z(); z++) {
+          *row_ptr++ = conversion_op(block_ptr->voxels[x][y][z]);
+        }
+      } else {
+        std::fill(row_ptr, row_ptr + (end.z() - start.z()), default_value);
+      }
+    }
+  }
+}
+
+// Fills the (already sized) grid from the layer. Blocks are handed out to
+// the workers of the default thread pool dynamically. Blocks write disjoint
+// parts of the grid so no further synchronization is needed.
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+void fillDenseGridOnHost(const VoxelBlockLayer<InputVoxelType>& layer,
+                         const OutputCellType& default_value,
+                         const ConversionFunctor& conversion_op,
+                         int num_threads, Unified3DGrid<OutputCellType>* grid) {
+  constexpr int kVoxelsPerSide = VoxelBlock<InputVoxelType>::kVoxelsPerSide;
+
+  // The blocks touched by the grid
+  const Index3D min_block_idx =
+      (grid->min_index().template cast<float>() / kVoxelsPerSide)
+          .array()
+          .floor()
+          .template cast<int>();
+  const Index3D max_block_idx =
+      ((grid->min_index() + grid->aabb_size() - Index3D::Ones())
+           .template cast<float>() /
+       kVoxelsPerSide)
+          .array()
+          .floor()
+          .template cast<int>();
+  const Index3D dims_in_blox = max_block_idx - min_block_idx + Index3D::Ones();
+  const size_t num_blocks = static_cast<size_t>(dims_in_blox.x()) *
+                            dims_in_blox.y() * dims_in_blox.z();
+
+  std::atomic<size_t> next_block{0};
+  auto worker = [&]() {
+    for (size_t linear_idx = next_block++; linear_idx < num_blocks;
+         linear_idx = next_block++) {
+      const int z = linear_idx % dims_in_blox.z();
+      const int y = (linear_idx / dims_in_blox.z()) % dims_in_blox.y();
+      const int x = linear_idx / (dims_in_blox.z() * dims_in_blox.y());
+      const Index3D block_idx = min_block_idx + Index3D(x, y, z);
+      // A single hash lookup per block.
+      typename VoxelBlock<InputVoxelType>::ConstPtr block_ptr =
+          layer.getBlockAtIndex(block_idx);
+      copyBlockToDenseGridOnHost(block_ptr.get(), block_idx, default_value,
+                                 conversion_op, grid);
+    }
+  };
+
+  // The calling thread does its share of the work.
+  ThreadPool& thread_pool = *ThreadPool::getDefault();
+  thread_pool.runWorkers(thread_pool.numWorkers(num_threads, num_blocks),
+                         worker);
+}
+
+template <typename VoxelType>
+struct HostIdentityFunctor {
+  inline const VoxelType& operator()(const VoxelType& voxel) const {
+    return voxel;
+  }
+};
+
+}  // namespace internal
+
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+void voxelLayerToDenseVoxelGridInAABB(
+    const VoxelBlockLayer<InputVoxelType>& layer,
+    const AxisAlignedBoundingBox& aabb, const OutputCellType default_value,
+    const ConversionFunctor& conversion_op, Unified3DGrid<OutputCellType>* grid,
+    int num_threads) {
+  CHECK_NOTNULL(grid);
+  CHECK(layer.memory_type() != MemoryType::kDevice)
+      << "The host conversion requires a host accessible layer.";
+  CHECK(grid->data().memory_type() != MemoryType::kDevice)
+      << "The host conversion requires a host accessible grid.";
+  timing::Timer timer("layer_to_3d_grid/host");
+
+  Index3D min_index;
+  Index3D aabb_size;
+  getDenseVoxelGridExtentInAABB(layer.voxel_size(), aabb, &min_index,
+                                &aabb_size);
+  grid->setAABB(min_index, aabb_size);
+  internal::fillDenseGridOnHost(layer, default_value, conversion_op,
+                                num_threads, grid);
+}
+
+template <typename VoxelType>
+void voxelLayerToDenseVoxelGridInAABB(const VoxelBlockLayer<VoxelType>& layer,
+                                      const AxisAlignedBoundingBox& aabb,
+                                      const VoxelType default_value,
+                                      Unified3DGrid<VoxelType>* grid,
+                                      int num_threads) {
+  // Pass through to conversion function with identity
+  internal::HostIdentityFunctor<VoxelType> conversion_op;
+  voxelLayerToDenseVoxelGridInAABB(layer, aabb, default_value, conversion_op,
+                                   grid, num_threads);
+}
+
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+void voxelLayerToDenseVoxelGridInAABBTiled(
+    const VoxelBlockLayer<InputVoxelType>& layer,
+    const AxisAlignedBoundingBox& aabb, const OutputCellType default_value,
+    const ConversionFunctor& conversion_op, const Index3D& tile_size_vox,
+    const DenseVoxelGridTileCallback<OutputCellType>& tile_callback,
+    MemoryType tile_memory_type, int num_threads) {
+  CHECK(tile_callback);
+  CHECK((tile_size_vox.array() > 0).all());
+  CHECK(layer.memory_type() != MemoryType::kDevice)
+      << "The host conversion requires a host accessible layer.";
+  CHECK(tile_memory_type != MemoryType::kDevice)
+      << "The host conversion requires a host accessible tile.";
+  timing::Timer timer("layer_to_3d_grid/host_tiled");
+
+  Index3D min_index;
+  Index3D aabb_size;
+  getDenseVoxelGridExtentInAABB(layer.voxel_size(), aabb, &min_index,
+                                &aabb_size);
+
+  // A single tile buffer which is reused for all tiles.
+  Unified3DGrid<OutputCellType> tile(tile_memory_type);
+  for (int x = 0; x < aabb_size.x(); x += tile_size_vox.x()) {
+    for (int y = 0; y < aabb_size.y(); y += tile_size_vox.y()) {
+      for (int z = 0; z < aabb_size.z(); z += tile_size_vox.z()) {
+        const Index3D tile_offset(x, y, z);
+        const Index3D tile_size =
+            tile_size_vox.cwiseMin(aabb_size - tile_offset);
+        tile.setAABB(min_index + tile_offset, tile_size);
+        internal::fillDenseGridOnHost(layer, default_value, conversion_op,
+                                      num_threads, &tile);
+        tile_callback(tile);
+      }
+    }
+  }
+}
+
+}  // namespace nvblox
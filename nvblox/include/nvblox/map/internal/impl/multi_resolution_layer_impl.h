@@ -0,0 +1,352 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "nvblox/core/hash.h"
+#include "nvblox/core/indexing.h"
+#include "nvblox/geometry/bounding_boxes.h"
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+
+inline bool VoxelDownsampler<TsdfVoxel>::downsample(
+    const TsdfVoxel* fine_voxels, int num_fine_voxels,
+    TsdfVoxel* coarse_voxel) {
+  float weighted_distance_sum = 0.0f;
+  float weight_sum = 0.0f;
+  for (int i = 0; i < num_fine_voxels; i++) {
+    weighted_distance_sum += fine_voxels[i].distance * fine_voxels[i].weight;
+    weight_sum += fine_voxels[i].weight;
+  }
+  if (weight_sum <= 0.0f) {
+    return false;
+  }
+  coarse_voxel->distance = weighted_distance_sum / weight_sum;
+  // Keep the weight in the range of a single (fine) observation such that the
+  // coarse level saturates at the same max weight as the fine level.
+  coarse_voxel->weight = weight_sum / static_cast<float>(num_fine_voxels);
+  return true;
+}
+
+inline bool VoxelDownsampler<OccupancyVoxel>::downsample(
+    const OccupancyVoxel* fine_voxels, int num_fine_voxels,
+    OccupancyVoxel* coarse_voxel) {
+  bool observed = false;
+  float max_log_odds = std::numeric_limits<float>::lowest();
+  for (int i = 0; i < num_fine_voxels; i++) {
+    // Zero log-odds (p=0.5) means unobserved. Unobserved voxels are left out,
+    // such that observed free space isn't turned into unknown space.
+    if (fine_voxels[i].log_odds == 0.0f) {
+      continue;
+    }
+    observed = true;
+    max_log_odds = std::max(max_log_odds, fine_voxels[i].log_odds);
+  }
+  if (!observed) {
+    return false;
+  }
+  coarse_voxel->log_odds = max_log_odds;
+  return true;
+}
+
+inline bool VoxelDownsampler<ColorVoxel>::downsample(
+    const ColorVoxel* fine_voxels, int num_fine_voxels,
+    ColorVoxel* coarse_voxel) {
+  Vector3f weighted_color_sum = Vector3f::Zero();
+  float weight_sum = 0.0f;
+  for (int i = 0; i < num_fine_voxels; i++) {
+    const Color& color = fine_voxels[i].color;
+    weighted_color_sum +=
+        fine_voxels[i].weight * Vector3f(color.r, color.g, color.b);
+    weight_sum += fine_voxels[i].weight;
+  }
+  if (weight_sum <= 0.0f) {
+    return false;
+  }
+  const Vector3f mean_color = weighted_color_sum / weight_sum;
+  coarse_voxel->color.r = static_cast<uint8_t>(std::round(mean_color.x()));
+  coarse_voxel->color.g = static_cast<uint8_t>(std::round(mean_color.y()));
+  coarse_voxel->color.b = static_cast<uint8_t>(std::round(mean_color.z()));
+  coarse_voxel->weight = weight_sum / static_cast<float>(num_fine_voxels);
+  return true;
+}
+
+namespace internal {
+
+// Integer division rounding towards negative infinity.
+inline int floorDivide(int numerator, int denominator) {
+  const int quotient = numerator / denominator;
+  const int remainder = numerator % denominator;
+  return (remainder != 0 && ((remainder < 0) != (denominator < 0)))
+             ? quotient - 1
+             : quotient;
+}
+
+}  // namespace internal
+
+template <typename VoxelType>
+MultiResolutionVoxelLayer<VoxelType>::MultiResolutionVoxelLayer(
+    float fine_voxel_size, MemoryType memory_type, int coarsening_factor)
+    : coarsening_factor_(coarsening_factor),
+      fine_layer_(fine_voxel_size, memory_type),
+      coarse_layer_(fine_voxel_size * coarsening_factor, memory_type) {
+  CHECK_GT(coarsening_factor_, 1);
+  CHECK_EQ(BlockType::kVoxelsPerSide % coarsening_factor_, 0)
+      << "The coarsening factor has to divide the number of voxels per block "
+         "side.";
+}
+
+template <typename VoxelType>
+void MultiResolutionVoxelLayer<VoxelType>::fine_region_radius_m(
+    float fine_region_radius_m) {
+  CHECK_GE(fine_region_radius_m, 0.0f);
+  fine_region_radius_m_ = fine_region_radius_m;
+}
+
+template <typename VoxelType>
+Index3D
+MultiResolutionVoxelLayer<VoxelType>::getCoarseBlockIndexFromFineBlockIndex(
+    const Index3D& fine_block_index) const {
+  return Index3D(
+      internal::floorDivide(fine_block_index.x(), coarsening_factor_),
+      internal::floorDivide(fine_block_index.y(), coarsening_factor_),
+      internal::floorDivide(fine_block_index.z(), coarsening_factor_));
+}
+
+template <typename VoxelType>
+bool MultiResolutionVoxelLayer<VoxelType>::isCoarseBlockInFineRegion(
+    const Index3D& coarse_block_index) const {
+  const AxisAlignedBoundingBox block_aabb =
+      getAABBOfBlock(coarse_layer_.block_size(), coarse_block_index);
+  if (fine_region_center_.has_value() &&
+      block_aabb.squaredExteriorDistance(fine_region_center_.value()) <=
+          fine_region_radius_m_ * fine_region_radius_m_) {
+    return true;
+  }
+  for (const AxisAlignedBoundingBox& fine_region : fine_regions_) {
+    if (block_aabb.intersects(fine_region)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename VoxelType>
+bool MultiResolutionVoxelLayer<VoxelType>::isFineBlockInFineRegion(
+    const Index3D& fine_block_index) const {
+  return isCoarseBlockInFineRegion(
+      getCoarseBlockIndexFromFineBlockIndex(fine_block_index));
+}
+
+template <typename VoxelType>
+void MultiResolutionVoxelLayer<VoxelType>::downsampleBlock(
+    const Index3D& fine_block_index, const BlockType& fine_block,
+    const Index3D& coarse_block_index, BlockType* coarse_block) const {
+  constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+  // Each coarse voxel is covered by coarsening_factor^3 fine voxels, which
+  // always lie within a single fine block.
+  const int coarse_voxels_per_fine_block = kVoxelsPerSide / coarsening_factor_;
+  const Index3D fine_block_offset =
+      fine_block_index - coarsening_factor_ * coarse_block_index;
+  const Index3D coarse_voxel_offset =
+      coarse_voxels_per_fine_block * fine_block_offset;
+
+  std::vector<VoxelType> fine_voxels(coarsening_factor_ * coarsening_factor_ *
+                                     coarsening_factor_);
+  for (int cx = 0; cx < coarse_voxels_per_fine_block; cx++) {
+    for (int cy = 0; cy < coarse_voxels_per_fine_block; cy++) {
+      for (int cz = 0; cz < coarse_voxels_per_fine_block; cz++) {
+        // Gather the fine voxels covering this coarse voxel.
+        int num_fine_voxels = 0;
+        for (int dx = 0; dx < coarsening_factor_; dx++) {
+          for (int dy = 0; dy < coarsening_factor_; dy++) {
+            for (int dz = 0; dz < coarsening_factor_; dz++) {
+              fine_voxels[num_fine_voxels++] =
+                  fine_block.voxels[cx * coarsening_factor_ + dx]
+                                   [cy * coarsening_factor_ + dy]
+                                   [cz * coarsening_factor_ + dz];
+            }
+          }
+        }
+        const Index3D coarse_voxel_index =
+            coarse_voxel_offset + Index3D(cx, cy, cz);
+        VoxelDownsampler<VoxelType>::downsample(
+            fine_voxels.data(), num_fine_voxels,
+            &coarse_block->voxels[coarse_voxel_index.x()]
+                                 [coarse_voxel_index.y()]
+                                 [coarse_voxel_index.z()]);
+      }
+    }
+  }
+}
+
+template <typename VoxelType>
+std::vector<Index3D>
+MultiResolutionVoxelLayer<VoxelType>::downsampleToCoarseLevel(
+    const std::vector<Index3D>& fine_block_indices,
+    const CudaStream& cuda_stream) {
+  // Group the fine blocks by the coarse block they fall into such that each
+  // coarse block is only copied once.
+  typename Index3DHashMapType<std::vector<Index3D>>::type
+      coarse_to_fine_indices;
+  for (const Index3D& fine_block_index : fine_block_indices) {
+    if (!fine_layer_.isBlockAllocated(fine_block_index)) {
+      continue;
+    }
+    coarse_to_fine_indices[getCoarseBlockIndexFromFineBlockIndex(
+                               fine_block_index)]
+        .push_back(fine_block_index);
+  }
+
+  const bool is_device = (memory_type() == MemoryType::kDevice);
+  std::vector<Index3D> updated_coarse_blocks;
+  updated_coarse_blocks.reserve(coarse_to_fine_indices.size());
+  for (const auto& kv : coarse_to_fine_indices) {
+    const Index3D& coarse_block_index = kv.first;
+    typename BlockType::Ptr coarse_block =
+        coarse_layer_.allocateBlockAtIndexAsync(coarse_block_index,
+                                                cuda_stream);
+    // Device blocks are modified through a host copy.
+    typename BlockType::Ptr coarse_block_host =
+        is_device ? coarse_block.cloneAsync(MemoryType::kHost, cuda_stream)
+                  : coarse_block;
+    cuda_stream.synchronize();
+
+    for (const Index3D& fine_block_index : kv.second) {
+      typename BlockType::ConstPtr fine_block =
+          fine_layer_.getBlockAtIndex(fine_block_index);
+      if (is_device) {
+        fine_block = fine_block.clone(MemoryType::kHost);
+      }
+      downsampleBlock(fine_block_index, *fine_block, coarse_block_index,
+                      coarse_block_host.get());
+    }
+
+    if (is_device) {
+      coarse_block.copyFromAsync(coarse_block_host, cuda_stream);
+    }
+    updated_coarse_blocks.push_back(coarse_block_index);
+  }
+  cuda_stream.synchronize();
+  return updated_coarse_blocks;
+}
+
+template <typename VoxelType>
+std::vector<Index3D> MultiResolutionVoxelLayer<VoxelType>::updateFineRegion(
+    const Vector3f& center, const CudaStream& cuda_stream,
+    std::vector<Index3D>* updated_coarse_blocks) {
+  fine_region_center_ = center;
+  const std::vector<Index3D> blocks_to_migrate =
+      fine_layer_.getBlockIndicesIf([this](const Index3D& fine_block_index) {
+        return !isFineBlockInFineRegion(fine_block_index);
+      });
+  if (blocks_to_migrate.empty()) {
+    return blocks_to_migrate;
+  }
+  const std::vector<Index3D> coarse_blocks =
+      downsampleToCoarseLevel(blocks_to_migrate, cuda_stream);
+  fine_layer_.clearBlocks(blocks_to_migrate);
+  if (updated_coarse_blocks != nullptr) {
+    *updated_coarse_blocks = coarse_blocks;
+  }
+  VLOG(1) << "Migrated " << blocks_to_migrate.size()
+          << " fine blocks into " << coarse_blocks.size()
+          << " coarse blocks.";
+  return blocks_to_migrate;
+}
+
+template <typename VoxelType>
+std::vector<Index3D>
+MultiResolutionVoxelLayer<VoxelType>::clearFineBlocksOutsideFineRegion() {
+  const std::vector<Index3D> blocks_to_clear =
+      fine_layer_.getBlockIndicesIf([this](const Index3D& fine_block_index) {
+        return !isFineBlockInFineRegion(fine_block_index);
+      });
+  fine_layer_.clearBlocks(blocks_to_clear);
+  return blocks_to_clear;
+}
+
+template <typename VoxelType>
+std::pair<VoxelType, bool> MultiResolutionVoxelLayer<VoxelType>::getVoxel(
+    const Vector3f& p_L, ResolutionLevel* level_ptr) const {
+  std::pair<VoxelType, bool> fine_voxel_and_flag(VoxelType(), false);
+  if (fine_layer_.isBlockAllocated(
+          getBlockIndexFromPositionInLayer(fine_layer_.block_size(), p_L))) {
+    fine_voxel_and_flag = fine_layer_.getVoxel(p_L);
+    if (fine_voxel_and_flag.second &&
+        VoxelDownsampler<VoxelType>::isObserved(fine_voxel_and_flag.first)) {
+      if (level_ptr != nullptr) {
+        *level_ptr = ResolutionLevel::kFine;
+      }
+      return fine_voxel_and_flag;
+    }
+  }
+  // The fine level has no observation here, ie. the region was migrated to
+  // the coarse level before and hasn't been observed at the fine level since.
+  const std::pair<VoxelType, bool> coarse_voxel_and_flag =
+      coarse_layer_.getVoxel(p_L);
+  if (coarse_voxel_and_flag.second || !fine_voxel_and_flag.second) {
+    if (level_ptr != nullptr) {
+      *level_ptr = ResolutionLevel::kCoarse;
+    }
+    return coarse_voxel_and_flag;
+  }
+  if (level_ptr != nullptr) {
+    *level_ptr = ResolutionLevel::kFine;
+  }
+  return fine_voxel_and_flag;
+}
+
+template <typename VoxelType>
+std::vector<Index3D>
+MultiResolutionVoxelLayer<VoxelType>::getCoarseBlocksOutsideFineRegion()
+    const {
+  return coarse_layer_.getBlockIndicesIf(
+      [this](const Index3D& coarse_block_index) {
+        return !isCoarseBlockInFineRegion(coarse_block_index);
+      });
+}
+
+template <typename VoxelType>
+bool MultiResolutionVoxelLayer<VoxelType>::isCoarseBlockOnFineRegionBoundary(
+    const Index3D& coarse_block_index) const {
+  if (!isCoarseBlockInFineRegion(coarse_block_index)) {
+    return false;
+  }
+  for (int dx = -1; dx <= 1; dx++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dz = -1; dz <= 1; dz++) {
+        if (!isCoarseBlockInFineRegion(coarse_block_index +
+                                       Index3D(dx, dy, dz))) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+template <typename VoxelType>
+void MultiResolutionVoxelLayer<VoxelType>::clear() {
+  fine_layer_.clear();
+  coarse_layer_.clear();
+}
+
+}  // namespace nvblox
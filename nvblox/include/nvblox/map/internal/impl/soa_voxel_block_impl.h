@@ -0,0 +1,55 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+namespace nvblox {
+
+template <typename VoxelType>
+SoaVoxelBlock<VoxelType>::SoaVoxelBlock() {
+  const VoxelType default_voxel;
+  for (int i = 0; i < kNumVoxels; i++) {
+    voxels.at(i) = default_voxel;
+  }
+}
+
+template <typename VoxelType>
+typename SoaVoxelBlock<VoxelType>::Ptr SoaVoxelBlock<VoxelType>::allocate(
+    MemoryType memory_type) {
+  return allocateAsync(memory_type, CudaStreamOwning());
+}
+
+template <typename VoxelType>
+typename SoaVoxelBlock<VoxelType>::Ptr SoaVoxelBlock<VoxelType>::allocateAsync(
+    MemoryType memory_type, const CudaStream& cuda_stream) {
+  Ptr voxel_block_ptr =
+      make_unified_async<SoaVoxelBlock>(memory_type, cuda_stream);
+  initAsync(voxel_block_ptr.get(), memory_type, cuda_stream);
+  return voxel_block_ptr;
+}
+
+template <typename VoxelType>
+void SoaVoxelBlock<VoxelType>::initAsync(SoaVoxelBlock<VoxelType>* block_ptr,
+                                         const MemoryType memory_type,
+                                         const CudaStream& cuda_stream) {
+  // All supported voxel types default to zero bytes.
+  if (memory_type == MemoryType::kDevice) {
+    setBlockBytesZeroOnGPUAsync(block_ptr, cuda_stream);
+  } else {
+    *block_ptr = SoaVoxelBlock<VoxelType>();
+  }
+}
+
+}  // namespace nvblox
@@ -0,0 +1,37 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+namespace nvblox {
+
+template <typename SrcBlockType, typename DstBlockType>
+void copyVoxelBlock(const SrcBlockType& src, DstBlockType* dst) {
+  static_assert(std::is_same<typename SrcBlockType::VoxelType,
+                             typename DstBlockType::VoxelType>::value,
+                "Blocks must have the same voxel type.");
+  CHECK_NOTNULL(dst);
+  using VoxelType = typename SrcBlockType::VoxelType;
+  constexpr int kVoxelsPerSide = SrcBlockType::kVoxelsPerSide;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        dst->voxels[x][y][z] = static_cast<VoxelType>(src.voxels[x][y][z]);
+      }
+    }
+  }
+}
+
+}  // namespace nvblox
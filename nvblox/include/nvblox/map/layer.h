@@ -16,10 +16,12 @@ limitations under the License.
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "nvblox/core/cuda_stream.h"
 #include "nvblox/core/hash.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/traits.h"
 #include "nvblox/core/types.h"
 #include "nvblox/core/unified_ptr.h"
@@ -75,6 +77,18 @@ class BlockLayer : public BaseLayer {
         memory_type_(memory_type),
         memory_pool_(memory_type),
         gpu_layer_view_up_to_date_(false) {}
+  /// Constructor with a given number of blocks preallocated in the memory
+  /// pool. Used for snapshots, which never allocate, and for layers which
+  /// are expected to stay (mostly) empty.
+  /// @param block_size The side-length in meters of a block.
+  /// @param memory_type Where the blocks are allocated and stored.
+  /// @param num_preallocated_blocks The initial size of the memory pool.
+  BlockLayer(float block_size, MemoryType memory_type,
+             int num_preallocated_blocks)
+      : block_size_(block_size),
+        memory_type_(memory_type),
+        memory_pool_(memory_type, num_preallocated_blocks),
+        gpu_layer_view_up_to_date_(false) {}
   virtual ~BlockLayer() = default;
 
   /// Use copyFrom() instead of copy constructors
@@ -96,6 +110,8 @@ class BlockLayer : public BaseLayer {
   void copyFromAsync(const BlockLayer& other, const CudaStream cuda_stream);
 
   /// Get a block by it's 3D index.
+  /// Note that the non-const version copies the block if it is shared with a
+  /// snapshot. See VoxelBlockLayer::createSnapshot().
   /// @param index The 3D index of the block
   /// @return A pointer to the block.
   typename BlockType::Ptr getBlockAtIndex(const Index3D& index);
@@ -103,6 +119,9 @@ class BlockLayer : public BaseLayer {
   typename BlockType::Ptr allocateBlockAtIndex(const Index3D& index);
   typename BlockType::Ptr allocateBlockAtIndexAsync(
       const Index3D& index, const CudaStream& cuda_stream);
+  /// Allocate blocks at all passed indices. The memory pool is expanded at
+  /// most once, so this is much faster than allocating many blocks one by
+  /// one. Synchronizes the stream.
   void allocateBlocksAtIndices(const std::vector<Index3D>& indices,
                                const CudaStream& cuda_stream);
 
@@ -120,7 +139,14 @@ class BlockLayer : public BaseLayer {
   /// Get the 3D indices of all allocated blocks.
   /// @return The indices.
   std::vector<Index3D> getAllBlockIndices() const;
+  /// Get the 3D indices of all allocated blocks sorted in Morton (Z) order
+  /// (see sortBlockIndicesInMortonOrder()). Unlike the hash map order of
+  /// getAllBlockIndices(), neighbouring blocks are visited close together,
+  /// which suits CPU work that also reads the neighbours of each block.
+  /// @return The sorted indices.
+  std::vector<Index3D> getAllBlockIndicesInMortonOrder() const;
   /// Get the pointers to all allocated blocks
+  /// Note that this copies all blocks shared with a snapshot.
   /// @return The pointers.
   std::vector<BlockType*> getAllBlockPointers();
 
@@ -179,7 +205,81 @@ class BlockLayer : public BaseLayer {
   /// See \ref getGpuLayerViewAsync
   GPULayerViewType getGpuLayerView() const;
 
+  /// Get a GPULayerView for writing to the layer on the GPU. The blocks
+  /// about to be written are copied first if they are shared with a snapshot
+  /// (see unshareBlocksAsync()). The plain getGpuLayerViewAsync() never copies
+  /// blocks, so kernels writing to blocks through it have to unshare them
+  /// first.
+  /// @param blocks_to_write The blocks written through the view.
+  /// @param cuda_stream The stream on which to perform the copies and the CPU
+  /// to GPU copy of the hash map.
+  /// @return The GPULayerView.
+  GPULayerViewType getWritableGpuLayerViewAsync(
+      const std::vector<Index3D>& blocks_to_write,
+      const CudaStream& cuda_stream);
+  /// See \ref getWritableGpuLayerViewAsync
+  GPULayerViewType getWritableGpuLayerView(
+      const std::vector<Index3D>& blocks_to_write);
+
+  /// Copy-on-write: Copies the blocks which are shared with a snapshot, such
+  /// that they can be modified without affecting the snapshot. Blocks which
+  /// are not shared or not allocated are skipped. Writers call this before
+  /// modifying blocks through raw pointers (this is done by the accessors
+  /// above) and can call it up front to batch the copies.
+  /// @param indices The blocks about to be written.
+  /// @param cuda_stream The stream on which to perform the copies.
+  void unshareBlocksAsync(const std::vector<Index3D>& indices,
+                          const CudaStream& cuda_stream);
+  /// See unshareBlocksAsync(). Synchronous.
+  void unshareBlocks(const std::vector<Index3D>& indices);
+  /// See unshareBlocksAsync(). Copies all shared blocks.
+  void unshareAllBlocksAsync(const CudaStream& cuda_stream);
+
+  /// Whether a block is (potentially) shared with a snapshot.
+  /// @param index The 3D index of the block.
+  /// @return True if the block has to be copied before it is written.
+  bool isBlockShared(const Index3D& index) const;
+
+  /// Whether any block is (potentially) shared with a snapshot. Writers whose
+  /// write set is expensive to compute can skip unsharing if this is false.
+  bool mayHaveSharedBlocks() const { return !all_blocks_unshared_; }
+
+  /// The number of snapshots taken of this layer. Serves as a version number
+  /// of the snapshots.
+  uint64_t snapshot_generation() const { return snapshot_generation_; }
+
+  /// The memory held by the layer. The report has the items "blocks" (the
+  /// allocated blocks), "memory_pool" (blocks reserved for future
+  /// allocations), "block_hash" (an estimate of the CPU hash) and
+  /// "gpu_layer_view" (the GPU hash and its staging buffer). Blocks shared
+  /// with a snapshot are counted by both layers.
+  /// @return The memory report.
+  MemoryReport getMemoryReport() const;
+
+  /// The total memory held by the layer, ie. the total of getMemoryReport(),
+  /// computed without building the report.
+  /// @return The memory usage.
+  MemoryUsage getMemoryUsage() const;
+
  protected:
+  /// Share all blocks with a snapshot (ie. a layer with an empty block hash).
+  /// Subsequent writes to the shared blocks in *this copy them first.
+  void shareBlocksWithSnapshot(BlockLayer* snapshot);
+
+  /// Copy-on-write helpers
+  bool isBlockShared(const typename BlockHash::const_iterator& it) const;
+  void unshareBlockAsync(const typename BlockHash::iterator& it,
+                         const CudaStream& cuda_stream);
+  void markBlockUnshared(const Index3D& index);
+
+  /// The memory held by the allocated blocks. Specialized for block types
+  /// which hold further memory, like MeshBlock.
+  MemoryUsage getAllocatedBlocksMemoryUsage() const;
+
+  /// Calls add_item(name, usage, count) for each item of getMemoryReport().
+  template <typename AddItemFunctionType>
+  void visitMemoryItems(AddItemFunctionType&& add_item) const;
+
   /// The side length in meters of a block.
   float block_size_;
 
@@ -203,8 +303,22 @@ class BlockLayer : public BaseLayer {
   ///   GPULayerView is not recopied.
   /// - Lazily allocated (space allocated on the GPU first request)
   /// - The "mutable" here is to enable caching in const member functions.
+  /// - Snapshots are read concurrently, so they build the view under
+  ///   gpu_layer_view_mutex_. Other layers have no mutex, as they're only
+  ///   used from one thread.
   mutable bool gpu_layer_view_up_to_date_;
   mutable std::unique_ptr<GPULayerViewType> gpu_layer_view_;
+  std::unique_ptr<std::mutex> gpu_layer_view_mutex_;
+
+  /// Copy-on-write bookkeeping for snapshots.
+  /// All blocks are shared with a snapshot when it is taken. Blocks allocated
+  /// or copied since the last snapshot are owned exclusively by this layer and
+  /// tracked in unshared_blocks_. A block outside this set is shared if it
+  /// still has other owners (ie. the snapshot was not released).
+  /// No bookkeeping is done for layers which were never snapshotted.
+  uint64_t snapshot_generation_ = 0;
+  Index3DSet unshared_blocks_;
+  bool all_blocks_unshared_ = true;
 };
 
 /// Specialization for BlockLayer that exclusively contains VoxelBlocks to make
@@ -228,6 +342,17 @@ class VoxelBlockLayer : public BlockLayer<VoxelBlock<_VoxelType>> {
       : BlockLayer<VoxelBlockType>(VoxelBlockType::kVoxelsPerSide * voxel_size,
                                    memory_type),
         voxel_size_(voxel_size) {}
+  /// Constructor with a given number of blocks preallocated in the memory
+  /// pool. See BlockLayer.
+  /// @param voxel_size The size of each voxel
+  /// @param memory_type In which type of memory the blocks in this layer should
+  ///                    be stored.
+  /// @param num_preallocated_blocks The initial size of the memory pool.
+  VoxelBlockLayer(float voxel_size, MemoryType memory_type,
+                  int num_preallocated_blocks)
+      : BlockLayer<VoxelBlockType>(VoxelBlockType::kVoxelsPerSide * voxel_size,
+                                   memory_type, num_preallocated_blocks),
+        voxel_size_(voxel_size) {}
   VoxelBlockLayer() = delete;
   virtual ~VoxelBlockLayer() = default;
 
@@ -241,6 +366,19 @@ class VoxelBlockLayer : public BlockLayer<VoxelBlock<_VoxelType>> {
   VoxelBlockLayer(VoxelBlockLayer&& other) = default;
   VoxelBlockLayer& operator=(VoxelBlockLayer&& other) = default;
 
+  /// Creates a copy-on-write snapshot of the layer.
+  /// The snapshot shares all blocks with this layer, so creating it only
+  /// copies the block hash. Blocks are copied lazily when this layer next
+  /// modifies them, so the memory cost of a snapshot is proportional to the
+  /// blocks changed since it was taken. The snapshot is immutable and may be
+  /// read from other threads while this layer is being written, also through
+  /// getGpuLayerView(). The snapshot has to be created on the thread writing
+  /// to this layer.
+  /// Layers written on the GPU (ie. the ESDF and freespace) copy the shared
+  /// blocks they write, see getWritableGpuLayerViewAsync().
+  /// @return The snapshot.
+  std::shared_ptr<const VoxelBlockLayer> createSnapshot();
+
   /// Gets voxels by copy from a list of positions.
   /// The positions are given with respect to the layer frame (L). The function
   /// returns the closest voxels to the passed points.
@@ -0,0 +1,124 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <functional>
+
+#include "nvblox/core/types.h"
+#include "nvblox/geometry/bounding_boxes.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/map/unified_3d_grid.h"
+
+namespace nvblox {
+
+/// Host (CPU) counterparts of the functions in
+/// map/internal/cuda/layer_to_3d_grid.cuh. These don't require a GPU: the
+/// layer has to be accessible from the host (kHost or kUnified) and so does
+/// the output grid. The work is split per voxel block over the threads of
+/// the default ThreadPool.
+
+/// The voxel extent of the dense grid covering an AABB.
+/// @param voxel_size The voxel size of the layer.
+/// @param aabb The AABB (inclusive, see voxelLayerToDenseVoxelGridInAABB()).
+/// @param min_index Output. The minimum voxel index of the grid.
+/// @param aabb_size Output. The size of the grid in voxels.
+void getDenseVoxelGridExtentInAABB(const float voxel_size,
+                                   const AxisAlignedBoundingBox& aabb,
+                                   Index3D* min_index, Index3D* aabb_size);
+
+/// Copies a VoxelLayer into a dense Unified3DGrid on the host.
+/// @tparam VoxelType The type of the voxel in the voxel layer.
+/// @param layer The voxel layer that is the source of the copy. Must be
+/// accessible from the host.
+/// @param aabb The AABB inside which to copy. The AABB is inclusive, in that we
+/// copy the voxels touched by the edges.
+/// @param default_value The default value in the output where the layer has
+/// missing data.
+/// @param grid The output grid to copy into. Must be accessible from the host.
+/// @param num_threads The maximum number of threads, including the calling
+/// thread. 0 uses the whole default ThreadPool.
+template <typename VoxelType>
+void voxelLayerToDenseVoxelGridInAABB(const VoxelBlockLayer<VoxelType>& layer,
+                                      const AxisAlignedBoundingBox& aabb,
+                                      const VoxelType default_value,
+                                      Unified3DGrid<VoxelType>* grid,
+                                      int num_threads = 0);
+
+/// Copies a VoxelLayer into a dense Unified3DGrid on the host with conversion.
+/// The conversion functor is a template parameter such that the call is
+/// inlined into the per-voxel copy loop.
+/// @tparam InputVoxelType The type of the voxel in the voxel layer.
+/// @tparam OutputCellType The type of the cell in the output grid.
+/// @tparam ConversionFunctor Functor for converting from InputVoxelType to
+/// OutputCellType. Called concurrently from several threads.
+/// @param layer The voxel layer that is the source of the copy. Must be
+/// accessible from the host.
+/// @param aabb The AABB inside which to copy. The AABB is inclusive, in that we
+/// copy the voxels touched by the edges.
+/// @param default_value The default value in the output where the layer has
+/// missing data.
+/// @param conversion_op The conversion functor.
+/// @param grid The output grid to copy into. Must be accessible from the host.
+/// @param num_threads The maximum number of threads, including the calling
+/// thread. 0 uses the whole default ThreadPool.
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+void voxelLayerToDenseVoxelGridInAABB(
+    const VoxelBlockLayer<InputVoxelType>& layer,
+    const AxisAlignedBoundingBox& aabb, const OutputCellType default_value,
+    const ConversionFunctor& conversion_op, Unified3DGrid<OutputCellType>* grid,
+    int num_threads = 0);
+
+/// Callback receiving the tiles produced by
+/// voxelLayerToDenseVoxelGridInAABBTiled(). The tile's location is given by
+/// its min_index() and aabb_size(). The grid is reused for the next tile, so
+/// the data has to be consumed (or copied) before returning.
+template <typename CellType>
+using DenseVoxelGridTileCallback =
+    std::function<void(const Unified3DGrid<CellType>& tile)>;
+
+/// Streams a VoxelLayer in an AABB into dense tiles on the host. Use this for
+/// AABBs whose dense grid doesn't fit into memory: only a single tile is held
+/// at a time. Tiles are visited in x-major, z-minor order, and tiles at the
+/// upper boundary of the AABB may be smaller than tile_size_vox.
+/// @tparam InputVoxelType The type of the voxel in the voxel layer.
+/// @tparam OutputCellType The type of the cell in the output grid.
+/// @tparam ConversionFunctor Functor for converting from InputVoxelType to
+/// OutputCellType.
+/// @param layer The voxel layer that is the source of the copy. Must be
+/// accessible from the host.
+/// @param aabb The AABB inside which to copy (inclusive).
+/// @param default_value The default value in the output where the layer has
+/// missing data.
+/// @param conversion_op The conversion functor.
+/// @param tile_size_vox The maximum size of a tile in voxels.
+/// @param tile_callback Called once per tile.
+/// @param tile_memory_type The memory type of the tile grid. Must be
+/// accessible from the host.
+/// @param num_threads The maximum number of threads, including the calling
+/// thread. 0 uses the whole default ThreadPool.
+template <typename InputVoxelType, typename OutputCellType,
+          typename ConversionFunctor>
+void voxelLayerToDenseVoxelGridInAABBTiled(
+    const VoxelBlockLayer<InputVoxelType>& layer,
+    const AxisAlignedBoundingBox& aabb, const OutputCellType default_value,
+    const ConversionFunctor& conversion_op, const Index3D& tile_size_vox,
+    const DenseVoxelGridTileCallback<OutputCellType>& tile_callback,
+    MemoryType tile_memory_type = MemoryType::kHost, int num_threads = 0);
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/layer_to_3d_grid_impl.h"
@@ -0,0 +1,93 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include "nvblox/core/morton.h"
+#include "nvblox/core/unified_ptr.h"
+#include "nvblox/map/blox.h"
+#include "nvblox/map/voxel_block_layout.h"
+#include "nvblox/map/voxels.h"
+
+namespace nvblox {
+
+/// The voxels of a MortonVoxelBlock: an array of voxels indexed by
+/// mortonIndexInBlock(). voxels[x][y][z] returns a reference to the voxel, so
+/// code written against VoxelBlock compiles unchanged, including code taking
+/// the address of a voxel.
+template <typename VoxelType>
+struct MortonVoxelStorage
+    : public SubscriptableVoxelStorage<MortonVoxelStorage<VoxelType>> {
+  using Base = SubscriptableVoxelStorage<MortonVoxelStorage<VoxelType>>;
+
+  /// Voxel access by x-major linear index, (x * 8 + y) * 8 + z.
+  VoxelType& at(int linear_index) {
+    return array[mortonIndexFromLinearIndex(linear_index)];
+  }
+  const VoxelType& at(int linear_index) const {
+    return array[mortonIndexFromLinearIndex(linear_index)];
+  }
+
+  /// The voxels in Morton order.
+  VoxelType array[Base::kNumVoxels];
+
+ private:
+  static int mortonIndexFromLinearIndex(int linear_index) {
+    return mortonIndexInBlock(linear_index >> 6, (linear_index >> 3) & 7,
+                              linear_index & 7);
+  }
+};
+
+/// A block of 8x8x8 voxels stored in Morton (Z) order. The voxels of each
+/// aligned 2x2x2 cube (a marching cubes cell, an interpolation stencil) share
+/// a cache line for small voxel types, and larger aligned cubes are contiguous
+/// too. Has the same interface as VoxelBlock, such that CPU kernels templated
+/// on the block type (e.g. the marching cubes block kernels) run on all
+/// layouts.
+///
+/// This is a host-side storage option: the GPU layers and integrators keep
+/// using VoxelBlock. Only voxel types which default to zero bytes are
+/// supported (not ColorVoxel).
+template <typename _VoxelType>
+struct MortonVoxelBlock {
+  typedef unified_ptr<MortonVoxelBlock> Ptr;
+  typedef unified_ptr<const MortonVoxelBlock> ConstPtr;
+
+  /// Allow introspection of the voxel type through BlockType::VoxelType
+  typedef _VoxelType VoxelType;
+
+  static constexpr int kVoxelsPerSide = 8;
+  static constexpr int kNumVoxels =
+      kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
+  MortonVoxelStorage<VoxelType> voxels;
+
+  /// Allocate a voxel block of a given memory type.
+  static Ptr allocateAsync(MemoryType memory_type,
+                           const CudaStream& cuda_stream);
+  static Ptr allocate(MemoryType memory_type);
+  /// Initializes all the memory of the voxels to 0 on the device and to
+  /// default constructed voxels on the host.
+  static void initAsync(MortonVoxelBlock* block_ptr,
+                        const MemoryType memory_type,
+                        const CudaStream& cuda_stream);
+};
+
+using MortonTsdfBlock = MortonVoxelBlock<TsdfVoxel>;
+using MortonOccupancyBlock = MortonVoxelBlock<OccupancyVoxel>;
+using MortonEsdfBlock = MortonVoxelBlock<EsdfVoxel>;
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/morton_voxel_block_impl.h"
@@ -0,0 +1,250 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "nvblox/core/cuda_stream.h"
+#include "nvblox/core/types.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/map/voxels.h"
+
+namespace nvblox {
+
+/// Defines how the fine voxels covering a single coarse voxel are combined
+/// when down-sampling. Specialized for the voxel types that can be stored in a
+/// MultiResolutionVoxelLayer.
+template <typename VoxelType>
+struct VoxelDownsampler;
+
+/// TSDF voxels are combined by weighted averaging of the distance.
+template <>
+struct VoxelDownsampler<TsdfVoxel> {
+  /// Combine fine voxels into a coarse voxel.
+  /// @param fine_voxels Pointer to the fine voxels covering the coarse voxel.
+  /// @param num_fine_voxels The number of fine voxels.
+  /// @param coarse_voxel The output voxel. Left untouched if none of the fine
+  /// voxels have been observed.
+  /// @return True if the coarse voxel was written.
+  static bool downsample(const TsdfVoxel* fine_voxels, int num_fine_voxels,
+                         TsdfVoxel* coarse_voxel);
+  /// Whether a voxel holds an observation. Queries of unobserved fine voxels
+  /// fall back to the coarse level.
+  static bool isObserved(const TsdfVoxel& voxel) { return voxel.weight > 0.0f; }
+};
+
+/// Occupancy voxels are combined conservatively by taking the maximum
+/// log-odds of the observed fine voxels, such that a single occupied fine voxel
+/// occupies the coarse voxel. Unobserved fine voxels don't erase free space.
+template <>
+struct VoxelDownsampler<OccupancyVoxel> {
+  /// See VoxelDownsampler<TsdfVoxel>::downsample().
+  static bool downsample(const OccupancyVoxel* fine_voxels,
+                         int num_fine_voxels, OccupancyVoxel* coarse_voxel);
+  /// See VoxelDownsampler<TsdfVoxel>::isObserved().
+  static bool isObserved(const OccupancyVoxel& voxel) {
+    return voxel.log_odds != 0.0f;
+  }
+};
+
+/// Color voxels are combined by weighted averaging of the color channels.
+template <>
+struct VoxelDownsampler<ColorVoxel> {
+  /// See VoxelDownsampler<TsdfVoxel>::downsample().
+  static bool downsample(const ColorVoxel* fine_voxels, int num_fine_voxels,
+                         ColorVoxel* coarse_voxel);
+  /// See VoxelDownsampler<TsdfVoxel>::isObserved().
+  static bool isObserved(const ColorVoxel& voxel) { return voxel.weight > 0.0f; }
+};
+
+/// The resolution level a voxel was retrieved from.
+enum class ResolutionLevel { kFine, kCoarse };
+
+/// A two-level voxel layer with a fine level near the robot (or inside
+/// user-defined regions) and a coarse level covering the far field.
+///
+/// The coarse level covers the whole map: fine blocks are down-sampled into it
+/// through downsampleToCoarseLevel(). The fine level only covers the fine
+/// region: updateFineRegion() down-samples and then deallocates fine blocks
+/// that lie outside of it. Integration is expected to happen at the fine
+/// level. Memory use is therefore bounded by the size of the fine region plus
+/// a coarse map of the whole world.
+///
+/// The fine region is defined in terms of coarse blocks, such that the
+/// boundary between the levels always lies on coarse block borders. A coarse
+/// block is in the fine region if it touches the sphere around the fine
+/// region center or any of the user-defined fine-region AABBs.
+template <typename _VoxelType>
+class MultiResolutionVoxelLayer {
+ public:
+  using VoxelType = _VoxelType;
+  using LayerType = VoxelBlockLayer<VoxelType>;
+  using BlockType = VoxelBlock<VoxelType>;
+
+  static constexpr int kDefaultCoarseningFactor = 4;
+  static constexpr float kDefaultFineRegionRadiusM = 5.0f;
+
+  MultiResolutionVoxelLayer() = delete;
+
+  /// Constructor
+  /// @param fine_voxel_size The voxel size of the fine level.
+  /// @param memory_type In which type of memory the blocks in this layer should
+  ///                    be stored.
+  /// @param coarsening_factor The ratio of coarse to fine voxel size. Must
+  ///                          divide the number of voxels per block side (ie.
+  ///                          2, 4 or 8).
+  MultiResolutionVoxelLayer(
+      float fine_voxel_size, MemoryType memory_type,
+      int coarsening_factor = kDefaultCoarseningFactor);
+  virtual ~MultiResolutionVoxelLayer() = default;
+
+  /// No copies (the contained layers are not copyable)
+  MultiResolutionVoxelLayer(const MultiResolutionVoxelLayer& other) = delete;
+  MultiResolutionVoxelLayer& operator=(const MultiResolutionVoxelLayer& other) =
+      delete;
+
+  /// Move operations
+  MultiResolutionVoxelLayer(MultiResolutionVoxelLayer&& other) = default;
+  MultiResolutionVoxelLayer& operator=(MultiResolutionVoxelLayer&& other) =
+      default;
+
+  /// Down-sample fine blocks into the coarse level. Coarse voxels are only
+  /// overwritten where the fine data has been observed.
+  /// @param fine_block_indices The fine blocks to down-sample. Unallocated
+  /// blocks are skipped.
+  /// @param cuda_stream The stream used for copies of device blocks.
+  /// @return The (unique) indices of the coarse blocks that were updated.
+  std::vector<Index3D> downsampleToCoarseLevel(
+      const std::vector<Index3D>& fine_block_indices,
+      const CudaStream& cuda_stream);
+
+  /// Move the center of the fine region and migrate the fine blocks that fell
+  /// out of it to the coarse level. Migrated blocks are down-sampled and then
+  /// deallocated from the fine level.
+  /// @param center The new center of the fine region (typically the robot).
+  /// @param cuda_stream The stream used for copies of device blocks.
+  /// @param updated_coarse_blocks Optional output. The coarse blocks that
+  /// received data.
+  /// @return The indices of the fine blocks that were deallocated.
+  std::vector<Index3D> updateFineRegion(
+      const Vector3f& center, const CudaStream& cuda_stream,
+      std::vector<Index3D>* updated_coarse_blocks = nullptr);
+
+  /// Deallocate fine blocks outside the fine region without down-sampling.
+  /// Useful for derived layers (ESDF, mesh) that are regenerated anyway.
+  /// @return The indices of the fine blocks that were deallocated.
+  std::vector<Index3D> clearFineBlocksOutsideFineRegion();
+
+  /// Get a voxel by copy. The fine level is queried first and the coarse level
+  /// serves as a fallback where the fine level is unallocated or unobserved.
+  /// See VoxelBlockLayer::getVoxel().
+  /// @param p_L Query position in the layer frame.
+  /// @param level_ptr Optional output. The level the voxel was retrieved from.
+  /// @return A pair containing the voxel copy and a flag indicating if the
+  /// voxel could be retrieved.
+  std::pair<VoxelType, bool> getVoxel(
+      const Vector3f& p_L, ResolutionLevel* level_ptr = nullptr) const;
+
+  /// Whether a coarse block lies inside the fine region.
+  bool isCoarseBlockInFineRegion(const Index3D& coarse_block_index) const;
+  /// Whether a fine block lies inside the fine region.
+  bool isFineBlockInFineRegion(const Index3D& fine_block_index) const;
+
+  /// The coarse block containing a fine block.
+  Index3D getCoarseBlockIndexFromFineBlockIndex(
+      const Index3D& fine_block_index) const;
+
+  /// Get the allocated coarse blocks that are not covered by the fine region.
+  /// These are the blocks which should be meshed at the coarse level.
+  std::vector<Index3D> getCoarseBlocksOutsideFineRegion() const;
+
+  /// Whether a coarse block lies inside the fine region, next to (ie. in the
+  /// 26-neighborhood of) a coarse block outside of it.
+  bool isCoarseBlockOnFineRegionBoundary(
+      const Index3D& coarse_block_index) const;
+
+  /// Add a user-defined region which is always kept at the fine level.
+  void addFineRegion(const AxisAlignedBoundingBox& aabb) {
+    fine_regions_.push_back(aabb);
+  }
+  /// Remove all user-defined fine regions.
+  void clearFineRegions() { fine_regions_.clear(); }
+  /// The user-defined fine regions.
+  const std::vector<AxisAlignedBoundingBox>& fine_regions() const {
+    return fine_regions_;
+  }
+
+  /// Getter
+  /// @return The center of the spherical part of the fine region, if set.
+  const std::optional<Vector3f>& fine_region_center() const {
+    return fine_region_center_;
+  }
+  /// A parameter getter
+  /// The radius of the sphere around the fine region center which is kept at
+  /// the fine level.
+  /// @returns the radius in meters
+  float fine_region_radius_m() const { return fine_region_radius_m_; }
+  /// A parameter setter
+  /// See fine_region_radius_m().
+  /// @param fine_region_radius_m the radius in meters.
+  void fine_region_radius_m(float fine_region_radius_m);
+
+  /// Clear both levels.
+  void clear();
+
+  /// Getter
+  LayerType& fine_layer() { return fine_layer_; }
+  const LayerType& fine_layer() const { return fine_layer_; }
+  LayerType& coarse_layer() { return coarse_layer_; }
+  const LayerType& coarse_layer() const { return coarse_layer_; }
+
+  float fine_voxel_size() const { return fine_layer_.voxel_size(); }
+  float coarse_voxel_size() const { return coarse_layer_.voxel_size(); }
+  int coarsening_factor() const { return coarsening_factor_; }
+  MemoryType memory_type() const { return fine_layer_.memory_type(); }
+
+  /// The total number of allocated blocks in both levels.
+  size_t numAllocatedBlocks() const {
+    return fine_layer_.numAllocatedBlocks() +
+           coarse_layer_.numAllocatedBlocks();
+  }
+
+ private:
+  // Down-samples a single (host-accessible) fine block into the (host
+  // accessible) coarse block containing it.
+  void downsampleBlock(const Index3D& fine_block_index,
+                       const BlockType& fine_block,
+                       const Index3D& coarse_block_index,
+                       BlockType* coarse_block) const;
+
+  int coarsening_factor_;
+  LayerType fine_layer_;
+  LayerType coarse_layer_;
+
+  std::optional<Vector3f> fine_region_center_;
+  float fine_region_radius_m_ = kDefaultFineRegionRadiusM;
+  std::vector<AxisAlignedBoundingBox> fine_regions_;
+};
+
+using MultiResolutionTsdfLayer = MultiResolutionVoxelLayer<TsdfVoxel>;
+using MultiResolutionOccupancyLayer = MultiResolutionVoxelLayer<OccupancyVoxel>;
+using MultiResolutionColorLayer = MultiResolutionVoxelLayer<ColorVoxel>;
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/multi_resolution_layer_impl.h"
@@ -0,0 +1,224 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include "nvblox/core/unified_ptr.h"
+#include "nvblox/map/blox.h"
+#include "nvblox/map/voxel_block_layout.h"
+#include "nvblox/map/voxels.h"
+
+namespace nvblox {
+
+/// The voxels of a SoaVoxelBlock, stored as one array per voxel field. The
+/// arrays are indexed by SoaVoxelBlock::linearIndex(), such that the voxels
+/// along z are contiguous, as they are in VoxelBlock.
+///
+/// Specializations provide at(linear_index), returning a Reference proxy with
+/// one reference member per voxel field. The proxy converts to and assigns
+/// from the voxel type, so code written as voxels[x][y][z].distance or
+/// `TsdfVoxel voxel = voxels[x][y][z]` compiles for both layouts. Taking the
+/// address of a whole voxel does not.
+template <typename VoxelType>
+struct SoaVoxelStorage;
+
+template <>
+struct SoaVoxelStorage<TsdfVoxel>
+    : public SubscriptableVoxelStorage<SoaVoxelStorage<TsdfVoxel>> {
+  struct Reference {
+    float& distance;
+    float& weight;
+
+    operator TsdfVoxel() const {
+      TsdfVoxel voxel;
+      voxel.distance = distance;
+      voxel.weight = weight;
+      return voxel;
+    }
+    const Reference& operator=(const TsdfVoxel& voxel) const {
+      distance = voxel.distance;
+      weight = voxel.weight;
+      return *this;
+    }
+    const Reference& operator=(const Reference& other) const {
+      return *this = static_cast<TsdfVoxel>(other);
+    }
+  };
+  struct ConstReference {
+    const float& distance;
+    const float& weight;
+
+    operator TsdfVoxel() const {
+      TsdfVoxel voxel;
+      voxel.distance = distance;
+      voxel.weight = weight;
+      return voxel;
+    }
+  };
+
+  Reference at(int i) { return {distance[i], weight[i]}; }
+  ConstReference at(int i) const { return {distance[i], weight[i]}; }
+
+  float distance[kNumVoxels];
+  float weight[kNumVoxels];
+};
+
+template <>
+struct SoaVoxelStorage<OccupancyVoxel>
+    : public SubscriptableVoxelStorage<SoaVoxelStorage<OccupancyVoxel>> {
+  struct Reference {
+    float& log_odds;
+
+    operator OccupancyVoxel() const {
+      OccupancyVoxel voxel;
+      voxel.log_odds = log_odds;
+      return voxel;
+    }
+    const Reference& operator=(const OccupancyVoxel& voxel) const {
+      log_odds = voxel.log_odds;
+      return *this;
+    }
+    const Reference& operator=(const Reference& other) const {
+      return *this = static_cast<OccupancyVoxel>(other);
+    }
+  };
+  struct ConstReference {
+    const float& log_odds;
+
+    operator OccupancyVoxel() const {
+      OccupancyVoxel voxel;
+      voxel.log_odds = log_odds;
+      return voxel;
+    }
+  };
+
+  Reference at(int i) { return {log_odds[i]}; }
+  ConstReference at(int i) const { return {log_odds[i]}; }
+
+  float log_odds[kNumVoxels];
+};
+
+template <>
+struct SoaVoxelStorage<EsdfVoxel>
+    : public SubscriptableVoxelStorage<SoaVoxelStorage<EsdfVoxel>> {
+  struct Reference {
+    float& squared_distance_vox;
+    Eigen::Vector3i& parent_direction;
+    bool& is_inside;
+    bool& observed;
+    bool& is_site;
+
+    operator EsdfVoxel() const {
+      EsdfVoxel voxel;
+      voxel.squared_distance_vox = squared_distance_vox;
+      voxel.parent_direction = parent_direction;
+      voxel.is_inside = is_inside;
+      voxel.observed = observed;
+      voxel.is_site = is_site;
+      return voxel;
+    }
+    const Reference& operator=(const EsdfVoxel& voxel) const {
+      squared_distance_vox = voxel.squared_distance_vox;
+      parent_direction = voxel.parent_direction;
+      is_inside = voxel.is_inside;
+      observed = voxel.observed;
+      is_site = voxel.is_site;
+      return *this;
+    }
+    const Reference& operator=(const Reference& other) const {
+      return *this = static_cast<EsdfVoxel>(other);
+    }
+  };
+  struct ConstReference {
+    const float& squared_distance_vox;
+    const Eigen::Vector3i& parent_direction;
+    const bool& is_inside;
+    const bool& observed;
+    const bool& is_site;
+
+    operator EsdfVoxel() const {
+      EsdfVoxel voxel;
+      voxel.squared_distance_vox = squared_distance_vox;
+      voxel.parent_direction = parent_direction;
+      voxel.is_inside = is_inside;
+      voxel.observed = observed;
+      voxel.is_site = is_site;
+      return voxel;
+    }
+  };
+
+  Reference at(int i) {
+    return {squared_distance_vox[i], parent_direction[i], is_inside[i],
+            observed[i], is_site[i]};
+  }
+  ConstReference at(int i) const {
+    return {squared_distance_vox[i], parent_direction[i], is_inside[i],
+            observed[i], is_site[i]};
+  }
+
+  float squared_distance_vox[kNumVoxels];
+  Eigen::Vector3i parent_direction[kNumVoxels];
+  bool is_inside[kNumVoxels];
+  bool observed[kNumVoxels];
+  bool is_site[kNumVoxels];
+};
+
+/// A block of 8x8x8 voxels stored as a structure of arrays (see
+/// SoaVoxelStorage). Has the same interface as VoxelBlock, such that CPU
+/// kernels templated on the block type (e.g. the marching cubes block kernels
+/// in marching_cubes.h) run on both layouts. Accessing the
+/// field arrays directly (e.g. voxels.distance) gives kernels contiguous rows
+/// to vectorize over.
+///
+/// This is a host-side storage option: the GPU layers and integrators keep
+/// using VoxelBlock.
+template <typename _VoxelType>
+struct SoaVoxelBlock {
+  typedef unified_ptr<SoaVoxelBlock> Ptr;
+  typedef unified_ptr<const SoaVoxelBlock> ConstPtr;
+
+  /// Allow introspection of the voxel type through BlockType::VoxelType
+  typedef _VoxelType VoxelType;
+
+  static constexpr int kVoxelsPerSide = 8;
+  static constexpr int kNumVoxels =
+      kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
+  SoaVoxelStorage<VoxelType> voxels;
+
+  /// Fills the block with default constructed voxels.
+  SoaVoxelBlock();
+
+  /// The index of voxel (x, y, z) in the field arrays.
+  static constexpr int linearIndex(int x, int y, int z) {
+    return (x * kVoxelsPerSide + y) * kVoxelsPerSide + z;
+  }
+
+  /// Allocate a voxel block of a given memory type.
+  static Ptr allocateAsync(MemoryType memory_type,
+                           const CudaStream& cuda_stream);
+  static Ptr allocate(MemoryType memory_type);
+  /// Initializes all the memory of the voxels to 0 on the device and to
+  /// default constructed voxels on the host.
+  static void initAsync(SoaVoxelBlock* block_ptr, const MemoryType memory_type,
+                        const CudaStream& cuda_stream);
+};
+
+using SoaTsdfBlock = SoaVoxelBlock<TsdfVoxel>;
+using SoaOccupancyBlock = SoaVoxelBlock<OccupancyVoxel>;
+using SoaEsdfBlock = SoaVoxelBlock<EsdfVoxel>;
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/soa_voxel_block_impl.h"
@@ -0,0 +1,109 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <type_traits>
+
+#include "nvblox/map/blox.h"
+
+namespace nvblox {
+
+/// The memory layout of the voxels in a block.
+enum class VoxelBlockLayout {
+  /// VoxelBlock: voxels[x][y][z] is an array of voxel structs, such that the
+  /// fields of a voxel are adjacent in memory.
+  kArrayOfStructs,
+  /// SoaVoxelBlock: each voxel field is a separate contiguous array, such that
+  /// a row of distances can be loaded as one vector.
+  kStructOfArrays,
+  /// MortonVoxelBlock: an array of voxel structs in Morton (Z) order, such
+  /// that the voxels of each aligned 2x2x2, 4x4x4 cube are contiguous.
+  kMortonOrder,
+};
+
+template <typename VoxelType>
+struct SoaVoxelBlock;
+template <typename VoxelType>
+struct MortonVoxelBlock;
+
+/// Select the block type of a voxel type by layout.
+template <typename VoxelType, VoxelBlockLayout kLayout>
+using VoxelBlockWithLayout = std::conditional_t<
+    kLayout == VoxelBlockLayout::kArrayOfStructs, VoxelBlock<VoxelType>,
+    std::conditional_t<kLayout == VoxelBlockLayout::kStructOfArrays,
+                       SoaVoxelBlock<VoxelType>, MortonVoxelBlock<VoxelType>>>;
+
+/// Proxy returned by the first two subscripts of a SubscriptableVoxelStorage.
+/// Makes voxels[x][y][z] compile for block layouts other than VoxelBlock.
+template <typename StorageType, int kRemainingDims>
+class VoxelSubscript {
+ public:
+  VoxelSubscript(StorageType* storage, int linear_index)
+      : storage_(storage), linear_index_(linear_index) {}
+
+  VoxelSubscript<StorageType, kRemainingDims - 1> operator[](int i) const {
+    return {storage_, linear_index_ * StorageType::kVoxelsPerSide + i};
+  }
+
+ private:
+  StorageType* storage_;
+  int linear_index_;
+};
+
+/// The last subscript resolves to whatever the storage returns for the x-major
+/// linear index of the voxel: a reference proxy or a voxel reference.
+template <typename StorageType>
+class VoxelSubscript<StorageType, 1> {
+ public:
+  VoxelSubscript(StorageType* storage, int linear_index)
+      : storage_(storage), linear_index_(linear_index) {}
+
+  decltype(auto) operator[](int i) const {
+    return storage_->at(linear_index_ * StorageType::kVoxelsPerSide + i);
+  }
+
+ private:
+  StorageType* storage_;
+  int linear_index_;
+};
+
+/// Base class providing voxels[x][y][z] for block storage types. Derived
+/// classes implement at(linear_index) (const and non-const), where
+/// linear_index = (x * 8 + y) * 8 + z.
+template <typename Derived>
+struct SubscriptableVoxelStorage {
+  static constexpr int kVoxelsPerSide = 8;
+  static constexpr int kNumVoxels =
+      kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
+
+  VoxelSubscript<Derived, 2> operator[](int x) {
+    return {static_cast<Derived*>(this), x};
+  }
+  VoxelSubscript<const Derived, 2> operator[](int x) const {
+    return {static_cast<const Derived*>(this), x};
+  }
+};
+
+/// Copy the voxels of a block into a block of the same voxel type, converting
+/// between layouts. Both blocks must be host accessible.
+/// @param src The block to copy from.
+/// @param dst The block to copy to.
+template <typename SrcBlockType, typename DstBlockType>
+void copyVoxelBlock(const SrcBlockType& src, DstBlockType* dst);
+
+}  // namespace nvblox
+
+#include "nvblox/map/internal/impl/voxel_block_layout_impl.h"
@@ -16,8 +16,11 @@ limitations under the License.
 #pragma once
 
 #include <Eigen/Core>
+#include <cstdint>
 
 #include "nvblox/core/color.h"
+#include "nvblox/core/float16.h"
+#include "nvblox/core/quantized_log_odds.h"
 #include "nvblox/core/time.h"
 
 namespace nvblox {
@@ -31,6 +34,18 @@ struct TsdfVoxel {
   float weight;
 };
 
+/// A TsdfVoxel storing its distance and weight in half precision, halving the
+/// memory (and bandwidth) of TSDF layers. The distance is bounded by the
+/// truncation distance and the weight by the maximum weight of the integrator,
+/// so 16 bits are enough for both. Members convert implicitly to float.
+struct CompactTsdfVoxel {
+  CompactTsdfVoxel() : distance(0.0f), weight(0.0f) {}
+  /// Signed projective distance of the voxel from a surface.
+  Float16 distance;
+  /// How many observations/how confident we are in this observation.
+  Float16 weight;
+};
+
 /// The freespace voxels and layer including its updating is based on
 /// the dynablox paper: https://ieeexplore.ieee.org/document/10218983
 struct FreespaceVoxel {
@@ -49,6 +64,99 @@ struct FreespaceVoxel {
   bool is_high_confidence_freespace;
 };
 
+/// A FreespaceVoxel packed into 8 instead of 24 bytes.
+///
+/// The last occupied timestamp is stored as a 32 bit offset in ms to the time
+/// base of the block that contains the voxel (see VoxelBlockHeader). The
+/// consecutive occupancy duration is stored in 30 bits (saturating at ~12
+/// days), next to the flags. The voxels are converted to and from
+/// FreespaceVoxels for processing with toFreespaceVoxel() and
+/// fromFreespaceVoxel().
+struct CompactFreespaceVoxel {
+  CompactFreespaceVoxel()
+      : last_occupied_offset_ms(0), duration_ms_and_flags(0) {}
+
+  /// Set once the voxel was updated for the first time.
+  static constexpr uint32_t kInitializedFlag = 1u << 0;
+  /// Whether a voxel belongs to the high confidence free space.
+  static constexpr uint32_t kHighConfidenceFreespaceFlag = 1u << 1;
+  static constexpr int kNumFlagBits = 2;
+  /// The largest representable consecutive occupancy duration.
+  static constexpr int64_t kMaxDurationMs = (1ll << (32 - kNumFlagBits)) - 1;
+  /// The largest representable offset of a timestamp to the block time base.
+  static constexpr int64_t kMaxTimeOffsetMs = UINT32_MAX;
+
+  /// Offset of the last occupied timestamp to the block time base in ms.
+  uint32_t last_occupied_offset_ms;
+  /// The consecutive occupancy duration in ms in the upper 30 bits, the flags
+  /// in the lower 2 bits.
+  uint32_t duration_ms_and_flags;
+
+  __host__ __device__ bool is_high_confidence_freespace() const {
+    return duration_ms_and_flags & kHighConfidenceFreespaceFlag;
+  }
+
+  /// Unpack into a FreespaceVoxel.
+  /// @param time_base_ms The time base of the block containing this voxel.
+  /// @param voxel The output voxel.
+  __host__ __device__ void toFreespaceVoxel(Time time_base_ms,
+                                            FreespaceVoxel* voxel) const {
+    // Uninitialized voxels have a zero timestamp, as FreespaceVoxels do.
+    voxel->last_occupied_timestamp_ms =
+        (duration_ms_and_flags & kInitializedFlag)
+            ? time_base_ms + Time(last_occupied_offset_ms)
+            : Time(0);
+    voxel->consecutive_occupancy_duration_ms =
+        Time(duration_ms_and_flags >> kNumFlagBits);
+    voxel->is_high_confidence_freespace = is_high_confidence_freespace();
+  }
+
+  /// Pack a FreespaceVoxel. Timestamps before the time base are clamped to
+  /// the time base.
+  /// @param voxel The voxel to pack.
+  /// @param time_base_ms The time base of the block containing this voxel.
+  __host__ __device__ void fromFreespaceVoxel(const FreespaceVoxel& voxel,
+                                              Time time_base_ms) {
+    last_occupied_offset_ms = clampTimeOffset(static_cast<int64_t>(
+        voxel.last_occupied_timestamp_ms - time_base_ms));
+    const int64_t duration_ms =
+        static_cast<int64_t>(voxel.consecutive_occupancy_duration_ms);
+    duration_ms_and_flags =
+        static_cast<uint32_t>(duration_ms < 0 ? 0
+                              : duration_ms > kMaxDurationMs ? kMaxDurationMs
+                                                             : duration_ms)
+        << kNumFlagBits;
+    if (!(voxel.last_occupied_timestamp_ms == Time(0))) {
+      duration_ms_and_flags |= kInitializedFlag;
+    }
+    if (voxel.is_high_confidence_freespace) {
+      duration_ms_and_flags |= kHighConfidenceFreespaceFlag;
+    }
+  }
+
+  /// Make the last occupied timestamp relative to a new time base. Timestamps
+  /// before the new time base are clamped to it.
+  /// @param old_time_base_ms The time base the voxel is currently relative to.
+  /// @param new_time_base_ms The new time base.
+  __host__ __device__ void rebase(Time old_time_base_ms,
+                                  Time new_time_base_ms) {
+    last_occupied_offset_ms = clampTimeOffset(
+        static_cast<int64_t>(old_time_base_ms - new_time_base_ms) +
+        static_cast<int64_t>(last_occupied_offset_ms));
+  }
+
+ private:
+  __host__ __device__ static uint32_t clampTimeOffset(int64_t offset_ms) {
+    return static_cast<uint32_t>(offset_ms < 0 ? 0
+                                 : offset_ms > kMaxTimeOffsetMs
+                                     ? kMaxTimeOffsetMs
+                                     : offset_ms);
+  }
+};
+
+static_assert(sizeof(CompactFreespaceVoxel) == 8,
+              "CompactFreespaceVoxel must be 8 bytes.");
+
 /// Voxels that stores the distance and full direction to the nearest surface.
 struct EsdfVoxel {
   EsdfVoxel()
@@ -85,4 +193,11 @@ struct OccupancyVoxel {
   float log_odds;
 };
 
+/// An OccupancyVoxel storing its log odds in 16 bit fixed point, halving the
+/// memory of occupancy layers. The members convert implicitly to float.
+struct QuantizedOccupancyVoxel {
+  QuantizedOccupancyVoxel() : log_odds(0.0f) {}
+  QuantizedLogOdds log_odds;
+};
+
 }  // namespace nvblox
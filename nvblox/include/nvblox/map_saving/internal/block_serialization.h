@@ -24,6 +24,10 @@ limitations under the License.
 namespace nvblox {
 
 // ------------------- Serialization ----------------------
+// Serialized voxel blocks hold the block header (if the voxel type has one,
+// see VoxelBlockHeader) followed by the voxels. The copies are queued on the
+// stream, so it has to be synchronized before the bytes are used.
+
 // Base template.
 template <typename BlockType>
 std::vector<Byte> serializeBlock(const unified_ptr<BlockType>& block,
@@ -35,14 +39,22 @@ std::vector<Byte> serializeBlock(
     const unified_ptr<const VoxelBlock<VoxelType>>& block,
     const CudaStream cuda_stream);
 
+// The number of bytes of a serialized voxel block.
+template <typename VoxelType>
+constexpr size_t serializedBlockSize();
+
 // ------------------- Deserialization ----------------------
+// Returns false (and leaves the block untouched) if the bytes don't hold a
+// block of this type. Blocks in device memory are written on the stream, so
+// the bytes have to outlive the copy. Host accessible blocks are written
+// synchronously.
 template <typename BlockType>
-void deserializeBlock(const std::vector<Byte>& bytes,
+bool deserializeBlock(const std::vector<Byte>& bytes,
                       unified_ptr<BlockType>& block,
                       const CudaStream cuda_stream);
 
 template <typename VoxelType>
-void deserializeBlock(const std::vector<Byte>& bytes,
+bool deserializeBlock(const std::vector<Byte>& bytes,
                       unified_ptr<VoxelBlock<VoxelType>>& block,
                       const CudaStream cuda_stream);
 
@@ -15,32 +15,83 @@ limitations under the License.
 */
 #pragma once
 
+#include <cstring>
+#include <type_traits>
+
+#include "nvblox/utils/logging.h"
+
 namespace nvblox {
+namespace internal {
+
+template <typename VoxelType>
+constexpr size_t serializedBlockHeaderSize() {
+  return std::is_empty_v<VoxelBlockHeader<VoxelType>>
+             ? 0
+             : sizeof(VoxelBlockHeader<VoxelType>);
+}
+
+}  // namespace internal
+
+template <typename VoxelType>
+constexpr size_t serializedBlockSize() {
+  return internal::serializedBlockHeaderSize<VoxelType>() +
+         sizeof(VoxelBlock<VoxelType>::voxels);
+}
 
 template <typename VoxelType>
 std::vector<Byte> serializeBlock(
     const unified_ptr<const VoxelBlock<VoxelType>>& block,
     const CudaStream cuda_stream) {
-  size_t block_size = sizeof(block->voxels);
-
+  constexpr size_t kHeaderSize =
+      internal::serializedBlockHeaderSize<VoxelType>();
   std::vector<Byte> bytes;
-  bytes.resize(block_size);
+  bytes.resize(serializedBlockSize<VoxelType>());
 
-  checkCudaErrors(cudaMemcpyAsync(bytes.data(), (block.get())->voxels,
-                                  block_size, cudaMemcpyDefault, cuda_stream));
+  if constexpr (kHeaderSize > 0) {
+    const VoxelBlockHeader<VoxelType>* header = block.get();
+    checkCudaErrors(cudaMemcpyAsync(bytes.data(), header, kHeaderSize,
+                                    cudaMemcpyDefault, cuda_stream));
+  }
+  checkCudaErrors(cudaMemcpyAsync(bytes.data() + kHeaderSize,
+                                  (block.get())->voxels,
+                                  sizeof(block->voxels), cudaMemcpyDefault,
+                                  cuda_stream));
 
   return bytes;
 }
 
 template <typename VoxelType>
-void deserializeBlock(const std::vector<Byte>& bytes,
+bool deserializeBlock(const std::vector<Byte>& bytes,
                       unified_ptr<VoxelBlock<VoxelType>>& block,
                       const CudaStream cuda_stream) {
-  CHECK_EQ(bytes.size(), sizeof(block->voxels));
+  constexpr size_t kHeaderSize =
+      internal::serializedBlockHeaderSize<VoxelType>();
+  if (bytes.size() != serializedBlockSize<VoxelType>()) {
+    LOG(ERROR) << "Serialized block has " << bytes.size()
+               << " bytes, expected " << serializedBlockSize<VoxelType>();
+    return false;
+  }
 
-  checkCudaErrors(cudaMemcpyAsync((block.get())->voxels, bytes.data(),
-                                  bytes.size(), cudaMemcpyDefault,
-                                  cuda_stream));
+  VoxelBlockHeader<VoxelType>* header = block.get();
+  if (block.memory_type() == MemoryType::kDevice) {
+    if constexpr (kHeaderSize > 0) {
+      checkCudaErrors(cudaMemcpyAsync(header, bytes.data(), kHeaderSize,
+                                      cudaMemcpyDefault, cuda_stream));
+    }
+    checkCudaErrors(cudaMemcpyAsync((block.get())->voxels,
+                                    bytes.data() + kHeaderSize,
+                                    sizeof(block->voxels), cudaMemcpyDefault,
+                                    cuda_stream));
+  } else {
+    // Host accessible blocks are written directly, which is thread safe for
+    // different blocks.
+    if constexpr (kHeaderSize > 0) {
+      std::memcpy(header, bytes.data(), kHeaderSize);
+    }
+    std::memcpy((block.get())->voxels, bytes.data() + kHeaderSize,
+                sizeof(block->voxels));
+  }
+  return true;
 }
 
 }  // namespace nvblox
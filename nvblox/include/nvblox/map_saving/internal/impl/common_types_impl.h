@@ -64,22 +64,40 @@ LayerSerializationFunctions bindDefaultFunctions() {
          BaseLayer* base_layer, const CudaStream cuda_stream) {
         LayerType* layer = dynamic_cast<LayerType*>(base_layer);
 
-        addDataToLayer(index, data, layer, cuda_stream);
+        return addDataToLayer(index, data, layer, cuda_stream);
       };
   layer_functions.add_data = lambda_add_data;
 
+  LayerSerializationFunctions::AddDataBatchToLayerFunction
+      lambda_add_data_batch = [](const std::vector<Index3D>& indices,
+                                 const std::vector<std::vector<Byte>>& data,
+                                 int num_threads, BaseLayer* base_layer,
+                                 const CudaStream cuda_stream) {
+        LayerType* layer = dynamic_cast<LayerType*>(base_layer);
+
+        return addDataBatchToLayer(indices, data, num_threads, layer,
+                                   cuda_stream);
+      };
+  layer_functions.add_data_batch = lambda_add_data_batch;
+
   return layer_functions;
 }
 
 void registerCommonTypes() {
   LayerTypeRegister::registerType("tsdf_layer", typeid(TsdfLayer),
                                   bindDefaultFunctions<TsdfLayer>());
+  LayerTypeRegister::registerType("compact_tsdf_layer",
+                                  typeid(CompactTsdfLayer),
+                                  bindDefaultFunctions<CompactTsdfLayer>());
   LayerTypeRegister::registerType("esdf_layer", typeid(EsdfLayer),
                                   bindDefaultFunctions<EsdfLayer>());
   LayerTypeRegister::registerType("color_layer", typeid(ColorLayer),
                                   bindDefaultFunctions<ColorLayer>());
   LayerTypeRegister::registerType("occupancy_layer", typeid(OccupancyLayer),
                                   bindDefaultFunctions<OccupancyLayer>());
+  LayerTypeRegister::registerType(
+      "quantized_occupancy_layer", typeid(QuantizedOccupancyLayer),
+      bindDefaultFunctions<QuantizedOccupancyLayer>());
 }
 
 }  // namespace nvblox
@@ -15,6 +15,11 @@ limitations under the License.
 */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+
+#include "nvblox/utils/thread_pool.h"
+
 namespace nvblox {
 
 template <typename VoxelType>
@@ -65,14 +70,70 @@ std::unique_ptr<VoxelBlockLayer<VoxelType>> deserializeLayerParameters(
 }
 
 template <typename VoxelType>
-void addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
+bool addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
                     VoxelBlockLayer<VoxelType>* layer,
                     const CudaStream cuda_stream) {
   // Create a block at the relevant index.
   auto block = layer->allocateBlockAtIndexAsync(index, cuda_stream);
 
   // Populate it using block serialialization.
-  deserializeBlock(data, block, cuda_stream);
+  if (!deserializeBlock(data, block, cuda_stream)) {
+    layer->clearBlock(index);
+    return false;
+  }
+  return true;
+}
+
+template <typename VoxelType>
+bool addDataBatchToLayer(const std::vector<Index3D>& indices,
+                         const std::vector<std::vector<Byte>>& data,
+                         int num_threads, VoxelBlockLayer<VoxelType>* layer,
+                         const CudaStream cuda_stream) {
+  CHECK_EQ(indices.size(), data.size());
+  using BlockType = VoxelBlock<VoxelType>;
+
+  // Reject the batch before modifying the layer.
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (data[i].size() != serializedBlockSize<VoxelType>()) {
+      LOG(ERROR) << "Block " << indices[i].transpose() << " has "
+                 << data[i].size() << " bytes, expected "
+                 << serializedBlockSize<VoxelType>();
+      return false;
+    }
+  }
+
+  // Allocate all blocks of the batch at once.
+  layer->allocateBlocksAtIndices(indices, cuda_stream);
+  std::vector<typename BlockType::Ptr> blocks;
+  blocks.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    blocks.push_back(layer->getBlockAtIndex(indices[i]));
+  }
+
+  // Device blocks can't be written from the host. The copies are queued
+  // instead.
+  if (layer->memory_type() == MemoryType::kDevice) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      deserializeBlock(data[i], blocks[i], cuda_stream);
+    }
+    // The data has to outlive the copies.
+    cuda_stream.synchronize();
+    return true;
+  }
+
+  // Host accessible blocks are filled in parallel. Blocks are handed out to
+  // the worker threads dynamically.
+  std::atomic<size_t> next_block{0};
+  auto worker = [&]() {
+    for (size_t i = next_block++; i < blocks.size(); i = next_block++) {
+      deserializeBlock(data[i], blocks[i], cuda_stream);
+    }
+  };
+  // The calling thread does its share of the work.
+  ThreadPool& thread_pool = *ThreadPool::getDefault();
+  thread_pool.runWorkers(thread_pool.numWorkers(num_threads, blocks.size()),
+                         worker);
+  return true;
 }
 
 }  // namespace nvblox
@@ -71,7 +71,7 @@ struct GetLayerType<VoxelBlockLayer<VoxelType>> {
 // present here.
 
 template <typename LayerType>
-void addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
+bool addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
                     LayerType* layer);
 
 // Block specializations
@@ -79,9 +79,23 @@ template <typename VoxelType>
 std::unique_ptr<VoxelBlockLayer<VoxelType>> deserializeLayerParameters(
     MemoryType memory_type, const LayerParameterStruct& params);
 
+/// Add a block to a layer.
+/// @return False if the data is not a serialized block of this layer type.
 template <typename VoxelType>
-void addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
-                    VoxelBlockLayer<VoxelType>* layer);
+bool addDataToLayer(const Index3D& index, const std::vector<Byte>& data,
+                    VoxelBlockLayer<VoxelType>* layer,
+                    const CudaStream cuda_stream);
+
+/// Add a batch of blocks to a layer. The blocks are allocated in bulk and
+/// (for layers in host or unified memory) filled on up to num_threads threads
+/// of the default ThreadPool. 0 threads uses the whole pool.
+/// @return False, without adding any blocks, if any of the data is not a
+/// serialized block of this layer type.
+template <typename VoxelType>
+bool addDataBatchToLayer(const std::vector<Index3D>& indices,
+                         const std::vector<std::vector<Byte>>& data,
+                         int num_threads, VoxelBlockLayer<VoxelType>* layer,
+                         const CudaStream cuda_stream);
 
 }  // namespace nvblox
 
@@ -49,9 +49,13 @@ struct LayerSerializationFunctions {
   typedef std::function<std::unique_ptr<BaseLayer>(MemoryType,
                                                    const LayerParameterStruct&)>
       ConstructLayerFunction;
-  typedef std::function<void(const Index3D&, const std::vector<Byte>&,
+  typedef std::function<bool(const Index3D&, const std::vector<Byte>&,
                              BaseLayer*, const CudaStream cuda_stream)>
       AddDataToLayerFunction;
+  typedef std::function<bool(const std::vector<Index3D>&,
+                             const std::vector<std::vector<Byte>>&, int,
+                             BaseLayer*, const CudaStream cuda_stream)>
+      AddDataBatchToLayerFunction;
 
   // The 5 functions that have to be defined to serialize and deserialize a
   // layer type.
@@ -61,6 +65,10 @@ struct LayerSerializationFunctions {
 
   ConstructLayerFunction construct_layer;
   AddDataToLayerFunction add_data;
+
+  // Optional. Adds many blocks at once, deserializing them on the passed
+  // number of threads. Used for loading instead of add_data if set.
+  AddDataBatchToLayerFunction add_data_batch;
 };
 
 /// A class that allows registering a layer type to be used for serialization.
@@ -28,6 +28,8 @@ namespace nvblox {
 /// Class to serialize and read a layer cake from an SQLite database.
 class Serializer {
  public:
+  static constexpr int kDefaultLoadBatchSize = 1024;
+
   /// Default constructor for invalid file. Must call open before using.
   Serializer();
   virtual ~Serializer() = default;
@@ -45,6 +47,10 @@ class Serializer {
             std::ios_base::openmode openmode = std::ios::in);
 
   /// Load a layer cake from the opened file of a given memory type.
+  /// Blocks are read in batches of load_batch_size(), allocated in bulk and
+  /// deserialized on num_load_threads() threads.
+  /// @return The layer cake. Empty if reading or deserializing any layer
+  /// failed.
   LayerCake loadLayerCake(MemoryType memory_type, const CudaStream cuda_stream);
 
   /// Write out a layer cake to the opened file, return success.
@@ -53,6 +59,16 @@ class Serializer {
   /// Close the file.
   bool close();
 
+  /// The number of blocks read from the database and added to a layer at a
+  /// time while loading.
+  int load_batch_size() const { return load_batch_size_; }
+  void load_batch_size(int load_batch_size);
+
+  /// The number of threads deserializing blocks while loading. 0 uses one
+  /// thread per core.
+  int num_load_threads() const { return num_load_threads_; }
+  void num_load_threads(int num_load_threads);
+
   // ======= Below use only if you know WTF you're doing! =====================
 
   /// Create a layer table & metadata table.
@@ -104,6 +120,10 @@ class Serializer {
   bool getLayerNames(std::vector<std::string>* layer_names);
   bool getDataIndices(const std::string& layer_name,
                       std::vector<Index3D>* indices);
+  // Stream all blocks of a layer in batches.
+  bool getDataInBatches(
+      const std::string& layer_name, size_t batch_size,
+      const SqliteDatabase::Index3DBlobBatchCallback& callback);
 
   // Get the name of the data layer table.
   std::string layerDataTableName(const std::string& layer_name) const;
@@ -111,6 +131,10 @@ class Serializer {
   std::string layerMetadataTableName(const std::string& layer_name) const;
 
   SqliteDatabase sqlite_;
+
+  // Params
+  int load_batch_size_ = kDefaultLoadBatchSize;
+  int num_load_threads_ = 0;
 };
 
 }  // namespace nvblox
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "nvblox/core/types.h"
@@ -62,6 +63,17 @@ class SqliteDatabase {
   bool runMultipleQueryIndex3D(const std::string& sql_query,
                                std::vector<Index3D>* result);
 
+  /// Callback receiving a batch of (index, blob) rows.
+  typedef std::function<void(const std::vector<Index3D>&,
+                             const std::vector<std::vector<Byte>>&)>
+      Index3DBlobBatchCallback;
+  /// Stream the rows of a query returning (index_x, index_y, index_z, blob)
+  /// in batches of up to batch_size rows. The query is run once, and the
+  /// buffers passed to the callback are reused between batches.
+  bool runBatchedQueryIndex3DBlob(const std::string& sql_query,
+                                  size_t batch_size,
+                                  const Index3DBlobBatchCallback& callback);
+
  private:
   sqlite3* db_ = nullptr;
 };
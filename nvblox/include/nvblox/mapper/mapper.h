@@ -15,10 +15,13 @@ limitations under the License.
 */
 #pragma once
 
+#include <memory>
 #include <optional>
+#include <string>
 #include <unordered_set>
 
 #include "nvblox/core/hash.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/dynamics/dynamics_detection.h"
 #include "nvblox/integrators/esdf_integrator.h"
@@ -28,6 +31,9 @@ limitations under the License.
 #include "nvblox/integrators/projective_occupancy_integrator.h"
 #include "nvblox/integrators/projective_tsdf_integrator.h"
 #include "nvblox/integrators/tsdf_decay_integrator.h"
+#include "nvblox/io/async_output_writer.h"
+#include "nvblox/map/block_distance_summary.h"
+#include "nvblox/map/block_pager.h"
 #include "nvblox/map/blocks_to_update_tracker.h"
 #include "nvblox/map/blox.h"
 #include "nvblox/map/common_names.h"
@@ -41,6 +47,7 @@ limitations under the License.
 #include "nvblox/sensors/camera.h"
 #include "nvblox/sensors/depth_preprocessing.h"
 #include "nvblox/sensors/lidar.h"
+#include "nvblox/utils/thread_pool.h"
 
 namespace nvblox {
 
@@ -159,10 +166,12 @@ class Mapper : public MapperBase {
   void integrateLidarDepth(const DepthImage& depth_frame,
                            const Transform& T_L_C, const Lidar& lidar);
 
-  /// Decay the TSDF layer (reduce weights)
+  /// Decay the TSDF layer (reduce weights). Decays the compact TSDF layer if
+  /// the projective layer type is kCompactTsdf.
   void decayTsdf();
 
-  /// Decay the full occupancy layer.
+  /// Decay the full occupancy layer. Decays the quantized occupancy layer if
+  /// the projective layer type is kQuantizedOccupancy.
   void decayOccupancy();
 
   /// Updates the freespace blocks.
@@ -188,6 +197,15 @@ class Mapper : public MapperBase {
       const std::optional<Transform>& maybe_T_L_C = std::nullopt,
       bool serialize_full_mesh = false);
 
+  /// Updates the TSDF distance summaries with the TSDF blocks changed since
+  /// the last call (by integration, decay, paging...). Does nothing unless
+  /// update_tsdf_distance_summaries() is set. Has to be called before reading
+  /// tsdf_distance_summaries(), which no other call refreshes.
+  /// @param update_full_layer Whether to recompute the summaries of all
+  /// blocks or only of the changed ones.
+  void updateTsdfDistanceSummaries(
+      UpdateFullLayer update_full_layer = UpdateFullLayer::kNo);
+
   /// Updates the ESDF blocks.
   /// Note that currently we limit the Mapper class to calculating *either*
   /// the 2D or 3D ESDF, not both. Which is to be calculated is determined by
@@ -226,6 +244,61 @@ class Mapper : public MapperBase {
   /// @param radius The radius of allocation-sphere
   void markUnobservedTsdfFreeInsideRadius(const Vector3f& center, float radius);
 
+  /// Enables out-of-core paging of blocks. Evicted blocks of the projective
+  /// (TSDF or occupancy), color and freespace layers are written to a block
+  /// store on disk instead of being discarded as in clearOutsideRadius(). The
+  /// ESDF and mesh are cleared for evicted blocks and regenerated once the
+  /// blocks are paged back in. Evicted blocks within range of a frame are paged
+  /// in before the frame is integrated. Calling this again pages in the blocks
+  /// of the previous block store. Not supported for the compact TSDF,
+  /// quantized occupancy and compact freespace layers.
+  /// @param block_store_directory The directory in which evicted blocks are
+  /// stored. Created if it doesn't exist.
+  void enableBlockPaging(const std::string& block_store_directory);
+
+  /// Whether block paging is enabled. See enableBlockPaging().
+  bool block_paging_enabled() const { return !block_store_directory_.empty(); }
+
+  /// Evicts the blocks outside a working radius to the block store. Requires
+  /// block paging to be enabled.
+  ///@param center The center of the working sphere.
+  ///@param radius The radius of the working sphere.
+  ///@return The evicted blocks.
+  std::vector<Index3D> evictOutsideRadius(const Vector3f& center,
+                                          float radius);
+
+  /// Evicts the blocks which were least recently integrated into, such that
+  /// at most max_num_resident_blocks blocks remain in the projective layer.
+  /// Requires block paging to be enabled.
+  ///@param max_num_resident_blocks The number of blocks to keep.
+  ///@return The evicted blocks.
+  std::vector<Index3D> evictLeastRecentlyUsed(size_t max_num_resident_blocks);
+
+  /// Starts reading the evicted blocks within a radius from the block store
+  /// in the background. Call pageInPrefetchedBlocks() to install them in the
+  /// map. Requires block paging to be enabled.
+  ///@param center The center of the prefetch sphere.
+  ///@param radius The radius of the prefetch sphere.
+  void prefetchInsideRadiusAsync(const Vector3f& center, float radius);
+
+  /// Installs the blocks read by prefetchInsideRadiusAsync() in the map and
+  /// marks them for updating the ESDF and mesh. Requires block paging to be
+  /// enabled.
+  ///@return The blocks paged into the projective layer.
+  std::vector<Index3D> pageInPrefetchedBlocks();
+
+  /// Synchronously pages in the evicted blocks within a radius and marks them
+  /// for updating the ESDF and mesh. Requires block paging to be enabled.
+  ///@param center The center of the page-in sphere.
+  ///@param radius The radius of the page-in sphere.
+  ///@return The blocks paged into the projective layer.
+  std::vector<Index3D> pageInInsideRadius(const Vector3f& center,
+                                          float radius);
+
+  /// The number of blocks of the projective layer currently in the block
+  /// store. Zero if block paging is disabled.
+  size_t num_evicted_blocks() const;
+
   /// Gets the preprocessed version of the last depth image passed to
   /// integrateDepth(). Note that we return a shared_ptr to a buffered depth
   /// image inside the mapper to avoid copying the image. Subsequent calls to
@@ -247,11 +320,29 @@ class Mapper : public MapperBase {
     return layers_.get<OccupancyLayer>();
   }
   /// Getter
+  ///@return const CompactTsdfLayer& compact (half precision) TSDF layer
+  /// Only exists if selected by the projective layer type.
+  const CompactTsdfLayer& compact_tsdf_layer() const {
+    return layers_.get<CompactTsdfLayer>();
+  }
+  /// Getter
+  ///@return const QuantizedOccupancyLayer& quantized (fixed point) occupancy
+  /// layer. Only exists if selected by the projective layer type.
+  const QuantizedOccupancyLayer& quantized_occupancy_layer() const {
+    return layers_.get<QuantizedOccupancyLayer>();
+  }
+  /// Getter
   ///@return const FreespaceLayer& freespace layer
   const FreespaceLayer& freespace_layer() const {
     return layers_.get<FreespaceLayer>();
   }
   /// Getter
+  ///@return const CompactFreespaceLayer& compact freespace layer
+  /// Only exists if selected by the projective layer type.
+  const CompactFreespaceLayer& compact_freespace_layer() const {
+    return layers_.get<CompactFreespaceLayer>();
+  }
+  /// Getter
   ///@return const ColorLayer& Color layer
   const ColorLayer& color_layer() const { return layers_.get<ColorLayer>(); }
   /// Getter
@@ -273,11 +364,29 @@ class Mapper : public MapperBase {
     return *layers_.getPtr<OccupancyLayer>();
   }
   /// Getter
+  ///@return CompactTsdfLayer& compact (half precision) TSDF layer
+  /// Only exists if selected by the projective layer type.
+  CompactTsdfLayer& compact_tsdf_layer() {
+    return *layers_.getPtr<CompactTsdfLayer>();
+  }
+  /// Getter
+  ///@return QuantizedOccupancyLayer& quantized (fixed point) occupancy layer
+  /// Only exists if selected by the projective layer type.
+  QuantizedOccupancyLayer& quantized_occupancy_layer() {
+    return *layers_.getPtr<QuantizedOccupancyLayer>();
+  }
+  /// Getter
   ///@return FreespaceLayer& freespace layer
   FreespaceLayer& freespace_layer() {
     return *layers_.getPtr<FreespaceLayer>();
   }
   /// Getter
+  ///@return CompactFreespaceLayer& compact freespace layer
+  /// Only exists if selected by the projective layer type.
+  CompactFreespaceLayer& compact_freespace_layer() {
+    return *layers_.getPtr<CompactFreespaceLayer>();
+  }
+  /// Getter
   ///@return ColorLayer& Color layer
   ColorLayer& color_layer() { return *layers_.getPtr<ColorLayer>(); }
   /// Getter
@@ -287,6 +396,36 @@ class Mapper : public MapperBase {
   ///@return MeshLayer& Mesh layer
   MeshLayer& mesh_layer() { return *layers_.getPtr<MeshLayer>(); }
 
+  /// Copy-on-write snapshots of the layers, for reading a frozen map on other
+  /// threads while mapping continues. See VoxelBlockLayer::createSnapshot().
+  /// Must be called from the thread updating the mapper.
+  ///@return std::shared_ptr<const TsdfLayer> Snapshot of the TSDF layer
+  std::shared_ptr<const TsdfLayer> createTsdfLayerSnapshot() {
+    return tsdf_layer().createSnapshot();
+  }
+  /// See createTsdfLayerSnapshot()
+  ///@return std::shared_ptr<const OccupancyLayer> Snapshot of the occupancy
+  /// layer
+  std::shared_ptr<const OccupancyLayer> createOccupancyLayerSnapshot() {
+    return occupancy_layer().createSnapshot();
+  }
+  /// See createTsdfLayerSnapshot()
+  ///@return std::shared_ptr<const FreespaceLayer> Snapshot of the freespace
+  /// layer
+  std::shared_ptr<const FreespaceLayer> createFreespaceLayerSnapshot() {
+    return freespace_layer().createSnapshot();
+  }
+  /// See createTsdfLayerSnapshot()
+  ///@return std::shared_ptr<const ColorLayer> Snapshot of the color layer
+  std::shared_ptr<const ColorLayer> createColorLayerSnapshot() {
+    return color_layer().createSnapshot();
+  }
+  /// See createTsdfLayerSnapshot()
+  ///@return std::shared_ptr<const EsdfLayer> Snapshot of the ESDF layer
+  std::shared_ptr<const EsdfLayer> createEsdfLayerSnapshot() {
+    return esdf_layer().createSnapshot();
+  }
+
   /// Getter
   ///@return const ProjectiveTsdfIntegrator& TSDF integrator used for
   ///        depth/rgbd frame integration.
@@ -399,6 +538,27 @@ class Mapper : public MapperBase {
   ///@return MeshStreamerOldestBlocks& Mesh streamer.
   MeshStreamerOldestBlocks& mesh_streamer() { return mesh_streamer_; }
   /// Getter
+  ///@return const BlockDistanceSummaryPyramid& Block-level summaries of the
+  ///        ESDF layer, used for fast collision checks. Only maintained if
+  ///        update_esdf_distance_summaries() is set.
+  const BlockDistanceSummaryPyramid& esdf_distance_summaries() const {
+    return esdf_distance_summaries_;
+  }
+  /// Getter
+  ///@return const BlockDistanceSummaryPyramid& Block-level summaries of the
+  ///        TSDF layer. Only maintained if update_tsdf_distance_summaries() is
+  ///        set.
+  /// The summaries are not refreshed by integration, decay or clearing. They
+  /// describe the TSDF as of the last call to updateTsdfDistanceSummaries(),
+  /// so call it before reading them.
+  /// Unlike the ESDF, the TSDF stores truncated projective distances, measured
+  /// along the camera rays. These overestimate the distance to the nearest
+  /// surface, so the summarized bounds are not conservative. Use the ESDF
+  /// summaries for collision checks.
+  const BlockDistanceSummaryPyramid& tsdf_distance_summaries() const {
+    return tsdf_distance_summaries_;
+  }
+  /// Getter
   /// @return The voxel size in meters
   float voxel_size_m() const { return voxel_size_m_; };
   /// Getter
@@ -475,6 +635,59 @@ class Mapper : public MapperBase {
     esdf_slice_height_ = esdf_slice_height;
   }
 
+  /// A parameter getter
+  /// Whether to maintain block-level summaries of the ESDF layer. If set, the
+  /// summaries are updated on each call to updateEsdf() or updateEsdfSlice().
+  /// See esdf_distance_summaries().
+  /// @returns update_esdf_distance_summaries
+  bool update_esdf_distance_summaries() const {
+    return update_esdf_distance_summaries_;
+  }
+  /// A parameter setter
+  /// See update_esdf_distance_summaries().
+  /// @param update_esdf_distance_summaries
+  void update_esdf_distance_summaries(bool update_esdf_distance_summaries);
+
+  /// A parameter getter
+  /// Whether to maintain block-level summaries of the TSDF layer. If set, the
+  /// blocks changed by integration and decay are tracked and summarized on the
+  /// next call to updateTsdfDistanceSummaries(). Only for TSDF layers.
+  /// @returns update_tsdf_distance_summaries
+  bool update_tsdf_distance_summaries() const {
+    return update_tsdf_distance_summaries_;
+  }
+  /// A parameter setter
+  /// See update_tsdf_distance_summaries().
+  /// @param update_tsdf_distance_summaries
+  void update_tsdf_distance_summaries(bool update_tsdf_distance_summaries);
+
+  /// A parameter getter
+  /// The number of threads of the pool running the CPU work of the mapper. 0
+  /// means the mapper uses the process-wide ThreadPool::getDefault().
+  /// @returns num_cpu_threads
+  int num_cpu_threads() const { return num_cpu_threads_; }
+  /// A parameter setter
+  /// See num_cpu_threads(). Replaces the pool if the number changes.
+  /// @param num_cpu_threads
+  void num_cpu_threads(int num_cpu_threads);
+
+  /// A parameter getter
+  /// Whether the threads of the mapper's own pool are pinned to cores.
+  /// @returns pin_cpu_threads_to_cores
+  bool pin_cpu_threads_to_cores() const { return pin_cpu_threads_to_cores_; }
+  /// A parameter setter
+  /// See pin_cpu_threads_to_cores(). Replaces the pool if the setting changes.
+  /// @param pin_cpu_threads_to_cores
+  void pin_cpu_threads_to_cores(bool pin_cpu_threads_to_cores);
+
+  /// The pool running the CPU work of the mapper (CPU meshing and coloring,
+  /// block update bookkeeping).
+  /// @returns the thread pool
+  std::shared_ptr<ThreadPool> thread_pool() const { return thread_pool_; }
+  /// Use a pool shared with other components, e.g. another mapper.
+  /// @param thread_pool The pool.
+  void thread_pool(std::shared_ptr<ThreadPool> thread_pool);
+
   /// A parameter getter
   /// Whether to exclude voxel contained observed in the the last depth frame
   /// passed to integrateDepth from the voxels which are decayed.
@@ -488,6 +701,19 @@ class Mapper : public MapperBase {
     exclude_last_view_from_decay_ = exclude_last_view_from_decay;
   }
 
+  /// A parameter getter
+  /// Whether decay is epoch-based (lazy). In this mode decayTsdf() and
+  /// decayOccupancy() only process the blocks in which voxels become fully
+  /// decayed, and only those blocks are marked for ESDF/mesh updates. Blocks
+  /// are brought up to date before integration writes to them. If the last
+  /// view is excluded from decay, the blocks updated by the last integration
+  /// are excluded.
+  bool epoch_based_decay() const { return epoch_based_decay_; }
+  /// A parameter setter
+  /// See epoch_based_decay()
+  /// @param epoch_based_decay
+  void epoch_based_decay(const bool epoch_based_decay);
+
   /// Saving and loading functions.
   /// Saving a map will serialize the TSDF and ESDF layers to a file.
   ///@param filename
@@ -525,6 +751,29 @@ class Mapper : public MapperBase {
   /// @return bool Flag indicating if the write was successful.
   bool saveOccupancyAsPly(const std::string& filename) const;
 
+  /// Queue the mesh on a background writer, see saveMeshAsPly(). The mesh is
+  /// copied before returning, such that mapping may continue right away.
+  /// @param filename Path to the output PLY file.
+  /// @param output_writer The writer to queue the output on.
+  /// @return bool Flag indicating if the output was queued (not dropped).
+  bool saveMeshAsPlyAsync(const std::string& filename,
+                          AsyncOutputWriter* output_writer);
+
+  /// Queue a layer on a background writer, see save*AsPly(). Writes a
+  /// snapshot of the layer (see createTsdfLayerSnapshot()), such that mapping
+  /// may continue right away. Must be called from the mapping thread.
+  /// @param filename Path to the output PLY file.
+  /// @param output_writer The writer to queue the output on.
+  /// @return bool Flag indicating if the output was queued (not dropped).
+  bool saveEsdfAsPlyAsync(const std::string& filename,
+                          AsyncOutputWriter* output_writer);
+  bool saveTsdfAsPlyAsync(const std::string& filename,
+                          AsyncOutputWriter* output_writer);
+  bool saveFreespaceAsPlyAsync(const std::string& filename,
+                               AsyncOutputWriter* output_writer);
+  bool saveOccupancyAsPlyAsync(const std::string& filename,
+                               AsyncOutputWriter* output_writer);
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
@@ -534,6 +783,28 @@ class Mapper : public MapperBase {
   /// @return the parameter tree string
   virtual std::string getParametersAsString() const;
 
+  /// A breakdown of the memory held by the mapper: the blocks, memory pools
+  /// and hashes of its layers, the scratch buffers of its integrators and its
+  /// depth images. Items are named like "tsdf_layer/blocks". Layers that the
+  /// mapper doesn't hold, e.g. ones missing from a loaded map, are left out.
+  /// @return The memory report.
+  MemoryReport getMemoryReport() const;
+
+  /// The total memory held by the mapper, ie. the total of getMemoryReport(),
+  /// computed without building the report.
+  /// @return The memory usage.
+  MemoryUsage getMemoryUsage() const;
+
+  /// The total memory held by the mapper (see getMemoryReport()) and its
+  /// maximum over the calls to this function since construction or the last
+  /// call to resetMemoryHighWatermark(). Does not synchronize with the GPU,
+  /// so it can be called every frame to track the high watermark.
+  /// @return The current usage and the high watermark.
+  MemorySnapshot getMemorySnapshot();
+
+  /// Restart tracking of the high watermark from the current memory usage.
+  void resetMemoryHighWatermark();
+
   /// @brief Get the mesh blocks that have been cleared in the mesh layer since
   /// the last call of the function. This information is needed to remove them
   /// from the visualizer.
@@ -544,6 +815,10 @@ class Mapper : public MapperBase {
       const std::vector<Index3D>& blocks_to_ignore);
 
  protected:
+  /// Runs the update stages of the mapper concurrently and needs access to its
+  /// integrators and block tracking.
+  friend class MapperUpdateScheduler;
+
   /// Perform preprocessing on a depth image
   const DepthImage& preprocessDepthImageAsync(const DepthImage& depth_image);
 
@@ -562,9 +837,67 @@ class Mapper : public MapperBase {
       BlocksToUpdateType blocks_to_update_type,
       UpdateFullLayer update_full_layer) const;
 
+  /// Bring the ESDF distance summaries up to date with the last ESDF update.
+  void updateEsdfDistanceSummaries();
+
+  /// Use the default pool or create a pool matching num_cpu_threads_ and
+  /// pin_cpu_threads_to_cores_, and hand it to the CPU components.
+  void updateThreadPool();
+
   /// @brief Deallocate blocks int the esdf, mesh and freespace layer.
   /// @param blocks_to_clear Vector of blocks to clear.
   void clearBlocksInLayers(const std::vector<Index3D>& blocks_to_clear);
+  /// Deallocate blocks in the derived (freespace, ESDF and mesh) layers.
+  void clearBlocksInDerivedLayers(const std::vector<Index3D>& blocks_to_clear);
+
+  /// Stage the writes to the derived layers (ie. clearing deallocated blocks
+  /// and paging in freespace blocks) instead of applying them, such that
+  /// integration doesn't touch the derived layers. Used by the
+  /// MapperUpdateScheduler while the derived layers are updated concurrently.
+  void deferDerivedLayerWrites(bool defer);
+  /// Apply the staged derived-layer writes in the order they were made.
+  void applyStagedDerivedLayerWrites();
+
+  /// (Re-)create the block pagers for the current layers.
+  void createBlockPagers();
+  /// Pass the integrator max weights and the thread pool to the block pagers.
+  void updateBlockPagerSettings();
+
+  /// Synchronously page in evicted blocks (ie. the blocks about to be
+  /// integrated) in all paged layers.
+  void pageInBlocks(const std::vector<Index3D>& block_indices);
+
+  /// Page in all evicted blocks in all paged layers.
+  void pageInAllEvictedBlocks();
+
+  /// Forget the evicted blocks of all pagers and remove them from the block
+  /// store.
+  void discardEvictedBlocks();
+  /// Evict the blocks evicted from the projective layer from the other layers.
+  void evictBlocksInLayers(const std::vector<Index3D>& evicted_blocks);
+  /// Page in blocks paged into the projective layer into the other layers.
+  void pageInBlocksInLayers(const std::vector<Index3D>& paged_in_blocks);
+  /// Mark blocks as recently used for least-recently-used eviction.
+  void touchPagedBlocks(const std::vector<Index3D>& updated_blocks);
+
+  /// Epoch-based decay: Bring blocks about to be integrated into up to date
+  /// with the current decay epoch.
+  void applyPendingDecay(const std::vector<Index3D>& blocks_to_integrate);
+  /// Epoch-based decay: The allocated blocks of the projective layer within a
+  /// radius. Only checks the blocks near the sensor, not the whole map.
+  std::vector<Index3D> getAllocatedProjectiveBlocksWithinRadius(
+      const Vector3f& center, float radius) const;
+  /// Epoch-based decay: Report the blocks written by an integration.
+  void markBlocksIntegrated(const std::vector<Index3D>& updated_blocks);
+  /// Epoch-based decay: The blocks excluded from the next decay epoch.
+  std::optional<DecayBlockExclusionOptions> getEpochDecayExclusionOptions()
+      const;
+
+  /// Calls add_layer(prefix, layer) for each layer and add_item(name, usage,
+  /// count) for the remaining items of getMemoryReport().
+  template <typename AddLayerFunctionType, typename AddItemFunctionType>
+  void visitMemoryItems(AddLayerFunctionType&& add_layer,
+                        AddItemFunctionType&& add_item) const;
 
   /// The CUDA stream that mapper work is processed on
   std::shared_ptr<CudaStream> cuda_stream_;
@@ -615,9 +948,39 @@ class Mapper : public MapperBase {
   /// to updateMesh(), updateFreespace() upd updateEsdf() respectively.
   BlocksToUpdateTracker blocks_to_update_tracker_;
 
+  /// The pool running the CPU work of the mapper. Either the default pool or
+  /// a pool of num_cpu_threads_ threads.
+  int num_cpu_threads_ = kNumCpuThreadsParamDesc.default_value;
+  bool pin_cpu_threads_to_cores_ =
+      kPinCpuThreadsToCoresParamDesc.default_value;
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::getDefault();
+
   /// Keeping track of the mesh blocks that got deleted in the mesh layer.
   Index3DSet cleared_mesh_blocks_;
 
+  /// Block-level summaries of the ESDF layer for fast collision checks.
+  BlockDistanceSummaryPyramid esdf_distance_summaries_;
+  bool update_esdf_distance_summaries_ =
+      kUpdateEsdfDistanceSummariesParamDesc.default_value;
+  /// Set when the summaries have to be recomputed for the whole ESDF layer
+  /// (ie. after enabling them or loading a map).
+  bool esdf_distance_summaries_need_rebuild_ = true;
+
+  /// Block-level summaries of the TSDF layer. Updated on request from the
+  /// blocks recorded by the blocks_to_update_tracker_.
+  BlockDistanceSummaryPyramid tsdf_distance_summaries_;
+  bool update_tsdf_distance_summaries_ =
+      kUpdateTsdfDistanceSummariesParamDesc.default_value;
+  bool tsdf_distance_summaries_need_rebuild_ = true;
+
+  /// Out-of-core block paging. Pagers exist only if paging is enabled and the
+  /// corresponding layer is in use.
+  std::string block_store_directory_;
+  std::unique_ptr<TsdfBlockPager> tsdf_block_pager_;
+  std::unique_ptr<OccupancyBlockPager> occupancy_block_pager_;
+  std::unique_ptr<ColorBlockPager> color_block_pager_;
+  std::unique_ptr<FreespaceBlockPager> freespace_block_pager_;
+
   /// This object handles the bandwidth limiting of the mesh streamer.
   MeshStreamerOldestBlocks mesh_streamer_;
   float mesh_bandwidth_limit_mbps_ =
@@ -630,6 +993,24 @@ class Mapper : public MapperBase {
   std::optional<DepthImage> last_depth_image_;
   std::optional<Camera> last_depth_camera_;
   std::optional<Transform> last_depth_T_L_C_;
+
+  /// Whether decay is epoch-based (lazy)
+  bool epoch_based_decay_ = kEpochBasedDecayParamDesc.default_value;
+  /// The blocks updated by the last integration, for block-based decay
+  /// exclusion in epoch-based decay.
+  std::vector<Index3D> last_integrated_blocks_;
+
+  /// Derived-layer writes staged while deferDerivedLayerWrites() is on.
+  struct DerivedLayerWrite {
+    enum class Type { kClearBlocks, kPageInFreespaceBlocks };
+    Type type;
+    std::vector<Index3D> block_indices;
+  };
+  bool defer_derived_layer_writes_ = false;
+  std::vector<DerivedLayerWrite> staged_derived_layer_writes_;
+
+  /// The maximum memory usage seen by getMemorySnapshot().
+  MemoryUsage memory_high_watermark_;
 };
 
 }  // namespace nvblox
@@ -64,6 +64,13 @@ constexpr Param<bool>::Description kExcludeLastViewFromDecayParamDesc{
     "Whether contributions from the last depth frame should be excluded when "
     "decaying"};
 
+constexpr Param<bool>::Description kEpochBasedDecayParamDesc{
+    "epoch_based_decay", false,
+    "Whether decay is applied lazily. Each decay call only touches the blocks "
+    "in which voxels become fully decayed, and blocks are brought up to date "
+    "before they are integrated into. With this option the last view is "
+    "excluded from decay at block (rather than voxel) granularity."};
+
 // ======= MESH STREAMER =======
 constexpr Param<float>::Description kMeshBandwidthLimitMbpsParamDesc{
     "mesh_bandwidth_limit_mbps", 25.f,
@@ -80,6 +87,30 @@ constexpr Param<float>::Description kMeshStreamerExclusionRadiusMParamDesc{
     "Mesh blocks outside this radius (centered on the robot) will not be "
     "streamed."};
 
+// ======= BLOCK DISTANCE SUMMARIES =======
+constexpr Param<bool>::Description kUpdateEsdfDistanceSummariesParamDesc{
+    "update_esdf_distance_summaries", false,
+    "Whether to maintain block-level summaries of the ESDF, which allow for "
+    "fast collision checks against the map."};
+
+constexpr Param<bool>::Description kUpdateTsdfDistanceSummariesParamDesc{
+    "update_tsdf_distance_summaries", false,
+    "Whether to maintain block-level summaries of the TSDF. The blocks touched "
+    "by integration and decay are summarized on each call to "
+    "updateTsdfDistanceSummaries(). Only for TSDF layers."};
+
+// ======= CPU THREAD POOL =======
+constexpr Param<int>::Description kNumCpuThreadsParamDesc{
+    "num_cpu_threads", 0,
+    "The number of worker threads running the CPU work of the mapper (CPU "
+    "meshing and coloring, block update bookkeeping). 0 shares the "
+    "process-wide default pool, which has one thread per core."};
+
+constexpr Param<bool>::Description kPinCpuThreadsToCoresParamDesc{
+    "pin_cpu_threads_to_cores", false,
+    "Whether to pin the worker threads to cores. Only applies if the mapper "
+    "has its own pool (num_cpu_threads > 0)."};
+
 /// A structure containing the mapper parameters. This object can be used to set
 /// all parameters of a mapper.
 struct MapperParams {
@@ -90,6 +121,7 @@ struct MapperParams {
   Param<float> esdf_slice_max_height{kEsdfSliceMaxHeightParamDesc};
   Param<float> esdf_slice_height{kEsdfSliceHeightParamDesc};
   Param<bool> exclude_last_view_from_decay{kExcludeLastViewFromDecayParamDesc};
+  Param<bool> epoch_based_decay{kEpochBasedDecayParamDesc};
   Param<float> projective_integrator_max_integration_distance_m{
       kProjectiveIntegratorMaxIntegrationDistanceMParamDesc};
   Param<float> lidar_projective_integrator_max_integration_distance_m{
@@ -142,6 +174,12 @@ struct MapperParams {
       kMeshStreamerExclusionHeightMParamDesc};
   Param<float> mesh_streamer_exclusion_radius_m{
       kMeshStreamerExclusionRadiusMParamDesc};
+  Param<bool> update_esdf_distance_summaries{
+      kUpdateEsdfDistanceSummariesParamDesc};
+  Param<bool> update_tsdf_distance_summaries{
+      kUpdateTsdfDistanceSummariesParamDesc};
+  Param<int> num_cpu_threads{kNumCpuThreadsParamDesc};
+  Param<bool> pin_cpu_threads_to_cores{kPinCpuThreadsToCoresParamDesc};
 };
 
 }  // namespace nvblox
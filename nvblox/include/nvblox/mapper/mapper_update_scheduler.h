@@ -0,0 +1,271 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "nvblox/core/cuda_stream.h"
+#include "nvblox/mapper/mapper.h"
+
+namespace nvblox {
+
+/// The stages of a mapper update cycle run by the MapperUpdateScheduler.
+enum class MapperStage {
+  kIntegrateDepth,
+  kIntegrateLidarDepth,
+  kIntegrateColor,
+  kDecay,
+  kUpdateFreespace,
+  kUpdateEsdf,
+  kUpdateMesh,
+  kNumStages
+};
+
+template <>
+inline std::string toString(const MapperStage& stage) {
+  switch (stage) {
+    case MapperStage::kIntegrateDepth:
+      return "integrate_depth";
+    case MapperStage::kIntegrateLidarDepth:
+      return "integrate_lidar_depth";
+    case MapperStage::kIntegrateColor:
+      return "integrate_color";
+    case MapperStage::kDecay:
+      return "decay";
+    case MapperStage::kUpdateFreespace:
+      return "update_freespace";
+    case MapperStage::kUpdateEsdf:
+      return "update_esdf";
+    case MapperStage::kUpdateMesh:
+      return "update_mesh";
+    default:
+      LOG(FATAL) << "Not implemented";
+      return "";
+  }
+}
+
+/// Latency and throughput of a single MapperStage.
+struct MapperStageMetrics {
+  /// The number of times the stage ran.
+  int num_runs = 0;
+  /// The number of blocks processed. Only counted for the derived-layer
+  /// stages (freespace, ESDF and mesh).
+  int64_t num_blocks_processed = 0;
+
+  /// The time spent running the stage in milliseconds.
+  float last_duration_ms = 0.0f;
+  float mean_duration_ms = 0.0f;
+  float max_duration_ms = 0.0f;
+
+  /// The time from the call (integration) or request (background stages) to
+  /// completion of the stage in milliseconds. This includes waiting for other
+  /// stages.
+  float last_latency_ms = 0.0f;
+  float mean_latency_ms = 0.0f;
+  float max_latency_ms = 0.0f;
+
+  /// The rate at which the stage completed in Hz.
+  float rate_hz = 0.0f;
+};
+
+/// Runs the updates of a Mapper's derived layers (decay, freespace, ESDF and
+/// mesh) on a background worker, concurrently with integration.
+///
+/// Integration runs on the calling thread, as with the Mapper. Derived-layer
+/// updates are requested and run on the worker thread, on their own CUDA
+/// stream, in the order decay, freespace, ESDF and mesh. Repeated requests
+/// for a stage which has not started yet are merged.
+///
+/// Consistency is kept at block granularity: A background update atomically
+/// takes a copy-on-write snapshot of the projective (and color) layer
+/// together with the blocks marked for update, and releases the mapper
+/// before doing the work. Blocks integrated into after that point are marked
+/// again and picked up by the next update, and integration only copies the
+/// blocks it writes while the snapshot is alive. Decay writes the projective
+/// layer and therefore doesn't overlap with integration. Integration never
+/// writes the derived layers: The blocks it deallocates (ie. with epoch-based
+/// decay, see Mapper::epoch_based_decay()) and the freespace blocks it pages
+/// in (with block paging, see Mapper::enableBlockPaging()) are staged and
+/// applied to the derived layers by the next background update.
+///
+/// The background updates use their own integrators. Mapper state other than
+/// the derived layers (ie. the ESDF distance summaries and the mesh streamer)
+/// is only accessed with the mapper locked.
+///
+/// While the scheduler exists, the mapper must only be accessed through it.
+/// Other mapper calls (ie. clearOutsideRadius(), reading the ESDF or mesh
+/// layers) have to go through runExclusive().
+class MapperUpdateScheduler {
+ public:
+  MapperUpdateScheduler() = delete;
+  /// Constructor. Starts the worker thread.
+  /// @param mapper The mapper to update. Must outlive the scheduler.
+  MapperUpdateScheduler(Mapper* mapper);
+  /// Finishes the requested updates and stops the worker thread.
+  ~MapperUpdateScheduler();
+
+  MapperUpdateScheduler(const MapperUpdateScheduler&) = delete;
+  MapperUpdateScheduler& operator=(const MapperUpdateScheduler&) = delete;
+
+  /// Integrates a depth frame. See Mapper::integrateDepth().
+  void integrateDepth(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Camera& camera);
+
+  /// Integrates a 3D LiDAR scan. See Mapper::integrateLidarDepth().
+  void integrateLidarDepth(const DepthImage& depth_frame,
+                           const Transform& T_L_C, const Lidar& lidar);
+
+  /// Integrates a color frame. See Mapper::integrateColor().
+  void integrateColor(const ColorImage& color_frame, const Transform& T_L_C,
+                      const Camera& camera);
+
+  /// Requests a decay of the projective layer. See Mapper::decayTsdf() and
+  /// Mapper::decayOccupancy().
+  void requestDecay();
+
+  /// Requests an update of the freespace layer. See
+  /// Mapper::updateFreespace().
+  /// @param update_time_ms The time of the update in miliseconds.
+  void requestFreespaceUpdate(Time update_time_ms);
+
+  /// Requests an update of the 3D ESDF. See Mapper::updateEsdf().
+  void requestEsdfUpdate();
+
+  /// Requests an update of the 2D ESDF. See Mapper::updateEsdfSlice().
+  void requestEsdfSliceUpdate();
+
+  /// Requests an update of the mesh. The updated blocks are serialized, see
+  /// getSerializedMesh().
+  /// @param maybe_T_L_C Optional camera pose, see Mapper::updateMesh().
+  void requestMeshUpdate(
+      const std::optional<Transform>& maybe_T_L_C = std::nullopt);
+
+  /// The mesh serialized by the last completed mesh update.
+  /// @return The serialized mesh, or nullptr if no mesh update completed.
+  std::shared_ptr<const SerializedMesh> getSerializedMesh() const;
+
+  /// Blocks until all requested updates are finished.
+  void waitUntilIdle();
+
+  /// Runs a function with exclusive access to the mapper, ie. with neither
+  /// integration nor background updates running.
+  /// @param function The function to run.
+  void runExclusive(const std::function<void(Mapper*)>& function);
+
+  /// The metrics of a stage.
+  /// @param stage The stage.
+  /// @return The metrics.
+  MapperStageMetrics getStageMetrics(MapperStage stage) const;
+
+  /// A table of the metrics of all stages that ran.
+  std::string getMetricsAsString() const;
+
+  /// Reset the metrics of all stages.
+  void resetMetrics();
+
+  /// The CUDA stream on which background updates are processed.
+  const CudaStream& worker_cuda_stream() const { return *worker_cuda_stream_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // A pending request for a background stage.
+  struct StageRequest {
+    bool requested = false;
+    Clock::time_point request_time;
+  };
+
+  // The background stages requested but not yet started.
+  struct PendingRequests {
+    StageRequest decay;
+    StageRequest freespace;
+    StageRequest esdf;
+    StageRequest mesh;
+    Time freespace_update_time_ms{0};
+    bool esdf_slice = false;
+    std::optional<Transform> mesh_T_L_C;
+  };
+
+  // Request a stage and wake up the worker.
+  void request(StageRequest* stage_request);
+
+  // The worker thread.
+  void workerLoop();
+
+  // Runs the requested background stages.
+  void runRequests(const PendingRequests& requests);
+
+  // Copies the parameters of the mapper's integrators to the ones owned by
+  // the worker. Requires the mapper to be locked.
+  void syncIntegratorParams();
+
+  // Record a run of a stage.
+  void recordStage(MapperStage stage, Clock::time_point request_time,
+                   Clock::time_point start_time, int num_blocks = 0);
+
+  Mapper* mapper_;
+
+  // Derived-layer updates run on this stream.
+  std::shared_ptr<CudaStream> worker_cuda_stream_;
+  MeshIntegrator mesh_integrator_;
+  EsdfIntegrator esdf_integrator_;
+  // Continues from (and hands back) the time of the last freespace update of
+  // the mapper's integrator.
+  FreespaceIntegrator freespace_integrator_;
+
+  // Guards the projective and color layers, the blocks-to-update tracker and
+  // all other non-derived state of the mapper. Held by integration and
+  // briefly by background updates.
+  std::mutex mapper_mutex_;
+  // Guards the derived layers (freespace, ESDF, mesh). Held by background
+  // updates and runExclusive(), never by integration. Always locked before
+  // mapper_mutex_.
+  std::mutex derived_layers_mutex_;
+
+  // Worker state
+  std::mutex worker_mutex_;
+  std::condition_variable worker_condition_;
+  std::condition_variable idle_condition_;
+  PendingRequests pending_requests_;
+  bool worker_busy_ = false;
+  bool stop_ = false;
+  std::thread worker_thread_;
+
+  // Output of the mesh stage
+  mutable std::mutex serialized_mesh_mutex_;
+  std::shared_ptr<const SerializedMesh> serialized_mesh_;
+
+  // Metrics
+  struct StageStatistics {
+    MapperStageMetrics metrics;
+    double total_duration_ms = 0.0;
+    double total_latency_ms = 0.0;
+    Clock::time_point first_completion_time;
+  };
+  mutable std::mutex metrics_mutex_;
+  std::array<StageStatistics, static_cast<size_t>(MapperStage::kNumStages)>
+      stage_statistics_;
+};
+
+}  // namespace nvblox
@@ -231,10 +231,32 @@ class MultiMapper {
   /// @return the parameter tree string
   virtual std::string getParametersAsString() const;
 
+  /// A breakdown of the memory held by both mappers, with items prefixed by
+  /// "unmasked_mapper/" and "masked_mapper/", and by the intermediate images.
+  /// See Mapper::getMemoryReport().
+  /// @return The memory report.
+  MemoryReport getMemoryReport() const;
+
+  /// The total memory held by the multi mapper, computed without building
+  /// the report. See Mapper::getMemoryUsage().
+  /// @return The memory usage.
+  MemoryUsage getMemoryUsage() const;
+
+  /// The total memory held by the multi mapper and its high watermark. See
+  /// Mapper::getMemorySnapshot().
+  /// @return The current usage and the high watermark.
+  MemorySnapshot getMemorySnapshot();
+
+  /// Restart tracking of the high watermark from the current memory usage.
+  void resetMemoryHighWatermark();
+
  protected:
   // Performs the esdf update on the passed mapper
   void updateEsdfOfMapper(const std::shared_ptr<Mapper>& mapper);
 
+  // The memory held by the intermediate images.
+  MemoryUsage getImagesMemoryUsage() const;
+
   // Mapping type needed on construction
   const MappingType mapping_type_;
   const EsdfMode esdf_mode_;
@@ -268,6 +290,9 @@ class MultiMapper {
 
   // The CUDA stream on which to process all work
   std::shared_ptr<CudaStream> cuda_stream_;
+
+  // The maximum memory usage seen by getMemorySnapshot()
+  MemoryUsage memory_high_watermark_;
 };
 
 }  // namespace nvblox
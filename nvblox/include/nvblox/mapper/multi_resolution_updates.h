@@ -0,0 +1,87 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <vector>
+
+#include "nvblox/integrators/esdf_integrator.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/multi_resolution_layer.h"
+#include "nvblox/mesh/mesh_integrator.h"
+
+namespace nvblox {
+
+/// Updates the mesh of both levels of a multi-resolution TSDF layer.
+/// The fine level is meshed inside the fine region and the coarse level
+/// outside of it. To avoid a crack at the (coarse block aligned) level
+/// boundary, the coarse mesh extends one coarse block into the fine region and
+/// overlaps the fine mesh there. This band is meshed from the coarse level, so
+/// the fine blocks in it should be down-sampled (see
+/// MultiResolutionVoxelLayer::downsampleToCoarseLevel()). Mesh blocks that are
+/// no longer covered by their level are deallocated.
+/// @param tsdf_layer The input multi-resolution TSDF.
+/// @param fine_blocks_to_update Fine blocks that changed since the last update.
+/// @param coarse_blocks_to_update Coarse blocks that changed since the last
+/// update.
+/// @param mesh_integrator The integrator used for meshing both levels.
+/// @param fine_mesh_layer Output mesh of the fine level.
+/// @param coarse_mesh_layer Output mesh of the coarse level.
+void updateMultiResolutionMesh(
+    const MultiResolutionTsdfLayer& tsdf_layer,
+    const std::vector<Index3D>& fine_blocks_to_update,
+    const std::vector<Index3D>& coarse_blocks_to_update,
+    MeshIntegrator* mesh_integrator, MeshLayer* fine_mesh_layer,
+    MeshLayer* coarse_mesh_layer);
+
+/// Updates the ESDF of both levels of a multi-resolution TSDF layer.
+/// The coarse level covers the whole map (including the down-sampled fine
+/// region) and therefore sees all obstacles, at coarse resolution. The fine
+/// level adds detail inside the fine region, but only sees the obstacles in
+/// the fine TSDF. Query the two levels through
+/// getMultiResolutionEsdfDistance(), which accounts for that. ESDF blocks that
+/// are no longer covered by their level are deallocated.
+/// @param tsdf_layer The input multi-resolution TSDF.
+/// @param fine_blocks_to_update Fine blocks that changed since the last update.
+/// @param coarse_blocks_to_update Coarse blocks that changed since the last
+/// update.
+/// @param esdf_integrator The integrator used for both levels.
+/// @param fine_esdf_layer Output ESDF of the fine level.
+/// @param coarse_esdf_layer Output ESDF of the coarse level.
+void updateMultiResolutionEsdf(
+    const MultiResolutionTsdfLayer& tsdf_layer,
+    const std::vector<Index3D>& fine_blocks_to_update,
+    const std::vector<Index3D>& coarse_blocks_to_update,
+    EsdfIntegrator* esdf_integrator, EsdfLayer* fine_esdf_layer,
+    EsdfLayer* coarse_esdf_layer);
+
+/// Query the distance to the closest obstacle in a two-level ESDF.
+/// Returns the smaller of the distances of the observed levels. Near the level
+/// boundary the fine level doesn't see the obstacles which only exist at the
+/// coarse level, so preferring it would overestimate the clearance.
+/// Note that this function performs a Cudamemcpy per level queried when the
+/// layers are stored on the device. See VoxelBlockLayer::getVoxel().
+/// @param fine_esdf_layer The fine ESDF level.
+/// @param coarse_esdf_layer The coarse ESDF level.
+/// @param p_L The query position in the layer frame.
+/// @param[out] distance_m The signed distance in meters (negative inside).
+/// @param[out] level_ptr Optional. The level the distance was retrieved from.
+/// @return True if either level has observed the queried position.
+bool getMultiResolutionEsdfDistance(const EsdfLayer& fine_esdf_layer,
+                                    const EsdfLayer& coarse_esdf_layer,
+                                    const Vector3f& p_L, float* distance_m,
+                                    ResolutionLevel* level_ptr = nullptr);
+
+}  // namespace nvblox
@@ -0,0 +1,318 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvblox/core/parameter_tree.h"
+#include "nvblox/core/time.h"
+#include "nvblox/geometry/bounding_boxes.h"
+#include "nvblox/map/block_pager.h"
+#include "nvblox/mapper/mapper.h"
+
+namespace nvblox {
+
+/// The lifecycle of a submap.
+enum class SubmapState {
+  /// The submap integrates incoming data.
+  kActive,
+  /// The submap is finished and waits to be frozen in the background.
+  kFreezing,
+  /// The submap is compacted and kept in host memory.
+  kFrozen,
+  /// The submap is written to disk and its memory released.
+  kOffloaded
+};
+
+template <>
+inline std::string toString(const SubmapState& state) {
+  switch (state) {
+    case SubmapState::kActive:
+      return "kActive";
+    case SubmapState::kFreezing:
+      return "kFreezing";
+    case SubmapState::kFrozen:
+      return "kFrozen";
+    case SubmapState::kOffloaded:
+      return "kOffloaded";
+    default:
+      LOG(FATAL) << "Not implemented";
+      return "";
+  }
+}
+
+/// Information on a submap.
+struct SubmapInfo {
+  int id = -1;
+  SubmapState state = SubmapState::kActive;
+  /// The position of the sensor when the submap was started.
+  Vector3f anchor_position_L = Vector3f::Zero();
+  /// Times of the first and last integrated frame.
+  Time start_time_ms{0};
+  Time end_time_ms{0};
+  /// The number of integrated depth frames.
+  int num_integrated_frames = 0;
+  /// The number of TSDF blocks (after compaction for frozen submaps).
+  size_t num_tsdf_blocks = 0;
+  /// The bounds of the allocated TSDF blocks. Only set once frozen.
+  AxisAlignedBoundingBox aabb;
+  /// Whether the submap has been fused into the global layers.
+  bool fused = false;
+  /// The file the submap was offloaded to, if it was.
+  std::string filepath;
+};
+
+/// Splits a map spatially into a sequence of local submaps, such that the
+/// per-frame cost of mapping doesn't grow with the length of a mission.
+///
+/// Data is integrated into the active submap, a regular Mapper. A new submap
+/// is started once the sensor has moved submap_distance_m away from where the
+/// active submap started, or once submap_duration_s have passed. All submaps
+/// share the frame L of the passed poses.
+///
+/// Finished submaps are handed to a background worker, which freezes them:
+/// their TSDF and color layers are copied to host memory without the blocks
+/// that were allocated but never observed, and the submap's Mapper (and its
+/// GPU memory) is released. Frozen submaps are then (optionally) fused into
+/// global TSDF and color layers by weight-averaging voxels, and (optionally)
+/// offloaded to disk. Fused weights are clamped to the max_weight of the
+/// submap's integrators. The calling thread only hands over the finished
+/// mapper, so integration cost is independent of the number of submaps.
+///
+/// With offloading enabled, the fused layers are paged by region as well:
+/// after fusing a submap, the fused blocks further than fused_region_radius_m
+/// from where the submap started are paged out to
+/// "<directory>/fused_tsdf" and "<directory>/fused_color", and they are paged
+/// back in when a later submap or a query overlaps them. Host memory is
+/// therefore bounded by the fused region and the submaps not offloaded yet.
+///
+/// Queries combine all submaps containing the queried position: the active
+/// submap, the global fused layers and the frozen submaps not fused yet.
+/// Offloaded submaps which were not fused are not queried; load them with
+/// loadOffloadedSubmap().
+class SubmapManager {
+ public:
+  static constexpr float kDefaultSubmapDistanceM = 20.0f;
+  static constexpr float kDefaultSubmapDurationS = 120.0f;
+  static constexpr bool kDefaultFuseFrozenSubmaps = true;
+  static constexpr float kDefaultFusedRegionRadiusM = 50.0f;
+
+  SubmapManager() = delete;
+  /// Constructor. Starts the background worker.
+  /// @param voxel_size_m The voxel size of the submaps.
+  /// @param memory_type Where the active submap's layers are stored.
+  SubmapManager(float voxel_size_m,
+                MemoryType memory_type = MemoryType::kDevice);
+  /// Freezes the submaps handed to the background worker and stops it.
+  ~SubmapManager();
+
+  SubmapManager(const SubmapManager&) = delete;
+  SubmapManager& operator=(const SubmapManager&) = delete;
+
+  /// Set the parameters of the mappers of new submaps.
+  /// @param params The parameters.
+  void setMapperParams(const MapperParams& params);
+
+  /// Integrates a depth frame into the active submap. Starts a new submap
+  /// first if the active one is too large or too old.
+  /// @param depth_frame Depth frame to integrate.
+  /// @param T_L_C Pose of the camera, in the common frame of all submaps.
+  /// @param camera Intrinsics model of the camera.
+  /// @param timestamp_ms Time of the frame.
+  void integrateDepth(const DepthImage& depth_frame, const Transform& T_L_C,
+                      const Camera& camera, Time timestamp_ms);
+
+  /// Integrates a color frame into the active submap. See
+  /// Mapper::integrateColor().
+  void integrateColor(const ColorImage& color_frame, const Transform& T_L_C,
+                      const Camera& camera);
+
+  /// Hands the active submap to the background worker, ie. at the end of a
+  /// mission. The next frame starts a new submap.
+  void finishActiveSubmap();
+
+  /// The mapper of the active submap. Created by the first integration.
+  /// @return The mapper, or nullptr if there is no active submap.
+  Mapper* active_mapper() { return active_mapper_.get(); }
+  const Mapper* active_mapper() const { return active_mapper_.get(); }
+
+  /// Information on all submaps, ordered by id.
+  std::vector<SubmapInfo> getSubmapInfos() const;
+
+  /// The number of submaps started so far.
+  int num_submaps() const;
+
+  /// Look up the TSDF at positions, combined over all submaps containing
+  /// them. Distances of overlapping submaps are averaged by their weight.
+  /// Fused blocks which are paged out are paged back in. Submaps which were
+  /// offloaded without being fused are NOT queried (their positions may be
+  /// reported as unobserved); use loadOffloadedSubmap() for those.
+  /// Must be called from the thread integrating, as it reads the active
+  /// submap.
+  /// @param positions_L The query positions.
+  /// @param voxels_ptr The combined voxels.
+  /// @param success_flags_ptr Whether a position is observed in any submap.
+  void getTsdfVoxels(const std::vector<Vector3f>& positions_L,
+                     std::vector<TsdfVoxel>* voxels_ptr,
+                     std::vector<bool>* success_flags_ptr) const;
+
+  /// Runs a function on the global fused layers, with the background worker
+  /// blocked from modifying them. With offloading enabled, only the fused
+  /// blocks currently paged in are passed (see fused_region_radius_m()).
+  /// @param function The function to run.
+  void runWithFusedLayers(
+      const std::function<void(const TsdfLayer&, const ColorLayer&)>&
+          function) const;
+
+  /// Loads the layers of an offloaded submap from disk.
+  /// @param id The id of the submap.
+  /// @return The layers, or an empty cake if the submap is not offloaded.
+  LayerCake loadOffloadedSubmap(int id) const;
+
+  /// Blocks until all finished submaps are frozen, fused and offloaded.
+  void waitForBackgroundWork();
+
+  /// Enables offloading frozen submaps to disk. Offloaded submaps are written
+  /// to "<directory>/submap_<id>.nvblx". Also enables paging of the fused
+  /// layers, see the class description.
+  /// @param directory Existing directory to write to.
+  void enableOffloading(const std::string& directory);
+
+  /// A parameter getter
+  /// A new submap is started when the sensor is further than this from where
+  /// the active submap started.
+  /// @returns the submap distance in meters
+  float submap_distance_m() const;
+
+  /// A parameter getter
+  /// A new submap is started when the active one is older than this.
+  /// @returns the submap duration in seconds
+  float submap_duration_s() const;
+
+  /// A parameter getter
+  /// Whether frozen submaps are fused into the global layers.
+  /// @returns whether to fuse
+  bool fuse_frozen_submaps() const;
+
+  /// A parameter getter
+  /// With offloading enabled, fused blocks further than this from the latest
+  /// fused submap are paged out to disk.
+  /// @returns the fused region radius in meters
+  float fused_region_radius_m() const;
+
+  /// A parameter setter
+  /// See submap_distance_m().
+  /// @param submap_distance_m the submap distance in meters.
+  void submap_distance_m(float submap_distance_m);
+
+  /// A parameter setter
+  /// See submap_duration_s().
+  /// @param submap_duration_s the submap duration in seconds.
+  void submap_duration_s(float submap_duration_s);
+
+  /// A parameter setter
+  /// See fuse_frozen_submaps().
+  /// @param fuse_frozen_submaps whether to fuse.
+  void fuse_frozen_submaps(bool fuse_frozen_submaps);
+
+  /// A parameter setter
+  /// See fused_region_radius_m().
+  /// @param fused_region_radius_m the fused region radius in meters.
+  void fused_region_radius_m(float fused_region_radius_m);
+
+  /// Return the parameter tree.
+  /// @return the parameter tree
+  parameters::ParameterTreeNode getParameterTree(
+      const std::string& name_remap = std::string()) const;
+
+ private:
+  // A submap, once it is no longer active.
+  struct Submap {
+    SubmapInfo info;
+    // The mapper, until the submap is frozen.
+    std::unique_ptr<Mapper> mapper;
+    // The compacted host layers, while the submap is frozen.
+    std::unique_ptr<TsdfLayer> tsdf_layer;
+    std::unique_ptr<ColorLayer> color_layer;
+    // What to do with the submap once frozen. Decided when it's finished.
+    bool fuse = false;
+    std::string offload_directory;
+    float fused_region_radius_m = kDefaultFusedRegionRadiusM;
+    // The fused voxel weights are clamped to the max weights of the
+    // submap's integrators.
+    float tsdf_max_weight = std::numeric_limits<float>::max();
+    float color_max_weight = std::numeric_limits<float>::max();
+  };
+
+  // Start a new active submap.
+  void startSubmap(const Vector3f& anchor_position_L, Time timestamp_ms);
+  // Hand the active submap to the background worker.
+  void finishSubmap();
+  // Background worker loop.
+  void workerLoop();
+  // Freeze, fuse and offload a submap. Runs on the worker.
+  void processFinishedSubmap(const std::shared_ptr<Submap>& submap);
+
+  const float voxel_size_m_;
+  const MemoryType memory_type_;
+  std::optional<MapperParams> mapper_params_;
+
+  // The active submap. Only touched by the calling thread.
+  std::unique_ptr<Mapper> active_mapper_;
+  SubmapInfo active_info_;
+  int next_submap_id_ = 0;
+
+  // Submaps that are no longer active. Guarded by submaps_mutex_.
+  mutable std::mutex submaps_mutex_;
+  std::vector<std::shared_ptr<Submap>> submaps_;
+
+  // The global fused layers and their pagers. The pagers only exist with
+  // offloading enabled. Guarded by fused_mutex_.
+  mutable std::mutex fused_mutex_;
+  TsdfLayer fused_tsdf_layer_;
+  ColorLayer fused_color_layer_;
+  std::unique_ptr<TsdfBlockPager> fused_tsdf_pager_;
+  std::unique_ptr<ColorBlockPager> fused_color_pager_;
+
+  // Background work. Guarded by work_mutex_.
+  std::mutex work_mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::shared_ptr<Submap>> work_queue_;
+  bool worker_busy_ = false;
+  bool stop_worker_ = false;
+  std::thread worker_thread_;
+  // The stream the worker freezes submaps on.
+  std::shared_ptr<CudaStream> cuda_stream_;
+
+  // Params
+  float submap_distance_m_ = kDefaultSubmapDistanceM;
+  float submap_duration_s_ = kDefaultSubmapDurationS;
+  bool fuse_frozen_submaps_ = kDefaultFuseFrozenSubmaps;
+  float fused_region_radius_m_ = kDefaultFusedRegionRadiusM;
+  std::string offload_directory_;
+};
+
+}  // namespace nvblox
@@ -0,0 +1,98 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <vector>
+
+#include "nvblox/core/hash.h"
+#include "nvblox/core/types.h"
+
+namespace nvblox {
+
+/// @brief An indexed max-heap of block indices.
+///
+/// Each block index is contained at most once. Pushing a contained block
+/// updates its priority in place. Blocks with equal priority are returned in
+/// the order in which they were first pushed.
+///
+/// Costs: push(), erase() and pop() are O(log n), top() and contains() are
+/// O(1).
+class BlockPriorityQueue {
+ public:
+  BlockPriorityQueue() = default;
+  ~BlockPriorityQueue() = default;
+
+  /// Inserts a block, or updates its priority if already contained.
+  /// @param block_index The block index.
+  /// @param priority The priority. Higher priorities are returned first.
+  void push(const Index3D& block_index, float priority);
+
+  /// Removes a block.
+  /// @param block_index The block index.
+  /// @return True if the block was contained.
+  bool erase(const Index3D& block_index);
+
+  /// The highest priority block. The queue must not be empty.
+  const Index3D& top() const;
+
+  /// The priority of the highest priority block. The queue must not be empty.
+  float topPriority() const;
+
+  /// Removes and returns the highest priority block. The queue must not be
+  /// empty.
+  Index3D pop();
+
+  /// @return True if the block is contained.
+  bool contains(const Index3D& block_index) const;
+
+  /// The priority of a block. The block must be contained.
+  float priority(const Index3D& block_index) const;
+
+  /// @return The number of blocks in the queue.
+  size_t size() const { return heap_.size(); }
+
+  /// @return True if the queue is empty.
+  bool empty() const { return heap_.empty(); }
+
+  /// Removes all blocks.
+  void clear();
+
+  /// All contained blocks in heap (not priority) order.
+  std::vector<Index3D> getBlockIndices() const;
+
+ private:
+  struct Entry {
+    Index3D block_index;
+    float priority;
+    // Insertion order, used to break ties.
+    uint64_t sequence_number;
+  };
+
+  // True if entry a should be returned before b.
+  static bool isBefore(const Entry& a, const Entry& b);
+
+  // Restore the heap property after the entry at a position was changed.
+  void siftUp(size_t position);
+  void siftDown(size_t position);
+  void swapEntries(size_t position_a, size_t position_b);
+
+  std::vector<Entry> heap_;
+  // The position of each block in heap_.
+  Index3DHashMapType<size_t>::type positions_;
+  uint64_t next_sequence_number_ = 0;
+};
+
+}  // namespace nvblox
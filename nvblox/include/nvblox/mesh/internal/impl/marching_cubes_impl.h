@@ -1,4 +1,6 @@
+#include "nvblox/core/indexing.h"
 #include "nvblox/core/types.h"
+#include "nvblox/map/voxels.h"
 #include "nvblox/mesh/internal/impl/marching_cubes_table.h"
 
 namespace nvblox {
@@ -106,6 +108,116 @@ inline void meshCube(const PerVoxelMarchingCubesResults& marching_cubes_results,
   }
 }
 
+// Corners of the cube formed by a voxel and its neighbours in the positive
+// directions, in the order expected by the marching cubes tables.
+constexpr int kCubeIndexOffsets[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0},
+                                         {0, 1, 0}, {0, 0, 1}, {1, 0, 1},
+                                         {1, 1, 1}, {0, 1, 1}};
+
+template <typename BlockType>
+bool isBlockMeshable(const BlockType& block, float cutoff, float min_weight) {
+  constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        // Copy the voxel, as not all layouts store voxel structs.
+        const TsdfVoxel voxel = block.voxels[x][y][z];
+        // Check if voxel distance is within the cutoff to determine if
+        // there's going to be a surface boundary in this block.
+        if (voxel.weight >= min_weight && std::abs(voxel.distance) <= cutoff) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+template <typename BlockType>
+bool getTriangleCandidatesAroundVoxel(
+    const NeighborBlockPtrs<BlockType>& neighbor_blocks,
+    const Index3D& voxel_index, const Vector3f& voxel_position,
+    float voxel_size, float min_weight,
+    PerVoxelMarchingCubesResults* neighbors) {
+  constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+  for (int i = 0; i < 8; ++i) {
+    const Index3D cube_index_offset(kCubeIndexOffsets[i][0],
+                                    kCubeIndexOffsets[i][1],
+                                    kCubeIndexOffsets[i][2]);
+    Index3D corner_index = voxel_index + cube_index_offset;
+
+    // Are we in bounds? If not, have to get a neighbor.
+    // The neighbor should correspond to the index in neighbor blocks.
+    Index3D block_offset(0, 0, 0);
+    for (int j = 0; j < 3; j++) {
+      if (corner_index[j] >= kVoxelsPerSide) {
+        corner_index(j) -= kVoxelsPerSide;
+        block_offset(j) = 1;
+      }
+    }
+    const BlockType* block =
+        neighbor_blocks[neighborIndexFromDirection(block_offset)];
+    if (block == nullptr) {
+      return false;
+    }
+    const TsdfVoxel voxel =
+        block->voxels[corner_index.x()][corner_index.y()][corner_index.z()];
+
+    // If any of the neighbors are not observed, this can't be a mesh
+    // triangle.
+    if (voxel.weight < min_weight) {
+      return false;
+    }
+    neighbors->vertex_sdf[i] = voxel.distance;
+    neighbors->vertex_coords[i] =
+        voxel_position + voxel_size * cube_index_offset.cast<float>();
+  }
+
+  // Figure out the index if we've made it this far.
+  neighbors->marching_cubes_table_index =
+      calculateVertexConfiguration(neighbors->vertex_sdf);
+
+  // Index 0 & 255 contain no triangles so not worth outputting it.
+  return neighbors->marching_cubes_table_index != 0 &&
+         neighbors->marching_cubes_table_index != 255;
+}
+
+template <typename BlockType>
+void getTriangleCandidatesInBlock(
+    const NeighborBlockPtrs<BlockType>& neighbor_blocks,
+    const Index3D& block_index, float block_size, float min_weight,
+    std::vector<PerVoxelMarchingCubesResults>* triangle_candidates) {
+  CHECK_NOTNULL(neighbor_blocks[0]);
+  CHECK_NOTNULL(triangle_candidates);
+
+  constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+  const float voxel_size = block_size / kVoxelsPerSide;
+
+  Index3D voxel_index;
+  // Iterate over all inside voxels.
+  for (voxel_index.x() = 0; voxel_index.x() < kVoxelsPerSide;
+       voxel_index.x()++) {
+    for (voxel_index.y() = 0; voxel_index.y() < kVoxelsPerSide;
+         voxel_index.y()++) {
+      for (voxel_index.z() = 0; voxel_index.z() < kVoxelsPerSide;
+           voxel_index.z()++) {
+        // Get the position of this voxel.
+        const Vector3f voxel_position =
+            getCenterPositionFromBlockIndexAndVoxelIndex(
+                block_size, block_index, voxel_index);
+
+        PerVoxelMarchingCubesResults neighbors;
+        // Figure out if this voxel is actually a triangle candidate.
+        if (getTriangleCandidatesAroundVoxel(neighbor_blocks, voxel_index,
+                                             voxel_position, voxel_size,
+                                             min_weight, &neighbors)) {
+          triangle_candidates->push_back(neighbors);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace marching_cubes
 
 }  // namespace nvblox
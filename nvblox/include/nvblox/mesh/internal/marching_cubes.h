@@ -24,6 +24,9 @@
 
 #include <cuda_runtime.h>
 
+#include <array>
+#include <vector>
+
 #include "nvblox/core/types.h"
 #include "nvblox/mesh/mesh_block.h"
 
@@ -79,6 +82,34 @@ __host__ void meshCube(
     const PerVoxelMarchingCubesResults& marching_cubes_results,
     MeshBlock* mesh);
 
+// CPU meshing of a single block. These are templated on the block type such
+// that they run on all voxel block layouts (VoxelBlock, SoaVoxelBlock and
+// MortonVoxelBlock). The neighbor blocks are indexed by
+// neighborIndexFromDirection(), with the block itself at index 0. Missing
+// neighbors are nullptr.
+template <typename BlockType>
+using NeighborBlockPtrs = std::array<const BlockType*, 8>;
+
+// Does the block contain an observed voxel within cutoff of the surface?
+template <typename BlockType>
+bool isBlockMeshable(const BlockType& block, float cutoff, float min_weight);
+
+// Get the marching cubes cube with the voxel at its minimum corner. Returns
+// false if the cube has no triangles or any corner is unobserved.
+template <typename BlockType>
+bool getTriangleCandidatesAroundVoxel(
+    const NeighborBlockPtrs<BlockType>& neighbor_blocks,
+    const Index3D& voxel_index, const Vector3f& voxel_position,
+    float voxel_size, float min_weight,
+    PerVoxelMarchingCubesResults* neighbors);
+
+// Append the cubes containing triangles for all voxels in the block.
+template <typename BlockType>
+void getTriangleCandidatesInBlock(
+    const NeighborBlockPtrs<BlockType>& neighbor_blocks,
+    const Index3D& block_index, float block_size, float min_weight,
+    std::vector<PerVoxelMarchingCubesResults>* triangle_candidates);
+
 }  // namespace marching_cubes
 }  // namespace nvblox
 
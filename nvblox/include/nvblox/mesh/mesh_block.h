@@ -60,6 +60,10 @@ struct MeshBlock {
   /// The number of bytes in this block
   size_t sizeInBytes() const;
 
+  /// The memory held by this block, including the reserved (rather than
+  /// used) capacity of its vectors.
+  MemoryUsage getMemoryUsage() const;
+
   /// Resize colors/intensities such that:
   /// `colors.size()/intensities.size() == vertices.size()`
   void expandColorsToMatchVertices();
@@ -116,4 +120,16 @@ inline void BlockLayer<MeshBlock>::copyFromAsync(const BlockLayer& other,
   }
 }
 
+/// Specialization of BlockLayer memory accounting for MeshBlocks, whose
+/// memory is mostly held in their vectors.
+template <>
+inline MemoryUsage BlockLayer<MeshBlock>::getAllocatedBlocksMemoryUsage()
+    const {
+  MemoryUsage usage;
+  for (const auto& index_block_pair : blocks_) {
+    usage += index_block_pair.second->getMemoryUsage();
+  }
+  return usage;
+}
+
 }  // namespace nvblox
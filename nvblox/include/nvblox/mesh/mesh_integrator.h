@@ -15,12 +15,14 @@ limitations under the License.
 */
 #pragma once
 
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/integrators/mesh_integrator_params.h"
 #include "nvblox/map/common_names.h"
 #include "nvblox/map/layer.h"
 #include "nvblox/mesh/internal/marching_cubes.h"
 #include "nvblox/mesh/mesh_block.h"
+#include "nvblox/utils/thread_pool.h"
 namespace nvblox {
 
 /// Class to integrate TSDF data into a mesh using marching cubes.
@@ -51,9 +53,23 @@ class MeshIntegrator {
                           const std::vector<Index3D>& block_indices,
                           BlockLayer<MeshBlock>* mesh_layer);
 
+  /// @brief Integrate new blocks of a compact (half precision) TSDF layer into
+  /// a mesh on the GPU.
+  /// @param distance_layer The compact TSDF layer to integrate.
+  /// @param block_indices Which block indices to integrate, can either be
+  /// updated ones or all blocks in the TSDF layer.
+  /// @param mesh_layer The mesh layer for output.
+  /// @return Whether the integration succeeded.
+  bool integrateBlocksGPU(const CompactTsdfLayer& distance_layer,
+                          const std::vector<Index3D>& block_indices,
+                          BlockLayer<MeshBlock>* mesh_layer);
+
   /// Color mesh layer.
-  /// TODO(alexmillane): Currently these functions color vertices by taking the
-  /// CLOSEST color. Would be good to have an option at least for interpolation.
+  /// The GPU functions color vertices by taking the CLOSEST color. The CPU
+  /// functions color mesh blocks in parallel and optionally interpolate the
+  /// colors of the voxels around each vertex (see
+  /// color_interpolation_trilinear()). The CPU functions require the color
+  /// layer to be accessible from the host.
   void colorMesh(const ColorLayer& color_layer, MeshLayer* mesh_layer);
   void colorMesh(const ColorLayer& color_layer,
                  const std::vector<Index3D>& block_indices,
@@ -73,38 +89,72 @@ class MeshIntegrator {
   bool weld_vertices() const { return weld_vertices_; }
   void weld_vertices(bool weld_vertices) { weld_vertices_ = weld_vertices; }
 
+  /// Whether CPU coloring interpolates the colors of the 8 observed voxels
+  /// around a vertex, rather than taking the color of the closest voxel.
+  bool color_interpolation_trilinear() const {
+    return color_interpolation_trilinear_;
+  }
+  void color_interpolation_trilinear(bool color_interpolation_trilinear) {
+    color_interpolation_trilinear_ = color_interpolation_trilinear;
+  }
+
+  /// The maximum number of threads used for CPU coloring, including the
+  /// calling thread. 0 uses the whole thread pool.
+  int num_color_threads() const { return num_color_threads_; }
+  void num_color_threads(int num_color_threads) {
+    num_color_threads_ = num_color_threads;
+  }
+
+  /// The pool running the CPU meshing and coloring. Defaults to
+  /// ThreadPool::getDefault().
+  std::shared_ptr<ThreadPool> thread_pool() const { return thread_pool_; }
+  void thread_pool(std::shared_ptr<ThreadPool> thread_pool) {
+    CHECK(thread_pool);
+    thread_pool_ = std::move(thread_pool);
+  }
+
   /// Return the parameter tree.
   /// @return the parameter tree
   virtual parameters::ParameterTreeNode getParameterTree(
       const std::string& name_remap = std::string()) const;
 
+  /// The memory held by the buffers used during meshing. The buffers
+  /// grow to fit the largest update so far and are never shrunk.
+  /// @return The memory usage.
+  MemoryUsage getScratchMemoryUsage() const;
+
  private:
-  bool isBlockMeshable(const VoxelBlock<TsdfVoxel>::ConstPtr block,
-                       float cutoff) const;
-
-  bool getTriangleCandidatesAroundVoxel(
-      const VoxelBlock<TsdfVoxel>::ConstPtr block,
-      const std::vector<VoxelBlock<TsdfVoxel>::ConstPtr>& neighbor_blocks,
-      const Index3D& index, const Vector3f& voxel_position,
-      const float voxel_size,
-      marching_cubes::PerVoxelMarchingCubesResults* neighbors);
-
-  void getTriangleCandidatesInBlock(
-      const VoxelBlock<TsdfVoxel>::ConstPtr block,
-      const std::vector<VoxelBlock<TsdfVoxel>::ConstPtr>& neighbor_blocks,
-      const Index3D& block_index, const float block_size,
-      std::vector<marching_cubes::PerVoxelMarchingCubesResults>*
-          triangle_candidates);
-
-  void getMeshableBlocksGPU(const TsdfLayer& distance_layer,
+  template <typename LayerType>
+  bool integrateBlocksGPUTemplate(const LayerType& distance_layer,
+                                  const std::vector<Index3D>& block_indices,
+                                  BlockLayer<MeshBlock>* mesh_layer);
+
+  template <typename LayerType>
+  void getMeshableBlocksGPU(const LayerType& distance_layer,
                             const std::vector<Index3D>& block_indices,
                             float cutoff_distance,
                             std::vector<Index3D>* meshable_blocks);
 
-  void meshBlocksGPU(const TsdfLayer& distance_layer,
+  template <typename LayerType>
+  void meshBlocksGPU(const LayerType& distance_layer,
                      const std::vector<Index3D>& block_indices,
                      BlockLayer<MeshBlock>* mesh_layer);
 
+  // Buffers of block pointers passed to the meshing kernels. One set per
+  // supported voxel type.
+  template <typename BlockType>
+  struct BlockPtrBuffers {
+    host_vector<const BlockType*> host;
+    device_vector<const BlockType*> device;
+  };
+  BlockPtrBuffers<TsdfBlock>& getBlockPtrBuffers(const TsdfLayer&) {
+    return tsdf_block_ptrs_;
+  }
+  BlockPtrBuffers<CompactTsdfBlock>& getBlockPtrBuffers(
+      const CompactTsdfLayer&) {
+    return compact_tsdf_block_ptrs_;
+  }
+
   // Weld overlapping vertices together, updaing the normals & indices of the
   // reduced vertex count.
   void weldVertices(device_vector<CudaMeshBlock>* cuda_mesh_blocks);
@@ -119,8 +169,14 @@ class MeshIntegrator {
   // of vertices by 5x.
   bool weld_vertices_ = kMeshIntegratorWeldVerticesParamDesc.default_value;
 
-  // Offsets for cube indices.
-  Eigen::Matrix<int, 3, 8> cube_index_offsets_;
+  // Whether CPU coloring interpolates voxel colors.
+  bool color_interpolation_trilinear_ = false;
+
+  // The maximum number of threads used for CPU coloring. 0 uses the pool.
+  int num_color_threads_ = 0;
+
+  // The pool running the CPU meshing and coloring.
+  std::shared_ptr<ThreadPool> thread_pool_ = ThreadPool::getDefault();
 
   // The color that the mesh takes if no coloring is available.
   Color default_mesh_color_ = Color::Gray();
@@ -130,8 +186,8 @@ class MeshIntegrator {
 
   // These are temporary variables so we don't have to allocate every single
   // frame.
-  host_vector<const VoxelBlock<TsdfVoxel>*> block_ptrs_host_;
-  device_vector<const VoxelBlock<TsdfVoxel>*> block_ptrs_device_;
+  BlockPtrBuffers<TsdfBlock> tsdf_block_ptrs_;
+  BlockPtrBuffers<CompactTsdfBlock> compact_tsdf_block_ptrs_;
   host_vector<bool> meshable_host_;
   device_vector<bool> meshable_device_;
   host_vector<Vector3f> block_positions_host_;
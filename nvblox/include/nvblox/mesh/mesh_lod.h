@@ -0,0 +1,143 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nvblox/core/parameter_tree.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/mesh/mesh_simplifier.h"
+
+namespace nvblox {
+
+/// @brief Simplified levels of detail (LODs) of a mesh layer.
+///
+/// LOD 0 is the full resolution mesh layer, which is owned by the caller.
+/// LODs 1 to num_lods() - 1 are simplified copies of it, each generated from
+/// the previous level with a doubled maximum error and lod_triangle_ratio of
+/// its triangles. Blocks are simplified independently with their borders
+/// preserved, so blocks of different LODs can be mixed in one mesh.
+///
+/// The LODs are not updated automatically: call updateBlocks() with the
+/// blocks that changed in the mesh layer, ie. after mesh integration.
+class MeshLodLayers {
+ public:
+  // Parameter defaults
+  static constexpr int kDefaultNumLods = 3;
+  static constexpr float kDefaultLodDistanceM = 4.0f;
+  static constexpr float kDefaultLod1MaxErrorM = 0.01f;
+  static constexpr float kDefaultLodTriangleRatio = 0.25f;
+
+  MeshLodLayers() = delete;
+  /// @brief Constructor
+  /// @param block_size The size of the mesh blocks in meters.
+  /// @param memory_type Where the simplified blocks are stored.
+  /// @param num_lods The number of LODs, including the full resolution.
+  MeshLodLayers(float block_size, MemoryType memory_type = MemoryType::kDevice,
+                int num_lods = kDefaultNumLods);
+  ~MeshLodLayers() = default;
+
+  /// @brief Regenerates the simplified LODs of blocks.
+  /// @param mesh_layer The full resolution mesh layer.
+  /// @param block_indices The blocks which changed. Blocks which are no longer
+  /// in the mesh layer are removed from all LODs.
+  void updateBlocks(const MeshLayer& mesh_layer,
+                    const std::vector<Index3D>& block_indices);
+
+  /// @return The number of LODs, including the full resolution.
+  int num_lods() const { return static_cast<int>(lod_layers_.size()) + 1; }
+
+  /// @param lod The level, between 1 and num_lods() - 1.
+  /// @return The simplified mesh layer of a level.
+  const MeshLayer& getLodLayer(int lod) const;
+
+  /// @brief Returns a block at a level of detail. Falls back to finer levels
+  /// if the level doesn't contain the block (yet).
+  /// @param mesh_layer The full resolution mesh layer (LOD 0).
+  /// @param block_index The index of the block.
+  /// @param lod The requested level.
+  /// @return The block, or nullptr if it's not in the mesh layer.
+  MeshBlock::ConstPtr getBlockAtLod(const MeshLayer& mesh_layer,
+                                    const Index3D& block_index, int lod) const;
+
+  /// @brief Selects the LOD at which to show a block at a distance.
+  /// Blocks closer than lod_distance_m are shown at full resolution. Each
+  /// coarser level covers twice the distance of the previous one.
+  /// @param distance_m The distance from the viewer to the block.
+  /// @return The LOD.
+  int selectLodForDistance(float distance_m) const;
+
+  /// @brief Copies blocks, each at its own LOD, into an output layer.
+  /// @param mesh_layer The full resolution mesh layer (LOD 0).
+  /// @param block_indices The blocks to copy.
+  /// @param lods The LOD of each block.
+  /// @param output The layer receiving the blocks. Cleared first.
+  void assembleMixedLodLayer(const MeshLayer& mesh_layer,
+                             const std::vector<Index3D>& block_indices,
+                             const std::vector<int>& lods,
+                             MeshLayer* output) const;
+
+  /// A parameter getter
+  /// The distance from which blocks are shown at LOD 1.
+  /// @returns the LOD distance in meters
+  float lod_distance_m() const;
+
+  /// A parameter getter
+  /// The maximum simplification error of LOD 1. Doubles with each level.
+  /// @returns the max error in meters
+  float lod1_max_error_m() const;
+
+  /// A parameter getter
+  /// The fraction of the triangles of the previous LOD kept by each level, at
+  /// most.
+  /// @returns the triangle ratio
+  float lod_triangle_ratio() const;
+
+  /// A parameter setter
+  /// See lod_distance_m().
+  /// @param lod_distance_m the LOD distance in meters.
+  void lod_distance_m(float lod_distance_m);
+
+  /// A parameter setter
+  /// See lod1_max_error_m(). Applies to blocks updated afterwards.
+  /// @param lod1_max_error_m the max error in meters.
+  void lod1_max_error_m(float lod1_max_error_m);
+
+  /// A parameter setter
+  /// See lod_triangle_ratio(). Applies to blocks updated afterwards.
+  /// @param lod_triangle_ratio the triangle ratio in [0, 1].
+  void lod_triangle_ratio(float lod_triangle_ratio);
+
+  /// Return the parameter tree.
+  /// @return the parameter tree
+  parameters::ParameterTreeNode getParameterTree(
+      const std::string& name_remap = std::string()) const;
+
+ private:
+  // The simplified layers of LODs 1 to num_lods() - 1.
+  std::vector<std::unique_ptr<MeshLayer>> lod_layers_;
+
+  MeshSimplifier simplifier_;
+
+  // Params
+  float lod_distance_m_ = kDefaultLodDistanceM;
+  float lod1_max_error_m_ = kDefaultLod1MaxErrorM;
+  float lod_triangle_ratio_ = kDefaultLodTriangleRatio;
+};
+
+}  // namespace nvblox
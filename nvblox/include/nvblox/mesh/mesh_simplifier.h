@@ -0,0 +1,110 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "nvblox/core/parameter_tree.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/mesh/mesh_block.h"
+
+namespace nvblox {
+
+/// @brief Reduces the number of triangles of mesh blocks by quadric error
+/// edge collapse.
+///
+/// Each block is simplified independently. Vertices on the open border of a
+/// block's mesh are never moved or removed, such that simplified blocks still
+/// meet their (possibly differently simplified) neighbors without cracks.
+/// Edges are collapsed onto one of their vertices (half-edge collapse), so the
+/// remaining vertices keep their positions, normals and colors.
+///
+/// Collapses are applied cheapest first, until the block has the target
+/// fraction of its triangles or the next collapse would move the surface by
+/// more than the maximum error. Large flat areas, like walls and floors,
+/// therefore reduce to a few triangles, while curved surfaces keep their
+/// detail.
+class MeshSimplifier {
+ public:
+  // Parameter defaults
+  static constexpr float kDefaultMaxErrorM = 0.01f;
+  static constexpr float kDefaultTargetTriangleRatio = 0.25f;
+  static constexpr float kDefaultMinNormalCosine = 0.2f;
+
+  MeshSimplifier() = default;
+  ~MeshSimplifier() = default;
+
+  /// @brief Simplifies a single mesh block.
+  /// @param input The block to simplify. May live in any memory.
+  /// @param output The simplified block. Keeps its memory type.
+  void simplifyBlock(const MeshBlock& input, MeshBlock* output) const;
+
+  /// @brief Simplifies blocks of a mesh layer into another layer.
+  /// @param input The mesh layer to simplify.
+  /// @param block_indices The blocks to simplify. Blocks which are not
+  /// allocated (or are empty) in the input are cleared in the output.
+  /// @param output The layer receiving the simplified blocks.
+  void simplifyBlocks(const MeshLayer& input,
+                      const std::vector<Index3D>& block_indices,
+                      MeshLayer* output) const;
+
+  /// A parameter getter
+  /// The maximum error of a collapse, in meters. The error of a collapse is
+  /// the root of the summed squared distances of the new vertex position to
+  /// the planes of the original triangles around the collapsed edge.
+  /// @returns the max error in meters
+  float max_error_m() const;
+
+  /// A parameter getter
+  /// The fraction of the triangles of a block at which simplification stops.
+  /// @returns the target triangle ratio
+  float target_triangle_ratio() const;
+
+  /// A parameter getter
+  /// Collapses which rotate a triangle's normal such that the cosine between
+  /// the old and new normal drops below this value are rejected. Prevents fold
+  /// overs.
+  /// @returns the min normal cosine
+  float min_normal_cosine() const;
+
+  /// A parameter setter
+  /// See max_error_m().
+  /// @param max_error_m the max error in meters.
+  void max_error_m(float max_error_m);
+
+  /// A parameter setter
+  /// See target_triangle_ratio().
+  /// @param target_triangle_ratio the target triangle ratio in [0, 1].
+  void target_triangle_ratio(float target_triangle_ratio);
+
+  /// A parameter setter
+  /// See min_normal_cosine().
+  /// @param min_normal_cosine the min normal cosine.
+  void min_normal_cosine(float min_normal_cosine);
+
+  /// Return the parameter tree.
+  /// @return the parameter tree
+  parameters::ParameterTreeNode getParameterTree(
+      const std::string& name_remap = std::string()) const;
+
+ private:
+  float max_error_m_ = kDefaultMaxErrorM;
+  float target_triangle_ratio_ = kDefaultTargetTriangleRatio;
+  float min_normal_cosine_ = kDefaultMinNormalCosine;
+};
+
+}  // namespace nvblox
@@ -22,6 +22,7 @@ limitations under the License.
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/core/types.h"
 #include "nvblox/map/common_names.h"
+#include "nvblox/mesh/internal/block_priority_queue.h"
 #include "nvblox/mesh/mesh_block.h"
 #include "nvblox/serialization/mesh_serializer_gpu.h"
 
@@ -32,6 +33,10 @@ namespace nvblox {
 /// Note that this class is an abstract base class. Child classes have to
 /// implement the compute priority function, which determines *which* blocks are
 /// streamed when the number of potential blocks exceeds the requested limit.
+///
+/// Candidates are kept in a priority queue which is updated incrementally as
+/// blocks are marked, such that selecting k blocks for streaming costs
+/// O(k log n) rather than sorting all n candidates on each call.
 class MeshStreamerBase {
  public:
   /// @brief Constructor
@@ -40,8 +45,12 @@ class MeshStreamerBase {
 
   /// @brief Marks these block indices as candidates for streaming (usually
   /// because they have been touched by the reconstruction process).
+  ///
+  /// The priorities of the blocks are computed here. Marking a block which is
+  /// already a candidate updates its priority.
   /// @param mesh_block_indices The indices of the candidate mesh blocks
-  void markIndicesCandidates(const std::vector<Index3D>& mesh_block_indices);
+  virtual void markIndicesCandidates(
+      const std::vector<Index3D>& mesh_block_indices);
 
   /// @brief Returns N highest-priority mesh blocks.
   ///
@@ -84,19 +93,30 @@ class MeshStreamerBase {
   // A function which tell the class whether to exclude a block from streaming
   using ExcludeBlockFunctor = std::function<bool(const Index3D&)>;
 
-  // Sets the exclusion functions being used.
+  // Sets the exclusion functions being used. Excluded blocks are dropped from
+  // the candidates when they come up for streaming, or when the candidates
+  // are pruned with removeExcludedCandidates().
   void setExclusionFunctors(
       std::vector<ExcludeBlockFunctor> exclude_block_functors);
 
  protected:
-  // The function which determines a block's priority to be streamed.
+  // The function which determines a block's priority to be streamed. It is
+  // called when blocks are marked as candidates, so a block's priority must
+  // not change while it is a candidate.
   virtual std::vector<float> computePriorities(
       const std::vector<Index3D>& mesh_block_indices) const = 0;
 
-  // Modifies the list of blocks eligible to be streamed in order to remove some
-  // blocks before priorities are computed. Internally this function calls the
-  // exclusion functors on each block.
-  void excludeBlocks(std::vector<Index3D>* mesh_block_indices) const;
+  // Recomputes the priorities of all candidates. Child classes call this when
+  // the inputs to their priority function change. O(n log n).
+  void recomputeCandidatePriorities();
+
+  // Returns true if any of the exclusion functors fire for this block.
+  bool isBlockExcluded(const Index3D& mesh_block_index) const;
+
+  // Drops all candidates which are excluded by the current exclusion functors.
+  // Child classes call this when the excluded region changes, such that
+  // excluded blocks don't pile up below the top of the queue. O(n log n).
+  void removeExcludedCandidates();
 
   // This struct which indicates whether a block should be streamed
   struct StreamStatus {
@@ -123,9 +143,9 @@ class MeshStreamerBase {
   std::vector<Index3D> getHighestPriorityMeshBlocks(
       StreamStatusFunctor get_stream_status);
 
-  // This set tracks the mesh blocks which are candidates for streaming but have
-  // not yet been streamed.
-  Index3DSet mesh_index_set_;
+  // This queue tracks the mesh blocks which are candidates for streaming but
+  // have not yet been streamed, ordered by priority.
+  BlockPriorityQueue mesh_block_queue_;
 
   // Handles serialization of the mesh
   MeshSerializerGpu serializer_;
@@ -223,6 +243,17 @@ class MeshStreamerOldestBlocks : public MeshStreamerBase {
   float exclusion_height_m_ = kDefaultExclusionHeightM;
   float exclusion_radius_m_ = kDefaultExclusionRadiusM;
 
+  // The exclusion settings the candidates were last pruned with. The
+  // candidates are pruned again when the settings change, or when the
+  // exclusion center moves by more than a block.
+  struct ExclusionSettings {
+    float exclusion_height_m = kDefaultExclusionHeightM;
+    float exclusion_radius_m = kDefaultExclusionRadiusM;
+    std::optional<float> block_size;
+    std::optional<Vector3f> exclusion_center_m;
+  };
+  std::optional<ExclusionSettings> last_pruned_exclusion_settings_;
+
   // The counts up with each call to getNMeshBlocks(). It is used to indicate
   // the "when" blocks are returned for streaming.
   int64_t publishing_index_ = 0;
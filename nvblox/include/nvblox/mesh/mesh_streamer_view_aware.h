@@ -0,0 +1,347 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "nvblox/mesh/mesh_lod.h"
+#include "nvblox/mesh/mesh_streamer.h"
+#include "nvblox/sensors/camera.h"
+
+namespace nvblox {
+
+/// A pose from which a streamed mesh is viewed, for example the camera of an
+/// operator's visualization.
+struct MeshStreamingViewer {
+  /// The pose of the viewer in the layer frame.
+  Transform T_L_C = Transform::Identity();
+  /// The camera of the viewer. If set, blocks inside its view frustum are
+  /// prioritized.
+  std::optional<Camera> camera;
+  /// The far plane of the view frustum.
+  float max_view_distance_m = 10.0f;
+};
+
+/// @brief A MeshStreamerBase policy which prioritizes mesh blocks close to
+/// and in view of one or more viewers.
+///
+/// The priority of a block is
+///   - distance_weight * (distance to the closest viewer in meters)
+///   + in_view_priority (if inside the frustum of a viewer with a camera)
+///   + staleness_weight * (streaming calls since the block was last streamed)
+/// Blocks which were never streamed count as last streamed before the first
+/// call. Without viewers this reduces to streaming the oldest blocks first.
+///
+/// Priorities are recomputed for all candidates only when the viewers moved
+/// by more than the reprioritization thresholds, such that small viewer
+/// motions keep the incremental cost of streaming.
+///
+/// Given MeshLodLayers, blocks are streamed at a level of detail selected by
+/// their distance to the closest viewer, and at coarser levels when the full
+/// level doesn't fit the remaining byte budget. Blocks streamed coarser than
+/// their distance asks for stay candidates, and are streamed again once a
+/// finer level fits.
+class MeshStreamerViewAware : public MeshStreamerBase {
+ public:
+  // Parameter defaults
+  static constexpr float kDefaultDistanceWeight = 1.0f;
+  static constexpr float kDefaultInViewPriority = 10.0f;
+  static constexpr float kDefaultStalenessWeight = 0.1f;
+  static constexpr float kDefaultReprioritizationDistanceM = 0.5f;
+  static constexpr float kDefaultReprioritizationAngleRad = 0.17f;
+
+  MeshStreamerViewAware() = delete;
+  /// @brief Constructor
+  /// @param block_size The size of the mesh blocks in meters.
+  MeshStreamerViewAware(float block_size);
+  virtual ~MeshStreamerViewAware() = default;
+
+  /// @brief Marks these block indices as candidates for streaming. See
+  /// MeshStreamerBase::markIndicesCandidates().
+  /// @param mesh_block_indices The indices of the candidate mesh blocks
+  void markIndicesCandidates(
+      const std::vector<Index3D>& mesh_block_indices) override;
+
+  /// @brief Stops tracking deleted mesh blocks.
+  /// @param mesh_block_indices The indices of the deleted mesh blocks.
+  void removeBlocks(const std::vector<Index3D>& mesh_block_indices);
+
+  /// @brief Sets the poses from which the mesh is viewed.
+  /// @param viewers The viewers. May be empty.
+  void setViewers(const std::vector<MeshStreamingViewer>& viewers);
+
+  /// @brief Returns N highest priority blocks for streaming
+  /// @param num_mesh_block The number of mesh blocks you want.
+  /// @return The list of mesh block indices.
+  std::vector<Index3D> getNMeshBlocks(const int num_mesh_blocks);
+
+  /// @brief Return N bytes of highest priority blocks for streaming
+  /// @param num_bytes The number of bytes of mesh blocks to stream
+  /// @param mesh_layer The mesh layer which will be streamed.
+  /// @return The list of mesh block indices.
+  std::vector<Index3D> getNBytesOfMeshBlocks(const size_t num_bytes,
+                                             const MeshLayer& mesh_layer);
+
+  /// @brief Returns highest priority serialized mesh blocks up to N bytes
+  /// @param num_bytes The maximum number of bytes returned
+  /// @param mesh_layer Mesh layer to serialize
+  /// @param cuda_stream Cuda stream.
+  /// @return Serialized mesh containing highest priority mesh blocks
+  const std::shared_ptr<const SerializedMesh> getNBytesOfSerializedMeshBlocks(
+      const size_t num_bytes, const MeshLayer& mesh_layer,
+      const CudaStream cuda_stream);
+
+  /// @brief Return N bytes of highest priority blocks for streaming, each at
+  /// a level of detail selected by its distance to the closest viewer.
+  /// @param num_bytes The number of bytes of mesh blocks to stream
+  /// @param mesh_layer The full resolution mesh layer.
+  /// @param lods The levels of detail of the mesh layer.
+  /// @param block_lods Output of the level of detail of each returned block.
+  /// @return The list of mesh block indices.
+  std::vector<Index3D> getNBytesOfMeshBlocks(const size_t num_bytes,
+                                             const MeshLayer& mesh_layer,
+                                             const MeshLodLayers& lods,
+                                             std::vector<int>* block_lods);
+
+  /// @brief Returns highest priority serialized mesh blocks up to N bytes,
+  /// each at a level of detail selected by its distance to the closest viewer.
+  /// @param num_bytes The maximum number of bytes returned
+  /// @param mesh_layer The full resolution mesh layer.
+  /// @param lods The levels of detail of the mesh layer.
+  /// @param cuda_stream Cuda stream.
+  /// @return Serialized mesh containing highest priority mesh blocks
+  const std::shared_ptr<const SerializedMesh> getNBytesOfSerializedMeshBlocks(
+      const size_t num_bytes, const MeshLayer& mesh_layer,
+      const MeshLodLayers& lods, const CudaStream cuda_stream);
+
+  /// @return The number of candidates which were streamed at a coarser level
+  /// of detail than their distance asks for.
+  int numPendingRefinements() const {
+    return static_cast<int>(coarse_streamed_lods_.size());
+  }
+
+  /// Computes the priority of a block given the current viewers.
+  float computePriority(const Index3D& mesh_block_index) const;
+
+  /// @return The number of times the candidate priorities were recomputed
+  /// because the viewers moved.
+  int num_reprioritizations() const { return num_reprioritizations_; }
+
+  /// Getters
+  float block_size() const { return block_size_; }
+  float distance_weight() const;
+  float in_view_priority() const;
+  float staleness_weight() const;
+  float reprioritization_distance_m() const;
+  float reprioritization_angle_rad() const;
+
+  /// Setters. Changing the weights recomputes the candidate priorities.
+  void distance_weight(float distance_weight);
+  void in_view_priority(float in_view_priority);
+  void staleness_weight(float staleness_weight);
+  void reprioritization_distance_m(float reprioritization_distance_m);
+  void reprioritization_angle_rad(float reprioritization_angle_rad);
+
+  /// Return the parameter tree.
+  /// @return the parameter tree
+  virtual parameters::ParameterTreeNode getParameterTree(
+      const std::string& name_remap = std::string()) const;
+
+ protected:
+  virtual std::vector<float> computePriorities(
+      const std::vector<Index3D>& mesh_block_indices) const override;
+
+  // The distance from a point to the closest viewer. Infinite without viewers.
+  float distanceToClosestViewer(const Vector3f& position) const;
+
+  // True if the viewers moved far enough to require reprioritization.
+  bool viewersMovedSignificantly(
+      const std::vector<MeshStreamingViewer>& viewers) const;
+
+  // Called before blocks are returned to requester. Marks blocks as having been
+  // streamed.
+  void updateBlocksLastPublishIndex(
+      const std::vector<Index3D>& mesh_block_indices);
+
+  const float block_size_;
+
+  // Params
+  float distance_weight_ = kDefaultDistanceWeight;
+  float in_view_priority_ = kDefaultInViewPriority;
+  float staleness_weight_ = kDefaultStalenessWeight;
+  float reprioritization_distance_m_ = kDefaultReprioritizationDistanceM;
+  float reprioritization_angle_rad_ = kDefaultReprioritizationAngleRad;
+
+  // The viewers (and their frustums) with which the candidate priorities were
+  // computed.
+  std::vector<MeshStreamingViewer> viewers_;
+  std::vector<Frustum> viewer_frustums_;
+  int num_reprioritizations_ = 0;
+
+  // The counts up with each streaming call.
+  int64_t publishing_index_ = 0;
+
+  // When each mesh block was last streamed.
+  Index3DHashMapType<int64_t>::type last_published_map_;
+
+  // Blocks streamed at a coarser level of detail than their distance asks
+  // for, and that level.
+  Index3DHashMapType<int>::type coarse_streamed_lods_;
+
+  // The streamed blocks, each at its level of detail.
+  std::unique_ptr<MeshLayer> mixed_lod_layer_;
+};
+
+/// @brief Streams a mesh to several independent clients.
+///
+/// Each client has its own viewers, its own byte budget per streaming call
+/// and keeps track of the version of each block it was sent. Blocks get a new
+/// version each time they are marked as candidates (ie. re-meshed), and are
+/// streamed to a client until it has the latest version. Deleted blocks are
+/// reported to the clients which were sent a version of them.
+class MultiClientMeshStreamer {
+ public:
+  MultiClientMeshStreamer() = delete;
+  /// @brief Constructor
+  /// @param block_size The size of the mesh blocks in meters.
+  MultiClientMeshStreamer(float block_size);
+  ~MultiClientMeshStreamer() = default;
+
+  /// @brief Adds a client. All blocks marked so far are candidates for it.
+  /// @param client_id The name of the client.
+  /// @param num_bytes_per_call The byte budget of each streaming call.
+  void addClient(const std::string& client_id, size_t num_bytes_per_call);
+
+  /// Removes a client.
+  void removeClient(const std::string& client_id);
+
+  /// @return True if the client exists.
+  bool hasClient(const std::string& client_id) const;
+
+  /// @return The names of all clients.
+  std::vector<std::string> getClientIds() const;
+
+  /// Sets the byte budget of a client.
+  void setClientByteBudget(const std::string& client_id,
+                           size_t num_bytes_per_call);
+
+  /// @return The byte budget of a client.
+  size_t getClientByteBudget(const std::string& client_id) const;
+
+  /// Sets the viewers of a client. See MeshStreamerViewAware::setViewers().
+  void setClientViewers(const std::string& client_id,
+                        const std::vector<MeshStreamingViewer>& viewers);
+
+  /// The streamer of a client, ie. to change its priority weights.
+  MeshStreamerViewAware& clientStreamer(const std::string& client_id);
+  const MeshStreamerViewAware& clientStreamer(
+      const std::string& client_id) const;
+
+  /// @brief Marks these block indices as candidates for all clients, and
+  /// increments their version.
+  /// @param mesh_block_indices The indices of the updated mesh blocks.
+  void markIndicesCandidates(const std::vector<Index3D>& mesh_block_indices);
+
+  /// @brief Stops tracking deleted mesh blocks (ie. the blocks returned by
+  /// Mapper::getClearedMeshBlocks()), for all clients. See
+  /// getDeletedBlocksForClient().
+  /// @param mesh_block_indices The indices of the deleted mesh blocks.
+  void removeBlocks(const std::vector<Index3D>& mesh_block_indices);
+
+  /// @brief Returns the deleted blocks which were sent to a client, such that
+  /// the client can delete them as well. Each deletion is returned once.
+  /// @param client_id The client.
+  /// @return The list of deleted mesh block indices.
+  std::vector<Index3D> getDeletedBlocksForClient(const std::string& client_id);
+
+  /// @brief Returns the highest priority mesh blocks for a client, up to its
+  /// byte budget, and records them as sent.
+  /// @param client_id The client.
+  /// @param mesh_layer The mesh layer which will be streamed.
+  /// @return The list of mesh block indices.
+  std::vector<Index3D> getMeshBlocksForClient(const std::string& client_id,
+                                              const MeshLayer& mesh_layer);
+
+  /// @brief Returns the highest priority serialized mesh blocks for a client,
+  /// up to its byte budget, and records them as sent.
+  /// @param client_id The client.
+  /// @param mesh_layer Mesh layer to serialize
+  /// @param cuda_stream Cuda stream.
+  /// @return Serialized mesh containing highest priority mesh blocks
+  std::shared_ptr<const SerializedMesh> getSerializedMeshForClient(
+      const std::string& client_id, const MeshLayer& mesh_layer,
+      const CudaStream cuda_stream);
+
+  /// @brief Returns the highest priority serialized mesh blocks for a client,
+  /// up to its byte budget, each at a level of detail selected by the
+  /// distance to the client's viewers, and records them as sent.
+  /// @param client_id The client.
+  /// @param mesh_layer The full resolution mesh layer.
+  /// @param lods The levels of detail of the mesh layer.
+  /// @param cuda_stream Cuda stream.
+  /// @return Serialized mesh containing highest priority mesh blocks
+  std::shared_ptr<const SerializedMesh> getSerializedMeshForClient(
+      const std::string& client_id, const MeshLayer& mesh_layer,
+      const MeshLodLayers& lods, const CudaStream cuda_stream);
+
+  /// Forget what was sent to a client, such that all blocks are streamed to
+  /// it again (ie. after it reconnected).
+  void resetClient(const std::string& client_id);
+
+  /// @return The current version of a block. 0 if the block was never marked.
+  uint64_t getBlockVersion(const Index3D& mesh_block_index) const;
+
+  /// @return The version of a block last sent to a client. 0 if never sent.
+  uint64_t getSentBlockVersion(const std::string& client_id,
+                               const Index3D& mesh_block_index) const;
+
+  /// @return The number of blocks waiting to be streamed to a client.
+  int numCandidates(const std::string& client_id) const;
+
+  /// Removes all clients and block versions.
+  void clear();
+
+ private:
+  struct Client {
+    std::unique_ptr<MeshStreamerViewAware> streamer;
+    // Each client has its own serializer, such that the serialized meshes of
+    // different clients don't share buffers.
+    std::unique_ptr<MeshSerializerGpu> serializer;
+    // The blocks streamed to the client, each at its level of detail.
+    std::unique_ptr<MeshLayer> mixed_lod_layer;
+    size_t num_bytes_per_call;
+    Index3DHashMapType<uint64_t>::type sent_block_versions;
+    // Blocks which were sent to the client and deleted since.
+    Index3DSet deleted_blocks;
+  };
+
+  Client& getClient(const std::string& client_id);
+  const Client& getClient(const std::string& client_id) const;
+
+  // Records the current version of blocks as sent to a client.
+  void recordSentBlocks(const std::vector<Index3D>& mesh_block_indices,
+                        Client* client) const;
+
+  const float block_size_;
+  std::map<std::string, Client> clients_;
+  Index3DHashMapType<uint64_t>::type block_versions_;
+};
+
+}  // namespace nvblox
@@ -21,6 +21,7 @@ limitations under the License.
 #include "nvblox/core/indexing.h"
 #include "nvblox/core/iterator.h"
 #include "nvblox/core/log_odds.h"
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/parameter_tree.h"
 #include "nvblox/core/time.h"
 #include "nvblox/core/traits.h"
@@ -58,21 +59,33 @@ limitations under the License.
 #include "nvblox/io/ply_writer.h"
 #include "nvblox/io/pointcloud_io.h"
 #include "nvblox/map/accessors.h"
+#include "nvblox/map/block_distance_summary.h"
+#include "nvblox/map/block_pager.h"
 #include "nvblox/map/blocks_to_update_tracker.h"
 #include "nvblox/map/blox.h"
 #include "nvblox/map/common_names.h"
 #include "nvblox/map/layer.h"
 #include "nvblox/map/layer_cake.h"
+#include "nvblox/map/layer_to_3d_grid.h"
+#include "nvblox/map/multi_resolution_layer.h"
 #include "nvblox/map/unified_3d_grid.h"
 #include "nvblox/map/voxels.h"
 #include "nvblox/mapper/mapper.h"
 #include "nvblox/mapper/mapper_params.h"
+#include "nvblox/mapper/mapper_update_scheduler.h"
 #include "nvblox/mapper/multi_mapper.h"
+#include "nvblox/mapper/multi_resolution_updates.h"
+#include "nvblox/mapper/submap_manager.h"
 #include "nvblox/mesh/mesh.h"
 #include "nvblox/mesh/mesh_block.h"
 #include "nvblox/mesh/mesh_integrator.h"
+#include "nvblox/mesh/mesh_lod.h"
+#include "nvblox/mesh/mesh_simplifier.h"
 #include "nvblox/mesh/mesh_streamer.h"
+#include "nvblox/mesh/mesh_streamer_view_aware.h"
+#include "nvblox/primitives/primitive_bvh.h"
 #include "nvblox/primitives/primitives.h"
+#include "nvblox/primitives/scenario_generator.h"
 #include "nvblox/primitives/scene.h"
 #include "nvblox/rays/ray_caster.h"
 #include "nvblox/rays/sphere_tracer.h"
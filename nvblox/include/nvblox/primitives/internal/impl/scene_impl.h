@@ -75,23 +75,25 @@ inline void Scene::setVoxel(float value, FreespaceVoxel* voxel) const {
 
 template <>
 inline float Scene::getVoxelGroundTruthValue<TsdfVoxel>(
-    const Vector3f& position, float max_dist, float) const {
+    const PrimitiveBvh& bvh, const Vector3f& position, float max_dist,
+    float) const {
   // Iterate over all objects and get distances to this thing.
   // Only computes up to max_distance away from the voxel (to reduce amount
   // of ray casting).
-  float distance = getSignedDistanceToPoint(position, max_dist);
+  float distance = bvh.getSignedDistanceToPoint(position, max_dist);
   // Also truncate the distance *inside* the obstacle, which is not truncated
   // by the previous function.
   return std::max(distance, -max_dist);
 }
 
 template <typename VoxelType>
-inline float Scene::getVoxelGroundTruthValue(const Vector3f& position,
+inline float Scene::getVoxelGroundTruthValue(const PrimitiveBvh& bvh,
+                                             const Vector3f& position,
                                              float max_dist,
                                              float voxel_size) const {
   // This template function is used both for Freespace and Tsdf voxels.
   const float min_distance_to_object =
-      getSignedDistanceToPoint(position, max_dist);
+      bvh.getSignedDistanceToPoint(position, max_dist);
   const float voxel_body_diagonal = sqrt(3.0) * voxel_size;
   // Note: Using the body diagonal to check whether the object lies
   // inside the voxel is an approximation.
@@ -114,34 +116,48 @@ void Scene::generateLayerFromScene(float max_dist,
   const float block_size = layer->block_size();
   const float voxel_size = layer->voxel_size();
 
+  timing::Timer timer("scene/generate_layer");
+
   // First allocate all the blocks within the AABB.
   std::vector<Index3D> block_indices =
       getBlockIndicesTouchedByBoundingBox(block_size, aabb_);
 
+  std::vector<VoxelBlock<VoxelType>*> blocks;
+  blocks.reserve(block_indices.size());
   for (const Index3D& block_index : block_indices) {
-    layer->allocateBlockAtIndex(block_index);
+    blocks.push_back(layer->allocateBlockAtIndex(block_index).get());
   }
 
-  // Iterate over every voxel in the layer and compute its distance to all
-  // objects.
-  auto lambda = [&block_size, &max_dist, &voxel_size, this](
-                    const Index3D& block_index, const Index3D& voxel_index,
-                    VoxelType* voxel) {
-    const Vector3f position = getCenterPositionFromBlockIndexAndVoxelIndex(
-        block_size, block_index, voxel_index);
-
-    if (!aabb_.contains(position)) {
-      return;
+  // Build the hierarchy once, rather than checking it for every voxel.
+  const std::shared_ptr<const PrimitiveBvh> bvh = getBvh();
+
+  // Compute the distance of every voxel to all objects, one block per work
+  // item.
+  parallelFor(static_cast<int>(blocks.size()), [&](int i) {
+    constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+    Index3D voxel_index;
+    for (voxel_index.x() = 0; voxel_index.x() < kVoxelsPerSide;
+         voxel_index.x()++) {
+      for (voxel_index.y() = 0; voxel_index.y() < kVoxelsPerSide;
+           voxel_index.y()++) {
+        for (voxel_index.z() = 0; voxel_index.z() < kVoxelsPerSide;
+             voxel_index.z()++) {
+          const Vector3f position =
+              getCenterPositionFromBlockIndexAndVoxelIndex(
+                  block_size, block_indices[i], voxel_index);
+          if (!aabb_.contains(position)) {
+            continue;
+          }
+          // Get the ground truth value for this voxel and update it
+          const float gt_value = getVoxelGroundTruthValue<VoxelType>(
+              *bvh, position, max_dist, voxel_size);
+          setVoxel<VoxelType>(
+              gt_value, &blocks[i]->voxels[voxel_index.x()][voxel_index.y()]
+                                          [voxel_index.z()]);
+        }
+      }
     }
-
-    // Get the ground truth value for this voxel and update it
-    float gt_value =
-        getVoxelGroundTruthValue<VoxelType>(position, max_dist, voxel_size);
-    setVoxel<VoxelType>(gt_value, voxel);
-  };
-
-  // Call above lambda on every voxel in the layer.
-  callFunctionOnAllVoxels<VoxelType>(layer, lambda);
+  });
 }
 
 }  // namespace primitives
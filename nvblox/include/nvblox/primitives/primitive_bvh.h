@@ -0,0 +1,94 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "nvblox/core/types.h"
+#include "nvblox/primitives/primitives.h"
+
+namespace nvblox {
+namespace primitives {
+
+/// A bounding volume hierarchy over the bounded primitives of a scene.
+/// Unbounded primitives (planes) are kept in a list and always tested.
+///
+/// Ray and distance queries give the same results as testing every primitive,
+/// but only visit the primitives whose bounding boxes can improve the result.
+/// The hierarchy references the primitives, which must outlive it and must not
+/// be modified.
+class PrimitiveBvh {
+ public:
+  /// The maximum number of primitives in a leaf node.
+  static constexpr int kMaxPrimitivesPerLeaf = 4;
+
+  PrimitiveBvh() = default;
+  /// Builds the hierarchy, splitting nodes at the median primitive along the
+  /// longest axis.
+  /// @param primitives The primitives.
+  explicit PrimitiveBvh(
+      const std::vector<std::unique_ptr<Primitive>>& primitives);
+
+  /// Get the intersection of a ray with the first hit primitive.
+  /// See Scene::getRayIntersection().
+  bool getRayIntersection(const Vector3f& ray_origin,
+                          const Vector3f& ray_direction, float max_dist,
+                          Vector3f* ray_intersection, float* ray_dist) const;
+
+  /// Computes the distance to the closest primitive, up to max_dist.
+  /// See Scene::getSignedDistanceToPoint().
+  float getSignedDistanceToPoint(const Vector3f& coords, float max_dist) const;
+
+  /// The number of nodes in the hierarchy.
+  int num_nodes() const { return static_cast<int>(nodes_.size()); }
+  /// The number of primitives in the hierarchy.
+  int num_bounded_primitives() const {
+    return static_cast<int>(bounded_primitives_.size());
+  }
+  /// The number of primitives tested for every query.
+  int num_unbounded_primitives() const {
+    return static_cast<int>(unbounded_primitives_.size());
+  }
+
+ private:
+  struct Node {
+    AxisAlignedBoundingBox aabb;
+    // Leaves: the range of primitives. Inner nodes: count is zero, the left
+    // child directly follows the node and first is the right child.
+    int first = 0;
+    int count = 0;
+  };
+
+  struct BuildPrimitive {
+    AxisAlignedBoundingBox aabb;
+    Vector3f centroid;
+    const Primitive* primitive;
+  };
+
+  // Builds the subtree over build_primitives[begin, end), appending its
+  // primitives to bounded_primitives_, and returns the index of its root.
+  int buildNode(int begin, int end,
+                std::vector<BuildPrimitive>* build_primitives);
+
+  std::vector<Node> nodes_;
+  // Ordered such that the primitives of each leaf are contiguous.
+  std::vector<const Primitive*> bounded_primitives_;
+  std::vector<const Primitive*> unbounded_primitives_;
+};
+
+}  // namespace primitives
+}  // namespace nvblox
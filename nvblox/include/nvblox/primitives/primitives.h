@@ -78,6 +78,11 @@ class Primitive {
                                   Vector3f* intersect_point,
                                   float* intersect_dist) const = 0;
 
+  /// Bounding box of the primitive, used for acceleration structures.
+  /// @param aabb The bounding box, if the primitive is bounded.
+  /// @return False if the primitive is unbounded (ie. planes).
+  virtual bool getAABB(AxisAlignedBoundingBox* aabb) const { return false; }
+
  protected:
   Vector3f center_;
   Type type_;
@@ -99,6 +104,8 @@ class Sphere : public Primitive {
                                   Vector3f* intersect_point,
                                   float* intersect_dist) const override;
 
+  virtual bool getAABB(AxisAlignedBoundingBox* aabb) const override;
+
  protected:
   float radius_;
 };
@@ -118,6 +125,8 @@ class Cube : public Primitive {
                                   Vector3f* intersect_point,
                                   float* intersect_dist) const override;
 
+  virtual bool getAABB(AxisAlignedBoundingBox* aabb) const override;
+
  protected:
   Vector3f size_;
 };
@@ -164,6 +173,8 @@ class Cylinder : public Primitive {
                                   Vector3f* intersect_point,
                                   float* intersect_dist) const override;
 
+  virtual bool getAABB(AxisAlignedBoundingBox* aabb) const override;
+
  protected:
   float radius_;
   float height_;
@@ -0,0 +1,112 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nvblox/core/time.h"
+#include "nvblox/core/types.h"
+#include "nvblox/primitives/scene.h"
+
+namespace nvblox {
+namespace primitives {
+
+/// The kinds of procedural worlds.
+enum class ScenarioType {
+  /// Rows of shelving racks stocked with boxes, under a ceiling. Driven
+  /// through aisle by aisle.
+  kWarehouse,
+  /// A grid of city blocks with buildings, street lamps, trees and parked
+  /// cars. Driven through street by street.
+  kCityBlocks
+};
+
+}  // namespace primitives
+
+template <>
+inline std::string toString(const primitives::ScenarioType& type) {
+  switch (type) {
+    case primitives::ScenarioType::kWarehouse:
+      return "kWarehouse";
+    case primitives::ScenarioType::kCityBlocks:
+      return "kCityBlocks";
+    default:
+      LOG(FATAL) << "Not implemented";
+      return "";
+  }
+}
+
+namespace primitives {
+
+/// Parameters of a generated scenario. The world grows with the number of
+/// cells (aisles or city blocks) and the trajectory with the world and the
+/// number of laps.
+struct ScenarioParams {
+  ScenarioType type = ScenarioType::kWarehouse;
+  /// The number of cells along x and y.
+  int num_cells_x = 4;
+  int num_cells_y = 4;
+  /// The speed of the sensor along the trajectory.
+  float sensor_speed_mps = 1.5f;
+  /// The time between frames.
+  float frame_period_s = 0.1f;
+  /// The number of traversals of the path. Laps alternate direction, such
+  /// that each lap revisits the previous one.
+  int num_laps = 1;
+  /// Seed of the (deterministic) random layout.
+  uint32_t seed = 0;
+};
+
+/// A procedural world together with a scripted sensor trajectory.
+struct Scenario {
+  Scene scene;
+  /// Poses of the sensor body (x forward, z up) in the scene frame.
+  std::vector<Transform> T_S_B;
+  /// The time of each pose.
+  std::vector<Time> timestamps_ms;
+  /// A sensor range suitable for the world.
+  float max_range_m = 0.0f;
+
+  /// The number of frames of the trajectory.
+  int num_frames() const { return static_cast<int>(T_S_B.size()); }
+
+  /// The pose of a camera (z forward, y down) looking ahead.
+  /// @param frame_idx The frame.
+  Transform getCameraPose(int frame_idx) const;
+
+  /// The pose of a lidar (z up) mounted on the body.
+  /// @param frame_idx The frame.
+  Transform getLidarPose(int frame_idx) const;
+};
+
+/// Creates the world and trajectory described by the parameters.
+/// @param params The scenario parameters.
+/// @return The scenario.
+Scenario createScenario(const ScenarioParams& params);
+
+/// Samples poses at constant speed along a path through waypoints. The body
+/// faces along the path.
+/// @param waypoints The path, in the xy plane.
+/// @param height The height of the sensor above the ground.
+/// @param params Speed, frame rate and number of laps.
+/// @param scenario The scenario to which the poses and timestamps are added.
+void sampleTrajectory(const std::vector<Vector2f>& waypoints, float height,
+                      const ScenarioParams& params, Scenario* scenario);
+
+}  // namespace primitives
+}  // namespace nvblox
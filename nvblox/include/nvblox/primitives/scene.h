@@ -44,20 +44,33 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include "nvblox/map/blox.h"
 #include "nvblox/map/layer.h"
+#include "nvblox/primitives/primitive_bvh.h"
 #include "nvblox/primitives/primitives.h"
 #include "nvblox/sensors/camera.h"
 #include "nvblox/sensors/image.h"
+#include "nvblox/sensors/lidar.h"
 
 namespace nvblox {
 namespace primitives {
 
+/// A scene of primitives, used to generate synthetic sensor data and ground
+/// truth maps.
+///
+/// Queries go through a bounding volume hierarchy over the primitives, which
+/// is (re)built on the first query after the scene changed. Rendering and
+/// ground truth generation are spread over num_threads() threads.
 class Scene {
  public:
+  static constexpr int kDefaultNumThreads = 0;
+  /// The side length, in pixels, of the image tiles rendered by a thread.
+  static constexpr int kRenderTileSize = 32;
+
   Scene();
 
   /// Create an environment by adding primitives, which are then owned by the
@@ -85,6 +98,12 @@ class Scene {
                                    float max_dist,
                                    DepthImage* depth_frame) const;
 
+  /// Generates a synthetic lidar scan. Pixels contain the range to the first
+  /// hit object, or 0.0 if there is none within max_dist.
+  void generateDepthImageFromScene(const Lidar& lidar, const Transform& T_S_C,
+                                   float max_dist,
+                                   DepthImage* depth_frame) const;
+
   /// Computes the ground truth SDFs (either TSDF or ESDF depending on template
   /// parameter).
   template <typename VoxelType>
@@ -104,12 +123,45 @@ class Scene {
   const AxisAlignedBoundingBox& aabb() const { return aabb_; }
   AxisAlignedBoundingBox& aabb() { return aabb_; }
 
+  /// A parameter getter
+  /// The maximum number of threads used for rendering and ground truth
+  /// generation. Zero or less uses the whole default ThreadPool.
+  /// @returns the number of threads
+  int num_threads() const { return num_threads_; }
+
+  /// A parameter setter
+  /// See num_threads().
+  /// @param num_threads the number of threads.
+  void num_threads(int num_threads) { num_threads_ = num_threads; }
+
  protected:
+  /// The hierarchy over the current primitives. Built if needed.
+  std::shared_ptr<const PrimitiveBvh> getBvh() const;
+
+  /// Must be called whenever primitives_ change.
+  void invalidateBvh();
+
+  /// Runs function(i) for i in [0, num_items), spread over num_threads()
+  /// threads.
+  void parallelFor(int num_items,
+                   const std::function<void(int)>& function) const;
+
+  /// Renders a depth image in tiles, in parallel.
+  /// @param get_ray_direction_C Returns the normalized ray through a pixel.
+  /// @param get_depth Returns the depth of a pixel given the intersection of
+  /// its ray with the scene, in the sensor frame.
+  void renderDepthImage(
+      const Transform& T_S_C, float max_dist,
+      const std::function<Vector3f(const Index2D&)>& get_ray_direction_C,
+      const std::function<float(const Vector3f&)>& get_depth,
+      DepthImage* depth_frame) const;
+
   template <typename VoxelType>
   inline void setVoxel(float value, VoxelType* voxel) const;
 
   template <typename VoxelType>
-  inline float getVoxelGroundTruthValue(const Vector3f& coords, float max_dist,
+  inline float getVoxelGroundTruthValue(const PrimitiveBvh& bvh,
+                                        const Vector3f& coords, float max_dist,
                                         float voxel_size = 0) const;
 
   /// Vector storing pointers to all the objects in this world.
@@ -118,6 +170,12 @@ class Scene {
   /// World boundaries... Can be changed arbitrarily, just sets ground truth
   /// generation and visualization bounds, accurate only up to block size.
   AxisAlignedBoundingBox aabb_;
+
+  /// Built lazily by getBvh(), which may be called from several threads.
+  /// Only accessed through std::atomic_load/store.
+  mutable std::shared_ptr<const PrimitiveBvh> bvh_;
+
+  int num_threads_ = kDefaultNumThreads;
 };
 
 }  // namespace primitives
@@ -154,6 +154,53 @@ class SphereTracer {
                             const MemoryType output_image_memory_type,
                             const int ray_subsampling_factor = 1);
 
+  /// Render a depth image on the CPU
+  /// Rendering occurs by sphere tracing the passed TsdfLayer, which has to be
+  /// accessible from the host (MemoryType::kHost or kUnified). The image is
+  /// traced in tiles of kCpuPacketSize x kCpuPacketSize rays, which are
+  /// distributed over num_cpu_threads() threads. This allocates (in host
+  /// memory) if the passed output image does not have the right size.
+  /// @param camera A the camera (intrinsics) model.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param tsdf_layer The tsdf layer to be sphere traced.
+  /// @param truncation_distance_m The (metric) truncation distance used during
+  /// the construction of tsdf_layer.
+  /// @param depth_ptr A pointer to the output image.
+  /// @param ray_subsampling_factor The subsampling rate applied to the number
+  /// of traced rays. See renderImageOnGPU().
+  void renderImageOnCPU(const Camera& camera, const Transform& T_L_C,
+                        const TsdfLayer& tsdf_layer,
+                        const float truncation_distance_m,
+                        DepthImage* depth_ptr,
+                        const int ray_subsampling_factor = 1);
+
+  /// Render a depth and color image on the CPU
+  /// See renderImageOnCPU(). Colors are decided by looking up the Color voxel
+  /// corresponding to ray depth. The color layer has to be accessible from
+  /// the host.
+  /// @param camera A the camera (intrinsics) model.
+  /// @param T_L_C The pose of the camera. Supplied as a Transform mapping
+  /// points in the camera frame (C) to the layer frame (L).
+  /// @param tsdf_layer The tsdf layer to be sphere traced.
+  /// @param color_layer The color layer to look up the color from.
+  /// @param truncation_distance_m The (metric) truncation distance used during
+  /// the construction of tsdf_layer.
+  /// @param depth_ptr Pointer to the output depth image.
+  /// @param color_ptr Pointer to the output color image.
+  /// @param ray_subsampling_factor The subsampling rate applied to the number
+  /// of traced rays. See renderImageOnGPU().
+  void renderRgbdImageOnCPU(const Camera& camera, const Transform& T_L_C,
+                            const TsdfLayer& tsdf_layer,
+                            const ColorLayer& color_layer,
+                            const float truncation_distance_m,
+                            DepthImage* depth_ptr, ColorImage* color_ptr,
+                            const int ray_subsampling_factor = 1);
+
+  /// The side length, in rays, of the square packets traced together on the
+  /// CPU.
+  static constexpr int kCpuPacketSize = 8;
+
   /// Returns the size of a (possibly subsampled) sphere traced image.
   /// @param camera The intrinsics of the viewing camera.
   /// @param subsampling_factor The subsampling rate applied to the number of
@@ -179,6 +226,12 @@ class SphereTracer {
   /// @returns the distance to the surface.
   float surface_distance_epsilon_vox() const;
 
+  /// A parameter getter.
+  /// The maximum number of threads used for rendering on the CPU. 0 uses the
+  /// whole default ThreadPool.
+  /// @returns the number of threads
+  int num_cpu_threads() const;
+
   /// A parameter setter.
   /// See maximum_steps().
   /// @param maximum_steps the maximum number of steps along the ray.
@@ -194,6 +247,11 @@ class SphereTracer {
   /// @param surface_distance_epsilon_vox the distance to the surface.
   void surface_distance_epsilon_vox(float surface_distance_epsilon_vox);
 
+  /// A parameter setter.
+  /// See num_cpu_threads().
+  /// @param num_cpu_threads the number of threads.
+  void num_cpu_threads(int num_cpu_threads);
+
  protected:
   // NOTE(alex.millane): The functions below are used in the tests.
 
@@ -212,10 +270,18 @@ class SphereTracer {
   bool castOnGPU(const Ray& ray, const TsdfLayer& tsdf_layer,
                  const float truncation_distance_m, float* t) const;
 
+  // Renders depth and (if color_layer and color_ptr are passed) color on the
+  // CPU.
+  void renderOnCPU(const Camera& camera, const Transform& T_L_C,
+                   const TsdfLayer& tsdf_layer, const ColorLayer* color_layer,
+                   const float truncation_distance_m, DepthImage* depth_ptr,
+                   ColorImage* color_ptr, const int ray_subsampling_factor);
+
   // Params
   int maximum_steps_ = 100;
   float maximum_ray_length_m_ = 15.0f;
   float surface_distance_epsilon_vox_ = 0.1f;
+  int num_cpu_threads_ = 0;
 
   // The CUDA stream on which processing occurs
   std::shared_ptr<CudaStream> cuda_stream_;
@@ -18,6 +18,7 @@ limitations under the License.
 #include <functional>
 #include <unordered_map>
 
+#include "nvblox/core/memory_report.h"
 #include "nvblox/core/types.h"
 #include "nvblox/sensors/image.h"
 
@@ -49,6 +50,13 @@ class ImageCache {
   /// @return The image.
   ImageType* get(const int rows, const int cols, const MemoryType memory_type);
 
+  /// The number of cached images.
+  size_t size() const { return image_cache_.size(); }
+
+  /// The memory held by the cached images. The cache never releases images.
+  /// @return The memory usage.
+  MemoryUsage getMemoryUsage() const;
+
  private:
   using ImageCacheMap =
       std::unordered_map<ImageCacheKey, std::shared_ptr<ImageType>,
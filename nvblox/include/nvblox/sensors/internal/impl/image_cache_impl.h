@@ -51,4 +51,13 @@ ImageType* ImageCache<ImageType>::get(const int rows, const int cols,
   }
 }
 
+template <typename ImageType>
+MemoryUsage ImageCache<ImageType>::getMemoryUsage() const {
+  MemoryUsage usage;
+  for (const auto& key_image_pair : image_cache_) {
+    usage.addImage(*key_image_pair.second);
+  }
+  return usage;
+}
+
 }  // namespace nvblox
@@ -0,0 +1,118 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "nvblox/core/types.h"
+#include "nvblox/core/unified_vector.h"
+
+namespace nvblox {
+
+struct SerializedMesh;
+
+/// How triangle indices are encoded in a CompactSerializedMesh.
+enum class CompactMeshIndexEncoding : uint8_t {
+  /// 16 bits per index. Blocks have far fewer than 2^16 vertices.
+  k16Bit = 0,
+  /// The difference to the first vertex of the block not referenced so far,
+  /// zigzag and varint encoded. Mostly 1 byte per index, as triangles
+  /// reference new or recently used vertices.
+  kVarintDelta = 1,
+};
+
+/// How vertex colors are encoded in a CompactSerializedMesh.
+enum class CompactMeshColorEncoding : uint8_t {
+  /// No colors.
+  kNone = 0,
+  /// 16 bits per vertex, 5/6/5 bits of red/green/blue.
+  kRgb565 = 1,
+  /// A per-block palette of up to 256 RGB colors and 8 bits per vertex.
+  /// Lossless for blocks with few distinct colors. Blocks with more colors
+  /// fall back to kRgb565.
+  kPalette = 2,
+};
+
+/// Options of the compact mesh encoding.
+struct CompactMeshEncodingOptions {
+  CompactMeshIndexEncoding index_encoding =
+      CompactMeshIndexEncoding::kVarintDelta;
+  CompactMeshColorEncoding color_encoding = CompactMeshColorEncoding::kRgb565;
+  /// Encode vertex normals, octahedral mapped to 2x8 bits.
+  bool encode_normals = false;
+};
+
+/// A mesh in the compact wire format.
+///
+/// The format is a self-contained byte stream. Vertex positions are quantized
+/// to 16 bits per axis relative to their block, over a range of two block
+/// sizes, which is far below voxel resolution. Alpha is not transmitted.
+///
+/// Layout (little endian):
+///   header: magic (u32), version (u8), has_normals (u8), index encoding
+///           (u8), color encoding (u8), block size (f32), number of blocks
+///           (varint)
+///   per block: block index (3x zigzag varint), number of vertices (varint),
+///              number of triangle indices (varint), positions (3x u16 per
+///              vertex), [normals (2x i8 per vertex)], [color mode of the
+///              block (u8) and colors], triangle indices
+struct CompactSerializedMesh {
+  /// The encoded mesh.
+  std::vector<uint8_t> data;
+  /// Indices of the encoded mesh blocks (also contained in data).
+  std::vector<Index3D> block_indices;
+  /// The size of the mesh in the uncompressed SerializedMesh format.
+  size_t uncompressed_size_bytes = 0;
+
+  /// @return uncompressed_size_bytes / data.size().
+  float compressionRatio() const;
+};
+
+/// Encodes a serialized mesh in the compact wire format.
+/// @param mesh The mesh to encode. All vertices of a block must lie within
+/// half a block of the block.
+/// @param block_size The size of the mesh blocks in meters.
+/// @param options The encoding options.
+/// @param normals Vertex normals, in the order of mesh.vertices. Required if
+/// options.encode_normals is set.
+/// @return The encoded mesh.
+CompactSerializedMesh encodeCompactMesh(
+    const SerializedMesh& mesh, float block_size,
+    const CompactMeshEncodingOptions& options = CompactMeshEncodingOptions(),
+    const host_vector<Vector3f>* normals = nullptr);
+
+/// Decodes a mesh in the compact wire format.
+/// @param data The encoded mesh.
+/// @param num_bytes The size of the encoded mesh.
+/// @param mesh The decoded mesh. Colors are empty if none were encoded.
+/// @param normals Optional output of the decoded normals. Empty if none were
+/// encoded.
+/// @return False if the data is not a valid compact mesh.
+bool decodeCompactMesh(const uint8_t* data, size_t num_bytes,
+                       SerializedMesh* mesh,
+                       std::vector<Vector3f>* normals = nullptr);
+
+/// Decodes a mesh in the compact wire format.
+/// @param compact_mesh The encoded mesh.
+/// @param mesh The decoded mesh.
+/// @param normals Optional output of the decoded normals.
+/// @return False if the data is not a valid compact mesh.
+bool decodeCompactMesh(const CompactSerializedMesh& compact_mesh,
+                       SerializedMesh* mesh,
+                       std::vector<Vector3f>* normals = nullptr);
+
+}  // namespace nvblox
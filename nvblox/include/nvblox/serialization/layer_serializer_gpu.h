@@ -43,8 +43,11 @@ struct SerializedLayer {
 };
 
 using SerializedTsdfLayer = SerializedLayer<TsdfVoxel>;
+using SerializedCompactTsdfLayer = SerializedLayer<CompactTsdfVoxel>;
 using SerializedColorLayer = SerializedLayer<ColorVoxel>;
 using SerializedOccupancyLayer = SerializedLayer<OccupancyVoxel>;
+using SerializedQuantizedOccupancyLayer =
+    SerializedLayer<QuantizedOccupancyVoxel>;
 using SerializedFreespaceLayer = SerializedLayer<FreespaceVoxel>;
 using SerializedEsdfLayer = SerializedLayer<EsdfVoxel>;
 
@@ -83,11 +86,47 @@ class LayerSerializerGpu {
 };
 
 using TsdfLayerSerializerGpu = LayerSerializerGpu<TsdfLayer>;
+using CompactTsdfLayerSerializerGpu = LayerSerializerGpu<CompactTsdfLayer>;
 using ColorLayerSerializerGpu = LayerSerializerGpu<ColorLayer>;
 using OccupancyLayerSerializerGpu = LayerSerializerGpu<OccupancyLayer>;
+using QuantizedOccupancyLayerSerializerGpu =
+    LayerSerializerGpu<QuantizedOccupancyLayer>;
 using FreespaceLayerSerializerGpu = LayerSerializerGpu<FreespaceLayer>;
 using EsdfLayerSerializerGpu = LayerSerializerGpu<EsdfLayer>;
 
+/// Class for serialization of a CompactFreespaceLayer from GPU to host
+///
+/// The compact voxels are unpacked into FreespaceVoxels during serialization,
+/// such that the output is identical to that of a FreespaceLayerSerializerGpu
+/// run on the equivalent FreespaceLayer.
+class CompactFreespaceLayerSerializerGpu {
+ public:
+  CompactFreespaceLayerSerializerGpu();
+  virtual ~CompactFreespaceLayerSerializerGpu() = default;
+
+  /// Serialize a layer and return a pointer to the result
+  ///
+  /// layer                       Layer to serialize
+  /// block_indices_to_serialize  Block indices to serialize
+  /// cuda_stream                 Cuda stream. Will be synced
+  std::shared_ptr<const SerializedFreespaceLayer> serialize(
+      const CompactFreespaceLayer& layer,
+      const std::vector<Index3D>& block_indices_to_serialize,
+      const CudaStream cuda_stream);
+
+ private:
+  LayerSerializerGpuInternal<CompactFreespaceLayer, CompactFreespaceVoxel>
+      voxel_serializer_;
+  LayerSerializerGpuInternal<CompactFreespaceLayer, Time> time_base_serializer_;
+
+  // The packed voxels and the block time bases before unpacking.
+  host_vector<CompactFreespaceVoxel> compact_voxels_;
+  host_vector<Time> time_bases_;
+  host_vector<int32_t> time_base_offsets_;
+
+  std::shared_ptr<SerializedFreespaceLayer> serialized_layer_;
+};
+
 }  // namespace nvblox
 
 #include "nvblox/serialization/internal/impl/layer_serializer_gpu_impl.h"
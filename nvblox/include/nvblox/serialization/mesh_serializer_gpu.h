@@ -23,6 +23,7 @@ limitations under the License.
 #include "nvblox/core/unified_vector.h"
 #include "nvblox/map/common_names.h"
 #include "nvblox/map/layer.h"
+#include "nvblox/serialization/compact_mesh_encoding.h"
 #include "nvblox/serialization/internal/serialization_gpu.h"
 
 namespace nvblox {
@@ -86,6 +87,17 @@ struct SerializedMesh {
     return triangle_index_block_offsets[block_index + 1] -
            triangle_index_block_offsets[block_index];
   }
+
+  /// The number of bytes of the mesh data, including offsets and block
+  /// indices.
+  size_t sizeInBytes() const {
+    return vertices.size() * sizeof(Vector3f) + colors.size() * sizeof(Color) +
+           triangle_indices.size() * sizeof(int) +
+           (vertex_block_offsets.size() +
+            triangle_index_block_offsets.size()) *
+               sizeof(int32_t) +
+           block_indices.size() * sizeof(Index3D);
+  }
 };
 
 /// Class for serialization
@@ -113,6 +125,24 @@ class MeshSerializerGpu {
       const std::vector<nvblox::Index3D>& block_indices_to_serialize,
       const nvblox::CudaStream cuda_stream);
 
+  /// Serialize a mesh layer in the compact wire format
+  ///
+  /// The requested blocks are serialized as in serializeMesh() and then
+  /// encoded, see CompactSerializedMesh. Note that this overwrites the mesh
+  /// returned by getSerializedMesh().
+  ///
+  /// @attention: Input mesh layer must be in device or unified memory
+  ///
+  /// @param mesh_layer                  Mesh layer to serialize
+  /// @param block_indices_to_serialize  Requested block indices
+  /// @param options                     Encoding options
+  /// @param cuda_stream                 Cuda stream
+  std::shared_ptr<const CompactSerializedMesh> serializeMeshCompact(
+      const nvblox::MeshLayer& mesh_layer,
+      const std::vector<nvblox::Index3D>& block_indices_to_serialize,
+      const CompactMeshEncodingOptions& options,
+      const nvblox::CudaStream cuda_stream);
+
   /// Get the serialized mesh
   std::shared_ptr<const SerializedMesh> getSerializedMesh() const {
     return serialized_mesh_;
@@ -120,9 +150,14 @@ class MeshSerializerGpu {
 
  private:
   LayerSerializerGpuInternal<MeshLayer, Vector3f> vertex_serializer_;
+  LayerSerializerGpuInternal<MeshLayer, Vector3f> normal_serializer_;
   LayerSerializerGpuInternal<MeshLayer, Color> color_serializer_;
   LayerSerializerGpuInternal<MeshLayer, int> triangle_index_serializer_;
 
+  // Normals are only serialized for the compact encoding.
+  host_vector<Vector3f> serialized_normals_;
+  host_vector<int32_t> normal_block_offsets_;
+
   std::shared_ptr<SerializedMesh> serialized_mesh_;
 };
 
@@ -0,0 +1,66 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <chrono>
+
+namespace nvblox {
+
+template <typename FunctionType>
+auto ThreadPool::submit(FunctionType&& function)
+    -> std::future<std::invoke_result_t<std::decay_t<FunctionType>>> {
+  using ResultType = std::invoke_result_t<std::decay_t<FunctionType>>;
+  // std::function requires copyable targets, so the task is shared.
+  auto task = std::make_shared<std::packaged_task<ResultType()>>(
+      std::forward<FunctionType>(function));
+  std::future<ResultType> future = task->get_future();
+  post([task]() { (*task)(); });
+  return future;
+}
+
+template <typename ResultType>
+void ThreadPool::wait(const std::future<ResultType>& future) {
+  if (!future.valid()) {
+    return;
+  }
+  if (!isWorkerThread()) {
+    future.wait();
+    return;
+  }
+  constexpr auto kPollPeriod = std::chrono::microseconds(100);
+  while (future.wait_for(std::chrono::seconds(0)) !=
+         std::future_status::ready) {
+    if (!runPendingTask()) {
+      future.wait_for(kPollPeriod);
+    }
+  }
+}
+
+template <typename FunctionType>
+void ThreadPool::parallelFor(int num_items, const FunctionType& function,
+                             int max_parallelism) {
+  if (num_items <= 0) {
+    return;
+  }
+  std::atomic<int> next_item{0};
+  runWorkers(numWorkers(max_parallelism, num_items), [&]() {
+    for (int i = next_item++; i < num_items; i = next_item++) {
+      function(i);
+    }
+  });
+}
+
+}  // namespace nvblox
@@ -0,0 +1,226 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace nvblox {
+
+/// Counters of a ThreadPool.
+struct ThreadPoolStats {
+  /// The number of worker threads.
+  int num_threads = 0;
+  /// The number of tasks queued on the pool.
+  int64_t num_tasks_submitted = 0;
+  /// The number of tasks run by the worker threads or by waiting callers.
+  int64_t num_tasks_executed = 0;
+  /// The number of tasks a worker took from the queue of another worker.
+  int64_t num_tasks_stolen = 0;
+  /// The number of calls to runWorkers() (and parallelFor()).
+  int64_t num_parallel_runs = 0;
+  /// The number of helper workers of runWorkers() which were skipped, because
+  /// the work was done before a pool thread got to them.
+  int64_t num_helpers_skipped = 0;
+};
+
+/// A pool of persistent worker threads, shared by the CPU-side components of
+/// nvblox (meshing, coloring, ray casting, serialization, ...), such that
+/// they don't spawn threads per call and don't oversubscribe the cores.
+///
+/// Each worker has its own task queue. Tasks queued from a worker go to its
+/// own queue and are run last-in first-out, which keeps nested work hot in the
+/// cache. Idle workers steal the oldest tasks from the other queues.
+///
+/// Parallel loops run on the calling thread as well as on the pool, so they
+/// make progress even if all workers are busy, and may be nested.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /// Constructor. Starts the worker threads.
+  /// @param num_threads The number of worker threads. 0 uses one per core,
+  /// minus one for the calling thread, which takes part in parallel loops.
+  /// @param pin_threads_to_cores Whether to pin worker i to core i + 1 (modulo
+  /// the number of cores). Only supported on Linux.
+  explicit ThreadPool(int num_threads = 0, bool pin_threads_to_cores = false);
+  /// Runs the queued tasks and stops the worker threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// The pool shared by all components which aren't given a pool explicitly.
+  /// Created on first use with one thread per core (see the constructor).
+  /// @return The default pool.
+  static std::shared_ptr<ThreadPool> getDefault();
+
+  /// Queue a task, without a way to wait for it.
+  /// @param task The task.
+  void post(Task task);
+
+  /// Queue a function.
+  /// @param function The function to run. Must be callable without arguments.
+  /// @return A future holding the result of the function.
+  template <typename FunctionType>
+  auto submit(FunctionType&& function)
+      -> std::future<std::invoke_result_t<std::decay_t<FunctionType>>>;
+
+  /// Wait for a future. Called from a worker thread of this pool, the waiting
+  /// thread runs queued tasks in the meantime, such that waiting for a task
+  /// queued behind the waiting one doesn't deadlock.
+  /// @param future The future to wait for.
+  template <typename ResultType>
+  void wait(const std::future<ResultType>& future);
+
+  /// Runs worker() on the calling thread and concurrently on up to
+  /// num_workers - 1 pool threads. The workers are expected to pull items
+  /// from shared state (e.g. an atomic counter) until all are claimed. Returns
+  /// once the caller's worker has returned and all pool workers which started
+  /// have returned. Pool workers which didn't start by then are skipped.
+  /// @param num_workers The maximum number of concurrent workers, including
+  /// the calling thread. See numWorkers().
+  /// @param worker The worker function.
+  void runWorkers(int num_workers, const std::function<void()>& worker);
+
+  /// Runs function(i) for all i in [0, num_items), spread over up to
+  /// max_parallelism threads (including the calling thread). Returns once
+  /// all items are done.
+  /// @param num_items The number of items.
+  /// @param function The function, called once per item.
+  /// @param max_parallelism The maximum number of threads. 0 uses the whole
+  /// pool.
+  template <typename FunctionType>
+  void parallelFor(int num_items, const FunctionType& function,
+                   int max_parallelism = 0);
+
+  /// The number of workers to use for a number of items: max_parallelism (or
+  /// the pool threads plus the caller if max_parallelism <= 0), limited to the
+  /// number of items and to the pool threads plus the caller.
+  /// @param max_parallelism The requested number of threads. 0 for all.
+  /// @param num_items The number of work items.
+  /// @return The number of workers, at least 1.
+  int numWorkers(int max_parallelism, size_t num_items) const;
+
+  /// Run one queued task on the calling thread, if there is one.
+  /// @return True if a task was run.
+  bool runPendingTask();
+
+  /// Whether the calling thread is a worker thread of this pool.
+  bool isWorkerThread() const;
+
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+  bool pin_threads_to_cores() const { return pin_threads_to_cores_; }
+
+  /// The counters of the pool.
+  ThreadPoolStats getStats() const;
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // The worker threads.
+  void workerLoop(int worker_index);
+  // Take a task: the newest of the own queue (if the calling thread is a
+  // worker), else the oldest of another queue.
+  bool popTask(int worker_index, Task* task);
+  void pinToCore(int worker_index);
+
+  const bool pin_threads_to_cores_;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  // The queue tasks posted from outside the pool go to next.
+  std::atomic<size_t> next_queue_{0};
+  // The number of queued tasks.
+  std::atomic<int> num_queued_tasks_{0};
+
+  std::mutex mutex_;
+  // Signalled when a task is queued or the pool stops.
+  std::condition_variable task_queued_condition_;
+  bool stop_ = false;
+
+  // Counters, see ThreadPoolStats.
+  std::atomic<int64_t> num_tasks_submitted_{0};
+  std::atomic<int64_t> num_tasks_executed_{0};
+  std::atomic<int64_t> num_tasks_stolen_{0};
+  std::atomic<int64_t> num_parallel_runs_{0};
+  std::atomic<int64_t> num_helpers_skipped_{0};
+
+  std::vector<std::thread> threads_;
+};
+
+/// A set of tasks with dependencies, run on a ThreadPool. A task is queued
+/// once all the tasks it depends on are done. Dependencies have to be added
+/// before the task which depends on them, so the graph can't have cycles.
+///
+/// Example: mesh and ESDF after integration, and streaming after both.
+///   TaskGraph graph;
+///   const auto integrate = graph.addTask(integrate_function);
+///   const auto mesh = graph.addTask(mesh_function, {integrate});
+///   const auto esdf = graph.addTask(esdf_function, {integrate});
+///   graph.addTask(stream_function, {mesh, esdf});
+///   graph.run(thread_pool.get());
+class TaskGraph {
+ public:
+  using TaskId = int;
+
+  TaskGraph() = default;
+
+  /// Add a task.
+  /// @param function The task function.
+  /// @param dependencies The tasks which have to finish before this one
+  /// starts.
+  /// @return The id of the task, to be used as a dependency of later tasks.
+  TaskId addTask(std::function<void()> function,
+                 const std::vector<TaskId>& dependencies = {});
+
+  /// Run all tasks and block until they are done. May be called repeatedly.
+  /// @param thread_pool The pool to run the tasks on.
+  void run(ThreadPool* thread_pool);
+
+  /// The number of tasks in the graph.
+  size_t size() const { return tasks_.size(); }
+
+ private:
+  struct RunState;
+
+  // Runs a task and queues the dependents which became ready.
+  void runTask(TaskId task_id, const std::shared_ptr<RunState>& state,
+               ThreadPool* thread_pool) const;
+
+  struct TaskNode {
+    std::function<void()> function;
+    // The tasks depending on this one.
+    std::vector<TaskId> dependents;
+    int num_dependencies = 0;
+  };
+  std::vector<TaskNode> tasks_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox/utils/internal/impl/thread_pool_impl.h"
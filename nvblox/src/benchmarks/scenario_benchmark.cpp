@@ -0,0 +1,271 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "nvblox/core/internal/error_check.h"
+#include "nvblox/core/internal/warmup_cuda.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/primitives/scenario_generator.h"
+#include "nvblox/sensors/camera.h"
+#include "nvblox/sensors/image.h"
+#include "nvblox/sensors/lidar.h"
+#include "nvblox/utils/timing.h"
+
+DEFINE_string(scenario, "warehouse", "The world: \"warehouse\" or \"city\".");
+DEFINE_int32(num_cells_x, 4, "The number of aisles/city blocks along x.");
+DEFINE_int32(num_cells_y, 4, "The number of aisles/city blocks along y.");
+DEFINE_int32(num_laps, 1, "The number of traversals of the trajectory.");
+DEFINE_double(sensor_speed_mps, 1.5, "The speed of the sensor.");
+DEFINE_int32(seed, 0, "Seed of the procedural layout.");
+DEFINE_string(sensor, "camera", "The sensor: \"camera\" or \"lidar\".");
+DEFINE_double(voxel_size_m, 0.05, "The voxel size of the map.");
+DEFINE_int32(max_frames, -1, "Stop after this many frames, if positive.");
+DEFINE_int32(mesh_every_n_frames, 1, "Update the mesh every n frames.");
+DEFINE_int32(esdf_every_n_frames, 1, "Update the ESDF every n frames.");
+DEFINE_string(output_csv, "", "Where to write the per-frame statistics.");
+
+DECLARE_bool(alsologtostderr);
+
+namespace nvblox {
+
+/// Statistics of a replayed frame.
+struct FrameStats {
+  int frame_idx = 0;
+  int64_t timestamp_ms = 0;
+  float integrate_ms = 0.0f;
+  float mesh_ms = 0.0f;
+  float esdf_ms = 0.0f;
+  size_t num_tsdf_blocks = 0;
+  size_t num_mesh_blocks = 0;
+  size_t num_esdf_blocks = 0;
+  size_t gpu_memory_used_bytes = 0;
+  size_t host_memory_resident_bytes = 0;
+
+  float total_ms() const { return integrate_ms + mesh_ms + esdf_ms; }
+};
+
+// Device wide memory in use, including other processes.
+size_t getGpuMemoryUsedBytes() {
+  size_t free_bytes;
+  size_t total_bytes;
+  checkCudaErrors(cudaMemGetInfo(&free_bytes, &total_bytes));
+  return total_bytes - free_bytes;
+}
+
+// The resident set size of this process.
+size_t getHostMemoryResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/// Replays a procedural scenario through a Mapper, recording per-frame
+/// latency, block counts and memory, in order to find scaling cliffs.
+class ScenarioBenchmark {
+ public:
+  explicit ScenarioBenchmark(const primitives::ScenarioParams& params);
+
+  void runBenchmark();
+  bool writeCsv(const std::string& csv_output_path) const;
+  void printSummary() const;
+
+ private:
+  template <typename SensorType>
+  void replay(const SensorType& sensor);
+
+  primitives::Scenario scenario_;
+  Mapper mapper_;
+  std::vector<FrameStats> stats_;
+
+  // Simulated sensors.
+  const Camera camera_{300, 300, 320, 240, 640, 480};
+  const Lidar lidar_{1024, 16, 0.0f, 100.0f, 30.0f * M_PI / 180.0f};
+};
+
+ScenarioBenchmark::ScenarioBenchmark(const primitives::ScenarioParams& params)
+    : scenario_(primitives::createScenario(params)),
+      mapper_(FLAGS_voxel_size_m, MemoryType::kDevice) {
+  mapper_.tsdf_integrator().max_integration_distance_m(scenario_.max_range_m);
+  mapper_.color_integrator().max_integration_distance_m(scenario_.max_range_m);
+  mapper_.esdf_integrator().max_esdf_distance_m(2.0f);
+  LOG(INFO) << "Scenario " << toString(params.type) << " with "
+            << scenario_.num_frames() << " frames, bounds "
+            << scenario_.scene.aabb().min().transpose() << " to "
+            << scenario_.scene.aabb().max().transpose();
+}
+
+void ScenarioBenchmark::runBenchmark() {
+  if (FLAGS_sensor == "lidar") {
+    replay(lidar_);
+  } else {
+    CHECK_EQ(FLAGS_sensor, "camera") << "Unknown sensor.";
+    replay(camera_);
+  }
+}
+
+template <typename SensorType>
+void ScenarioBenchmark::replay(const SensorType& sensor) {
+  constexpr bool kIsLidar = std::is_same<SensorType, Lidar>::value;
+  DepthImage depth_frame(sensor.rows(), sensor.cols(), MemoryType::kUnified);
+  int num_frames = scenario_.num_frames();
+  if (FLAGS_max_frames > 0) {
+    num_frames = std::min(num_frames, FLAGS_max_frames);
+  }
+  stats_.reserve(num_frames);
+
+  using Clock = std::chrono::steady_clock;
+  auto elapsed_ms = [](const Clock::time_point& start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start)
+        .count();
+  };
+
+  for (int i = 0; i < num_frames; i++) {
+    FrameStats stats;
+    stats.frame_idx = i;
+    stats.timestamp_ms = static_cast<int64_t>(scenario_.timestamps_ms[i]);
+
+    // Rendering the ground truth is not part of the measured latency.
+    Transform T_S_C;
+    {
+      timing::Timer render_timer("scenario/render");
+      T_S_C = kIsLidar ? scenario_.getLidarPose(i)
+                       : scenario_.getCameraPose(i);
+      scenario_.scene.generateDepthImageFromScene(
+          sensor, T_S_C, scenario_.max_range_m, &depth_frame);
+    }
+
+    auto start = Clock::now();
+    if constexpr (kIsLidar) {
+      mapper_.integrateLidarDepth(depth_frame, T_S_C, sensor);
+    } else {
+      mapper_.integrateDepth(depth_frame, T_S_C, sensor);
+    }
+    stats.integrate_ms = elapsed_ms(start);
+
+    if (FLAGS_mesh_every_n_frames > 0 && i % FLAGS_mesh_every_n_frames == 0) {
+      start = Clock::now();
+      mapper_.updateMesh();
+      stats.mesh_ms = elapsed_ms(start);
+    }
+    if (FLAGS_esdf_every_n_frames > 0 && i % FLAGS_esdf_every_n_frames == 0) {
+      start = Clock::now();
+      mapper_.updateEsdf();
+      stats.esdf_ms = elapsed_ms(start);
+    }
+
+    stats.num_tsdf_blocks = mapper_.tsdf_layer().numAllocatedBlocks();
+    stats.num_mesh_blocks = mapper_.mesh_layer().numAllocatedBlocks();
+    stats.num_esdf_blocks = mapper_.esdf_layer().numAllocatedBlocks();
+    stats.gpu_memory_used_bytes = getGpuMemoryUsedBytes();
+    stats.host_memory_resident_bytes = getHostMemoryResidentBytes();
+    stats_.push_back(stats);
+
+    LOG_EVERY_N(INFO, 100) << "Frame " << i << "/" << num_frames << ": "
+                           << stats.total_ms() << " ms, "
+                           << stats.num_tsdf_blocks << " TSDF blocks";
+  }
+}
+
+bool ScenarioBenchmark::writeCsv(const std::string& csv_output_path) const {
+  std::ofstream file(csv_output_path);
+  if (!file) {
+    LOG(ERROR) << "Could not open " << csv_output_path;
+    return false;
+  }
+  file << "frame,timestamp_ms,integrate_ms,mesh_ms,esdf_ms,total_ms,"
+          "num_tsdf_blocks,num_mesh_blocks,num_esdf_blocks,"
+          "gpu_memory_used_bytes,host_memory_resident_bytes\n";
+  for (const FrameStats& stats : stats_) {
+    file << stats.frame_idx << "," << stats.timestamp_ms << ","
+         << stats.integrate_ms << "," << stats.mesh_ms << "," << stats.esdf_ms
+         << "," << stats.total_ms() << "," << stats.num_tsdf_blocks << ","
+         << stats.num_mesh_blocks << "," << stats.num_esdf_blocks << ","
+         << stats.gpu_memory_used_bytes << ","
+         << stats.host_memory_resident_bytes << "\n";
+  }
+  return static_cast<bool>(file);
+}
+
+void ScenarioBenchmark::printSummary() const {
+  if (stats_.empty()) {
+    return;
+  }
+  std::vector<float> total_ms;
+  for (const FrameStats& stats : stats_) {
+    total_ms.push_back(stats.total_ms());
+  }
+  const auto max_it = std::max_element(total_ms.begin(), total_ms.end());
+  std::vector<float> sorted_ms = total_ms;
+  std::sort(sorted_ms.begin(), sorted_ms.end());
+  auto percentile = [&sorted_ms](float p) {
+    return sorted_ms[static_cast<size_t>(p * (sorted_ms.size() - 1))];
+  };
+  const FrameStats& last = stats_.back();
+  std::cout << "Frames: " << stats_.size() << "\n"
+            << "Frame latency [ms]: p50 " << percentile(0.5f) << ", p99 "
+            << percentile(0.99f) << ", max " << *max_it << " (frame "
+            << std::distance(total_ms.begin(), max_it) << ")\n"
+            << "Final blocks: TSDF " << last.num_tsdf_blocks << ", mesh "
+            << last.num_mesh_blocks << ", ESDF " << last.num_esdf_blocks
+            << "\n"
+            << "Final memory [MB]: GPU " << last.gpu_memory_used_bytes / 1e6
+            << ", host resident " << last.host_memory_resident_bytes / 1e6
+            << "\n";
+}
+
+}  // namespace nvblox
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_alsologtostderr = true;
+  google::InstallFailureSignalHandler();
+
+  nvblox::warmupCuda();
+
+  nvblox::primitives::ScenarioParams params;
+  if (FLAGS_scenario == "city") {
+    params.type = nvblox::primitives::ScenarioType::kCityBlocks;
+  } else {
+    CHECK_EQ(FLAGS_scenario, "warehouse") << "Unknown scenario.";
+    params.type = nvblox::primitives::ScenarioType::kWarehouse;
+  }
+  params.num_cells_x = FLAGS_num_cells_x;
+  params.num_cells_y = FLAGS_num_cells_y;
+  params.num_laps = FLAGS_num_laps;
+  params.sensor_speed_mps = FLAGS_sensor_speed_mps;
+  params.seed = static_cast<uint32_t>(FLAGS_seed);
+
+  nvblox::ScenarioBenchmark benchmark(params);
+  benchmark.runBenchmark();
+  benchmark.printSummary();
+
+  if (!FLAGS_output_csv.empty()) {
+    benchmark.writeCsv(FLAGS_output_csv);
+  }
+
+  std::cout << nvblox::timing::Timing::Print();
+
+  return 0;
+}
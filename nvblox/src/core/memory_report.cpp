@@ -0,0 +1,105 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/core/memory_report.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace nvblox {
+
+void MemoryUsage::add(MemoryType memory_type, size_t num_bytes) {
+  switch (memory_type) {
+    case MemoryType::kDevice:
+      device_bytes += num_bytes;
+      break;
+    case MemoryType::kUnified:
+      unified_bytes += num_bytes;
+      break;
+    case MemoryType::kHost:
+      host_pinned_bytes += num_bytes;
+      break;
+  }
+}
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+  device_bytes += other.device_bytes;
+  unified_bytes += other.unified_bytes;
+  host_pinned_bytes += other.host_pinned_bytes;
+  host_bytes += other.host_bytes;
+  return *this;
+}
+
+MemoryUsage MemoryUsage::cwiseMax(const MemoryUsage& other) const {
+  MemoryUsage max_usage;
+  max_usage.device_bytes = std::max(device_bytes, other.device_bytes);
+  max_usage.unified_bytes = std::max(unified_bytes, other.unified_bytes);
+  max_usage.host_pinned_bytes =
+      std::max(host_pinned_bytes, other.host_pinned_bytes);
+  max_usage.host_bytes = std::max(host_bytes, other.host_bytes);
+  return max_usage;
+}
+
+void MemoryReport::add(const std::string& name, const MemoryUsage& usage,
+                       size_t count) {
+  items_.push_back({name, count, usage});
+}
+
+void MemoryReport::add(const std::string& prefix, const MemoryReport& other) {
+  for (const MemoryReportItem& item : other.items()) {
+    items_.push_back({prefix + item.name, item.count, item.usage});
+  }
+}
+
+MemoryUsage MemoryReport::total() const {
+  MemoryUsage total_usage;
+  for (const MemoryReportItem& item : items_) {
+    total_usage += item.usage;
+  }
+  return total_usage;
+}
+
+std::string MemoryReport::toString() const {
+  constexpr int kNameWidth = 40;
+  constexpr int kColumnWidth = 12;
+  constexpr double kBytesToMegabytes = 1.0 / (1024.0 * 1024.0);
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  auto print_row = [&](const std::string& name, const std::string& count,
+                       const MemoryUsage& usage) {
+    ss << std::left << std::setw(kNameWidth) << name << std::right
+       << std::setw(kColumnWidth) << count << std::setw(kColumnWidth)
+       << usage.device_bytes * kBytesToMegabytes << std::setw(kColumnWidth)
+       << usage.unified_bytes * kBytesToMegabytes << std::setw(kColumnWidth)
+       << usage.host_pinned_bytes * kBytesToMegabytes
+       << std::setw(kColumnWidth) << usage.host_bytes * kBytesToMegabytes
+       << std::setw(kColumnWidth) << usage.total_bytes() * kBytesToMegabytes
+       << "\n";
+  };
+  ss << std::left << std::setw(kNameWidth) << "Memory [MB]" << std::right
+     << std::setw(kColumnWidth) << "count" << std::setw(kColumnWidth)
+     << "device" << std::setw(kColumnWidth) << "unified"
+     << std::setw(kColumnWidth) << "pinned" << std::setw(kColumnWidth)
+     << "host" << std::setw(kColumnWidth) << "total"
+     << "\n";
+  for (const MemoryReportItem& item : items_) {
+    print_row(item.name, std::to_string(item.count), item.usage);
+  }
+  print_row("total", "", total());
+  return ss.str();
+}
+
+}  // namespace nvblox
@@ -69,4 +69,76 @@ std::vector<Index3D> getBlocksWithinRadiusOfAABB(
   return output_blocks;
 }
 
+namespace {
+
+void getBoundingCubeBlockIndices(float block_size, const Vector3f& center,
+                                 float radius, Index3D* min_block_index,
+                                 Index3D* max_block_index) {
+  const Vector3f offset = Vector3f::Constant(radius);
+  *min_block_index =
+      getBlockIndexFromPositionInLayer(block_size, center - offset);
+  *max_block_index =
+      getBlockIndexFromPositionInLayer(block_size, center + offset);
+}
+
+}  // namespace
+
+std::vector<Index3D> getBlockIndicesWithinRadius(float block_size,
+                                                 const Vector3f& center,
+                                                 float radius) {
+  Index3D min_block_index;
+  Index3D max_block_index;
+  getBoundingCubeBlockIndices(block_size, center, radius, &min_block_index,
+                              &max_block_index);
+  std::vector<Index3D> output_blocks;
+  Index3D block_index;
+  for (block_index.x() = min_block_index.x();
+       block_index.x() <= max_block_index.x(); block_index.x()++) {
+    for (block_index.y() = min_block_index.y();
+         block_index.y() <= max_block_index.y(); block_index.y()++) {
+      for (block_index.z() = min_block_index.z();
+           block_index.z() <= max_block_index.z(); block_index.z()++) {
+        const AxisAlignedBoundingBox box =
+            getAABBOfBlock(block_size, block_index);
+        if (box.exteriorDistance(center) < radius) {
+          output_blocks.push_back(block_index);
+        }
+      }
+    }
+  }
+  return output_blocks;
+}
+
+size_t getNumBlocksInBoundingCube(float block_size, const Vector3f& center,
+                                  float radius) {
+  Index3D min_block_index;
+  Index3D max_block_index;
+  getBoundingCubeBlockIndices(block_size, center, radius, &min_block_index,
+                              &max_block_index);
+  const Index3D num_blocks = max_block_index - min_block_index +
+                             Index3D::Ones();
+  return static_cast<size_t>(num_blocks.x()) * num_blocks.y() *
+         num_blocks.z();
+}
+
+std::vector<Index3D> getBlocksWithinRadius(const Index3DSet& blocks,
+                                           float block_size,
+                                           const Vector3f& center,
+                                           float radius) {
+  if (getNumBlocksInBoundingCube(block_size, center, radius) >=
+      blocks.size()) {
+    return getBlocksWithinRadius(
+        std::vector<Index3D>(blocks.begin(), blocks.end()), block_size,
+        center, radius);
+  }
+  std::vector<Index3D> output_blocks;
+  for (const Index3D& block_index :
+       getBlockIndicesWithinRadius(block_size, center, radius)) {
+    if (blocks.count(block_index) > 0) {
+      output_blocks.push_back(block_index);
+    }
+  }
+  return output_blocks;
+}
+
 }  // namespace nvblox
\ No newline at end of file
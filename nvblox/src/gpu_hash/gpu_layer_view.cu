@@ -26,10 +26,13 @@ namespace nvblox {
 
 // Compile Specializations for the standard block types.
 template class GPULayerView<TsdfBlock>;
+template class GPULayerView<CompactTsdfBlock>;
 template class GPULayerView<FreespaceBlock>;
+template class GPULayerView<CompactFreespaceBlock>;
 template class GPULayerView<EsdfBlock>;
 template class GPULayerView<ColorBlock>;
 template class GPULayerView<OccupancyBlock>;
+template class GPULayerView<QuantizedOccupancyBlock>;
 template class GPULayerView<MeshBlock>;
 
 }  // namespace nvblox
@@ -0,0 +1,136 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/integrators/internal/decay_epoch_tracker.h"
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+
+void DecayEpochTracker::advanceEpoch() { ++epoch_; }
+
+void DecayEpochTracker::trackBlocks(const std::vector<Index3D>& block_indices) {
+  CHECK_GT(epoch_, 0) << "Advance the epoch before tracking blocks.";
+  for (const Index3D& block_index : block_indices) {
+    auto insert_status = block_states_.emplace(
+        block_index, BlockDecayState{epoch_ - 1, 0});
+    if (insert_status.second) {
+      scheduleBlock(block_index, &insert_status.first->second, epoch_);
+    }
+  }
+}
+
+void DecayEpochTracker::markBlocksUpdated(
+    const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    BlockDecayState& state = block_states_[block_index];
+    state.last_decayed_epoch = epoch_;
+    scheduleBlock(block_index, &state, epoch_ + 1);
+  }
+}
+
+void DecayEpochTracker::markBlockDecayed(const Index3D& block_index,
+                                         int num_epochs_until_due) {
+  CHECK_GT(num_epochs_until_due, 0);
+  BlockDecayState& state = block_states_[block_index];
+  state.last_decayed_epoch = epoch_;
+  if (num_epochs_until_due == kNeverDue) {
+    state.due_epoch = 0;
+  } else {
+    scheduleBlock(block_index, &state, epoch_ + num_epochs_until_due);
+  }
+}
+
+void DecayEpochTracker::excludeBlocksFromEpoch(
+    const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    auto it = block_states_.find(block_index);
+    if (it == block_states_.end() || it->second.last_decayed_epoch >= epoch_) {
+      continue;
+    }
+    // Pause the clock of this block by one epoch.
+    BlockDecayState& state = it->second;
+    ++state.last_decayed_epoch;
+    if (state.due_epoch != 0) {
+      scheduleBlock(block_index, &state, state.due_epoch + 1);
+    }
+  }
+}
+
+void DecayEpochTracker::forgetBlocks(
+    const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    block_states_.erase(block_index);
+  }
+}
+
+void DecayEpochTracker::clear() {
+  epoch_ = 0;
+  block_states_.clear();
+  due_blocks_.clear();
+}
+
+std::vector<Index3D> DecayEpochTracker::popDueBlocks() {
+  std::vector<Index3D> due_block_indices;
+  auto bucket_it = due_blocks_.begin();
+  while (bucket_it != due_blocks_.end() && bucket_it->first <= epoch_) {
+    for (const Index3D& block_index : bucket_it->second) {
+      auto state_it = block_states_.find(block_index);
+      // Skip blocks that were forgotten or rescheduled.
+      if (state_it == block_states_.end() ||
+          state_it->second.due_epoch != bucket_it->first) {
+        continue;
+      }
+      // Unschedule, such that duplicate entries are skipped.
+      state_it->second.due_epoch = 0;
+      due_block_indices.push_back(block_index);
+    }
+    bucket_it = due_blocks_.erase(bucket_it);
+  }
+  return due_block_indices;
+}
+
+int DecayEpochTracker::numPendingEpochs(const Index3D& block_index) const {
+  const auto it = block_states_.find(block_index);
+  if (it == block_states_.end()) {
+    return 0;
+  }
+  return static_cast<int>(epoch_ - it->second.last_decayed_epoch);
+}
+
+bool DecayEpochTracker::isTracked(const Index3D& block_index) const {
+  return block_states_.count(block_index) > 0;
+}
+
+std::vector<Index3D> DecayEpochTracker::getTrackedBlockIndices() const {
+  std::vector<Index3D> block_indices;
+  block_indices.reserve(block_states_.size());
+  for (const auto& kv : block_states_) {
+    block_indices.push_back(kv.first);
+  }
+  return block_indices;
+}
+
+void DecayEpochTracker::scheduleBlock(const Index3D& block_index,
+                                      BlockDecayState* state,
+                                      uint64_t due_epoch) {
+  if (state->due_epoch == due_epoch) {
+    return;
+  }
+  state->due_epoch = due_epoch;
+  due_blocks_[due_epoch].push_back(block_index);
+}
+
+}  // namespace nvblox
@@ -40,20 +40,37 @@ __device__ bool isVoxelFreespace(const FreespaceBlock* freespace_block_ptr,
   }
 }
 
+__device__ bool isVoxelFreespace(
+    const CompactFreespaceBlock* freespace_block_ptr, const dim3& voxel_index) {
+  if (freespace_block_ptr == nullptr) {
+    return false;
+  } else {
+    return freespace_block_ptr
+        ->voxels[voxel_index.x][voxel_index.y][voxel_index.z]
+        .is_high_confidence_freespace();
+  }
+}
+
+// NOTE: Templated on the voxel type such that the functor works for both
+// TsdfVoxel and CompactTsdfVoxel. The squashed slice is always TsdfVoxel.
 struct TsdfSiteFunctor {
-  __device__ bool isVoxelObserved(const TsdfVoxel& tsdf_voxel) const {
+  template <typename TsdfVoxelType>
+  __device__ bool isVoxelObserved(const TsdfVoxelType& tsdf_voxel) const {
     return tsdf_voxel.weight >= min_weight;
   }
 
-  __device__ bool isVoxelInsideObject(const TsdfVoxel& tsdf_voxel) const {
+  template <typename TsdfVoxelType>
+  __device__ bool isVoxelInsideObject(const TsdfVoxelType& tsdf_voxel) const {
     return tsdf_voxel.distance <= 0.0f;
   }
 
-  __device__ bool isVoxelNearSurface(const TsdfVoxel& tsdf_voxel) const {
+  template <typename TsdfVoxelType>
+  __device__ bool isVoxelNearSurface(const TsdfVoxelType& tsdf_voxel) const {
     return fabsf(tsdf_voxel.distance) <= max_site_distance_m;
   }
 
-  __device__ void updateSquashedExtremumAtomic(const TsdfVoxel& tsdf_voxel,
+  template <typename TsdfVoxelType>
+  __device__ void updateSquashedExtremumAtomic(const TsdfVoxelType& tsdf_voxel,
                                                const bool is_freespace,
                                                TsdfVoxel* current_value) const {
     if (is_freespace) {
@@ -67,25 +84,33 @@ struct TsdfSiteFunctor {
   float max_site_distance_m;
 };
 
+// NOTE: Templated on the voxel type such that the functor works for both
+// OccupancyVoxel and QuantizedOccupancyVoxel. The squashed slice is always
+// OccupancyVoxel.
 struct OccupancySiteFunctor {
-  __device__ bool isVoxelObserved(const OccupancyVoxel& occupancy_voxel) const {
+  template <typename OccupancyVoxelType>
+  __device__ bool isVoxelObserved(
+      const OccupancyVoxelType& occupancy_voxel) const {
     constexpr float kEps = 1e-4;
     constexpr float kLogOddsZeroPointFive = 0;
     return fabsf(occupancy_voxel.log_odds - kLogOddsZeroPointFive) > kEps;
   }
 
+  template <typename OccupancyVoxelType>
   __device__ bool isVoxelInsideObject(
-      const OccupancyVoxel& occupancy_voxel) const {
+      const OccupancyVoxelType& occupancy_voxel) const {
     return occupancy_voxel.log_odds > occupied_threshold_log_odds;
   }
 
+  template <typename OccupancyVoxelType>
   __device__ bool isVoxelNearSurface(
-      const OccupancyVoxel& occupancy_voxel) const {
+      const OccupancyVoxelType& occupancy_voxel) const {
     return true;
   }
 
+  template <typename OccupancyVoxelType>
   __device__ void updateSquashedExtremumAtomic(
-      const OccupancyVoxel& occupancy_voxel, const bool is_freespace,
+      const OccupancyVoxelType& occupancy_voxel, const bool is_freespace,
       OccupancyVoxel* current_voxel) const {
     if (is_freespace) {
       // Ignore voxels that are marked as freespace.
@@ -140,6 +165,67 @@ void EsdfIntegrator::occupied_threshold(float occupied_threshold) {
   occupied_threshold_log_odds_ = logOddsFromProbability(occupied_threshold);
 }
 
+bool EsdfIntegrator::track_updated_blocks() const {
+  return track_updated_blocks_;
+}
+
+void EsdfIntegrator::track_updated_blocks(bool track_updated_blocks) {
+  track_updated_blocks_ = track_updated_blocks;
+  if (!track_updated_blocks_) {
+    updated_block_indices_set_.clear();
+    updated_block_indices_device_.clear();
+    last_updated_block_indices_.clear();
+  }
+}
+
+void EsdfIntegrator::recordUpdatedBlocks(
+    const device_vector<Index3D>& block_indices) {
+  if (!track_updated_blocks_ || block_indices.empty()) {
+    return;
+  }
+  // Append on the device. Duplicates are removed when the blocks are moved to
+  // the host in finishRecordingUpdatedBlocks().
+  const size_t num_recorded = updated_block_indices_device_.size();
+  const size_t num_total = num_recorded + block_indices.size();
+  if (num_total > updated_block_indices_device_.capacity()) {
+    // Grow geometrically to keep the number of reallocations low.
+    updated_block_indices_device_.reserveAsync(
+        std::max(num_total, 2 * updated_block_indices_device_.capacity()),
+        *cuda_stream_);
+  }
+  updated_block_indices_device_.resizeAsync(num_total, *cuda_stream_);
+  checkCudaErrors(cudaMemcpyAsync(
+      updated_block_indices_device_.data() + num_recorded,
+      block_indices.data(), sizeof(Index3D) * block_indices.size(),
+      cudaMemcpyDefault, *cuda_stream_));
+}
+
+void EsdfIntegrator::recordUpdatedBlocks(
+    const std::vector<Index3D>& block_indices) {
+  if (!track_updated_blocks_) {
+    return;
+  }
+  updated_block_indices_set_.insert(block_indices.begin(),
+                                    block_indices.end());
+}
+
+void EsdfIntegrator::finishRecordingUpdatedBlocks() {
+  if (!track_updated_blocks_) {
+    return;
+  }
+  if (!updated_block_indices_device_.empty()) {
+    const std::vector<Index3D> block_indices_host =
+        updated_block_indices_device_.toVectorAsync(*cuda_stream_);
+    cuda_stream_->synchronize();
+    updated_block_indices_set_.insert(block_indices_host.begin(),
+                                      block_indices_host.end());
+    updated_block_indices_device_.clearNoDealloc();
+  }
+  last_updated_block_indices_.assign(updated_block_indices_set_.begin(),
+                                     updated_block_indices_set_.end());
+  updated_block_indices_set_.clear();
+}
+
 parameters::ParameterTreeNode EsdfIntegrator::getParameterTree(
     const std::string& name_remap) const {
   using parameters::ParameterTreeNode;
@@ -156,12 +242,29 @@ parameters::ParameterTreeNode EsdfIntegrator::getParameterTree(
             });
 }
 
-template <typename LayerType>
+MemoryUsage EsdfIntegrator::getScratchMemoryUsage() const {
+  MemoryUsage usage;
+  usage.addVector(block_indices_device_);
+  usage.addVector(block_indices_host_);
+  usage.addVector(updated_indices_device_);
+  usage.addVector(updated_indices_host_);
+  usage.addVector(to_clear_indices_device_);
+  usage.addVector(to_clear_indices_host_);
+  usage.addVector(temp_indices_device_);
+  usage.addVector(temp_indices_host_);
+  usage.addVector(cleared_block_indices_device_);
+  usage.addVector(temp_block_pointers_);
+  usage.addVector(updated_block_indices_device_);
+  return usage;
+}
+
+template <typename LayerType, typename FreespaceLayerType>
 void EsdfIntegrator::integrateBlocksTemplate(
     const LayerType& layer, const std::vector<Index3D>& block_indices,
-    EsdfLayer* esdf_layer, const FreespaceLayer* freespace_layer_ptr) {
+    EsdfLayer* esdf_layer, const FreespaceLayerType* freespace_layer_ptr) {
   timing::Timer esdf_timer("esdf/integrate");
 
+  last_updated_block_indices_.clear();
   if (block_indices.empty()) {
     return;
   }
@@ -170,6 +273,7 @@ void EsdfIntegrator::integrateBlocksTemplate(
   // First, allocate all the destination blocks.
   allocateBlocksOnCPU(block_indices, esdf_layer);
   allocate_timer.Stop();
+  recordUpdatedBlocks(block_indices);
 
   timing::Timer mark_timer("esdf/integrate/mark_sites");
   // Then, mark all the sites on GPU.
@@ -180,9 +284,12 @@ void EsdfIntegrator::integrateBlocksTemplate(
 
   if (!to_clear_indices_device_.empty()) {
     timing::Timer compute_timer("esdf/integrate/clear");
-    clearAllInvalid(to_clear_indices_device_.toVector(), esdf_layer,
+    const std::vector<Index3D> to_clear_indices =
+        to_clear_indices_device_.toVector();
+    clearAllInvalid(to_clear_indices, esdf_layer,
                     &cleared_block_indices_device_);
     cuda_stream_->synchronize();
+    recordUpdatedBlocks(to_clear_indices);
   }
 
   timing::Timer compute_timer("esdf/integrate/compute");
@@ -192,6 +299,7 @@ void EsdfIntegrator::integrateBlocksTemplate(
     computeEsdf(cleared_block_indices_device_, esdf_layer);
   }
   compute_timer.Stop();
+  finishRecordingUpdatedBlocks();
 }
 
 void EsdfIntegrator::integrateBlocks(const TsdfLayer& tsdf_layer,
@@ -208,6 +316,20 @@ void EsdfIntegrator::integrateBlocks(const TsdfLayer& tsdf_layer,
                                      &freespace_layer);
 }
 
+void EsdfIntegrator::integrateBlocks(
+    const TsdfLayer& tsdf_layer, const CompactFreespaceLayer& freespace_layer,
+    const std::vector<Index3D>& block_indices, EsdfLayer* esdf_layer) {
+  integrateBlocksTemplate<TsdfLayer>(tsdf_layer, block_indices, esdf_layer,
+                                     &freespace_layer);
+}
+
+void EsdfIntegrator::integrateBlocks(const CompactTsdfLayer& tsdf_layer,
+                                     const std::vector<Index3D>& block_indices,
+                                     EsdfLayer* esdf_layer) {
+  integrateBlocksTemplate<CompactTsdfLayer>(tsdf_layer, block_indices,
+                                            esdf_layer);
+}
+
 void EsdfIntegrator::integrateBlocks(const OccupancyLayer& occupancy_layer,
                                      const std::vector<Index3D>& block_indices,
                                      EsdfLayer* esdf_layer) {
@@ -215,13 +337,21 @@ void EsdfIntegrator::integrateBlocks(const OccupancyLayer& occupancy_layer,
                                           esdf_layer);
 }
 
-template <typename LayerType>
+void EsdfIntegrator::integrateBlocks(
+    const QuantizedOccupancyLayer& occupancy_layer,
+    const std::vector<Index3D>& block_indices, EsdfLayer* esdf_layer) {
+  integrateBlocksTemplate<QuantizedOccupancyLayer>(occupancy_layer,
+                                                   block_indices, esdf_layer);
+}
+
+template <typename LayerType, typename FreespaceLayerType>
 void EsdfIntegrator::integrateSliceTemplate(
     const LayerType& layer, const std::vector<Index3D>& block_indices,
     float z_min, float z_max, float z_output, EsdfLayer* esdf_layer,
-    const FreespaceLayer* freespace_layer_ptr) {
+    const FreespaceLayerType* freespace_layer_ptr) {
   timing::Timer esdf_timer("esdf/integrate_slice");
 
+  last_updated_block_indices_.clear();
   if (block_indices.empty()) {
     return;
   }
@@ -236,9 +366,12 @@ void EsdfIntegrator::integrateSliceTemplate(
 
   if (!to_clear_indices_device_.empty()) {
     timing::Timer compute_timer("esdf/integrate/clear");
-    clearAllInvalid(to_clear_indices_device_.toVectorAsync(*cuda_stream_),
-                    esdf_layer, &cleared_block_indices_device_);
+    const std::vector<Index3D> to_clear_indices =
+        to_clear_indices_device_.toVectorAsync(*cuda_stream_);
+    clearAllInvalid(to_clear_indices, esdf_layer,
+                    &cleared_block_indices_device_);
     cuda_stream_->synchronize();
+    recordUpdatedBlocks(to_clear_indices);
   }
 
   timing::Timer compute_timer("esdf/integrate_slice/compute");
@@ -248,6 +381,7 @@ void EsdfIntegrator::integrateSliceTemplate(
     computeEsdf(cleared_block_indices_device_, esdf_layer);
   }
   compute_timer.Stop();
+  finishRecordingUpdatedBlocks();
 }
 
 void EsdfIntegrator::integrateSlice(const TsdfLayer& tsdf_layer,
@@ -267,6 +401,22 @@ void EsdfIntegrator::integrateSlice(const TsdfLayer& tsdf_layer,
                                     z_output, esdf_layer, &freespace_layer);
 }
 
+void EsdfIntegrator::integrateSlice(
+    const TsdfLayer& tsdf_layer, const CompactFreespaceLayer& freespace_layer,
+    const std::vector<Index3D>& block_indices, float z_min, float z_max,
+    float z_output, EsdfLayer* esdf_layer) {
+  integrateSliceTemplate<TsdfLayer>(tsdf_layer, block_indices, z_min, z_max,
+                                    z_output, esdf_layer, &freespace_layer);
+}
+
+void EsdfIntegrator::integrateSlice(const CompactTsdfLayer& tsdf_layer,
+                                    const std::vector<Index3D>& block_indices,
+                                    float z_min, float z_max, float z_output,
+                                    EsdfLayer* esdf_layer) {
+  integrateSliceTemplate<CompactTsdfLayer>(tsdf_layer, block_indices, z_min,
+                                           z_max, z_output, esdf_layer);
+}
+
 void EsdfIntegrator::integrateSlice(const OccupancyLayer& occupancy_layer,
                                     const std::vector<Index3D>& block_indices,
                                     float z_min, float z_max, float z_output,
@@ -275,6 +425,14 @@ void EsdfIntegrator::integrateSlice(const OccupancyLayer& occupancy_layer,
                                          z_max, z_output, esdf_layer);
 }
 
+void EsdfIntegrator::integrateSlice(
+    const QuantizedOccupancyLayer& occupancy_layer,
+    const std::vector<Index3D>& block_indices, float z_min, float z_max,
+    float z_output, EsdfLayer* esdf_layer) {
+  integrateSliceTemplate<QuantizedOccupancyLayer>(
+      occupancy_layer, block_indices, z_min, z_max, z_output, esdf_layer);
+}
+
 void EsdfIntegrator::allocateBlocksOnCPU(
     const std::vector<Index3D>& block_indices, EsdfLayer* esdf_layer) {
   // We want to allocate all ESDF layer blocks and copy over the sites.
@@ -293,11 +451,12 @@ __device__ void clearVoxelDevice(EsdfVoxel* voxel,
 // Mark sites to lower & clear.
 // Block size MUST be voxels_per_side x voxels_per_side x voxel_per_size.
 // Grid size can be anything.
-template <typename BlockType, typename SiteFunctorType>
+template <typename BlockType, typename FreespaceBlockType,
+          typename SiteFunctorType>
 __global__ void markAllSitesKernel(
     int num_blocks, Index3D* block_indices,
     const Index3DDeviceHashMapType<BlockType> input_layer_block_hash,
-    const Index3DDeviceHashMapType<FreespaceBlock> freespace_block_hash,
+    const Index3DDeviceHashMapType<FreespaceBlockType> freespace_block_hash,
     Index3DDeviceHashMapType<EsdfBlock> esdf_block_hash,
     const SiteFunctorType site_functor, float max_squared_esdf_distance_vox,
     Index3D* updated_vec, int* updated_vec_size, Index3D* to_clear_vec,
@@ -308,7 +467,7 @@ __global__ void markAllSitesKernel(
   using VoxelType = typename BlockType::VoxelType;
 
   __shared__ BlockType* block_ptr;
-  __shared__ FreespaceBlock* freespace_block_ptr;
+  __shared__ FreespaceBlockType* freespace_block_ptr;
   __shared__ EsdfBlock* esdf_block;
   __shared__ int updated;
   __shared__ int to_clear;
@@ -423,22 +582,35 @@ struct SharedVoxel<TsdfVoxel> {
   typedef TsdfVoxelShared type;
 };
 
+// Compact voxels are squashed into full precision voxels.
+template <>
+struct SharedVoxel<CompactTsdfVoxel> {
+  typedef TsdfVoxelShared type;
+};
+
 template <>
 struct SharedVoxel<OccupancyVoxel> {
   typedef OccupancyVoxelShared type;
 };
 
+// Quantized voxels are squashed into full precision voxels.
+template <>
+struct SharedVoxel<QuantizedOccupancyVoxel> {
+  typedef OccupancyVoxelShared type;
+};
+
 }  // namespace
 
 // ThreadsPerBlock: kVoxelsPerSide * kVoxelsPerSide * num_vertical_blocks
 // ThreadBlockDim: number_of_blocks_in_slice * 1 * 1.
 // NOTE(remos): All block indices have the same z-value (output_block_index_z)
 // and no block index is duplicated.
-template <typename BlockType, typename SiteFunctorType>
+template <typename BlockType, typename FreespaceBlockType,
+          typename SiteFunctorType>
 __global__ void markSitesInSliceKernel(
     Index3D* block_indices_in_output_slice,
     const Index3DDeviceHashMapType<BlockType> input_layer_block_hash,
-    const Index3DDeviceHashMapType<FreespaceBlock> freespace_block_hash,
+    const Index3DDeviceHashMapType<FreespaceBlockType> freespace_block_hash,
     Index3DDeviceHashMapType<EsdfBlock> esdf_block_hash,
     const SiteFunctorType site_functor, float max_squared_esdf_distance_vox,
     int min_input_block_index_z, int min_input_voxel_index_z,
@@ -473,12 +645,15 @@ __global__ void markSitesInSliceKernel(
   // Initialize this once for each voxel in the x/y plane.
   if (vertical_block_idx_offset == 0) {
     observed[voxel_idx_x][voxel_idx_y] = false;
-    if constexpr (std::is_same<TsdfVoxel, VoxelType>::value) {
+    if constexpr (std::is_same<TsdfVoxel, VoxelType>::value ||
+                  std::is_same<CompactTsdfVoxel, VoxelType>::value) {
       // NOTE(alexmillane): We don't use the weight in the slice, so we don't
       // initialize it.
       voxel_slice[voxel_idx_x][voxel_idx_y].distance =
           2 * max_squared_esdf_distance_vox;
-    } else if constexpr (std::is_same<OccupancyVoxel, VoxelType>::value) {
+    } else if constexpr (std::is_same<OccupancyVoxel, VoxelType>::value ||
+                         std::is_same<QuantizedOccupancyVoxel,
+                                      VoxelType>::value) {
       voxel_slice[voxel_idx_x][voxel_idx_y].log_odds = 0.0f;
     } else {
       static_assert(conditional_false<BlockType>::value,
@@ -518,7 +693,7 @@ __global__ void markSitesInSliceKernel(
   if (it != input_layer_block_hash.end()) {
     block_in_column_ptr = it->second;
   }
-  const FreespaceBlock* freespace_block_ptr = nullptr;
+  const FreespaceBlockType* freespace_block_ptr = nullptr;
   if (!freespace_block_hash.empty()) {
     auto freespace_it = freespace_block_hash.find(block_in_column_index);
     if (freespace_it != freespace_block_hash.end()) {
@@ -761,6 +936,13 @@ OccupancySiteFunctor EsdfIntegrator::getSiteFunctor(const OccupancyLayer&) {
   return functor;
 }
 
+OccupancySiteFunctor EsdfIntegrator::getSiteFunctor(
+    const QuantizedOccupancyLayer&) {
+  OccupancySiteFunctor functor;
+  functor.occupied_threshold_log_odds = occupied_threshold_log_odds_;
+  return functor;
+}
+
 TsdfSiteFunctor EsdfIntegrator::getSiteFunctor(const TsdfLayer& layer) {
   TsdfSiteFunctor functor;
   functor.min_weight = tsdf_min_weight_;
@@ -769,10 +951,18 @@ TsdfSiteFunctor EsdfIntegrator::getSiteFunctor(const TsdfLayer& layer) {
   return functor;
 }
 
-template <typename LayerType>
+TsdfSiteFunctor EsdfIntegrator::getSiteFunctor(const CompactTsdfLayer& layer) {
+  TsdfSiteFunctor functor;
+  functor.min_weight = tsdf_min_weight_;
+  functor.max_site_distance_m =
+      max_tsdf_site_distance_vox_ * layer.voxel_size();
+  return functor;
+}
+
+template <typename LayerType, typename FreespaceLayerType>
 void EsdfIntegrator::markAllSites(const LayerType& layer,
                                   const std::vector<Index3D>& block_indices,
-                                  const FreespaceLayer* freespace_layer_ptr,
+                                  const FreespaceLayerType* freespace_layer_ptr,
                                   EsdfLayer* esdf_layer,
                                   device_vector<Index3D>* blocks_with_sites,
                                   device_vector<Index3D>* cleared_blocks) {
@@ -807,11 +997,12 @@ void EsdfIntegrator::markAllSites(const LayerType& layer,
   cleared_counter_device_.setZeroAsync(*cuda_stream_);
 
   GPULayerView<EsdfBlock> esdf_layer_view =
-      esdf_layer->getGpuLayerViewAsync(*cuda_stream_);
+      esdf_layer->getWritableGpuLayerViewAsync(block_indices, *cuda_stream_);
   GPULayerView<typename LayerType::BlockType> input_layer_view =
       layer.getGpuLayerViewAsync(*cuda_stream_);
 
-  Index3DDeviceHashMapType<FreespaceBlock> freespace_hash_map;
+  Index3DDeviceHashMapType<typename FreespaceLayerType::BlockType>
+      freespace_hash_map;
   if (freespace_layer_ptr != nullptr) {
     freespace_hash_map =
         freespace_layer_ptr->getGpuLayerViewAsync(*cuda_stream_)
@@ -862,14 +1053,13 @@ std::pair<int, int> getBlockAndVoxelZIndexFromHeightInLayer(
   return {block_index.z(), voxel_index.z()};
 }
 
-template <typename LayerType>
-void EsdfIntegrator::markSitesInSlice(const LayerType& input_layer,
-                                      const std::vector<Index3D>& block_indices,
-                                      float min_z, float max_z, float output_z,
-                                      const FreespaceLayer* freespace_layer_ptr,
-                                      EsdfLayer* esdf_layer,
-                                      device_vector<Index3D>* updated_blocks,
-                                      device_vector<Index3D>* cleared_blocks) {
+template <typename LayerType, typename FreespaceLayerType>
+void EsdfIntegrator::markSitesInSlice(
+    const LayerType& input_layer, const std::vector<Index3D>& block_indices,
+    float min_z, float max_z, float output_z,
+    const FreespaceLayerType* freespace_layer_ptr, EsdfLayer* esdf_layer,
+    device_vector<Index3D>* updated_blocks,
+    device_vector<Index3D>* cleared_blocks) {
   if (block_indices.empty()) {
     return;
   }
@@ -948,13 +1138,15 @@ void EsdfIntegrator::markSitesInSlice(const LayerType& input_layer,
 
   using BlockType = typename LayerType::BlockType;
 
-  // Get the GPU hash of both the TSDF and the ESDF.
+  // Get the GPU hash of both the TSDF and the ESDF. The written output blocks
+  // were copied (if shared with a snapshot) when allocated above.
   GPULayerView<EsdfBlock> esdf_layer_view =
       esdf_layer->getGpuLayerViewAsync(*cuda_stream_);
   GPULayerView<BlockType> tsdf_layer_view =
       input_layer.getGpuLayerViewAsync(*cuda_stream_);
 
-  Index3DDeviceHashMapType<FreespaceBlock> freespace_hash_map;
+  Index3DDeviceHashMapType<typename FreespaceLayerType::BlockType>
+      freespace_hash_map;
   if (freespace_layer_ptr != nullptr) {
     freespace_hash_map =
         freespace_layer_ptr->getGpuLayerViewAsync(*cuda_stream_)
@@ -1284,6 +1476,23 @@ void EsdfIntegrator::updateNeighborBands(
   }
 
   timing::Timer gpu_view("esdf/integrate/compute/neighbor_bands/gpu_view");
+  // The kernel writes to the neighbors of the band. These have to be copied
+  // first if they are shared with a snapshot, which needs the band on the
+  // host.
+  if (esdf_layer->mayHaveSharedBlocks()) {
+    const std::vector<Index3D> band_indices =
+        block_indices->toVectorAsync(*cuda_stream_);
+    cuda_stream_->synchronize();
+    std::vector<Index3D> neighbor_indices;
+    neighbor_indices.reserve(band_indices.size() * kNumNeighbors);
+    for (const Index3D& block_index : band_indices) {
+      for (int axis = 0; axis < 3; axis++) {
+        neighbor_indices.push_back(block_index + Index3D::Unit(axis));
+        neighbor_indices.push_back(block_index - Index3D::Unit(axis));
+      }
+    }
+    esdf_layer->unshareBlocksAsync(neighbor_indices, *cuda_stream_);
+  }
   GPULayerView<EsdfBlock> gpu_layer_view =
       esdf_layer->getGpuLayerViewAsync(*cuda_stream_);
   gpu_view.Stop();
@@ -1393,6 +1602,9 @@ void EsdfIntegrator::sweepBlockBandAsync(device_vector<Index3D>* block_indices,
   constexpr int kVoxelsPerSide = VoxelBlock<bool>::kVoxelsPerSide;
   const int num_blocks = block_indices->size();
 
+  // The band consists of blocks which were marked, cleared or reached by
+  // updateNeighborBands(). These were copied (if shared with a snapshot)
+  // before they were first written.
   GPULayerView<EsdfBlock> gpu_layer_view =
       esdf_layer->getGpuLayerViewAsync(*cuda_stream_);
 
@@ -1432,6 +1644,7 @@ void EsdfIntegrator::computeEsdf(
   block_indices_device_.copyFromAsync(blocks_with_sites, *cuda_stream_);
   sweepBlockBandAsync(&block_indices_device_, esdf_layer,
                       max_squared_esdf_distance_vox);
+  recordUpdatedBlocks(block_indices_device_);
 
   while (!block_indices_device_.empty()) {
     updateNeighborBands(&block_indices_device_, esdf_layer,
@@ -1443,6 +1656,7 @@ void EsdfIntegrator::computeEsdf(
     timing::Timer swap_timer("esdf/integrate/compute/swap");
     std::swap(block_indices_device_, updated_indices_device_);
     swap_timer.Stop();
+    recordUpdatedBlocks(block_indices_device_);
   }
 }
 
@@ -1552,18 +1766,18 @@ void EsdfIntegrator::clearAllInvalid(
 
   timing::Timer get_blocks_timer("esdf/integrate/clear/get_blocks");
 
-  temp_indices_host_.copyFromAsync(
-      getBlocksWithinRadiusOfAABB(
-          esdf_layer->getAllBlockIndices(), esdf_layer->block_size(),
-          getAABBOfBlocks(esdf_layer->block_size(), blocks_to_clear),
-          max_esdf_distance_m_),
-      *cuda_stream_);
+  const std::vector<Index3D> blocks_in_range = getBlocksWithinRadiusOfAABB(
+      esdf_layer->getAllBlockIndices(), esdf_layer->block_size(),
+      getAABBOfBlocks(esdf_layer->block_size(), blocks_to_clear),
+      max_esdf_distance_m_);
+  temp_indices_host_.copyFromAsync(blocks_in_range, *cuda_stream_);
   get_blocks_timer.Stop();
   temp_indices_device_.copyFromAsync(temp_indices_host_, *cuda_stream_);
 
-  // Get the hash map of the whole ESDF map.
+  // Get the hash map of the whole ESDF map. Only the blocks in range are
+  // written.
   GPULayerView<EsdfBlock> gpu_layer_view =
-      esdf_layer->getGpuLayerViewAsync(*cuda_stream_);
+      esdf_layer->getWritableGpuLayerViewAsync(blocks_in_range, *cuda_stream_);
 
   // Create an output variable.
   if (updated_counter_device_ == nullptr || updated_counter_host_ == nullptr) {
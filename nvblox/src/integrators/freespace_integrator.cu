@@ -36,6 +36,41 @@ __device__ void clamp(Index3D& index, int minval, int maxval) {
 // allow for filtering. Currently only 1 is supported.
 constexpr int kPaddingSize = 1;
 
+// When the time base of a compact freespace block is moved, it is set this far
+// behind the current time. Older timestamps are clamped to the new time base,
+// which is fine as long as this is much longer than the freespace durations.
+constexpr int64_t kCompactFreespaceRebaseHistoryMs = 1ll << 31;
+
+// Read a voxel from a block.
+template <typename VoxelType>
+__device__ void loadVoxel(const VoxelBlock<VoxelType>& block,
+                          const Index3D& voxel_index, VoxelType* voxel) {
+  *voxel = block.voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()];
+}
+
+// Read a compact freespace voxel, unpacking it relative to its block time base.
+__device__ void loadVoxel(const CompactFreespaceBlock& block,
+                          const Index3D& voxel_index, FreespaceVoxel* voxel) {
+  block.voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()]
+      .toFreespaceVoxel(block.time_base_ms, voxel);
+}
+
+// Write a voxel to a block.
+template <typename VoxelType>
+__device__ void storeVoxel(const VoxelType& voxel, const Index3D& voxel_index,
+                           VoxelBlock<VoxelType>* block) {
+  block->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()] = voxel;
+}
+
+// Write a freespace voxel to a compact block, packing it relative to the block
+// time base.
+__device__ void storeVoxel(const FreespaceVoxel& voxel,
+                           const Index3D& voxel_index,
+                           CompactFreespaceBlock* block) {
+  block->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()]
+      .fromFreespaceVoxel(voxel, block->time_base_ms);
+}
+
 // Class for storing a neighborhood of 3x3x3 block pointers. This allows for
 // faster lookup of voxels, compared to using a hashmap.
 //
@@ -102,12 +137,13 @@ class BlockNeighborhood {
     }
   }
 
+  // Setter for a voxel. The value is converted to VoxelType by storeVoxel().
+  template <typename ValueType>
   __device__ void setVoxel(const Index3D& block_index,
-                           const Index3D& voxel_index, const VoxelType& voxel) {
+                           const Index3D& voxel_index, const ValueType& voxel) {
     BlockType* block_ptr = getBlock(block_index);
     if (block_ptr != nullptr) {
-      block_ptr->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()] =
-          voxel;
+      storeVoxel(voxel, voxel_index, block_ptr);
     }
   }
 
@@ -153,10 +189,12 @@ class PaddedBlock {
   static constexpr int kVoxelsPerSide = TsdfBlock::kVoxelsPerSide;
   static constexpr int kVoxelsPerSidePadded = kVoxelsPerSide + 2 * kPaddingSize;
 
-  // Populate the voxel at voxel_index by looking it up in block_neighbors
+  // Populate the voxel at voxel_index by looking it up in block_neighbors. The
+  // source voxels are converted to VoxelType by loadVoxel().
+  template <typename SourceVoxelType>
   __device__ void populateVoxel(
       const Index3D& voxel_index, const Index3D& center_block_index,
-      const BlockNeighborhood<VoxelType>& block_neighbors) {
+      const BlockNeighborhood<SourceVoxelType>& block_neighbors) {
     // We will write to this padded block index
     const Index3D target_voxel_index =
         Index3D(voxel_index.x() + kPaddingSize, voxel_index.y() + kPaddingSize,
@@ -184,22 +222,22 @@ class PaddedBlock {
     }
 
     // Set the voxel if it exists
-    const VoxelType* source_voxel_ptr =
-        block_neighbors.getVoxel(source_block_index, source_voxel_index);
-    if (source_voxel_ptr == nullptr) {
+    const VoxelBlock<SourceVoxelType>* source_block_ptr =
+        block_neighbors.getBlock(source_block_index);
+    if (source_block_ptr == nullptr) {
       // if the voxel doesn't exist  (because the block is outside the map) we
       // duplicate an adjacent voxel insted.
 
       // Sanity check that the input index was really on the border
       assert(!isWithinBlockBounds(voxel_index));
       clamp(source_voxel_index, 0, kVoxelsPerSide - 1);
-      source_voxel_ptr =
-          block_neighbors.getVoxel(center_block_index, source_voxel_index);
+      source_block_ptr = block_neighbors.getBlock(center_block_index);
     }
 
-    assert(source_voxel_ptr != nullptr);
-    voxels_[target_voxel_index.x()][target_voxel_index.y()]
-           [target_voxel_index.z()] = *source_voxel_ptr;
+    assert(source_block_ptr != nullptr);
+    loadVoxel(*source_block_ptr, source_voxel_index,
+              &voxels_[target_voxel_index.x()][target_voxel_index.y()]
+                      [target_voxel_index.z()]);
   }
 
   // Returns true if the voxel lies inside the block i.e. *not* in the padded
@@ -266,6 +304,43 @@ __device__ bool isVoxelNeighborhoodFree(
   return neighborhood_is_free;
 }
 
+// Move the time base of compact freespace blocks such that the current time is
+// representable. This runs before updateFreespaceLayerKernel(), which reads
+// the time bases of neighboring blocks.
+__global__ void rebaseCompactFreespaceBlocksKernel(
+    const Index3D* block_indices_to_update, Time current_update_time_ms,
+    Index3DDeviceHashMapType<CompactFreespaceBlock> freespace_block_hash) {
+  // Every ThreadBlock works on one VoxelBlock with one thread per voxel.
+  __shared__ CompactFreespaceBlock* block_ptr;
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    block_ptr = getBlockPtr(freespace_block_hash,
+                            block_indices_to_update[blockIdx.x]);
+  }
+  __syncthreads();
+  if (block_ptr == nullptr) {
+    return;
+  }
+
+  // All threads take the same decision here, so returning doesn't desync.
+  const Time old_time_base_ms = block_ptr->time_base_ms;
+  const int64_t offset_ms =
+      static_cast<int64_t>(current_update_time_ms - old_time_base_ms);
+  if (offset_ms >= 0 && offset_ms <= CompactFreespaceVoxel::kMaxTimeOffsetMs) {
+    return;
+  }
+  const Time new_time_base_ms =
+      current_update_time_ms - Time(kCompactFreespaceRebaseHistoryMs);
+  block_ptr->voxels[threadIdx.z][threadIdx.y][threadIdx.x].rebase(
+      old_time_base_ms, new_time_base_ms);
+
+  // Only update the time base once all threads have read the old one.
+  __syncthreads();
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    block_ptr->time_base_ms = new_time_base_ms;
+  }
+}
+
+template <typename FreespaceBlockType>
 __global__ void updateFreespaceLayerKernel(
     const Index3DDeviceHashMapType<TsdfBlock> tsdf_block_hash,
     const Index3D* block_indices_to_update, float voxel_size,
@@ -275,7 +350,7 @@ __global__ void updateFreespaceLayerKernel(
     Time min_consecutive_occupancy_duration_for_reset_ms,
     bool check_neighborhood, Time last_update_time_ms,
     Time current_update_time_ms,
-    Index3DDeviceHashMapType<FreespaceBlock> freespace_block_hash) {
+    Index3DDeviceHashMapType<FreespaceBlockType> freespace_block_hash) {
   // This kernel implements the freespace update as described in the
   // dynablox paper (https://ieeexplore.ieee.org/document/10218983).
   //
@@ -298,7 +373,8 @@ __global__ void updateFreespaceLayerKernel(
   // Lookup all block pointers in a 3x3x3 neighborhood around block_index and
   // store them in shared memory. This saves us from excessive and expensive
   // hashtable lookups.
-  __shared__ BlockNeighborhood<FreespaceVoxel> freespace_block_neighbors;
+  __shared__ BlockNeighborhood<typename FreespaceBlockType::VoxelType>
+      freespace_block_neighbors;
   __shared__ BlockNeighborhood<TsdfVoxel> tsdf_block_neighbors;
   freespace_block_neighbors.populateBlock(block_index, freespace_block_hash);
   tsdf_block_neighbors.populateBlock(block_index, tsdf_block_hash);
@@ -306,7 +382,7 @@ __global__ void updateFreespaceLayerKernel(
 
   // Populate shared memory with voxels from the current block. We also copy an
   // additional padded voxel layerborder around the block to allow filtering at
-  // the border
+  // the border. Compact freespace voxels are unpacked on the way.
   __shared__ PaddedBlock<FreespaceVoxel> freespace_block_padded;
   freespace_block_padded.populateVoxel(voxel_index, block_index,
                                        freespace_block_neighbors);
@@ -445,6 +521,14 @@ void FreespaceIntegrator::check_neighborhood(bool value) {
   check_neighborhood_ = value;
 }
 
+Time FreespaceIntegrator::last_update_time_ms() const {
+  return last_update_time_ms_;
+}
+
+void FreespaceIntegrator::last_update_time_ms(Time value) {
+  last_update_time_ms_ = value;
+}
+
 parameters::ParameterTreeNode FreespaceIntegrator::getParameterTree(
     const std::string& name_remap) const {
   const std::string name =
@@ -474,6 +558,21 @@ parameters::ParameterTreeNode FreespaceIntegrator::getParameterTree(
 void FreespaceIntegrator::updateFreespaceLayer(
     const std::vector<Index3D>& block_indices_to_update, Time update_time_ms,
     const TsdfLayer& tsdf_layer, FreespaceLayer* freespace_layer_ptr) {
+  updateFreespaceLayerTemplate(block_indices_to_update, update_time_ms,
+                               tsdf_layer, freespace_layer_ptr);
+}
+
+void FreespaceIntegrator::updateFreespaceLayer(
+    const std::vector<Index3D>& block_indices_to_update, Time update_time_ms,
+    const TsdfLayer& tsdf_layer, CompactFreespaceLayer* freespace_layer_ptr) {
+  updateFreespaceLayerTemplate(block_indices_to_update, update_time_ms,
+                               tsdf_layer, freespace_layer_ptr);
+}
+
+template <typename FreespaceLayerType>
+void FreespaceIntegrator::updateFreespaceLayerTemplate(
+    const std::vector<Index3D>& block_indices_to_update, Time update_time_ms,
+    const TsdfLayer& tsdf_layer, FreespaceLayerType* freespace_layer_ptr) {
   timing::Timer integration_timer("freespace/integrate");
 
   // Check inputs
@@ -513,6 +612,26 @@ void FreespaceIntegrator::updateFreespaceLayer(
   const dim3 kThreadsPerBlock(kNumThreads1D, kNumThreads1D, kNumThreads1D);
   const int num_thread_blocks = num_block_to_update;
 
+  // The kernels only write the blocks being updated.
+  GPULayerView<typename FreespaceLayerType::BlockType> freespace_layer_view =
+      freespace_layer_ptr->getWritableGpuLayerViewAsync(block_indices_to_update,
+                                                        *cuda_stream_);
+
+  // Compact blocks store timestamps relative to a per-block time base, which
+  // has to be moved before the current time can be stored.
+  if constexpr (std::is_same<FreespaceLayerType,
+                             CompactFreespaceLayer>::value) {
+    constexpr int kVoxelsPerSide = CompactFreespaceBlock::kVoxelsPerSide;
+    const dim3 kRebaseThreadsPerBlock(kVoxelsPerSide, kVoxelsPerSide,
+                                      kVoxelsPerSide);
+    rebaseCompactFreespaceBlocksKernel<<<num_thread_blocks,
+                                         kRebaseThreadsPerBlock, 0,
+                                         *cuda_stream_>>>(
+        block_indices_to_update_device_.data(), current_update_time_ms_,
+        freespace_layer_view.getHash().impl_);
+    checkCudaErrors(cudaPeekAtLastError());
+  }
+
   updateFreespaceLayerKernel<<<num_thread_blocks, kThreadsPerBlock, 0,
                                *cuda_stream_>>>(
       tsdf_layer.getGpuLayerViewAsync(*cuda_stream_).getHash().impl_,  // NOLINT
@@ -525,9 +644,7 @@ void FreespaceIntegrator::updateFreespaceLayer(
       check_neighborhood_,                                             // NOLINT
       last_update_time_ms_,                                            // NOLINT
       current_update_time_ms_,                                         // NOLINT
-      freespace_layer_ptr->getGpuLayerViewAsync(*cuda_stream_)
-          .getHash()
-          .impl_  // NOLINT
+      freespace_layer_view.getHash().impl_                             // NOLINT
   );
   cuda_stream_->synchronize();
   checkCudaErrors(cudaPeekAtLastError());
@@ -32,7 +32,8 @@ struct OccupancyDecayFunctor {
   /// Return true if the passed voxel is fully decayed
   /// @param voxel_ptr The voxel to check
   /// @return True if fully decayed
-  __device__ bool isFullyDecayed(OccupancyVoxel* voxel_ptr) const {
+  template <typename OccupancyVoxelType>
+  __device__ bool isFullyDecayed(OccupancyVoxelType* voxel_ptr) const {
     // Check if the next decay step would pass the threshold value in either
     // direction.
     const float log_odds = voxel_ptr->log_odds;
@@ -43,10 +44,38 @@ struct OccupancyDecayFunctor {
     }
   }
 
-  /// Decays a single Occupancy voxel.
+  /// Return the number of decay steps after which the voxel is fully decayed.
+  /// Used to schedule the epoch-based decay.
+  /// @param voxel_ptr The voxel to check
+  /// @return The number of steps. Zero if the voxel is fully decayed.
+  template <typename OccupancyVoxelType>
+  __device__ int numDecaysUntilFullyDecayed(
+      OccupancyVoxelType* voxel_ptr) const {
+    if (isFullyDecayed(voxel_ptr)) {
+      return 0;
+    }
+    const float log_odds = voxel_ptr->log_odds;
+    if (log_odds >= 0.f && log_odds >= decay_to_log_odds_) {
+      // Decaying downwards. See isFullyDecayed().
+      return static_cast<int>(floorf((log_odds - decay_to_log_odds_) /
+                                     -occupied_space_decay_log_odds_));
+    } else if (log_odds < decay_to_log_odds_) {
+      // Decaying upwards.
+      return static_cast<int>(ceilf((decay_to_log_odds_ - log_odds) /
+                                    free_space_decay_log_odds_)) -
+             1;
+    }
+    // Between the decay target and zero the decay direction flips. Check
+    // again after the next step.
+    return 1;
+  }
+
+  /// Decays a single Occupancy voxel. Works for both OccupancyVoxel and
+  /// QuantizedOccupancyVoxel.
   /// @param voxel_ptr voxel to decay
   /// @return True if the voxel is fully decayed
-  __device__ void operator()(OccupancyVoxel* voxel_ptr) const {
+  template <typename OccupancyVoxelType>
+  __device__ void operator()(OccupancyVoxelType* voxel_ptr) const {
     // If fully decayed, set to decay-to probility
     if (isFullyDecayed(voxel_ptr)) {
       // This voxel decayed to zero log odds (0.5 occupancy probability).
@@ -55,10 +84,11 @@ struct OccupancyDecayFunctor {
     }
 
     // Else decay
-    if (voxel_ptr->log_odds >= 0) {
-      voxel_ptr->log_odds += occupied_space_decay_log_odds_;
+    const float log_odds = voxel_ptr->log_odds;
+    if (log_odds >= 0) {
+      voxel_ptr->log_odds = log_odds + occupied_space_decay_log_odds_;
     } else {
-      voxel_ptr->log_odds += free_space_decay_log_odds_;
+      voxel_ptr->log_odds = log_odds + free_space_decay_log_odds_;
     }
   }
 
@@ -103,6 +133,44 @@ std::vector<Index3D> OccupancyDecayIntegrator::decay(
                         cuda_stream);
 }
 
+std::vector<Index3D> OccupancyDecayIntegrator::decay(
+    QuantizedOccupancyLayer* layer_ptr,
+    const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+    const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
+    const CudaStream cuda_stream) {
+  OccupancyDecayFunctor voxel_decayer(free_space_decay_log_odds_,
+                                      occupied_space_decay_log_odds_,
+                                      decay_to_log_odds_);
+  return quantized_decayer_.decay(layer_ptr, voxel_decayer,
+                                  deallocate_decayed_blocks_,
+                                  block_exclusion_options,
+                                  view_exclusion_options, cuda_stream);
+}
+
+std::vector<Index3D> OccupancyDecayIntegrator::decayEpoch(
+    OccupancyLayer* layer_ptr,
+    const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+    const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) {
+  OccupancyDecayFunctor voxel_decayer(free_space_decay_log_odds_,
+                                      occupied_space_decay_log_odds_,
+                                      decay_to_log_odds_);
+  return decayer_.decayEpoch(layer_ptr, voxel_decayer,
+                             deallocate_decayed_blocks_, block_exclusion_options,
+                             &epoch_tracker_, cuda_stream, changed_blocks);
+}
+
+std::vector<Index3D> OccupancyDecayIntegrator::applyPendingDecay(
+    OccupancyLayer* layer_ptr, const std::vector<Index3D>& block_indices,
+    const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) {
+  OccupancyDecayFunctor voxel_decayer(free_space_decay_log_odds_,
+                                      occupied_space_decay_log_odds_,
+                                      decay_to_log_odds_);
+  return decayer_.applyPendingDecay(layer_ptr, voxel_decayer,
+                                    deallocate_decayed_blocks_, block_indices,
+                                    &epoch_tracker_, cuda_stream,
+                                    changed_blocks);
+}
+
 OccupancyDecayIntegrator::OccupancyDecayIntegrator(DecayMode decay_mode)
     : DecayIntegratorBase(decay_mode) {
   if (decay_mode == DecayMode::kDecayToDeallocate) {
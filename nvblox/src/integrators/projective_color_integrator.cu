@@ -204,6 +204,17 @@ parameters::ParameterTreeNode ProjectiveColorIntegrator::getParameterTree(
             });
 }
 
+MemoryUsage ProjectiveColorIntegrator::getScratchMemoryUsage() const {
+  MemoryUsage usage = ProjectiveIntegrator<ColorVoxel>::getScratchMemoryUsage();
+  usage += view_calculator_.getScratchMemoryUsage();
+  usage += synthetic_depth_images_.getMemoryUsage();
+  usage.addVector(truncation_band_block_ptrs_device_);
+  usage.addVector(truncation_band_block_ptrs_host_);
+  usage.addVector(block_in_truncation_band_device_);
+  usage.addVector(block_in_truncation_band_host_);
+  return usage;
+}
+
 __device__ inline Color blendTwoColors(const Color& first_color,
                                        float first_weight,
                                        const Color& second_color,
@@ -25,25 +25,40 @@ namespace nvblox {
 struct UpdateOccupancyVoxelFunctor {
   UpdateOccupancyVoxelFunctor() {}
 
+  // Works for both OccupancyVoxel and QuantizedOccupancyVoxel.
+  template <typename OccupancyVoxelType>
   __device__ bool operator()(const float surface_depth_measured,
                              const float voxel_depth_m,
-                             OccupancyVoxel* voxel_ptr) {
+                             OccupancyVoxelType* voxel_ptr) {
     // Get the update summand depending on the measured depth
     float log_odds_update;
+    int32_t quantized_log_odds_update;
     if (voxel_depth_m <
         surface_depth_measured - occupied_region_half_width_m_) {
       log_odds_update = free_region_log_odds_;
+      quantized_log_odds_update = quantized_free_region_log_odds_;
     } else if (voxel_depth_m <=
                surface_depth_measured + occupied_region_half_width_m_) {
       log_odds_update = occupied_region_log_odds_;
+      quantized_log_odds_update = quantized_occupied_region_log_odds_;
     } else {
       log_odds_update = unobserved_region_log_odds_;
+      quantized_log_odds_update = quantized_unobserved_region_log_odds_;
     }
 
-    // Update and clip
-    float updated_log_odds = voxel_ptr->log_odds + log_odds_update;
-    voxel_ptr->log_odds =
-        fmax(kMinLogOdds_, fmin(updated_log_odds, kMaxLogOdds_));
+    if constexpr (std::is_same<QuantizedOccupancyVoxel,
+                               OccupancyVoxelType>::value) {
+      // Fixed point update. The summands and bounds are quantized once per
+      // frame, so the update is a saturating integer addition.
+      voxel_ptr->log_odds.addSaturating(quantized_log_odds_update,
+                                        kQuantizedMinLogOdds_,
+                                        kQuantizedMaxLogOdds_);
+    } else {
+      // Update and clip
+      float updated_log_odds = voxel_ptr->log_odds + log_odds_update;
+      voxel_ptr->log_odds =
+          fmax(kMinLogOdds_, fmin(updated_log_odds, kMaxLogOdds_));
+    }
 
     return true;
   }
@@ -58,9 +73,55 @@ struct UpdateOccupancyVoxelFunctor {
   float occupied_region_half_width_m_ =
       kOccupiedRegionHalfWidthMParamDesc.default_value;
 
+  // The sensor model parameters in fixed point units, for updating
+  // QuantizedOccupancyVoxels.
+  int32_t quantized_free_region_log_odds_ = 0;
+  int32_t quantized_occupied_region_log_odds_ = 0;
+  int32_t quantized_unobserved_region_log_odds_ = 0;
+
   // Min and max values for clipping
   const float kMaxLogOdds_ = logOddsFromProbability(0.99);
   const float kMinLogOdds_ = logOddsFromProbability(0.01);
+  const int32_t kQuantizedMaxLogOdds_ =
+      QuantizedLogOdds::quantize(kMaxLogOdds_);
+  const int32_t kQuantizedMinLogOdds_ =
+      QuantizedLogOdds::quantize(kMinLogOdds_);
+};
+
+// Integrates into QuantizedOccupancyLayers on behalf of the
+// ProjectiveOccupancyIntegrator. The projective integration machinery (and
+// its scratch buffers) is typed on the voxel, so the quantized layers need
+// their own ProjectiveIntegrator. It takes over the parameters of the
+// ProjectiveOccupancyIntegrator before each use.
+class ProjectiveQuantizedOccupancyIntegrator
+    : public ProjectiveIntegrator<QuantizedOccupancyVoxel> {
+ public:
+  ProjectiveQuantizedOccupancyIntegrator(
+      std::shared_ptr<CudaStream> cuda_stream)
+      : ProjectiveIntegrator<QuantizedOccupancyVoxel>(cuda_stream) {}
+  virtual ~ProjectiveQuantizedOccupancyIntegrator() = default;
+
+  using ProjectiveIntegrator<QuantizedOccupancyVoxel>::integrateFrame;
+  using ProjectiveIntegrator<
+      QuantizedOccupancyVoxel>::markUnobservedFreeInsideRadiusTemplate;
+
+  void copyParameters(const ProjectiveIntegrator<OccupancyVoxel>& other) {
+    truncation_distance_vox(other.truncation_distance_vox());
+    max_integration_distance_m(other.max_integration_distance_m());
+    lidar_linear_interpolation_max_allowable_difference_vox(
+        other.lidar_linear_interpolation_max_allowable_difference_vox());
+    lidar_nearest_interpolation_max_allowable_dist_to_ray_vox(
+        other.lidar_nearest_interpolation_max_allowable_dist_to_ray_vox());
+    view_calculator_.raycast_subsampling_factor(
+        other.view_calculator().raycast_subsampling_factor());
+    view_calculator_.raycast_to_pixels(
+        other.view_calculator().raycast_to_pixels());
+  }
+
+ protected:
+  std::string getIntegratorName() const override {
+    return "quantized_occupancy";
+  }
 };
 
 ProjectiveOccupancyIntegrator::ProjectiveOccupancyIntegrator()
@@ -102,6 +163,42 @@ void ProjectiveOccupancyIntegrator::integrateFrame(
       layer, updated_blocks);
 }
 
+ProjectiveQuantizedOccupancyIntegrator&
+ProjectiveOccupancyIntegrator::getQuantizedIntegrator() {
+  if (!quantized_integrator_) {
+    quantized_integrator_ =
+        std::make_unique<ProjectiveQuantizedOccupancyIntegrator>(cuda_stream_);
+  }
+  quantized_integrator_->copyParameters(*this);
+  return *quantized_integrator_;
+}
+
+void ProjectiveOccupancyIntegrator::integrateFrame(
+    const DepthImage& depth_frame, const Transform& T_L_C, const Camera& camera,
+    QuantizedOccupancyLayer* layer, std::vector<Index3D>* updated_blocks) {
+  CHECK_NOTNULL(layer);
+  // NOTE: Set the functor parameters first. They may change the truncation
+  // distance, which is then copied to the quantized integrator.
+  setFunctorParameters(layer->voxel_size());
+  getQuantizedIntegrator().integrateFrame(
+      depth_frame, T_L_C, camera,
+      update_functor_host_ptr_.cloneAsync(MemoryType::kDevice, *cuda_stream_)
+          .get(),
+      layer, updated_blocks);
+}
+
+void ProjectiveOccupancyIntegrator::integrateFrame(
+    const DepthImage& depth_frame, const Transform& T_L_C, const Lidar& lidar,
+    QuantizedOccupancyLayer* layer, std::vector<Index3D>* updated_blocks) {
+  CHECK_NOTNULL(layer);
+  setFunctorParameters(layer->voxel_size());
+  getQuantizedIntegrator().integrateFrame(
+      depth_frame, T_L_C, lidar,
+      update_functor_host_ptr_.cloneAsync(MemoryType::kDevice, *cuda_stream_)
+          .get(),
+      layer, updated_blocks);
+}
+
 void ProjectiveOccupancyIntegrator::setFunctorParameters(
     const float voxel_size) {
   update_functor_host_ptr_->free_region_log_odds_ = free_region_log_odds_;
@@ -111,6 +208,12 @@ void ProjectiveOccupancyIntegrator::setFunctorParameters(
       unobserved_region_log_odds_;
   update_functor_host_ptr_->occupied_region_half_width_m_ =
       occupied_region_half_width_m_;
+  update_functor_host_ptr_->quantized_free_region_log_odds_ =
+      QuantizedLogOdds::quantize(free_region_log_odds_);
+  update_functor_host_ptr_->quantized_occupied_region_log_odds_ =
+      QuantizedLogOdds::quantize(occupied_region_log_odds_);
+  update_functor_host_ptr_->quantized_unobserved_region_log_odds_ =
+      QuantizedLogOdds::quantize(unobserved_region_log_odds_);
 
   // Make sure all blocks that are considered
   // occupied by the sensor model are updated.
@@ -179,6 +282,22 @@ void ProjectiveOccupancyIntegrator::markUnobservedFreeInsideRadius(
                                          updated_blocks_ptr);
 }
 
+void ProjectiveOccupancyIntegrator::markUnobservedFreeInsideRadius(
+    const Vector3f& center, float radius, QuantizedOccupancyLayer* layer,
+    std::vector<Index3D>* updated_blocks_ptr) {
+  getQuantizedIntegrator().markUnobservedFreeInsideRadiusTemplate(
+      center, radius, layer, updated_blocks_ptr);
+}
+
+MemoryUsage ProjectiveOccupancyIntegrator::getScratchMemoryUsage() const {
+  MemoryUsage usage =
+      ProjectiveIntegrator<OccupancyVoxel>::getScratchMemoryUsage();
+  if (quantized_integrator_) {
+    usage += quantized_integrator_->getScratchMemoryUsage();
+  }
+  return usage;
+}
+
 parameters::ParameterTreeNode ProjectiveOccupancyIntegrator::getParameterTree(
     const std::string& name_remap) const {
   using parameters::ParameterTreeNode;
@@ -27,8 +27,11 @@ struct UpdateTsdfVoxelFunctor {
   __host__ __device__ ~UpdateTsdfVoxelFunctor() = default;
 
   // Vector3f p_voxel_C, float depth, TsdfVoxel* voxel_ptr
+  // Fusion is done in float for both the TsdfVoxel and the CompactTsdfVoxel.
+  template <typename TsdfVoxelType>
   __device__ bool operator()(const float surface_depth_measured,
-                             const float voxel_depth_m, TsdfVoxel* voxel_ptr) {
+                             const float voxel_depth_m,
+                             TsdfVoxelType* voxel_ptr) {
     // Get the distance between the voxel we're updating the surface.
     // Note that the distance is the projective distance, i.e. the distance
     // along the ray.
@@ -79,6 +82,38 @@ struct UpdateTsdfVoxelFunctor {
       kProjectiveIntegratorWeightingModeParamDesc.default_value;
 };
 
+// Integrates into CompactTsdfLayers on behalf of the ProjectiveTsdfIntegrator.
+// The projective integration machinery (and its scratch buffers) is typed on
+// the voxel, so the compact layers need their own ProjectiveIntegrator. It
+// takes over the parameters of the ProjectiveTsdfIntegrator before each use.
+class ProjectiveCompactTsdfIntegrator
+    : public ProjectiveIntegrator<CompactTsdfVoxel> {
+ public:
+  ProjectiveCompactTsdfIntegrator(std::shared_ptr<CudaStream> cuda_stream)
+      : ProjectiveIntegrator<CompactTsdfVoxel>(cuda_stream) {}
+  virtual ~ProjectiveCompactTsdfIntegrator() = default;
+
+  using ProjectiveIntegrator<CompactTsdfVoxel>::integrateFrame;
+  using ProjectiveIntegrator<
+      CompactTsdfVoxel>::markUnobservedFreeInsideRadiusTemplate;
+
+  void copyParameters(const ProjectiveIntegrator<TsdfVoxel>& other) {
+    truncation_distance_vox(other.truncation_distance_vox());
+    max_integration_distance_m(other.max_integration_distance_m());
+    lidar_linear_interpolation_max_allowable_difference_vox(
+        other.lidar_linear_interpolation_max_allowable_difference_vox());
+    lidar_nearest_interpolation_max_allowable_dist_to_ray_vox(
+        other.lidar_nearest_interpolation_max_allowable_dist_to_ray_vox());
+    view_calculator_.raycast_subsampling_factor(
+        other.view_calculator().raycast_subsampling_factor());
+    view_calculator_.raycast_to_pixels(
+        other.view_calculator().raycast_to_pixels());
+  }
+
+ protected:
+  std::string getIntegratorName() const override { return "compact_tsdf"; }
+};
+
 ProjectiveTsdfIntegrator::ProjectiveTsdfIntegrator()
     : ProjectiveTsdfIntegrator(std::make_shared<CudaStreamOwning>()) {}
 
@@ -134,6 +169,38 @@ void ProjectiveTsdfIntegrator::integrateFrame(
       updated_blocks);
 }
 
+ProjectiveCompactTsdfIntegrator&
+ProjectiveTsdfIntegrator::getCompactIntegrator() {
+  if (!compact_integrator_) {
+    compact_integrator_ =
+        std::make_unique<ProjectiveCompactTsdfIntegrator>(cuda_stream_);
+  }
+  compact_integrator_->copyParameters(*this);
+  return *compact_integrator_;
+}
+
+void ProjectiveTsdfIntegrator::integrateFrame(
+    const DepthImage& depth_frame, const Transform& T_L_C, const Camera& camera,
+    CompactTsdfLayer* layer, std::vector<Index3D>* updated_blocks) {
+  CHECK_NOTNULL(layer);
+  unified_ptr<UpdateTsdfVoxelFunctor> update_functor_device_ptr =
+      getTsdfUpdateFunctorOnDevice(layer->voxel_size());
+  getCompactIntegrator().integrateFrame(depth_frame, T_L_C, camera,
+                                        update_functor_device_ptr.get(), layer,
+                                        updated_blocks);
+}
+
+void ProjectiveTsdfIntegrator::integrateFrame(
+    const DepthImage& depth_frame, const Transform& T_L_C, const Lidar& lidar,
+    CompactTsdfLayer* layer, std::vector<Index3D>* updated_blocks) {
+  CHECK_NOTNULL(layer);
+  unified_ptr<UpdateTsdfVoxelFunctor> update_functor_device_ptr =
+      getTsdfUpdateFunctorOnDevice(layer->voxel_size());
+  getCompactIntegrator().integrateFrame(depth_frame, T_L_C, lidar,
+                                        update_functor_device_ptr.get(), layer,
+                                        updated_blocks);
+}
+
 float ProjectiveTsdfIntegrator::max_weight() const { return max_weight_; }
 
 void ProjectiveTsdfIntegrator::max_weight(float max_weight) {
@@ -180,6 +247,21 @@ void ProjectiveTsdfIntegrator::markUnobservedFreeInsideRadius(
                                          updated_blocks_ptr);
 }
 
+void ProjectiveTsdfIntegrator::markUnobservedFreeInsideRadius(
+    const Vector3f& center, float radius, CompactTsdfLayer* layer,
+    std::vector<Index3D>* updated_blocks_ptr) {
+  getCompactIntegrator().markUnobservedFreeInsideRadiusTemplate(
+      center, radius, layer, updated_blocks_ptr);
+}
+
+MemoryUsage ProjectiveTsdfIntegrator::getScratchMemoryUsage() const {
+  MemoryUsage usage = ProjectiveIntegrator<TsdfVoxel>::getScratchMemoryUsage();
+  if (compact_integrator_) {
+    usage += compact_integrator_->getScratchMemoryUsage();
+  }
+  return usage;
+}
+
 parameters::ParameterTreeNode ProjectiveTsdfIntegrator::getParameterTree(
     const std::string& name_remap) const {
   using parameters::ParameterTreeNode;
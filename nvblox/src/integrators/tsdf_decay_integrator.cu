@@ -78,17 +78,39 @@ struct TsdfDecayFunctor {
   /// Return true if the passed voxel is fully decayed
   /// @param voxel_ptr The voxel to check
   /// @return True if fully decayed
-  __device__ bool isFullyDecayed(TsdfVoxel* voxel_ptr) const {
+  template <typename TsdfVoxelType>
+  __device__ bool isFullyDecayed(TsdfVoxelType* voxel_ptr) const {
     constexpr float kEps = 1e-6;
     return (voxel_ptr->weight < (decayed_weight_threshold_ + kEps));
   }
 
+  /// Return the number of decay steps after which the voxel is fully decayed.
+  /// Used to schedule the epoch-based decay.
+  /// @param voxel_ptr The voxel to check
+  /// @return The number of steps. Zero if the voxel is fully decayed.
+  template <typename TsdfVoxelType>
+  __device__ int numDecaysUntilFullyDecayed(TsdfVoxelType* voxel_ptr) const {
+    if (isFullyDecayed(voxel_ptr)) {
+      return 0;
+    }
+    // The voxel is fully decayed after n steps if
+    // weight * decay_factor^n < decayed_weight_threshold.
+    constexpr float kEps = 1e-6;
+    constexpr float kMaxNumDecays = 1e9f;
+    const float num_decays =
+        logf((decayed_weight_threshold_ + kEps) / voxel_ptr->weight) /
+        logf(decay_factor_);
+    return static_cast<int>(floorf(fminf(num_decays, kMaxNumDecays))) + 1;
+  }
+
   __host__ __device__ ~TsdfDecayFunctor() = default;
 
-  /// Decays a single TSDF voxel.
+  /// Decays a single TSDF voxel. Works for both TsdfVoxel and
+  /// CompactTsdfVoxel.
   /// @param voxel_ptr voxel to decay
   /// @return True if the voxel is fully decayed
-  __device__ void operator()(TsdfVoxel* voxel_ptr) const {
+  template <typename TsdfVoxelType>
+  __device__ void operator()(TsdfVoxelType* voxel_ptr) const {
     // Load the weight from global memory
     float weight = voxel_ptr->weight;
 
@@ -164,6 +186,47 @@ std::vector<Index3D> TsdfDecayIntegrator::decay(
   }
 }
 
+std::vector<Index3D> TsdfDecayIntegrator::decay(
+    CompactTsdfLayer* layer_ptr,
+    const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+    const std::optional<DecayViewExclusionOptions>& view_exclusion_options,
+    const CudaStream cuda_stream) {
+  const float free_distance_m = free_distance_vox_ * layer_ptr->voxel_size();
+  TsdfDecayFunctor voxel_decayer(decay_factor_, decayed_weight_threshold_,
+                                 set_free_distance_on_decayed_,
+                                 free_distance_m);
+  return compact_decayer_.decay(layer_ptr, voxel_decayer,
+                                deallocate_decayed_blocks_,
+                                block_exclusion_options,
+                                view_exclusion_options, cuda_stream);
+}
+
+std::vector<Index3D> TsdfDecayIntegrator::decayEpoch(
+    TsdfLayer* layer_ptr,
+    const std::optional<DecayBlockExclusionOptions>& block_exclusion_options,
+    const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) {
+  const float free_distance_m = free_distance_vox_ * layer_ptr->voxel_size();
+  TsdfDecayFunctor voxel_decayer(decay_factor_, decayed_weight_threshold_,
+                                 set_free_distance_on_decayed_,
+                                 free_distance_m);
+  return decayer_.decayEpoch(layer_ptr, voxel_decayer,
+                             deallocate_decayed_blocks_, block_exclusion_options,
+                             &epoch_tracker_, cuda_stream, changed_blocks);
+}
+
+std::vector<Index3D> TsdfDecayIntegrator::applyPendingDecay(
+    TsdfLayer* layer_ptr, const std::vector<Index3D>& block_indices,
+    const CudaStream cuda_stream, std::vector<Index3D>* changed_blocks) {
+  const float free_distance_m = free_distance_vox_ * layer_ptr->voxel_size();
+  TsdfDecayFunctor voxel_decayer(decay_factor_, decayed_weight_threshold_,
+                                 set_free_distance_on_decayed_,
+                                 free_distance_m);
+  return decayer_.applyPendingDecay(layer_ptr, voxel_decayer,
+                                    deallocate_decayed_blocks_, block_indices,
+                                    &epoch_tracker_, cuda_stream,
+                                    changed_blocks);
+}
+
 parameters::ParameterTreeNode TsdfDecayIntegrator::getParameterTree(
     const std::string& name_remap) const {
   using parameters::ParameterTreeNode;
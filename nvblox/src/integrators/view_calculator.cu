@@ -53,6 +53,13 @@ parameters::ParameterTreeNode ViewCalculator::getParameterTree(
             });
 }
 
+MemoryUsage ViewCalculator::getScratchMemoryUsage() const {
+  MemoryUsage usage;
+  usage.addVector(aabb_device_buffer_);
+  usage.addVector(aabb_host_buffer_);
+  return usage;
+}
+
 // AABB linear indexing
 // - We index in x-major, i.e. x is varied first, then y, then z.
 // - Linear indexing within an AABB is relative and starts at zero. This is
@@ -38,6 +38,24 @@ bool interpolateOnCPU(const Vector3f& p_L, const TsdfLayer& layer,
       p_L, layer, get_distance_lambda, voxel_valid_lambda, distance_ptr);
 }
 
+bool interpolateOnCPU(const Vector3f& p_L, const CompactTsdfLayer& layer,
+                      float* distance_ptr) {
+  CHECK_NOTNULL(distance_ptr);
+  CHECK(layer.memory_type() == MemoryType::kHost ||
+        layer.memory_type() == MemoryType::kUnified)
+      << "For CPU-based interpolation, the layer must be CPU accessible (ie "
+         "MemoryType::kUnified).";
+  auto get_distance_lambda = [](const CompactTsdfVoxel& voxel) -> float {
+    return voxel.distance;
+  };
+  constexpr float kMinWeight = 1e-4;
+  auto voxel_valid_lambda = [](const CompactTsdfVoxel& voxel) -> bool {
+    return voxel.weight > kMinWeight;
+  };
+  return internal::interpolateMemberOnCPU<CompactTsdfVoxel>(
+      p_L, layer, get_distance_lambda, voxel_valid_lambda, distance_ptr);
+}
+
 bool interpolateOnCPU(const Vector3f& p_L, const EsdfLayer& layer,
                       float* distance_ptr) {
   CHECK_NOTNULL(distance_ptr);
@@ -70,6 +88,24 @@ bool interpolateOnCPU(const Vector3f& p_L, const OccupancyLayer& layer,
       p_L, layer, get_probability_lambda, voxel_valid_lambda, probability_ptr);
 }
 
+bool interpolateOnCPU(const Vector3f& p_L, const QuantizedOccupancyLayer& layer,
+                      float* probability_ptr) {
+  CHECK_NOTNULL(probability_ptr);
+  CHECK(layer.memory_type() == MemoryType::kHost ||
+        layer.memory_type() == MemoryType::kUnified)
+      << "For CPU-based interpolation, the layer must be CPU accessible (ie "
+         "MemoryType::kUnified).";
+  auto get_probability_lambda =
+      [](const QuantizedOccupancyVoxel& voxel) -> float {
+    return probabilityFromLogOdds(voxel.log_odds);
+  };
+  auto voxel_valid_lambda = [](const QuantizedOccupancyVoxel&) -> bool {
+    return true;
+  };
+  return internal::interpolateMemberOnCPU<QuantizedOccupancyVoxel>(
+      p_L, layer, get_probability_lambda, voxel_valid_lambda, probability_ptr);
+}
+
 namespace internal {
 
 Eigen::Matrix<float, 8, 1> getQVector3D(const Vector3f& p_offset_in_voxels_L) {
@@ -0,0 +1,184 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/io/async_output_writer.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "nvblox/io/image_io.h"
+#include "nvblox/io/mesh_io.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+AsyncOutputWriter::AsyncOutputWriter(int num_threads, int max_queue_size,
+                                     OutputQueueFullPolicy queue_full_policy)
+    : max_queue_size_(max_queue_size), queue_full_policy_(queue_full_policy) {
+  CHECK_GT(num_threads, 0);
+  CHECK_GT(max_queue_size_, 0);
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&AsyncOutputWriter::workerLoop, this);
+  }
+}
+
+AsyncOutputWriter::~AsyncOutputWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  output_queued_condition_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool AsyncOutputWriter::writeAsync(const std::string& name,
+                                   WriteFunction write_function) {
+  CHECK(write_function);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (static_cast<int>(queue_.size()) >= max_queue_size_) {
+    switch (queue_full_policy_) {
+      case OutputQueueFullPolicy::kBlock:
+        output_taken_condition_.wait(lock, [this]() {
+          return static_cast<int>(queue_.size()) < max_queue_size_;
+        });
+        break;
+      case OutputQueueFullPolicy::kDropNewest:
+        ++stats_.num_dropped;
+        LOG(WARNING) << "Output queue full. Dropping output: " << name;
+        return false;
+      default:
+        ++stats_.num_dropped;
+        LOG(WARNING) << "Output queue full. Dropping output: "
+                     << queue_.front().name;
+        queue_.pop_front();
+        break;
+    }
+  }
+  queue_.push_back({name, std::move(write_function)});
+  ++stats_.num_queued;
+  stats_.max_queue_depth =
+      std::max(stats_.max_queue_depth, static_cast<int>(queue_.size()));
+  lock.unlock();
+  output_queued_condition_.notify_one();
+  return true;
+}
+
+bool AsyncOutputWriter::writePngAsync(const std::string& filepath,
+                                      const ColorImage& image) {
+  timing::Timer timer("async_output_writer/copy_image");
+  auto image_host = std::make_shared<ColorImage>(MemoryType::kHost);
+  image_host->copyFrom(image);
+  timer.Stop();
+  return writeAsync(filepath, [filepath, image_host]() {
+    timing::Timer timer("async_output_writer/write_png");
+    return io::writeToPng(filepath, *image_host);
+  });
+}
+
+bool AsyncOutputWriter::writePngAsync(const std::string& filepath,
+                                      const MonoImage& image) {
+  timing::Timer timer("async_output_writer/copy_image");
+  auto image_host = std::make_shared<MonoImage>(MemoryType::kHost);
+  image_host->copyFrom(image);
+  timer.Stop();
+  return writeAsync(filepath, [filepath, image_host]() {
+    timing::Timer timer("async_output_writer/write_png");
+    return io::writeToPng(filepath, *image_host);
+  });
+}
+
+bool AsyncOutputWriter::writeMeshPlyAsync(const std::string& filepath,
+                                          const MeshLayer& mesh_layer) {
+  timing::Timer timer("async_output_writer/copy_mesh");
+  auto mesh_layer_copy = std::make_shared<MeshLayer>(
+      mesh_layer.block_size(), mesh_layer.memory_type());
+  mesh_layer_copy->copyFrom(mesh_layer);
+  timer.Stop();
+  return writeAsync(filepath, [filepath, mesh_layer_copy]() {
+    timing::Timer timer("async_output_writer/write_mesh_ply");
+    return io::outputMeshLayerToPly(*mesh_layer_copy, filepath);
+  });
+}
+
+bool AsyncOutputWriter::writeTextAsync(const std::string& filepath,
+                                       std::string contents) {
+  auto contents_ptr = std::make_shared<std::string>(std::move(contents));
+  return writeAsync(filepath, [filepath, contents_ptr]() {
+    timing::Timer timer("async_output_writer/write_text");
+    std::ofstream file(filepath);
+    if (!file) {
+      return false;
+    }
+    file << *contents_ptr;
+    return static_cast<bool>(file);
+  });
+}
+
+void AsyncOutputWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  output_taken_condition_.wait(lock, [this]() {
+    return queue_.empty() && num_outputs_in_progress_ == 0;
+  });
+}
+
+int AsyncOutputWriter::queueDepth() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int>(queue_.size());
+}
+
+AsyncOutputWriterStats AsyncOutputWriter::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AsyncOutputWriterStats stats = stats_;
+  stats.queue_depth = static_cast<int>(queue_.size());
+  return stats;
+}
+
+void AsyncOutputWriter::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    output_queued_condition_.wait(
+        lock, [this]() { return stop_ || !queue_.empty(); });
+    // Write everything queued before stopping.
+    if (queue_.empty()) {
+      return;
+    }
+    Output output = std::move(queue_.front());
+    queue_.pop_front();
+    ++num_outputs_in_progress_;
+    lock.unlock();
+    output_taken_condition_.notify_all();
+
+    timing::Timer timer("async_output_writer/write");
+    const bool success = output.write_function();
+    timer.Stop();
+    if (!success) {
+      LOG(WARNING) << "Failed to write output: " << output.name;
+    }
+
+    lock.lock();
+    --num_outputs_in_progress_;
+    if (success) {
+      ++stats_.num_written;
+    } else {
+      ++stats_.num_failed;
+    }
+    output_taken_condition_.notify_all();
+  }
+}
+
+}  // namespace nvblox
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <vector>
 
+#include "nvblox/core/indexing.h"
 #include "nvblox/io/ply_writer.h"
 #include "nvblox/mesh/mesh.h"
 
@@ -46,5 +47,23 @@ bool outputMeshLayerToPly(const BlockLayer<MeshBlock>& layer,
   return outputMeshLayerToPly(layer, std::string(filename));
 }
 
+bool outputMeshLayerToPly(const BlockLayer<MeshBlock>& layer,
+                          const MeshLodLayers& lods, const Vector3f& viewpoint,
+                          const std::string& filename) {
+  const std::vector<Index3D> block_indices = layer.getAllBlockIndices();
+  std::vector<int> block_lods;
+  block_lods.reserve(block_indices.size());
+  for (const Index3D& block_idx : block_indices) {
+    const Vector3f block_center =
+        getCenterPositionFromBlockIndex(layer.block_size(), block_idx);
+    block_lods.push_back(
+        lods.selectLodForDistance((block_center - viewpoint).norm()));
+  }
+  BlockLayer<MeshBlock> mixed_lod_layer(layer.block_size(), MemoryType::kHost);
+  lods.assembleMixedLodLayer(layer, block_indices, block_lods,
+                             &mixed_lod_layer);
+  return outputMeshLayerToPly(mixed_lod_layer, filename);
+}
+
 }  // namespace io
 }  // namespace nvblox
@@ -0,0 +1,192 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/map/block_distance_summary.h"
+
+#include "nvblox/core/internal/cuda/atomic_float.cuh"
+#include "nvblox/core/internal/error_check.h"
+#include "nvblox/integrators/internal/integrators_common.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+namespace {
+
+__host__ __device__ inline bool getVoxelDistance(const EsdfVoxel& voxel,
+                                                 const float voxel_size,
+                                                 const float,
+                                                 float* distance_m) {
+  if (!voxel.observed) {
+    return false;
+  }
+  const float distance = voxel_size * sqrtf(voxel.squared_distance_vox);
+  *distance_m = voxel.is_inside ? -distance : distance;
+  return true;
+}
+
+__host__ __device__ inline bool getVoxelDistance(const TsdfVoxel& voxel,
+                                                 const float,
+                                                 const float min_weight,
+                                                 float* distance_m) {
+  if (voxel.weight < min_weight) {
+    return false;
+  }
+  *distance_m = voxel.distance;
+  return true;
+}
+
+template <typename VoxelType>
+__global__ void summarizeBlocksKernel(
+    const VoxelBlock<VoxelType>** block_ptrs, const float voxel_size,
+    const float min_weight, BlockDistanceSummary* summaries) {
+  __shared__ float min_distance_shared;
+  __shared__ float max_distance_shared;
+  __shared__ int num_observed_shared;
+  const bool is_first_thread =
+      (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0);
+  if (is_first_thread) {
+    min_distance_shared = std::numeric_limits<float>::max();
+    max_distance_shared = std::numeric_limits<float>::lowest();
+    num_observed_shared = 0;
+  }
+  __syncthreads();
+
+  // One thread per voxel
+  const VoxelType& voxel =
+      block_ptrs[blockIdx.x]->voxels[threadIdx.z][threadIdx.y][threadIdx.x];
+  float distance_m;
+  if (getVoxelDistance(voxel, voxel_size, min_weight, &distance_m)) {
+    atomicMinFloat(&min_distance_shared, distance_m);
+    atomicMaxFloat(&max_distance_shared, distance_m);
+    atomicAdd(&num_observed_shared, 1);
+  }
+  __syncthreads();
+
+  // One thread writes the output
+  if (is_first_thread) {
+    constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+    BlockDistanceSummary* summary = &summaries[blockIdx.x];
+    summary->min_distance_m = min_distance_shared;
+    summary->max_distance_m = max_distance_shared;
+    summary->num_observed_voxels = num_observed_shared;
+    summary->num_voxels = kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
+  }
+}
+
+template <typename VoxelType>
+BlockDistanceSummary summarizeBlockOnHost(const VoxelBlock<VoxelType>& block,
+                                          const float voxel_size,
+                                          const float min_weight) {
+  constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+  BlockDistanceSummary summary;
+  summary.num_voxels = kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        float distance_m;
+        if (getVoxelDistance(block.voxels[x][y][z], voxel_size, min_weight,
+                             &distance_m)) {
+          summary.min_distance_m = std::min(summary.min_distance_m, distance_m);
+          summary.max_distance_m = std::max(summary.max_distance_m, distance_m);
+          ++summary.num_observed_voxels;
+        }
+      }
+    }
+  }
+  return summary;
+}
+
+}  // namespace
+
+BlockDistanceSummarizer::BlockDistanceSummarizer()
+    : BlockDistanceSummarizer(std::make_shared<CudaStreamOwning>()) {}
+
+BlockDistanceSummarizer::BlockDistanceSummarizer(
+    std::shared_ptr<CudaStream> cuda_stream)
+    : cuda_stream_(cuda_stream) {}
+
+void BlockDistanceSummarizer::tsdf_min_weight(float tsdf_min_weight) {
+  CHECK_GE(tsdf_min_weight, 0.0f);
+  tsdf_min_weight_ = tsdf_min_weight;
+}
+
+std::vector<BlockDistanceSummary> BlockDistanceSummarizer::summarize(
+    const EsdfLayer& layer, const std::vector<Index3D>& block_indices) {
+  return summarizeTemplate(layer, block_indices, &esdf_block_ptrs_host_,
+                           &esdf_block_ptrs_device_);
+}
+
+std::vector<BlockDistanceSummary> BlockDistanceSummarizer::summarize(
+    const TsdfLayer& layer, const std::vector<Index3D>& block_indices) {
+  return summarizeTemplate(layer, block_indices, &tsdf_block_ptrs_host_,
+                           &tsdf_block_ptrs_device_);
+}
+
+template <typename VoxelType>
+std::vector<BlockDistanceSummary> BlockDistanceSummarizer::summarizeTemplate(
+    const VoxelBlockLayer<VoxelType>& layer,
+    const std::vector<Index3D>& block_indices,
+    host_vector<const VoxelBlock<VoxelType>*>* block_ptrs_host,
+    device_vector<const VoxelBlock<VoxelType>*>* block_ptrs_device) {
+  CHECK_NOTNULL(block_ptrs_host);
+  CHECK_NOTNULL(block_ptrs_device);
+  timing::Timer timer("block_distance_summary/summarize");
+
+  if (block_indices.empty()) {
+    return std::vector<BlockDistanceSummary>();
+  }
+  const std::vector<const VoxelBlock<VoxelType>*> block_ptrs =
+      getBlockPtrsFromIndices(block_indices, layer);
+
+  // Host layers are summarized on the CPU.
+  if (layer.memory_type() == MemoryType::kHost) {
+    std::vector<BlockDistanceSummary> summaries;
+    summaries.reserve(block_ptrs.size());
+    for (const VoxelBlock<VoxelType>* block_ptr : block_ptrs) {
+      summaries.push_back(summarizeBlockOnHost(*block_ptr, layer.voxel_size(),
+                                               tsdf_min_weight_));
+    }
+    return summaries;
+  }
+
+  // Stage the block pointers on the device
+  const int num_blocks = block_ptrs.size();
+  expandBuffersIfRequired(num_blocks, *cuda_stream_, block_ptrs_host,
+                          block_ptrs_device, &summaries_device_,
+                          &summaries_host_);
+  block_ptrs_host->copyFromAsync(block_ptrs, *cuda_stream_);
+  block_ptrs_device->copyFromAsync(*block_ptrs_host, *cuda_stream_);
+  summaries_device_.resizeAsync(num_blocks, *cuda_stream_);
+
+  // Kernel call - One ThreadBlock launched per VoxelBlock
+  constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+  const dim3 kThreadsPerBlock(kVoxelsPerSide, kVoxelsPerSide, kVoxelsPerSide);
+  summarizeBlocksKernel<VoxelType>
+      <<<num_blocks, kThreadsPerBlock, 0, *cuda_stream_>>>(
+          block_ptrs_device->data(),  // NOLINT
+          layer.voxel_size(),         // NOLINT
+          tsdf_min_weight_,           // NOLINT
+          summaries_device_.data()    // NOLINT
+      );
+  checkCudaErrors(cudaPeekAtLastError());
+
+  // Copy results back to host and synchronize
+  summaries_host_.copyFromAsync(summaries_device_, *cuda_stream_);
+  cuda_stream_->synchronize();
+  CHECK_EQ(summaries_host_.size(), block_ptrs.size());
+  return summaries_host_.toVector();
+}
+
+}  // namespace nvblox
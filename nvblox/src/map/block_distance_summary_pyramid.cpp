@@ -0,0 +1,352 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cmath>
+
+#include "nvblox/map/block_distance_summary.h"
+#include "nvblox/utils/logging.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+namespace {
+
+// The number of voxels summarized by a single level-0 node.
+constexpr int kVoxelsPerBlock = VoxelBlock<bool>::kVoxelsPerSide *
+                                VoxelBlock<bool>::kVoxelsPerSide *
+                                VoxelBlock<bool>::kVoxelsPerSide;
+
+// Above this the number of voxels per node overflows an int.
+constexpr int kMaxNumLevels = 8;
+
+// Whether the line segment from p_start to p_end touches the box.
+bool segmentIntersectsAABB(const Vector3f& p_start, const Vector3f& p_end,
+                           const AxisAlignedBoundingBox& aabb) {
+  constexpr float kEps = 1e-9f;
+  const Vector3f direction = p_end - p_start;
+  float t_min = 0.0f;
+  float t_max = 1.0f;
+  for (int i = 0; i < 3; i++) {
+    if (std::abs(direction[i]) < kEps) {
+      // Parallel to the slab
+      if (p_start[i] < aabb.min()[i] || p_start[i] > aabb.max()[i]) {
+        return false;
+      }
+    } else {
+      float t_1 = (aabb.min()[i] - p_start[i]) / direction[i];
+      float t_2 = (aabb.max()[i] - p_start[i]) / direction[i];
+      if (t_1 > t_2) {
+        std::swap(t_1, t_2);
+      }
+      t_min = std::max(t_min, t_1);
+      t_max = std::min(t_max, t_2);
+      if (t_min > t_max) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void worsenStatus(const CollisionStatus new_status, CollisionStatus* status) {
+  if (static_cast<int>(new_status) > static_cast<int>(*status)) {
+    *status = new_status;
+  }
+}
+
+}  // namespace
+
+BlockDistanceSummaryPyramid::BlockDistanceSummaryPyramid(int num_levels)
+    : BlockDistanceSummaryPyramid(num_levels,
+                                  std::make_shared<CudaStreamOwning>()) {}
+
+BlockDistanceSummaryPyramid::BlockDistanceSummaryPyramid(
+    int num_levels, std::shared_ptr<CudaStream> cuda_stream)
+    : levels_(num_levels), summarizer_(cuda_stream) {
+  CHECK_GT(num_levels, 0);
+  CHECK_LE(num_levels, kMaxNumLevels);
+}
+
+void BlockDistanceSummaryPyramid::updateBlocks(
+    const EsdfLayer& layer, const std::vector<Index3D>& block_indices) {
+  updateBlocksTemplate(layer, block_indices);
+}
+
+void BlockDistanceSummaryPyramid::updateBlocks(
+    const TsdfLayer& layer, const std::vector<Index3D>& block_indices) {
+  updateBlocksTemplate(layer, block_indices);
+}
+
+template <typename LayerType>
+void BlockDistanceSummaryPyramid::updateBlocksTemplate(
+    const LayerType& layer, const std::vector<Index3D>& block_indices) {
+  timing::Timer timer("block_distance_summary/update");
+  std::vector<Index3D> allocated_block_indices;
+  std::vector<Index3D> deallocated_block_indices;
+  allocated_block_indices.reserve(block_indices.size());
+  for (const Index3D& block_index : block_indices) {
+    if (layer.isBlockAllocated(block_index)) {
+      allocated_block_indices.push_back(block_index);
+    } else {
+      deallocated_block_indices.push_back(block_index);
+    }
+  }
+  const std::vector<BlockDistanceSummary> summaries =
+      summarizer_.summarize(layer, allocated_block_indices);
+  setBlockSummaries(layer.block_size(), layer.voxel_size(),
+                    allocated_block_indices, summaries);
+  removeBlocks(deallocated_block_indices);
+}
+
+void BlockDistanceSummaryPyramid::setBlockSummaries(
+    float block_size, float voxel_size,
+    const std::vector<Index3D>& block_indices,
+    const std::vector<BlockDistanceSummary>& summaries) {
+  CHECK_EQ(block_indices.size(), summaries.size());
+  CHECK_GT(block_size, 0.0f);
+  CHECK_GT(voxel_size, 0.0f);
+  if (block_size_ > 0.0f) {
+    CHECK_EQ(block_size_, block_size)
+        << "Summaries of layers with different block sizes can't be mixed.";
+  }
+  block_size_ = block_size;
+  voxel_size_ = voxel_size;
+
+  for (size_t i = 0; i < block_indices.size(); i++) {
+    levels_[0][block_indices[i]] = summaries[i];
+  }
+  updateParents(block_indices);
+}
+
+void BlockDistanceSummaryPyramid::removeBlocks(
+    const std::vector<Index3D>& block_indices) {
+  if (block_indices.empty()) {
+    return;
+  }
+  for (const Index3D& block_index : block_indices) {
+    levels_[0].erase(block_index);
+  }
+  updateParents(block_indices);
+}
+
+void BlockDistanceSummaryPyramid::clear() {
+  for (SummaryMap& level : levels_) {
+    level.clear();
+  }
+}
+
+void BlockDistanceSummaryPyramid::updateParents(
+    const std::vector<Index3D>& block_indices) {
+  std::vector<Index3D> child_indices = block_indices;
+  for (int level = 1; level < num_levels(); level++) {
+    // The unique parents of the changed children
+    Index3DSet parent_set;
+    for (const Index3D& child_index : child_indices) {
+      parent_set.insert(getParentIndex(child_index, 1));
+    }
+
+    // Recompute each parent from its (up to) 8 children
+    const int num_voxels_per_node = kVoxelsPerBlock * (1 << (3 * level));
+    const SummaryMap& children = levels_[level - 1];
+    for (const Index3D& parent_index : parent_set) {
+      BlockDistanceSummary summary;
+      summary.num_voxels = num_voxels_per_node;
+      bool has_children = false;
+      for (int x = 0; x < 2; x++) {
+        for (int y = 0; y < 2; y++) {
+          for (int z = 0; z < 2; z++) {
+            const auto it = children.find(2 * parent_index + Index3D(x, y, z));
+            if (it != children.end()) {
+              summary.mergeObserved(it->second);
+              has_children = true;
+            }
+          }
+        }
+      }
+      if (has_children) {
+        levels_[level][parent_index] = summary;
+      } else {
+        levels_[level].erase(parent_index);
+      }
+    }
+    child_indices.assign(parent_set.begin(), parent_set.end());
+  }
+}
+
+const BlockDistanceSummary* BlockDistanceSummaryPyramid::getSummary(
+    const Index3D& index, int level) const {
+  CHECK_GE(level, 0);
+  CHECK_LT(level, num_levels());
+  const auto it = levels_[level].find(index);
+  if (it == levels_[level].end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+size_t BlockDistanceSummaryPyramid::size(int level) const {
+  CHECK_GE(level, 0);
+  CHECK_LT(level, num_levels());
+  return levels_[level].size();
+}
+
+CollisionStatus BlockDistanceSummaryPyramid::checkSphere(
+    const Vector3f& center, float radius,
+    std::vector<Index3D>* blocks_to_check) const {
+  return checkCapsule(center, center, radius, blocks_to_check);
+}
+
+CollisionStatus BlockDistanceSummaryPyramid::checkCapsule(
+    const Vector3f& p_start, const Vector3f& p_end, float radius,
+    std::vector<Index3D>* blocks_to_check) const {
+  CHECK_GE(radius, 0.0f);
+  if (empty()) {
+    return CollisionStatus::kUnknown;
+  }
+
+  // The top-level nodes touched by the capsule axis
+  const int top_level = num_levels() - 1;
+  const float node_size = block_size_ * static_cast<float>(1 << top_level);
+  const Index3D min_index =
+      (p_start.cwiseMin(p_end) / node_size).array().floor().cast<int>();
+  const Index3D max_index =
+      (p_start.cwiseMax(p_end) / node_size).array().floor().cast<int>();
+
+  CollisionStatus status = CollisionStatus::kFree;
+  for (int x = min_index.x(); x <= max_index.x(); x++) {
+    for (int y = min_index.y(); y <= max_index.y(); y++) {
+      for (int z = min_index.z(); z <= max_index.z(); z++) {
+        const Index3D index(x, y, z);
+        if (!segmentIntersectsAABB(p_start, p_end,
+                                   getNodeAABB(index, top_level))) {
+          continue;
+        }
+        checkNode(index, top_level, p_start, p_end, radius, &status,
+                  blocks_to_check);
+        if (status == CollisionStatus::kOccupied) {
+          return status;
+        }
+      }
+    }
+  }
+  return status;
+}
+
+CollisionStatus BlockDistanceSummaryPyramid::checkPath(
+    const std::vector<Vector3f>& path, float radius,
+    std::vector<Index3D>* blocks_to_check) const {
+  if (path.empty()) {
+    return CollisionStatus::kFree;
+  }
+  if (path.size() == 1) {
+    return checkSphere(path.front(), radius, blocks_to_check);
+  }
+  CollisionStatus status = CollisionStatus::kFree;
+  Index3DSet blocks_to_check_set;
+  std::vector<Index3D> segment_blocks_to_check;
+  for (size_t i = 1; i < path.size(); i++) {
+    segment_blocks_to_check.clear();
+    worsenStatus(checkCapsule(path[i - 1], path[i], radius,
+                              &segment_blocks_to_check),
+                 &status);
+    if (status == CollisionStatus::kOccupied) {
+      break;
+    }
+    blocks_to_check_set.insert(segment_blocks_to_check.begin(),
+                               segment_blocks_to_check.end());
+  }
+  if (blocks_to_check != nullptr) {
+    blocks_to_check->insert(blocks_to_check->end(),
+                            blocks_to_check_set.begin(),
+                            blocks_to_check_set.end());
+  }
+  return status;
+}
+
+void BlockDistanceSummaryPyramid::checkNode(
+    const Index3D& index, int level, const Vector3f& p_start,
+    const Vector3f& p_end, float radius, CollisionStatus* status,
+    std::vector<Index3D>* blocks_to_check) const {
+  const BlockDistanceSummary* summary = getSummary(index, level);
+  if (summary == nullptr) {
+    worsenStatus(CollisionStatus::kUnknown, status);
+    return;
+  }
+
+  // The distance of any point in the node differs from the closest voxel
+  // center by at most half a voxel diagonal.
+  const float half_voxel_diagonal_m = 0.5f * std::sqrt(3.0f) * voxel_size_;
+  if (summary->isFullyObserved()) {
+    if (summary->min_distance_m - half_voxel_diagonal_m > radius) {
+      return;
+    }
+    if (summary->max_distance_m + half_voxel_diagonal_m < 0.0f) {
+      worsenStatus(CollisionStatus::kOccupied, status);
+      return;
+    }
+  }
+
+  if (level == 0) {
+    if (summary->isFullyUnknown()) {
+      worsenStatus(CollisionStatus::kUnknown, status);
+    } else {
+      worsenStatus(CollisionStatus::kUncertain, status);
+      if (blocks_to_check != nullptr) {
+        blocks_to_check->push_back(index);
+      }
+    }
+    return;
+  }
+
+  // Undecided: descend into the children touched by the capsule axis.
+  for (int x = 0; x < 2; x++) {
+    for (int y = 0; y < 2; y++) {
+      for (int z = 0; z < 2; z++) {
+        const Index3D child_index = 2 * index + Index3D(x, y, z);
+        if (!segmentIntersectsAABB(p_start, p_end,
+                                   getNodeAABB(child_index, level - 1))) {
+          continue;
+        }
+        checkNode(child_index, level - 1, p_start, p_end, radius, status,
+                  blocks_to_check);
+        if (*status == CollisionStatus::kOccupied) {
+          return;
+        }
+      }
+    }
+  }
+}
+
+Index3D BlockDistanceSummaryPyramid::getParentIndex(const Index3D& index,
+                                                    int levels_up) const {
+  const int divisor = 1 << levels_up;
+  Index3D parent_index;
+  for (int i = 0; i < 3; i++) {
+    // Floor division (rounding towards negative infinity)
+    parent_index[i] = (index[i] >= 0) ? index[i] / divisor
+                                      : -((-index[i] + divisor - 1) / divisor);
+  }
+  return parent_index;
+}
+
+AxisAlignedBoundingBox BlockDistanceSummaryPyramid::getNodeAABB(
+    const Index3D& index, int level) const {
+  const float node_size = block_size_ * static_cast<float>(1 << level);
+  const Vector3f min_corner = index.cast<float>() * node_size;
+  return AxisAlignedBoundingBox(
+      min_corner, min_corner + Vector3f::Constant(node_size));
+}
+
+}  // namespace nvblox
@@ -0,0 +1,80 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/map/block_pager.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace nvblox {
+
+FileBlockStore::FileBlockStore(const std::string& directory)
+    : directory_(directory) {
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  CHECK(!error) << "Could not create block store directory " << directory_
+                << ": " << error.message();
+}
+
+std::string FileBlockStore::getBlockFilePath(const Index3D& block_index) const {
+  std::stringstream path;
+  path << directory_ << "/block_" << block_index.x() << "_" << block_index.y()
+       << "_" << block_index.z() << ".bin";
+  return path.str();
+}
+
+bool FileBlockStore::write(const Index3D& block_index,
+                           const std::vector<Byte>& bytes) {
+  // Write to a temporary file first such that a block file is never seen
+  // half-written.
+  const std::string path = getBlockFilePath(block_index);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::out | std::ios::binary);
+    if (!file) {
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!file) {
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_path, path, error);
+  return !error;
+}
+
+bool FileBlockStore::read(const Index3D& block_index,
+                          std::vector<Byte>* bytes) const {
+  CHECK_NOTNULL(bytes);
+  std::ifstream file(getBlockFilePath(block_index),
+                     std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  const std::streamsize size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  bytes->resize(size);
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char*>(bytes->data()), size));
+}
+
+bool FileBlockStore::erase(const Index3D& block_index) {
+  std::error_code error;
+  return std::filesystem::remove(getBlockFilePath(block_index), error);
+}
+
+}  // namespace nvblox
@@ -15,26 +15,92 @@ limitations under the License.
 */
 #include "nvblox/map/blocks_to_update_tracker.h"
 
+#include <atomic>
+
 namespace nvblox {
 
+// A modification is run by whichever claims it first: the pool task queued
+// for it, or a caller waiting for it.
+struct BlocksToUpdateTracker::PendingModification {
+  std::function<void()> function;
+  std::atomic<bool> claimed{false};
+
+  // Run the function, unless it was claimed already.
+  // @return True if the function was run by the calling thread.
+  bool tryRun() {
+    if (claimed.exchange(true)) {
+      return false;
+    }
+    function();
+    return true;
+  }
+};
+
+BlocksToUpdateTracker::~BlocksToUpdateTracker() { wait(); }
+
+BlocksToUpdateTracker::BlocksToUpdateTracker(BlocksToUpdateTracker&& other) {
+  *this = std::move(other);
+}
+
+BlocksToUpdateTracker& BlocksToUpdateTracker::operator=(
+    BlocksToUpdateTracker&& other) {
+  // The pending modifications capture the tracker which queued them.
+  wait();
+  other.wait();
+  projective_layer_type_ = other.projective_layer_type_;
+  esdf_blocks_to_update_ = std::move(other.esdf_blocks_to_update_);
+  mesh_blocks_to_update_ = std::move(other.mesh_blocks_to_update_);
+  freespace_blocks_to_update_ = std::move(other.freespace_blocks_to_update_);
+  tsdf_distance_summary_blocks_to_update_ =
+      std::move(other.tsdf_distance_summary_blocks_to_update_);
+  track_tsdf_distance_summaries_ = other.track_tsdf_distance_summaries_;
+  thread_pool_ = other.thread_pool_;
+  return *this;
+}
+
+void BlocksToUpdateTracker::wait() const {
+  if (!pending_modification_) {
+    return;
+  }
+  // Don't wait for the pool to get to the modification, e.g. behind long
+  // tasks queued on a shared pool.
+  if (!pending_modification_->tryRun()) {
+    thread_pool_->wait(future_);
+  }
+  pending_modification_.reset();
+}
+
+void BlocksToUpdateTracker::modifyAsync(std::function<void()> modification) {
+  wait();
+  pending_modification_ = std::make_shared<PendingModification>();
+  pending_modification_->function = std::move(modification);
+  future_ = thread_pool_->submit(
+      [pending_modification = pending_modification_]() {
+        pending_modification->tryRun();
+      });
+}
+
 void BlocksToUpdateTracker::addBlocksToUpdate(
     const std::vector<Index3D>& blocks_to_update) {
   // Function definition to update blocks.
   auto funct = [&](const std::vector<Index3D> vec) -> void {
     esdf_blocks_to_update_.insert(vec.begin(), vec.end());
-    if (hasTsdfLayer(projective_layer_type_)) {
+    if (hasTsdfLayer(projective_layer_type_) ||
+        hasCompactTsdfLayer(projective_layer_type_)) {
       // The mesh is only updated if the projective layer type is tsdf.
       mesh_blocks_to_update_.insert(vec.begin(), vec.end());
     }
     if (hasFreespaceLayer(projective_layer_type_)) {
       freespace_blocks_to_update_.insert(vec.begin(), vec.end());
     }
+    if (track_tsdf_distance_summaries_) {
+      tsdf_distance_summary_blocks_to_update_.insert(vec.begin(), vec.end());
+    }
   };
 
   // Synchronize (wait for other async calls to finish) and
   // then call the update function asynchronous.
-  future_.wait();
-  future_ = std::async(std::launch::async, funct, blocks_to_update);
+  modifyAsync([funct, blocks_to_update]() { funct(blocks_to_update); });
 }
 
 void BlocksToUpdateTracker::removeBlocksToUpdate(
@@ -43,26 +109,27 @@ void BlocksToUpdateTracker::removeBlocksToUpdate(
   auto funct = [&](const std::vector<Index3D> vec) -> void {
     for (const Index3D& idx : vec) {
       esdf_blocks_to_update_.erase(idx);
-      if (hasTsdfLayer(projective_layer_type_)) {
+      if (hasTsdfLayer(projective_layer_type_) ||
+          hasCompactTsdfLayer(projective_layer_type_)) {
         // The mesh is only updated if the projective layer type is tsdf.
         mesh_blocks_to_update_.erase(idx);
       }
       if (hasFreespaceLayer(projective_layer_type_)) {
         freespace_blocks_to_update_.erase(idx);
       }
+      tsdf_distance_summary_blocks_to_update_.erase(idx);
     }
   };
 
   // Synchronize (wait for other async calls to finish) and
   // then call the removal function asynchronous.
-  future_.wait();
-  future_ = std::async(std::launch::async, funct, blocks_to_remove);
+  modifyAsync([funct, blocks_to_remove]() { funct(blocks_to_remove); });
 }
 
 std::vector<Index3D> BlocksToUpdateTracker::getBlocksToUpdate(
     BlocksToUpdateType blocks_to_update_type) const {
   // Synchronize (wait for async calls modifying the update sets to finish).
-  future_.wait();
+  wait();
 
   // Return the blocks to update.
   switch (blocks_to_update_type) {
@@ -73,6 +140,9 @@ std::vector<Index3D> BlocksToUpdateTracker::getBlocksToUpdate(
     case BlocksToUpdateType::kFreespace:
       return {freespace_blocks_to_update_.begin(),
               freespace_blocks_to_update_.end()};
+    case BlocksToUpdateType::kTsdfDistanceSummaries:
+      return {tsdf_distance_summary_blocks_to_update_.begin(),
+              tsdf_distance_summary_blocks_to_update_.end()};
     default:
       LOG(FATAL) << "BlocksToUpdateType not implemented";
       break;
@@ -93,6 +163,9 @@ void BlocksToUpdateTracker::markBlocksAsUpdated(
       case BlocksToUpdateType::kFreespace:
         freespace_blocks_to_update_.clear();
         break;
+      case BlocksToUpdateType::kTsdfDistanceSummaries:
+        tsdf_distance_summary_blocks_to_update_.clear();
+        break;
       default:
         LOG(FATAL) << "BlocksToUpdateType not implemented";
         break;
@@ -101,8 +174,25 @@ void BlocksToUpdateTracker::markBlocksAsUpdated(
 
   // Synchronize (wait for other async calls to finish) and
   // then call the mark as updated function asynchronous.
-  future_.wait();
-  future_ = std::async(std::launch::async, funct, blocks_to_update_type);
+  modifyAsync(
+      [funct, blocks_to_update_type]() { funct(blocks_to_update_type); });
+}
+
+void BlocksToUpdateTracker::track_tsdf_distance_summaries(
+    bool track_tsdf_distance_summaries) {
+  wait();
+  track_tsdf_distance_summaries_ = track_tsdf_distance_summaries;
+  if (!track_tsdf_distance_summaries_) {
+    tsdf_distance_summary_blocks_to_update_.clear();
+  }
+}
+
+void BlocksToUpdateTracker::thread_pool(
+    std::shared_ptr<ThreadPool> thread_pool) {
+  CHECK(thread_pool);
+  // The pending modification finishes on the old pool.
+  wait();
+  thread_pool_ = std::move(thread_pool);
 }
 
 }  // namespace nvblox
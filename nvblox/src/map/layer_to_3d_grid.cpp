@@ -0,0 +1,37 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/map/layer_to_3d_grid.h"
+
+namespace nvblox {
+
+void getDenseVoxelGridExtentInAABB(const float voxel_size,
+                                   const AxisAlignedBoundingBox& aabb,
+                                   Index3D* min_index, Index3D* aabb_size) {
+  CHECK_NOTNULL(min_index);
+  CHECK_NOTNULL(aabb_size);
+  CHECK_GT(voxel_size, 0.0f);
+  // NOTE: This matches the extent computed by the GPU version in
+  // map/internal/cuda/layer_to_3d_grid.cuh, such that both produce the same
+  // grid for the same AABB.
+  const float inv_voxel_size = 1.0f / voxel_size;
+  const Index3D min_in_vox = (aabb.min() * inv_voxel_size).cast<int>();
+  const Index3D max_in_vox = (aabb.max() * inv_voxel_size).cast<int>();
+  *min_index = min_in_vox;
+  *aabb_size = max_in_vox - min_in_vox + Index3D::Ones();
+  CHECK((aabb_size->array() > 0).all());
+}
+
+}  // namespace nvblox
@@ -78,13 +78,34 @@ LayerCake Serializer::loadLayerCake(MemoryType memory_type,
     layer = layer_functions.construct_layer(memory_type, layer_params);
 
     // Populate the layer with bloxxx.
-    std::vector<Index3D> data_indices;
-    getDataIndices(layer_name, &data_indices);
-
-    for (const Index3D& index : data_indices) {
-      std::vector<Byte> data;
-      getDataAtIndex(layer_name, index, &data);
-      layer_functions.add_data(index, data, layer.get(), cuda_stream);
+    bool data_loaded = true;
+    if (layer_functions.add_data_batch != nullptr) {
+      // Stream the blocks in batches, rather than querying them one by one.
+      auto add_batch = [&](const std::vector<Index3D>& indices,
+                           const std::vector<std::vector<Byte>>& data) {
+        // The remaining batches are skipped after a failure.
+        data_loaded = data_loaded &&
+                      layer_functions.add_data_batch(indices, data,
+                                                     num_load_threads_,
+                                                     layer.get(), cuda_stream);
+      };
+      data_loaded =
+          getDataInBatches(layer_name, load_batch_size_, add_batch) &&
+          data_loaded;
+    } else {
+      std::vector<Index3D> data_indices;
+      data_loaded = getDataIndices(layer_name, &data_indices);
+
+      for (const Index3D& index : data_indices) {
+        std::vector<Byte> data;
+        data_loaded = data_loaded && getDataAtIndex(layer_name, index, &data) &&
+                      layer_functions.add_data(index, data, layer.get(),
+                                               cuda_stream);
+      }
+    }
+    if (!data_loaded) {
+      LOG(ERROR) << "Failed to load the data of " << layer_name << ".";
+      return LayerCake();
     }
 
     // If the layer has a block size, then set the layer cake to the correct
@@ -171,6 +192,16 @@ bool Serializer::writeLayerCake(const LayerCake& cake,
 /// Close the file.
 bool Serializer::close() { return sqlite_.close(); }
 
+void Serializer::load_batch_size(int load_batch_size) {
+  CHECK_GT(load_batch_size, 0);
+  load_batch_size_ = load_batch_size;
+}
+
+void Serializer::num_load_threads(int num_load_threads) {
+  CHECK_GE(num_load_threads, 0);
+  num_load_threads_ = num_load_threads;
+}
+
 // --------- horrible SQL below this line ----------
 
 // Get the name of the blocks layer table.
@@ -369,6 +400,15 @@ bool Serializer::getDataIndices(const std::string& layer_name,
   return sqlite_.runMultipleQueryIndex3D(sql_statement, indices);
 }
 
+bool Serializer::getDataInBatches(
+    const std::string& layer_name, size_t batch_size,
+    const SqliteDatabase::Index3DBlobBatchCallback& callback) {
+  std::string sql_statement = "SELECT index_x,index_y,index_z,data FROM " +
+                              layerDataTableName(layer_name) + ";";
+  return sqlite_.runBatchedQueryIndex3DBlob(sql_statement, batch_size,
+                                            callback);
+}
+
 bool Serializer::getDataAtIndex(const std::string& layer_name,
                                 const Index3D& index, std::vector<Byte>* data) {
   std::string sql_statement = "SELECT data FROM " +
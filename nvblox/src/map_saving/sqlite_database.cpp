@@ -232,4 +232,49 @@ bool SqliteDatabase::runMultipleQueryIndex3D(const std::string& sql_query,
   return retval;
 }
 
+bool SqliteDatabase::runBatchedQueryIndex3DBlob(
+    const std::string& sql_query, size_t batch_size,
+    const Index3DBlobBatchCallback& callback) {
+  CHECK_GT(batch_size, 0);
+  bool retval = true;
+  sqlite3_stmt* statement;
+  int status = sqlite3_prepare_v2(db_, sql_query.c_str(), -1, &statement, 0);
+  if (status != SQLITE_OK) {
+    LOG(ERROR) << "Preparing query failed: " << sqlite3_errmsg(db_);
+    return false;
+  }
+  // The blobs keep their capacity between batches, so after the first batch
+  // reading a row does not allocate.
+  std::vector<Index3D> indices;
+  std::vector<std::vector<Byte>> blobs(batch_size);
+  indices.reserve(batch_size);
+  int rc = sqlite3_step(statement);
+  while (rc == SQLITE_ROW) {
+    std::vector<Byte>& blob = blobs[indices.size()];
+    indices.emplace_back(sqlite3_column_int(statement, 0),
+                         sqlite3_column_int(statement, 1),
+                         sqlite3_column_int(statement, 2));
+    const void* blob_data = sqlite3_column_blob(statement, 3);
+    const size_t blob_size = sqlite3_column_bytes(statement, 3);
+    blob.resize(blob_size);
+    memcpy(blob.data(), blob_data, blob_size);
+    if (indices.size() == batch_size) {
+      callback(indices, blobs);
+      indices.clear();
+    }
+    rc = sqlite3_step(statement);
+  }
+  if (rc != SQLITE_DONE) {
+    LOG(ERROR) << "Query execution failed: " << sqlite3_errmsg(db_);
+    retval = false;
+  }
+  // The last, partial, batch.
+  if (!indices.empty()) {
+    blobs.resize(indices.size());
+    callback(indices, blobs);
+  }
+  sqlite3_finalize(statement);
+  return retval;
+}
+
 }  // namespace nvblox
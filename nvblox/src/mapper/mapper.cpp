@@ -24,6 +24,80 @@ limitations under the License.
 
 namespace nvblox {
 
+namespace {
+
+// Get a layer from a (const) layer cake. nullptr if the cake doesn't contain
+// the layer.
+template <typename LayerType>
+LayerType* getLayerPtr(LayerCake* layers) {
+  return layers->getPtr<LayerType>();
+}
+template <typename LayerType>
+const LayerType* getLayerPtr(const LayerCake* layers) {
+  return layers->getConstPtr<LayerType>();
+}
+
+// Calls a function on the layer holding the TSDF voxels of a projective layer
+// type, ie. on the TsdfLayer or on the CompactTsdfLayer. The function is
+// passed a pointer to the layer, which is const for a const cake.
+// Returns false if the projective layer type has no TSDF voxels.
+template <typename LayerCakeType, typename FunctionType>
+bool callOnTsdfLayer(ProjectiveLayerType projective_layer_type,
+                     LayerCakeType* layers, FunctionType&& function) {
+  if (hasTsdfLayer(projective_layer_type)) {
+    function(getLayerPtr<TsdfLayer>(layers));
+  } else if (hasCompactTsdfLayer(projective_layer_type)) {
+    function(getLayerPtr<CompactTsdfLayer>(layers));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Calls a function on the layer holding the occupancy voxels of a projective
+// layer type, ie. on the OccupancyLayer or on the QuantizedOccupancyLayer.
+// Returns false if the projective layer type has no occupancy voxels.
+template <typename LayerCakeType, typename FunctionType>
+bool callOnOccupancyLayer(ProjectiveLayerType projective_layer_type,
+                          LayerCakeType* layers, FunctionType&& function) {
+  if (projective_layer_type == ProjectiveLayerType::kOccupancy) {
+    function(getLayerPtr<OccupancyLayer>(layers));
+  } else if (hasQuantizedOccupancyLayer(projective_layer_type)) {
+    function(getLayerPtr<QuantizedOccupancyLayer>(layers));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Calls add_layer(prefix, layer) if the cake contains the layer. A loaded
+// map only contains the layers that were serialized.
+template <typename LayerType, typename AddLayerFunctionType>
+void addLayerIfExists(const LayerCake& layers, const char* prefix,
+                      AddLayerFunctionType& add_layer) {
+  if (layers.exists<LayerType>()) {
+    add_layer(prefix, layers.get<LayerType>());
+  }
+}
+
+// Adds a full precision layer to the cake. If the layer is replaced by its
+// memory-saving variant, it's still added, such that its accessors keep
+// working, but without preallocating blocks.
+template <typename LayerType>
+void addFullPrecisionLayer(bool is_replaced, MemoryType memory_type,
+                           LayerCake* layers) {
+  if (!is_replaced) {
+    layers->add<LayerType>(memory_type);
+    return;
+  }
+  constexpr int kNumPreallocatedBlocks = 0;
+  layers->insert(typeid(LayerType),
+                 std::make_unique<LayerType>(layers->voxel_size(), memory_type,
+                                             kNumPreallocatedBlocks));
+}
+
+}  // namespace
+
 Mapper::Mapper(float voxel_size_m, MemoryType memory_type,
                ProjectiveLayerType projective_layer_type,
                std::shared_ptr<CudaStream> cuda_stream)
@@ -40,10 +114,31 @@ Mapper::Mapper(float voxel_size_m, MemoryType memory_type,
       mesh_integrator_(cuda_stream),
       esdf_integrator_(cuda_stream),
       depth_preprocessor_(cuda_stream),
-      blocks_to_update_tracker_(projective_layer_type) {
-  layers_ =
-      LayerCake::create<TsdfLayer, ColorLayer, FreespaceLayer, OccupancyLayer,
-                        EsdfLayer, MeshLayer>(voxel_size_m_, memory_type);
+      blocks_to_update_tracker_(projective_layer_type),
+      esdf_distance_summaries_(BlockDistanceSummaryPyramid::kDefaultNumLevels,
+                               cuda_stream),
+      tsdf_distance_summaries_(BlockDistanceSummaryPyramid::kDefaultNumLevels,
+                               cuda_stream) {
+  layers_ = LayerCake::create<ColorLayer, EsdfLayer, MeshLayer>(voxel_size_m_,
+                                                               memory_type);
+  // The memory-saving layer variants are only created when selected, and
+  // replace the corresponding full precision layer.
+  addFullPrecisionLayer<TsdfLayer>(hasCompactTsdfLayer(projective_layer_type_),
+                                   memory_type, &layers_);
+  addFullPrecisionLayer<OccupancyLayer>(
+      hasQuantizedOccupancyLayer(projective_layer_type_), memory_type,
+      &layers_);
+  addFullPrecisionLayer<FreespaceLayer>(
+      hasCompactFreespaceLayer(projective_layer_type_), memory_type, &layers_);
+  if (hasCompactTsdfLayer(projective_layer_type_)) {
+    layers_.add<CompactTsdfLayer>(memory_type);
+  }
+  if (hasQuantizedOccupancyLayer(projective_layer_type_)) {
+    layers_.add<QuantizedOccupancyLayer>(memory_type);
+  }
+  if (hasCompactFreespaceLayer(projective_layer_type_)) {
+    layers_.add<CompactFreespaceLayer>(memory_type);
+  }
 }
 
 Mapper::Mapper(const std::string& map_filepath, MemoryType memory_type,
@@ -59,7 +154,11 @@ Mapper::Mapper(const std::string& map_filepath, MemoryType memory_type,
       mesh_integrator_(cuda_stream),
       esdf_integrator_(cuda_stream),
       depth_preprocessor_(cuda_stream),
-      blocks_to_update_tracker_(kDefaultProjectiveLayerType) {
+      blocks_to_update_tracker_(kDefaultProjectiveLayerType),
+      esdf_distance_summaries_(BlockDistanceSummaryPyramid::kDefaultNumLevels,
+                               cuda_stream),
+      tsdf_distance_summaries_(BlockDistanceSummaryPyramid::kDefaultNumLevels,
+                               cuda_stream) {
   loadMap(map_filepath);
 }
 
@@ -76,6 +175,13 @@ void Mapper::setMapperParams(const MapperParams& params) {
   esdf_slice_height(params.esdf_slice_height);
   // Decay
   exclude_last_view_from_decay(params.exclude_last_view_from_decay);
+  epoch_based_decay(params.epoch_based_decay);
+  // ESDF distance summaries
+  update_esdf_distance_summaries(params.update_esdf_distance_summaries);
+  update_tsdf_distance_summaries(params.update_tsdf_distance_summaries);
+  // CPU thread pool
+  pin_cpu_threads_to_cores(params.pin_cpu_threads_to_cores);
+  num_cpu_threads(params.num_cpu_threads);
 
   // ======= PROJECTIVE INTEGRATOR (TSDF/COLOR/OCCUPANCY)
   // max integration distance
@@ -200,16 +306,44 @@ void Mapper::integrateDepth(const DepthImage& depth_frame,
       (do_depth_preprocessing_) ? preprocessDepthImageAsync(depth_frame)
                                 : depth_frame;
 
+  // Page in the evicted blocks in view, such that integration updates them
+  // rather than re-allocating them, and bring the blocks in view up to date
+  // with the decay.
+  const bool has_evicted_blocks = num_evicted_blocks() > 0;
+  if (epoch_based_decay_ || has_evicted_blocks) {
+    const float max_distance_m =
+        hasTsdfLayer(projective_layer_type_)
+            ? tsdf_integrator_.max_integration_distance_m() +
+                  tsdf_integrator_.get_truncation_distance_m(voxel_size_m_)
+            : occupancy_integrator_.max_integration_distance_m() +
+                  occupancy_integrator_.get_truncation_distance_m(
+                      voxel_size_m_);
+    const std::vector<Index3D> blocks_in_view =
+        ViewCalculator::getBlocksInViewPlanes(
+            T_L_C, camera, voxelSizeToBlockSize(voxel_size_m_),
+            max_distance_m);
+    if (has_evicted_blocks) {
+      pageInBlocks(blocks_in_view);
+    }
+    if (epoch_based_decay_) {
+      applyPendingDecay(blocks_in_view);
+    }
+  }
+
   // Call the integrator.
   std::vector<Index3D> updated_blocks;
-  if (hasTsdfLayer(projective_layer_type_)) {
+  auto integrate_tsdf = [&](auto* tsdf_layer) {
     tsdf_integrator_.integrateFrame(depth_image_for_integration, T_L_C, camera,
-                                    layers_.getPtr<TsdfLayer>(),
-                                    &updated_blocks);
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-    occupancy_integrator_.integrateFrame(
-        depth_image_for_integration, T_L_C, camera,
-        layers_.getPtr<OccupancyLayer>(), &updated_blocks);
+                                    tsdf_layer, &updated_blocks);
+  };
+  auto integrate_occupancy = [&](auto* occupancy_layer) {
+    occupancy_integrator_.integrateFrame(depth_image_for_integration, T_L_C,
+                                         camera, occupancy_layer,
+                                         &updated_blocks);
+  };
+  if (!callOnTsdfLayer(projective_layer_type_, &layers_, integrate_tsdf)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_,
+                         integrate_occupancy);
   }
 
   // Save the viewpoint for use in viewpoint exclusion.
@@ -227,6 +361,8 @@ void Mapper::integrateDepth(const DepthImage& depth_frame,
     last_depth_T_L_C_ = T_L_C;
   }
 
+  markBlocksIntegrated(updated_blocks);
+  touchPagedBlocks(updated_blocks);
   blocks_to_update_tracker_.addBlocksToUpdate(updated_blocks);
 }
 
@@ -234,18 +370,42 @@ void Mapper::integrateLidarDepth(const DepthImage& depth_frame,
                                  const Transform& T_L_C, const Lidar& lidar) {
   CHECK(projective_layer_type_ != ProjectiveLayerType::kNone)
       << "You are trying to update on an inexistent projective layer.";
+  const float max_distance_m =
+      hasTsdfLayer(projective_layer_type_)
+          ? lidar_tsdf_integrator_.max_integration_distance_m() +
+                lidar_tsdf_integrator_.get_truncation_distance_m(voxel_size_m_)
+          : lidar_occupancy_integrator_.max_integration_distance_m() +
+                lidar_occupancy_integrator_.get_truncation_distance_m(
+                    voxel_size_m_);
+  // Page in the evicted blocks in range, such that integration updates them
+  // rather than re-allocating them.
+  if (num_evicted_blocks() > 0) {
+    pageInInsideRadius(T_L_C.translation(), max_distance_m);
+  }
+  // Bring the blocks in range up to date with the decay.
+  if (epoch_based_decay_) {
+    applyPendingDecay(
+        getAllocatedProjectiveBlocksWithinRadius(T_L_C.translation(),
+                                                 max_distance_m));
+  }
+
   // Call the integrator.
   std::vector<Index3D> updated_blocks;
-  if (hasTsdfLayer(projective_layer_type_)) {
-    lidar_tsdf_integrator_.integrateFrame(depth_frame, T_L_C, lidar,
-                                          layers_.getPtr<TsdfLayer>(),
+  auto integrate_tsdf = [&](auto* tsdf_layer) {
+    lidar_tsdf_integrator_.integrateFrame(depth_frame, T_L_C, lidar, tsdf_layer,
                                           &updated_blocks);
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-    lidar_occupancy_integrator_.integrateFrame(depth_frame, T_L_C, lidar,
-                                               layers_.getPtr<OccupancyLayer>(),
-                                               &updated_blocks);
+  };
+  auto integrate_occupancy = [&](auto* occupancy_layer) {
+    lidar_occupancy_integrator_.integrateFrame(
+        depth_frame, T_L_C, lidar, occupancy_layer, &updated_blocks);
+  };
+  if (!callOnTsdfLayer(projective_layer_type_, &layers_, integrate_tsdf)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_,
+                         integrate_occupancy);
   }
 
+  markBlocksIntegrated(updated_blocks);
+  touchPagedBlocks(updated_blocks);
   blocks_to_update_tracker_.addBlocksToUpdate(updated_blocks);
 }
 
@@ -260,30 +420,44 @@ void Mapper::integrateColor(const ColorImage& color_frame,
 }
 
 void Mapper::decayTsdf() {
+  if (epoch_based_decay_) {
+    // Only the blocks in which voxels became fully decayed need an update.
+    std::vector<Index3D> changed_blocks;
+    const std::vector<Index3D> deallocated_blocks =
+        tsdf_decay_integrator_.decayEpoch(layers_.getPtr<TsdfLayer>(),
+                                          getEpochDecayExclusionOptions(),
+                                          *cuda_stream_, &changed_blocks);
+    blocks_to_update_tracker_.addBlocksToUpdate(changed_blocks);
+    clearBlocksInLayers(deallocated_blocks);
+    return;
+  }
+
   // TODO(remos): In the future we could exclude the blocks not decayed, from
   // the blocks requiring an update.
-  const std::vector<Index3D> all_blocks =
-      layers_.get<TsdfLayer>().getAllBlockIndices();
-  blocks_to_update_tracker_.addBlocksToUpdate(all_blocks);
+  callOnTsdfLayer(projective_layer_type_, &layers_, [&](auto* tsdf_layer) {
+    blocks_to_update_tracker_.addBlocksToUpdate(
+        tsdf_layer->getAllBlockIndices());
+  });
 
   // Decay - either all blocks or exclude a view
   std::vector<Index3D> deallocated_blocks;
+  std::optional<DecayViewExclusionOptions> view_exclusion_options;
   if (exclude_last_view_from_decay_) {
-    if (last_depth_image_.has_value() && last_depth_camera_.has_value() &&
-        last_depth_T_L_C_.has_value()) {
-      deallocated_blocks = tsdf_decay_integrator_.decay(
-          layers_.getPtr<TsdfLayer>(),
-          DecayViewExclusionOptions(
-              &last_depth_image_.value(), last_depth_T_L_C_.value(),
-              last_depth_camera_.value(),
-              tsdf_integrator_.max_integration_distance_m(),
-              tsdf_integrator_.get_truncation_distance_m(voxel_size_m_)),
-          *cuda_stream_);
+    if (!last_depth_image_.has_value() || !last_depth_camera_.has_value() ||
+        !last_depth_T_L_C_.has_value()) {
+      // No view to exclude yet.
+      return;
     }
-  } else {
-    deallocated_blocks = tsdf_decay_integrator_.decay(
-        layers_.getPtr<TsdfLayer>(), *cuda_stream_);
+    view_exclusion_options = DecayViewExclusionOptions(
+        &last_depth_image_.value(), last_depth_T_L_C_.value(),
+        last_depth_camera_.value(),
+        tsdf_integrator_.max_integration_distance_m(),
+        tsdf_integrator_.get_truncation_distance_m(voxel_size_m_));
   }
+  callOnTsdfLayer(projective_layer_type_, &layers_, [&](auto* tsdf_layer) {
+    deallocated_blocks = tsdf_decay_integrator_.decay(
+        tsdf_layer, std::nullopt, view_exclusion_options, *cuda_stream_);
+  });
 
   // Clear the blocks that got deallocated in the tsdf layer also in the esdf,
   // freespace and mesh layers.
@@ -291,35 +465,128 @@ void Mapper::decayTsdf() {
 }
 
 void Mapper::decayOccupancy() {
+  if (epoch_based_decay_) {
+    // Only the blocks in which voxels became fully decayed need an update.
+    std::vector<Index3D> changed_blocks;
+    const std::vector<Index3D> deallocated_blocks =
+        occupancy_decay_integrator_.decayEpoch(
+            layers_.getPtr<OccupancyLayer>(), getEpochDecayExclusionOptions(),
+            *cuda_stream_, &changed_blocks);
+    blocks_to_update_tracker_.addBlocksToUpdate(changed_blocks);
+    clearBlocksInLayers(deallocated_blocks);
+    return;
+  }
+
   // TODO(remos): In the future we could exclude the blocks not decayed, from
   // the blocks requiring an update.
-  const std::vector<Index3D> all_blocks =
-      layers_.get<OccupancyLayer>().getAllBlockIndices();
-  blocks_to_update_tracker_.addBlocksToUpdate(all_blocks);
+  callOnOccupancyLayer(
+      projective_layer_type_, &layers_, [&](auto* occupancy_layer) {
+        blocks_to_update_tracker_.addBlocksToUpdate(
+            occupancy_layer->getAllBlockIndices());
+      });
 
   // Decay - either all blocks or exclude a view
   std::vector<Index3D> deallocated_blocks;
+  std::optional<DecayViewExclusionOptions> view_exclusion_options;
   if (exclude_last_view_from_decay_) {
-    if (last_depth_image_ && last_depth_camera_ && last_depth_T_L_C_) {
-      deallocated_blocks = occupancy_decay_integrator_.decay(
-          layers_.getPtr<OccupancyLayer>(), std::nullopt,
-          DecayViewExclusionOptions(
-              &last_depth_image_.value(), last_depth_T_L_C_.value(),
-              last_depth_camera_.value(),
-              occupancy_integrator_.max_integration_distance_m(),
-              occupancy_integrator_.get_truncation_distance_m(voxel_size_m_)),
-          *cuda_stream_);
+    if (!last_depth_image_ || !last_depth_camera_ || !last_depth_T_L_C_) {
+      // No view to exclude yet.
+      return;
     }
-  } else {
-    deallocated_blocks = occupancy_decay_integrator_.decay(
-        layers_.getPtr<OccupancyLayer>(), *cuda_stream_);
+    view_exclusion_options = DecayViewExclusionOptions(
+        &last_depth_image_.value(), last_depth_T_L_C_.value(),
+        last_depth_camera_.value(),
+        occupancy_integrator_.max_integration_distance_m(),
+        occupancy_integrator_.get_truncation_distance_m(voxel_size_m_));
   }
+  callOnOccupancyLayer(
+      projective_layer_type_, &layers_, [&](auto* occupancy_layer) {
+        deallocated_blocks = occupancy_decay_integrator_.decay(
+            occupancy_layer, std::nullopt, view_exclusion_options,
+            *cuda_stream_);
+      });
 
   // Clear the blocks that got deallocated in the occupancy layer also in the
   // esdf, freespace and mesh layers.
   clearBlocksInLayers(deallocated_blocks);
 }
 
+void Mapper::epoch_based_decay(const bool epoch_based_decay) {
+  CHECK(!epoch_based_decay || !hasCompactTsdfLayer(projective_layer_type_))
+      << "Epoch-based decay is not supported for compact TSDF layers.";
+  CHECK(!epoch_based_decay ||
+        !hasQuantizedOccupancyLayer(projective_layer_type_))
+      << "Epoch-based decay is not supported for quantized occupancy layers.";
+  if (epoch_based_decay_ && !epoch_based_decay) {
+    // Apply the outstanding decay, such that eager decay continues from an
+    // up-to-date layer.
+    if (hasTsdfLayer(projective_layer_type_)) {
+      applyPendingDecay(
+          tsdf_decay_integrator_.epoch_tracker().getTrackedBlockIndices());
+    } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+      applyPendingDecay(
+          occupancy_decay_integrator_.epoch_tracker().getTrackedBlockIndices());
+    }
+  }
+  tsdf_decay_integrator_.resetDecayEpochs();
+  occupancy_decay_integrator_.resetDecayEpochs();
+  last_integrated_blocks_.clear();
+  epoch_based_decay_ = epoch_based_decay;
+}
+
+void Mapper::applyPendingDecay(
+    const std::vector<Index3D>& blocks_to_integrate) {
+  std::vector<Index3D> changed_blocks;
+  std::vector<Index3D> deallocated_blocks;
+  if (hasTsdfLayer(projective_layer_type_)) {
+    deallocated_blocks = tsdf_decay_integrator_.applyPendingDecay(
+        layers_.getPtr<TsdfLayer>(), blocks_to_integrate, *cuda_stream_,
+        &changed_blocks);
+  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+    deallocated_blocks = occupancy_decay_integrator_.applyPendingDecay(
+        layers_.getPtr<OccupancyLayer>(), blocks_to_integrate, *cuda_stream_,
+        &changed_blocks);
+  }
+  blocks_to_update_tracker_.addBlocksToUpdate(changed_blocks);
+  clearBlocksInLayers(deallocated_blocks);
+}
+
+std::vector<Index3D> Mapper::getAllocatedProjectiveBlocksWithinRadius(
+    const Vector3f& center, float radius) const {
+  if (hasTsdfLayer(projective_layer_type_)) {
+    return getAllocatedBlocksWithinRadius(layers_.get<TsdfLayer>(), center,
+                                          radius);
+  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+    return getAllocatedBlocksWithinRadius(layers_.get<OccupancyLayer>(),
+                                          center, radius);
+  }
+  return std::vector<Index3D>();
+}
+
+void Mapper::markBlocksIntegrated(const std::vector<Index3D>& updated_blocks) {
+  if (!epoch_based_decay_) {
+    return;
+  }
+  if (hasTsdfLayer(projective_layer_type_)) {
+    tsdf_decay_integrator_.markBlocksUpdated(updated_blocks);
+  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+    occupancy_decay_integrator_.markBlocksUpdated(updated_blocks);
+  }
+  if (exclude_last_view_from_decay_) {
+    last_integrated_blocks_ = updated_blocks;
+  }
+}
+
+std::optional<DecayBlockExclusionOptions>
+Mapper::getEpochDecayExclusionOptions() const {
+  if (!exclude_last_view_from_decay_ || last_integrated_blocks_.empty()) {
+    return std::nullopt;
+  }
+  DecayBlockExclusionOptions block_exclusion_options;
+  block_exclusion_options.block_indices_to_exclude = last_integrated_blocks_;
+  return block_exclusion_options;
+}
+
 void Mapper::updateFreespace(Time update_time_ms,
                              UpdateFullLayer update_full_layer) {
   CHECK(hasFreespaceLayer(projective_layer_type_))
@@ -330,9 +597,15 @@ void Mapper::updateFreespace(Time update_time_ms,
       getBlocksToUpdate(BlocksToUpdateType::kFreespace, update_full_layer);
 
   // Call the integrator.
-  freespace_integrator_.updateFreespaceLayer(blocks_to_update, update_time_ms,
-                                             layers_.get<TsdfLayer>(),
-                                             layers_.getPtr<FreespaceLayer>());
+  if (hasCompactFreespaceLayer(projective_layer_type_)) {
+    freespace_integrator_.updateFreespaceLayer(
+        blocks_to_update, update_time_ms, layers_.get<TsdfLayer>(),
+        layers_.getPtr<CompactFreespaceLayer>());
+  } else {
+    freespace_integrator_.updateFreespaceLayer(
+        blocks_to_update, update_time_ms, layers_.get<TsdfLayer>(),
+        layers_.getPtr<FreespaceLayer>());
+  }
 
   // Mark blocks as updated
   blocks_to_update_tracker_.markBlocksAsUpdated(BlocksToUpdateType::kFreespace);
@@ -378,7 +651,8 @@ std::shared_ptr<const SerializedMesh> Mapper::updateMesh(
     UpdateFullLayer update_full_layer,
     const std::optional<Transform>& maybe_T_L_C, bool serialize_full_mesh) {
   // Mesh is only updated for Tsdf layers (not for occupancy)
-  if (!hasTsdfLayer(projective_layer_type_)) {
+  if (!hasTsdfLayer(projective_layer_type_) &&
+      !hasCompactTsdfLayer(projective_layer_type_)) {
     return std::make_shared<const SerializedMesh>();
   } else {
     // Get the mesh blocks that need an update
@@ -386,9 +660,12 @@ std::shared_ptr<const SerializedMesh> Mapper::updateMesh(
         getBlocksToUpdate(BlocksToUpdateType::kMesh, update_full_layer);
 
     // Call the integrator.
-    mesh_integrator_.integrateBlocksGPU(layers_.get<TsdfLayer>(),
-                                        blocks_to_update,
-                                        layers_.getPtr<MeshLayer>());
+    callOnTsdfLayer(projective_layer_type_, &layers_,
+                    [&](const auto* tsdf_layer) {
+                      mesh_integrator_.integrateBlocksGPU(
+                          *tsdf_layer, blocks_to_update,
+                          layers_.getPtr<MeshLayer>());
+                    });
 
     mesh_integrator_.colorMesh(layers_.get<ColorLayer>(), blocks_to_update,
                                layers_.getPtr<MeshLayer>());
@@ -417,19 +694,26 @@ void Mapper::updateEsdf(UpdateFullLayer update_full_layer) {
   std::vector<Index3D> blocks_to_update =
       getBlocksToUpdate(BlocksToUpdateType::kEsdf, update_full_layer);
 
+  auto integrate_blocks = [&](const auto* layer) {
+    esdf_integrator_.integrateBlocks(*layer, blocks_to_update,
+                                     layers_.getPtr<EsdfLayer>());
+  };
   if (projective_layer_type_ == ProjectiveLayerType::kTsdfWithFreespace) {
     // Passing a freespace layer to the integrator for checking if
     // candidate esdf sites fall into freespace
     esdf_integrator_.integrateBlocks(
         layers_.get<TsdfLayer>(), layers_.get<FreespaceLayer>(),
         blocks_to_update, layers_.getPtr<EsdfLayer>());
-  } else if (projective_layer_type_ == ProjectiveLayerType::kTsdf) {
-    esdf_integrator_.integrateBlocks(layers_.get<TsdfLayer>(), blocks_to_update,
-                                     layers_.getPtr<EsdfLayer>());
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-    esdf_integrator_.integrateBlocks(layers_.get<OccupancyLayer>(),
-                                     blocks_to_update,
-                                     layers_.getPtr<EsdfLayer>());
+  } else if (hasCompactFreespaceLayer(projective_layer_type_)) {
+    esdf_integrator_.integrateBlocks(
+        layers_.get<TsdfLayer>(), layers_.get<CompactFreespaceLayer>(),
+        blocks_to_update, layers_.getPtr<EsdfLayer>());
+  } else if (!callOnTsdfLayer(projective_layer_type_, &layers_,
+                              integrate_blocks)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_, integrate_blocks);
+  }
+  if (update_esdf_distance_summaries_) {
+    updateEsdfDistanceSummaries();
   }
 
   // Mark blocks as updated
@@ -445,6 +729,12 @@ void Mapper::updateEsdfSlice(UpdateFullLayer update_full_layer) {
   std::vector<Index3D> blocks_to_update =
       getBlocksToUpdate(BlocksToUpdateType::kEsdf, update_full_layer);
 
+  auto integrate_slice = [&](const auto* layer) {
+    esdf_integrator_.integrateSlice(*layer, blocks_to_update,
+                                    esdf_slice_min_height_,
+                                    esdf_slice_max_height_, esdf_slice_height_,
+                                    layers_.getPtr<EsdfLayer>());
+  };
   if (projective_layer_type_ == ProjectiveLayerType::kTsdfWithFreespace) {
     // Passing a freespace layer to the integrator for checking if
     // candidate esdf sites fall into freespace
@@ -452,35 +742,126 @@ void Mapper::updateEsdfSlice(UpdateFullLayer update_full_layer) {
         layers_.get<TsdfLayer>(), layers_.get<FreespaceLayer>(),
         blocks_to_update, esdf_slice_min_height_, esdf_slice_max_height_,
         esdf_slice_height_, layers_.getPtr<EsdfLayer>());
-  } else if (projective_layer_type_ == ProjectiveLayerType::kTsdf) {
-    esdf_integrator_.integrateSlice(layers_.get<TsdfLayer>(), blocks_to_update,
-                                    esdf_slice_min_height_,
-                                    esdf_slice_max_height_, esdf_slice_height_,
-                                    layers_.getPtr<EsdfLayer>());
-
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-    esdf_integrator_.integrateSlice(layers_.get<OccupancyLayer>(),
-                                    blocks_to_update, esdf_slice_min_height_,
-                                    esdf_slice_max_height_, esdf_slice_height_,
-                                    layers_.getPtr<EsdfLayer>());
+  } else if (hasCompactFreespaceLayer(projective_layer_type_)) {
+    esdf_integrator_.integrateSlice(
+        layers_.get<TsdfLayer>(), layers_.get<CompactFreespaceLayer>(),
+        blocks_to_update, esdf_slice_min_height_, esdf_slice_max_height_,
+        esdf_slice_height_, layers_.getPtr<EsdfLayer>());
+  } else if (!callOnTsdfLayer(projective_layer_type_, &layers_,
+                              integrate_slice)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_, integrate_slice);
+  }
+  if (update_esdf_distance_summaries_) {
+    updateEsdfDistanceSummaries();
   }
 
   // Mark blocks as updated
   blocks_to_update_tracker_.markBlocksAsUpdated(BlocksToUpdateType::kEsdf);
 }
 
+void Mapper::update_esdf_distance_summaries(
+    bool update_esdf_distance_summaries) {
+  update_esdf_distance_summaries_ = update_esdf_distance_summaries;
+  esdf_integrator_.track_updated_blocks(update_esdf_distance_summaries);
+  if (update_esdf_distance_summaries_) {
+    // The ESDF may have changed while we weren't tracking it.
+    esdf_distance_summaries_need_rebuild_ = true;
+  } else {
+    esdf_distance_summaries_.clear();
+  }
+}
+
+void Mapper::update_tsdf_distance_summaries(
+    bool update_tsdf_distance_summaries) {
+  if (update_tsdf_distance_summaries &&
+      !hasTsdfLayer(projective_layer_type_)) {
+    LOG(WARNING) << "TSDF distance summaries are only supported for TSDF "
+                    "layers. Not enabling them.";
+    update_tsdf_distance_summaries = false;
+  }
+  update_tsdf_distance_summaries_ = update_tsdf_distance_summaries;
+  blocks_to_update_tracker_.track_tsdf_distance_summaries(
+      update_tsdf_distance_summaries);
+  // The TSDF may have changed while we weren't tracking it.
+  tsdf_distance_summaries_need_rebuild_ = true;
+  tsdf_distance_summaries_.clear();
+}
+
+void Mapper::updateTsdfDistanceSummaries(UpdateFullLayer update_full_layer) {
+  if (!update_tsdf_distance_summaries_) {
+    return;
+  }
+  const TsdfLayer& tsdf_layer = layers_.get<TsdfLayer>();
+  if (tsdf_distance_summaries_need_rebuild_ ||
+      update_full_layer == UpdateFullLayer::kYes) {
+    tsdf_distance_summaries_.clear();
+    tsdf_distance_summaries_.updateBlocks(tsdf_layer,
+                                          tsdf_layer.getAllBlockIndices());
+    tsdf_distance_summaries_need_rebuild_ = false;
+  } else {
+    tsdf_distance_summaries_.updateBlocks(
+        tsdf_layer, blocks_to_update_tracker_.getBlocksToUpdate(
+                        BlocksToUpdateType::kTsdfDistanceSummaries));
+  }
+  blocks_to_update_tracker_.markBlocksAsUpdated(
+      BlocksToUpdateType::kTsdfDistanceSummaries);
+}
+
+void Mapper::num_cpu_threads(int num_cpu_threads) {
+  if (num_cpu_threads == num_cpu_threads_) {
+    return;
+  }
+  num_cpu_threads_ = num_cpu_threads;
+  updateThreadPool();
+}
+
+void Mapper::pin_cpu_threads_to_cores(bool pin_cpu_threads_to_cores) {
+  if (pin_cpu_threads_to_cores == pin_cpu_threads_to_cores_) {
+    return;
+  }
+  pin_cpu_threads_to_cores_ = pin_cpu_threads_to_cores;
+  updateThreadPool();
+}
+
+void Mapper::updateThreadPool() {
+  if (num_cpu_threads_ <= 0) {
+    thread_pool(ThreadPool::getDefault());
+  } else {
+    thread_pool(std::make_shared<ThreadPool>(num_cpu_threads_,
+                                             pin_cpu_threads_to_cores_));
+  }
+}
+
+void Mapper::thread_pool(std::shared_ptr<ThreadPool> thread_pool) {
+  CHECK(thread_pool);
+  thread_pool_ = thread_pool;
+  mesh_integrator_.thread_pool(thread_pool_);
+  blocks_to_update_tracker_.thread_pool(thread_pool_);
+  updateBlockPagerSettings();
+}
+
+void Mapper::updateEsdfDistanceSummaries() {
+  const EsdfLayer& esdf_layer = layers_.get<EsdfLayer>();
+  if (esdf_distance_summaries_need_rebuild_) {
+    esdf_distance_summaries_.clear();
+    esdf_distance_summaries_.updateBlocks(esdf_layer,
+                                          esdf_layer.getAllBlockIndices());
+    esdf_distance_summaries_need_rebuild_ = false;
+  } else {
+    esdf_distance_summaries_.updateBlocks(
+        esdf_layer, esdf_integrator_.getLastUpdatedBlockIndices());
+  }
+}
+
 void Mapper::clearOutsideRadius(const Vector3f& center, float radius) {
   std::vector<Index3D> block_indices_for_deletion;
-  if (hasTsdfLayer(projective_layer_type_)) {
+  auto clear_blocks = [&](auto* layer) {
     block_indices_for_deletion = getBlocksOutsideRadius(
-        layers_.get<TsdfLayer>().getAllBlockIndices(),
-        layers_.get<TsdfLayer>().block_size(), center, radius);
-    layers_.getPtr<TsdfLayer>()->clearBlocks(block_indices_for_deletion);
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-    block_indices_for_deletion = getBlocksOutsideRadius(
-        layers_.get<OccupancyLayer>().getAllBlockIndices(),
-        layers_.get<OccupancyLayer>().block_size(), center, radius);
-    layers_.getPtr<OccupancyLayer>()->clearBlocks(block_indices_for_deletion);
+        layer->getAllBlockIndices(), layer->block_size(), center, radius);
+    layer->clearBlocks(block_indices_for_deletion);
+  };
+  if (!callOnTsdfLayer(projective_layer_type_, &layers_, clear_blocks)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_, clear_blocks);
   }
 
   // Clear the blocks that got deallocated in the tsdf/occupancy layer also in
@@ -488,18 +869,271 @@ void Mapper::clearOutsideRadius(const Vector3f& center, float radius) {
   clearBlocksInLayers(block_indices_for_deletion);
 }
 
+void Mapper::enableBlockPaging(const std::string& block_store_directory) {
+  CHECK(!block_store_directory.empty());
+  // Bring back the blocks evicted to the previous block store, such that no
+  // part of the map is left behind when the pagers are replaced.
+  if (block_paging_enabled()) {
+    pageInAllEvictedBlocks();
+  }
+  block_store_directory_ = block_store_directory;
+  createBlockPagers();
+}
+
+void Mapper::createBlockPagers() {
+  tsdf_block_pager_.reset();
+  occupancy_block_pager_.reset();
+  color_block_pager_.reset();
+  freespace_block_pager_.reset();
+  if (!block_paging_enabled()) {
+    return;
+  }
+  CHECK(!hasCompactTsdfLayer(projective_layer_type_) &&
+        !hasQuantizedOccupancyLayer(projective_layer_type_) &&
+        !hasCompactFreespaceLayer(projective_layer_type_))
+      << "Block paging is not supported for the projective layer type "
+      << toString(projective_layer_type_);
+  // Each layer gets its own sub-directory in the block store.
+  if (hasTsdfLayer(projective_layer_type_) && layers_.exists<TsdfLayer>()) {
+    tsdf_block_pager_ = std::make_unique<TsdfBlockPager>(
+        layers_.getPtr<TsdfLayer>(), block_store_directory_ + "/tsdf",
+        cuda_stream_);
+    if (layers_.exists<ColorLayer>()) {
+      color_block_pager_ = std::make_unique<ColorBlockPager>(
+          layers_.getPtr<ColorLayer>(), block_store_directory_ + "/color",
+          cuda_stream_);
+    }
+  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy &&
+             layers_.exists<OccupancyLayer>()) {
+    occupancy_block_pager_ = std::make_unique<OccupancyBlockPager>(
+        layers_.getPtr<OccupancyLayer>(), block_store_directory_ + "/occupancy",
+        cuda_stream_);
+  }
+  if (projective_layer_type_ == ProjectiveLayerType::kTsdfWithFreespace &&
+      layers_.exists<FreespaceLayer>()) {
+    freespace_block_pager_ = std::make_unique<FreespaceBlockPager>(
+        layers_.getPtr<FreespaceLayer>(), block_store_directory_ + "/freespace",
+        cuda_stream_);
+  }
+  updateBlockPagerSettings();
+}
+
+void Mapper::updateBlockPagerSettings() {
+  // Merging blocks re-allocated while evicted must not exceed the weights the
+  // integrators would reach.
+  if (tsdf_block_pager_) {
+    tsdf_block_pager_->max_weight(tsdf_integrator_.max_weight());
+    tsdf_block_pager_->thread_pool(thread_pool_);
+  }
+  if (occupancy_block_pager_) {
+    occupancy_block_pager_->thread_pool(thread_pool_);
+  }
+  if (color_block_pager_) {
+    color_block_pager_->max_weight(color_integrator_.max_weight());
+    color_block_pager_->thread_pool(thread_pool_);
+  }
+  if (freespace_block_pager_) {
+    freespace_block_pager_->thread_pool(thread_pool_);
+  }
+}
+
+std::vector<Index3D> Mapper::evictOutsideRadius(const Vector3f& center,
+                                                float radius) {
+  CHECK(block_paging_enabled()) << "Call enableBlockPaging() first.";
+  std::vector<Index3D> evicted_blocks;
+  if (tsdf_block_pager_) {
+    evicted_blocks = tsdf_block_pager_->evictOutsideRadius(center, radius);
+  } else if (occupancy_block_pager_) {
+    evicted_blocks = occupancy_block_pager_->evictOutsideRadius(center, radius);
+  }
+  evictBlocksInLayers(evicted_blocks);
+  return evicted_blocks;
+}
+
+std::vector<Index3D> Mapper::evictLeastRecentlyUsed(
+    size_t max_num_resident_blocks) {
+  CHECK(block_paging_enabled()) << "Call enableBlockPaging() first.";
+  std::vector<Index3D> evicted_blocks;
+  if (tsdf_block_pager_) {
+    evicted_blocks =
+        tsdf_block_pager_->evictLeastRecentlyUsed(max_num_resident_blocks);
+  } else if (occupancy_block_pager_) {
+    evicted_blocks =
+        occupancy_block_pager_->evictLeastRecentlyUsed(max_num_resident_blocks);
+  }
+  evictBlocksInLayers(evicted_blocks);
+  return evicted_blocks;
+}
+
+void Mapper::evictBlocksInLayers(const std::vector<Index3D>& evicted_blocks) {
+  if (evicted_blocks.empty()) {
+    return;
+  }
+  // Page out the layers which can't be regenerated...
+  if (color_block_pager_) {
+    color_block_pager_->evictBlocks(evicted_blocks);
+  }
+  if (freespace_block_pager_) {
+    freespace_block_pager_->evictBlocks(evicted_blocks);
+  }
+  // ...and drop the ones that can.
+  clearBlocksInLayers(evicted_blocks);
+}
+
+void Mapper::prefetchInsideRadiusAsync(const Vector3f& center, float radius) {
+  CHECK(block_paging_enabled()) << "Call enableBlockPaging() first.";
+  if (tsdf_block_pager_) {
+    tsdf_block_pager_->prefetchWithinRadiusAsync(center, radius);
+  }
+  if (occupancy_block_pager_) {
+    occupancy_block_pager_->prefetchWithinRadiusAsync(center, radius);
+  }
+  if (color_block_pager_) {
+    color_block_pager_->prefetchWithinRadiusAsync(center, radius);
+  }
+  if (freespace_block_pager_) {
+    freespace_block_pager_->prefetchWithinRadiusAsync(center, radius);
+  }
+}
+
+std::vector<Index3D> Mapper::pageInPrefetchedBlocks() {
+  CHECK(block_paging_enabled()) << "Call enableBlockPaging() first.";
+  // The integrator weights may have changed since the pagers were created.
+  updateBlockPagerSettings();
+  std::vector<Index3D> paged_in_blocks;
+  if (tsdf_block_pager_) {
+    paged_in_blocks = tsdf_block_pager_->installPrefetchedBlocks();
+  } else if (occupancy_block_pager_) {
+    paged_in_blocks = occupancy_block_pager_->installPrefetchedBlocks();
+  }
+  pageInBlocksInLayers(paged_in_blocks);
+  return paged_in_blocks;
+}
+
+std::vector<Index3D> Mapper::pageInInsideRadius(const Vector3f& center,
+                                                float radius) {
+  CHECK(block_paging_enabled()) << "Call enableBlockPaging() first.";
+  updateBlockPagerSettings();
+  std::vector<Index3D> paged_in_blocks;
+  if (tsdf_block_pager_) {
+    paged_in_blocks = tsdf_block_pager_->pageInWithinRadius(center, radius);
+  } else if (occupancy_block_pager_) {
+    paged_in_blocks =
+        occupancy_block_pager_->pageInWithinRadius(center, radius);
+  }
+  pageInBlocksInLayers(paged_in_blocks);
+  return paged_in_blocks;
+}
+
+void Mapper::pageInBlocks(const std::vector<Index3D>& block_indices) {
+  updateBlockPagerSettings();
+  std::vector<Index3D> paged_in_blocks;
+  if (tsdf_block_pager_) {
+    paged_in_blocks = tsdf_block_pager_->pageInBlocks(block_indices);
+  } else if (occupancy_block_pager_) {
+    paged_in_blocks = occupancy_block_pager_->pageInBlocks(block_indices);
+  }
+  pageInBlocksInLayers(paged_in_blocks);
+}
+
+void Mapper::pageInAllEvictedBlocks() {
+  updateBlockPagerSettings();
+  std::vector<Index3D> paged_in_blocks;
+  if (tsdf_block_pager_) {
+    paged_in_blocks = tsdf_block_pager_->pageInAllBlocks();
+  } else if (occupancy_block_pager_) {
+    paged_in_blocks = occupancy_block_pager_->pageInAllBlocks();
+  }
+  pageInBlocksInLayers(paged_in_blocks);
+  if (color_block_pager_) {
+    color_block_pager_->pageInAllBlocks();
+  }
+  if (freespace_block_pager_) {
+    freespace_block_pager_->pageInAllBlocks();
+  }
+}
+
+void Mapper::discardEvictedBlocks() {
+  if (tsdf_block_pager_) {
+    tsdf_block_pager_->discardEvictedBlocks();
+  }
+  if (occupancy_block_pager_) {
+    occupancy_block_pager_->discardEvictedBlocks();
+  }
+  if (color_block_pager_) {
+    color_block_pager_->discardEvictedBlocks();
+  }
+  if (freespace_block_pager_) {
+    freespace_block_pager_->discardEvictedBlocks();
+  }
+}
+
+void Mapper::pageInBlocksInLayers(const std::vector<Index3D>& paged_in_blocks) {
+  // Exactly the blocks paged into the projective layer are paged into the
+  // other layers. Prefetched blocks are used where available, the remaining
+  // ones are read synchronously.
+  if (color_block_pager_) {
+    color_block_pager_->pageInBlocks(paged_in_blocks);
+  }
+  if (freespace_block_pager_ && !paged_in_blocks.empty()) {
+    if (defer_derived_layer_writes_) {
+      staged_derived_layer_writes_.push_back(
+          {DerivedLayerWrite::Type::kPageInFreespaceBlocks, paged_in_blocks});
+    } else {
+      freespace_block_pager_->pageInBlocks(paged_in_blocks);
+    }
+  }
+  // The ESDF and mesh have to be regenerated for the paged-in blocks.
+  blocks_to_update_tracker_.addBlocksToUpdate(paged_in_blocks);
+}
+
+void Mapper::touchPagedBlocks(const std::vector<Index3D>& updated_blocks) {
+  if (tsdf_block_pager_) {
+    tsdf_block_pager_->touchBlocks(updated_blocks);
+  } else if (occupancy_block_pager_) {
+    occupancy_block_pager_->touchBlocks(updated_blocks);
+  }
+}
+
+size_t Mapper::num_evicted_blocks() const {
+  if (tsdf_block_pager_) {
+    return tsdf_block_pager_->num_evicted_blocks();
+  } else if (occupancy_block_pager_) {
+    return occupancy_block_pager_->num_evicted_blocks();
+  }
+  return 0;
+}
+
 void Mapper::markUnobservedTsdfFreeInsideRadius(const Vector3f& center,
                                                 float radius) {
   CHECK_GT(radius, 0.0f);
+  if (num_evicted_blocks() > 0) {
+    pageInInsideRadius(center, radius);
+  }
+  if (epoch_based_decay_) {
+    applyPendingDecay(getAllocatedProjectiveBlocksWithinRadius(center, radius));
+  }
   std::vector<Index3D> updated_blocks;
-  if (hasTsdfLayer(projective_layer_type_)) {
-    tsdf_integrator_.markUnobservedFreeInsideRadius(
-        center, radius, layers_.getPtr<TsdfLayer>(), &updated_blocks);
-  } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+  auto mark_tsdf_free = [&](auto* tsdf_layer) {
+    tsdf_integrator_.markUnobservedFreeInsideRadius(center, radius, tsdf_layer,
+                                                    &updated_blocks);
+  };
+  auto mark_occupancy_free = [&](auto* occupancy_layer) {
     occupancy_integrator_.markUnobservedFreeInsideRadius(
-        center, radius, layers_.getPtr<OccupancyLayer>(), &updated_blocks);
+        center, radius, occupancy_layer, &updated_blocks);
+  };
+  if (!callOnTsdfLayer(projective_layer_type_, &layers_, mark_tsdf_free)) {
+    callOnOccupancyLayer(projective_layer_type_, &layers_,
+                         mark_occupancy_free);
   }
 
+  if (epoch_based_decay_) {
+    if (hasTsdfLayer(projective_layer_type_)) {
+      tsdf_decay_integrator_.markBlocksUpdated(updated_blocks);
+    } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
+      occupancy_decay_integrator_.markBlocksUpdated(updated_blocks);
+    }
+  }
   blocks_to_update_tracker_.addBlocksToUpdate(updated_blocks);
 }
 
@@ -521,34 +1155,68 @@ std::vector<Index3D> Mapper::getBlocksToUpdate(
     BlocksToUpdateType blocks_to_update_type,
     UpdateFullLayer update_full_layer) const {
   if (update_full_layer == UpdateFullLayer::kYes) {
-    if (hasTsdfLayer(projective_layer_type_)) {
-      return layers_.get<TsdfLayer>().getAllBlockIndices();
-    } else {
-      return layers_.get<OccupancyLayer>().getAllBlockIndices();
+    std::vector<Index3D> all_blocks;
+    auto get_all_blocks = [&](const auto* layer) {
+      all_blocks = layer->getAllBlockIndices();
+    };
+    if (!callOnTsdfLayer(projective_layer_type_, &layers_, get_all_blocks)) {
+      callOnOccupancyLayer(projective_layer_type_, &layers_, get_all_blocks);
     }
+    return all_blocks;
   } else {
     return blocks_to_update_tracker_.getBlocksToUpdate(blocks_to_update_type);
   }
 }
 
 void Mapper::clearBlocksInLayers(const std::vector<Index3D>& blocks_to_clear) {
-  // Clear the mesh and color blocks.
+  // Clear the color blocks.
   layers_.getPtr<ColorLayer>()->clearBlocks(blocks_to_clear);
-  if (hasTsdfLayer(projective_layer_type_)) {
+  if (update_tsdf_distance_summaries_) {
+    tsdf_distance_summaries_.removeBlocks(blocks_to_clear);
+  }
+
+  // We don't need to update the deallocated blocks.
+  blocks_to_update_tracker_.removeBlocksToUpdate(blocks_to_clear);
+
+  // Nor decay them.
+  tsdf_decay_integrator_.forgetBlocks(blocks_to_clear);
+  occupancy_decay_integrator_.forgetBlocks(blocks_to_clear);
+
+  // Clear the blocks in the derived layers, or leave it to the update of the
+  // derived layers.
+  if (defer_derived_layer_writes_) {
+    if (!blocks_to_clear.empty()) {
+      staged_derived_layer_writes_.push_back(
+          {DerivedLayerWrite::Type::kClearBlocks, blocks_to_clear});
+    }
+  } else {
+    clearBlocksInDerivedLayers(blocks_to_clear);
+  }
+}
+
+void Mapper::clearBlocksInDerivedLayers(
+    const std::vector<Index3D>& blocks_to_clear) {
+  // Clear the mesh blocks.
+  if (hasTsdfLayer(projective_layer_type_) ||
+      hasCompactTsdfLayer(projective_layer_type_)) {
     layers_.getPtr<MeshLayer>()->clearBlocks(blocks_to_clear);
     // We need to keep track of cleared mesh blocks to delete them in our
     // visualizer.
     cleared_mesh_blocks_.insert(blocks_to_clear.begin(), blocks_to_clear.end());
   }
   // Clear the freespace blocks, if existent.
-  if (hasFreespaceLayer(projective_layer_type_)) {
+  if (hasCompactFreespaceLayer(projective_layer_type_)) {
+    layers_.getPtr<CompactFreespaceLayer>()->clearBlocks(blocks_to_clear);
+  } else if (hasFreespaceLayer(projective_layer_type_)) {
     layers_.getPtr<FreespaceLayer>()->clearBlocks(blocks_to_clear);
   }
 
   // Clear the blocks in the esdf layer.
+  std::vector<Index3D> cleared_esdf_blocks;
   if (esdf_mode_ == EsdfMode::k3D) {
     // In the 3D case this is easy.
     layers_.getPtr<EsdfLayer>()->clearBlocks(blocks_to_clear);
+    cleared_esdf_blocks = blocks_to_clear;
   } else {
     // In the 2D case we need to check if an occupancy/tsdf block is left in the
     // vertical column (z-axis) for every 2d esdf block.
@@ -585,12 +1253,12 @@ void Mapper::clearBlocksInLayers(const std::vector<Index3D>& blocks_to_clear) {
       for (size_t i = 0; i < num_blocks_in_vertical_column; i++) {
         projective_block_index.z() = min_slice_bound_index_z + i;
         // Check on tsdf or occupancy layer.
-        if (hasTsdfLayer(projective_layer_type_)) {
+        auto check_block = [&](const auto* layer) {
           has_block_in_column |=
-              layers_.get<TsdfLayer>().isBlockAllocated(projective_block_index);
-        } else if (projective_layer_type_ == ProjectiveLayerType::kOccupancy) {
-          has_block_in_column |= layers_.get<OccupancyLayer>().isBlockAllocated(
-              projective_block_index);
+              layer->isBlockAllocated(projective_block_index);
+        };
+        if (!callOnTsdfLayer(projective_layer_type_, &layers_, check_block)) {
+          callOnOccupancyLayer(projective_layer_type_, &layers_, check_block);
         }
         if (has_block_in_column) {
           break;
@@ -600,12 +1268,36 @@ void Mapper::clearBlocksInLayers(const std::vector<Index3D>& blocks_to_clear) {
         // No corresponding projective block found. So let's clear this esdf
         // block.
         layers_.getPtr<EsdfLayer>()->clearBlock(esdf_block_index);
+        cleared_esdf_blocks.push_back(esdf_block_index);
       }
     }
   }
+  if (update_esdf_distance_summaries_) {
+    esdf_distance_summaries_.removeBlocks(cleared_esdf_blocks);
+  }
+}
 
-  // We don't need to update the deallocated blocks.
-  blocks_to_update_tracker_.removeBlocksToUpdate(blocks_to_clear);
+void Mapper::deferDerivedLayerWrites(bool defer) {
+  if (!defer) {
+    applyStagedDerivedLayerWrites();
+  }
+  defer_derived_layer_writes_ = defer;
+}
+
+void Mapper::applyStagedDerivedLayerWrites() {
+  for (const DerivedLayerWrite& write : staged_derived_layer_writes_) {
+    switch (write.type) {
+      case DerivedLayerWrite::Type::kClearBlocks:
+        clearBlocksInDerivedLayers(write.block_indices);
+        break;
+      case DerivedLayerWrite::Type::kPageInFreespaceBlocks:
+        if (freespace_block_pager_) {
+          freespace_block_pager_->pageInBlocks(write.block_indices);
+        }
+        break;
+    }
+  }
+  staged_derived_layer_writes_.clear();
 }
 
 bool Mapper::saveLayerCake(const std::string& filename) const {
@@ -624,30 +1316,51 @@ bool Mapper::loadMap(const std::string& filename) {
     return false;
   }
 
-  TsdfLayer* tsdf_layer = new_cake.getPtr<TsdfLayer>();
-
-  if (tsdf_layer == nullptr) {
-    LOG(ERROR) << "No TSDF layer could be loaded from file: " << filename
+  // The map has to contain the layer that this mapper integrates into.
+  bool has_projective_layer = false;
+  auto check_layer = [&](const auto* layer) {
+    has_projective_layer = layer != nullptr;
+  };
+  if (!callOnTsdfLayer(projective_layer_type_, &new_cake, check_layer)) {
+    callOnOccupancyLayer(projective_layer_type_, &new_cake, check_layer);
+  }
+  if (!has_projective_layer) {
+    LOG(ERROR) << "No " << toString(projective_layer_type_)
+               << " layer could be loaded from file: " << filename
                << ". Aborting loading.";
     return false;
   }
   // Double check what's going on with the voxel sizes.
-  if (tsdf_layer->voxel_size() != voxel_size_m_) {
+  if (new_cake.voxel_size() != voxel_size_m_) {
     LOG(INFO) << "Setting the voxel size from the loaded map as: "
-              << tsdf_layer->voxel_size();
-    voxel_size_m_ = tsdf_layer->voxel_size();
+              << new_cake.voxel_size();
+    voxel_size_m_ = new_cake.voxel_size();
   }
 
+  // The blocks evicted from the old layers are replaced by the loaded map.
+  // Remove them from the block store before the pagers are re-created.
+  discardEvictedBlocks();
+
   // Now we're happy, let's swap the cakes.
   layers_ = std::move(new_cake);
   blocks_to_update_tracker_.markBlocksAsUpdated(BlocksToUpdateType::kEsdf);
+  esdf_distance_summaries_need_rebuild_ = true;
+  tsdf_distance_summaries_need_rebuild_ = true;
 
   // We can't serialize mesh layers yet so we have to add a new mesh layer.
   std::unique_ptr<MeshLayer> mesh(
-      new MeshLayer(layers_.getPtr<TsdfLayer>()->block_size(), memory_type_));
+      new MeshLayer(layers_.block_size(), memory_type_));
   layers_.insert(typeid(MeshLayer), std::move(mesh));
   updateMesh(UpdateFullLayer::kYes);
 
+  // The pagers refer to the old layers.
+  createBlockPagers();
+
+  // The decay epochs refer to the old layers too.
+  tsdf_decay_integrator_.resetDecayEpochs();
+  occupancy_decay_integrator_.resetDecayEpochs();
+  last_integrated_blocks_.clear();
+
   return true;
 }
 
@@ -675,6 +1388,40 @@ bool Mapper::saveFreespaceAsPly(const std::string& filename) const {
   return io::outputVoxelLayerToPly(freespace_layer(), filename);
 }
 
+bool Mapper::saveMeshAsPlyAsync(const std::string& filename,
+                                AsyncOutputWriter* output_writer) {
+  CHECK_NOTNULL(output_writer);
+  return output_writer->writeMeshPlyAsync(filename, mesh_layer());
+}
+
+bool Mapper::saveEsdfAsPlyAsync(const std::string& filename,
+                                AsyncOutputWriter* output_writer) {
+  CHECK_NOTNULL(output_writer);
+  return output_writer->writeVoxelLayerPlyAsync(filename,
+                                                createEsdfLayerSnapshot());
+}
+
+bool Mapper::saveTsdfAsPlyAsync(const std::string& filename,
+                                AsyncOutputWriter* output_writer) {
+  CHECK_NOTNULL(output_writer);
+  return output_writer->writeVoxelLayerPlyAsync(filename,
+                                                createTsdfLayerSnapshot());
+}
+
+bool Mapper::saveOccupancyAsPlyAsync(const std::string& filename,
+                                     AsyncOutputWriter* output_writer) {
+  CHECK_NOTNULL(output_writer);
+  return output_writer->writeVoxelLayerPlyAsync(
+      filename, createOccupancyLayerSnapshot());
+}
+
+bool Mapper::saveFreespaceAsPlyAsync(const std::string& filename,
+                                     AsyncOutputWriter* output_writer) {
+  CHECK_NOTNULL(output_writer);
+  return output_writer->writeVoxelLayerPlyAsync(
+      filename, createFreespaceLayerSnapshot());
+}
+
 parameters::ParameterTreeNode Mapper::getParameterTree(
     const std::string& name_remap) const {
   using parameters::ParameterTreeNode;
@@ -695,6 +1442,14 @@ parameters::ParameterTreeNode Mapper::getParameterTree(
        ParameterTreeNode("esdf_slice_height", esdf_slice_height_),
        ParameterTreeNode("exclude_last_view_from_decay",
                          exclude_last_view_from_decay_),
+       ParameterTreeNode("epoch_based_decay", epoch_based_decay_),
+       ParameterTreeNode("update_esdf_distance_summaries",
+                         update_esdf_distance_summaries_),
+       ParameterTreeNode("update_tsdf_distance_summaries",
+                         update_tsdf_distance_summaries_),
+       ParameterTreeNode("num_cpu_threads", num_cpu_threads_),
+       ParameterTreeNode("pin_cpu_threads_to_cores",
+                         pin_cpu_threads_to_cores_),
        tsdf_integrator_.getParameterTree("camera_tsdf_integrator"),
        lidar_tsdf_integrator_.getParameterTree("lidar_tsdf_integrator"),
        color_integrator_.getParameterTree(),
@@ -713,4 +1468,81 @@ std::string Mapper::getParametersAsString() const {
   return parameterTreeToString(getParameterTree());
 }
 
+template <typename AddLayerFunctionType, typename AddItemFunctionType>
+void Mapper::visitMemoryItems(AddLayerFunctionType&& add_layer,
+                              AddItemFunctionType&& add_item) const {
+  addLayerIfExists<TsdfLayer>(layers_, "tsdf_layer/", add_layer);
+  addLayerIfExists<OccupancyLayer>(layers_, "occupancy_layer/", add_layer);
+  addLayerIfExists<CompactTsdfLayer>(layers_, "compact_tsdf_layer/",
+                                     add_layer);
+  addLayerIfExists<QuantizedOccupancyLayer>(
+      layers_, "quantized_occupancy_layer/", add_layer);
+  addLayerIfExists<FreespaceLayer>(layers_, "freespace_layer/", add_layer);
+  addLayerIfExists<CompactFreespaceLayer>(layers_, "compact_freespace_layer/",
+                                          add_layer);
+  addLayerIfExists<ColorLayer>(layers_, "color_layer/", add_layer);
+  addLayerIfExists<EsdfLayer>(layers_, "esdf_layer/", add_layer);
+  addLayerIfExists<MeshLayer>(layers_, "mesh_layer/", add_layer);
+
+  add_item("tsdf_integrator", tsdf_integrator_.getScratchMemoryUsage(), 0);
+  add_item("lidar_tsdf_integrator",
+           lidar_tsdf_integrator_.getScratchMemoryUsage(), 0);
+  add_item("occupancy_integrator",
+           occupancy_integrator_.getScratchMemoryUsage(), 0);
+  add_item("lidar_occupancy_integrator",
+           lidar_occupancy_integrator_.getScratchMemoryUsage(), 0);
+  add_item("color_integrator", color_integrator_.getScratchMemoryUsage(), 0);
+  add_item("mesh_integrator", mesh_integrator_.getScratchMemoryUsage(), 0);
+  add_item("esdf_integrator", esdf_integrator_.getScratchMemoryUsage(), 0);
+
+  MemoryUsage depth_images_usage;
+  size_t num_depth_images = 0;
+  if (preprocessed_depth_image_) {
+    depth_images_usage.addImage(*preprocessed_depth_image_);
+    num_depth_images++;
+  }
+  if (last_depth_image_) {
+    depth_images_usage.addImage(*last_depth_image_);
+    num_depth_images++;
+  }
+  add_item("depth_images", depth_images_usage, num_depth_images);
+}
+
+MemoryReport Mapper::getMemoryReport() const {
+  MemoryReport report;
+  visitMemoryItems(
+      [&report](const char* prefix, const auto& layer) {
+        report.add(prefix, layer.getMemoryReport());
+      },
+      [&report](const char* name, const MemoryUsage& usage, size_t count) {
+        report.add(name, usage, count);
+      });
+  return report;
+}
+
+MemoryUsage Mapper::getMemoryUsage() const {
+  // Sums the items directly, as the snapshots are taken every frame.
+  MemoryUsage total_usage;
+  visitMemoryItems(
+      [&total_usage](const char*, const auto& layer) {
+        total_usage += layer.getMemoryUsage();
+      },
+      [&total_usage](const char*, const MemoryUsage& usage, size_t) {
+        total_usage += usage;
+      });
+  return total_usage;
+}
+
+MemorySnapshot Mapper::getMemorySnapshot() {
+  MemorySnapshot snapshot;
+  snapshot.current = getMemoryUsage();
+  memory_high_watermark_ = memory_high_watermark_.cwiseMax(snapshot.current);
+  snapshot.high_watermark = memory_high_watermark_;
+  return snapshot;
+}
+
+void Mapper::resetMemoryHighWatermark() {
+  memory_high_watermark_ = getMemoryUsage();
+}
+
 }  // namespace nvblox
@@ -0,0 +1,480 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mapper/mapper_update_scheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+namespace {
+
+float millisecondsBetween(std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+}  // namespace
+
+MapperUpdateScheduler::MapperUpdateScheduler(Mapper* mapper)
+    : mapper_(mapper),
+      worker_cuda_stream_(std::make_shared<CudaStreamOwning>()),
+      mesh_integrator_(worker_cuda_stream_),
+      esdf_integrator_(worker_cuda_stream_),
+      freespace_integrator_(worker_cuda_stream_) {
+  CHECK_NOTNULL(mapper_);
+  // The snapshots the updates read from are only taken of full precision
+  // layers.
+  CHECK(!hasCompactTsdfLayer(mapper_->projective_layer_type()))
+      << "The update scheduler does not support compact TSDF layers.";
+  CHECK(!hasQuantizedOccupancyLayer(mapper_->projective_layer_type()))
+      << "The update scheduler does not support quantized occupancy layers.";
+  CHECK(!hasCompactFreespaceLayer(mapper_->projective_layer_type()))
+      << "The update scheduler does not support compact freespace layers.";
+  freespace_integrator_.last_update_time_ms(
+      mapper_->freespace_integrator().last_update_time_ms());
+  // Integration leaves the derived layers to the background updates.
+  mapper_->deferDerivedLayerWrites(true);
+  worker_thread_ = std::thread(&MapperUpdateScheduler::workerLoop, this);
+}
+
+MapperUpdateScheduler::~MapperUpdateScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    stop_ = true;
+  }
+  worker_condition_.notify_all();
+  worker_thread_.join();
+  mapper_->deferDerivedLayerWrites(false);
+  // Later freespace updates through the mapper continue from ours.
+  mapper_->freespace_integrator().last_update_time_ms(
+      freespace_integrator_.last_update_time_ms());
+}
+
+void MapperUpdateScheduler::integrateDepth(const DepthImage& depth_frame,
+                                           const Transform& T_L_C,
+                                           const Camera& camera) {
+  const Clock::time_point call_time = Clock::now();
+  std::lock_guard<std::mutex> lock(mapper_mutex_);
+  const Clock::time_point start_time = Clock::now();
+  mapper_->integrateDepth(depth_frame, T_L_C, camera);
+  recordStage(MapperStage::kIntegrateDepth, call_time, start_time);
+}
+
+void MapperUpdateScheduler::integrateLidarDepth(const DepthImage& depth_frame,
+                                                const Transform& T_L_C,
+                                                const Lidar& lidar) {
+  const Clock::time_point call_time = Clock::now();
+  std::lock_guard<std::mutex> lock(mapper_mutex_);
+  const Clock::time_point start_time = Clock::now();
+  mapper_->integrateLidarDepth(depth_frame, T_L_C, lidar);
+  recordStage(MapperStage::kIntegrateLidarDepth, call_time, start_time);
+}
+
+void MapperUpdateScheduler::integrateColor(const ColorImage& color_frame,
+                                           const Transform& T_L_C,
+                                           const Camera& camera) {
+  const Clock::time_point call_time = Clock::now();
+  std::lock_guard<std::mutex> lock(mapper_mutex_);
+  const Clock::time_point start_time = Clock::now();
+  mapper_->integrateColor(color_frame, T_L_C, camera);
+  recordStage(MapperStage::kIntegrateColor, call_time, start_time);
+}
+
+void MapperUpdateScheduler::requestDecay() {
+  request(&pending_requests_.decay);
+}
+
+void MapperUpdateScheduler::requestFreespaceUpdate(Time update_time_ms) {
+  CHECK(hasFreespaceLayer(mapper_->projective_layer_type()))
+      << "Trying to update the freespace layer while it is not enabled.";
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    pending_requests_.freespace_update_time_ms = update_time_ms;
+  }
+  request(&pending_requests_.freespace);
+}
+
+void MapperUpdateScheduler::requestEsdfUpdate() {
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    pending_requests_.esdf_slice = false;
+  }
+  request(&pending_requests_.esdf);
+}
+
+void MapperUpdateScheduler::requestEsdfSliceUpdate() {
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    pending_requests_.esdf_slice = true;
+  }
+  request(&pending_requests_.esdf);
+}
+
+void MapperUpdateScheduler::requestMeshUpdate(
+    const std::optional<Transform>& maybe_T_L_C) {
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    pending_requests_.mesh_T_L_C = maybe_T_L_C;
+  }
+  request(&pending_requests_.mesh);
+}
+
+void MapperUpdateScheduler::request(StageRequest* stage_request) {
+  {
+    std::lock_guard<std::mutex> lock(worker_mutex_);
+    // Requests merge with a pending request. The latency is measured from the
+    // first request.
+    if (!stage_request->requested) {
+      stage_request->requested = true;
+      stage_request->request_time = Clock::now();
+    }
+  }
+  worker_condition_.notify_one();
+}
+
+std::shared_ptr<const SerializedMesh> MapperUpdateScheduler::getSerializedMesh()
+    const {
+  std::lock_guard<std::mutex> lock(serialized_mesh_mutex_);
+  return serialized_mesh_;
+}
+
+void MapperUpdateScheduler::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(worker_mutex_);
+  idle_condition_.wait(lock, [this]() {
+    const PendingRequests& p = pending_requests_;
+    return !worker_busy_ && !p.decay.requested && !p.freespace.requested &&
+           !p.esdf.requested && !p.mesh.requested;
+  });
+}
+
+void MapperUpdateScheduler::runExclusive(
+    const std::function<void(Mapper*)>& function) {
+  std::lock_guard<std::mutex> derived_layers_lock(derived_layers_mutex_);
+  std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+  // The function sees (and writes) the derived layers directly.
+  mapper_->deferDerivedLayerWrites(false);
+  function(mapper_);
+  mapper_->deferDerivedLayerWrites(true);
+}
+
+void MapperUpdateScheduler::workerLoop() {
+  while (true) {
+    PendingRequests requests;
+    {
+      std::unique_lock<std::mutex> lock(worker_mutex_);
+      worker_condition_.wait(lock, [this]() {
+        const PendingRequests& p = pending_requests_;
+        return stop_ || p.decay.requested || p.freespace.requested ||
+               p.esdf.requested || p.mesh.requested;
+      });
+      const PendingRequests& p = pending_requests_;
+      const bool has_requests = p.decay.requested || p.freespace.requested ||
+                                p.esdf.requested || p.mesh.requested;
+      if (stop_ && !has_requests) {
+        break;
+      }
+      requests = pending_requests_;
+      pending_requests_ = PendingRequests();
+      worker_busy_ = true;
+    }
+
+    runRequests(requests);
+
+    {
+      std::lock_guard<std::mutex> lock(worker_mutex_);
+      worker_busy_ = false;
+    }
+    idle_condition_.notify_all();
+  }
+}
+
+void MapperUpdateScheduler::runRequests(const PendingRequests& requests) {
+  std::lock_guard<std::mutex> derived_layers_lock(derived_layers_mutex_);
+  const ProjectiveLayerType projective_layer_type =
+      mapper_->projective_layer_type();
+
+  // Decay writes the projective layer, so it can't overlap with integration.
+  if (requests.decay.requested) {
+    timing::Timer timer("mapper_update_scheduler/decay");
+    std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+    const Clock::time_point start_time = Clock::now();
+    if (hasTsdfLayer(projective_layer_type)) {
+      mapper_->decayTsdf();
+    } else if (projective_layer_type == ProjectiveLayerType::kOccupancy) {
+      mapper_->decayOccupancy();
+    }
+    recordStage(MapperStage::kDecay, requests.decay.request_time, start_time);
+  }
+
+  const bool update_mesh =
+      requests.mesh.requested && hasTsdfLayer(projective_layer_type);
+  if (!requests.freespace.requested && !requests.esdf.requested &&
+      !update_mesh) {
+    std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+    mapper_->applyStagedDerivedLayerWrites();
+    return;
+  }
+
+  // Take the snapshots the updates read from together with the blocks to
+  // update. Blocks integrated into from here on are marked again and picked
+  // up by the next update.
+  std::shared_ptr<const TsdfLayer> tsdf_snapshot;
+  std::shared_ptr<const OccupancyLayer> occupancy_snapshot;
+  std::shared_ptr<const ColorLayer> color_snapshot;
+  std::vector<Index3D> freespace_blocks;
+  std::vector<Index3D> esdf_blocks;
+  std::vector<Index3D> mesh_blocks;
+  float esdf_slice_min_height = 0.0f;
+  float esdf_slice_max_height = 0.0f;
+  float esdf_slice_height = 0.0f;
+  {
+    timing::Timer timer("mapper_update_scheduler/snapshot");
+    std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+    // Clear the blocks deallocated and page in the blocks paged in by
+    // integration (and decay) since the last update.
+    mapper_->applyStagedDerivedLayerWrites();
+    if (requests.esdf.requested) {
+      if (requests.esdf_slice) {
+        CHECK(mapper_->esdf_mode_ != EsdfMode::k3D)
+            << "Currently, we limit computation of the ESDF to 2d *or* 3d. "
+               "Not both.";
+        mapper_->esdf_mode_ = EsdfMode::k2D;
+        esdf_slice_min_height = mapper_->esdf_slice_min_height_;
+        esdf_slice_max_height = mapper_->esdf_slice_max_height_;
+        esdf_slice_height = mapper_->esdf_slice_height_;
+      } else {
+        CHECK(mapper_->esdf_mode_ != EsdfMode::k2D)
+            << "Currently, we limit computation of the ESDF to 2d *or* 3d. "
+               "Not both.";
+        mapper_->esdf_mode_ = EsdfMode::k3D;
+      }
+    }
+    syncIntegratorParams();
+    BlocksToUpdateTracker& tracker = mapper_->blocks_to_update_tracker_;
+    if (hasTsdfLayer(projective_layer_type)) {
+      tsdf_snapshot = mapper_->createTsdfLayerSnapshot();
+    } else if (projective_layer_type == ProjectiveLayerType::kOccupancy) {
+      occupancy_snapshot = mapper_->createOccupancyLayerSnapshot();
+    }
+    if (requests.freespace.requested) {
+      freespace_blocks =
+          tracker.getBlocksToUpdate(BlocksToUpdateType::kFreespace);
+      tracker.markBlocksAsUpdated(BlocksToUpdateType::kFreespace);
+    }
+    if (requests.esdf.requested) {
+      esdf_blocks = tracker.getBlocksToUpdate(BlocksToUpdateType::kEsdf);
+      tracker.markBlocksAsUpdated(BlocksToUpdateType::kEsdf);
+    }
+    if (update_mesh) {
+      color_snapshot = mapper_->createColorLayerSnapshot();
+      mesh_blocks = tracker.getBlocksToUpdate(BlocksToUpdateType::kMesh);
+      tracker.markBlocksAsUpdated(BlocksToUpdateType::kMesh);
+    }
+  }
+
+  // Freespace
+  if (requests.freespace.requested) {
+    timing::Timer timer("mapper_update_scheduler/update_freespace");
+    const Clock::time_point start_time = Clock::now();
+    freespace_integrator_.updateFreespaceLayer(
+        freespace_blocks, requests.freespace_update_time_ms, *tsdf_snapshot,
+        mapper_->layers_.getPtr<FreespaceLayer>());
+    recordStage(MapperStage::kUpdateFreespace,
+                requests.freespace.request_time, start_time,
+                freespace_blocks.size());
+  }
+
+  // ESDF
+  if (requests.esdf.requested) {
+    timing::Timer timer("mapper_update_scheduler/update_esdf");
+    const Clock::time_point start_time = Clock::now();
+    EsdfLayer* esdf_layer = mapper_->layers_.getPtr<EsdfLayer>();
+    const FreespaceLayer& freespace_layer =
+        mapper_->layers_.get<FreespaceLayer>();
+    if (requests.esdf_slice) {
+      if (projective_layer_type == ProjectiveLayerType::kTsdfWithFreespace) {
+        esdf_integrator_.integrateSlice(
+            *tsdf_snapshot, freespace_layer, esdf_blocks, esdf_slice_min_height,
+            esdf_slice_max_height, esdf_slice_height, esdf_layer);
+      } else if (projective_layer_type == ProjectiveLayerType::kTsdf) {
+        esdf_integrator_.integrateSlice(*tsdf_snapshot, esdf_blocks,
+                                        esdf_slice_min_height,
+                                        esdf_slice_max_height,
+                                        esdf_slice_height, esdf_layer);
+      } else if (projective_layer_type == ProjectiveLayerType::kOccupancy) {
+        esdf_integrator_.integrateSlice(*occupancy_snapshot, esdf_blocks,
+                                        esdf_slice_min_height,
+                                        esdf_slice_max_height,
+                                        esdf_slice_height, esdf_layer);
+      }
+    } else {
+      if (projective_layer_type == ProjectiveLayerType::kTsdfWithFreespace) {
+        esdf_integrator_.integrateBlocks(*tsdf_snapshot, freespace_layer,
+                                         esdf_blocks, esdf_layer);
+      } else if (projective_layer_type == ProjectiveLayerType::kTsdf) {
+        esdf_integrator_.integrateBlocks(*tsdf_snapshot, esdf_blocks,
+                                         esdf_layer);
+      } else if (projective_layer_type == ProjectiveLayerType::kOccupancy) {
+        esdf_integrator_.integrateBlocks(*occupancy_snapshot, esdf_blocks,
+                                         esdf_layer);
+      }
+    }
+    // The summaries are mapper state, also read and written outside of the
+    // derived-layer updates.
+    std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+    if (mapper_->update_esdf_distance_summaries_) {
+      if (mapper_->esdf_distance_summaries_need_rebuild_) {
+        mapper_->esdf_distance_summaries_.clear();
+        mapper_->esdf_distance_summaries_.updateBlocks(
+            *esdf_layer, esdf_layer->getAllBlockIndices());
+        mapper_->esdf_distance_summaries_need_rebuild_ = false;
+      } else {
+        mapper_->esdf_distance_summaries_.updateBlocks(
+            *esdf_layer, esdf_integrator_.getLastUpdatedBlockIndices());
+      }
+    }
+    recordStage(MapperStage::kUpdateEsdf, requests.esdf.request_time,
+                start_time, esdf_blocks.size());
+  }
+
+  // Mesh
+  if (update_mesh) {
+    timing::Timer timer("mapper_update_scheduler/update_mesh");
+    const Clock::time_point start_time = Clock::now();
+    MeshLayer* mesh_layer = mapper_->layers_.getPtr<MeshLayer>();
+    mesh_integrator_.integrateBlocksGPU(*tsdf_snapshot, mesh_blocks,
+                                        mesh_layer);
+    mesh_integrator_.colorMesh(*color_snapshot, mesh_blocks, mesh_layer);
+    // Serialization uses the mapper's mesh streamer and CUDA stream.
+    std::shared_ptr<const SerializedMesh> serialized_mesh;
+    {
+      std::lock_guard<std::mutex> mapper_lock(mapper_mutex_);
+      serialized_mesh =
+          mapper_->createSerializedMesh(mesh_blocks, requests.mesh_T_L_C);
+    }
+    {
+      std::lock_guard<std::mutex> lock(serialized_mesh_mutex_);
+      serialized_mesh_ = serialized_mesh;
+    }
+    recordStage(MapperStage::kUpdateMesh, requests.mesh.request_time,
+                start_time, mesh_blocks.size());
+  }
+}
+
+void MapperUpdateScheduler::syncIntegratorParams() {
+  const MeshIntegrator& mapper_mesh_integrator = mapper_->mesh_integrator();
+  mesh_integrator_.min_weight(mapper_mesh_integrator.min_weight());
+  mesh_integrator_.weld_vertices(mapper_mesh_integrator.weld_vertices());
+  mesh_integrator_.thread_pool(mapper_->thread_pool());
+
+  const EsdfIntegrator& mapper_esdf_integrator = mapper_->esdf_integrator();
+  esdf_integrator_.max_esdf_distance_m(
+      mapper_esdf_integrator.max_esdf_distance_m());
+  esdf_integrator_.max_site_distance_vox(
+      mapper_esdf_integrator.max_site_distance_vox());
+  esdf_integrator_.min_weight(mapper_esdf_integrator.min_weight());
+  esdf_integrator_.occupied_threshold(
+      mapper_esdf_integrator.occupied_threshold());
+  esdf_integrator_.track_updated_blocks(
+      mapper_esdf_integrator.track_updated_blocks());
+
+  const FreespaceIntegrator& mapper_freespace_integrator =
+      mapper_->freespace_integrator();
+  freespace_integrator_.max_tsdf_distance_for_occupancy_m(
+      mapper_freespace_integrator.max_tsdf_distance_for_occupancy_m());
+  freespace_integrator_.max_unobserved_to_keep_consecutive_occupancy_ms(
+      mapper_freespace_integrator
+          .max_unobserved_to_keep_consecutive_occupancy_ms());
+  freespace_integrator_.min_duration_since_occupied_for_freespace_ms(
+      mapper_freespace_integrator
+          .min_duration_since_occupied_for_freespace_ms());
+  freespace_integrator_.min_consecutive_occupancy_duration_for_reset_ms(
+      mapper_freespace_integrator
+          .min_consecutive_occupancy_duration_for_reset_ms());
+  freespace_integrator_.check_neighborhood(
+      mapper_freespace_integrator.check_neighborhood());
+}
+
+void MapperUpdateScheduler::recordStage(MapperStage stage,
+                                        Clock::time_point request_time,
+                                        Clock::time_point start_time,
+                                        int num_blocks) {
+  const Clock::time_point end_time = Clock::now();
+  const float duration_ms = millisecondsBetween(start_time, end_time);
+  const float latency_ms = millisecondsBetween(request_time, end_time);
+
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  StageStatistics& statistics =
+      stage_statistics_[static_cast<size_t>(stage)];
+  MapperStageMetrics& metrics = statistics.metrics;
+  if (metrics.num_runs == 0) {
+    statistics.first_completion_time = end_time;
+  }
+  ++metrics.num_runs;
+  metrics.num_blocks_processed += num_blocks;
+
+  statistics.total_duration_ms += duration_ms;
+  metrics.last_duration_ms = duration_ms;
+  metrics.mean_duration_ms = statistics.total_duration_ms / metrics.num_runs;
+  metrics.max_duration_ms = std::max(metrics.max_duration_ms, duration_ms);
+
+  statistics.total_latency_ms += latency_ms;
+  metrics.last_latency_ms = latency_ms;
+  metrics.mean_latency_ms = statistics.total_latency_ms / metrics.num_runs;
+  metrics.max_latency_ms = std::max(metrics.max_latency_ms, latency_ms);
+
+  const float elapsed_s =
+      millisecondsBetween(statistics.first_completion_time, end_time) / 1000.f;
+  metrics.rate_hz =
+      (elapsed_s > 0.f) ? (metrics.num_runs - 1) / elapsed_s : 0.f;
+}
+
+MapperStageMetrics MapperUpdateScheduler::getStageMetrics(
+    MapperStage stage) const {
+  CHECK(stage != MapperStage::kNumStages);
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  return stage_statistics_[static_cast<size_t>(stage)].metrics;
+}
+
+std::string MapperUpdateScheduler::getMetricsAsString() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  ss << "stage\truns\tblocks\tmean ms\tmax ms\tmean latency ms\tmax latency "
+        "ms\trate Hz\n";
+  for (size_t i = 0; i < static_cast<size_t>(MapperStage::kNumStages); i++) {
+    const MapperStage stage = static_cast<MapperStage>(i);
+    const MapperStageMetrics metrics = getStageMetrics(stage);
+    if (metrics.num_runs == 0) {
+      continue;
+    }
+    ss << toString(stage) << "\t" << metrics.num_runs << "\t"
+       << metrics.num_blocks_processed << "\t" << metrics.mean_duration_ms
+       << "\t" << metrics.max_duration_ms << "\t" << metrics.mean_latency_ms
+       << "\t" << metrics.max_latency_ms << "\t" << metrics.rate_hz << "\n";
+  }
+  return ss.str();
+}
+
+void MapperUpdateScheduler::resetMetrics() {
+  std::lock_guard<std::mutex> lock(metrics_mutex_);
+  stage_statistics_.fill(StageStatistics());
+}
+
+}  // namespace nvblox
@@ -98,6 +98,13 @@ void MultiMapper::setMapperParams(
   unmasked_mapper_->setMapperParams(unmasked_mapper_params);
   if (masked_mapper_params) {
     masked_mapper_->setMapperParams(masked_mapper_params.value());
+    // Two pools of the same size would oversubscribe the cores.
+    if (masked_mapper_->num_cpu_threads() ==
+            unmasked_mapper_->num_cpu_threads() &&
+        masked_mapper_->pin_cpu_threads_to_cores() ==
+            unmasked_mapper_->pin_cpu_threads_to_cores()) {
+      masked_mapper_->thread_pool(unmasked_mapper_->thread_pool());
+    }
   }
 }
 
@@ -266,4 +273,45 @@ std::string MultiMapper::getParametersAsString() const {
   return parameterTreeToString(getParameterTree());
 }
 
+MemoryReport MultiMapper::getMemoryReport() const {
+  MemoryReport report;
+  report.add("unmasked_mapper/", unmasked_mapper_->getMemoryReport());
+  report.add("masked_mapper/", masked_mapper_->getMemoryReport());
+  constexpr size_t kNumImages = 8;
+  report.add("images", getImagesMemoryUsage(), kNumImages);
+  return report;
+}
+
+MemoryUsage MultiMapper::getMemoryUsage() const {
+  MemoryUsage usage = unmasked_mapper_->getMemoryUsage();
+  usage += masked_mapper_->getMemoryUsage();
+  usage += getImagesMemoryUsage();
+  return usage;
+}
+
+MemoryUsage MultiMapper::getImagesMemoryUsage() const {
+  MemoryUsage images_usage;
+  images_usage.addImage(cleaned_dynamic_mask_);
+  images_usage.addImage(cleaned_semantic_mask_);
+  images_usage.addImage(depth_frame_unmasked_);
+  images_usage.addImage(depth_frame_masked_);
+  images_usage.addImage(color_frame_unmasked_);
+  images_usage.addImage(color_frame_masked_);
+  images_usage.addImage(masked_depth_overlay_);
+  images_usage.addImage(masked_color_overlay_);
+  return images_usage;
+}
+
+MemorySnapshot MultiMapper::getMemorySnapshot() {
+  MemorySnapshot snapshot;
+  snapshot.current = getMemoryUsage();
+  memory_high_watermark_ = memory_high_watermark_.cwiseMax(snapshot.current);
+  snapshot.high_watermark = memory_high_watermark_;
+  return snapshot;
+}
+
+void MultiMapper::resetMemoryHighWatermark() {
+  memory_high_watermark_ = getMemoryUsage();
+}
+
 }  // namespace nvblox
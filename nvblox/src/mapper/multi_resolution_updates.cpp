@@ -0,0 +1,155 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mapper/multi_resolution_updates.h"
+
+#include <cmath>
+
+namespace nvblox {
+namespace {
+
+// Deallocate blocks in a derived layer whose source block is not allocated.
+template <typename DerivedLayerType>
+void clearBlocksWithoutSource(const TsdfLayer& source_layer,
+                              DerivedLayerType* derived_layer) {
+  derived_layer->clearBlocks(
+      derived_layer->getBlockIndicesIf([&](const Index3D& block_index) {
+        return !source_layer.isBlockAllocated(block_index);
+      }));
+}
+
+// Reads a signed distance out of an ESDF voxel, if it has been observed.
+bool getEsdfDistance(const EsdfLayer& esdf_layer, const Vector3f& p_L,
+                     float* distance_m) {
+  const auto voxel_and_flag = esdf_layer.getVoxel(p_L);
+  if (!voxel_and_flag.second || !voxel_and_flag.first.observed) {
+    return false;
+  }
+  const EsdfVoxel& voxel = voxel_and_flag.first;
+  *distance_m =
+      esdf_layer.voxel_size() * std::sqrt(voxel.squared_distance_vox);
+  if (voxel.is_inside) {
+    *distance_m = -*distance_m;
+  }
+  return true;
+}
+
+}  // namespace
+
+void updateMultiResolutionMesh(
+    const MultiResolutionTsdfLayer& tsdf_layer,
+    const std::vector<Index3D>& fine_blocks_to_update,
+    const std::vector<Index3D>& coarse_blocks_to_update,
+    MeshIntegrator* mesh_integrator, MeshLayer* fine_mesh_layer,
+    MeshLayer* coarse_mesh_layer) {
+  CHECK_NOTNULL(mesh_integrator);
+  CHECK_NOTNULL(fine_mesh_layer);
+  CHECK_NOTNULL(coarse_mesh_layer);
+  CHECK_EQ(fine_mesh_layer->block_size(),
+           tsdf_layer.fine_layer().block_size());
+  CHECK_EQ(coarse_mesh_layer->block_size(),
+           tsdf_layer.coarse_layer().block_size());
+
+  // Fine level. Blocks which migrated to the coarse level lose their mesh.
+  clearBlocksWithoutSource(tsdf_layer.fine_layer(), fine_mesh_layer);
+  mesh_integrator->integrateBlocksGPU(tsdf_layer.fine_layer(),
+                                      fine_blocks_to_update, fine_mesh_layer);
+
+  // Coarse level. Mesh outside of the fine region plus a band of one coarse
+  // block into it. Meshing only uses a block and its neighbors, so two meshes
+  // which meet exactly at the level boundary leave a crack. The band overlaps
+  // the fine mesh instead. Remove the coarse mesh blocks that the fine region
+  // moved over.
+  const auto is_coarse_block_meshed = [&](const Index3D& block_index) {
+    return !tsdf_layer.isCoarseBlockInFineRegion(block_index) ||
+           tsdf_layer.isCoarseBlockOnFineRegionBoundary(block_index);
+  };
+  coarse_mesh_layer->clearBlocks(
+      coarse_mesh_layer->getBlockIndicesIf([&](const Index3D& block_index) {
+        return !is_coarse_block_meshed(block_index);
+      }));
+  clearBlocksWithoutSource(tsdf_layer.coarse_layer(), coarse_mesh_layer);
+  std::vector<Index3D> coarse_blocks_to_mesh;
+  coarse_blocks_to_mesh.reserve(coarse_blocks_to_update.size());
+  for (const Index3D& block_index : coarse_blocks_to_update) {
+    if (is_coarse_block_meshed(block_index)) {
+      coarse_blocks_to_mesh.push_back(block_index);
+    }
+  }
+  // Blocks that entered the band because the fine region moved didn't
+  // necessarily change, but have no mesh yet. Band blocks without a surface
+  // are re-checked on every update, which is cheap as the band is thin.
+  const std::vector<Index3D> new_band_blocks =
+      tsdf_layer.coarse_layer().getBlockIndicesIf(
+          [&](const Index3D& block_index) {
+            return tsdf_layer.isCoarseBlockOnFineRegionBoundary(block_index) &&
+                   !coarse_mesh_layer->isBlockAllocated(block_index);
+          });
+  coarse_blocks_to_mesh.insert(coarse_blocks_to_mesh.end(),
+                               new_band_blocks.begin(), new_band_blocks.end());
+  mesh_integrator->integrateBlocksGPU(tsdf_layer.coarse_layer(),
+                                      coarse_blocks_to_mesh, coarse_mesh_layer);
+}
+
+void updateMultiResolutionEsdf(
+    const MultiResolutionTsdfLayer& tsdf_layer,
+    const std::vector<Index3D>& fine_blocks_to_update,
+    const std::vector<Index3D>& coarse_blocks_to_update,
+    EsdfIntegrator* esdf_integrator, EsdfLayer* fine_esdf_layer,
+    EsdfLayer* coarse_esdf_layer) {
+  CHECK_NOTNULL(esdf_integrator);
+  CHECK_NOTNULL(fine_esdf_layer);
+  CHECK_NOTNULL(coarse_esdf_layer);
+  CHECK_EQ(fine_esdf_layer->voxel_size(), tsdf_layer.fine_voxel_size());
+  CHECK_EQ(coarse_esdf_layer->voxel_size(), tsdf_layer.coarse_voxel_size());
+
+  clearBlocksWithoutSource(tsdf_layer.fine_layer(), fine_esdf_layer);
+  esdf_integrator->integrateBlocks(tsdf_layer.fine_layer(),
+                                   fine_blocks_to_update, fine_esdf_layer);
+
+  esdf_integrator->integrateBlocks(tsdf_layer.coarse_layer(),
+                                   coarse_blocks_to_update, coarse_esdf_layer);
+}
+
+bool getMultiResolutionEsdfDistance(const EsdfLayer& fine_esdf_layer,
+                                    const EsdfLayer& coarse_esdf_layer,
+                                    const Vector3f& p_L, float* distance_m,
+                                    ResolutionLevel* level_ptr) {
+  CHECK_NOTNULL(distance_m);
+  // The fine ESDF only sees the obstacles in the fine TSDF. Obstacles which
+  // only exist at the coarse level (ie. outside of the fine region, or in
+  // parts of it migrated before) are seen by the coarse ESDF. We therefore
+  // return the smaller of the two distances, which never overestimates the
+  // clearance.
+  float fine_distance_m = 0.0f;
+  float coarse_distance_m = 0.0f;
+  const bool fine_observed =
+      getEsdfDistance(fine_esdf_layer, p_L, &fine_distance_m);
+  const bool coarse_observed =
+      getEsdfDistance(coarse_esdf_layer, p_L, &coarse_distance_m);
+  if (!fine_observed && !coarse_observed) {
+    return false;
+  }
+  const bool use_fine =
+      fine_observed &&
+      (!coarse_observed || fine_distance_m <= coarse_distance_m);
+  *distance_m = use_fine ? fine_distance_m : coarse_distance_m;
+  if (level_ptr != nullptr) {
+    *level_ptr = use_fine ? ResolutionLevel::kFine : ResolutionLevel::kCoarse;
+  }
+  return true;
+}
+
+}  // namespace nvblox
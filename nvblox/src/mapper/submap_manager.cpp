@@ -0,0 +1,520 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mapper/submap_manager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <typeindex>
+
+#include "nvblox/io/layer_cake_io.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+
+namespace {
+
+template <typename VoxelType>
+bool isBlockObserved(const VoxelBlock<VoxelType>& block) {
+  constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        if (block.voxels[x][y][z].weight > 0.0f) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Copies the blocks of a layer (in any memory) which contain at least one
+// observed voxel to a host layer.
+template <typename VoxelType>
+void copyObservedBlocksToHost(const VoxelBlockLayer<VoxelType>& layer,
+                              const CudaStream& cuda_stream,
+                              VoxelBlockLayer<VoxelType>* host_layer) {
+  CHECK_EQ(host_layer->memory_type(), MemoryType::kHost);
+  VoxelBlockLayer<VoxelType> host_copy(layer.voxel_size(), MemoryType::kHost);
+  host_copy.copyFromAsync(layer, cuda_stream);
+  cuda_stream.synchronize();
+
+  std::vector<Index3D> observed_block_indices;
+  for (const Index3D& block_idx : host_copy.getAllBlockIndices()) {
+    if (isBlockObserved(*host_copy.getBlockAtIndex(block_idx))) {
+      observed_block_indices.push_back(block_idx);
+    }
+  }
+  host_layer->allocateBlocksAtIndices(observed_block_indices, cuda_stream);
+  for (const Index3D& block_idx : observed_block_indices) {
+    std::copy_n(&host_copy.getBlockAtIndex(block_idx)->voxels[0][0][0],
+                VoxelBlock<VoxelType>::kNumVoxels,
+                &host_layer->getBlockAtIndex(block_idx)->voxels[0][0][0]);
+  }
+}
+
+// Weight-averages a voxel into a fused voxel. The fused weight is clamped to
+// max_weight, like the integrators clamp the weights they accumulate.
+void fuseVoxel(const TsdfVoxel& voxel, float max_weight,
+               TsdfVoxel* fused_voxel) {
+  const float weight_sum = fused_voxel->weight + voxel.weight;
+  fused_voxel->distance = (fused_voxel->weight * fused_voxel->distance +
+                           voxel.weight * voxel.distance) /
+                          weight_sum;
+  fused_voxel->weight = std::min(weight_sum, max_weight);
+}
+
+void fuseVoxel(const ColorVoxel& voxel, float max_weight,
+               ColorVoxel* fused_voxel) {
+  const float weight_sum = fused_voxel->weight + voxel.weight;
+  auto fuse_channel = [&](uint8_t fused, uint8_t value) {
+    return static_cast<uint8_t>(std::round(
+        (fused_voxel->weight * fused + voxel.weight * value) / weight_sum));
+  };
+  fused_voxel->color =
+      Color(fuse_channel(fused_voxel->color.r, voxel.color.r),
+            fuse_channel(fused_voxel->color.g, voxel.color.g),
+            fuse_channel(fused_voxel->color.b, voxel.color.b));
+  fused_voxel->weight = std::min(weight_sum, max_weight);
+}
+
+// Fuses the observed voxels of a host layer into another host layer by
+// averaging them by their weights.
+template <typename VoxelType>
+void fuseLayer(const VoxelBlockLayer<VoxelType>& layer, float max_weight,
+               VoxelBlockLayer<VoxelType>* fused_layer) {
+  constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
+  for (const Index3D& block_idx : layer.getAllBlockIndices()) {
+    const auto block = layer.getBlockAtIndex(block_idx);
+    auto fused_block = fused_layer->allocateBlockAtIndex(block_idx);
+    for (int x = 0; x < kVoxelsPerSide; x++) {
+      for (int y = 0; y < kVoxelsPerSide; y++) {
+        for (int z = 0; z < kVoxelsPerSide; z++) {
+          const VoxelType& voxel = block->voxels[x][y][z];
+          if (voxel.weight > 0.0f) {
+            fuseVoxel(voxel, max_weight, &fused_block->voxels[x][y][z]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Accumulates the weighted distances of a layer at positions. The weights are
+// not clamped, so the result doesn't depend on the order of the layers.
+void accumulateTsdf(const TsdfLayer& layer,
+                    const std::vector<Vector3f>& positions_L,
+                    const std::vector<size_t>& position_indices,
+                    std::vector<TsdfVoxel>* voxels,
+                    std::vector<bool>* success_flags) {
+  if (position_indices.empty()) {
+    return;
+  }
+  std::vector<Vector3f> positions_subset;
+  positions_subset.reserve(position_indices.size());
+  for (const size_t i : position_indices) {
+    positions_subset.push_back(positions_L[i]);
+  }
+  std::vector<TsdfVoxel> layer_voxels;
+  std::vector<bool> layer_success_flags;
+  layer.getVoxels(positions_subset, &layer_voxels, &layer_success_flags);
+  for (size_t j = 0; j < position_indices.size(); j++) {
+    if (!layer_success_flags[j] || layer_voxels[j].weight <= 0.0f) {
+      continue;
+    }
+    const size_t i = position_indices[j];
+    fuseVoxel(layer_voxels[j], std::numeric_limits<float>::max(),
+              &(*voxels)[i]);
+    (*success_flags)[i] = true;
+  }
+}
+
+}  // namespace
+
+SubmapManager::SubmapManager(float voxel_size_m, MemoryType memory_type)
+    : voxel_size_m_(voxel_size_m),
+      memory_type_(memory_type),
+      fused_tsdf_layer_(voxel_size_m, MemoryType::kHost),
+      fused_color_layer_(voxel_size_m, MemoryType::kHost),
+      cuda_stream_(std::make_shared<CudaStreamOwning>()) {
+  CHECK_GT(voxel_size_m, 0.0f);
+  worker_thread_ = std::thread(&SubmapManager::workerLoop, this);
+}
+
+SubmapManager::~SubmapManager() {
+  {
+    std::lock_guard<std::mutex> lock(work_mutex_);
+    stop_worker_ = true;
+  }
+  work_cv_.notify_all();
+  worker_thread_.join();
+}
+
+void SubmapManager::setMapperParams(const MapperParams& params) {
+  mapper_params_ = params;
+  if (active_mapper_) {
+    active_mapper_->setMapperParams(params);
+  }
+}
+
+void SubmapManager::integrateDepth(const DepthImage& depth_frame,
+                                   const Transform& T_L_C,
+                                   const Camera& camera, Time timestamp_ms) {
+  const Vector3f position_L = T_L_C.translation();
+  if (active_mapper_) {
+    const bool too_far =
+        (position_L - active_info_.anchor_position_L).norm() >
+        submap_distance_m_;
+    const bool too_old =
+        static_cast<int64_t>(timestamp_ms - active_info_.start_time_ms) >
+        static_cast<int64_t>(submap_duration_s_ * 1000.0f);
+    if (too_far || too_old) {
+      finishSubmap();
+    }
+  }
+  if (!active_mapper_) {
+    startSubmap(position_L, timestamp_ms);
+  }
+  active_mapper_->integrateDepth(depth_frame, T_L_C, camera);
+  active_info_.end_time_ms = timestamp_ms;
+  ++active_info_.num_integrated_frames;
+}
+
+void SubmapManager::integrateColor(const ColorImage& color_frame,
+                                   const Transform& T_L_C,
+                                   const Camera& camera) {
+  // Color is only integrated into already observed space, so there's nothing
+  // to do before the first depth frame.
+  if (active_mapper_) {
+    active_mapper_->integrateColor(color_frame, T_L_C, camera);
+  }
+}
+
+void SubmapManager::finishActiveSubmap() {
+  if (active_mapper_) {
+    finishSubmap();
+  }
+}
+
+void SubmapManager::startSubmap(const Vector3f& anchor_position_L,
+                                Time timestamp_ms) {
+  active_mapper_ = std::make_unique<Mapper>(voxel_size_m_, memory_type_);
+  if (mapper_params_) {
+    active_mapper_->setMapperParams(*mapper_params_);
+  }
+  active_info_ = SubmapInfo();
+  active_info_.id = next_submap_id_++;
+  active_info_.anchor_position_L = anchor_position_L;
+  active_info_.start_time_ms = timestamp_ms;
+  active_info_.end_time_ms = timestamp_ms;
+}
+
+void SubmapManager::finishSubmap() {
+  auto submap = std::make_shared<Submap>();
+  submap->info = active_info_;
+  submap->info.state = SubmapState::kFreezing;
+  submap->info.num_tsdf_blocks =
+      active_mapper_->tsdf_layer().numAllocatedBlocks();
+  submap->mapper = std::move(active_mapper_);
+  submap->fuse = fuse_frozen_submaps_;
+  submap->offload_directory = offload_directory_;
+  submap->fused_region_radius_m = fused_region_radius_m_;
+  submap->tsdf_max_weight = submap->mapper->tsdf_integrator().max_weight();
+  submap->color_max_weight = submap->mapper->color_integrator().max_weight();
+  {
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    submaps_.push_back(submap);
+  }
+  {
+    std::lock_guard<std::mutex> lock(work_mutex_);
+    work_queue_.push_back(submap);
+  }
+  work_cv_.notify_one();
+}
+
+void SubmapManager::workerLoop() {
+  while (true) {
+    std::shared_ptr<Submap> submap;
+    {
+      std::unique_lock<std::mutex> lock(work_mutex_);
+      work_cv_.wait(lock,
+                    [this]() { return stop_worker_ || !work_queue_.empty(); });
+      // Finish the queued submaps before stopping.
+      if (work_queue_.empty()) {
+        return;
+      }
+      submap = work_queue_.front();
+      work_queue_.pop_front();
+      worker_busy_ = true;
+    }
+    processFinishedSubmap(submap);
+    {
+      std::lock_guard<std::mutex> lock(work_mutex_);
+      worker_busy_ = false;
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+void SubmapManager::processFinishedSubmap(
+    const std::shared_ptr<Submap>& submap) {
+  // Freeze: keep the observed blocks in host memory and release the mapper.
+  timing::Timer freeze_timer("submap_manager/freeze");
+  auto tsdf_layer =
+      std::make_unique<TsdfLayer>(voxel_size_m_, MemoryType::kHost);
+  auto color_layer =
+      std::make_unique<ColorLayer>(voxel_size_m_, MemoryType::kHost);
+  copyObservedBlocksToHost(submap->mapper->tsdf_layer(), *cuda_stream_,
+                           tsdf_layer.get());
+  copyObservedBlocksToHost(submap->mapper->color_layer(), *cuda_stream_,
+                           color_layer.get());
+  const AxisAlignedBoundingBox aabb = getAABBOfAllocatedBlocks(*tsdf_layer);
+  {
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    submap->tsdf_layer = std::move(tsdf_layer);
+    submap->color_layer = std::move(color_layer);
+    submap->mapper.reset();
+    submap->info.state = SubmapState::kFrozen;
+    submap->info.num_tsdf_blocks = submap->tsdf_layer->numAllocatedBlocks();
+    submap->info.aabb = aabb;
+  }
+  freeze_timer.Stop();
+
+  // Fuse into the global layers. Queries see the submap either in the global
+  // layers or on its own, never in both.
+  if (submap->fuse) {
+    timing::Timer fuse_timer("submap_manager/fuse");
+    std::lock_guard<std::mutex> fused_lock(fused_mutex_);
+    if (fused_tsdf_pager_) {
+      // Merged paged-out voxels are clamped like fused ones.
+      fused_tsdf_pager_->max_weight(submap->tsdf_max_weight);
+      fused_color_pager_->max_weight(submap->color_max_weight);
+      fused_tsdf_pager_->pageInBlocks(
+          submap->tsdf_layer->getAllBlockIndices());
+      fused_color_pager_->pageInBlocks(
+          submap->color_layer->getAllBlockIndices());
+    }
+    fuseLayer(*submap->tsdf_layer, submap->tsdf_max_weight,
+              &fused_tsdf_layer_);
+    fuseLayer(*submap->color_layer, submap->color_max_weight,
+              &fused_color_layer_);
+    // Bound the fused layers to the region around the latest submap.
+    if (fused_tsdf_pager_) {
+      timing::Timer page_out_timer("submap_manager/page_out_fused");
+      fused_tsdf_pager_->evictOutsideRadius(submap->info.anchor_position_L,
+                                            submap->fused_region_radius_m);
+      fused_color_pager_->evictOutsideRadius(submap->info.anchor_position_L,
+                                             submap->fused_region_radius_m);
+    }
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    submap->info.fused = true;
+  }
+
+  // Offload to disk.
+  if (!submap->offload_directory.empty()) {
+    timing::Timer offload_timer("submap_manager/offload");
+    LayerCake cake(voxel_size_m_);
+    {
+      std::lock_guard<std::mutex> lock(submaps_mutex_);
+      cake.insert(typeid(TsdfLayer), std::move(submap->tsdf_layer));
+      cake.insert(typeid(ColorLayer), std::move(submap->color_layer));
+    }
+    const std::string filepath = submap->offload_directory + "/submap_" +
+                                 std::to_string(submap->info.id) + ".nvblx";
+    const bool success = io::writeLayerCakeToFile(filepath, cake);
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    if (success) {
+      submap->info.state = SubmapState::kOffloaded;
+      submap->info.filepath = filepath;
+    } else {
+      // Keep the submap in memory.
+      LOG(ERROR) << "Failed to offload submap " << submap->info.id << " to "
+                 << filepath;
+      submap->tsdf_layer = std::make_unique<TsdfLayer>(
+          std::move(*cake.getPtr<TsdfLayer>()));
+      submap->color_layer = std::make_unique<ColorLayer>(
+          std::move(*cake.getPtr<ColorLayer>()));
+    }
+  }
+}
+
+std::vector<SubmapInfo> SubmapManager::getSubmapInfos() const {
+  std::vector<SubmapInfo> infos;
+  {
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    for (const auto& submap : submaps_) {
+      infos.push_back(submap->info);
+    }
+  }
+  if (active_mapper_) {
+    infos.push_back(active_info_);
+    infos.back().num_tsdf_blocks =
+        active_mapper_->tsdf_layer().numAllocatedBlocks();
+  }
+  return infos;
+}
+
+int SubmapManager::num_submaps() const { return next_submap_id_; }
+
+void SubmapManager::getTsdfVoxels(const std::vector<Vector3f>& positions_L,
+                                  std::vector<TsdfVoxel>* voxels_ptr,
+                                  std::vector<bool>* success_flags_ptr) const {
+  CHECK_NOTNULL(voxels_ptr);
+  CHECK_NOTNULL(success_flags_ptr);
+  voxels_ptr->assign(positions_L.size(), TsdfVoxel());
+  success_flags_ptr->assign(positions_L.size(), false);
+
+  std::vector<size_t> all_indices(positions_L.size());
+  for (size_t i = 0; i < positions_L.size(); i++) {
+    all_indices[i] = i;
+  }
+  if (active_mapper_) {
+    accumulateTsdf(active_mapper_->tsdf_layer(), positions_L, all_indices,
+                   voxels_ptr, success_flags_ptr);
+  }
+
+  // Lock order: fused layers, then submaps.
+  std::lock_guard<std::mutex> fused_lock(fused_mutex_);
+  if (fused_tsdf_pager_) {
+    // The paged-in blocks stay resident until the next submap is fused.
+    std::vector<Index3D> block_indices;
+    block_indices.reserve(positions_L.size());
+    for (const Vector3f& position_L : positions_L) {
+      block_indices.push_back(getBlockIndexFromPositionInLayer(
+          fused_tsdf_layer_.block_size(), position_L));
+    }
+    fused_tsdf_pager_->pageInBlocks(block_indices);
+  }
+  accumulateTsdf(fused_tsdf_layer_, positions_L, all_indices, voxels_ptr,
+                 success_flags_ptr);
+  std::lock_guard<std::mutex> lock(submaps_mutex_);
+  for (const auto& submap : submaps_) {
+    if (submap->info.fused) {
+      continue;
+    }
+    // Submaps being frozen are queried through their mapper. Offloaded
+    // submaps are skipped, as loading them per query would be too slow.
+    const TsdfLayer* layer = nullptr;
+    if (submap->tsdf_layer) {
+      layer = submap->tsdf_layer.get();
+    } else if (submap->mapper) {
+      layer = &submap->mapper->tsdf_layer();
+    } else {
+      continue;
+    }
+    std::vector<size_t> indices;
+    for (const size_t i : all_indices) {
+      if (submap->mapper || submap->info.aabb.contains(positions_L[i])) {
+        indices.push_back(i);
+      }
+    }
+    accumulateTsdf(*layer, positions_L, indices, voxels_ptr,
+                   success_flags_ptr);
+  }
+}
+
+void SubmapManager::runWithFusedLayers(
+    const std::function<void(const TsdfLayer&, const ColorLayer&)>& function)
+    const {
+  std::lock_guard<std::mutex> lock(fused_mutex_);
+  function(fused_tsdf_layer_, fused_color_layer_);
+}
+
+LayerCake SubmapManager::loadOffloadedSubmap(int id) const {
+  std::string filepath;
+  {
+    std::lock_guard<std::mutex> lock(submaps_mutex_);
+    for (const auto& submap : submaps_) {
+      if (submap->info.id == id &&
+          submap->info.state == SubmapState::kOffloaded) {
+        filepath = submap->info.filepath;
+      }
+    }
+  }
+  if (filepath.empty()) {
+    LOG(WARNING) << "Submap " << id << " is not offloaded.";
+    return LayerCake();
+  }
+  return io::loadLayerCakeFromFile(filepath, MemoryType::kHost);
+}
+
+void SubmapManager::waitForBackgroundWork() {
+  std::unique_lock<std::mutex> lock(work_mutex_);
+  idle_cv_.wait(lock,
+                [this]() { return work_queue_.empty() && !worker_busy_; });
+}
+
+void SubmapManager::enableOffloading(const std::string& directory) {
+  CHECK(!directory.empty());
+  offload_directory_ = directory;
+  std::lock_guard<std::mutex> lock(fused_mutex_);
+  // Blocks paged out to a previous directory come back first.
+  if (fused_tsdf_pager_) {
+    fused_tsdf_pager_->pageInAllBlocks();
+    fused_color_pager_->pageInAllBlocks();
+  }
+  fused_tsdf_pager_ = std::make_unique<TsdfBlockPager>(
+      &fused_tsdf_layer_, directory + "/fused_tsdf");
+  fused_color_pager_ = std::make_unique<ColorBlockPager>(
+      &fused_color_layer_, directory + "/fused_color");
+}
+
+float SubmapManager::submap_distance_m() const { return submap_distance_m_; }
+
+float SubmapManager::submap_duration_s() const { return submap_duration_s_; }
+
+bool SubmapManager::fuse_frozen_submaps() const {
+  return fuse_frozen_submaps_;
+}
+
+float SubmapManager::fused_region_radius_m() const {
+  return fused_region_radius_m_;
+}
+
+void SubmapManager::submap_distance_m(float submap_distance_m) {
+  CHECK_GT(submap_distance_m, 0.0f);
+  submap_distance_m_ = submap_distance_m;
+}
+
+void SubmapManager::submap_duration_s(float submap_duration_s) {
+  CHECK_GT(submap_duration_s, 0.0f);
+  submap_duration_s_ = submap_duration_s;
+}
+
+void SubmapManager::fuse_frozen_submaps(bool fuse_frozen_submaps) {
+  fuse_frozen_submaps_ = fuse_frozen_submaps;
+}
+
+void SubmapManager::fused_region_radius_m(float fused_region_radius_m) {
+  CHECK_GT(fused_region_radius_m, 0.0f);
+  fused_region_radius_m_ = fused_region_radius_m;
+}
+
+parameters::ParameterTreeNode SubmapManager::getParameterTree(
+    const std::string& name_remap) const {
+  using parameters::ParameterTreeNode;
+  const std::string name = (name_remap.empty()) ? "submap_manager" : name_remap;
+  return ParameterTreeNode(
+      name, {ParameterTreeNode("submap_distance_m:", submap_distance_m_),
+             ParameterTreeNode("submap_duration_s:", submap_duration_s_),
+             ParameterTreeNode("fuse_frozen_submaps:", fuse_frozen_submaps_),
+             ParameterTreeNode("fused_region_radius_m:",
+                               fused_region_radius_m_),
+             ParameterTreeNode("offload_directory:", offload_directory_)});
+}
+
+}  // namespace nvblox
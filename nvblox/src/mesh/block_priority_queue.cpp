@@ -0,0 +1,150 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mesh/internal/block_priority_queue.h"
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+
+void BlockPriorityQueue::push(const Index3D& block_index, float priority) {
+  const auto it = positions_.find(block_index);
+  if (it != positions_.end()) {
+    // Update in place, keeping the original insertion order.
+    const size_t position = it->second;
+    const float old_priority = heap_[position].priority;
+    heap_[position].priority = priority;
+    if (priority > old_priority) {
+      siftUp(position);
+    } else if (priority < old_priority) {
+      siftDown(position);
+    }
+    return;
+  }
+  heap_.push_back({block_index, priority, next_sequence_number_++});
+  positions_[block_index] = heap_.size() - 1;
+  siftUp(heap_.size() - 1);
+}
+
+bool BlockPriorityQueue::erase(const Index3D& block_index) {
+  const auto it = positions_.find(block_index);
+  if (it == positions_.end()) {
+    return false;
+  }
+  const size_t position = it->second;
+  const size_t last_position = heap_.size() - 1;
+  if (position != last_position) {
+    swapEntries(position, last_position);
+  }
+  heap_.pop_back();
+  positions_.erase(it);
+  if (position < heap_.size()) {
+    // The entry moved into the gap may have to go either way.
+    if (position > 0 && isBefore(heap_[position], heap_[(position - 1) / 2])) {
+      siftUp(position);
+    } else {
+      siftDown(position);
+    }
+  }
+  return true;
+}
+
+const Index3D& BlockPriorityQueue::top() const {
+  CHECK(!heap_.empty());
+  return heap_.front().block_index;
+}
+
+float BlockPriorityQueue::topPriority() const {
+  CHECK(!heap_.empty());
+  return heap_.front().priority;
+}
+
+Index3D BlockPriorityQueue::pop() {
+  CHECK(!heap_.empty());
+  const Index3D block_index = heap_.front().block_index;
+  erase(block_index);
+  return block_index;
+}
+
+bool BlockPriorityQueue::contains(const Index3D& block_index) const {
+  return positions_.count(block_index) > 0;
+}
+
+float BlockPriorityQueue::priority(const Index3D& block_index) const {
+  const auto it = positions_.find(block_index);
+  CHECK(it != positions_.end());
+  return heap_[it->second].priority;
+}
+
+void BlockPriorityQueue::clear() {
+  heap_.clear();
+  positions_.clear();
+  next_sequence_number_ = 0;
+}
+
+std::vector<Index3D> BlockPriorityQueue::getBlockIndices() const {
+  std::vector<Index3D> block_indices;
+  block_indices.reserve(heap_.size());
+  for (const Entry& entry : heap_) {
+    block_indices.push_back(entry.block_index);
+  }
+  return block_indices;
+}
+
+bool BlockPriorityQueue::isBefore(const Entry& a, const Entry& b) {
+  if (a.priority != b.priority) {
+    return a.priority > b.priority;
+  }
+  return a.sequence_number < b.sequence_number;
+}
+
+void BlockPriorityQueue::siftUp(size_t position) {
+  while (position > 0) {
+    const size_t parent = (position - 1) / 2;
+    if (!isBefore(heap_[position], heap_[parent])) {
+      break;
+    }
+    swapEntries(position, parent);
+    position = parent;
+  }
+}
+
+void BlockPriorityQueue::siftDown(size_t position) {
+  const size_t size = heap_.size();
+  while (true) {
+    const size_t left = 2 * position + 1;
+    const size_t right = left + 1;
+    size_t first = position;
+    if (left < size && isBefore(heap_[left], heap_[first])) {
+      first = left;
+    }
+    if (right < size && isBefore(heap_[right], heap_[first])) {
+      first = right;
+    }
+    if (first == position) {
+      break;
+    }
+    swapEntries(position, first);
+    position = first;
+  }
+}
+
+void BlockPriorityQueue::swapEntries(size_t position_a, size_t position_b) {
+  std::swap(heap_[position_a], heap_[position_b]);
+  positions_[heap_[position_a].block_index] = position_a;
+  positions_[heap_[position_b].block_index] = position_b;
+}
+
+}  // namespace nvblox
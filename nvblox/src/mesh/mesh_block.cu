@@ -50,6 +50,16 @@ size_t MeshBlock::sizeInBytes() const {
 
 size_t MeshBlock::capacity() const { return vertices.capacity(); }
 
+MemoryUsage MeshBlock::getMemoryUsage() const {
+  MemoryUsage usage;
+  usage.host_bytes = sizeof(MeshBlock);
+  usage.addVector(vertices);
+  usage.addVector(normals);
+  usage.addVector(colors);
+  usage.addVector(triangles);
+  return usage;
+}
+
 void MeshBlock::expandColorsToMatchVertices() {
   colors.reserve(vertices.capacity());
   colors.resize(vertices.size());
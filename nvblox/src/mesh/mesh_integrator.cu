@@ -36,17 +36,12 @@ MeshIntegrator::MeshIntegrator()
     : MeshIntegrator(std::make_shared<CudaStreamOwning>()) {}
 
 MeshIntegrator::MeshIntegrator(std::shared_ptr<CudaStream> cuda_stream)
-    : cuda_stream_(cuda_stream) {
-  // clang-format off
-    cube_index_offsets_ << 0, 1, 1, 0, 0, 1, 1, 0,
-                           0, 0, 1, 1, 0, 0, 1, 1,
-                           0, 0, 0, 0, 1, 1, 1, 1;
-  // clang-format on
-}
+    : cuda_stream_(cuda_stream) {}
 
 // Return all indices that exists in layer
+template <typename LayerType>
 std::vector<Index3D> getIndicesInLayer(
-    const std::vector<Index3D>& block_indices_in, const TsdfLayer& layer) {
+    const std::vector<Index3D>& block_indices_in, const LayerType& layer) {
   std::vector<Index3D> out = block_indices_in;
 
   auto remove_end = std::remove_if(
@@ -61,6 +56,23 @@ bool MeshIntegrator::integrateBlocksGPU(
     const TsdfLayer& distance_layer,
     const std::vector<Index3D>& block_indices_in,
     BlockLayer<MeshBlock>* mesh_layer) {
+  return integrateBlocksGPUTemplate(distance_layer, block_indices_in,
+                                    mesh_layer);
+}
+
+bool MeshIntegrator::integrateBlocksGPU(
+    const CompactTsdfLayer& distance_layer,
+    const std::vector<Index3D>& block_indices_in,
+    BlockLayer<MeshBlock>* mesh_layer) {
+  return integrateBlocksGPUTemplate(distance_layer, block_indices_in,
+                                    mesh_layer);
+}
+
+template <typename LayerType>
+bool MeshIntegrator::integrateBlocksGPUTemplate(
+    const LayerType& distance_layer,
+    const std::vector<Index3D>& block_indices_in,
+    BlockLayer<MeshBlock>* mesh_layer) {
   timing::Timer mesh_timer("mesh/gpu/integrate");
   const std::vector<Index3D> block_indices =
       getIndicesInLayer(block_indices_in, distance_layer);
@@ -100,12 +112,15 @@ bool MeshIntegrator::integrateBlocksGPU(
 bool MeshIntegrator::integrateMeshFromDistanceField(
     const TsdfLayer& distance_layer, BlockLayer<MeshBlock>* mesh_layer,
     const DeviceType device_type) {
-  // First, get all the blocks.
-  std::vector<Index3D> block_indices = distance_layer.getAllBlockIndices();
   if (device_type == DeviceType::kCPU) {
-    return integrateBlocksCPU(distance_layer, block_indices, mesh_layer);
+    // Meshing a block reads its neighbours. Visiting the blocks in Morton
+    // order keeps the neighbours in cache.
+    return integrateBlocksCPU(distance_layer,
+                              distance_layer.getAllBlockIndicesInMortonOrder(),
+                              mesh_layer);
   } else {
-    return integrateBlocksGPU(distance_layer, block_indices, mesh_layer);
+    return integrateBlocksGPU(distance_layer,
+                              distance_layer.getAllBlockIndices(), mesh_layer);
   }
 }
 
@@ -120,43 +135,50 @@ bool MeshIntegrator::integrateBlocksCPU(
   const float block_size = distance_layer.block_size();
   const float voxel_size = distance_layer.voxel_size();
 
-  // For each block...
-  for (const Index3D& block_index : block_indices) {
-    // Get the block.
-    VoxelBlock<TsdfVoxel>::ConstPtr block =
-        distance_layer.getBlockAtIndex(block_index);
-
-    // Check meshability - basically if this contains anything near the
-    // border.
-    if (!isBlockMeshable(block, voxel_size * 2)) {
-      continue;
-    }
-
-    // Get all the neighbor blocks.
-    std::vector<VoxelBlock<TsdfVoxel>::ConstPtr> neighbor_blocks(8);
+  // Finding the triangle candidates only reads the distance layer, so the
+  // blocks are searched in parallel.
+  std::vector<std::vector<marching_cubes::PerVoxelMarchingCubesResults>>
+      triangle_candidates(block_indices.size());
+  thread_pool_->parallelFor(block_indices.size(), [&](int list_idx) {
+    const Index3D& block_index = block_indices[list_idx];
+    // Get the block and all the neighbor blocks.
+    marching_cubes::NeighborBlockPtrs<TsdfBlock> neighbor_blocks;
     for (int i = 0; i < 8; i++) {
       Index3D neighbor_index =
           block_index + marching_cubes::directionFromNeighborIndex(i);
-      neighbor_blocks[i] = distance_layer.getBlockAtIndex(neighbor_index);
+      neighbor_blocks[i] = distance_layer.getBlockAtIndex(neighbor_index).get();
+    }
+
+    if (neighbor_blocks[0] == nullptr) {
+      return;
+    }
+
+    // Check meshability - basically if this contains anything near the
+    // border.
+    if (!marching_cubes::isBlockMeshable(*neighbor_blocks[0], voxel_size * 2,
+                                         min_weight_)) {
+      return;
     }
 
     // Get all the potential triangles:
-    std::vector<marching_cubes::PerVoxelMarchingCubesResults>
-        triangle_candidates;
-    getTriangleCandidatesInBlock(block, neighbor_blocks, block_index,
-                                 block_size, &triangle_candidates);
+    marching_cubes::getTriangleCandidatesInBlock(
+        neighbor_blocks, block_index, block_size, min_weight_,
+        &triangle_candidates[list_idx]);
+  });
 
-    if (triangle_candidates.size() <= 0) {
+  // Allocating mesh blocks modifies the mesh layer, so meshing is serial.
+  for (size_t i = 0; i < block_indices.size(); i++) {
+    if (triangle_candidates[i].empty()) {
       continue;
     }
 
     // Allocate the mesh block.
     MeshBlock::Ptr mesh_block =
-        mesh_layer->allocateBlockAtIndexAsync(block_index, *cuda_stream_);
+        mesh_layer->allocateBlockAtIndexAsync(block_indices[i], *cuda_stream_);
 
     // Then actually calculate the triangles.
     for (const marching_cubes::PerVoxelMarchingCubesResults& candidate :
-         triangle_candidates) {
+         triangle_candidates[i]) {
       marching_cubes::meshCube(candidate, mesh_block.get());
     }
   }
@@ -164,139 +186,15 @@ bool MeshIntegrator::integrateBlocksCPU(
   return true;
 }
 
-bool MeshIntegrator::isBlockMeshable(
-    const VoxelBlock<TsdfVoxel>::ConstPtr block, float cutoff) const {
-  constexpr int kVoxelsPerSide = VoxelBlock<TsdfVoxel>::kVoxelsPerSide;
-
-  Index3D voxel_index;
-  // Iterate over all the voxels:
-  for (voxel_index.x() = 0; voxel_index.x() < kVoxelsPerSide;
-       voxel_index.x()++) {
-    for (voxel_index.y() = 0; voxel_index.y() < kVoxelsPerSide;
-         voxel_index.y()++) {
-      for (voxel_index.z() = 0; voxel_index.z() < kVoxelsPerSide;
-           voxel_index.z()++) {
-        const TsdfVoxel* voxel =
-            &block->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()];
-
-        // Check if voxel distance is within the cutoff to determine if
-        // there's going to be a surface boundary in this block.
-        if (voxel->weight >= min_weight_ &&
-            std::abs(voxel->distance) <= cutoff) {
-          return true;
-        }
-      }
-    }
-  }
-  return false;
-}
-
-void MeshIntegrator::getTriangleCandidatesInBlock(
-    const TsdfBlock::ConstPtr block,
-    const std::vector<TsdfBlock::ConstPtr>& neighbor_blocks,
-    const Index3D& block_index, const float block_size,
-    std::vector<marching_cubes::PerVoxelMarchingCubesResults>*
-        triangle_candidates) {
-  CHECK_NOTNULL(block);
-  CHECK_NOTNULL(triangle_candidates);
-
-  constexpr int kVoxelsPerSide = TsdfBlock::kVoxelsPerSide;
-  const float voxel_size = block_size / kVoxelsPerSide;
-
-  Index3D voxel_index;
-  // Iterate over all inside voxels.
-  for (voxel_index.x() = 0; voxel_index.x() < kVoxelsPerSide;
-       voxel_index.x()++) {
-    for (voxel_index.y() = 0; voxel_index.y() < kVoxelsPerSide;
-         voxel_index.y()++) {
-      for (voxel_index.z() = 0; voxel_index.z() < kVoxelsPerSide;
-           voxel_index.z()++) {
-        // Get the position of this voxel.
-        Vector3f voxel_position = getCenterPositionFromBlockIndexAndVoxelIndex(
-            block_size, block_index, voxel_index);
-
-        marching_cubes::PerVoxelMarchingCubesResults neighbors;
-        // Figure out if this voxel is actually a triangle candidate.
-        if (getTriangleCandidatesAroundVoxel(block, neighbor_blocks,
-                                             voxel_index, voxel_position,
-                                             voxel_size, &neighbors)) {
-          triangle_candidates->push_back(neighbors);
-        }
-      }
-    }
-  }
-}
-
-bool MeshIntegrator::getTriangleCandidatesAroundVoxel(
-    const TsdfBlock::ConstPtr block,
-    const std::vector<VoxelBlock<TsdfVoxel>::ConstPtr>& neighbor_blocks,
-    const Index3D& voxel_index, const Vector3f& voxel_position,
-    const float voxel_size,
-    marching_cubes::PerVoxelMarchingCubesResults* neighbors) {
-  DCHECK_EQ(neighbor_blocks.size(), 8);
-  constexpr int kVoxelsPerSide = VoxelBlock<bool>::kVoxelsPerSide;
-  for (unsigned int i = 0; i < 8; ++i) {
-    Index3D corner_index = voxel_index + cube_index_offsets_.col(i);
-
-    // Are we in bounds? If not, have to get a neighbor.
-    // The neighbor should correspond to the index in neighbor blocks.
-
-    bool search_neighbor = false;
-    Index3D block_offset(0, 0, 0);
-    for (int j = 0; j < 3; j++) {
-      if (corner_index[j] >= kVoxelsPerSide) {
-        // Here the index is too much.
-        corner_index(j) -= kVoxelsPerSide;
-        block_offset(j) = 1;
-        search_neighbor = true;
-      }
-    }
-
-    const TsdfVoxel* voxel = nullptr;
-    // Get the voxel either from the current block or from the corresponding
-    // neighbor.
-    if (search_neighbor) {
-      // Find the correct neighbor block.
-      int neighbor_index =
-          marching_cubes::neighborIndexFromDirection(block_offset);
-      if (neighbor_blocks[neighbor_index] == nullptr) {
-        return false;
-      }
-      voxel =
-          &neighbor_blocks[neighbor_index]
-               ->voxels[corner_index.x()][corner_index.y()][corner_index.z()];
-    } else {
-      voxel =
-          &block->voxels[corner_index.x()][corner_index.y()][corner_index.z()];
-    }
-
-    // If any of the neighbors are not observed, this can't be a mesh
-    // triangle.
-    if (voxel->weight < min_weight_) {
-      return false;
-    }
-    neighbors->vertex_sdf[i] = voxel->distance;
-    neighbors->vertex_coords[i] =
-        voxel_position + voxel_size * cube_index_offsets_.col(i).cast<float>();
-  }
-
-  // Figure out the index if we've made it this far.
-  neighbors->marching_cubes_table_index =
-      marching_cubes::calculateVertexConfiguration(neighbors->vertex_sdf);
-
-  // Index 0 & 255 contain no triangles so not worth outputting it.
-  return neighbors->marching_cubes_table_index != 0 &&
-         neighbors->marching_cubes_table_index != 255;
-}
-
 // Kernels
 
 // Takes in a vector of blocks, and outputs an integer true if that block is
 // meshable.
 // Block size MUST be voxels_per_side x voxels_per_side x voxel_per_size.
 // Grid size can be anything.
+template <typename VoxelType>
 __global__ void isBlockMeshableKernel(int num_blocks,
-                                      const VoxelBlock<TsdfVoxel>** blocks,
+                                      const VoxelBlock<VoxelType>** blocks,
                                       float cutoff_distance, float min_weight,
                                       bool* meshable) {
   dim3 voxel_index = threadIdx;
@@ -306,10 +204,12 @@ __global__ void isBlockMeshableKernel(int num_blocks,
   for (int block_index = blockIdx.x; block_index < num_blocks;
        block_index += gridDim.x) {
     // Get the correct voxel for this index.
-    const TsdfVoxel& voxel =
+    const VoxelType& voxel =
         blocks[block_index]
             ->voxels[voxel_index.z][voxel_index.y][voxel_index.x];
-    if (fabs(voxel.distance) <= cutoff_distance && voxel.weight >= min_weight) {
+    const float distance = voxel.distance;
+    const float weight = voxel.weight;
+    if (fabs(distance) <= cutoff_distance && weight >= min_weight) {
       meshable[block_index] = true;
     }
   }
@@ -320,12 +220,13 @@ __global__ void isBlockMeshableKernel(int num_blocks,
 // meshes for them.
 // Block size MUST be voxels_per_side x voxels_per_side x voxel_per_size.
 // Grid size can be anything.
+template <typename VoxelType>
 __global__ void meshBlocksCalculateTableIndicesKernel(
-    int num_blocks, const VoxelBlock<TsdfVoxel>** blocks,
+    int num_blocks, const VoxelBlock<VoxelType>** blocks,
     const Vector3f* block_positions, float voxel_size, float min_weight,
     marching_cubes::PerVoxelMarchingCubesResults* marching_cubes_results,
     int* mesh_block_sizes) {
-  constexpr int kVoxelsPerSide = VoxelBlock<TsdfVoxel>::kVoxelsPerSide;
+  constexpr int kVoxelsPerSide = VoxelBlock<VoxelType>::kVoxelsPerSide;
   constexpr int kVoxelsPerBlock =
       kVoxelsPerSide * kVoxelsPerSide * kVoxelsPerSide;
   constexpr int kCubeNeighbors = 8;
@@ -354,7 +255,7 @@ __global__ void meshBlocksCalculateTableIndicesKernel(
     __syncthreads();
 
     // Getting the block pointer is complicated now so let's just get it.
-    const VoxelBlock<TsdfVoxel>* block = blocks[block_index * kCubeNeighbors];
+    const VoxelBlock<VoxelType>* block = blocks[block_index * kCubeNeighbors];
 
     // Get the linear index of the this voxel in this block
     const int vertex_neighbor_idx =
@@ -380,12 +281,12 @@ __global__ void meshBlocksCalculateTableIndicesKernel(
         }
       }
 
-      const TsdfVoxel* voxel = nullptr;
+      const VoxelType* voxel = nullptr;
       // Don't look for neighbors for now.
       if (search_neighbor) {
         int neighbor_index =
             marching_cubes::neighborIndexFromDirection(block_offset);
-        const VoxelBlock<TsdfVoxel>* neighbor_block =
+        const VoxelBlock<VoxelType>* neighbor_block =
             blocks[block_index * kCubeNeighbors + neighbor_index];
         if (neighbor_block == nullptr) {
           skip_voxel = true;
@@ -477,8 +378,9 @@ __global__ void meshBlocksCalculateVerticesKernel(
 
 // Wrappers
 
+template <typename LayerType>
 void MeshIntegrator::getMeshableBlocksGPU(
-    const TsdfLayer& distance_layer, const std::vector<Index3D>& block_indices,
+    const LayerType& distance_layer, const std::vector<Index3D>& block_indices,
     float cutoff_distance, std::vector<Index3D>* meshable_blocks) {
   CHECK_NOTNULL(meshable_blocks);
   if (block_indices.size() == 0) {
@@ -493,21 +395,21 @@ void MeshIntegrator::getMeshableBlocksGPU(
 
   // Collect all the meshable blocks as raw pointers.
   // Get all the block pointers and positions.
-  block_ptrs_host_.resize(block_indices.size());
+  auto& block_ptrs = getBlockPtrBuffers(distance_layer);
+  block_ptrs.host.resize(block_indices.size());
 
   for (size_t i = 0; i < block_indices.size(); i++) {
-    block_ptrs_host_[i] =
-        distance_layer.getBlockAtIndex(block_indices[i]).get();
+    block_ptrs.host[i] = distance_layer.getBlockAtIndex(block_indices[i]).get();
   }
 
-  block_ptrs_device_.copyFromAsync(block_ptrs_host_, *cuda_stream_);
+  block_ptrs.device.copyFromAsync(block_ptrs.host, *cuda_stream_);
 
   // Allocate a device vector that holds the meshable result.
   meshable_device_.resizeAsync(block_indices.size(), *cuda_stream_);
   meshable_device_.setZeroAsync(*cuda_stream_);
 
   isBlockMeshableKernel<<<dim_block, dim_threads, 0, *cuda_stream_>>>(
-      block_indices.size(), block_ptrs_device_.data(), cutoff_distance,
+      block_indices.size(), block_ptrs.device.data(), cutoff_distance,
       min_weight_, meshable_device_.data());
 
   checkCudaErrors(cudaPeekAtLastError());
@@ -522,7 +424,8 @@ void MeshIntegrator::getMeshableBlocksGPU(
   }
 }
 
-void MeshIntegrator::meshBlocksGPU(const TsdfLayer& distance_layer,
+template <typename LayerType>
+void MeshIntegrator::meshBlocksGPU(const LayerType& distance_layer,
                                    const std::vector<Index3D>& block_indices,
                                    BlockLayer<MeshBlock>* mesh_layer) {
   if (block_indices.empty()) {
@@ -544,14 +447,15 @@ void MeshIntegrator::meshBlocksGPU(const TsdfLayer& distance_layer,
   // Get all the block pointers and positions.
   // Block pointers are actually a 2D array of also the neighbor block pointers
   // The neighbors CAN be null so they need to be checked.
-  block_ptrs_host_.resize(block_indices.size() * kCubeNeighbors);
+  auto& block_ptrs = getBlockPtrBuffers(distance_layer);
+  block_ptrs.host.resize(block_indices.size() * kCubeNeighbors);
   block_positions_host_.resize(block_indices.size());
   for (size_t i = 0; i < block_indices.size(); i++) {
-    block_ptrs_host_[i * kCubeNeighbors] =
+    block_ptrs.host[i * kCubeNeighbors] =
         distance_layer.getBlockAtIndex(block_indices[i]).get();
     for (size_t j = 1; j < kCubeNeighbors; j++) {
       // Get the pointers to all the neighbors as well.
-      block_ptrs_host_[i * kCubeNeighbors + j] =
+      block_ptrs.host[i * kCubeNeighbors + j] =
           distance_layer
               .getBlockAtIndex(block_indices[i] +
                                marching_cubes::directionFromNeighborIndex(j))
@@ -565,7 +469,7 @@ void MeshIntegrator::meshBlocksGPU(const TsdfLayer& distance_layer,
   mesh_blocks_host_.resize(block_indices.size());
   mesh_blocks_host_.setZeroAsync(*cuda_stream_);
 
-  block_ptrs_device_.copyFromAsync(block_ptrs_host_, *cuda_stream_);
+  block_ptrs.device.copyFromAsync(block_ptrs.host, *cuda_stream_);
   block_positions_device_.copyFromAsync(block_positions_host_, *cuda_stream_);
 
   // Allocate working space
@@ -584,7 +488,7 @@ void MeshIntegrator::meshBlocksGPU(const TsdfLayer& distance_layer,
   timing::Timer mesh_kernel_1_timer("mesh/gpu/mesh_blocks/kernel_table");
   meshBlocksCalculateTableIndicesKernel<<<dim_block, dim_threads, 0,
                                           *cuda_stream_>>>(
-      block_indices.size(), block_ptrs_device_.data(),
+      block_indices.size(), block_ptrs.device.data(),
       block_positions_device_.data(), voxel_size, min_weight_,
       marching_cubes_results_device_.data(), mesh_block_sizes_device_.data());
   checkCudaErrors(cudaPeekAtLastError());
@@ -811,7 +715,30 @@ parameters::ParameterTreeNode MeshIntegrator::getParameterTree(
                 ParameterTreeNode("min_weight:", min_weight_),
                 ParameterTreeNode("cutoff_distance_vox:", cutoff_distance_vox_),
                 ParameterTreeNode("weld_vertices:", weld_vertices_),
+                ParameterTreeNode("color_interpolation_trilinear:",
+                                  color_interpolation_trilinear_),
+                ParameterTreeNode("num_color_threads:", num_color_threads_),
             });
 }
 
+MemoryUsage MeshIntegrator::getScratchMemoryUsage() const {
+  MemoryUsage usage;
+  usage.addVector(tsdf_block_ptrs_.host);
+  usage.addVector(tsdf_block_ptrs_.device);
+  usage.addVector(compact_tsdf_block_ptrs_.host);
+  usage.addVector(compact_tsdf_block_ptrs_.device);
+  usage.addVector(meshable_host_);
+  usage.addVector(meshable_device_);
+  usage.addVector(block_positions_host_);
+  usage.addVector(block_positions_device_);
+  usage.addVector(mesh_blocks_host_);
+  usage.addVector(mesh_blocks_device_);
+  usage.addVector(input_vertices_);
+  usage.addVector(input_normals_);
+  usage.addVector(marching_cubes_results_device_);
+  usage.addVector(mesh_block_sizes_device_);
+  usage.addVector(mesh_block_sizes_host_);
+  return usage;
+}
+
 }  // namespace nvblox
@@ -15,6 +15,10 @@ limitations under the License.
 */
 #include <cuda_runtime.h>
 
+#include <array>
+#include <atomic>
+
+#include "nvblox/core/indexing.h"
 #include "nvblox/integrators/internal/integrators_common.h"
 #include "nvblox/map/accessors.h"
 #include "nvblox/map/common_names.h"
@@ -270,29 +274,158 @@ void MeshIntegrator::colorMeshGPU(
 
 void MeshIntegrator::colorMeshCPU(const ColorLayer& color_layer,
                                   BlockLayer<MeshBlock>* mesh_layer) {
-  colorMeshCPU(color_layer, mesh_layer->getAllBlockIndices(), mesh_layer);
+  // Neighbouring mesh blocks read the same color blocks. Visit them in Morton
+  // order such that those stay in cache.
+  colorMeshCPU(color_layer, mesh_layer->getAllBlockIndicesInMortonOrder(),
+               mesh_layer);
+}
+
+namespace {
+
+// Caches the color blocks around a mesh block, such that each of them is
+// looked up in the color layer at most once per mesh block, rather than once
+// per vertex.
+class ColorBlockNeighborhood {
+ public:
+  ColorBlockNeighborhood(const ColorLayer& color_layer,
+                         const Index3D& center_block_idx)
+      : color_layer_(color_layer), center_block_idx_(center_block_idx) {
+    blocks_.fill(nullptr);
+    resolved_.fill(false);
+  }
+
+  // Returns the voxel with the given index in the layer, or nullptr if its
+  // block is not allocated.
+  const ColorVoxel* getVoxel(const Index3D& voxel_idx_in_layer) {
+    constexpr int kVoxelsPerSide = ColorBlock::kVoxelsPerSide;
+    const Index3D block_idx = voxel_idx_in_layer.unaryExpr([](int i) {
+      return (i >= 0) ? i / kVoxelsPerSide
+                      : (i - kVoxelsPerSide + 1) / kVoxelsPerSide;
+    });
+    const ColorBlock* block_ptr = getBlock(block_idx);
+    if (block_ptr == nullptr) {
+      return nullptr;
+    }
+    const Index3D voxel_idx = voxel_idx_in_layer - block_idx * kVoxelsPerSide;
+    return &block_ptr->voxels[voxel_idx.x()][voxel_idx.y()][voxel_idx.z()];
+  }
+
+ private:
+  const ColorBlock* getBlock(const Index3D& block_idx) {
+    const Index3D offset = block_idx - center_block_idx_ + Index3D::Ones();
+    if ((offset.array() < 0).any() || (offset.array() > 2).any()) {
+      // Vertices (almost) never leave the neighborhood of their block.
+      return color_layer_.getBlockAtIndex(block_idx).get();
+    }
+    const int linear_idx = offset.x() * 9 + offset.y() * 3 + offset.z();
+    if (!resolved_[linear_idx]) {
+      blocks_[linear_idx] = color_layer_.getBlockAtIndex(block_idx).get();
+      resolved_[linear_idx] = true;
+    }
+    return blocks_[linear_idx];
+  }
+
+  const ColorLayer& color_layer_;
+  const Index3D center_block_idx_;
+  std::array<const ColorBlock*, 27> blocks_;
+  std::array<bool, 27> resolved_;
+};
+
+// Interpolates the colors of the observed voxels around a position. Returns
+// false if none of them was observed.
+bool interpolateColorTrilinear(const Vector3f& position, float voxel_size,
+                               ColorBlockNeighborhood* neighborhood,
+                               Color* color) {
+  // Voxel centers are at (i + 0.5) * voxel_size.
+  const Vector3f position_vox =
+      position / voxel_size - Vector3f::Constant(0.5f);
+  const Vector3f low_corner_vox = position_vox.array().floor();
+  const Index3D low_corner_idx = low_corner_vox.cast<int>();
+  const Vector3f fraction = position_vox - low_corner_vox;
+
+  Vector3f color_sum = Vector3f::Zero();
+  float weight_sum = 0.0f;
+  for (int i = 0; i < 8; i++) {
+    const Index3D corner_offset(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+    float weight = 1.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      weight *= corner_offset[axis] ? fraction[axis] : 1.0f - fraction[axis];
+    }
+    if (weight <= 0.0f) {
+      continue;
+    }
+    const ColorVoxel* voxel =
+        neighborhood->getVoxel(low_corner_idx + corner_offset);
+    if (voxel == nullptr || voxel->weight <= 0.0f) {
+      continue;
+    }
+    color_sum += weight * Vector3f(voxel->color.r, voxel->color.g,
+                                   voxel->color.b);
+    weight_sum += weight;
+  }
+  if (weight_sum <= 0.0f) {
+    return false;
+  }
+  const Vector3f interpolated = color_sum / weight_sum;
+  *color = Color(static_cast<uint8_t>(std::round(interpolated.x())),
+                 static_cast<uint8_t>(std::round(interpolated.y())),
+                 static_cast<uint8_t>(std::round(interpolated.z())));
+  return true;
 }
 
+}  // namespace
+
 void MeshIntegrator::colorMeshCPU(const ColorLayer& color_layer,
                                   const std::vector<Index3D>& block_indices,
                                   BlockLayer<MeshBlock>* mesh_layer) {
-  // For each vertex just grab the closest color
+  CHECK_NOTNULL(mesh_layer);
+  CHECK_EQ(color_layer.block_size(), mesh_layer->block_size());
+  timing::Timer timer("mesh/cpu/color");
+
+  // Allocate the colors up front, such that the workers only write to
+  // existing memory.
+  std::vector<std::pair<Index3D, MeshBlock*>> mesh_blocks;
+  mesh_blocks.reserve(block_indices.size());
   for (const Index3D& block_idx : block_indices) {
     MeshBlock::Ptr block = mesh_layer->getBlockAtIndex(block_idx);
     if (block == nullptr) {
       continue;
     }
-    block->colors.resize(block->vertices.size());
-    for (size_t i = 0; i < block->vertices.size(); i++) {
-      const Vector3f& vertex = block->vertices[i];
-      const ColorVoxel* color_voxel;
-      if (getVoxelAtPosition<ColorVoxel>(color_layer, vertex, &color_voxel)) {
-        block->colors[i] = color_voxel->color;
-      } else {
-        block->colors[i] = Color::Gray();
+    block->expandColorsToMatchVertices();
+    mesh_blocks.emplace_back(block_idx, block.get());
+  }
+
+  const float voxel_size = blockSizeToVoxelSize(color_layer.block_size());
+  const bool interpolate = color_interpolation_trilinear_;
+  const Color default_color = default_mesh_color_;
+
+  // Mesh blocks are handed out to the worker threads dynamically. Each mesh
+  // block only writes its own colors.
+  std::atomic<size_t> next_block{0};
+  auto worker = [&]() {
+    for (size_t i = next_block++; i < mesh_blocks.size(); i = next_block++) {
+      const auto& [block_idx, block] = mesh_blocks[i];
+      ColorBlockNeighborhood neighborhood(color_layer, block_idx);
+      for (size_t v = 0; v < block->vertices.size(); v++) {
+        const Vector3f& vertex = block->vertices[v];
+        if (interpolate && interpolateColorTrilinear(vertex, voxel_size,
+                                                     &neighborhood,
+                                                     &block->colors[v])) {
+          continue;
+        }
+        // The closest voxel.
+        const Index3D voxel_idx =
+            (vertex / voxel_size).array().floor().cast<int>();
+        const ColorVoxel* color_voxel = neighborhood.getVoxel(voxel_idx);
+        block->colors[v] =
+            (color_voxel != nullptr) ? color_voxel->color : default_color;
       }
     }
-  }
+  };
+
+  // The calling thread does its share of the work.
+  thread_pool_->runWorkers(
+      thread_pool_->numWorkers(num_color_threads_, mesh_blocks.size()), worker);
 }
 
 }  // namespace nvblox
@@ -0,0 +1,127 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mesh/mesh_lod.h"
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+
+MeshLodLayers::MeshLodLayers(float block_size, MemoryType memory_type,
+                             int num_lods) {
+  CHECK_GT(block_size, 0.0f);
+  CHECK_GE(num_lods, 1);
+  for (int lod = 1; lod < num_lods; lod++) {
+    lod_layers_.push_back(std::make_unique<MeshLayer>(block_size, memory_type));
+  }
+}
+
+void MeshLodLayers::updateBlocks(const MeshLayer& mesh_layer,
+                                 const std::vector<Index3D>& block_indices) {
+  // Each level is simplified from the previous one, which is cheaper than
+  // simplifying the full resolution mesh each time.
+  const MeshLayer* input_layer = &mesh_layer;
+  float max_error_m = lod1_max_error_m_;
+  for (std::unique_ptr<MeshLayer>& lod_layer : lod_layers_) {
+    simplifier_.max_error_m(max_error_m);
+    simplifier_.target_triangle_ratio(lod_triangle_ratio_);
+    simplifier_.simplifyBlocks(*input_layer, block_indices, lod_layer.get());
+    input_layer = lod_layer.get();
+    max_error_m *= 2.0f;
+  }
+}
+
+const MeshLayer& MeshLodLayers::getLodLayer(int lod) const {
+  CHECK_GE(lod, 1);
+  CHECK_LT(lod, num_lods());
+  return *lod_layers_[lod - 1];
+}
+
+MeshBlock::ConstPtr MeshLodLayers::getBlockAtLod(const MeshLayer& mesh_layer,
+                                                 const Index3D& block_index,
+                                                 int lod) const {
+  CHECK_GE(lod, 0);
+  CHECK_LT(lod, num_lods());
+  for (; lod > 0; lod--) {
+    const MeshBlock::ConstPtr block =
+        lod_layers_[lod - 1]->getBlockAtIndex(block_index);
+    if (block) {
+      return block;
+    }
+  }
+  return mesh_layer.getBlockAtIndex(block_index);
+}
+
+int MeshLodLayers::selectLodForDistance(float distance_m) const {
+  // Level l starts at lod_distance_m * 2^(l - 1).
+  int lod = 0;
+  float lod_start_distance_m = lod_distance_m_;
+  while (lod < num_lods() - 1 && distance_m >= lod_start_distance_m) {
+    ++lod;
+    lod_start_distance_m *= 2.0f;
+  }
+  return lod;
+}
+
+void MeshLodLayers::assembleMixedLodLayer(
+    const MeshLayer& mesh_layer, const std::vector<Index3D>& block_indices,
+    const std::vector<int>& lods, MeshLayer* output) const {
+  CHECK_NOTNULL(output);
+  CHECK_EQ(block_indices.size(), lods.size());
+  CHECK_EQ(mesh_layer.block_size(), output->block_size());
+  output->clear();
+  for (size_t i = 0; i < block_indices.size(); i++) {
+    const MeshBlock::ConstPtr block =
+        getBlockAtLod(mesh_layer, block_indices[i], lods[i]);
+    if (block) {
+      output->allocateBlockAtIndex(block_indices[i])->copyFrom(*block);
+    }
+  }
+}
+
+float MeshLodLayers::lod_distance_m() const { return lod_distance_m_; }
+
+float MeshLodLayers::lod1_max_error_m() const { return lod1_max_error_m_; }
+
+float MeshLodLayers::lod_triangle_ratio() const { return lod_triangle_ratio_; }
+
+void MeshLodLayers::lod_distance_m(float lod_distance_m) {
+  CHECK_GT(lod_distance_m, 0.0f);
+  lod_distance_m_ = lod_distance_m;
+}
+
+void MeshLodLayers::lod1_max_error_m(float lod1_max_error_m) {
+  CHECK_GE(lod1_max_error_m, 0.0f);
+  lod1_max_error_m_ = lod1_max_error_m;
+}
+
+void MeshLodLayers::lod_triangle_ratio(float lod_triangle_ratio) {
+  CHECK_GE(lod_triangle_ratio, 0.0f);
+  CHECK_LE(lod_triangle_ratio, 1.0f);
+  lod_triangle_ratio_ = lod_triangle_ratio;
+}
+
+parameters::ParameterTreeNode MeshLodLayers::getParameterTree(
+    const std::string& name_remap) const {
+  using parameters::ParameterTreeNode;
+  const std::string name = (name_remap.empty()) ? "mesh_lod" : name_remap;
+  return ParameterTreeNode(
+      name, {ParameterTreeNode("num_lods:", num_lods()),
+             ParameterTreeNode("lod_distance_m:", lod_distance_m_),
+             ParameterTreeNode("lod1_max_error_m:", lod1_max_error_m_),
+             ParameterTreeNode("lod_triangle_ratio:", lod_triangle_ratio_)});
+}
+
+}  // namespace nvblox
@@ -0,0 +1,462 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mesh/mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+namespace {
+
+// The plane quadric p * p^T of a plane p = (n, d). The sum of the quadrics of
+// several planes evaluates to the summed squared distance to these planes.
+using Quadric = Eigen::Matrix4d;
+
+// A candidate collapse of the vertex "from" onto the vertex "to". The
+// versions of the two vertices at the time the candidate was created are used
+// to detect stale candidates.
+struct EdgeCollapse {
+  double cost;
+  int from;
+  int to;
+  int from_version;
+  int to_version;
+
+  bool operator>(const EdgeCollapse& other) const { return cost > other.cost; }
+};
+
+uint64_t edgeKey(int a, int b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) |
+         static_cast<uint32_t>(b);
+}
+
+// Hashes the exact bit pattern of a position, for welding duplicate vertices.
+struct PositionHash {
+  size_t operator()(const std::array<uint32_t, 3>& bits) const {
+    return (static_cast<size_t>(bits[0]) * 73856093) ^
+           (static_cast<size_t>(bits[1]) * 19349669) ^
+           (static_cast<size_t>(bits[2]) * 83492791);
+  }
+};
+
+std::array<uint32_t, 3> positionBits(const Vector3f& position) {
+  std::array<uint32_t, 3> bits;
+  std::memcpy(bits.data(), position.data(), sizeof(bits));
+  return bits;
+}
+
+// Simplifies a triangle mesh in host memory, in place.
+class HostMeshSimplification {
+ public:
+  HostMeshSimplification(std::vector<Vector3f>* vertices,
+                         std::vector<Vector3f>* normals,
+                         std::vector<Color>* colors, std::vector<int>* indices)
+      : vertices_(*CHECK_NOTNULL(vertices)),
+        normals_(*CHECK_NOTNULL(normals)),
+        colors_(*CHECK_NOTNULL(colors)),
+        indices_(*CHECK_NOTNULL(indices)) {}
+
+  void simplify(float max_error_m, float target_triangle_ratio,
+                float min_normal_cosine) {
+    weldVertices();
+    if (triangles_.empty()) {
+      writeOutput();
+      return;
+    }
+    initialize();
+
+    const int target_num_triangles = static_cast<int>(
+        std::ceil(target_triangle_ratio * static_cast<float>(num_triangles_)));
+    const double max_cost = static_cast<double>(max_error_m) * max_error_m;
+    while (!collapse_queue_.empty() && num_triangles_ > target_num_triangles) {
+      const EdgeCollapse collapse = collapse_queue_.top();
+      if (collapse.cost > max_cost) {
+        break;
+      }
+      collapse_queue_.pop();
+      // Skip candidates which were invalidated by earlier collapses.
+      if (vertex_removed_[collapse.from] || vertex_removed_[collapse.to] ||
+          vertex_versions_[collapse.from] != collapse.from_version ||
+          vertex_versions_[collapse.to] != collapse.to_version) {
+        continue;
+      }
+      if (!isCollapseValid(collapse.from, collapse.to, min_normal_cosine)) {
+        continue;
+      }
+      applyCollapse(collapse.from, collapse.to);
+    }
+    writeOutput();
+  }
+
+ private:
+  // Merges vertices at identical positions (blocks from the GPU mesher are
+  // not welded) and drops degenerate triangles.
+  void weldVertices() {
+    const bool has_normals = normals_.size() == vertices_.size();
+    const bool has_colors = colors_.size() == vertices_.size();
+    std::unordered_map<std::array<uint32_t, 3>, int, PositionHash>
+        position_to_vertex;
+    std::vector<int> vertex_remap(vertices_.size());
+    std::vector<Vector3f> welded_normals;
+    std::vector<Color> welded_colors;
+    for (size_t i = 0; i < vertices_.size(); i++) {
+      const auto [it, inserted] = position_to_vertex.emplace(
+          positionBits(vertices_[i]), static_cast<int>(positions_.size()));
+      vertex_remap[i] = it->second;
+      if (inserted) {
+        positions_.push_back(vertices_[i]);
+        if (has_normals) {
+          welded_normals.push_back(normals_[i]);
+        }
+        if (has_colors) {
+          welded_colors.push_back(colors_[i]);
+        }
+      }
+    }
+    normals_ = std::move(welded_normals);
+    colors_ = std::move(welded_colors);
+
+    CHECK_EQ(indices_.size() % 3, 0);
+    for (size_t i = 0; i + 2 < indices_.size(); i += 3) {
+      const std::array<int, 3> triangle = {vertex_remap[indices_[i]],
+                                           vertex_remap[indices_[i + 1]],
+                                           vertex_remap[indices_[i + 2]]};
+      if (triangle[0] != triangle[1] && triangle[1] != triangle[2] &&
+          triangle[0] != triangle[2]) {
+        triangles_.push_back(triangle);
+      }
+    }
+  }
+
+  void initialize() {
+    const size_t num_vertices = positions_.size();
+    num_triangles_ = static_cast<int>(triangles_.size());
+    triangle_removed_.assign(triangles_.size(), false);
+    vertex_removed_.assign(num_vertices, false);
+    vertex_locked_.assign(num_vertices, false);
+    vertex_versions_.assign(num_vertices, 0);
+    vertex_triangles_.assign(num_vertices, {});
+    quadrics_.assign(num_vertices, Quadric::Zero());
+
+    std::unordered_map<uint64_t, int> edge_counts;
+    for (size_t t = 0; t < triangles_.size(); t++) {
+      const std::array<int, 3>& triangle = triangles_[t];
+      for (int i = 0; i < 3; i++) {
+        vertex_triangles_[triangle[i]].push_back(static_cast<int>(t));
+        ++edge_counts[edgeKey(triangle[i], triangle[(i + 1) % 3])];
+      }
+      // Accumulate the plane of the triangle in its vertices' quadrics.
+      const Vector3f normal = triangleNormal(triangle);
+      const float norm = normal.norm();
+      if (norm > 0.0f) {
+        const Eigen::Vector3d n = (normal / norm).cast<double>();
+        Eigen::Vector4d plane;
+        plane << n, -n.dot(positions_[triangle[0]].cast<double>());
+        const Quadric quadric = plane * plane.transpose();
+        for (int i = 0; i < 3; i++) {
+          quadrics_[triangle[i]] += quadric;
+        }
+      }
+    }
+
+    // Vertices on open (and non-manifold) edges are locked. This preserves
+    // the block borders and holes in the mesh.
+    for (const auto& [key, count] : edge_counts) {
+      if (count != 2) {
+        vertex_locked_[static_cast<int>(key >> 32)] = true;
+        vertex_locked_[static_cast<int>(key & 0xFFFFFFFF)] = true;
+      }
+    }
+
+    for (const auto& [key, count] : edge_counts) {
+      pushEdge(static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFF));
+    }
+  }
+
+  Vector3f triangleNormal(const std::array<int, 3>& triangle) const {
+    const Vector3f& a = positions_[triangle[0]];
+    return (positions_[triangle[1]] - a).cross(positions_[triangle[2]] - a);
+  }
+
+  double collapseCost(int from, int to) const {
+    const Eigen::Vector4d p = positions_[to].cast<double>().homogeneous();
+    return p.dot((quadrics_[from] + quadrics_[to]) * p);
+  }
+
+  // Queues the cheaper of the two collapse directions of an edge. Locked
+  // vertices are never collapsed away.
+  void pushEdge(int a, int b) {
+    std::optional<EdgeCollapse> best;
+    for (const auto& [from, to] : {std::make_pair(a, b), std::make_pair(b, a)}) {
+      if (vertex_locked_[from]) {
+        continue;
+      }
+      const double cost = collapseCost(from, to);
+      if (!best || cost < best->cost) {
+        best = EdgeCollapse{cost, from, to, vertex_versions_[from],
+                            vertex_versions_[to]};
+      }
+    }
+    if (best) {
+      collapse_queue_.push(*best);
+    }
+  }
+
+  bool containsVertex(const std::array<int, 3>& triangle, int vertex) const {
+    return triangle[0] == vertex || triangle[1] == vertex ||
+           triangle[2] == vertex;
+  }
+
+  std::unordered_set<int> getNeighbors(int vertex) const {
+    std::unordered_set<int> neighbors;
+    for (const int t : vertex_triangles_[vertex]) {
+      if (triangle_removed_[t]) {
+        continue;
+      }
+      for (const int v : triangles_[t]) {
+        if (v != vertex) {
+          neighbors.insert(v);
+        }
+      }
+    }
+    return neighbors;
+  }
+
+  bool isCollapseValid(int from, int to, float min_normal_cosine) const {
+    // The link condition: the only vertices adjacent to both ends of the edge
+    // are the opposite corners of the triangles sharing the edge. Otherwise
+    // the collapse changes the topology of the mesh.
+    int num_shared_triangles = 0;
+    for (const int t : vertex_triangles_[from]) {
+      if (!triangle_removed_[t] && containsVertex(triangles_[t], to)) {
+        ++num_shared_triangles;
+      }
+    }
+    if (num_shared_triangles == 0) {
+      return false;
+    }
+    const std::unordered_set<int> from_neighbors = getNeighbors(from);
+    const std::unordered_set<int> to_neighbors = getNeighbors(to);
+    int num_common_neighbors = 0;
+    for (const int v : from_neighbors) {
+      num_common_neighbors += to_neighbors.count(v);
+    }
+    if (num_common_neighbors != num_shared_triangles) {
+      return false;
+    }
+
+    // Reject collapses which flip or degenerate the remaining triangles.
+    for (const int t : vertex_triangles_[from]) {
+      const std::array<int, 3>& triangle = triangles_[t];
+      if (triangle_removed_[t] || containsVertex(triangle, to)) {
+        continue;
+      }
+      std::array<int, 3> collapsed_triangle = triangle;
+      for (int& v : collapsed_triangle) {
+        if (v == from) {
+          v = to;
+        }
+      }
+      const Vector3f old_normal = triangleNormal(triangle);
+      const Vector3f new_normal = triangleNormal(collapsed_triangle);
+      const float old_norm = old_normal.norm();
+      const float new_norm = new_normal.norm();
+      if (new_norm <= 0.0f) {
+        return false;
+      }
+      if (old_norm > 0.0f && old_normal.dot(new_normal) <
+                                 min_normal_cosine * old_norm * new_norm) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void applyCollapse(int from, int to) {
+    for (const int t : vertex_triangles_[from]) {
+      if (triangle_removed_[t]) {
+        continue;
+      }
+      std::array<int, 3>& triangle = triangles_[t];
+      if (containsVertex(triangle, to)) {
+        triangle_removed_[t] = true;
+        --num_triangles_;
+      } else {
+        for (int& v : triangle) {
+          if (v == from) {
+            v = to;
+          }
+        }
+        vertex_triangles_[to].push_back(t);
+      }
+    }
+    vertex_triangles_[from].clear();
+    vertex_removed_[from] = true;
+    quadrics_[to] += quadrics_[from];
+    ++vertex_versions_[to];
+
+    // Drop references to removed triangles and requeue the edges around the
+    // surviving vertex.
+    std::vector<int>& to_triangles = vertex_triangles_[to];
+    to_triangles.erase(
+        std::remove_if(to_triangles.begin(), to_triangles.end(),
+                       [this](int t) { return triangle_removed_[t]; }),
+        to_triangles.end());
+    for (const int neighbor : getNeighbors(to)) {
+      pushEdge(to, neighbor);
+    }
+  }
+
+  // Writes the surviving vertices and triangles back to the input vectors.
+  void writeOutput() {
+    const bool has_normals = normals_.size() == positions_.size();
+    const bool has_colors = colors_.size() == positions_.size();
+    std::vector<int> vertex_remap(positions_.size(), -1);
+    vertices_.clear();
+    std::vector<Vector3f> output_normals;
+    std::vector<Color> output_colors;
+    indices_.clear();
+    for (size_t t = 0; t < triangles_.size(); t++) {
+      if (!triangle_removed_.empty() && triangle_removed_[t]) {
+        continue;
+      }
+      for (const int v : triangles_[t]) {
+        if (vertex_remap[v] < 0) {
+          vertex_remap[v] = static_cast<int>(vertices_.size());
+          vertices_.push_back(positions_[v]);
+          if (has_normals) {
+            output_normals.push_back(normals_[v]);
+          }
+          if (has_colors) {
+            output_colors.push_back(colors_[v]);
+          }
+        }
+        indices_.push_back(vertex_remap[v]);
+      }
+    }
+    normals_ = std::move(output_normals);
+    colors_ = std::move(output_colors);
+  }
+
+  // Input and output
+  std::vector<Vector3f>& vertices_;
+  std::vector<Vector3f>& normals_;
+  std::vector<Color>& colors_;
+  std::vector<int>& indices_;
+
+  // The welded mesh
+  std::vector<Vector3f> positions_;
+  std::vector<std::array<int, 3>> triangles_;
+
+  // Simplification state
+  int num_triangles_ = 0;
+  std::vector<bool> triangle_removed_;
+  std::vector<bool> vertex_removed_;
+  std::vector<bool> vertex_locked_;
+  std::vector<int> vertex_versions_;
+  std::vector<std::vector<int>> vertex_triangles_;
+  std::vector<Quadric> quadrics_;
+  std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>,
+                      std::greater<EdgeCollapse>>
+      collapse_queue_;
+};
+
+}  // namespace
+
+void MeshSimplifier::simplifyBlock(const MeshBlock& input,
+                                   MeshBlock* output) const {
+  CHECK_NOTNULL(output);
+  std::vector<Vector3f> vertices = input.vertices.toVector();
+  std::vector<Vector3f> normals = input.normals.toVector();
+  std::vector<Color> colors = input.colors.toVector();
+  std::vector<int> triangles = input.triangles.toVector();
+
+  HostMeshSimplification simplification(&vertices, &normals, &colors,
+                                        &triangles);
+  simplification.simplify(max_error_m_, target_triangle_ratio_,
+                          min_normal_cosine_);
+
+  output->vertices.copyFrom(vertices);
+  output->normals.copyFrom(normals);
+  output->colors.copyFrom(colors);
+  output->triangles.copyFrom(triangles);
+}
+
+void MeshSimplifier::simplifyBlocks(const MeshLayer& input,
+                                    const std::vector<Index3D>& block_indices,
+                                    MeshLayer* output) const {
+  CHECK_NOTNULL(output);
+  CHECK_EQ(input.block_size(), output->block_size());
+  for (const Index3D& block_idx : block_indices) {
+    const MeshBlock::ConstPtr input_block = input.getBlockAtIndex(block_idx);
+    if (!input_block || input_block->triangles.size() == 0) {
+      output->clearBlock(block_idx);
+      continue;
+    }
+    simplifyBlock(*input_block,
+                  output->allocateBlockAtIndex(block_idx).get());
+  }
+}
+
+float MeshSimplifier::max_error_m() const { return max_error_m_; }
+
+float MeshSimplifier::target_triangle_ratio() const {
+  return target_triangle_ratio_;
+}
+
+float MeshSimplifier::min_normal_cosine() const { return min_normal_cosine_; }
+
+void MeshSimplifier::max_error_m(float max_error_m) {
+  CHECK_GE(max_error_m, 0.0f);
+  max_error_m_ = max_error_m;
+}
+
+void MeshSimplifier::target_triangle_ratio(float target_triangle_ratio) {
+  CHECK_GE(target_triangle_ratio, 0.0f);
+  CHECK_LE(target_triangle_ratio, 1.0f);
+  target_triangle_ratio_ = target_triangle_ratio;
+}
+
+void MeshSimplifier::min_normal_cosine(float min_normal_cosine) {
+  CHECK_GE(min_normal_cosine, -1.0f);
+  CHECK_LE(min_normal_cosine, 1.0f);
+  min_normal_cosine_ = min_normal_cosine;
+}
+
+parameters::ParameterTreeNode MeshSimplifier::getParameterTree(
+    const std::string& name_remap) const {
+  using parameters::ParameterTreeNode;
+  const std::string name =
+      (name_remap.empty()) ? "mesh_simplifier" : name_remap;
+  return ParameterTreeNode(
+      name, {ParameterTreeNode("max_error_m:", max_error_m_),
+             ParameterTreeNode("target_triangle_ratio:", target_triangle_ratio_),
+             ParameterTreeNode("min_normal_cosine:", min_normal_cosine_)});
+}
+
+}  // namespace nvblox
@@ -15,17 +15,24 @@ limitations under the License.
 */
 #include "nvblox/mesh/mesh_streamer.h"
 
-#include <numeric>
+#include <utility>
 
 namespace nvblox {
 
-int MeshStreamerBase::numCandidates() const { return mesh_index_set_.size(); }
+int MeshStreamerBase::numCandidates() const {
+  return mesh_block_queue_.size();
+}
 
-void MeshStreamerBase::clear() { return mesh_index_set_.clear(); }
+void MeshStreamerBase::clear() { return mesh_block_queue_.clear(); }
 
 void MeshStreamerBase::markIndicesCandidates(
     const std::vector<Index3D>& mesh_block_indices) {
-  mesh_index_set_.insert(mesh_block_indices.begin(), mesh_block_indices.end());
+  // Priorities are computed once, when blocks become candidates.
+  const std::vector<float> priorities = computePriorities(mesh_block_indices);
+  CHECK_EQ(priorities.size(), mesh_block_indices.size());
+  for (size_t i = 0; i < mesh_block_indices.size(); i++) {
+    mesh_block_queue_.push(mesh_block_indices[i], priorities[i]);
+  }
 }
 
 void MeshStreamerBase::setExclusionFunctors(
@@ -91,102 +98,86 @@ MeshStreamerBase::getNBytesOfSerializedMeshBlocks(
 
 std::vector<Index3D> MeshStreamerBase::getHighestPriorityMeshBlocks(
     StreamStatusFunctor get_stream_status) {
-  // Convert the set of indices to a vector for index-based random access
-  std::vector<Index3D> mesh_index_vec;
-  std::copy(mesh_index_set_.begin(), mesh_index_set_.end(),
-            std::back_inserter(mesh_index_vec));
-
-  // Clear the set. We'll repopulate it with the un-streamed vertices later
-  mesh_index_set_.clear();
-
-  // Before we compute any priorities we can exclude blocks
-  excludeBlocks(&mesh_index_vec);
-
-  // Compute the priority of each mesh block
-  const std::vector<float> priorities = computePriorities(mesh_index_vec);
-
-  // Sort the priorities
-  std::vector<int> indices(priorities.size());
-  std::iota(indices.begin(), indices.end(), 0);
-
-  // Sort high to low
-  std::sort(indices.begin(), indices.end(),
-            [&](const int a, const int b) -> bool {
-              return priorities[a] > priorities[b];
-            });
-
-  // Split the mesh_index_vec into highest priority for streaming and the lower
-  // priority to store in the class for next time.
+  // Pop blocks in priority order until the streaming limit is reached. Only
+  // the blocks visited are touched, so the cost is O(k log n) for k returned
+  // blocks out of n candidates.
   std::vector<Index3D> high_priority_blocks;
-  int insert_remaining_start_idx = -1;
-  for (int i = 0; i < static_cast<int>(mesh_index_vec.size()); i++) {
-    // Get the index of the i'th high priority block.
-    const int sorted_index = indices[i];
-    const Index3D& mesh_block_index = mesh_index_vec[sorted_index];
+  // Blocks which were visited but stay candidates, with their priorities.
+  std::vector<std::pair<Index3D, float>> skipped_blocks;
+  while (!mesh_block_queue_.empty()) {
+    const Index3D mesh_block_index = mesh_block_queue_.top();
+    // Excluded blocks are no longer tracked.
+    if (isBlockExcluded(mesh_block_index)) {
+      mesh_block_queue_.pop();
+      continue;
+    }
     // Call out to the functor to see what we should do with this block.
     const StreamStatus stream_status = get_stream_status(mesh_block_index);
+    // Streaming limit reached, stop testing. The block stays in the queue.
+    if (stream_status.streaming_limit_reached &&
+        !stream_status.should_block_be_streamed) {
+      break;
+    }
+    const float priority = mesh_block_queue_.topPriority();
+    mesh_block_queue_.pop();
     // Stream
     if (stream_status.should_block_be_streamed) {
       high_priority_blocks.push_back(mesh_block_index);
     }
     // Stay - block should not be streamed but *is* valid.
     else if (!stream_status.block_index_invalid) {
-      mesh_index_set_.insert(mesh_block_index);
+      skipped_blocks.emplace_back(mesh_block_index, priority);
     }
-    // Streaming limit reached, stop testing
     if (stream_status.streaming_limit_reached) {
-      insert_remaining_start_idx = i + 1;
       break;
     }
   }
-  // If we terminated early, add the untested blocks back into the tracking set.
-  if (insert_remaining_start_idx > 0) {
-    for (size_t i = insert_remaining_start_idx; i < indices.size(); i++) {
-      const int sorted_index = indices[i];
-      const Index3D mesh_block_index = mesh_index_vec[sorted_index];
-      mesh_index_set_.insert(mesh_block_index);
-    }
+  // Put the skipped blocks back.
+  for (const auto& [mesh_block_index, priority] : skipped_blocks) {
+    mesh_block_queue_.push(mesh_block_index, priority);
   }
-  // Sanity check that the set isn't getting too big.
+  // Sanity check that the queue isn't getting too big.
   // NOTE(alexmillane): This number is approximately 50m*50m*10m at 0.05m
   // voxels. At this point you really should be using radius-based exclusion (in
   // the child class MeshStreamerOldestBlocks).
   constexpr size_t kNumBlocksWarningThreshold = 500000ul;
-  if (mesh_index_set_.size() > kNumBlocksWarningThreshold) {
+  if (mesh_block_queue_.size() > kNumBlocksWarningThreshold) {
     LOG(WARNING) << "The number of tracked mesh blocks for streaming is "
                     "getting very large: "
-                 << mesh_index_set_.size()
+                 << mesh_block_queue_.size()
                  << ". Consider adding some form of block exclusion.";
   }
   return high_priority_blocks;
 }
 
-void MeshStreamerBase::excludeBlocks(
-    std::vector<Index3D>* mesh_block_indices) const {
-  if (exclude_block_functors_.size() == 0) {
-    // The base implementation is to not exclude any blocks.
-    return;
+void MeshStreamerBase::recomputeCandidatePriorities() {
+  const std::vector<Index3D> mesh_block_indices =
+      mesh_block_queue_.getBlockIndices();
+  const std::vector<float> priorities = computePriorities(mesh_block_indices);
+  for (size_t i = 0; i < mesh_block_indices.size(); i++) {
+    mesh_block_queue_.push(mesh_block_indices[i], priorities[i]);
   }
-  // Exclude blocks not meeting the exclusion functions
-  std::vector<Index3D> mesh_index_vec_not_excluded;
-  mesh_index_vec_not_excluded.reserve(mesh_block_indices->size());
-  for (const Index3D& block_idx : *mesh_block_indices) {
-    bool exclude = false;
-    for (const ExcludeBlockFunctor& exclude_block_functor :
-         exclude_block_functors_) {
-      if (exclude_block_functor(block_idx)) {
-        // Exclusion function fired, move to the next block.
-        exclude = true;
-        break;
-      };
+}
+
+bool MeshStreamerBase::isBlockExcluded(const Index3D& mesh_block_index) const {
+  for (const ExcludeBlockFunctor& exclude_block_functor :
+       exclude_block_functors_) {
+    if (exclude_block_functor(mesh_block_index)) {
+      return true;
     }
-    // If none of the exclusion functions fire, we add this block
-    if (!exclude) {
-      mesh_index_vec_not_excluded.push_back(block_idx);
+  }
+  return false;
+}
+
+void MeshStreamerBase::removeExcludedCandidates() {
+  if (exclude_block_functors_.empty()) {
+    return;
+  }
+  for (const Index3D& mesh_block_index : mesh_block_queue_.getBlockIndices()) {
+    if (isBlockExcluded(mesh_block_index)) {
+      mesh_block_queue_.erase(mesh_block_index);
     }
   }
-  // Rewrite the block indices
-  *mesh_block_indices = std::move(mesh_index_vec_not_excluded);
 }
 
 float MeshStreamerOldestBlocks::exclusion_height_m() const {
@@ -300,6 +291,35 @@ void MeshStreamerOldestBlocks::setupExclusionFunctors(
     }
   }
   setExclusionFunctors(exclusion_functors);
+
+  // Prune the candidates if the excluded region changed. Otherwise blocks
+  // leaving the region are only dropped once they reach the top of the queue.
+  // A moving center is only considered changed once it moved by a block, to
+  // bound the cost of pruning.
+  const ExclusionSettings settings{.exclusion_height_m = exclusion_height_m_,
+                                   .exclusion_radius_m = exclusion_radius_m_,
+                                   .block_size = block_size,
+                                   .exclusion_center_m = exclusion_center_m};
+  bool settings_changed = true;
+  if (last_pruned_exclusion_settings_) {
+    const ExclusionSettings& last = *last_pruned_exclusion_settings_;
+    settings_changed =
+        settings.exclusion_height_m != last.exclusion_height_m ||
+        settings.exclusion_radius_m != last.exclusion_radius_m ||
+        settings.block_size != last.block_size ||
+        settings.exclusion_center_m.has_value() !=
+            last.exclusion_center_m.has_value();
+    if (!settings_changed && settings.exclusion_center_m.has_value() &&
+        settings.block_size.has_value()) {
+      settings_changed = (*settings.exclusion_center_m -
+                          *last.exclusion_center_m)
+                             .norm() > *settings.block_size;
+    }
+  }
+  if (settings_changed) {
+    removeExcludedCandidates();
+    last_pruned_exclusion_settings_ = settings;
+  }
 }
 
 MeshStreamerOldestBlocks::ExcludeBlockFunctor
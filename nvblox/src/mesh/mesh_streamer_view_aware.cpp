@@ -0,0 +1,529 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/mesh/mesh_streamer_view_aware.h"
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/geometry/bounding_boxes.h"
+
+namespace nvblox {
+
+// Blocks closer than this to the camera are not tested against the frustum.
+constexpr float kFrustumMinDepthM = 0.1f;
+
+MeshStreamerViewAware::MeshStreamerViewAware(float block_size)
+    : block_size_(block_size) {
+  CHECK_GT(block_size_, 0.0f);
+}
+
+void MeshStreamerViewAware::markIndicesCandidates(
+    const std::vector<Index3D>& mesh_block_indices) {
+  // Re-meshed blocks are streamed at any level of detail again.
+  for (const Index3D& block_idx : mesh_block_indices) {
+    coarse_streamed_lods_.erase(block_idx);
+  }
+  MeshStreamerBase::markIndicesCandidates(mesh_block_indices);
+}
+
+void MeshStreamerViewAware::removeBlocks(
+    const std::vector<Index3D>& mesh_block_indices) {
+  for (const Index3D& block_idx : mesh_block_indices) {
+    mesh_block_queue_.erase(block_idx);
+    coarse_streamed_lods_.erase(block_idx);
+    last_published_map_.erase(block_idx);
+  }
+}
+
+void MeshStreamerViewAware::setViewers(
+    const std::vector<MeshStreamingViewer>& viewers) {
+  if (!viewersMovedSignificantly(viewers)) {
+    return;
+  }
+  viewers_ = viewers;
+  viewer_frustums_.clear();
+  for (const MeshStreamingViewer& viewer : viewers_) {
+    if (viewer.camera.has_value()) {
+      viewer_frustums_.push_back(viewer.camera->getViewFrustum(
+          viewer.T_L_C, kFrustumMinDepthM, viewer.max_view_distance_m));
+    }
+  }
+  recomputeCandidatePriorities();
+  ++num_reprioritizations_;
+}
+
+bool MeshStreamerViewAware::viewersMovedSignificantly(
+    const std::vector<MeshStreamingViewer>& viewers) const {
+  if (viewers.size() != viewers_.size()) {
+    return true;
+  }
+  for (size_t i = 0; i < viewers.size(); i++) {
+    const MeshStreamingViewer& viewer = viewers[i];
+    const MeshStreamingViewer& last_viewer = viewers_[i];
+    if (viewer.camera.has_value() != last_viewer.camera.has_value() ||
+        viewer.max_view_distance_m != last_viewer.max_view_distance_m) {
+      return true;
+    }
+    const float distance_m =
+        (viewer.T_L_C.translation() - last_viewer.T_L_C.translation()).norm();
+    if (distance_m > reprioritization_distance_m_) {
+      return true;
+    }
+    // The angle of the rotation between the two poses.
+    const Eigen::AngleAxisf rotation(viewer.T_L_C.rotation().transpose() *
+                                     last_viewer.T_L_C.rotation());
+    if (viewer.camera.has_value() &&
+        std::abs(rotation.angle()) > reprioritization_angle_rad_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<Index3D> MeshStreamerViewAware::getNMeshBlocks(
+    const int num_mesh_blocks) {
+  const std::vector<Index3D> mesh_block_indices =
+      MeshStreamerBase::getNMeshBlocks(num_mesh_blocks);
+  updateBlocksLastPublishIndex(mesh_block_indices);
+  return mesh_block_indices;
+}
+
+std::vector<Index3D> MeshStreamerViewAware::getNBytesOfMeshBlocks(
+    const size_t num_bytes, const MeshLayer& mesh_layer) {
+  CHECK_EQ(mesh_layer.block_size(), block_size_);
+  const std::vector<Index3D> mesh_block_indices =
+      MeshStreamerBase::getNBytesOfMeshBlocks(num_bytes, mesh_layer);
+  updateBlocksLastPublishIndex(mesh_block_indices);
+  return mesh_block_indices;
+}
+
+const std::shared_ptr<const SerializedMesh>
+MeshStreamerViewAware::getNBytesOfSerializedMeshBlocks(
+    const size_t num_bytes, const MeshLayer& mesh_layer,
+    const CudaStream cuda_stream) {
+  return serializer_.serializeMesh(
+      mesh_layer, getNBytesOfMeshBlocks(num_bytes, mesh_layer), cuda_stream);
+}
+
+std::vector<Index3D> MeshStreamerViewAware::getNBytesOfMeshBlocks(
+    const size_t num_bytes, const MeshLayer& mesh_layer,
+    const MeshLodLayers& lods, std::vector<int>* block_lods) {
+  CHECK_EQ(mesh_layer.block_size(), block_size_);
+  CHECK_NOTNULL(block_lods);
+  block_lods->clear();
+  // The level each streamed block should have been streamed at.
+  std::vector<int> wanted_lods;
+  size_t num_bytes_streamed = 0;
+  StreamStatusFunctor stream_lods_functor =
+      [&](const Index3D& idx) -> StreamStatus {
+    // If the mesh block has been deallocated, don't stream and indicate invalid
+    if (!mesh_layer.getBlockAtIndex(idx)) {
+      coarse_streamed_lods_.erase(idx);
+      return {.should_block_be_streamed = false,
+              .block_index_invalid = true,
+              .streaming_limit_reached = false};
+    }
+    // Without viewers, blocks are wanted at full resolution.
+    const int wanted_lod =
+        viewers_.empty()
+            ? 0
+            : lods.selectLodForDistance(distanceToClosestViewer(
+                  getCenterPositionFromBlockIndex(block_size_, idx)));
+    // Blocks which were already streamed are only sent again at a finer level.
+    int coarsest_lod = lods.num_lods() - 1;
+    const auto it = coarse_streamed_lods_.find(idx);
+    const bool is_refinement = it != coarse_streamed_lods_.end();
+    if (is_refinement) {
+      coarsest_lod = it->second - 1;
+      if (coarsest_lod < wanted_lod) {
+        // The viewers moved away, the streamed level is good enough.
+        coarse_streamed_lods_.erase(it);
+        return {.should_block_be_streamed = false,
+                .block_index_invalid = true,
+                .streaming_limit_reached = false};
+      }
+    }
+    // The finest level which fits the remaining budget.
+    for (int lod = wanted_lod; lod <= coarsest_lod; lod++) {
+      const size_t block_num_bytes =
+          lods.getBlockAtLod(mesh_layer, idx, lod)->sizeInBytes();
+      if (num_bytes_streamed + block_num_bytes < num_bytes) {
+        num_bytes_streamed += block_num_bytes;
+        block_lods->push_back(lod);
+        wanted_lods.push_back(wanted_lod);
+        return {.should_block_be_streamed = true,
+                .block_index_invalid = false,
+                .streaming_limit_reached = false};
+      }
+    }
+    // A refinement which doesn't fit waits for a later call. Otherwise we're
+    // out of budget.
+    return {.should_block_be_streamed = false,
+            .block_index_invalid = false,
+            .streaming_limit_reached = !is_refinement};
+  };
+  const std::vector<Index3D> mesh_block_indices =
+      getHighestPriorityMeshBlocks(stream_lods_functor);
+  updateBlocksLastPublishIndex(mesh_block_indices);
+
+  // Blocks streamed coarser than wanted stay candidates for refinement.
+  std::vector<Index3D> refinement_indices;
+  for (size_t i = 0; i < mesh_block_indices.size(); i++) {
+    if ((*block_lods)[i] > wanted_lods[i]) {
+      coarse_streamed_lods_[mesh_block_indices[i]] = (*block_lods)[i];
+      refinement_indices.push_back(mesh_block_indices[i]);
+    } else {
+      coarse_streamed_lods_.erase(mesh_block_indices[i]);
+    }
+  }
+  MeshStreamerBase::markIndicesCandidates(refinement_indices);
+  return mesh_block_indices;
+}
+
+const std::shared_ptr<const SerializedMesh>
+MeshStreamerViewAware::getNBytesOfSerializedMeshBlocks(
+    const size_t num_bytes, const MeshLayer& mesh_layer,
+    const MeshLodLayers& lods, const CudaStream cuda_stream) {
+  std::vector<int> block_lods;
+  const std::vector<Index3D> mesh_block_indices =
+      getNBytesOfMeshBlocks(num_bytes, mesh_layer, lods, &block_lods);
+  if (!mixed_lod_layer_) {
+    mixed_lod_layer_ =
+        std::make_unique<MeshLayer>(block_size_, mesh_layer.memory_type());
+  }
+  lods.assembleMixedLodLayer(mesh_layer, mesh_block_indices, block_lods,
+                             mixed_lod_layer_.get());
+  return serializer_.serializeMesh(*mixed_lod_layer_, mesh_block_indices,
+                                   cuda_stream);
+}
+
+std::vector<float> MeshStreamerViewAware::computePriorities(
+    const std::vector<Index3D>& mesh_block_indices) const {
+  std::vector<float> priorities;
+  priorities.reserve(mesh_block_indices.size());
+  for (const Index3D& mesh_block_index : mesh_block_indices) {
+    priorities.push_back(computePriority(mesh_block_index));
+  }
+  return priorities;
+}
+
+float MeshStreamerViewAware::computePriority(
+    const Index3D& mesh_block_index) const {
+  // Staleness. The number of calls since the block was last streamed is
+  // (publishing_index_ - last_published_index). The first term is common to
+  // all blocks, so we drop it, such that the priority of a candidate doesn't
+  // change between calls.
+  const auto it = last_published_map_.find(mesh_block_index);
+  const int64_t last_published_index =
+      (it == last_published_map_.end()) ? -1 : it->second;
+  float priority =
+      -staleness_weight_ * static_cast<float>(last_published_index);
+
+  if (viewers_.empty()) {
+    return priority;
+  }
+
+  // Distance to the closest viewer
+  priority -= distance_weight_ *
+              distanceToClosestViewer(getCenterPositionFromBlockIndex(
+                  block_size_, mesh_block_index));
+
+  // In view of any viewer
+  if (!viewer_frustums_.empty()) {
+    const AxisAlignedBoundingBox aabb =
+        getAABBOfBlock(block_size_, mesh_block_index);
+    for (const Frustum& frustum : viewer_frustums_) {
+      if (frustum.isAABBInView(aabb)) {
+        priority += in_view_priority_;
+        break;
+      }
+    }
+  }
+  return priority;
+}
+
+float MeshStreamerViewAware::distanceToClosestViewer(
+    const Vector3f& position) const {
+  float min_distance_m = std::numeric_limits<float>::infinity();
+  for (const MeshStreamingViewer& viewer : viewers_) {
+    min_distance_m =
+        std::min(min_distance_m, (position - viewer.T_L_C.translation()).norm());
+  }
+  return min_distance_m;
+}
+
+void MeshStreamerViewAware::updateBlocksLastPublishIndex(
+    const std::vector<Index3D>& mesh_block_indices) {
+  for (const Index3D& block_idx : mesh_block_indices) {
+    last_published_map_[block_idx] = publishing_index_;
+  }
+  ++publishing_index_;
+  CHECK_LT(publishing_index_, std::numeric_limits<int64_t>::max());
+}
+
+float MeshStreamerViewAware::distance_weight() const {
+  return distance_weight_;
+}
+
+float MeshStreamerViewAware::in_view_priority() const {
+  return in_view_priority_;
+}
+
+float MeshStreamerViewAware::staleness_weight() const {
+  return staleness_weight_;
+}
+
+float MeshStreamerViewAware::reprioritization_distance_m() const {
+  return reprioritization_distance_m_;
+}
+
+float MeshStreamerViewAware::reprioritization_angle_rad() const {
+  return reprioritization_angle_rad_;
+}
+
+void MeshStreamerViewAware::distance_weight(float distance_weight) {
+  distance_weight_ = distance_weight;
+  recomputeCandidatePriorities();
+}
+
+void MeshStreamerViewAware::in_view_priority(float in_view_priority) {
+  in_view_priority_ = in_view_priority;
+  recomputeCandidatePriorities();
+}
+
+void MeshStreamerViewAware::staleness_weight(float staleness_weight) {
+  staleness_weight_ = staleness_weight;
+  recomputeCandidatePriorities();
+}
+
+void MeshStreamerViewAware::reprioritization_distance_m(
+    float reprioritization_distance_m) {
+  reprioritization_distance_m_ = reprioritization_distance_m;
+}
+
+void MeshStreamerViewAware::reprioritization_angle_rad(
+    float reprioritization_angle_rad) {
+  reprioritization_angle_rad_ = reprioritization_angle_rad;
+}
+
+parameters::ParameterTreeNode MeshStreamerViewAware::getParameterTree(
+    const std::string& name_remap) const {
+  using parameters::ParameterTreeNode;
+  const std::string name =
+      (name_remap.empty()) ? "mesh_streamer_view_aware" : name_remap;
+  return ParameterTreeNode(
+      name,
+      {ParameterTreeNode("distance_weight:", distance_weight_),
+       ParameterTreeNode("in_view_priority:", in_view_priority_),
+       ParameterTreeNode("staleness_weight:", staleness_weight_),
+       ParameterTreeNode("reprioritization_distance_m:",
+                         reprioritization_distance_m_),
+       ParameterTreeNode("reprioritization_angle_rad:",
+                         reprioritization_angle_rad_)});
+}
+
+MultiClientMeshStreamer::MultiClientMeshStreamer(float block_size)
+    : block_size_(block_size) {
+  CHECK_GT(block_size_, 0.0f);
+}
+
+void MultiClientMeshStreamer::addClient(const std::string& client_id,
+                                        size_t num_bytes_per_call) {
+  CHECK(!hasClient(client_id)) << "Client already exists: " << client_id;
+  Client& client = clients_[client_id];
+  client.streamer = std::make_unique<MeshStreamerViewAware>(block_size_);
+  client.serializer = std::make_unique<MeshSerializerGpu>();
+  client.num_bytes_per_call = num_bytes_per_call;
+  resetClient(client_id);
+}
+
+void MultiClientMeshStreamer::removeClient(const std::string& client_id) {
+  clients_.erase(client_id);
+}
+
+bool MultiClientMeshStreamer::hasClient(const std::string& client_id) const {
+  return clients_.count(client_id) > 0;
+}
+
+std::vector<std::string> MultiClientMeshStreamer::getClientIds() const {
+  std::vector<std::string> client_ids;
+  for (const auto& [client_id, client] : clients_) {
+    client_ids.push_back(client_id);
+  }
+  return client_ids;
+}
+
+void MultiClientMeshStreamer::setClientByteBudget(
+    const std::string& client_id, size_t num_bytes_per_call) {
+  getClient(client_id).num_bytes_per_call = num_bytes_per_call;
+}
+
+size_t MultiClientMeshStreamer::getClientByteBudget(
+    const std::string& client_id) const {
+  return getClient(client_id).num_bytes_per_call;
+}
+
+void MultiClientMeshStreamer::setClientViewers(
+    const std::string& client_id,
+    const std::vector<MeshStreamingViewer>& viewers) {
+  getClient(client_id).streamer->setViewers(viewers);
+}
+
+MeshStreamerViewAware& MultiClientMeshStreamer::clientStreamer(
+    const std::string& client_id) {
+  return *getClient(client_id).streamer;
+}
+
+const MeshStreamerViewAware& MultiClientMeshStreamer::clientStreamer(
+    const std::string& client_id) const {
+  return *getClient(client_id).streamer;
+}
+
+void MultiClientMeshStreamer::markIndicesCandidates(
+    const std::vector<Index3D>& mesh_block_indices) {
+  for (const Index3D& block_idx : mesh_block_indices) {
+    ++block_versions_[block_idx];
+  }
+  for (auto& [client_id, client] : clients_) {
+    // A re-allocated block replaces the deleted one on the client.
+    for (const Index3D& block_idx : mesh_block_indices) {
+      client.deleted_blocks.erase(block_idx);
+    }
+    client.streamer->markIndicesCandidates(mesh_block_indices);
+  }
+}
+
+void MultiClientMeshStreamer::removeBlocks(
+    const std::vector<Index3D>& mesh_block_indices) {
+  for (const Index3D& block_idx : mesh_block_indices) {
+    block_versions_.erase(block_idx);
+  }
+  for (auto& [client_id, client] : clients_) {
+    client.streamer->removeBlocks(mesh_block_indices);
+    for (const Index3D& block_idx : mesh_block_indices) {
+      // Only clients which were sent the block have to delete it.
+      if (client.sent_block_versions.erase(block_idx) > 0) {
+        client.deleted_blocks.insert(block_idx);
+      }
+    }
+  }
+}
+
+std::vector<Index3D> MultiClientMeshStreamer::getDeletedBlocksForClient(
+    const std::string& client_id) {
+  Client& client = getClient(client_id);
+  const std::vector<Index3D> deleted_blocks(client.deleted_blocks.begin(),
+                                            client.deleted_blocks.end());
+  client.deleted_blocks.clear();
+  return deleted_blocks;
+}
+
+std::vector<Index3D> MultiClientMeshStreamer::getMeshBlocksForClient(
+    const std::string& client_id, const MeshLayer& mesh_layer) {
+  Client& client = getClient(client_id);
+  const std::vector<Index3D> mesh_block_indices =
+      client.streamer->getNBytesOfMeshBlocks(client.num_bytes_per_call,
+                                             mesh_layer);
+  recordSentBlocks(mesh_block_indices, &client);
+  return mesh_block_indices;
+}
+
+std::shared_ptr<const SerializedMesh>
+MultiClientMeshStreamer::getSerializedMeshForClient(
+    const std::string& client_id, const MeshLayer& mesh_layer,
+    const CudaStream cuda_stream) {
+  const std::vector<Index3D> mesh_block_indices =
+      getMeshBlocksForClient(client_id, mesh_layer);
+  return getClient(client_id).serializer->serializeMesh(
+      mesh_layer, mesh_block_indices, cuda_stream);
+}
+
+std::shared_ptr<const SerializedMesh>
+MultiClientMeshStreamer::getSerializedMeshForClient(
+    const std::string& client_id, const MeshLayer& mesh_layer,
+    const MeshLodLayers& lods, const CudaStream cuda_stream) {
+  Client& client = getClient(client_id);
+  std::vector<int> block_lods;
+  const std::vector<Index3D> mesh_block_indices =
+      client.streamer->getNBytesOfMeshBlocks(client.num_bytes_per_call,
+                                             mesh_layer, lods, &block_lods);
+  recordSentBlocks(mesh_block_indices, &client);
+  if (!client.mixed_lod_layer) {
+    client.mixed_lod_layer =
+        std::make_unique<MeshLayer>(block_size_, mesh_layer.memory_type());
+  }
+  lods.assembleMixedLodLayer(mesh_layer, mesh_block_indices, block_lods,
+                             client.mixed_lod_layer.get());
+  return client.serializer->serializeMesh(*client.mixed_lod_layer,
+                                          mesh_block_indices, cuda_stream);
+}
+
+void MultiClientMeshStreamer::resetClient(const std::string& client_id) {
+  Client& client = getClient(client_id);
+  client.sent_block_versions.clear();
+  client.deleted_blocks.clear();
+  client.streamer->clear();
+  std::vector<Index3D> mesh_block_indices;
+  mesh_block_indices.reserve(block_versions_.size());
+  for (const auto& [block_idx, version] : block_versions_) {
+    mesh_block_indices.push_back(block_idx);
+  }
+  client.streamer->markIndicesCandidates(mesh_block_indices);
+}
+
+uint64_t MultiClientMeshStreamer::getBlockVersion(
+    const Index3D& mesh_block_index) const {
+  const auto it = block_versions_.find(mesh_block_index);
+  return (it == block_versions_.end()) ? 0 : it->second;
+}
+
+uint64_t MultiClientMeshStreamer::getSentBlockVersion(
+    const std::string& client_id, const Index3D& mesh_block_index) const {
+  const Client& client = getClient(client_id);
+  const auto it = client.sent_block_versions.find(mesh_block_index);
+  return (it == client.sent_block_versions.end()) ? 0 : it->second;
+}
+
+int MultiClientMeshStreamer::numCandidates(
+    const std::string& client_id) const {
+  return getClient(client_id).streamer->numCandidates();
+}
+
+void MultiClientMeshStreamer::clear() {
+  clients_.clear();
+  block_versions_.clear();
+}
+
+MultiClientMeshStreamer::Client& MultiClientMeshStreamer::getClient(
+    const std::string& client_id) {
+  auto it = clients_.find(client_id);
+  CHECK(it != clients_.end()) << "Unknown client: " << client_id;
+  return it->second;
+}
+
+void MultiClientMeshStreamer::recordSentBlocks(
+    const std::vector<Index3D>& mesh_block_indices, Client* client) const {
+  for (const Index3D& block_idx : mesh_block_indices) {
+    client->sent_block_versions[block_idx] = getBlockVersion(block_idx);
+  }
+}
+
+const MultiClientMeshStreamer::Client& MultiClientMeshStreamer::getClient(
+    const std::string& client_id) const {
+  const auto it = clients_.find(client_id);
+  CHECK(it != clients_.end()) << "Unknown client: " << client_id;
+  return it->second;
+}
+
+}  // namespace nvblox
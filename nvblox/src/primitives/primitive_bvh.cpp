@@ -0,0 +1,239 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/primitives/primitive_bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace nvblox {
+namespace primitives {
+namespace {
+
+// Deep enough for any tree built by median splits of less than 2^60
+// primitives.
+constexpr int kMaxStackSize = 64;
+
+// Slab test. Returns the distance along the ray at which it enters the box,
+// or infinity if it misses the box or enters it further than max_dist.
+float getRayEntryDistance(const AxisAlignedBoundingBox& aabb,
+                          const Vector3f& ray_origin,
+                          const Vector3f& inverse_ray_direction,
+                          float max_dist) {
+  const Vector3f t_1 =
+      (aabb.min() - ray_origin).cwiseProduct(inverse_ray_direction);
+  const Vector3f t_2 =
+      (aabb.max() - ray_origin).cwiseProduct(inverse_ray_direction);
+  const float t_enter = std::max(t_1.cwiseMin(t_2).maxCoeff(), 0.0f);
+  const float t_exit = t_1.cwiseMax(t_2).minCoeff();
+  if (t_exit < t_enter || t_enter > max_dist) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return t_enter;
+}
+
+}  // namespace
+
+PrimitiveBvh::PrimitiveBvh(
+    const std::vector<std::unique_ptr<Primitive>>& primitives) {
+  std::vector<BuildPrimitive> build_primitives;
+  for (const std::unique_ptr<Primitive>& primitive : primitives) {
+    AxisAlignedBoundingBox aabb;
+    if (primitive->getAABB(&aabb)) {
+      build_primitives.push_back({aabb, aabb.center(), primitive.get()});
+    } else {
+      unbounded_primitives_.push_back(primitive.get());
+    }
+  }
+  if (build_primitives.empty()) {
+    return;
+  }
+  // A binary tree with at least one primitive per leaf.
+  nodes_.reserve(2 * build_primitives.size());
+  bounded_primitives_.reserve(build_primitives.size());
+  buildNode(0, static_cast<int>(build_primitives.size()), &build_primitives);
+}
+
+int PrimitiveBvh::buildNode(int begin, int end,
+                            std::vector<BuildPrimitive>* build_primitives) {
+  const int node_idx = static_cast<int>(nodes_.size());
+  nodes_.emplace_back();
+  AxisAlignedBoundingBox aabb;
+  AxisAlignedBoundingBox centroid_aabb;
+  for (int i = begin; i < end; i++) {
+    aabb.extend((*build_primitives)[i].aabb);
+    centroid_aabb.extend((*build_primitives)[i].centroid);
+  }
+  nodes_[node_idx].aabb = aabb;
+
+  if (end - begin <= kMaxPrimitivesPerLeaf) {
+    nodes_[node_idx].first = static_cast<int>(bounded_primitives_.size());
+    nodes_[node_idx].count = end - begin;
+    for (int i = begin; i < end; i++) {
+      bounded_primitives_.push_back((*build_primitives)[i].primitive);
+    }
+    return node_idx;
+  }
+
+  // Split at the median along the axis along which the centroids spread most.
+  int axis;
+  centroid_aabb.sizes().maxCoeff(&axis);
+  const int middle = begin + (end - begin) / 2;
+  std::nth_element(build_primitives->begin() + begin,
+                   build_primitives->begin() + middle,
+                   build_primitives->begin() + end,
+                   [axis](const BuildPrimitive& a, const BuildPrimitive& b) {
+                     return a.centroid[axis] < b.centroid[axis];
+                   });
+  // The left child directly follows this node.
+  buildNode(begin, middle, build_primitives);
+  const int right_idx = buildNode(middle, end, build_primitives);
+  nodes_[node_idx].first = right_idx;
+  return node_idx;
+}
+
+bool PrimitiveBvh::getRayIntersection(const Vector3f& ray_origin,
+                                      const Vector3f& ray_direction,
+                                      float max_dist,
+                                      Vector3f* ray_intersection,
+                                      float* ray_dist) const {
+  CHECK_NOTNULL(ray_intersection);
+  CHECK_NOTNULL(ray_dist);
+  *ray_intersection = Vector3f::Zero();
+  *ray_dist = max_dist;
+  bool ray_valid = false;
+
+  auto test_primitive = [&](const Primitive* primitive) {
+    Vector3f primitive_intersection;
+    float primitive_dist;
+    // Only intersections closer than the closest so far can change the
+    // result.
+    const float test_dist = ray_valid ? *ray_dist : max_dist;
+    if (primitive->getRayIntersection(ray_origin, ray_direction, test_dist,
+                                      &primitive_intersection,
+                                      &primitive_dist)) {
+      if (!ray_valid || primitive_dist < *ray_dist) {
+        ray_valid = true;
+        *ray_dist = primitive_dist;
+        *ray_intersection = primitive_intersection;
+      }
+    }
+  };
+
+  for (const Primitive* primitive : unbounded_primitives_) {
+    test_primitive(primitive);
+  }
+  if (nodes_.empty()) {
+    return ray_valid;
+  }
+
+  // Front-to-back traversal, skipping boxes entered beyond the closest hit.
+  const Vector3f inverse_ray_direction = ray_direction.cwiseInverse();
+  std::pair<int, float> stack[kMaxStackSize];
+  int stack_size = 0;
+  const float root_entry = getRayEntryDistance(
+      nodes_[0].aabb, ray_origin, inverse_ray_direction, *ray_dist);
+  if (root_entry <= *ray_dist) {
+    stack[stack_size++] = {0, root_entry};
+  }
+  while (stack_size > 0) {
+    const auto [node_idx, entry_dist] = stack[--stack_size];
+    if (entry_dist > *ray_dist) {
+      continue;
+    }
+    const Node& node = nodes_[node_idx];
+    if (node.count > 0) {
+      for (int i = node.first; i < node.first + node.count; i++) {
+        test_primitive(bounded_primitives_[i]);
+      }
+      continue;
+    }
+    const int left_idx = node_idx + 1;
+    const int right_idx = node.first;
+    const float left_entry = getRayEntryDistance(
+        nodes_[left_idx].aabb, ray_origin, inverse_ray_direction, *ray_dist);
+    const float right_entry = getRayEntryDistance(
+        nodes_[right_idx].aabb, ray_origin, inverse_ray_direction, *ray_dist);
+    // Push the far child first, such that the near one is visited first.
+    std::pair<int, float> near{left_idx, left_entry};
+    std::pair<int, float> far{right_idx, right_entry};
+    if (far.second < near.second) {
+      std::swap(near, far);
+    }
+    CHECK_LE(stack_size + 2, kMaxStackSize);
+    if (far.second <= *ray_dist) {
+      stack[stack_size++] = far;
+    }
+    if (near.second <= *ray_dist) {
+      stack[stack_size++] = near;
+    }
+  }
+  return ray_valid;
+}
+
+float PrimitiveBvh::getSignedDistanceToPoint(const Vector3f& coords,
+                                             float max_dist) const {
+  float min_dist = max_dist;
+  auto test_primitive = [&](const Primitive* primitive) {
+    const float primitive_dist = primitive->getDistanceToPoint(coords);
+    if (primitive_dist < min_dist) {
+      min_dist = primitive_dist;
+    }
+  };
+
+  for (const Primitive* primitive : unbounded_primitives_) {
+    test_primitive(primitive);
+  }
+  if (nodes_.empty()) {
+    return min_dist;
+  }
+
+  // A primitive is never closer than its bounding box, so boxes further than
+  // the closest primitive so far are skipped. Once the point is inside a
+  // primitive, only boxes containing the point can hold a smaller (more
+  // negative) distance.
+  std::pair<int, float> stack[kMaxStackSize];
+  int stack_size = 0;
+  stack[stack_size++] = {0, nodes_[0].aabb.exteriorDistance(coords)};
+  while (stack_size > 0) {
+    const auto [node_idx, box_dist] = stack[--stack_size];
+    if (box_dist > std::max(min_dist, 0.0f)) {
+      continue;
+    }
+    const Node& node = nodes_[node_idx];
+    if (node.count > 0) {
+      for (int i = node.first; i < node.first + node.count; i++) {
+        test_primitive(bounded_primitives_[i]);
+      }
+      continue;
+    }
+    const int left_idx = node_idx + 1;
+    const int right_idx = node.first;
+    std::pair<int, float> near{left_idx,
+                               nodes_[left_idx].aabb.exteriorDistance(coords)};
+    std::pair<int, float> far{right_idx,
+                              nodes_[right_idx].aabb.exteriorDistance(coords)};
+    if (far.second < near.second) {
+      std::swap(near, far);
+    }
+    CHECK_LE(stack_size + 2, kMaxStackSize);
+    stack[stack_size++] = far;
+    stack[stack_size++] = near;
+  }
+  return min_dist;
+}
+
+}  // namespace primitives
+}  // namespace nvblox
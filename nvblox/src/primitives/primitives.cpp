@@ -86,6 +86,13 @@ bool Sphere::getRayIntersection(const Vector3f& ray_origin,
   return true;
 }
 
+bool Sphere::getAABB(AxisAlignedBoundingBox* aabb) const {
+  CHECK_NOTNULL(aabb);
+  *aabb = AxisAlignedBoundingBox(center_ - Vector3f::Constant(radius_),
+                                 center_ + Vector3f::Constant(radius_));
+  return true;
+}
+
 float Cube::getDistanceToPoint(const Vector3f& point) const {
   // Solution from http://stackoverflow.com/questions/5254838/
   // calculating-distance-between-a-point-and-a-rectangular-box-nearest-point
@@ -169,6 +176,13 @@ bool Cube::getRayIntersection(const Vector3f& ray_origin,
   return true;
 }
 
+bool Cube::getAABB(AxisAlignedBoundingBox* aabb) const {
+  CHECK_NOTNULL(aabb);
+  *aabb =
+      AxisAlignedBoundingBox(center_ - size_ / 2.0f, center_ + size_ / 2.0f);
+  return true;
+}
+
 float Plane::getDistanceToPoint(const Vector3f& point) const {
   // Compute the 'd' in ax + by + cz + d = 0:
   // This is actually the scalar product I guess.
@@ -328,5 +342,12 @@ bool Cylinder::getRayIntersection(const Vector3f& ray_origin,
   return true;
 }
 
+bool Cylinder::getAABB(AxisAlignedBoundingBox* aabb) const {
+  CHECK_NOTNULL(aabb);
+  const Vector3f half_extent(radius_, radius_, height_ / 2.0f);
+  *aabb = AxisAlignedBoundingBox(center_ - half_extent, center_ + half_extent);
+  return true;
+}
+
 }  // namespace primitives
 }  // namespace nvblox
\ No newline at end of file
@@ -0,0 +1,357 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/primitives/scenario_generator.h"
+
+#include <cmath>
+#include <random>
+
+#include "nvblox/utils/logging.h"
+
+namespace nvblox {
+namespace primitives {
+namespace {
+
+// Draws uniformly distributed floats.
+class RandomFloat {
+ public:
+  explicit RandomFloat(uint32_t seed) : generator_(seed) {}
+  float operator()(float min, float max) {
+    return std::uniform_real_distribution<float>(min, max)(generator_);
+  }
+  bool chance(float probability) { return (*this)(0.0f, 1.0f) < probability; }
+
+ private:
+  std::mt19937 generator_;
+};
+
+// Warehouse dimensions.
+constexpr float kRackSegmentLength = 2.5f;
+constexpr int kRackSegmentsPerCell = 4;
+constexpr float kRackDepth = 1.2f;
+constexpr float kRackHeight = 5.5f;
+constexpr int kNumShelves = 4;
+constexpr float kShelfSpacing = 1.4f;
+constexpr float kAisleWidth = 3.0f;
+constexpr float kCrossAisleWidth = 4.0f;
+constexpr float kWarehouseHeight = 8.0f;
+constexpr float kForkliftSensorHeight = 1.0f;
+constexpr float kWarehouseRange = 10.0f;
+
+// City dimensions.
+constexpr float kCityBlockSize = 40.0f;
+constexpr float kStreetWidth = 12.0f;
+constexpr float kLotSize = kCityBlockSize / 2.0f;
+constexpr float kMaxBuildingHeight = 40.0f;
+constexpr float kLampSpacing = 15.0f;
+constexpr float kParkingSpacing = 6.0f;
+constexpr float kCarSensorHeight = 2.0f;
+constexpr float kCityRange = 30.0f;
+
+void addRackSegment(const Vector2f& min_corner, RandomFloat* random,
+                    Scene* scene) {
+  const Vector3f segment_size(kRackSegmentLength, kRackDepth, 0.05f);
+  // Uprights at the start of the segment, front and back.
+  for (const float y : {min_corner.y(), min_corner.y() + kRackDepth}) {
+    scene->addPrimitive(std::make_unique<Cube>(
+        Vector3f(min_corner.x(), y, kRackHeight / 2.0f),
+        Vector3f(0.1f, 0.1f, kRackHeight)));
+  }
+  for (int shelf = 0; shelf < kNumShelves; shelf++) {
+    const float shelf_z = 0.1f + shelf * kShelfSpacing;
+    scene->addPrimitive(std::make_unique<Cube>(
+        Vector3f(min_corner.x() + kRackSegmentLength / 2.0f,
+                 min_corner.y() + kRackDepth / 2.0f, shelf_z),
+        segment_size));
+    // Stock the shelf with up to three boxes, side by side.
+    const int num_boxes = static_cast<int>((*random)(0.0f, 4.0f));
+    const float box_slot_length = kRackSegmentLength / 3.0f;
+    for (int box = 0; box < num_boxes; box++) {
+      const Vector3f box_size((*random)(0.3f, box_slot_length - 0.1f),
+                              (*random)(0.4f, kRackDepth - 0.1f),
+                              (*random)(0.3f, kShelfSpacing - 0.3f));
+      scene->addPrimitive(std::make_unique<Cube>(
+          Vector3f(min_corner.x() + (box + 0.5f) * box_slot_length,
+                   min_corner.y() + kRackDepth / 2.0f,
+                   shelf_z + box_size.z() / 2.0f),
+          box_size, Color(static_cast<uint8_t>((*random)(100.0f, 255.0f)),
+                          static_cast<uint8_t>((*random)(60.0f, 180.0f)), 40)));
+    }
+  }
+}
+
+Scenario createWarehouse(const ScenarioParams& params) {
+  RandomFloat random(params.seed);
+  Scenario scenario;
+  scenario.max_range_m = kWarehouseRange;
+
+  // Rows of racks along x, with aisles in between. There is one aisle per
+  // cell along y and one more row of racks than aisles.
+  const float length_x =
+      params.num_cells_x * kRackSegmentsPerCell * kRackSegmentLength;
+  const float pitch_y = kRackDepth + kAisleWidth;
+  const int num_rack_rows = params.num_cells_y + 1;
+  for (int row = 0; row < num_rack_rows; row++) {
+    const float y = row * pitch_y - kRackDepth / 2.0f;
+    for (int segment = 0; segment < params.num_cells_x * kRackSegmentsPerCell;
+         segment++) {
+      addRackSegment(Vector2f(segment * kRackSegmentLength, y), &random,
+                     &scenario.scene);
+    }
+    // Closing uprights at the end of the row.
+    scenario.scene.addPrimitive(std::make_unique<Cylinder>(
+        Vector3f(length_x, row * pitch_y, kRackHeight / 2.0f), 0.15f,
+        kRackHeight));
+  }
+
+  // The building.
+  const float x_min = -kCrossAisleWidth;
+  const float x_max = length_x + kCrossAisleWidth;
+  const float y_min = -kRackDepth / 2.0f - kAisleWidth;
+  const float y_max = params.num_cells_y * pitch_y + kRackDepth / 2.0f +
+                      kAisleWidth;
+  scenario.scene.addGroundLevel(0.0f);
+  scenario.scene.addCeiling(kWarehouseHeight);
+  scenario.scene.addPlaneBoundaries(x_min, x_max, y_min, y_max);
+  scenario.scene.aabb() = AxisAlignedBoundingBox(
+      Vector3f(x_min, y_min, 0.0f), Vector3f(x_max, y_max, kWarehouseHeight));
+
+  // Snake through the aisles, turning in the cross aisles.
+  std::vector<Vector2f> waypoints;
+  const float x_turn_start = -kCrossAisleWidth / 2.0f;
+  const float x_turn_end = length_x + kCrossAisleWidth / 2.0f;
+  for (int aisle = 0; aisle < params.num_cells_y; aisle++) {
+    const float y = (aisle + 0.5f) * pitch_y;
+    if (aisle % 2 == 0) {
+      waypoints.emplace_back(x_turn_start, y);
+      waypoints.emplace_back(x_turn_end, y);
+    } else {
+      waypoints.emplace_back(x_turn_end, y);
+      waypoints.emplace_back(x_turn_start, y);
+    }
+  }
+  sampleTrajectory(waypoints, kForkliftSensorHeight, params, &scenario);
+  return scenario;
+}
+
+// Adds the furniture of a street segment between two intersections. The
+// segment runs along x if along_x, otherwise along y.
+void addStreetSegment(const Vector2f& start, bool along_x, RandomFloat* random,
+                      Scene* scene) {
+  const Vector2f direction = along_x ? Vector2f(1.0f, 0.0f)
+                                     : Vector2f(0.0f, 1.0f);
+  const Vector2f side = along_x ? Vector2f(0.0f, 1.0f) : Vector2f(1.0f, 0.0f);
+  for (const float sign : {-1.0f, 1.0f}) {
+    // Lamp posts on the sidewalk.
+    for (float s = kLampSpacing / 2.0f; s < kCityBlockSize; s += kLampSpacing) {
+      const Vector2f p =
+          start + s * direction + sign * (kStreetWidth / 2.0f - 1.0f) * side;
+      scene->addPrimitive(std::make_unique<Cylinder>(
+          Vector3f(p.x(), p.y(), 3.0f), 0.15f, 6.0f));
+    }
+    // Cars parked in the outer lane.
+    for (float s = kParkingSpacing / 2.0f; s < kCityBlockSize;
+         s += kParkingSpacing) {
+      if (!random->chance(0.4f)) {
+        continue;
+      }
+      const Vector2f p = start + s * direction +
+                         sign * (kStreetWidth / 2.0f - 2.5f) * side;
+      const Vector3f size = along_x ? Vector3f(4.5f, 1.8f, 1.5f)
+                                    : Vector3f(1.8f, 4.5f, 1.5f);
+      scene->addPrimitive(std::make_unique<Cube>(
+          Vector3f(p.x(), p.y(), size.z() / 2.0f), size,
+          Color(static_cast<uint8_t>((*random)(0.0f, 255.0f)),
+                static_cast<uint8_t>((*random)(0.0f, 255.0f)),
+                static_cast<uint8_t>((*random)(0.0f, 255.0f)))));
+    }
+  }
+}
+
+// Adds a building or a small park to a lot.
+void addLot(const Vector2f& min_corner, RandomFloat* random, Scene* scene) {
+  const Vector2f center = min_corner + Vector2f::Constant(kLotSize / 2.0f);
+  if (random->chance(0.2f)) {
+    // A park with a few trees.
+    const int num_trees = static_cast<int>((*random)(2.0f, 6.0f));
+    for (int i = 0; i < num_trees; i++) {
+      const Vector2f p(min_corner.x() + (*random)(3.0f, kLotSize - 3.0f),
+                       min_corner.y() + (*random)(3.0f, kLotSize - 3.0f));
+      const float trunk_height = (*random)(2.0f, 4.0f);
+      scene->addPrimitive(std::make_unique<Cylinder>(
+          Vector3f(p.x(), p.y(), trunk_height / 2.0f), 0.2f, trunk_height));
+      const float crown_radius = (*random)(1.5f, 2.5f);
+      scene->addPrimitive(std::make_unique<Sphere>(
+          Vector3f(p.x(), p.y(), trunk_height + crown_radius * 0.8f),
+          crown_radius, Color::Green()));
+    }
+    return;
+  }
+  // A building, possibly with a narrower tower on top.
+  const float footprint_x = (*random)(12.0f, kLotSize - 2.0f);
+  const float footprint_y = (*random)(12.0f, kLotSize - 2.0f);
+  const float height = (*random)(6.0f, kMaxBuildingHeight / 2.0f);
+  scene->addPrimitive(std::make_unique<Cube>(
+      Vector3f(center.x(), center.y(), height / 2.0f),
+      Vector3f(footprint_x, footprint_y, height)));
+  if (random->chance(0.3f)) {
+    const float tower_height = (*random)(5.0f, kMaxBuildingHeight - height);
+    scene->addPrimitive(std::make_unique<Cube>(
+        Vector3f(center.x(), center.y(), height + tower_height / 2.0f),
+        Vector3f(footprint_x / 2.0f, footprint_y / 2.0f, tower_height)));
+  }
+}
+
+Scenario createCityBlocks(const ScenarioParams& params) {
+  RandomFloat random(params.seed);
+  Scenario scenario;
+  scenario.max_range_m = kCityRange;
+
+  // Streets are centered at multiples of the pitch, with the blocks in
+  // between.
+  const float pitch = kCityBlockSize + kStreetWidth;
+  for (int cell_x = 0; cell_x < params.num_cells_x; cell_x++) {
+    for (int cell_y = 0; cell_y < params.num_cells_y; cell_y++) {
+      const Vector2f block_min(cell_x * pitch + kStreetWidth / 2.0f,
+                               cell_y * pitch + kStreetWidth / 2.0f);
+      for (int lot_x = 0; lot_x < 2; lot_x++) {
+        for (int lot_y = 0; lot_y < 2; lot_y++) {
+          addLot(block_min + kLotSize * Vector2f(lot_x, lot_y), &random,
+                 &scenario.scene);
+        }
+      }
+    }
+  }
+  // Street furniture between the intersections.
+  for (int street = 0; street <= params.num_cells_y; street++) {
+    for (int cell_x = 0; cell_x < params.num_cells_x; cell_x++) {
+      addStreetSegment(
+          Vector2f(cell_x * pitch + kStreetWidth / 2.0f, street * pitch),
+          true, &random, &scenario.scene);
+    }
+  }
+  for (int street = 0; street <= params.num_cells_x; street++) {
+    for (int cell_y = 0; cell_y < params.num_cells_y; cell_y++) {
+      addStreetSegment(
+          Vector2f(street * pitch, cell_y * pitch + kStreetWidth / 2.0f),
+          false, &random, &scenario.scene);
+    }
+  }
+
+  scenario.scene.addGroundLevel(0.0f);
+  const float margin = kStreetWidth / 2.0f;
+  scenario.scene.aabb() = AxisAlignedBoundingBox(
+      Vector3f(-margin, -margin, 0.0f),
+      Vector3f(params.num_cells_x * pitch + margin,
+               params.num_cells_y * pitch + margin, kMaxBuildingHeight));
+
+  // Drive along the streets running along x, turning at the ends.
+  std::vector<Vector2f> waypoints;
+  const float x_end = params.num_cells_x * pitch;
+  for (int street = 0; street <= params.num_cells_y; street++) {
+    const float y = street * pitch;
+    if (street % 2 == 0) {
+      waypoints.emplace_back(0.0f, y);
+      waypoints.emplace_back(x_end, y);
+    } else {
+      waypoints.emplace_back(x_end, y);
+      waypoints.emplace_back(0.0f, y);
+    }
+  }
+  sampleTrajectory(waypoints, kCarSensorHeight, params, &scenario);
+  return scenario;
+}
+
+}  // namespace
+
+Transform Scenario::getCameraPose(int frame_idx) const {
+  CHECK_GE(frame_idx, 0);
+  CHECK_LT(frame_idx, num_frames());
+  // The camera's z axis is the body's x axis, its y axis points down.
+  Eigen::Matrix3f R_B_C;
+  R_B_C << 0.0f, 0.0f, 1.0f,  //
+      -1.0f, 0.0f, 0.0f,      //
+      0.0f, -1.0f, 0.0f;
+  Transform T_B_C = Transform::Identity();
+  T_B_C.linear() = R_B_C;
+  return T_S_B[frame_idx] * T_B_C;
+}
+
+Transform Scenario::getLidarPose(int frame_idx) const {
+  CHECK_GE(frame_idx, 0);
+  CHECK_LT(frame_idx, num_frames());
+  return T_S_B[frame_idx];
+}
+
+Scenario createScenario(const ScenarioParams& params) {
+  CHECK_GT(params.num_cells_x, 0);
+  CHECK_GT(params.num_cells_y, 0);
+  switch (params.type) {
+    case ScenarioType::kWarehouse:
+      return createWarehouse(params);
+    case ScenarioType::kCityBlocks:
+      return createCityBlocks(params);
+    default:
+      LOG(FATAL) << "Not implemented";
+      return Scenario();
+  }
+}
+
+void sampleTrajectory(const std::vector<Vector2f>& waypoints, float height,
+                      const ScenarioParams& params, Scenario* scenario) {
+  CHECK_NOTNULL(scenario);
+  CHECK_GE(waypoints.size(), 2);
+  CHECK_GT(params.sensor_speed_mps, 0.0f);
+  CHECK_GT(params.frame_period_s, 0.0f);
+  CHECK_GT(params.num_laps, 0);
+
+  // Odd laps go back along the path.
+  std::vector<Vector2f> path = waypoints;
+  for (int lap = 1; lap < params.num_laps; lap++) {
+    if (lap % 2 == 1) {
+      path.insert(path.end(), waypoints.rbegin() + 1, waypoints.rend());
+    } else {
+      path.insert(path.end(), waypoints.begin() + 1, waypoints.end());
+    }
+  }
+
+  const float step_m = params.sensor_speed_mps * params.frame_period_s;
+  const int64_t frame_period_ms =
+      static_cast<int64_t>(std::round(params.frame_period_s * 1000.0f));
+  // Distance left to walk on the current segment before the next sample.
+  float offset_m = 0.0f;
+  for (size_t i = 0; i + 1 < path.size(); i++) {
+    const Vector2f segment = path[i + 1] - path[i];
+    const float length = segment.norm();
+    if (length <= 0.0f) {
+      continue;
+    }
+    const float yaw = std::atan2(segment.y(), segment.x());
+    float s = offset_m;
+    for (; s < length; s += step_m) {
+      const Vector2f p = path[i] + (s / length) * segment;
+      Transform T_S_B = Transform::Identity();
+      T_S_B.prerotate(Eigen::AngleAxisf(yaw, Vector3f::UnitZ()));
+      T_S_B.pretranslate(Vector3f(p.x(), p.y(), height));
+      scenario->timestamps_ms.push_back(Time(
+          static_cast<int64_t>(scenario->T_S_B.size()) * frame_period_ms));
+      scenario->T_S_B.push_back(T_S_B);
+    }
+    offset_m = s - length;
+  }
+}
+
+}  // namespace primitives
+}  // namespace nvblox
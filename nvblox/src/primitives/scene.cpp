@@ -44,6 +44,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "nvblox/primitives/scene.h"
 
+#include <algorithm>
+#include <atomic>
+
+#include "nvblox/utils/thread_pool.h"
+#include "nvblox/utils/timing.h"
+
 namespace nvblox {
 namespace primitives {
 
@@ -51,20 +57,24 @@ Scene::Scene() : aabb_(Vector3f(-5.0, -5.0, -1.0), Vector3f(5.0, 5.0, 9.0)) {}
 
 void Scene::addPrimitive(std::unique_ptr<Primitive> primitive) {
   primitives_.emplace_back(std::move(primitive));
+  invalidateBvh();
 }
 
 void Scene::addGroundLevel(float height) {
+  invalidateBvh();
   primitives_.emplace_back(
       new Plane(Vector3f(0.0, 0.0, height), Vector3f(0.0, 0.0, 1.0)));
 }
 
 void Scene::addCeiling(float height) {
+  invalidateBvh();
   primitives_.emplace_back(
       new Plane(Vector3f(0.0, 0.0, height), Vector3f(0.0, 0.0, -1.0)));
 }
 
 void Scene::addPlaneBoundaries(float x_min, float x_max, float y_min,
                                float y_max) {
+  invalidateBvh();
   // X planes:
   primitives_.emplace_back(
       new Plane(Vector3f(x_min, 0.0, 0.0), Vector3f(1.0, 0.0, 0.0)));
@@ -78,46 +88,89 @@ void Scene::addPlaneBoundaries(float x_min, float x_max, float y_min,
       new Plane(Vector3f(0.0, y_max, 0.0), Vector3f(0.0, -1.0, 0.0)));
 }
 
-void Scene::clear() { primitives_.clear(); }
+void Scene::clear() {
+  primitives_.clear();
+  invalidateBvh();
+}
 
-float Scene::getSignedDistanceToPoint(const Vector3f& coords,
-                                      float max_dist) const {
-  float min_dist = max_dist;
-  for (const std::unique_ptr<Primitive>& primitive : primitives_) {
-    float primitive_dist = primitive->getDistanceToPoint(coords);
-    if (primitive_dist < min_dist) {
-      min_dist = primitive_dist;
-    }
+std::shared_ptr<const PrimitiveBvh> Scene::getBvh() const {
+  std::shared_ptr<const PrimitiveBvh> bvh = std::atomic_load(&bvh_);
+  if (!bvh) {
+    // Concurrent first queries may build the hierarchy more than once, which
+    // is harmless.
+    bvh = std::make_shared<const PrimitiveBvh>(primitives_);
+    std::atomic_store(&bvh_, bvh);
   }
+  return bvh;
+}
 
-  return min_dist;
+void Scene::invalidateBvh() {
+  std::atomic_store(&bvh_, std::shared_ptr<const PrimitiveBvh>());
+}
+
+void Scene::parallelFor(int num_items,
+                        const std::function<void(int)>& function) const {
+  ThreadPool::getDefault()->parallelFor(num_items, function, num_threads_);
+}
+
+float Scene::getSignedDistanceToPoint(const Vector3f& coords,
+                                      float max_dist) const {
+  return getBvh()->getSignedDistanceToPoint(coords, max_dist);
 }
 
 bool Scene::getRayIntersection(const Vector3f& ray_origin,
                                const Vector3f& ray_direction, float max_dist,
                                Vector3f* ray_intersection,
                                float* ray_dist) const {
-  CHECK_NOTNULL(ray_intersection);
-  CHECK_NOTNULL(ray_dist);
-  *ray_intersection = Vector3f::Zero();
-  *ray_dist = max_dist;
-  bool ray_valid = false;
-  for (const std::unique_ptr<Primitive>& primitive : primitives_) {
-    Vector3f primitive_intersection;
-    float primitive_dist;
-    bool intersects =
-        primitive->getRayIntersection(ray_origin, ray_direction, max_dist,
-                                      &primitive_intersection, &primitive_dist);
-    if (intersects) {
-      if (!ray_valid || primitive_dist < *ray_dist) {
-        ray_valid = true;
-        *ray_dist = primitive_dist;
-        *ray_intersection = primitive_intersection;
+  return getBvh()->getRayIntersection(ray_origin, ray_direction, max_dist,
+                                      ray_intersection, ray_dist);
+}
+
+void Scene::renderDepthImage(
+    const Transform& T_S_C, float max_dist,
+    const std::function<Vector3f(const Index2D&)>& get_ray_direction_C,
+    const std::function<float(const Vector3f&)>& get_depth,
+    DepthImage* depth_frame) const {
+  const Transform T_C_S = T_S_C.inverse();
+  // Build the hierarchy once, rather than checking it for every ray.
+  const std::shared_ptr<const PrimitiveBvh> bvh = getBvh();
+
+  // Tiles are handed out to the threads dynamically, as their cost varies
+  // with the number of primitives they see.
+  const int tile_rows = (depth_frame->rows() + kRenderTileSize - 1) /
+                        kRenderTileSize;
+  const int tile_cols = (depth_frame->cols() + kRenderTileSize - 1) /
+                        kRenderTileSize;
+  parallelFor(tile_rows * tile_cols, [&](int tile_idx) {
+    const int row_start = (tile_idx / tile_cols) * kRenderTileSize;
+    const int col_start = (tile_idx % tile_cols) * kRenderTileSize;
+    const int row_end = std::min(row_start + kRenderTileSize,
+                                 depth_frame->rows());
+    const int col_end = std::min(col_start + kRenderTileSize,
+                                 depth_frame->cols());
+    // Row-major, matching the layout of the image.
+    Index2D u_C;
+    for (u_C.y() = row_start; u_C.y() < row_end; u_C.y()++) {
+      for (u_C.x() = col_start; u_C.x() < col_end; u_C.x()++) {
+        // Get the ray going through this pixel.
+        const Vector3f ray_direction =
+            T_S_C.linear() * get_ray_direction_C(u_C);
+        // Get the intersection point for this ray.
+        Vector3f ray_intersection;
+        float ray_dist;
+        if (bvh->getRayIntersection(T_S_C.translation(), ray_direction,
+                                    max_dist, &ray_intersection, &ray_dist)) {
+          // The ray intersection is expressed in the world coordinate frame.
+          // We must transform it back to the sensor coordinate frame.
+          (*depth_frame)(u_C.y(), u_C.x()) =
+              get_depth(T_C_S * ray_intersection);
+        } else {
+          // Otherwise set the depth to 0.0 to mark it as invalid.
+          (*depth_frame)(u_C.y(), u_C.x()) = 0.0f;
+        }
       }
     }
-  }
-
-  return ray_valid;
+  });
 }
 
 void Scene::generateDepthImageFromScene(const Camera& camera,
@@ -129,32 +182,36 @@ void Scene::generateDepthImageFromScene(const Camera& camera,
          "required.";
   CHECK_EQ(depth_frame->rows(), camera.height());
   CHECK_EQ(depth_frame->cols(), camera.width());
+  timing::Timer timer("scene/generate_depth_image");
+
+  renderDepthImage(
+      T_S_C, max_dist,
+      [&camera](const Index2D& u_C) {
+        return camera.vectorFromPixelIndices(u_C).normalized();
+      },
+      // We use the z coordinate in the camera frame to set the depth.
+      [](const Vector3f& p_C) { return p_C.z(); }, depth_frame);
+}
 
-  const Transform T_C_S = T_S_C.inverse();
-
-  // Iterate over the entire image.
-  Index2D u_C;
-  for (u_C.x() = 0; u_C.x() < camera.width(); u_C.x()++) {
-    for (u_C.y() = 0; u_C.y() < camera.height(); u_C.y()++) {
-      // Get the ray going through this pixel.
-      const Vector3f ray_direction =
-          T_S_C.linear() * camera.vectorFromPixelIndices(u_C).normalized();
-      // Get the intersection point for this ray.
-      Vector3f ray_intersection;
-      float ray_dist;
-      if (getRayIntersection(T_S_C.translation(), ray_direction, max_dist,
-                             &ray_intersection, &ray_dist)) {
-        // The ray intersection is expressed in the world coordinate frame.
-        // We must transform it back to the camera coordinate frame.
-        const Vector3f p_C = T_C_S * ray_intersection;
-        // Then we use the z coordinate in the camera frame to set the depth.
-        (*depth_frame)(u_C.y(), u_C.x()) = p_C.z();
-      } else {
-        // Otherwise set the depth to 0.0 to mark it as invalid.
-        (*depth_frame)(u_C.y(), u_C.x()) = 0.0f;
-      }
-    }
-  }
+void Scene::generateDepthImageFromScene(const Lidar& lidar,
+                                        const Transform& T_S_C, float max_dist,
+                                        DepthImage* depth_frame) const {
+  CHECK_NOTNULL(depth_frame);
+  CHECK(depth_frame->memory_type() == MemoryType::kUnified)
+      << "For scene generation DepthImage with memory_type == kUnified is "
+         "required.";
+  CHECK_EQ(depth_frame->rows(), lidar.num_elevation_divisions());
+  CHECK_EQ(depth_frame->cols(), lidar.num_azimuth_divisions());
+  timing::Timer timer("scene/generate_lidar_image");
+
+  renderDepthImage(
+      T_S_C, max_dist,
+      [&lidar](const Index2D& u_C) {
+        return lidar.vectorFromPixelIndices(u_C);
+      },
+      // Lidar depth is the range to the point.
+      [&lidar](const Vector3f& p_C) { return lidar.getDepth(p_C); },
+      depth_frame);
 }
 
 }  // namespace primitives
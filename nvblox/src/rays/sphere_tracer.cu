@@ -316,6 +316,8 @@ float SphereTracer::surface_distance_epsilon_vox() const {
   return surface_distance_epsilon_vox_;
 }
 
+int SphereTracer::num_cpu_threads() const { return num_cpu_threads_; }
+
 void SphereTracer::maximum_steps(int maximum_steps) {
   CHECK_GT(maximum_steps, 0);
   maximum_steps_ = maximum_steps;
@@ -332,6 +334,11 @@ void SphereTracer::surface_distance_epsilon_vox(
   surface_distance_epsilon_vox_ = surface_distance_epsilon_vox;
 }
 
+void SphereTracer::num_cpu_threads(int num_cpu_threads) {
+  CHECK_GE(num_cpu_threads, 0);
+  num_cpu_threads_ = num_cpu_threads;
+}
+
 SphereTracer::SubsampledImageSize SphereTracer::getSubsampledImageSize(
     const Camera& camera, const int subsampling_factor) const {
   return SubsampledImageSize(camera.height() / subsampling_factor,
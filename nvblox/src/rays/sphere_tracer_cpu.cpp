@@ -0,0 +1,368 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/rays/sphere_tracer.h"
+#include "nvblox/utils/thread_pool.h"
+#include "nvblox/utils/timing.h"
+
+namespace nvblox {
+namespace {
+
+// The number of rays in a full packet.
+constexpr int kMaxRaysPerPacket =
+    SphereTracer::kCpuPacketSize * SphereTracer::kCpuPacketSize;
+
+// Mirrors isTsdfVoxelValid() of the GPU tracer.
+inline bool isTsdfVoxelValid(const TsdfVoxel& voxel) {
+  constexpr float kMinWeight = 1e-4;
+  return voxel.weight > kMinWeight;
+}
+
+// A small direct-mapped cache of block lookups. The rays of a packet are
+// coherent and traverse the same few blocks, so most lookups hit the cache and
+// the layer's hash map is only queried when a ray enters a new block. Missing
+// blocks are cached as well, because rays spend many steps in unobserved
+// space.
+template <typename VoxelType>
+class BlockLookupCache {
+ public:
+  explicit BlockLookupCache(const VoxelBlockLayer<VoxelType>& layer)
+      : layer_(layer) {}
+
+  // Returns the voxel containing p_L or nullptr if its block is not allocated.
+  const VoxelType* getVoxelAtPosition(const Vector3f& p_L) {
+    Index3D block_idx;
+    Index3D voxel_idx;
+    getBlockAndVoxelIndexFromPositionInLayer(layer_.block_size(), p_L,
+                                             &block_idx, &voxel_idx);
+    const VoxelBlock<VoxelType>* block = getBlock(block_idx);
+    if (block == nullptr) {
+      return nullptr;
+    }
+    return &block->voxels[voxel_idx.x()][voxel_idx.y()][voxel_idx.z()];
+  }
+
+ private:
+  static constexpr int kNumEntries = 16;
+
+  struct Entry {
+    Index3D block_idx;
+    const VoxelBlock<VoxelType>* block = nullptr;
+    bool valid = false;
+  };
+
+  const VoxelBlock<VoxelType>* getBlock(const Index3D& block_idx) {
+    const uint32_t hash = static_cast<uint32_t>(block_idx.x()) * 73856093u ^
+                          static_cast<uint32_t>(block_idx.y()) * 19349663u ^
+                          static_cast<uint32_t>(block_idx.z()) * 83492791u;
+    Entry& entry = entries_[hash & (kNumEntries - 1)];
+    if (!entry.valid || entry.block_idx != block_idx) {
+      entry.block_idx = block_idx;
+      entry.block = layer_.getBlockAtIndex(block_idx).get();
+      entry.valid = true;
+    }
+    return entry.block;
+  }
+
+  const VoxelBlockLayer<VoxelType>& layer_;
+  std::array<Entry, kNumEntries> entries_;
+};
+
+struct CpuSphereTracingParams {
+  float truncation_distance_m;
+  int maximum_steps;
+  float maximum_ray_length_m;
+  float surface_distance_epsilon_m;
+  int ray_subsampling_factor;
+};
+
+// The state of a ray in a packet. Same as FirstDistanceType of the GPU tracer,
+// plus the two terminal states.
+enum class RayState : uint8_t {
+  kNotYetKnown,
+  kPositive,
+  kNegative,
+  kConverged,
+  kFailed
+};
+
+// Traces packets of rays, one tile of the output image each. The rays of a
+// packet are stored as structure-of-arrays and are stepped in lockstep, such
+// that the position updates vectorize. Each ray follows exactly the same steps
+// as cast() of the GPU tracer.
+class PacketSphereTracer {
+ public:
+  PacketSphereTracer(const Camera& camera, const Transform& T_L_C,
+                     const TsdfLayer& tsdf_layer, const ColorLayer* color_layer,
+                     const CpuSphereTracingParams& params)
+      : camera_(camera),
+        T_L_C_(T_L_C),
+        params_(params),
+        tsdf_cache_(tsdf_layer) {
+    if (color_layer != nullptr) {
+      color_cache_.emplace_back(*color_layer);
+    }
+  }
+
+  // Traces the rays of a tile and writes them to the (host) output images.
+  // color_image may be nullptr.
+  void traceTile(int tile_row, int tile_col, int ray_rows, int ray_cols,
+                 float* depth_image, Color* color_image) {
+    // Generate the rays of the tile.
+    const int row_start = tile_row * SphereTracer::kCpuPacketSize;
+    const int col_start = tile_col * SphereTracer::kCpuPacketSize;
+    const int row_end =
+        std::min(row_start + SphereTracer::kCpuPacketSize, ray_rows);
+    const int col_end =
+        std::min(col_start + SphereTracer::kCpuPacketSize, ray_cols);
+    const int factor = params_.ray_subsampling_factor;
+    constexpr float kHalf = 1.0f / 2.0f;
+    int num_rays = 0;
+    for (int ray_row_idx = row_start; ray_row_idx < row_end; ray_row_idx++) {
+      for (int ray_col_idx = col_start; ray_col_idx < col_end; ray_col_idx++) {
+        // The ray passes through the center of the patch it represents.
+        const Index2D ray_indices(ray_col_idx, ray_row_idx);
+        const Vector2f pixel_coords =
+            (ray_indices * factor).cast<float>() +
+            kHalf * static_cast<float>(factor) * Vector2f::Ones();
+        const Vector3f ray_direction_C =
+            camera_.vectorFromImagePlaneCoordinates(pixel_coords).normalized();
+        const Vector3f ray_direction_L = T_L_C_.linear() * ray_direction_C;
+        direction_x_[num_rays] = ray_direction_L.x();
+        direction_y_[num_rays] = ray_direction_L.y();
+        direction_z_[num_rays] = ray_direction_L.z();
+        direction_C_z_[num_rays] = ray_direction_C.z();
+        linear_idx_[num_rays] = ray_row_idx * ray_cols + ray_col_idx;
+        t_[num_rays] = 0.0f;
+        state_[num_rays] = RayState::kNotYetKnown;
+        ++num_rays;
+      }
+    }
+
+    tracePacket(num_rays);
+
+    // Write the outputs. Failed rays get -1 and a black color.
+    const Vector3f origin_L = T_L_C_.translation();
+    for (int r = 0; r < num_rays; r++) {
+      const bool converged = state_[r] == RayState::kConverged;
+      depth_image[linear_idx_[r]] =
+          converged ? t_[r] * direction_C_z_[r] : -1.0f;
+      if (color_image == nullptr) {
+        continue;
+      }
+      Color color(0, 0, 0);
+      if (converged) {
+        // Look up the color at the position where the ray bounced
+        const Vector3f p_L =
+            origin_L +
+            t_[r] * Vector3f(direction_x_[r], direction_y_[r], direction_z_[r]);
+        const ColorVoxel* voxel_ptr = color_cache_[0].getVoxelAtPosition(p_L);
+        if (voxel_ptr != nullptr) {
+          color = voxel_ptr->color;
+        }
+      }
+      color_image[linear_idx_[r]] = color;
+    }
+  }
+
+ private:
+  void tracePacket(int num_rays) {
+    const Vector3f origin_L = T_L_C_.translation();
+    const float eps = params_.surface_distance_epsilon_m;
+    int num_active = num_rays;
+    for (int i = 0; (i < params_.maximum_steps) && (num_active > 0); i++) {
+      // Current points to sample, for all rays of the packet at once.
+      for (int r = 0; r < num_rays; r++) {
+        p_x_[r] = origin_L.x() + t_[r] * direction_x_[r];
+        p_y_[r] = origin_L.y() + t_[r] * direction_y_[r];
+        p_z_[r] = origin_L.z() + t_[r] * direction_z_[r];
+      }
+      for (int r = 0; r < num_rays; r++) {
+        RayState& state = state_[r];
+        if (state == RayState::kConverged || state == RayState::kFailed) {
+          continue;
+        }
+        // Ran out of distance.
+        if (!(t_[r] < params_.maximum_ray_length_m)) {
+          state = RayState::kFailed;
+          --num_active;
+          continue;
+        }
+        const TsdfVoxel* voxel_ptr = tsdf_cache_.getVoxelAtPosition(
+            Vector3f(p_x_[r], p_y_[r], p_z_[r]));
+        // No distance: step through unobserved space, unless we've left
+        // observed space, in which case the ray is killed (see cast()).
+        if (voxel_ptr == nullptr || !isTsdfVoxelValid(*voxel_ptr)) {
+          if (state == RayState::kNotYetKnown) {
+            t_[r] += params_.truncation_distance_m;
+          } else {
+            state = RayState::kFailed;
+            --num_active;
+          }
+          continue;
+        }
+        const float distance = voxel_ptr->distance;
+        if (state == RayState::kNotYetKnown) {
+          state = (distance >= 0.0f) ? RayState::kPositive
+                                     : RayState::kNegative;
+        }
+        if (state == RayState::kPositive) {
+          if (distance < eps) {
+            // Zero crossing. Refine by back stepping the distance.
+            t_[r] += distance;
+            state = RayState::kConverged;
+            --num_active;
+          } else {
+            t_[r] += distance;
+          }
+        } else {
+          if (distance > -eps) {
+            t_[r] -= distance;
+            state = RayState::kConverged;
+            --num_active;
+          } else {
+            t_[r] -= distance;
+          }
+        }
+      }
+    }
+    // Ran out of steps.
+    for (int r = 0; r < num_rays; r++) {
+      if (state_[r] != RayState::kConverged) {
+        state_[r] = RayState::kFailed;
+      }
+    }
+  }
+
+  const Camera& camera_;
+  const Transform& T_L_C_;
+  const CpuSphereTracingParams params_;
+  BlockLookupCache<TsdfVoxel> tsdf_cache_;
+  // Holds a single cache if rendering color.
+  std::vector<BlockLookupCache<ColorVoxel>> color_cache_;
+
+  // The packet, as structure-of-arrays.
+  alignas(32) std::array<float, kMaxRaysPerPacket> direction_x_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> direction_y_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> direction_z_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> direction_C_z_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> t_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> p_x_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> p_y_;
+  alignas(32) std::array<float, kMaxRaysPerPacket> p_z_;
+  std::array<RayState, kMaxRaysPerPacket> state_;
+  std::array<int, kMaxRaysPerPacket> linear_idx_;
+};
+
+}  // namespace
+
+void SphereTracer::renderImageOnCPU(const Camera& camera,
+                                    const Transform& T_L_C,
+                                    const TsdfLayer& tsdf_layer,
+                                    const float truncation_distance_m,
+                                    DepthImage* depth_ptr,
+                                    const int ray_subsampling_factor) {
+  renderOnCPU(camera, T_L_C, tsdf_layer, nullptr, truncation_distance_m,
+              depth_ptr, nullptr, ray_subsampling_factor);
+}
+
+void SphereTracer::renderRgbdImageOnCPU(
+    const Camera& camera, const Transform& T_L_C, const TsdfLayer& tsdf_layer,
+    const ColorLayer& color_layer, const float truncation_distance_m,
+    DepthImage* depth_ptr, ColorImage* color_ptr,
+    const int ray_subsampling_factor) {
+  CHECK_NOTNULL(color_ptr);
+  renderOnCPU(camera, T_L_C, tsdf_layer, &color_layer, truncation_distance_m,
+              depth_ptr, color_ptr, ray_subsampling_factor);
+}
+
+void SphereTracer::renderOnCPU(const Camera& camera, const Transform& T_L_C,
+                               const TsdfLayer& tsdf_layer,
+                               const ColorLayer* color_layer,
+                               const float truncation_distance_m,
+                               DepthImage* depth_ptr, ColorImage* color_ptr,
+                               const int ray_subsampling_factor) {
+  CHECK_NOTNULL(depth_ptr);
+  CHECK_GT(ray_subsampling_factor, 0);
+  CHECK_EQ(camera.width() % ray_subsampling_factor, 0);
+  CHECK_EQ(camera.height() % ray_subsampling_factor, 0);
+  CHECK(tsdf_layer.memory_type() != MemoryType::kDevice)
+      << "Rendering on the CPU requires a host accessible TSDF layer.";
+  if (color_layer != nullptr) {
+    CHECK(color_layer->memory_type() != MemoryType::kDevice)
+        << "Rendering on the CPU requires a host accessible color layer.";
+    CHECK_EQ(color_layer->block_size(), tsdf_layer.block_size());
+  }
+  timing::Timer render_timer("sphere_tracing/cpu/render");
+
+  // Output space
+  const SubsampledImageSize image_size =
+      getSubsampledImageSize(camera, ray_subsampling_factor);
+  const int image_height = image_size.rows;
+  const int image_width = image_size.cols;
+
+  // If we get a request for a different size image, reallocate.
+  if (depth_ptr->width() != image_width ||
+      depth_ptr->height() != image_height ||
+      depth_ptr->memory_type() != MemoryType::kHost) {
+    LOG(INFO) << "Allocating output space for sphere tracing";
+    *depth_ptr = DepthImage(image_height, image_width, MemoryType::kHost);
+  }
+  if (color_ptr != nullptr &&
+      (color_ptr->width() != image_width ||
+       color_ptr->height() != image_height ||
+       color_ptr->memory_type() != MemoryType::kHost)) {
+    *color_ptr = ColorImage(image_height, image_width, MemoryType::kHost);
+  }
+  float* depth_image = depth_ptr->dataPtr();
+  Color* color_image = (color_ptr != nullptr) ? color_ptr->dataPtr() : nullptr;
+
+  const CpuSphereTracingParams params{
+      truncation_distance_m, maximum_steps_, maximum_ray_length_m_,
+      surface_distance_epsilon_vox_ * tsdf_layer.voxel_size(),
+      ray_subsampling_factor};
+
+  // Tiles are handed out to the worker threads dynamically, such that threads
+  // tracing cheap tiles (ie. looking at a close wall) pick up more of them.
+  const int tile_rows =
+      (image_height + kCpuPacketSize - 1) / kCpuPacketSize;
+  const int tile_cols = (image_width + kCpuPacketSize - 1) / kCpuPacketSize;
+  const int num_tiles = tile_rows * tile_cols;
+  std::atomic<int> next_tile{0};
+  auto worker = [&]() {
+    // Each thread has its own packet and block caches.
+    auto tracer = std::make_unique<PacketSphereTracer>(
+        camera, T_L_C, tsdf_layer, color_layer, params);
+    for (int i = next_tile++; i < num_tiles; i = next_tile++) {
+      tracer->traceTile(i / tile_cols, i % tile_cols, image_height,
+                        image_width, depth_image, color_image);
+    }
+  };
+
+  // The calling thread does its share of the work.
+  ThreadPool& thread_pool = *ThreadPool::getDefault();
+  thread_pool.runWorkers(thread_pool.numWorkers(num_cpu_threads_, num_tiles),
+                         worker);
+}
+
+}  // namespace nvblox
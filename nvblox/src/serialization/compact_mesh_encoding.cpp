@@ -0,0 +1,499 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/serialization/compact_mesh_encoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/serialization/mesh_serializer_gpu.h"
+
+namespace nvblox {
+namespace {
+
+constexpr uint32_t kMagic = 0x4D43564E;  // "NVCM"
+constexpr uint8_t kVersion = 1;
+constexpr int kMaxPaletteSize = 256;
+constexpr float kMaxQuantizedPosition = 65535.0f;
+
+// Vertices are quantized over [origin - block_size/2, origin + 3*block_size/2]
+// of their block.
+inline Vector3f getQuantizationOrigin(const Index3D& block_index,
+                                      float block_size) {
+  return getPositionFromBlockIndex(block_size, block_index) -
+         Vector3f::Constant(0.5f * block_size);
+}
+
+inline uint16_t quantizePosition(float position, float origin,
+                                 float block_size) {
+  const float normalized = (position - origin) / (2.0f * block_size);
+  const float quantized = std::round(normalized * kMaxQuantizedPosition);
+  return static_cast<uint16_t>(
+      std::clamp(quantized, 0.0f, kMaxQuantizedPosition));
+}
+
+inline float dequantizePosition(uint16_t quantized, float origin,
+                                float block_size) {
+  return origin + static_cast<float>(quantized) / kMaxQuantizedPosition *
+                      (2.0f * block_size);
+}
+
+inline float signNotZero(float value) { return (value >= 0.0f) ? 1.0f : -1.0f; }
+
+// Octahedral mapping of a unit vector to [-1, 1]^2.
+inline void encodeOctahedral(const Vector3f& normal, int8_t* u, int8_t* v) {
+  const float l1_norm =
+      std::abs(normal.x()) + std::abs(normal.y()) + std::abs(normal.z());
+  float x = 0.0f;
+  float y = 0.0f;
+  if (l1_norm > 0.0f) {
+    x = normal.x() / l1_norm;
+    y = normal.y() / l1_norm;
+    if (normal.z() < 0.0f) {
+      const float folded_x = (1.0f - std::abs(y)) * signNotZero(x);
+      const float folded_y = (1.0f - std::abs(x)) * signNotZero(y);
+      x = folded_x;
+      y = folded_y;
+    }
+  }
+  *u = static_cast<int8_t>(std::round(std::clamp(x, -1.0f, 1.0f) * 127.0f));
+  *v = static_cast<int8_t>(std::round(std::clamp(y, -1.0f, 1.0f) * 127.0f));
+}
+
+inline Vector3f decodeOctahedral(int8_t u, int8_t v) {
+  float x = static_cast<float>(u) / 127.0f;
+  float y = static_cast<float>(v) / 127.0f;
+  const float z = 1.0f - std::abs(x) - std::abs(y);
+  if (z < 0.0f) {
+    const float unfolded_x = (1.0f - std::abs(y)) * signNotZero(x);
+    const float unfolded_y = (1.0f - std::abs(x)) * signNotZero(y);
+    x = unfolded_x;
+    y = unfolded_y;
+  }
+  return Vector3f(x, y, z).normalized();
+}
+
+inline uint16_t encodeRgb565(const Color& color) {
+  const uint16_t r = (static_cast<uint16_t>(color.r) * 31 + 127) / 255;
+  const uint16_t g = (static_cast<uint16_t>(color.g) * 63 + 127) / 255;
+  const uint16_t b = (static_cast<uint16_t>(color.b) * 31 + 127) / 255;
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+inline Color decodeRgb565(uint16_t rgb565) {
+  const uint16_t r = (rgb565 >> 11) & 0x1F;
+  const uint16_t g = (rgb565 >> 5) & 0x3F;
+  const uint16_t b = rgb565 & 0x1F;
+  return Color(static_cast<uint8_t>((r * 255 + 15) / 31),
+               static_cast<uint8_t>((g * 255 + 31) / 63),
+               static_cast<uint8_t>((b * 255 + 15) / 31));
+}
+
+inline uint32_t zigzagEncode(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+  return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// Appends little-endian values to a byte buffer.
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::vector<uint8_t>* buffer) : buffer_(buffer) {}
+
+  template <typename T>
+  void put(T value) {
+    const size_t offset = buffer_->size();
+    buffer_->resize(offset + sizeof(T));
+    std::memcpy(buffer_->data() + offset, &value, sizeof(T));
+  }
+
+  void putVarint(uint32_t value) {
+    while (value >= 0x80) {
+      buffer_->push_back(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    buffer_->push_back(static_cast<uint8_t>(value));
+  }
+
+ private:
+  std::vector<uint8_t>* buffer_;
+};
+
+// Reads little-endian values from a byte buffer. Reads past the end fail.
+class ByteReader {
+ public:
+  ByteReader(const uint8_t* data, size_t num_bytes)
+      : data_(data), num_bytes_(num_bytes) {}
+
+  template <typename T>
+  bool get(T* value) {
+    if (position_ + sizeof(T) > num_bytes_) {
+      return false;
+    }
+    std::memcpy(value, data_ + position_, sizeof(T));
+    position_ += sizeof(T);
+    return true;
+  }
+
+  bool getVarint(uint32_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t byte;
+      if (!get(&byte)) {
+        return false;
+      }
+      *value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t remaining() const { return num_bytes_ - position_; }
+
+ private:
+  const uint8_t* data_;
+  size_t num_bytes_;
+  size_t position_ = 0;
+};
+
+void encodeBlockColors(const SerializedMesh& mesh, int vertex_begin,
+                       int vertex_end, CompactMeshColorEncoding encoding,
+                       ByteWriter* writer) {
+  if (encoding == CompactMeshColorEncoding::kPalette) {
+    // Try to build a palette of the distinct colors of the block.
+    std::unordered_map<uint32_t, uint8_t> palette_lookup;
+    std::vector<Color> palette;
+    bool fits_palette = true;
+    for (int i = vertex_begin; i < vertex_end && fits_palette; i++) {
+      const Color& color = mesh.colors[i];
+      const uint32_t key = (static_cast<uint32_t>(color.r) << 16) |
+                           (static_cast<uint32_t>(color.g) << 8) | color.b;
+      if (palette_lookup.count(key) == 0) {
+        if (static_cast<int>(palette.size()) == kMaxPaletteSize) {
+          fits_palette = false;
+        } else {
+          palette_lookup[key] = static_cast<uint8_t>(palette.size());
+          palette.push_back(color);
+        }
+      }
+    }
+    if (fits_palette) {
+      writer->put(static_cast<uint8_t>(CompactMeshColorEncoding::kPalette));
+      writer->putVarint(palette.size());
+      for (const Color& color : palette) {
+        writer->put(color.r);
+        writer->put(color.g);
+        writer->put(color.b);
+      }
+      for (int i = vertex_begin; i < vertex_end; i++) {
+        const Color& color = mesh.colors[i];
+        const uint32_t key = (static_cast<uint32_t>(color.r) << 16) |
+                             (static_cast<uint32_t>(color.g) << 8) | color.b;
+        writer->put(palette_lookup[key]);
+      }
+      return;
+    }
+  }
+  // RGB565, either requested or as the palette fallback.
+  writer->put(static_cast<uint8_t>(CompactMeshColorEncoding::kRgb565));
+  for (int i = vertex_begin; i < vertex_end; i++) {
+    writer->put(encodeRgb565(mesh.colors[i]));
+  }
+}
+
+bool decodeBlockColors(int num_vertices, ByteReader* reader,
+                       SerializedMesh* mesh) {
+  uint8_t block_encoding;
+  if (!reader->get(&block_encoding)) {
+    return false;
+  }
+  if (block_encoding ==
+      static_cast<uint8_t>(CompactMeshColorEncoding::kPalette)) {
+    uint32_t palette_size;
+    if (!reader->getVarint(&palette_size) || palette_size == 0 ||
+        palette_size > kMaxPaletteSize) {
+      return false;
+    }
+    std::vector<Color> palette(palette_size);
+    for (Color& color : palette) {
+      if (!reader->get(&color.r) || !reader->get(&color.g) ||
+          !reader->get(&color.b)) {
+        return false;
+      }
+      color.a = 255;
+    }
+    for (int i = 0; i < num_vertices; i++) {
+      uint8_t palette_index;
+      if (!reader->get(&palette_index) || palette_index >= palette_size) {
+        return false;
+      }
+      mesh->colors.push_back(palette[palette_index]);
+    }
+    return true;
+  }
+  if (block_encoding ==
+      static_cast<uint8_t>(CompactMeshColorEncoding::kRgb565)) {
+    for (int i = 0; i < num_vertices; i++) {
+      uint16_t rgb565;
+      if (!reader->get(&rgb565)) {
+        return false;
+      }
+      mesh->colors.push_back(decodeRgb565(rgb565));
+    }
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+float CompactSerializedMesh::compressionRatio() const {
+  if (data.empty()) {
+    return 0.0f;
+  }
+  return static_cast<float>(uncompressed_size_bytes) /
+         static_cast<float>(data.size());
+}
+
+CompactSerializedMesh encodeCompactMesh(
+    const SerializedMesh& mesh, float block_size,
+    const CompactMeshEncodingOptions& options,
+    const host_vector<Vector3f>* normals) {
+  CHECK_GT(block_size, 0.0f);
+  const int num_blocks = static_cast<int>(mesh.block_indices.size());
+  CHECK_EQ(mesh.vertex_block_offsets.size(), num_blocks + 1);
+  CHECK_EQ(mesh.triangle_index_block_offsets.size(), num_blocks + 1);
+  if (options.encode_normals) {
+    CHECK_NOTNULL(normals);
+    CHECK_EQ(normals->size(), mesh.vertices.size());
+  }
+  // Colors are only encoded if there is one per vertex.
+  const CompactMeshColorEncoding color_encoding =
+      (mesh.colors.size() == mesh.vertices.size())
+          ? options.color_encoding
+          : CompactMeshColorEncoding::kNone;
+
+  CompactSerializedMesh compact_mesh;
+  compact_mesh.block_indices = mesh.block_indices;
+  compact_mesh.uncompressed_size_bytes = mesh.sizeInBytes();
+  // A rough upper bound of the encoded size.
+  compact_mesh.data.reserve(64 + num_blocks * 32 + mesh.vertices.size() * 10 +
+                            mesh.triangle_indices.size() * 2);
+  ByteWriter writer(&compact_mesh.data);
+
+  // Header
+  writer.put(kMagic);
+  writer.put(kVersion);
+  writer.put(static_cast<uint8_t>(options.encode_normals));
+  writer.put(static_cast<uint8_t>(options.index_encoding));
+  writer.put(static_cast<uint8_t>(color_encoding));
+  writer.put(block_size);
+  writer.putVarint(num_blocks);
+
+  for (int block = 0; block < num_blocks; block++) {
+    const Index3D& block_index = mesh.block_indices[block];
+    const int vertex_begin = mesh.vertex_block_offsets[block];
+    const int vertex_end = mesh.vertex_block_offsets[block + 1];
+    const int index_begin = mesh.triangle_index_block_offsets[block];
+    const int index_end = mesh.triangle_index_block_offsets[block + 1];
+    const int num_vertices = vertex_end - vertex_begin;
+
+    writer.putVarint(zigzagEncode(block_index.x()));
+    writer.putVarint(zigzagEncode(block_index.y()));
+    writer.putVarint(zigzagEncode(block_index.z()));
+    writer.putVarint(num_vertices);
+    writer.putVarint(index_end - index_begin);
+
+    // Positions
+    const Vector3f origin = getQuantizationOrigin(block_index, block_size);
+    for (int i = vertex_begin; i < vertex_end; i++) {
+      const Vector3f& vertex = mesh.vertices[i];
+      for (int axis = 0; axis < 3; axis++) {
+        writer.put(quantizePosition(vertex[axis], origin[axis], block_size));
+      }
+    }
+
+    // Normals
+    if (options.encode_normals) {
+      for (int i = vertex_begin; i < vertex_end; i++) {
+        int8_t u, v;
+        encodeOctahedral((*normals)[i], &u, &v);
+        writer.put(u);
+        writer.put(v);
+      }
+    }
+
+    // Colors
+    if (color_encoding != CompactMeshColorEncoding::kNone) {
+      encodeBlockColors(mesh, vertex_begin, vertex_end, color_encoding,
+                        &writer);
+    }
+
+    // Triangle indices
+    if (options.index_encoding == CompactMeshIndexEncoding::k16Bit) {
+      CHECK_LE(num_vertices, std::numeric_limits<uint16_t>::max() + 1);
+      for (int i = index_begin; i < index_end; i++) {
+        writer.put(static_cast<uint16_t>(mesh.triangle_indices[i]));
+      }
+    } else {
+      // Predict the next index as the first vertex not referenced yet.
+      int32_t next_new_index = 0;
+      for (int i = index_begin; i < index_end; i++) {
+        const int32_t index = mesh.triangle_indices[i];
+        writer.putVarint(zigzagEncode(next_new_index - index));
+        next_new_index = std::max(next_new_index, index + 1);
+      }
+    }
+  }
+  return compact_mesh;
+}
+
+bool decodeCompactMesh(const uint8_t* data, size_t num_bytes,
+                       SerializedMesh* mesh, std::vector<Vector3f>* normals) {
+  CHECK_NOTNULL(mesh);
+  mesh->vertices.clear();
+  mesh->colors.clear();
+  mesh->triangle_indices.clear();
+  mesh->vertex_block_offsets.clear();
+  mesh->triangle_index_block_offsets.clear();
+  mesh->block_indices.clear();
+  if (normals) {
+    normals->clear();
+  }
+
+  // Header
+  ByteReader reader(data, num_bytes);
+  uint32_t magic;
+  uint8_t version, has_normals, index_encoding, color_encoding;
+  float block_size;
+  uint32_t num_blocks;
+  if (!reader.get(&magic) || magic != kMagic || !reader.get(&version) ||
+      version != kVersion || !reader.get(&has_normals) ||
+      !reader.get(&index_encoding) || !reader.get(&color_encoding) ||
+      !reader.get(&block_size) || !(block_size > 0.0f) ||
+      !reader.getVarint(&num_blocks)) {
+    return false;
+  }
+  if (index_encoding >
+          static_cast<uint8_t>(CompactMeshIndexEncoding::kVarintDelta) ||
+      color_encoding > static_cast<uint8_t>(CompactMeshColorEncoding::kPalette)) {
+    return false;
+  }
+  // Each block takes at least 5 bytes.
+  if (num_blocks > reader.remaining() / 5) {
+    return false;
+  }
+
+  mesh->vertex_block_offsets.push_back(0);
+  mesh->triangle_index_block_offsets.push_back(0);
+  mesh->block_indices.reserve(num_blocks);
+  for (uint32_t block = 0; block < num_blocks; block++) {
+    uint32_t x, y, z, num_vertices, num_indices;
+    if (!reader.getVarint(&x) || !reader.getVarint(&y) ||
+        !reader.getVarint(&z) || !reader.getVarint(&num_vertices) ||
+        !reader.getVarint(&num_indices)) {
+      return false;
+    }
+    // Each vertex takes at least 6 bytes and each index 1 byte.
+    if (num_vertices > reader.remaining() / 6 ||
+        num_indices > reader.remaining()) {
+      return false;
+    }
+    const Index3D block_index(zigzagDecode(x), zigzagDecode(y),
+                              zigzagDecode(z));
+    mesh->block_indices.push_back(block_index);
+
+    // Positions
+    const Vector3f origin = getQuantizationOrigin(block_index, block_size);
+    for (uint32_t i = 0; i < num_vertices; i++) {
+      Vector3f vertex;
+      for (int axis = 0; axis < 3; axis++) {
+        uint16_t quantized;
+        if (!reader.get(&quantized)) {
+          return false;
+        }
+        vertex[axis] = dequantizePosition(quantized, origin[axis], block_size);
+      }
+      mesh->vertices.push_back(vertex);
+    }
+
+    // Normals
+    if (has_normals) {
+      for (uint32_t i = 0; i < num_vertices; i++) {
+        int8_t u, v;
+        if (!reader.get(&u) || !reader.get(&v)) {
+          return false;
+        }
+        if (normals) {
+          normals->push_back(decodeOctahedral(u, v));
+        }
+      }
+    }
+
+    // Colors
+    if (color_encoding !=
+        static_cast<uint8_t>(CompactMeshColorEncoding::kNone)) {
+      if (!decodeBlockColors(num_vertices, &reader, mesh)) {
+        return false;
+      }
+    }
+
+    // Triangle indices
+    int32_t next_new_index = 0;
+    for (uint32_t i = 0; i < num_indices; i++) {
+      int32_t index;
+      if (index_encoding ==
+          static_cast<uint8_t>(CompactMeshIndexEncoding::k16Bit)) {
+        uint16_t index_16;
+        if (!reader.get(&index_16)) {
+          return false;
+        }
+        index = index_16;
+      } else {
+        uint32_t delta;
+        if (!reader.getVarint(&delta)) {
+          return false;
+        }
+        index = next_new_index - zigzagDecode(delta);
+      }
+      if (index < 0 || index >= static_cast<int32_t>(num_vertices)) {
+        return false;
+      }
+      next_new_index = std::max(next_new_index, index + 1);
+      mesh->triangle_indices.push_back(index);
+    }
+
+    mesh->vertex_block_offsets.push_back(mesh->vertices.size());
+    mesh->triangle_index_block_offsets.push_back(
+        mesh->triangle_indices.size());
+  }
+  return reader.remaining() == 0;
+}
+
+bool decodeCompactMesh(const CompactSerializedMesh& compact_mesh,
+                       SerializedMesh* mesh, std::vector<Vector3f>* normals) {
+  return decodeCompactMesh(compact_mesh.data.data(), compact_mesh.data.size(),
+                           mesh, normals);
+}
+
+}  // namespace nvblox
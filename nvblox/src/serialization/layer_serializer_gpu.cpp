@@ -0,0 +1,75 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/serialization/layer_serializer_gpu.h"
+
+#include "glog/logging.h"
+
+namespace nvblox {
+
+CompactFreespaceLayerSerializerGpu::CompactFreespaceLayerSerializerGpu()
+    : serialized_layer_(std::make_shared<SerializedFreespaceLayer>()) {}
+
+std::shared_ptr<const SerializedFreespaceLayer>
+CompactFreespaceLayerSerializerGpu::serialize(
+    const CompactFreespaceLayer& layer,
+    const std::vector<Index3D>& block_indices_to_serialize,
+    const CudaStream cuda_stream) {
+  // Gather the packed voxels and the time base of each block.
+  voxel_serializer_.serializeAsync(
+      layer, block_indices_to_serialize, compact_voxels_,
+      serialized_layer_->block_offsets,
+      [](const CompactFreespaceBlock* block)
+          -> const std::pair<const CompactFreespaceVoxel*, int> {
+        if (block == nullptr) {
+          return {nullptr, 0};
+        } else {
+          return std::make_pair(&block->voxels[0][0][0],
+                                CompactFreespaceBlock::kNumVoxels);
+        }
+      },
+      cuda_stream);
+  time_base_serializer_.serializeAsync(
+      layer, block_indices_to_serialize, time_bases_, time_base_offsets_,
+      [](const CompactFreespaceBlock* block)
+          -> const std::pair<const Time*, int> {
+        if (block == nullptr) {
+          return {nullptr, 0};
+        } else {
+          return std::make_pair(&block->time_base_ms, 1);
+        }
+      },
+      cuda_stream);
+  serialized_layer_->block_indices = block_indices_to_serialize;
+  cuda_stream.synchronize();
+
+  // Unpack the voxels of each block relative to the block's time base.
+  serialized_layer_->voxels.resize(compact_voxels_.size());
+  for (size_t i = 0; i < block_indices_to_serialize.size(); ++i) {
+    const int32_t begin = serialized_layer_->block_offsets[i];
+    const int32_t end = serialized_layer_->block_offsets[i + 1];
+    if (begin == end) {
+      continue;
+    }
+    const Time time_base_ms = time_bases_[time_base_offsets_[i]];
+    for (int32_t voxel_idx = begin; voxel_idx < end; ++voxel_idx) {
+      compact_voxels_[voxel_idx].toFreespaceVoxel(
+          time_base_ms, &serialized_layer_->voxels[voxel_idx]);
+    }
+  }
+  return serialized_layer_;
+}
+
+}  // namespace nvblox
@@ -64,6 +64,40 @@ std::shared_ptr<const SerializedMesh> MeshSerializerGpu::serializeMesh(
   return serialized_mesh_;
 }
 
+std::shared_ptr<const CompactSerializedMesh>
+MeshSerializerGpu::serializeMeshCompact(
+    const MeshLayer& mesh_layer,
+    const std::vector<Index3D>& block_indices_to_serialize,
+    const CompactMeshEncodingOptions& options, const CudaStream cuda_stream) {
+  // The serializers leave their outputs untouched if there are no blocks.
+  if (block_indices_to_serialize.empty()) {
+    SerializedMesh empty_mesh;
+    empty_mesh.vertex_block_offsets.push_back(0);
+    empty_mesh.triangle_index_block_offsets.push_back(0);
+    return std::make_shared<const CompactSerializedMesh>(encodeCompactMesh(
+        empty_mesh, mesh_layer.block_size(),
+        CompactMeshEncodingOptions{options.index_encoding,
+                                   options.color_encoding, false}));
+  }
+  if (options.encode_normals) {
+    normal_serializer_.serializeAsync(
+        mesh_layer, block_indices_to_serialize, serialized_normals_,
+        normal_block_offsets_,
+        [](const MeshBlock* mesh_block)
+            -> const std::pair<const Vector3f*, int> {
+          return std::make_pair(mesh_block->normals.data(),
+                                mesh_block->normals.size());
+        },
+        cuda_stream);
+  }
+  // Synchronizes the stream.
+  serializeMesh(mesh_layer, block_indices_to_serialize, cuda_stream);
+
+  return std::make_shared<const CompactSerializedMesh>(encodeCompactMesh(
+      *serialized_mesh_, mesh_layer.block_size(), options,
+      options.encode_normals ? &serialized_normals_ : nullptr));
+}
+
 MeshSerializerGpu::MeshSerializerGpu()
     : serialized_mesh_(std::make_shared<SerializedMesh>()) {}
 
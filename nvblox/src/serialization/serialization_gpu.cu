@@ -127,6 +127,18 @@ template void LayerSerializerGpuInternal<TsdfLayer, TsdfVoxel>::serializeAsync(
         get_data_and_size,
     const CudaStream cuda_stream);
 
+// Instantiation of serialize function for compact TSDF layer
+template void
+LayerSerializerGpuInternal<CompactTsdfLayer, CompactTsdfVoxel>::serializeAsync(
+    const CompactTsdfLayer& layer,
+    const std::vector<Index3D>& block_indices_to_serialize,
+    host_vector<CompactTsdfVoxel>& serialized_output,
+    host_vector<int32_t>& offsets_output,
+    std::function<std::pair<const CompactTsdfVoxel*, int>(
+        const CompactTsdfBlock* block)>
+        get_data_and_size,
+    const CudaStream cuda_stream);
+
 // Instantiation of serialize function for Color layer
 template void
 LayerSerializerGpuInternal<ColorLayer, ColorVoxel>::serializeAsync(
@@ -150,6 +162,19 @@ LayerSerializerGpuInternal<OccupancyLayer, OccupancyVoxel>::serializeAsync(
         get_data_and_size,
     const CudaStream cuda_stream);
 
+// Instantiation of serialize function for quantized Occupancy layer
+template void LayerSerializerGpuInternal<QuantizedOccupancyLayer,
+                                         QuantizedOccupancyVoxel>::
+    serializeAsync(
+        const QuantizedOccupancyLayer& layer,
+        const std::vector<Index3D>& block_indices_to_serialize,
+        host_vector<QuantizedOccupancyVoxel>& serialized_output,
+        host_vector<int32_t>& offsets_output,
+        std::function<std::pair<const QuantizedOccupancyVoxel*, int>(
+            const QuantizedOccupancyBlock* block)>
+            get_data_and_size,
+        const CudaStream cuda_stream);
+
 // Instantiation of serialize function for Freespace layer
 template void
 LayerSerializerGpuInternal<FreespaceLayer, FreespaceVoxel>::serializeAsync(
@@ -162,6 +187,31 @@ LayerSerializerGpuInternal<FreespaceLayer, FreespaceVoxel>::serializeAsync(
         get_data_and_size,
     const CudaStream cuda_stream);
 
+// Instantiation of serialize function for compact Freespace layer
+template void LayerSerializerGpuInternal<CompactFreespaceLayer,
+                                         CompactFreespaceVoxel>::
+    serializeAsync(
+        const CompactFreespaceLayer& layer,
+        const std::vector<Index3D>& block_indices_to_serialize,
+        host_vector<CompactFreespaceVoxel>& serialized_output,
+        host_vector<int32_t>& offsets_output,
+        std::function<std::pair<const CompactFreespaceVoxel*, int>(
+            const CompactFreespaceBlock* block)>
+            get_data_and_size,
+        const CudaStream cuda_stream);
+
+// Instantiation of serialize function for compact Freespace layer::Time (the
+// block time bases)
+template void
+LayerSerializerGpuInternal<CompactFreespaceLayer, Time>::serializeAsync(
+    const CompactFreespaceLayer& layer,
+    const std::vector<Index3D>& block_indices_to_serialize,
+    host_vector<Time>& serialized_output, host_vector<int32_t>& offsets_output,
+    std::function<std::pair<const Time*, int>(
+        const CompactFreespaceBlock* block)>
+        get_data_and_size,
+    const CudaStream cuda_stream);
+
 // Instantiation of serialize function for Esdf layer
 template void LayerSerializerGpuInternal<EsdfLayer, EsdfVoxel>::serializeAsync(
     const EsdfLayer& layer,
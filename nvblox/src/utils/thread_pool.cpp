@@ -0,0 +1,327 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "nvblox/utils/thread_pool.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nvblox {
+
+namespace {
+
+// The pool and queue of the calling thread, if it is a pool worker.
+thread_local const ThreadPool* tls_thread_pool = nullptr;
+thread_local int tls_worker_index = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads, bool pin_threads_to_cores)
+    : pin_threads_to_cores_(pin_threads_to_cores) {
+  if (num_threads <= 0) {
+    // The calling thread takes part in parallel loops.
+    num_threads = std::max(
+        1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  }
+  queues_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_queued_condition_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::getDefault() {
+  static std::shared_ptr<ThreadPool> default_thread_pool =
+      std::make_shared<ThreadPool>();
+  return default_thread_pool;
+}
+
+void ThreadPool::post(Task task) {
+  CHECK(task);
+  // Tasks posted by a worker go to its own queue, others are spread.
+  const size_t queue_index = isWorkerThread()
+                                 ? static_cast<size_t>(tls_worker_index)
+                                 : next_queue_++ % queues_.size();
+  {
+    WorkerQueue& queue = *queues_[queue_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_queued_tasks_;
+  }
+  ++num_tasks_submitted_;
+  task_queued_condition_.notify_one();
+}
+
+void ThreadPool::runWorkers(int num_workers,
+                            const std::function<void()>& worker) {
+  ++num_parallel_runs_;
+  num_workers = std::max(1, std::min(num_workers, num_threads() + 1));
+  if (num_workers == 1) {
+    worker();
+    return;
+  }
+
+  // Helpers which start after the run is closed return right away, so
+  // worker is never called after this function returned.
+  struct RunState {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool closed = false;
+    int num_running = 0;
+  };
+  auto state = std::make_shared<RunState>();
+  const std::function<void()>* worker_ptr = &worker;
+  for (int i = 1; i < num_workers; i++) {
+    post([this, state, worker_ptr]() {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->closed) {
+          ++num_helpers_skipped_;
+          return;
+        }
+        ++state->num_running;
+      }
+      (*worker_ptr)();
+      std::lock_guard<std::mutex> lock(state->mutex);
+      --state->num_running;
+      state->condition.notify_all();
+    });
+  }
+
+  auto close_and_wait = [&state]() {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->closed = true;
+    state->condition.wait(lock, [&state]() { return state->num_running == 0; });
+  };
+  try {
+    worker();
+  } catch (...) {
+    close_and_wait();
+    throw;
+  }
+  close_and_wait();
+}
+
+int ThreadPool::numWorkers(int max_parallelism, size_t num_items) const {
+  const int max_workers = num_threads() + 1;
+  const int num_workers = (max_parallelism <= 0)
+                              ? max_workers
+                              : std::min(max_parallelism, max_workers);
+  return static_cast<int>(
+      std::max<size_t>(1, std::min<size_t>(num_workers, num_items)));
+}
+
+bool ThreadPool::runPendingTask() {
+  Task task;
+  if (!popTask(isWorkerThread() ? tls_worker_index : -1, &task)) {
+    return false;
+  }
+  task();
+  ++num_tasks_executed_;
+  return true;
+}
+
+bool ThreadPool::isWorkerThread() const { return tls_thread_pool == this; }
+
+ThreadPoolStats ThreadPool::getStats() const {
+  ThreadPoolStats stats;
+  stats.num_threads = num_threads();
+  stats.num_tasks_submitted = num_tasks_submitted_;
+  stats.num_tasks_executed = num_tasks_executed_;
+  stats.num_tasks_stolen = num_tasks_stolen_;
+  stats.num_parallel_runs = num_parallel_runs_;
+  stats.num_helpers_skipped = num_helpers_skipped_;
+  return stats;
+}
+
+void ThreadPool::workerLoop(int worker_index) {
+  tls_thread_pool = this;
+  tls_worker_index = worker_index;
+  if (pin_threads_to_cores_) {
+    pinToCore(worker_index);
+  }
+  Task task;
+  while (true) {
+    if (popTask(worker_index, &task)) {
+      task();
+      task = nullptr;
+      ++num_tasks_executed_;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_queued_condition_.wait(
+        lock, [this]() { return stop_ || num_queued_tasks_ > 0; });
+    // Run everything queued before stopping.
+    if (stop_ && num_queued_tasks_ == 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::popTask(int worker_index, Task* task) {
+  const int num_queues = static_cast<int>(queues_.size());
+  if (worker_index >= 0) {
+    WorkerQueue& queue = *queues_[worker_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      --num_queued_tasks_;
+      return true;
+    }
+  }
+  // Steal, starting at the next queue such that the victims are spread.
+  for (int i = 1; i <= num_queues; i++) {
+    const int queue_index = (worker_index + i + num_queues) % num_queues;
+    if (queue_index == worker_index) {
+      continue;
+    }
+    WorkerQueue& queue = *queues_[queue_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      --num_queued_tasks_;
+      if (worker_index >= 0) {
+        ++num_tasks_stolen_;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::pinToCore(int worker_index) {
+#ifdef __linux__
+  const int num_cores =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET((worker_index + 1) % num_cores, &cpu_set);
+  const int result =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+  LOG_IF(WARNING, result != 0)
+      << "Failed to pin thread pool worker " << worker_index << " to a core.";
+#else
+  LOG(WARNING) << "Pinning threads to cores is only supported on Linux.";
+#endif
+}
+
+struct TaskGraph::RunState {
+  explicit RunState(size_t num_tasks)
+      : num_remaining_dependencies(new std::atomic<int>[num_tasks]) {}
+  std::unique_ptr<std::atomic<int>[]> num_remaining_dependencies;
+  std::atomic<size_t> num_done{0};
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+TaskGraph::TaskId TaskGraph::addTask(std::function<void()> function,
+                                     const std::vector<TaskId>& dependencies) {
+  CHECK(function);
+  const TaskId task_id = static_cast<TaskId>(tasks_.size());
+  for (const TaskId dependency : dependencies) {
+    CHECK_GE(dependency, 0);
+    CHECK_LT(dependency, task_id)
+        << "Dependencies have to be added before their dependents.";
+    tasks_[dependency].dependents.push_back(task_id);
+  }
+  TaskNode task;
+  task.function = std::move(function);
+  task.num_dependencies = static_cast<int>(dependencies.size());
+  tasks_.push_back(std::move(task));
+  return task_id;
+}
+
+void TaskGraph::run(ThreadPool* thread_pool) {
+  CHECK_NOTNULL(thread_pool);
+  const size_t num_tasks = tasks_.size();
+  if (num_tasks == 0) {
+    return;
+  }
+  auto state = std::make_shared<RunState>(num_tasks);
+  for (size_t i = 0; i < num_tasks; i++) {
+    state->num_remaining_dependencies[i] = tasks_[i].num_dependencies;
+  }
+  for (size_t i = 0; i < num_tasks; i++) {
+    if (tasks_[i].num_dependencies == 0) {
+      const TaskId task_id = static_cast<TaskId>(i);
+      thread_pool->post([this, task_id, state, thread_pool]() {
+        runTask(task_id, state, thread_pool);
+      });
+    }
+  }
+
+  auto all_done = [&]() { return state->num_done == num_tasks; };
+  if (thread_pool->isWorkerThread()) {
+    // Help out, the graph may be queued behind the waiting task.
+    constexpr auto kPollPeriod = std::chrono::microseconds(100);
+    while (!all_done()) {
+      if (!thread_pool->runPendingTask()) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->condition.wait_for(lock, kPollPeriod, all_done);
+      }
+    }
+  } else {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, all_done);
+  }
+}
+
+void TaskGraph::runTask(TaskId task_id, const std::shared_ptr<RunState>& state,
+                        ThreadPool* thread_pool) const {
+  const TaskNode& task = tasks_[task_id];
+  const size_t num_tasks = tasks_.size();
+  task.function();
+  for (const TaskId dependent : task.dependents) {
+    if (--state->num_remaining_dependencies[dependent] == 0) {
+      thread_pool->post([this, dependent, state, thread_pool]() {
+        runTask(dependent, state, thread_pool);
+      });
+    }
+  }
+  // The graph may be destroyed once the last task is counted, so it isn't
+  // accessed below.
+  if (++state->num_done == num_tasks) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->condition.notify_all();
+  }
+}
+
+}  // namespace nvblox
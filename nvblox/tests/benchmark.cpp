@@ -16,15 +16,26 @@ limitations under the License.
 
 #include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <memory>
 #include "nvblox/datasets/3dmatch.h"
 #include "nvblox/executables/fuser.h"
 #include "nvblox/io/image_io.h"
+#include "nvblox/io/layer_cake_io.h"
+#include "nvblox/map/layer_to_3d_grid.h"
+#include "nvblox/map_saving/internal/serializer.h"
+#include "nvblox/mesh/mesh_streamer.h"
+#include "nvblox/primitives/scene.h"
+#include "nvblox/rays/sphere_tracer.h"
 #include "nvblox/sensors/connected_components.h"
 #include "nvblox/sensors/npp_image_operations.h"
 #include "nvblox/serialization/mesh_serializer_gpu.h"
+#include "nvblox/tests/block_layout_utils.h"
 #include "nvblox/tests/utils.h"
+#include "nvblox/utils/thread_pool.h"
 
 namespace nvblox {
 
@@ -146,6 +157,190 @@ void benchmarkUpdateEsdf(benchmark::State& state) {
 }
 BENCHMARK(benchmarkUpdateEsdf)->Unit(benchmark::kMillisecond);
 
+void benchmarkColorMeshCPU(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_threads = state.range(0);
+  const bool trilinear = state.range(1) != 0;
+  const FrameData data = readFrameData();
+  auto mapper = createMapper();
+  mapper->integrateDepth(data.depth_frame, data.T_L_C, data.camera);
+  mapper->integrateColor(data.color_frame, data.T_L_C, data.camera);
+  mapper->updateMesh();
+
+  // CPU coloring works on host memory.
+  ColorLayer color_layer(mapper->color_layer().voxel_size(),
+                         MemoryType::kHost);
+  color_layer.copyFrom(mapper->color_layer());
+  MeshLayer mesh_layer(mapper->mesh_layer().block_size(), MemoryType::kHost);
+  mesh_layer.copyFrom(mapper->mesh_layer());
+  const std::vector<Index3D> block_indices = mesh_layer.getAllBlockIndices();
+  size_t num_vertices = 0;
+  for (const Index3D& block_idx : block_indices) {
+    num_vertices += mesh_layer.getBlockAtIndex(block_idx)->vertices.size();
+  }
+
+  MeshIntegrator mesh_integrator;
+  mesh_integrator.num_color_threads(num_threads);
+  mesh_integrator.color_interpolation_trilinear(trilinear);
+  for (auto _ : state) {
+    // Recolor the full map.
+    mesh_integrator.colorMeshCPU(color_layer, block_indices, &mesh_layer);
+  }
+  state.counters["vertices_per_second"] =
+      benchmark::Counter(static_cast<double>(num_vertices),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(benchmarkColorMeshCPU)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1, 0})
+    ->Args({0, 0})   // All hardware threads
+    ->Args({1, 1})
+    ->Args({0, 1});  // All hardware threads, trilinear
+
+void benchmarkSphereTraceCPU(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_threads = state.range(0);
+  const int ray_subsampling_factor = state.range(1);
+  const FrameData data = readFrameData();
+  auto mapper = createMapper();
+  mapper->integrateDepth(data.depth_frame, data.T_L_C, data.camera);
+  mapper->integrateColor(data.color_frame, data.T_L_C, data.camera);
+
+  // CPU rendering works on host memory.
+  TsdfLayer tsdf_layer(mapper->tsdf_layer().voxel_size(), MemoryType::kHost);
+  tsdf_layer.copyFrom(mapper->tsdf_layer());
+  ColorLayer color_layer(mapper->color_layer().voxel_size(),
+                         MemoryType::kHost);
+  color_layer.copyFrom(mapper->color_layer());
+  const float truncation_distance_m =
+      mapper->tsdf_integrator().get_truncation_distance_m(
+          tsdf_layer.voxel_size());
+
+  SphereTracer sphere_tracer;
+  sphere_tracer.num_cpu_threads(num_threads);
+  DepthImage depth_image(MemoryType::kHost);
+  ColorImage color_image(MemoryType::kHost);
+  for (auto _ : state) {
+    // Re-render the integrated view.
+    sphere_tracer.renderRgbdImageOnCPU(
+        data.camera, data.T_L_C, tsdf_layer, color_layer,
+        truncation_distance_m, &depth_image, &color_image,
+        ray_subsampling_factor);
+  }
+  state.counters["fps"] =
+      benchmark::Counter(1.0, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(benchmarkSphereTraceCPU)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1, 1})
+    ->Args({0, 1})   // All hardware threads
+    ->Args({1, 4})
+    ->Args({0, 4});  // All hardware threads, subsampled
+
+// A box with num_primitives random spheres and cubes.
+primitives::Scene createClutteredScene(int num_primitives) {
+  primitives::Scene scene;
+  scene.aabb() = AxisAlignedBoundingBox(Vector3f(-5.0f, -5.0f, 0.0f),
+                                        Vector3f(5.0f, 5.0f, 3.0f));
+  scene.addGroundLevel(0.0f);
+  scene.addCeiling(3.0f);
+  scene.addPlaneBoundaries(-5.0f, 5.0f, -5.0f, 5.0f);
+  for (int i = 0; i < num_primitives; i++) {
+    const Vector3f center(test_utils::randomFloatInRange(-4.5f, 4.5f),
+                          test_utils::randomFloatInRange(-4.5f, 4.5f),
+                          test_utils::randomFloatInRange(0.0f, 3.0f));
+    const float size = test_utils::randomFloatInRange(0.05f, 0.2f);
+    if (i % 2 == 0) {
+      scene.addPrimitive(std::make_unique<primitives::Sphere>(center, size));
+    } else {
+      scene.addPrimitive(std::make_unique<primitives::Cube>(
+          center, Vector3f::Constant(size)));
+    }
+  }
+  return scene;
+}
+
+void benchmarkGenerateDepthImageFromScene(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_primitives = state.range(0);
+  const int num_threads = state.range(1);
+  primitives::Scene scene = createClutteredScene(num_primitives);
+  scene.num_threads(num_threads);
+  const Camera camera(300, 300, 320, 240, 640, 480);
+  Transform T_S_C = Transform::Identity();
+  T_S_C.prerotate(
+      Eigen::AngleAxisf(M_PI / 2.0f, Vector3f::UnitX()).toRotationMatrix());
+  T_S_C.pretranslate(Vector3f(0.0f, -4.0f, 1.5f));
+  DepthImage depth_frame(camera.height(), camera.width(), MemoryType::kUnified);
+  for (auto _ : state) {
+    scene.generateDepthImageFromScene(camera, T_S_C, 20.0f, &depth_frame);
+  }
+  state.counters["fps"] =
+      benchmark::Counter(1.0, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(benchmarkGenerateDepthImageFromScene)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({100, 1})
+    ->Args({5000, 1})
+    ->Args({5000, 0});  // All hardware threads
+
+void benchmarkGenerateLayerFromScene(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_primitives = state.range(0);
+  const int num_threads = state.range(1);
+  primitives::Scene scene = createClutteredScene(num_primitives);
+  scene.num_threads(num_threads);
+  for (auto _ : state) {
+    TsdfLayer layer(0.1f, MemoryType::kHost);
+    scene.generateLayerFromScene(0.4f, &layer);
+    benchmark::DoNotOptimize(layer);
+  }
+}
+BENCHMARK(benchmarkGenerateLayerFromScene)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({100, 1})
+    ->Args({5000, 1})
+    ->Args({5000, 0});  // All hardware threads
+
+void benchmarkLoadLayerCake(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_blocks = state.range(0);
+  const int num_threads = state.range(1);
+
+  // A map with num_blocks TSDF and color blocks, in a cube.
+  constexpr float kVoxelSizeM = 0.05f;
+  LayerCake cake = LayerCake::create<TsdfLayer, ColorLayer>(kVoxelSizeM,
+                                                            MemoryType::kHost);
+  const int side = static_cast<int>(std::ceil(std::cbrt(num_blocks)));
+  for (int i = 0; i < num_blocks; i++) {
+    const Index3D index(i % side, (i / side) % side, i / (side * side));
+    cake.getPtr<TsdfLayer>()->allocateBlockAtIndex(index);
+    cake.getPtr<ColorLayer>()->allocateBlockAtIndex(index);
+  }
+  const std::string filename = "benchmark_load_layer_cake.nvblx";
+  io::writeLayerCakeToFile(filename, cake);
+
+  for (auto _ : state) {
+    Serializer serializer(filename, std::ios::in);
+    serializer.num_load_threads(num_threads);
+    LayerCake loaded =
+        serializer.loadLayerCake(MemoryType::kHost, CudaStreamOwning());
+    serializer.close();
+    benchmark::DoNotOptimize(loaded);
+  }
+  state.counters["blocks_per_second"] = benchmark::Counter(
+      2.0 * num_blocks, benchmark::Counter::kIsIterationInvariantRate);
+  std::remove(filename.c_str());
+}
+BENCHMARK(benchmarkLoadLayerCake)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({1000, 1})
+    ->Args({1000, 0})  // All hardware threads
+    ->Args({10000, 1})
+    ->Args({10000, 0})
+    ->Args({50000, 1})
+    ->Args({50000, 0});
+
 void benchmarkSerializeMesh(benchmark::State& state) {
   std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
   const FrameData data = readFrameData();
@@ -173,6 +368,38 @@ void benchmarkSerializeMesh(benchmark::State& state) {
 
 BENCHMARK(benchmarkSerializeMesh)->Unit(benchmark::kMillisecond);
 
+void benchmarkSerializeMeshCompact(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const FrameData data = readFrameData();
+  auto mapper = createMapper();
+  MeshSerializerGpu serializer;
+  CompactMeshEncodingOptions options;
+  options.color_encoding =
+      static_cast<CompactMeshColorEncoding>(state.range(0));
+
+  CudaStreamOwning cuda_stream;
+
+  std::shared_ptr<const CompactSerializedMesh> compact_mesh;
+  for (auto _ : state) {
+    state.PauseTiming();
+    mapper->integrateDepth(data.depth_frame, data.T_L_C, data.camera);
+    mapper->integrateColor(data.color_frame, data.T_L_C, data.camera);
+    mapper->updateMesh();
+    state.ResumeTiming();
+
+    compact_mesh = serializer.serializeMeshCompact(
+        mapper->mesh_layer(), mapper->mesh_layer().getAllBlockIndices(),
+        options, cuda_stream);
+  }
+  state.counters["bytes"] = compact_mesh->data.size();
+  state.counters["compression_ratio"] = compact_mesh->compressionRatio();
+}
+
+BENCHMARK(benchmarkSerializeMeshCompact)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(static_cast<int64_t>(CompactMeshColorEncoding::kRgb565))
+    ->Arg(static_cast<int64_t>(CompactMeshColorEncoding::kPalette));
+
 void benchmarkRemoveSmallConnectedComponents(benchmark::State& state) {
   std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
 
@@ -214,6 +441,236 @@ BENCHMARK(benchmarkMonoImageGpuToCpuRoundtrip)
     ->Args({1920, 1080})
     ->Unit(benchmark::kMillisecond);
 
+// A host ESDF layer with a dense cube of allocated blocks.
+std::unique_ptr<EsdfLayer> createDenseHostEsdfLayer(int num_blocks_per_side) {
+  constexpr float kVoxelSize = 0.05;
+  auto layer = std::make_unique<EsdfLayer>(kVoxelSize, MemoryType::kHost);
+  std::vector<Index3D> block_indices;
+  for (int x = 0; x < num_blocks_per_side; x++) {
+    for (int y = 0; y < num_blocks_per_side; y++) {
+      for (int z = 0; z < num_blocks_per_side; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  layer->allocateBlocksAtIndices(block_indices, CudaStreamOwning());
+  return layer;
+}
+
+struct EsdfDistanceFunctor {
+  float operator()(const EsdfVoxel& voxel) const {
+    return voxel.squared_distance_vox;
+  }
+};
+
+void benchmarkLayerToDenseGridHost(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_threads = state.range(0);
+  constexpr int kNumBlocksPerSide = 32;
+  auto layer = createDenseHostEsdfLayer(kNumBlocksPerSide);
+  const auto aabb = getAABBOfAllocatedBlocks(*layer);
+
+  Unified3DGrid<float> grid(MemoryType::kHost);
+  for (auto _ : state) {
+    voxelLayerToDenseVoxelGridInAABB(*layer, aabb, -1.0f,
+                                     EsdfDistanceFunctor(), &grid,
+                                     num_threads);
+    benchmark::DoNotOptimize(grid.data().data());
+  }
+  state.counters["voxels_per_second"] =
+      benchmark::Counter(static_cast<double>(grid.data().size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(benchmarkLayerToDenseGridHost)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(0);  // All hardware threads
+
+void benchmarkLayerToDenseGridHostTiled(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int tile_size = state.range(0);
+  constexpr int kNumBlocksPerSide = 32;
+  auto layer = createDenseHostEsdfLayer(kNumBlocksPerSide);
+  const auto aabb = getAABBOfAllocatedBlocks(*layer);
+
+  size_t num_voxels = 0;
+  for (auto _ : state) {
+    num_voxels = 0;
+    voxelLayerToDenseVoxelGridInAABBTiled<EsdfVoxel, float>(
+        *layer, aabb, -1.0f, EsdfDistanceFunctor(),
+        Index3D::Constant(tile_size), [&](const Unified3DGrid<float>& tile) {
+          benchmark::DoNotOptimize(tile.data().data());
+          num_voxels += tile.data().size();
+        });
+  }
+  state.counters["voxels_per_second"] =
+      benchmark::Counter(static_cast<double>(num_voxels),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(benchmarkLayerToDenseGridHostTiled)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128);
+
+void benchmarkMeshStreamerGetNMeshBlocks(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const int num_candidates = state.range(0);
+  const int num_blocks_per_call = state.range(1);
+
+  // A cube of candidate blocks.
+  const int num_blocks_per_side =
+      static_cast<int>(std::ceil(std::cbrt(num_candidates)));
+  std::vector<Index3D> block_indices;
+  block_indices.reserve(num_candidates);
+  for (int x = 0; x < num_blocks_per_side; x++) {
+    for (int y = 0; y < num_blocks_per_side; y++) {
+      for (int z = 0; z < num_blocks_per_side; z++) {
+        if (static_cast<int>(block_indices.size()) < num_candidates) {
+          block_indices.push_back(Index3D(x, y, z));
+        }
+      }
+    }
+  }
+  MeshStreamerOldestBlocks mesh_streamer;
+  mesh_streamer.markIndicesCandidates(block_indices);
+
+  for (auto _ : state) {
+    // Stream some blocks and mark them again, as if they were re-meshed, such
+    // that the number of candidates stays constant.
+    const std::vector<Index3D> streamed_blocks =
+        mesh_streamer.getNMeshBlocks(num_blocks_per_call);
+    mesh_streamer.markIndicesCandidates(streamed_blocks);
+    benchmark::DoNotOptimize(streamed_blocks.data());
+  }
+  state.counters["num_candidates"] = mesh_streamer.numCandidates();
+}
+BENCHMARK(benchmarkMeshStreamerGetNMeshBlocks)
+    ->Unit(benchmark::kMicrosecond)
+    ->Args({1000000, 100})
+    ->Args({1000000, 1000})
+    ->Args({1000000, 10000});
+
+// Find the marching cubes triangle candidates of a sphere with the CPU
+// meshing kernels, for each block layout.
+template <typename BlockType>
+void benchmarkBlockLayoutMeshing(benchmark::State& state) {
+  constexpr int kNumBlocksPerSide = 10;
+  constexpr float kBlockSize = 0.4f;
+  const test_utils::SphereTsdfBlockGrid<BlockType> grid(kNumBlocksPerSide,
+                                                        kBlockSize);
+  for (auto _ : state) {
+    const std::vector<marching_cubes::PerVoxelMarchingCubesResults>
+        candidates = test_utils::getTriangleCandidatesInGrid(grid, 0.5f);
+    benchmark::DoNotOptimize(candidates.data());
+  }
+}
+BENCHMARK_TEMPLATE(benchmarkBlockLayoutMeshing, TsdfBlock)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmarkBlockLayoutMeshing, SoaTsdfBlock)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(benchmarkBlockLayoutMeshing, MortonTsdfBlock)
+    ->Unit(benchmark::kMicrosecond);
+
+// Visit all blocks of a layer and read the boundary voxels of their face
+// neighbours, as ESDF propagation and dilation do. Arg 0 iterates in hash map
+// order, arg 1 in Morton order.
+void benchmarkBlockIterationOrder(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const bool morton_order = state.range(0);
+  constexpr int kNumBlocksPerSide = 32;
+  TsdfLayer layer(0.05f, MemoryType::kHost);
+  std::vector<Index3D> block_indices;
+  for (int x = 0; x < kNumBlocksPerSide; x++) {
+    for (int y = 0; y < kNumBlocksPerSide; y++) {
+      for (int z = 0; z < kNumBlocksPerSide; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  layer.allocateBlocksAtIndices(block_indices, CudaStreamOwning());
+  const std::array<Index3D, 6> kFaceNeighbors = {
+      Index3D(1, 0, 0),  Index3D(-1, 0, 0), Index3D(0, 1, 0),
+      Index3D(0, -1, 0), Index3D(0, 0, 1),  Index3D(0, 0, -1)};
+
+  for (auto _ : state) {
+    const std::vector<Index3D> indices =
+        morton_order ? layer.getAllBlockIndicesInMortonOrder()
+                     : layer.getAllBlockIndices();
+    float sum = 0.0f;
+    for (const Index3D& block_index : indices) {
+      for (const Index3D& offset : kFaceNeighbors) {
+        const TsdfBlock::ConstPtr neighbor =
+            layer.getBlockAtIndex(block_index + offset);
+        if (!neighbor) {
+          continue;
+        }
+        // The face of the neighbour towards the block.
+        int axis = 0;
+        while (offset[axis] == 0) {
+          axis++;
+        }
+        constexpr int kVoxelsPerSide = TsdfBlock::kVoxelsPerSide;
+        Index3D voxel_index;
+        voxel_index[axis] = offset[axis] > 0 ? 0 : kVoxelsPerSide - 1;
+        for (int i = 0; i < kVoxelsPerSide; i++) {
+          for (int j = 0; j < kVoxelsPerSide; j++) {
+            voxel_index[(axis + 1) % 3] = i;
+            voxel_index[(axis + 2) % 3] = j;
+            const Index3D& v = voxel_index;
+            sum += neighbor->voxels[v.x()][v.y()][v.z()].distance;
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(benchmarkBlockIterationOrder)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1);
+
+// A small parallel loop, as run per block batch by the CPU components. Arg 0
+// runs it on the persistent pool, arg 1 spawns threads per call, as the
+// components did before the pool.
+void benchmarkParallelForOverhead(benchmark::State& state) {
+  std::call_once(init_glog_flag, []() { google::InitGoogleLogging(""); });
+  const bool spawn_threads = state.range(0);
+  constexpr int kNumItems = 256;
+  ThreadPool& thread_pool = *ThreadPool::getDefault();
+  const int num_workers = thread_pool.numWorkers(0, kNumItems);
+  std::vector<float> values(kNumItems, 1.0f);
+  auto process_item = [&](int i) { values[i] = std::sqrt(values[i] + i); };
+
+  for (auto _ : state) {
+    if (spawn_threads) {
+      std::atomic<int> next_item{0};
+      auto worker = [&]() {
+        for (int i = next_item++; i < kNumItems; i = next_item++) {
+          process_item(i);
+        }
+      };
+      std::vector<std::thread> threads;
+      for (int i = 1; i < num_workers; i++) {
+        threads.emplace_back(worker);
+      }
+      worker();
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    } else {
+      thread_pool.parallelFor(kNumItems, process_item);
+    }
+    benchmark::DoNotOptimize(values.data());
+  }
+}
+BENCHMARK(benchmarkParallelForOverhead)
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(0)
+    ->Arg(1);
+
 }  // namespace nvblox
 
 BENCHMARK_MAIN();
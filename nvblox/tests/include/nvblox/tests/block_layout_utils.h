@@ -0,0 +1,141 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/core/types.h"
+#include "nvblox/map/morton_voxel_block.h"
+#include "nvblox/map/soa_voxel_block.h"
+#include "nvblox/mesh/internal/marching_cubes.h"
+
+namespace nvblox {
+namespace test_utils {
+
+// Helpers for running the CPU kernels on all block layouts (VoxelBlock,
+// SoaVoxelBlock and MortonVoxelBlock), which is what the tests and benchmarks
+// compare.
+
+// Fill the block with pseudo random TSDF voxels, the same for both layouts.
+template <typename BlockType>
+void setTsdfBlockVoxelsPseudoRandom(int seed, BlockType* block) {
+  unsigned int state = 2654435761u * (seed + 1);
+  auto next_float = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) / static_cast<float>(1u << 24);
+  };
+  for (int x = 0; x < BlockType::kVoxelsPerSide; x++) {
+    for (int y = 0; y < BlockType::kVoxelsPerSide; y++) {
+      for (int z = 0; z < BlockType::kVoxelsPerSide; z++) {
+        block->voxels[x][y][z].distance = next_float() - 0.5f;
+        block->voxels[x][y][z].weight = 10.0f * next_float();
+      }
+    }
+  }
+}
+
+// A cube of blocks holding the TSDF of a sphere centered in the cube.
+template <typename BlockType>
+struct SphereTsdfBlockGrid {
+  SphereTsdfBlockGrid(int num_blocks_per_side_in, float block_size_in)
+      : num_blocks_per_side(num_blocks_per_side_in), block_size(block_size_in) {
+    constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+    const float voxel_size = block_size / kVoxelsPerSide;
+    const Vector3f center =
+        Vector3f::Constant(0.5f * num_blocks_per_side * block_size);
+    const float radius = 0.35f * num_blocks_per_side * block_size;
+    Index3D block_index;
+    for (block_index.x() = 0; block_index.x() < num_blocks_per_side;
+         block_index.x()++) {
+      for (block_index.y() = 0; block_index.y() < num_blocks_per_side;
+           block_index.y()++) {
+        for (block_index.z() = 0; block_index.z() < num_blocks_per_side;
+             block_index.z()++) {
+          blocks.push_back(BlockType::allocate(MemoryType::kHost));
+          BlockType* block = blocks.back().get();
+          for (int x = 0; x < kVoxelsPerSide; x++) {
+            for (int y = 0; y < kVoxelsPerSide; y++) {
+              for (int z = 0; z < kVoxelsPerSide; z++) {
+                const Vector3f position =
+                    getCenterPositionFromBlockIndexAndVoxelIndex(
+                        block_size, block_index, Index3D(x, y, z));
+                auto&& voxel = block->voxels[x][y][z];
+                voxel.distance = std::clamp((position - center).norm() - radius,
+                                            -4.0f * voxel_size,
+                                            4.0f * voxel_size);
+                voxel.weight = 1.0f;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Nullptr outside the grid.
+  const BlockType* getBlockAtIndex(const Index3D& block_index) const {
+    if ((block_index.array() < 0).any() ||
+        (block_index.array() >= num_blocks_per_side).any()) {
+      return nullptr;
+    }
+    return blocks[(block_index.x() * num_blocks_per_side + block_index.y()) *
+                      num_blocks_per_side +
+                  block_index.z()]
+        .get();
+  }
+
+  const int num_blocks_per_side;
+  const float block_size;
+  std::vector<typename BlockType::Ptr> blocks;
+};
+
+// The marching cubes triangle candidates of all blocks in the grid, found as
+// MeshIntegrator::integrateBlocksCPU() does.
+template <typename BlockType>
+std::vector<marching_cubes::PerVoxelMarchingCubesResults>
+getTriangleCandidatesInGrid(const SphereTsdfBlockGrid<BlockType>& grid,
+                            float min_weight) {
+  std::vector<marching_cubes::PerVoxelMarchingCubesResults> triangle_candidates;
+  const float voxel_size = grid.block_size / BlockType::kVoxelsPerSide;
+  Index3D block_index;
+  for (block_index.x() = 0; block_index.x() < grid.num_blocks_per_side;
+       block_index.x()++) {
+    for (block_index.y() = 0; block_index.y() < grid.num_blocks_per_side;
+         block_index.y()++) {
+      for (block_index.z() = 0; block_index.z() < grid.num_blocks_per_side;
+           block_index.z()++) {
+        marching_cubes::NeighborBlockPtrs<BlockType> neighbor_blocks;
+        for (int i = 0; i < 8; i++) {
+          neighbor_blocks[i] = grid.getBlockAtIndex(
+              block_index + marching_cubes::directionFromNeighborIndex(i));
+        }
+        if (!marching_cubes::isBlockMeshable(*neighbor_blocks[0],
+                                             2.0f * voxel_size, min_weight)) {
+          continue;
+        }
+        marching_cubes::getTriangleCandidatesInBlock(
+            neighbor_blocks, block_index, grid.block_size, min_weight,
+            &triangle_candidates);
+      }
+    }
+  }
+  return triangle_candidates;
+}
+
+}  // namespace test_utils
+}  // namespace nvblox
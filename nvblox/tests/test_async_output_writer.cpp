@@ -0,0 +1,237 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#include "nvblox/io/async_output_writer.h"
+#include "nvblox/io/image_io.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/primitives/scene.h"
+
+using namespace nvblox;
+
+const std::string kOutputDirectory = "async_output_writer_test";
+
+class AsyncOutputWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::filesystem::remove_all(kOutputDirectory);
+    std::filesystem::create_directory(kOutputDirectory);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(kOutputDirectory); }
+
+  static std::string path(const std::string& filename) {
+    return kOutputDirectory + "/" + filename;
+  }
+
+  static std::string readFile(const std::string& filepath) {
+    std::ifstream file(filepath);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+};
+
+// Blocks the worker thread until released, such that the queue fills up.
+class WorkerBlocker {
+ public:
+  AsyncOutputWriter::WriteFunction writeFunction() {
+    return [this]() {
+      started_.set_value();
+      release_future_.wait();
+      return true;
+    };
+  }
+  void waitUntilStarted() { started_future_.wait(); }
+  void release() { release_.set_value(); }
+
+ private:
+  std::promise<void> started_;
+  std::shared_future<void> started_future_ = started_.get_future().share();
+  std::promise<void> release_;
+  std::shared_future<void> release_future_ = release_.get_future().share();
+};
+
+TEST_F(AsyncOutputWriterTest, WriteText) {
+  AsyncOutputWriter writer;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(writer.writeTextAsync(path(std::to_string(i) + ".txt"),
+                                      "contents " + std::to_string(i)));
+  }
+  writer.flush();
+  EXPECT_EQ(writer.queueDepth(), 0);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(readFile(path(std::to_string(i) + ".txt")),
+              "contents " + std::to_string(i));
+  }
+  const AsyncOutputWriterStats stats = writer.getStats();
+  EXPECT_EQ(stats.num_queued, 10);
+  EXPECT_EQ(stats.num_written, 10);
+  EXPECT_EQ(stats.num_failed, 0);
+  EXPECT_EQ(stats.num_dropped, 0);
+
+  // Writing into a non-existent directory fails without throwing.
+  EXPECT_TRUE(writer.writeTextAsync(path("missing/file.txt"), "contents"));
+  writer.flush();
+  EXPECT_EQ(writer.getStats().num_failed, 1);
+}
+
+TEST_F(AsyncOutputWriterTest, DestructorWritesQueuedOutputs) {
+  {
+    AsyncOutputWriter writer(2, 100);
+    for (int i = 0; i < 50; i++) {
+      writer.writeTextAsync(path(std::to_string(i) + ".txt"), "contents");
+    }
+  }
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(readFile(path(std::to_string(i) + ".txt")), "contents");
+  }
+}
+
+TEST_F(AsyncOutputWriterTest, DropNewest) {
+  AsyncOutputWriter writer(1, 1, OutputQueueFullPolicy::kDropNewest);
+  WorkerBlocker blocker;
+  EXPECT_TRUE(writer.writeAsync("blocker", blocker.writeFunction()));
+  blocker.waitUntilStarted();
+
+  // The queue holds one output, the rest is dropped.
+  std::atomic<int> num_written{0};
+  for (int i = 0; i < 3; i++) {
+    const bool queued = writer.writeAsync("output", [&num_written, i]() {
+      EXPECT_EQ(i, 0);
+      ++num_written;
+      return true;
+    });
+    EXPECT_EQ(queued, i == 0);
+  }
+  EXPECT_EQ(writer.queueDepth(), 1);
+  blocker.release();
+  writer.flush();
+  EXPECT_EQ(num_written, 1);
+  EXPECT_EQ(writer.getStats().num_dropped, 2);
+}
+
+TEST_F(AsyncOutputWriterTest, DropOldest) {
+  AsyncOutputWriter writer(1, 1, OutputQueueFullPolicy::kDropOldest);
+  WorkerBlocker blocker;
+  EXPECT_TRUE(writer.writeAsync("blocker", blocker.writeFunction()));
+  blocker.waitUntilStarted();
+
+  // Each output replaces the previous one, the last one is written.
+  std::atomic<int> num_written{0};
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(writer.writeAsync("output", [&num_written, i]() {
+      EXPECT_EQ(i, 2);
+      ++num_written;
+      return true;
+    }));
+  }
+  blocker.release();
+  writer.flush();
+  EXPECT_EQ(num_written, 1);
+  EXPECT_EQ(writer.getStats().num_dropped, 2);
+  EXPECT_EQ(writer.getStats().max_queue_depth, 1);
+}
+
+TEST_F(AsyncOutputWriterTest, BlockWhenFull) {
+  AsyncOutputWriter writer(1, 1, OutputQueueFullPolicy::kBlock);
+  WorkerBlocker blocker;
+  EXPECT_TRUE(writer.writeAsync("blocker", blocker.writeFunction()));
+  blocker.waitUntilStarted();
+  EXPECT_TRUE(writer.writeAsync("queued", []() { return true; }));
+
+  // The queue is full, so the next output waits for the blocker.
+  std::future<bool> blocked_write = std::async(std::launch::async, [&]() {
+    return writer.writeAsync("blocked", []() { return true; });
+  });
+  EXPECT_EQ(blocked_write.wait_for(std::chrono::milliseconds(100)),
+            std::future_status::timeout);
+  blocker.release();
+  EXPECT_TRUE(blocked_write.get());
+  writer.flush();
+  EXPECT_EQ(writer.getStats().num_written, 3);
+  EXPECT_EQ(writer.getStats().num_dropped, 0);
+}
+
+TEST_F(AsyncOutputWriterTest, WritePng) {
+  ColorImage image(2, 3, MemoryType::kUnified);
+  for (int row = 0; row < image.rows(); row++) {
+    for (int col = 0; col < image.cols(); col++) {
+      image(row, col) = Color(10 * row, 20 * col, 30, 255);
+    }
+  }
+  AsyncOutputWriter writer;
+  EXPECT_TRUE(writer.writePngAsync(path("image.png"), image));
+  // The image is copied, so modifying it doesn't affect the output.
+  image(0, 0) = Color(1, 2, 3, 255);
+  writer.flush();
+
+  ColorImage image_readback(MemoryType::kHost);
+  EXPECT_TRUE(io::readFromPng(path("image.png"), &image_readback));
+  ASSERT_EQ(image_readback.rows(), image.rows());
+  ASSERT_EQ(image_readback.cols(), image.cols());
+  EXPECT_EQ(image_readback(0, 0), Color(0, 0, 30, 255));
+  EXPECT_EQ(image_readback(1, 2), image(1, 2));
+}
+
+TEST_F(AsyncOutputWriterTest, MapperPlyMatchesSynchronousOutput) {
+  constexpr float kVoxelSize = 0.1f;
+  Mapper mapper(kVoxelSize, MemoryType::kUnified);
+  primitives::Scene scene;
+  scene.aabb() = AxisAlignedBoundingBox(Vector3f(-2.0f, -2.0f, 0.0f),
+                                        Vector3f(2.0f, 2.0f, 2.0f));
+  scene.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.0f, 0.0f, 0.0f), Vector3f(-1.0f, 0.0f, 0.0f)));
+  scene.generateLayerFromScene(4 * kVoxelSize, &mapper.tsdf_layer());
+  mapper.updateMesh(UpdateFullLayer::kYes);
+  mapper.updateEsdf(UpdateFullLayer::kYes);
+
+  EXPECT_TRUE(mapper.saveTsdfAsPly(path("tsdf_sync.ply")));
+  EXPECT_TRUE(mapper.saveEsdfAsPly(path("esdf_sync.ply")));
+  EXPECT_TRUE(mapper.saveMeshAsPly(path("mesh_sync.ply")));
+
+  AsyncOutputWriter writer(2);
+  EXPECT_TRUE(mapper.saveTsdfAsPlyAsync(path("tsdf_async.ply"), &writer));
+  EXPECT_TRUE(mapper.saveEsdfAsPlyAsync(path("esdf_async.ply"), &writer));
+  EXPECT_TRUE(mapper.saveMeshAsPlyAsync(path("mesh_async.ply"), &writer));
+  // The outputs are snapshots: clearing the map doesn't affect them.
+  mapper.tsdf_layer().clear();
+  mapper.esdf_layer().clear();
+  mapper.mesh_layer().clear();
+  writer.flush();
+
+  EXPECT_EQ(writer.getStats().num_written, 3);
+  for (const std::string name : {"tsdf", "esdf", "mesh"}) {
+    const std::string sync_output = readFile(path(name + "_sync.ply"));
+    EXPECT_FALSE(sync_output.empty());
+    EXPECT_EQ(readFile(path(name + "_async.ply")), sync_output);
+  }
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
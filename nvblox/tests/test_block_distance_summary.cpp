@@ -0,0 +1,263 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/map/accessors.h"
+#include "nvblox/map/block_distance_summary.h"
+#include "nvblox/map/common_names.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSizeM = 0.1f;
+constexpr float kEps = 1e-4f;
+
+// An ESDF of a ball at the origin, covering the blocks in [-4, 4)^3.
+constexpr float kBallRadiusM = 1.5f;
+constexpr int kHalfNumBlocksPerSide = 4;
+
+float ballDistance(const Vector3f& p_L) { return p_L.norm() - kBallRadiusM; }
+
+std::vector<Index3D> getBlocksInRegion() {
+  std::vector<Index3D> block_indices;
+  for (int x = -kHalfNumBlocksPerSide; x < kHalfNumBlocksPerSide; x++) {
+    for (int y = -kHalfNumBlocksPerSide; y < kHalfNumBlocksPerSide; y++) {
+      for (int z = -kHalfNumBlocksPerSide; z < kHalfNumBlocksPerSide; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  return block_indices;
+}
+
+void fillBallEsdf(EsdfLayer* layer_host) {
+  const float block_size = layer_host->block_size();
+  for (const Index3D& block_index : getBlocksInRegion()) {
+    auto block = layer_host->allocateBlockAtIndex(block_index);
+    callFunctionOnAllVoxels<EsdfVoxel>(
+        block.get(), [&](const Index3D& voxel_index, EsdfVoxel* voxel) {
+          const float distance_m =
+              ballDistance(getCenterPositionFromBlockIndexAndVoxelIndex(
+                  block_size, block_index, voxel_index));
+          const float distance_vox = distance_m / kVoxelSizeM;
+          voxel->squared_distance_vox = distance_vox * distance_vox;
+          voxel->is_inside = distance_m < 0.0f;
+          voxel->observed = true;
+        });
+  }
+}
+
+TEST(BlockDistanceSummaryTest, SummarizeEsdfBlock) {
+  EsdfLayer layer(kVoxelSizeM, MemoryType::kHost);
+  fillBallEsdf(&layer);
+
+  // Brute-force the expected summary
+  const Index3D block_index(1, 0, 0);
+  float min_distance_m = std::numeric_limits<float>::max();
+  float max_distance_m = std::numeric_limits<float>::lowest();
+  callFunctionOnAllVoxels<EsdfVoxel>(
+      *layer.getBlockAtIndex(block_index),
+      [&](const Index3D& voxel_index, const EsdfVoxel*) {
+        const float distance_m =
+            ballDistance(getCenterPositionFromBlockIndexAndVoxelIndex(
+                layer.block_size(), block_index, voxel_index));
+        min_distance_m = std::min(min_distance_m, distance_m);
+        max_distance_m = std::max(max_distance_m, distance_m);
+      });
+
+  BlockDistanceSummarizer summarizer;
+  const std::vector<BlockDistanceSummary> summaries =
+      summarizer.summarize(layer, {block_index});
+  ASSERT_EQ(summaries.size(), 1);
+  EXPECT_NEAR(summaries[0].min_distance_m, min_distance_m, kEps);
+  EXPECT_NEAR(summaries[0].max_distance_m, max_distance_m, kEps);
+  EXPECT_EQ(summaries[0].num_observed_voxels, 512);
+  EXPECT_TRUE(summaries[0].isFullyObserved());
+  EXPECT_FALSE(summaries[0].isFullyFree());
+  EXPECT_FALSE(summaries[0].isFullyOccupied());
+
+  // The block at the center of the ball is fully occupied.
+  EXPECT_TRUE(
+      summarizer.summarize(layer, {Index3D::Zero()})[0].isFullyOccupied());
+}
+
+TEST(BlockDistanceSummaryTest, SummarizeOnGpu) {
+  EsdfLayer layer_host(kVoxelSizeM, MemoryType::kHost);
+  fillBallEsdf(&layer_host);
+
+  // Copy the layer to the device
+  EsdfLayer layer_device(kVoxelSizeM, MemoryType::kDevice);
+  const std::vector<Index3D> block_indices = getBlocksInRegion();
+  for (const Index3D& block_index : block_indices) {
+    auto block_host = layer_host.getBlockAtIndex(block_index);
+    layer_device.allocateBlockAtIndex(block_index).copyFrom(block_host);
+  }
+
+  BlockDistanceSummarizer summarizer;
+  const std::vector<BlockDistanceSummary> summaries_host =
+      summarizer.summarize(layer_host, block_indices);
+  const std::vector<BlockDistanceSummary> summaries_device =
+      summarizer.summarize(layer_device, block_indices);
+  ASSERT_EQ(summaries_host.size(), summaries_device.size());
+  for (size_t i = 0; i < summaries_host.size(); i++) {
+    EXPECT_NEAR(summaries_host[i].min_distance_m,
+                summaries_device[i].min_distance_m, kEps);
+    EXPECT_NEAR(summaries_host[i].max_distance_m,
+                summaries_device[i].max_distance_m, kEps);
+    EXPECT_EQ(summaries_host[i].num_observed_voxels,
+              summaries_device[i].num_observed_voxels);
+    EXPECT_EQ(summaries_host[i].num_voxels, summaries_device[i].num_voxels);
+  }
+}
+
+TEST(BlockDistanceSummaryTest, PartiallyObservedTsdfBlock) {
+  TsdfLayer layer(kVoxelSizeM, MemoryType::kHost);
+  auto block = layer.allocateBlockAtIndex(Index3D::Zero());
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      block.get(), [&](const Index3D& voxel_index, TsdfVoxel* voxel) {
+        if (voxel_index.x() == 0) {
+          voxel->distance = 0.05f;
+          voxel->weight = 1.0f;
+        }
+      });
+
+  BlockDistanceSummarizer summarizer;
+  const BlockDistanceSummary summary =
+      summarizer.summarize(layer, {Index3D::Zero()})[0];
+  EXPECT_EQ(summary.num_observed_voxels, 64);
+  EXPECT_FALSE(summary.isFullyObserved());
+  EXPECT_FALSE(summary.isFullyUnknown());
+  EXPECT_NEAR(summary.min_distance_m, 0.05f, kEps);
+  EXPECT_NEAR(summary.max_distance_m, 0.05f, kEps);
+}
+
+TEST(BlockDistanceSummaryTest, PyramidLevels) {
+  EsdfLayer layer(kVoxelSizeM, MemoryType::kHost);
+  fillBallEsdf(&layer);
+
+  constexpr int kNumLevels = 4;
+  BlockDistanceSummaryPyramid pyramid(kNumLevels);
+  pyramid.updateBlocks(layer, layer.getAllBlockIndices());
+  EXPECT_EQ(pyramid.size(0), 512);
+  EXPECT_EQ(pyramid.size(1), 64);
+  EXPECT_EQ(pyramid.size(2), 8);
+  EXPECT_EQ(pyramid.size(3), 8);
+
+  // A level 2 node covers 4x4x4 blocks
+  const BlockDistanceSummary* node_2 =
+      pyramid.getSummary(Index3D(-1, -1, -1), 2);
+  ASSERT_NE(node_2, nullptr);
+  EXPECT_TRUE(node_2->isFullyObserved());
+  EXPECT_EQ(node_2->num_observed_voxels, 64 * 512);
+  EXPECT_LT(node_2->min_distance_m, 0.0f);
+
+  // A level 3 node covers 8x8x8 blocks, only 4x4x4 of which are allocated.
+  const BlockDistanceSummary* node_3 =
+      pyramid.getSummary(Index3D(-1, -1, -1), 3);
+  ASSERT_NE(node_3, nullptr);
+  EXPECT_FALSE(node_3->isFullyObserved());
+  EXPECT_EQ(node_3->num_observed_voxels, 64 * 512);
+  EXPECT_EQ(node_3->num_voxels, 512 * 512);
+
+  // Level 1 nodes are the min/max of their children
+  const BlockDistanceSummary* node = pyramid.getSummary(Index3D(0, 0, 0), 1);
+  ASSERT_NE(node, nullptr);
+  float min_distance_m = std::numeric_limits<float>::max();
+  for (const Index3D& offset :
+       {Index3D(0, 0, 0), Index3D(1, 0, 0), Index3D(0, 1, 0), Index3D(0, 0, 1),
+        Index3D(1, 1, 0), Index3D(1, 0, 1), Index3D(0, 1, 1),
+        Index3D(1, 1, 1)}) {
+    min_distance_m =
+        std::min(min_distance_m, pyramid.getSummary(offset)->min_distance_m);
+  }
+  EXPECT_NEAR(node->min_distance_m, min_distance_m, kEps);
+
+  // Removing a block makes its ancestors partially observed
+  pyramid.removeBlocks({Index3D(0, 0, 0)});
+  EXPECT_EQ(pyramid.getSummary(Index3D(0, 0, 0)), nullptr);
+  EXPECT_FALSE(pyramid.getSummary(Index3D(0, 0, 0), 1)->isFullyObserved());
+  EXPECT_EQ(pyramid.getSummary(Index3D(0, 0, 0), 1)->num_observed_voxels,
+            7 * 512);
+
+  // Removing all blocks empties the pyramid
+  pyramid.removeBlocks(layer.getAllBlockIndices());
+  EXPECT_TRUE(pyramid.empty());
+  for (int level = 0; level < kNumLevels; level++) {
+    EXPECT_EQ(pyramid.size(level), 0);
+  }
+}
+
+TEST(BlockDistanceSummaryTest, CollisionQueries) {
+  EsdfLayer layer(kVoxelSizeM, MemoryType::kHost);
+  fillBallEsdf(&layer);
+  BlockDistanceSummaryPyramid pyramid;
+  EXPECT_EQ(pyramid.checkSphere(Vector3f::Zero(), 0.1f),
+            CollisionStatus::kUnknown);
+  pyramid.updateBlocks(layer, layer.getAllBlockIndices());
+
+  // Far from the ball
+  constexpr float kRobotRadiusM = 0.3f;
+  std::vector<Index3D> blocks_to_check;
+  EXPECT_EQ(pyramid.checkSphere(Vector3f(2.8f, 2.8f, 2.8f), kRobotRadiusM,
+                                &blocks_to_check),
+            CollisionStatus::kFree);
+  EXPECT_TRUE(blocks_to_check.empty());
+  EXPECT_EQ(pyramid.checkCapsule(Vector3f(-2.8f, 2.8f, 2.8f),
+                                 Vector3f(2.8f, 2.8f, 2.8f), kRobotRadiusM),
+            CollisionStatus::kFree);
+
+  // Close to the surface of the ball the summaries can't decide
+  const Vector3f p_near_surface(1.7f, 0.4f, 0.4f);
+  EXPECT_EQ(pyramid.checkSphere(p_near_surface, kRobotRadiusM,
+                                &blocks_to_check),
+            CollisionStatus::kUncertain);
+  ASSERT_FALSE(blocks_to_check.empty());
+  for (const Index3D& block_index : blocks_to_check) {
+    EXPECT_EQ(block_index, getBlockIndexFromPositionInLayer(
+                               layer.block_size(), p_near_surface));
+  }
+
+  // Passing through the center of the ball
+  EXPECT_EQ(pyramid.checkCapsule(Vector3f(-2.8f, 0.1f, 0.1f),
+                                 Vector3f(2.8f, 0.1f, 0.1f), kRobotRadiusM),
+            CollisionStatus::kOccupied);
+
+  // Leaving the mapped region
+  EXPECT_EQ(pyramid.checkCapsule(Vector3f(2.8f, 2.8f, 2.8f),
+                                 Vector3f(10.0f, 2.8f, 2.8f), kRobotRadiusM),
+            CollisionStatus::kUnknown);
+
+  // A path made of free segments
+  EXPECT_EQ(pyramid.checkPath({Vector3f(-2.8f, 2.8f, 2.8f),
+                               Vector3f(2.8f, 2.8f, 2.8f),
+                               Vector3f(2.8f, -2.8f, 2.8f)},
+                              kRobotRadiusM),
+            CollisionStatus::kFree);
+
+  // Unknown after the block is removed
+  pyramid.removeBlocks({getBlockIndexFromPositionInLayer(
+      layer.block_size(), Vector3f(2.8f, 2.8f, 2.8f))});
+  EXPECT_EQ(pyramid.checkSphere(Vector3f(2.8f, 2.8f, 2.8f), kRobotRadiusM),
+            CollisionStatus::kUnknown);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
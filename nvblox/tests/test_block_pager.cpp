@@ -0,0 +1,340 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "nvblox/map/accessors.h"
+#include "nvblox/map/block_pager.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/utils/thread_pool.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSize = 0.1f;
+
+class BlockPagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::filesystem::remove_all(kStoreDirectory);
+    // A row of blocks along the x-axis.
+    for (int x = 0; x < kNumBlocks; x++) {
+      block_indices_.push_back(Index3D(x, 0, 0));
+    }
+    layer_.allocateBlocksAtIndices(block_indices_, CudaStreamOwning());
+    setTestValues(&layer_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(kStoreDirectory); }
+
+  // Encode the global voxel position in the voxel.
+  static float testValue(const Index3D& block_index,
+                         const Index3D& voxel_index) {
+    const Index3D global_index =
+        block_index * TsdfBlock::kVoxelsPerSide + voxel_index;
+    return static_cast<float>(global_index.x() * 10000 +
+                              global_index.y() * 100 + global_index.z());
+  }
+
+  static void setTestValues(TsdfLayer* layer) {
+    callFunctionOnAllVoxels<TsdfVoxel>(
+        layer, [](const Index3D& block_index, const Index3D& voxel_index,
+                  TsdfVoxel* voxel) {
+          voxel->distance = testValue(block_index, voxel_index);
+          voxel->weight = 1.0f;
+        });
+  }
+
+  static void checkTestValues(const TsdfLayer& layer) {
+    int num_checked = 0;
+    callFunctionOnAllVoxels<TsdfVoxel>(
+        layer, [&](const Index3D& block_index, const Index3D& voxel_index,
+                   const TsdfVoxel* voxel) {
+          EXPECT_EQ(voxel->distance, testValue(block_index, voxel_index));
+          EXPECT_EQ(voxel->weight, 1.0f);
+          num_checked++;
+        });
+    EXPECT_GT(num_checked, 0);
+  }
+
+  const std::string kStoreDirectory = "./block_pager_test_store";
+  static constexpr int kNumBlocks = 10;
+  std::vector<Index3D> block_indices_;
+  TsdfLayer layer_{kVoxelSize, MemoryType::kUnified};
+};
+
+TEST_F(BlockPagerTest, FileBlockStore) {
+  FileBlockStore store(kStoreDirectory);
+  const Index3D block_index(-1, 2, -3);
+  const std::vector<Byte> bytes = {1, 2, 3, 4, 5};
+
+  std::vector<Byte> bytes_read;
+  EXPECT_FALSE(store.read(block_index, &bytes_read));
+  EXPECT_TRUE(store.write(block_index, bytes));
+  EXPECT_TRUE(std::filesystem::exists(store.getBlockFilePath(block_index)));
+  EXPECT_TRUE(store.read(block_index, &bytes_read));
+  EXPECT_EQ(bytes_read, bytes);
+
+  // Overwrite
+  const std::vector<Byte> other_bytes = {6, 7};
+  EXPECT_TRUE(store.write(block_index, other_bytes));
+  EXPECT_TRUE(store.read(block_index, &bytes_read));
+  EXPECT_EQ(bytes_read, other_bytes);
+
+  EXPECT_TRUE(store.erase(block_index));
+  EXPECT_FALSE(store.erase(block_index));
+  EXPECT_FALSE(store.read(block_index, &bytes_read));
+}
+
+TEST_F(BlockPagerTest, EvictAndPageIn) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+
+  // Keep the first three blocks.
+  const float block_size = layer_.block_size();
+  const Vector3f center(0.5f * block_size, 0.5f * block_size,
+                        0.5f * block_size);
+  const float radius = 2.0f * block_size;
+  const std::vector<Index3D> evicted = pager.evictOutsideRadius(center, radius);
+  EXPECT_EQ(evicted.size(), kNumBlocks - 3);
+  EXPECT_EQ(pager.num_evicted_blocks(), kNumBlocks - 3);
+  EXPECT_EQ(pager.num_resident_blocks(), 3);
+  for (const Index3D& block_index : evicted) {
+    EXPECT_TRUE(pager.isEvicted(block_index));
+    EXPECT_FALSE(layer_.isBlockAllocated(block_index));
+    EXPECT_TRUE(std::filesystem::exists(
+        pager.block_store().getBlockFilePath(block_index)));
+  }
+  checkTestValues(layer_);
+
+  // Evicting again is a no-op.
+  EXPECT_TRUE(pager.evictOutsideRadius(center, radius).empty());
+
+  // Page a single block back in.
+  const std::vector<Index3D> paged_in = pager.pageInBlocks({Index3D(5, 0, 0)});
+  ASSERT_EQ(paged_in.size(), 1);
+  EXPECT_TRUE(layer_.isBlockAllocated(Index3D(5, 0, 0)));
+  EXPECT_FALSE(pager.isEvicted(Index3D(5, 0, 0)));
+  EXPECT_FALSE(std::filesystem::exists(
+      pager.block_store().getBlockFilePath(Index3D(5, 0, 0))));
+
+  // Page the rest in.
+  pager.pageInBlocks(block_indices_);
+  EXPECT_EQ(pager.num_evicted_blocks(), 0);
+  EXPECT_EQ(layer_.numAllocatedBlocks(), kNumBlocks);
+  checkTestValues(layer_);
+}
+
+TEST_F(BlockPagerTest, PrefetchAsync) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  pager.evictBlocks(block_indices_);
+  EXPECT_EQ(layer_.numAllocatedBlocks(), 0);
+
+  // Prefetch the blocks near the far end.
+  const float block_size = layer_.block_size();
+  const Vector3f center(9.5f * block_size, 0.5f * block_size,
+                        0.5f * block_size);
+  pager.prefetchWithinRadiusAsync(center, block_size);
+  // Nothing is installed before asking for it.
+  EXPECT_EQ(layer_.numAllocatedBlocks(), 0);
+  const std::vector<Index3D> installed = pager.installPrefetchedBlocks();
+  EXPECT_EQ(installed.size(), 2);
+  EXPECT_TRUE(layer_.isBlockAllocated(Index3D(9, 0, 0)));
+  EXPECT_TRUE(layer_.isBlockAllocated(Index3D(8, 0, 0)));
+  EXPECT_EQ(pager.num_evicted_blocks(), kNumBlocks - 2);
+  checkTestValues(layer_);
+
+  // Installing again doesn't do anything.
+  EXPECT_TRUE(pager.installPrefetchedBlocks().empty());
+
+  // Prefetched blocks are also used for synchronous page-ins. Evicting a
+  // prefetched block discards the prefetched data.
+  pager.prefetchBlocksAsync({Index3D(0, 0, 0), Index3D(1, 0, 0)});
+  pager.evictBlocks({Index3D(9, 0, 0)});
+  EXPECT_EQ(pager.pageInBlocks({Index3D(0, 0, 0)}).size(), 1);
+  EXPECT_EQ(pager.installPrefetchedBlocks().size(), 1);
+  EXPECT_TRUE(layer_.isBlockAllocated(Index3D(1, 0, 0)));
+  EXPECT_FALSE(layer_.isBlockAllocated(Index3D(9, 0, 0)));
+  checkTestValues(layer_);
+}
+
+TEST_F(BlockPagerTest, LeastRecentlyUsed) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  // Touch the blocks in order, block 0 being the least recently used.
+  for (const Index3D& block_index : block_indices_) {
+    pager.touchBlocks({block_index});
+  }
+  // Touching block 0 again makes block 1 the least recently used.
+  pager.touchBlocks({Index3D(0, 0, 0)});
+
+  const std::vector<Index3D> evicted = pager.evictLeastRecentlyUsed(7);
+  EXPECT_EQ(evicted.size(), 3);
+  EXPECT_EQ(layer_.numAllocatedBlocks(), 7);
+  EXPECT_TRUE(layer_.isBlockAllocated(Index3D(0, 0, 0)));
+  for (int x = 1; x <= 3; x++) {
+    EXPECT_TRUE(pager.isEvicted(Index3D(x, 0, 0)));
+  }
+  // Already within budget
+  EXPECT_TRUE(pager.evictLeastRecentlyUsed(7).empty());
+}
+
+TEST_F(BlockPagerTest, ReallocatedBlockIsMerged) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  const Index3D block_index(4, 0, 0);
+  pager.evictBlocks({block_index});
+
+  // The block gets re-allocated (ie. by integration) while evicted and a
+  // single voxel is observed.
+  auto block = layer_.allocateBlockAtIndex(block_index);
+  block->voxels[0][0][0].distance = -1.0f;
+  block->voxels[0][0][0].weight = 1.0f;
+
+  // The stored copy is merged into the resident block.
+  EXPECT_EQ(pager.pageInBlocks({block_index}).size(), 1);
+  EXPECT_FALSE(pager.isEvicted(block_index));
+  const TsdfVoxel& observed_voxel =
+      layer_.getBlockAtIndex(block_index)->voxels[0][0][0];
+  EXPECT_EQ(observed_voxel.weight, 2.0f);
+  EXPECT_EQ(observed_voxel.distance,
+            0.5f * (testValue(block_index, Index3D::Zero()) - 1.0f));
+  const TsdfVoxel& unobserved_voxel =
+      layer_.getBlockAtIndex(block_index)->voxels[1][0][0];
+  EXPECT_EQ(unobserved_voxel.weight, 1.0f);
+  EXPECT_EQ(unobserved_voxel.distance,
+            testValue(block_index, Index3D(1, 0, 0)));
+}
+
+TEST_F(BlockPagerTest, MergedWeightIsClamped) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  pager.max_weight(1.5f);
+  const Index3D block_index(4, 0, 0);
+  pager.evictBlocks({block_index});
+
+  auto block = layer_.allocateBlockAtIndex(block_index);
+  block->voxels[0][0][0].distance = -1.0f;
+  block->voxels[0][0][0].weight = 1.0f;
+
+  // The distance is the weighted average, the weight stays within the limit.
+  EXPECT_EQ(pager.pageInBlocks({block_index}).size(), 1);
+  const TsdfVoxel& observed_voxel =
+      layer_.getBlockAtIndex(block_index)->voxels[0][0][0];
+  EXPECT_EQ(observed_voxel.weight, 1.5f);
+  EXPECT_EQ(observed_voxel.distance,
+            0.5f * (testValue(block_index, Index3D::Zero()) - 1.0f));
+}
+
+TEST_F(BlockPagerTest, PrefetchOnThreadPool) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  auto thread_pool = std::make_shared<ThreadPool>(1);
+  pager.thread_pool(thread_pool);
+  pager.evictBlocks(block_indices_);
+
+  pager.prefetchBlocksAsync(block_indices_);
+  EXPECT_EQ(pager.installPrefetchedBlocks().size(), kNumBlocks);
+  EXPECT_EQ(thread_pool->getStats().num_tasks_submitted, 1);
+  checkTestValues(layer_);
+}
+
+TEST_F(BlockPagerTest, DiscardEvictedBlocks) {
+  TsdfBlockPager pager(&layer_, kStoreDirectory);
+  pager.evictBlocks(block_indices_);
+  pager.prefetchBlocksAsync({Index3D(0, 0, 0)});
+  pager.discardEvictedBlocks();
+  EXPECT_EQ(pager.num_evicted_blocks(), 0);
+  EXPECT_TRUE(pager.installPrefetchedBlocks().empty());
+  for (const Index3D& block_index : block_indices_) {
+    EXPECT_FALSE(std::filesystem::exists(
+        pager.block_store().getBlockFilePath(block_index)));
+  }
+}
+
+TEST_F(BlockPagerTest, Mapper) {
+  Mapper mapper(kVoxelSize, MemoryType::kUnified);
+  mapper.tsdf_layer().copyFrom(layer_);
+  mapper.color_layer().allocateBlocksAtIndices(block_indices_,
+                                               CudaStreamOwning());
+  EXPECT_FALSE(mapper.block_paging_enabled());
+  mapper.enableBlockPaging(kStoreDirectory);
+  EXPECT_TRUE(mapper.block_paging_enabled());
+
+  // Evict all but the first block.
+  const float block_size = layer_.block_size();
+  const Vector3f center(0.5f * block_size, 0.5f * block_size,
+                        0.5f * block_size);
+  const std::vector<Index3D> evicted =
+      mapper.evictOutsideRadius(center, 0.25f * block_size);
+  EXPECT_EQ(evicted.size(), kNumBlocks - 1);
+  EXPECT_EQ(mapper.num_evicted_blocks(), kNumBlocks - 1);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), 1);
+  EXPECT_EQ(mapper.color_layer().numAllocatedBlocks(), 1);
+
+  // Return to the far end.
+  const Vector3f far_center(9.5f * block_size, 0.5f * block_size,
+                            0.5f * block_size);
+  mapper.prefetchInsideRadiusAsync(far_center, block_size);
+  EXPECT_EQ(mapper.pageInPrefetchedBlocks().size(), 2);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), 3);
+  EXPECT_EQ(mapper.color_layer().numAllocatedBlocks(), 3);
+
+  // Only the blocks paged into the TSDF layer are paged into the color layer,
+  // even if more color blocks were prefetched.
+  mapper.prefetchInsideRadiusAsync(center, 100.0f);
+  EXPECT_EQ(mapper.pageInInsideRadius(far_center, 2.0f * block_size).size(),
+            1);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), 4);
+  EXPECT_EQ(mapper.color_layer().numAllocatedBlocks(), 4);
+
+  // Moving the block store pages everything in.
+  mapper.enableBlockPaging(kStoreDirectory + "_moved");
+  EXPECT_EQ(mapper.num_evicted_blocks(), 0);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), kNumBlocks);
+  EXPECT_EQ(mapper.color_layer().numAllocatedBlocks(), kNumBlocks);
+  checkTestValues(mapper.tsdf_layer());
+  std::filesystem::remove_all(kStoreDirectory + "_moved");
+
+  // The mesh is regenerated for the paged in blocks.
+  mapper.updateMesh();
+}
+
+TEST_F(BlockPagerTest, MapperClampsMergedWeights) {
+  Mapper mapper(kVoxelSize, MemoryType::kUnified);
+  mapper.tsdf_layer().copyFrom(layer_);
+  mapper.tsdf_integrator().max_weight(1.5f);
+  mapper.enableBlockPaging(kStoreDirectory);
+  const float block_size = layer_.block_size();
+  const Vector3f center(0.5f * block_size, 0.5f * block_size,
+                        0.5f * block_size);
+  mapper.evictOutsideRadius(center, 0.25f * block_size);
+
+  // Re-allocate an evicted block, as integration would.
+  const Index3D block_index(4, 0, 0);
+  auto block = mapper.tsdf_layer().allocateBlockAtIndex(block_index);
+  block->voxels[0][0][0].weight = 1.0f;
+
+  mapper.pageInInsideRadius(center, 100.0f);
+  EXPECT_EQ(mapper.num_evicted_blocks(), 0);
+  EXPECT_EQ(
+      mapper.tsdf_layer().getBlockAtIndex(block_index)->voxels[0][0][0].weight,
+      1.5f);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -104,6 +104,40 @@ TEST(BoundingSpheresTest, BlocksOutside) {
   EXPECT_EQ(result.size(), 0);
 }
 
+TEST(BoundingSpheresTest, LocalQueryMatchesScan) {
+  // A 13x13x13 cube of blocks.
+  std::vector<Index3D> block_indices;
+  for (int x = -6; x <= 6; x++) {
+    for (int y = -6; y <= 6; y++) {
+      for (int z = -6; z <= 6; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  const Index3DSet block_set(block_indices.begin(), block_indices.end());
+
+  constexpr float kBlockSize = 0.5f;
+  const Vector3f center(0.3f, -1.2f, 2.7f);
+  // Small radii enumerate the sphere, large ones scan the set.
+  for (const float radius : {0.1f, 0.6f, 1.7f, 8.0f}) {
+    const std::vector<Index3D> expected =
+        getBlocksWithinRadius(block_indices, kBlockSize, center, radius);
+    const std::vector<Index3D> result =
+        getBlocksWithinRadius(block_set, kBlockSize, center, radius);
+    EXPECT_EQ(result.size(), expected.size());
+    for (const Index3D& idx : expected) {
+      EXPECT_TRUE(isInResult(result, idx));
+    }
+  }
+
+  // Unallocated blocks are returned too.
+  const Vector3f far_center(100.2f, 0.2f, 0.2f);
+  EXPECT_EQ(getBlockIndicesWithinRadius(kBlockSize, far_center, 0.1f).size(),
+            1);
+  EXPECT_EQ(getNumBlocksInBoundingCube(1.0f, Vector3f(0.5f, 0.5f, 0.5f), 0.6f),
+            27);
+}
+
 int main(int argc, char** argv) {
   FLAGS_alsologtostderr = true;
   google::InitGoogleLogging(argv[0]);
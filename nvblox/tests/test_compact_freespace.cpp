@@ -0,0 +1,359 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/integrators/esdf_integrator.h"
+#include "nvblox/integrators/freespace_integrator.h"
+#include "nvblox/integrators/projective_tsdf_integrator.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/primitives/scene.h"
+#include "nvblox/serialization/layer_serializer_gpu.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSizeM = 0.05f;
+constexpr Time kTimeStepMs{100};
+// Unix time in ms, far outside of the range of a 32 bit offset to zero.
+constexpr Time kStartTimeMs{1700000000000};
+
+bool voxelsEqual(const FreespaceVoxel& voxel_1,
+                 const FreespaceVoxel& voxel_2) {
+  return voxel_1.last_occupied_timestamp_ms ==
+             voxel_2.last_occupied_timestamp_ms &&
+         voxel_1.consecutive_occupancy_duration_ms ==
+             voxel_2.consecutive_occupancy_duration_ms &&
+         voxel_1.is_high_confidence_freespace ==
+             voxel_2.is_high_confidence_freespace;
+}
+
+class CompactFreespaceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scene_.aabb() = AxisAlignedBoundingBox(Vector3f(-3.0f, -3.0f, -1.0f),
+                                           Vector3f(3.0f, 3.0f, 3.0f));
+    scene_.addGroundLevel(-0.5f);
+    scene_.addCeiling(2.5f);
+    scene_.addPlaneBoundaries(-2.5f, 2.5f, -2.5f, 2.5f);
+    scene_.addPrimitive(std::make_unique<primitives::Sphere>(
+        Vector3f(1.5f, 0.0f, 0.5f), 0.5f));
+    // Camera at the origin looking along the x-axis.
+    T_S_C_ = Transform::Identity();
+    T_S_C_.prerotate(Eigen::Quaternionf(0.5, 0.5, 0.5, 0.5));
+    scene_.generateDepthImageFromScene(camera_, T_S_C_, 10.0f, &depth_image_);
+
+    ProjectiveTsdfIntegrator tsdf_integrator;
+    tsdf_integrator.integrateFrame(depth_image_, T_S_C_, camera_,
+                                   &tsdf_layer_, &updated_blocks_);
+
+    for (FreespaceIntegrator* integrator :
+         {&freespace_integrator_, &compact_freespace_integrator_}) {
+      integrator->max_unobserved_to_keep_consecutive_occupancy_ms(
+          2 * kTimeStepMs);
+      integrator->min_duration_since_occupied_for_freespace_ms(5 *
+                                                               kTimeStepMs);
+      integrator->min_consecutive_occupancy_duration_for_reset_ms(
+          10 * kTimeStepMs);
+      integrator->check_neighborhood(true);
+    }
+  }
+
+  // Update the full and the compact freespace layer at the given time.
+  void updateFreespaceLayers(Time update_time_ms) {
+    freespace_integrator_.updateFreespaceLayer(
+        updated_blocks_, update_time_ms, tsdf_layer_, &freespace_layer_);
+    compact_freespace_integrator_.updateFreespaceLayer(
+        updated_blocks_, update_time_ms, tsdf_layer_,
+        &compact_freespace_layer_);
+  }
+
+  // Check that the compact freespace layer unpacks to the full one. In the
+  // compact layer, timestamps before min_timestamp_ms are clamped to it.
+  void expectLayersEqual(Time min_timestamp_ms = Time(0)) {
+    ASSERT_EQ(freespace_layer_.numAllocatedBlocks(),
+              compact_freespace_layer_.numAllocatedBlocks());
+    int num_initialized_voxels = 0;
+    int num_high_confidence_voxels = 0;
+    int num_mismatches = 0;
+    for (const Index3D& block_index : freespace_layer_.getAllBlockIndices()) {
+      const FreespaceBlock::ConstPtr block =
+          freespace_layer_.getBlockAtIndex(block_index);
+      const CompactFreespaceBlock::ConstPtr compact_block =
+          compact_freespace_layer_.getBlockAtIndex(block_index);
+      ASSERT_TRUE(compact_block);
+      for (int x = 0; x < FreespaceBlock::kVoxelsPerSide; x++) {
+        for (int y = 0; y < FreespaceBlock::kVoxelsPerSide; y++) {
+          for (int z = 0; z < FreespaceBlock::kVoxelsPerSide; z++) {
+            const FreespaceVoxel& voxel = block->voxels[x][y][z];
+            FreespaceVoxel unpacked_voxel;
+            compact_block->voxels[x][y][z].toFreespaceVoxel(
+                compact_block->time_base_ms, &unpacked_voxel);
+
+            const bool is_initialized =
+                !(voxel.last_occupied_timestamp_ms == Time(0));
+            FreespaceVoxel expected_voxel = voxel;
+            if (is_initialized &&
+                voxel.last_occupied_timestamp_ms < min_timestamp_ms) {
+              expected_voxel.last_occupied_timestamp_ms = min_timestamp_ms;
+            }
+            num_mismatches += !voxelsEqual(unpacked_voxel, expected_voxel);
+            num_initialized_voxels += is_initialized;
+            num_high_confidence_voxels += voxel.is_high_confidence_freespace;
+          }
+        }
+      }
+    }
+    EXPECT_GT(num_initialized_voxels, 0);
+    EXPECT_GT(num_high_confidence_voxels, 0);
+    EXPECT_EQ(num_mismatches, 0);
+  }
+
+  primitives::Scene scene_;
+  Camera camera_ = Camera(300, 300, 320, 240, 640, 480);
+  Transform T_S_C_;
+  DepthImage depth_image_ = DepthImage(480, 640, MemoryType::kUnified);
+
+  TsdfLayer tsdf_layer_ = TsdfLayer(kVoxelSizeM, MemoryType::kUnified);
+  std::vector<Index3D> updated_blocks_;
+
+  FreespaceIntegrator freespace_integrator_;
+  FreespaceIntegrator compact_freespace_integrator_;
+  FreespaceLayer freespace_layer_ =
+      FreespaceLayer(kVoxelSizeM, MemoryType::kUnified);
+  CompactFreespaceLayer compact_freespace_layer_ =
+      CompactFreespaceLayer(kVoxelSizeM, MemoryType::kUnified);
+};
+
+TEST(CompactFreespaceVoxelTest, Size) {
+  EXPECT_EQ(sizeof(CompactFreespaceVoxel), 8);
+  EXPECT_EQ(3 * sizeof(CompactFreespaceVoxel), sizeof(FreespaceVoxel));
+  EXPECT_EQ(3 * sizeof(CompactFreespaceBlock::voxels),
+            sizeof(FreespaceBlock::voxels));
+  // Only the compact blocks carry a header, the other blocks are unchanged.
+  EXPECT_EQ(sizeof(CompactFreespaceBlock),
+            sizeof(CompactFreespaceBlock::voxels) + sizeof(Time));
+  EXPECT_EQ(sizeof(FreespaceBlock), sizeof(FreespaceBlock::voxels));
+  EXPECT_EQ(sizeof(TsdfBlock), sizeof(TsdfBlock::voxels));
+}
+
+TEST(CompactFreespaceVoxelTest, PackUnpack) {
+  const Time time_base_ms = kStartTimeMs;
+
+  // A default voxel is uninitialized, as is a default FreespaceVoxel.
+  FreespaceVoxel unpacked_voxel;
+  CompactFreespaceVoxel().toFreespaceVoxel(time_base_ms, &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms, Time(0));
+  EXPECT_EQ(unpacked_voxel.consecutive_occupancy_duration_ms, Time(0));
+  EXPECT_FALSE(unpacked_voxel.is_high_confidence_freespace);
+
+  // Round trip.
+  FreespaceVoxel voxel;
+  voxel.last_occupied_timestamp_ms = time_base_ms + Time(123456);
+  voxel.consecutive_occupancy_duration_ms = Time(789);
+  voxel.is_high_confidence_freespace = true;
+  CompactFreespaceVoxel compact_voxel;
+  compact_voxel.fromFreespaceVoxel(voxel, time_base_ms);
+  EXPECT_TRUE(compact_voxel.is_high_confidence_freespace());
+  compact_voxel.toFreespaceVoxel(time_base_ms, &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms,
+            voxel.last_occupied_timestamp_ms);
+  EXPECT_EQ(unpacked_voxel.consecutive_occupancy_duration_ms,
+            voxel.consecutive_occupancy_duration_ms);
+  EXPECT_TRUE(unpacked_voxel.is_high_confidence_freespace);
+
+  // Durations saturate.
+  voxel.consecutive_occupancy_duration_ms =
+      Time(CompactFreespaceVoxel::kMaxDurationMs + 1000);
+  voxel.is_high_confidence_freespace = false;
+  compact_voxel.fromFreespaceVoxel(voxel, time_base_ms);
+  compact_voxel.toFreespaceVoxel(time_base_ms, &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.consecutive_occupancy_duration_ms,
+            Time(CompactFreespaceVoxel::kMaxDurationMs));
+  EXPECT_FALSE(unpacked_voxel.is_high_confidence_freespace);
+
+  // Timestamps are clamped to the representable range.
+  voxel.last_occupied_timestamp_ms = time_base_ms - Time(1000);
+  compact_voxel.fromFreespaceVoxel(voxel, time_base_ms);
+  compact_voxel.toFreespaceVoxel(time_base_ms, &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms, time_base_ms);
+  voxel.last_occupied_timestamp_ms =
+      time_base_ms + Time(CompactFreespaceVoxel::kMaxTimeOffsetMs + 1000);
+  compact_voxel.fromFreespaceVoxel(voxel, time_base_ms);
+  compact_voxel.toFreespaceVoxel(time_base_ms, &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms,
+            time_base_ms + Time(CompactFreespaceVoxel::kMaxTimeOffsetMs));
+
+  // Rebasing keeps the timestamp if it is representable.
+  voxel.last_occupied_timestamp_ms = time_base_ms + Time(5000);
+  compact_voxel.fromFreespaceVoxel(voxel, time_base_ms);
+  compact_voxel.rebase(time_base_ms, time_base_ms + Time(2000));
+  compact_voxel.toFreespaceVoxel(time_base_ms + Time(2000), &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms,
+            voxel.last_occupied_timestamp_ms);
+  compact_voxel.rebase(time_base_ms + Time(2000), time_base_ms + Time(9000));
+  compact_voxel.toFreespaceVoxel(time_base_ms + Time(9000), &unpacked_voxel);
+  EXPECT_EQ(unpacked_voxel.last_occupied_timestamp_ms,
+            time_base_ms + Time(9000));
+}
+
+TEST_F(CompactFreespaceTest, UpdateMatchesFullLayer) {
+  ASSERT_GT(updated_blocks_.size(), 0);
+  Time current_time_ms = kStartTimeMs;
+  for (int i = 0; i < 8; i++) {
+    updateFreespaceLayers(current_time_ms);
+    current_time_ms += kTimeStepMs;
+  }
+  expectLayersEqual();
+
+  // The first update moved the time bases to the start time.
+  for (const Index3D& block_index : updated_blocks_) {
+    const Time time_base_ms =
+        compact_freespace_layer_.getBlockAtIndex(block_index)->time_base_ms;
+    EXPECT_LE(time_base_ms, kStartTimeMs);
+    EXPECT_GE(time_base_ms + Time(CompactFreespaceVoxel::kMaxTimeOffsetMs),
+              current_time_ms);
+  }
+
+  // Jumping beyond the range of the offsets rebases the blocks. Timestamps
+  // that are too old to be represented are clamped.
+  current_time_ms += Time(CompactFreespaceVoxel::kMaxTimeOffsetMs);
+  updateFreespaceLayers(current_time_ms);
+  Time min_time_base_ms = current_time_ms;
+  for (const Index3D& block_index : updated_blocks_) {
+    const Time time_base_ms =
+        compact_freespace_layer_.getBlockAtIndex(block_index)->time_base_ms;
+    EXPECT_LE(time_base_ms, current_time_ms);
+    min_time_base_ms = std::min(min_time_base_ms, time_base_ms);
+  }
+  expectLayersEqual(min_time_base_ms);
+}
+
+TEST_F(CompactFreespaceTest, Esdf) {
+  Time current_time_ms = kStartTimeMs;
+  for (int i = 0; i < 8; i++) {
+    updateFreespaceLayers(current_time_ms);
+    current_time_ms += kTimeStepMs;
+  }
+
+  EsdfIntegrator esdf_integrator;
+  EsdfLayer esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  EsdfLayer compact_esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  const std::vector<Index3D> block_indices = tsdf_layer_.getAllBlockIndices();
+  esdf_integrator.integrateBlocks(tsdf_layer_, freespace_layer_, block_indices,
+                                  &esdf_layer);
+  esdf_integrator.integrateBlocks(tsdf_layer_, compact_freespace_layer_,
+                                  block_indices, &compact_esdf_layer);
+  ASSERT_EQ(esdf_layer.numAllocatedBlocks(),
+            compact_esdf_layer.numAllocatedBlocks());
+
+  int num_sites = 0;
+  for (const Index3D& block_index : esdf_layer.getAllBlockIndices()) {
+    const EsdfBlock::ConstPtr block = esdf_layer.getBlockAtIndex(block_index);
+    const EsdfBlock::ConstPtr compact_block =
+        compact_esdf_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(compact_block);
+    for (int x = 0; x < EsdfBlock::kVoxelsPerSide; x++) {
+      for (int y = 0; y < EsdfBlock::kVoxelsPerSide; y++) {
+        for (int z = 0; z < EsdfBlock::kVoxelsPerSide; z++) {
+          num_sites += block->voxels[x][y][z].is_site;
+          EXPECT_EQ(block->voxels[x][y][z].is_site,
+                    compact_block->voxels[x][y][z].is_site);
+          EXPECT_EQ(block->voxels[x][y][z].squared_distance_vox,
+                    compact_block->voxels[x][y][z].squared_distance_vox);
+        }
+      }
+    }
+  }
+  EXPECT_GT(num_sites, 0);
+}
+
+TEST_F(CompactFreespaceTest, Serialization) {
+  Time current_time_ms = kStartTimeMs;
+  for (int i = 0; i < 8; i++) {
+    updateFreespaceLayers(current_time_ms);
+    current_time_ms += kTimeStepMs;
+  }
+
+  CudaStreamOwning cuda_stream;
+  FreespaceLayerSerializerGpu serializer;
+  CompactFreespaceLayerSerializerGpu compact_serializer;
+  const std::shared_ptr<const SerializedFreespaceLayer> serialized =
+      serializer.serialize(freespace_layer_, updated_blocks_, cuda_stream);
+  const std::shared_ptr<const SerializedFreespaceLayer> compact_serialized =
+      compact_serializer.serialize(compact_freespace_layer_, updated_blocks_,
+                                   cuda_stream);
+
+  EXPECT_EQ(serialized->block_indices, compact_serialized->block_indices);
+  ASSERT_EQ(serialized->block_offsets.size(),
+            compact_serialized->block_offsets.size());
+  for (size_t i = 0; i < serialized->block_offsets.size(); i++) {
+    EXPECT_EQ(serialized->block_offsets[i],
+              compact_serialized->block_offsets[i]);
+  }
+  ASSERT_EQ(serialized->voxels.size(), compact_serialized->voxels.size());
+  ASSERT_GT(serialized->voxels.size(), 0);
+  int num_mismatches = 0;
+  for (size_t i = 0; i < serialized->voxels.size(); i++) {
+    num_mismatches +=
+        !voxelsEqual(serialized->voxels[i], compact_serialized->voxels[i]);
+  }
+  EXPECT_EQ(num_mismatches, 0);
+}
+
+TEST_F(CompactFreespaceTest, Mapper) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kDevice,
+                ProjectiveLayerType::kTsdfWithCompactFreespace);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  mapper.updateFreespace(kStartTimeMs);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  mapper.updateFreespace(kStartTimeMs + kTimeStepMs);
+  EXPECT_GT(mapper.tsdf_layer().numAllocatedBlocks(), 0);
+  EXPECT_EQ(mapper.compact_freespace_layer().numAllocatedBlocks(),
+            mapper.tsdf_layer().numAllocatedBlocks());
+  EXPECT_EQ(mapper.freespace_layer().numAllocatedBlocks(), 0);
+
+  mapper.updateEsdf();
+  EXPECT_GT(mapper.esdf_layer().numAllocatedBlocks(), 0);
+
+  // The compact layer holds a third of the memory of a full one, and the full
+  // layer it replaces doesn't preallocate blocks.
+  const MemoryReport report = mapper.getMemoryReport();
+  for (const MemoryReportItem& item : report.items()) {
+    if (item.name == "compact_freespace_layer/blocks") {
+      EXPECT_EQ(item.usage.device_bytes,
+                item.count * sizeof(CompactFreespaceBlock));
+    }
+    if (item.name == "freespace_layer/memory_pool") {
+      EXPECT_EQ(item.count, 0);
+    }
+  }
+  // Mappers which don't use the compact layer don't create it.
+  EXPECT_FALSE(Mapper(kVoxelSizeM, MemoryType::kDevice,
+                      ProjectiveLayerType::kTsdfWithFreespace)
+                   .layers()
+                   .exists<CompactFreespaceLayer>());
+
+  mapper.clearOutsideRadius(Vector3f::Zero(), 2.0f);
+  EXPECT_EQ(mapper.compact_freespace_layer().numAllocatedBlocks(),
+            mapper.tsdf_layer().numAllocatedBlocks());
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
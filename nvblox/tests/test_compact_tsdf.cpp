@@ -0,0 +1,287 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "nvblox/core/float16.h"
+#include "nvblox/integrators/esdf_integrator.h"
+#include "nvblox/integrators/projective_tsdf_integrator.h"
+#include "nvblox/integrators/tsdf_decay_integrator.h"
+#include "nvblox/interpolation/interpolation_3d.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/mesh/mesh_integrator.h"
+#include "nvblox/primitives/scene.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSizeM = 0.05f;
+
+// Half precision has 11 significant bits. For distances within a truncation
+// band of a few voxels the conversion error is far below a millimeter.
+constexpr float kMaxDistanceErrorM = 1e-3f;
+
+class CompactTsdfTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scene_.aabb() = AxisAlignedBoundingBox(Vector3f(-3.0f, -3.0f, -1.0f),
+                                           Vector3f(3.0f, 3.0f, 3.0f));
+    scene_.addGroundLevel(-0.5f);
+    scene_.addCeiling(2.5f);
+    scene_.addPlaneBoundaries(-2.5f, 2.5f, -2.5f, 2.5f);
+    scene_.addPrimitive(std::make_unique<primitives::Sphere>(
+        Vector3f(1.5f, 0.0f, 0.5f), 0.5f));
+    // Camera at the origin looking along the x-axis.
+    T_S_C_ = Transform::Identity();
+    T_S_C_.prerotate(Eigen::Quaternionf(0.5, 0.5, 0.5, 0.5));
+    scene_.generateDepthImageFromScene(camera_, T_S_C_, 10.0f, &depth_image_);
+  }
+
+  primitives::Scene scene_;
+  Camera camera_ = Camera(300, 300, 320, 240, 640, 480);
+  Transform T_S_C_;
+  DepthImage depth_image_ = DepthImage(480, 640, MemoryType::kUnified);
+};
+
+TEST(Float16Test, Conversion) {
+  // Exactly representable values survive the round trip.
+  for (const float value : {0.0f, -0.0f, 1.0f, -2.5f, 0.125f, 1024.0f,
+                            65504.0f, std::pow(2.0f, -24.0f)}) {
+    EXPECT_EQ(static_cast<float>(Float16(value)), value);
+  }
+  // Others are rounded to 11 significant bits.
+  for (float value = -10.0f; value < 10.0f; value += 0.0137f) {
+    const float converted = Float16(value);
+    EXPECT_LE(std::abs(converted - value), std::abs(value) * 4.9e-4f + 1e-7f);
+  }
+  // Out of range values become infinite.
+  EXPECT_TRUE(std::isinf(static_cast<float>(Float16(1e6f))));
+  EXPECT_TRUE(std::isinf(
+      static_cast<float>(Float16(std::numeric_limits<float>::infinity()))));
+  EXPECT_TRUE(std::isnan(
+      static_cast<float>(Float16(std::numeric_limits<float>::quiet_NaN()))));
+  // Known bit patterns.
+  EXPECT_EQ(Float16(1.0f).bits(), 0x3C00);
+  EXPECT_EQ(Float16(-2.0f).bits(), 0xC000);
+}
+
+TEST(CompactTsdfVoxelTest, Size) {
+  EXPECT_EQ(sizeof(CompactTsdfVoxel), 4);
+  EXPECT_EQ(2 * sizeof(CompactTsdfVoxel), sizeof(TsdfVoxel));
+  EXPECT_EQ(2 * sizeof(CompactTsdfBlock::voxels), sizeof(TsdfBlock::voxels));
+}
+
+TEST_F(CompactTsdfTest, IntegrateMatchesFullPrecision) {
+  TsdfLayer tsdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  CompactTsdfLayer compact_layer(kVoxelSizeM, MemoryType::kUnified);
+
+  ProjectiveTsdfIntegrator integrator;
+  std::vector<Index3D> updated_blocks;
+  std::vector<Index3D> compact_updated_blocks;
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &tsdf_layer,
+                            &updated_blocks);
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &compact_layer,
+                            &compact_updated_blocks);
+  EXPECT_EQ(updated_blocks.size(), compact_updated_blocks.size());
+  ASSERT_EQ(tsdf_layer.numAllocatedBlocks(),
+            compact_layer.numAllocatedBlocks());
+  EXPECT_GT(tsdf_layer.numAllocatedBlocks(), 0);
+
+  // Every voxel matches up to the half precision rounding.
+  int num_observed_voxels = 0;
+  float max_distance_error_m = 0.0f;
+  for (const Index3D& block_index : tsdf_layer.getAllBlockIndices()) {
+    const TsdfBlock::ConstPtr block = tsdf_layer.getBlockAtIndex(block_index);
+    const CompactTsdfBlock::ConstPtr compact_block =
+        compact_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(compact_block);
+    for (int x = 0; x < TsdfBlock::kVoxelsPerSide; x++) {
+      for (int y = 0; y < TsdfBlock::kVoxelsPerSide; y++) {
+        for (int z = 0; z < TsdfBlock::kVoxelsPerSide; z++) {
+          const TsdfVoxel& voxel = block->voxels[x][y][z];
+          const CompactTsdfVoxel& compact_voxel =
+              compact_block->voxels[x][y][z];
+          EXPECT_NEAR(compact_voxel.weight, voxel.weight,
+                      std::abs(voxel.weight) * 1e-3f);
+          if (voxel.weight > 0.0f) {
+            num_observed_voxels++;
+            max_distance_error_m =
+                std::max(max_distance_error_m,
+                         std::abs(compact_voxel.distance - voxel.distance));
+          }
+        }
+      }
+    }
+  }
+  LOG(INFO) << "Compared " << num_observed_voxels
+            << " observed voxels. Max distance error: " << max_distance_error_m
+            << "m";
+  EXPECT_GT(num_observed_voxels, 0);
+  EXPECT_LT(max_distance_error_m, kMaxDistanceErrorM);
+
+  // Interpolation works on both layers.
+  const Vector3f sphere_surface_point(1.0f, 0.0f, 0.5f);
+  float distance = 0.0f;
+  float compact_distance = 0.0f;
+  ASSERT_TRUE(interpolation::interpolateOnCPU(sphere_surface_point,
+                                              tsdf_layer, &distance));
+  ASSERT_TRUE(interpolation::interpolateOnCPU(
+      sphere_surface_point, compact_layer, &compact_distance));
+  EXPECT_NEAR(distance, compact_distance, kMaxDistanceErrorM);
+}
+
+TEST_F(CompactTsdfTest, MeshAndEsdf) {
+  TsdfLayer tsdf_layer(kVoxelSizeM, MemoryType::kDevice);
+  CompactTsdfLayer compact_layer(kVoxelSizeM, MemoryType::kDevice);
+  ProjectiveTsdfIntegrator integrator;
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &tsdf_layer);
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &compact_layer);
+
+  // Meshes have (nearly) the same number of vertices. Rounding may flip the
+  // sign of distances very close to zero.
+  MeshIntegrator mesh_integrator;
+  MeshLayer mesh_layer(tsdf_layer.block_size(), MemoryType::kUnified);
+  MeshLayer compact_mesh_layer(tsdf_layer.block_size(), MemoryType::kUnified);
+  EXPECT_TRUE(mesh_integrator.integrateBlocksGPU(
+      tsdf_layer, tsdf_layer.getAllBlockIndices(), &mesh_layer));
+  EXPECT_TRUE(mesh_integrator.integrateBlocksGPU(
+      compact_layer, compact_layer.getAllBlockIndices(), &compact_mesh_layer));
+  size_t num_vertices = 0;
+  size_t compact_num_vertices = 0;
+  for (const Index3D& block_index : mesh_layer.getAllBlockIndices()) {
+    num_vertices += mesh_layer.getBlockAtIndex(block_index)->vertices.size();
+  }
+  for (const Index3D& block_index : compact_mesh_layer.getAllBlockIndices()) {
+    compact_num_vertices +=
+        compact_mesh_layer.getBlockAtIndex(block_index)->vertices.size();
+  }
+  EXPECT_GT(num_vertices, 0);
+  EXPECT_NEAR(static_cast<float>(compact_num_vertices),
+              static_cast<float>(num_vertices), 0.01f * num_vertices);
+
+  // The ESDFs agree.
+  EsdfIntegrator esdf_integrator;
+  EsdfLayer esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  EsdfLayer compact_esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  esdf_integrator.integrateBlocks(tsdf_layer, tsdf_layer.getAllBlockIndices(),
+                                  &esdf_layer);
+  esdf_integrator.integrateBlocks(compact_layer,
+                                  compact_layer.getAllBlockIndices(),
+                                  &compact_esdf_layer);
+  int num_sites = 0;
+  int num_differing_sites = 0;
+  for (const Index3D& block_index : esdf_layer.getAllBlockIndices()) {
+    const EsdfBlock::ConstPtr block = esdf_layer.getBlockAtIndex(block_index);
+    const EsdfBlock::ConstPtr compact_block =
+        compact_esdf_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(compact_block);
+    for (int x = 0; x < EsdfBlock::kVoxelsPerSide; x++) {
+      for (int y = 0; y < EsdfBlock::kVoxelsPerSide; y++) {
+        for (int z = 0; z < EsdfBlock::kVoxelsPerSide; z++) {
+          const bool is_site = block->voxels[x][y][z].is_site;
+          num_sites += is_site;
+          num_differing_sites +=
+              is_site != compact_block->voxels[x][y][z].is_site;
+        }
+      }
+    }
+  }
+  EXPECT_GT(num_sites, 0);
+  EXPECT_LT(num_differing_sites, 0.01f * num_sites);
+}
+
+TEST_F(CompactTsdfTest, Decay) {
+  CompactTsdfLayer compact_layer(kVoxelSizeM, MemoryType::kUnified);
+  ProjectiveTsdfIntegrator integrator;
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &compact_layer);
+  const int num_blocks = compact_layer.numAllocatedBlocks();
+  ASSERT_GT(num_blocks, 0);
+
+  // Decaying repeatedly eventually deallocates all blocks.
+  TsdfDecayIntegrator decay_integrator(DecayMode::kDecayToDeallocate);
+  CudaStreamOwning cuda_stream;
+  int num_deallocated_blocks = 0;
+  constexpr int kMaxNumDecays = 1000;
+  for (int i = 0; i < kMaxNumDecays && compact_layer.numAllocatedBlocks() > 0;
+       i++) {
+    num_deallocated_blocks +=
+        decay_integrator
+            .decay(&compact_layer, std::nullopt, std::nullopt, cuda_stream)
+            .size();
+  }
+  EXPECT_EQ(compact_layer.numAllocatedBlocks(), 0);
+  EXPECT_EQ(num_deallocated_blocks, num_blocks);
+}
+
+TEST_F(CompactTsdfTest, Mapper) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kDevice,
+                ProjectiveLayerType::kCompactTsdf);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  EXPECT_GT(mapper.compact_tsdf_layer().numAllocatedBlocks(), 0);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), 0);
+
+  mapper.updateMesh();
+  EXPECT_GT(mapper.mesh_layer().numAllocatedBlocks(), 0);
+  mapper.updateEsdf();
+  EXPECT_GT(mapper.esdf_layer().numAllocatedBlocks(), 0);
+
+  // The compact layer holds half the memory of a full precision one, and the
+  // full precision layer it replaces doesn't preallocate blocks.
+  const MemoryReport report = mapper.getMemoryReport();
+  for (const MemoryReportItem& item : report.items()) {
+    if (item.name == "compact_tsdf_layer/blocks") {
+      EXPECT_EQ(item.usage.device_bytes,
+                item.count * sizeof(CompactTsdfBlock));
+    }
+    if (item.name == "tsdf_layer/memory_pool") {
+      EXPECT_EQ(item.count, 0);
+    }
+  }
+  // Mappers which don't use the compact layer don't create it.
+  EXPECT_FALSE(Mapper(kVoxelSizeM, MemoryType::kDevice)
+                   .layers()
+                   .exists<CompactTsdfLayer>());
+
+  mapper.markUnobservedTsdfFreeInsideRadius(Vector3f::Zero(), 0.5f);
+  mapper.decayTsdf();
+  mapper.clearOutsideRadius(Vector3f::Zero(), 2.0f);
+  EXPECT_GT(mapper.compact_tsdf_layer().numAllocatedBlocks(), 0);
+}
+
+TEST_F(CompactTsdfTest, SaveAndLoadMap) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kDevice,
+                ProjectiveLayerType::kCompactTsdf);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  const std::string filename = "compact_tsdf_map.nvblx";
+  ASSERT_TRUE(mapper.saveLayerCake(filename));
+
+  Mapper loaded_mapper(2.0f * kVoxelSizeM, MemoryType::kDevice,
+                       ProjectiveLayerType::kCompactTsdf);
+  ASSERT_TRUE(loaded_mapper.loadMap(filename));
+  EXPECT_EQ(loaded_mapper.voxel_size_m(), kVoxelSizeM);
+  EXPECT_EQ(loaded_mapper.compact_tsdf_layer().numAllocatedBlocks(),
+            mapper.compact_tsdf_layer().numAllocatedBlocks());
+  EXPECT_GT(loaded_mapper.mesh_layer().numAllocatedBlocks(), 0);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
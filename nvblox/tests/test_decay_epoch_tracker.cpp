@@ -0,0 +1,154 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "nvblox/integrators/internal/decay_epoch_tracker.h"
+#include "nvblox/utils/logging.h"
+
+using namespace nvblox;
+
+bool contains(const std::vector<Index3D>& block_indices,
+              const Index3D& block_index) {
+  return std::find(block_indices.begin(), block_indices.end(), block_index) !=
+         block_indices.end();
+}
+
+TEST(DecayEpochTrackerTest, NewBlocksAreDueImmediately) {
+  DecayEpochTracker tracker;
+  EXPECT_EQ(tracker.epoch(), 0);
+  tracker.advanceEpoch();
+  tracker.trackBlocks({Index3D(0, 0, 0), Index3D(1, 0, 0)});
+  EXPECT_EQ(tracker.numTrackedBlocks(), 2);
+  EXPECT_EQ(tracker.numPendingEpochs(Index3D(0, 0, 0)), 1);
+
+  const std::vector<Index3D> due_blocks = tracker.popDueBlocks();
+  EXPECT_EQ(due_blocks.size(), 2);
+  // Popped blocks are unscheduled.
+  EXPECT_TRUE(tracker.popDueBlocks().empty());
+
+  // Untracked blocks have nothing pending.
+  EXPECT_FALSE(tracker.isTracked(Index3D(2, 0, 0)));
+  EXPECT_EQ(tracker.numPendingEpochs(Index3D(2, 0, 0)), 0);
+}
+
+TEST(DecayEpochTrackerTest, BlocksAreDueAfterScheduledEpochs) {
+  const Index3D block_index(0, 0, 0);
+  DecayEpochTracker tracker;
+  tracker.advanceEpoch();
+  tracker.trackBlocks({block_index});
+  ASSERT_EQ(tracker.popDueBlocks().size(), 1);
+  tracker.markBlockDecayed(block_index, 3);
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 0);
+
+  for (int i = 0; i < 2; i++) {
+    tracker.advanceEpoch();
+    EXPECT_TRUE(tracker.popDueBlocks().empty());
+  }
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 2);
+  tracker.advanceEpoch();
+  const std::vector<Index3D> due_blocks = tracker.popDueBlocks();
+  ASSERT_EQ(due_blocks.size(), 1);
+  EXPECT_EQ(due_blocks[0], block_index);
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 3);
+
+  // Blocks with nothing left to decay are never due again.
+  tracker.markBlockDecayed(block_index, DecayEpochTracker::kNeverDue);
+  for (int i = 0; i < 10; i++) {
+    tracker.advanceEpoch();
+    EXPECT_TRUE(tracker.popDueBlocks().empty());
+  }
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 10);
+}
+
+TEST(DecayEpochTrackerTest, UpdatedBlocksAreRescheduled) {
+  const Index3D block_index(0, 0, 0);
+  DecayEpochTracker tracker;
+  tracker.advanceEpoch();
+  tracker.trackBlocks({block_index});
+  tracker.popDueBlocks();
+  tracker.markBlockDecayed(block_index, 5);
+
+  // An integration moves the block to the next epoch.
+  tracker.advanceEpoch();
+  tracker.markBlocksUpdated({block_index});
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 0);
+  tracker.advanceEpoch();
+  EXPECT_TRUE(contains(tracker.popDueBlocks(), block_index));
+
+  // The stale schedule entry is skipped.
+  tracker.markBlockDecayed(block_index, DecayEpochTracker::kNeverDue);
+  for (int i = 0; i < 5; i++) {
+    tracker.advanceEpoch();
+    EXPECT_TRUE(tracker.popDueBlocks().empty());
+  }
+}
+
+TEST(DecayEpochTrackerTest, ExcludedBlocksArePaused) {
+  const Index3D excluded_block_index(0, 0, 0);
+  const Index3D block_index(1, 0, 0);
+  DecayEpochTracker tracker;
+  tracker.advanceEpoch();
+  tracker.trackBlocks({excluded_block_index, block_index});
+  tracker.popDueBlocks();
+  tracker.markBlockDecayed(excluded_block_index, 2);
+  tracker.markBlockDecayed(block_index, 2);
+
+  tracker.advanceEpoch();
+  tracker.excludeBlocksFromEpoch({excluded_block_index});
+  EXPECT_EQ(tracker.numPendingEpochs(excluded_block_index), 0);
+  EXPECT_EQ(tracker.numPendingEpochs(block_index), 1);
+  EXPECT_TRUE(tracker.popDueBlocks().empty());
+
+  tracker.advanceEpoch();
+  std::vector<Index3D> due_blocks = tracker.popDueBlocks();
+  ASSERT_EQ(due_blocks.size(), 1);
+  EXPECT_EQ(due_blocks[0], block_index);
+
+  tracker.advanceEpoch();
+  due_blocks = tracker.popDueBlocks();
+  ASSERT_EQ(due_blocks.size(), 1);
+  EXPECT_EQ(due_blocks[0], excluded_block_index);
+  EXPECT_EQ(tracker.numPendingEpochs(excluded_block_index), 2);
+}
+
+TEST(DecayEpochTrackerTest, ForgetAndClear) {
+  DecayEpochTracker tracker;
+  tracker.advanceEpoch();
+  tracker.trackBlocks({Index3D(0, 0, 0), Index3D(1, 0, 0)});
+  tracker.forgetBlocks({Index3D(0, 0, 0)});
+  EXPECT_FALSE(tracker.isTracked(Index3D(0, 0, 0)));
+  EXPECT_EQ(tracker.numTrackedBlocks(), 1);
+
+  // Forgotten blocks are not returned.
+  const std::vector<Index3D> due_blocks = tracker.popDueBlocks();
+  ASSERT_EQ(due_blocks.size(), 1);
+  EXPECT_EQ(due_blocks[0], Index3D(1, 0, 0));
+
+  tracker.clear();
+  EXPECT_EQ(tracker.epoch(), 0);
+  EXPECT_EQ(tracker.numTrackedBlocks(), 0);
+  EXPECT_TRUE(tracker.getTrackedBlockIndices().empty());
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -82,6 +82,10 @@ TEST(FuserTest, CommandLineFlags) {
   EXPECT_EQ(fuser->mesh_output_path_, "5");
   EXPECT_EQ(fuser->map_output_path_, "6");
 
+  // Output writing is synchronous unless requested.
+  EXPECT_FALSE(fuser->async_output_);
+  EXPECT_EQ(fuser->output_writer_, nullptr);
+
   // Subsampling
   EXPECT_EQ(fuser->projective_frame_subsampling_, 7);
   EXPECT_EQ(fuser->color_frame_subsampling_, 8);
@@ -0,0 +1,258 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "nvblox/map/accessors.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/mapper/mapper.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSize = 0.1f;
+
+class LayerSnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int x = 0; x < kNumBlocks; x++) {
+      block_indices_.push_back(Index3D(x, 0, 0));
+    }
+    layer_.allocateBlocksAtIndices(block_indices_, CudaStreamOwning());
+    setDistances(&layer_, 1.0f);
+  }
+
+  static void setDistances(TsdfLayer* layer, float distance) {
+    callFunctionOnAllVoxels<TsdfVoxel>(
+        layer, [distance](const Index3D&, const Index3D&, TsdfVoxel* voxel) {
+          voxel->distance = distance;
+        });
+  }
+
+  static void checkDistances(const TsdfLayer& layer, float distance) {
+    int num_checked = 0;
+    callFunctionOnAllVoxels<TsdfVoxel>(
+        layer, [&](const Index3D&, const Index3D&, const TsdfVoxel* voxel) {
+          EXPECT_EQ(voxel->distance, distance);
+          num_checked++;
+        });
+    EXPECT_GT(num_checked, 0);
+  }
+
+  static const TsdfBlock* constBlockPtr(const TsdfLayer& layer,
+                                        const Index3D& block_index) {
+    return layer.getBlockAtIndex(block_index).get();
+  }
+
+  static constexpr int kNumBlocks = 10;
+  std::vector<Index3D> block_indices_;
+  TsdfLayer layer_{kVoxelSize, MemoryType::kUnified};
+};
+
+TEST_F(LayerSnapshotTest, SnapshotIsFrozen) {
+  std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+  EXPECT_EQ(snapshot->numAllocatedBlocks(), kNumBlocks);
+  EXPECT_EQ(snapshot->voxel_size(), layer_.voxel_size());
+  EXPECT_EQ(snapshot->memory_type(), layer_.memory_type());
+  EXPECT_EQ(layer_.snapshot_generation(), 1);
+
+  // Writes to the live layer don't show up in the snapshot.
+  setDistances(&layer_, 2.0f);
+  checkDistances(layer_, 2.0f);
+  checkDistances(*snapshot, 1.0f);
+
+  // New blocks neither.
+  layer_.allocateBlockAtIndex(Index3D(0, 1, 0));
+  EXPECT_EQ(layer_.numAllocatedBlocks(), kNumBlocks + 1);
+  EXPECT_EQ(snapshot->numAllocatedBlocks(), kNumBlocks);
+
+  // A second snapshot sees the new values.
+  std::shared_ptr<const TsdfLayer> snapshot_2 = layer_.createSnapshot();
+  EXPECT_EQ(layer_.snapshot_generation(), 2);
+  setDistances(&layer_, 3.0f);
+  checkDistances(*snapshot, 1.0f);
+  checkDistances(*snapshot_2, 2.0f);
+  checkDistances(layer_, 3.0f);
+}
+
+TEST_F(LayerSnapshotTest, BlocksAreCopiedOnWrite) {
+  std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+
+  // Before writing, all blocks are shared.
+  for (const Index3D& block_index : block_indices_) {
+    EXPECT_TRUE(layer_.isBlockShared(block_index));
+    EXPECT_EQ(constBlockPtr(layer_, block_index),
+              constBlockPtr(*snapshot, block_index));
+  }
+
+  // Write a single block. Only that block is copied.
+  const Index3D written_block_index = block_indices_[3];
+  TsdfBlock::Ptr block = layer_.getBlockAtIndex(written_block_index);
+  block->voxels[0][0][0].distance = 5.0f;
+  for (const Index3D& block_index : block_indices_) {
+    if (block_index == written_block_index) {
+      EXPECT_FALSE(layer_.isBlockShared(block_index));
+      EXPECT_NE(constBlockPtr(layer_, block_index),
+                constBlockPtr(*snapshot, block_index));
+    } else {
+      EXPECT_TRUE(layer_.isBlockShared(block_index));
+      EXPECT_EQ(constBlockPtr(layer_, block_index),
+                constBlockPtr(*snapshot, block_index));
+    }
+  }
+  EXPECT_EQ(snapshot->getBlockAtIndex(written_block_index)
+                ->voxels[0][0][0]
+                .distance,
+            1.0f);
+
+  // The copy is made once.
+  EXPECT_EQ(layer_.getBlockAtIndex(written_block_index).get(), block.get());
+
+  // Writing via the allocation function copies too.
+  const Index3D allocated_block_index = block_indices_[5];
+  TsdfBlock::Ptr allocated_block =
+      layer_.allocateBlockAtIndex(allocated_block_index);
+  EXPECT_NE(allocated_block.get(),
+            constBlockPtr(*snapshot, allocated_block_index));
+  EXPECT_EQ(allocated_block->voxels[1][1][1].distance, 1.0f);
+
+  // Explicit batched copies.
+  layer_.unshareBlocks(block_indices_);
+  for (const Index3D& block_index : block_indices_) {
+    EXPECT_FALSE(layer_.isBlockShared(block_index));
+    EXPECT_NE(constBlockPtr(layer_, block_index),
+              constBlockPtr(*snapshot, block_index));
+  }
+  checkDistances(*snapshot, 1.0f);
+}
+
+TEST_F(LayerSnapshotTest, ReleasedSnapshotIsNotCopied) {
+  std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+  const TsdfBlock* block_ptr_before = constBlockPtr(layer_, block_indices_[0]);
+  snapshot.reset();
+
+  // Nobody else holds the blocks anymore, so writing doesn't copy.
+  EXPECT_FALSE(layer_.isBlockShared(block_indices_[0]));
+  EXPECT_EQ(layer_.getBlockAtIndex(block_indices_[0]).get(), block_ptr_before);
+}
+
+TEST_F(LayerSnapshotTest, ClearBlocksWithLiveSnapshot) {
+  std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+
+  // Clearing blocks in the live layer doesn't affect the snapshot.
+  layer_.clearBlocks(block_indices_);
+  EXPECT_EQ(layer_.numAllocatedBlocks(), 0);
+  EXPECT_EQ(snapshot->numAllocatedBlocks(), kNumBlocks);
+  checkDistances(*snapshot, 1.0f);
+
+  // Re-allocated blocks must not be the blocks held by the snapshot.
+  layer_.allocateBlocksAtIndices(block_indices_, CudaStreamOwning());
+  setDistances(&layer_, 2.0f);
+  checkDistances(*snapshot, 1.0f);
+
+  // Neither does clearing the whole layer.
+  layer_.clear();
+  checkDistances(*snapshot, 1.0f);
+}
+
+TEST_F(LayerSnapshotTest, ConcurrentReader) {
+  constexpr int kNumUpdates = 20;
+  for (int i = 0; i < kNumUpdates; i++) {
+    const float distance = static_cast<float>(i);
+    setDistances(&layer_, distance);
+    std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+
+    // Read the snapshot while the live layer is being written.
+    std::thread reader([snapshot, distance]() {
+      checkDistances(*snapshot, distance);
+    });
+    setDistances(&layer_, distance + 0.5f);
+    reader.join();
+  }
+}
+
+TEST_F(LayerSnapshotTest, ConcurrentGpuLayerViews) {
+  std::shared_ptr<const TsdfLayer> snapshot = layer_.createSnapshot();
+  // The readers race to build the snapshot's GPU view. It's built once and
+  // shared by all of them.
+  constexpr int kNumReaders = 8;
+  std::vector<const GPUHashImpl<TsdfBlock>*> hashes(kNumReaders, nullptr);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kNumReaders; i++) {
+    readers.emplace_back([snapshot, &hashes, i]() {
+      const TsdfLayer::GPULayerViewType gpu_layer_view =
+          snapshot->getGpuLayerView();
+      hashes[i] = &gpu_layer_view.getHash();
+      EXPECT_GE(gpu_layer_view.size(), static_cast<size_t>(kNumBlocks));
+    });
+  }
+  setDistances(&layer_, 2.0f);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  for (int i = 0; i < kNumReaders; i++) {
+    EXPECT_EQ(hashes[i], hashes[0]);
+  }
+  checkDistances(*snapshot, 1.0f);
+}
+
+TEST(MapperSnapshotTest, LayerSnapshots) {
+  Mapper mapper(kVoxelSize, MemoryType::kUnified);
+  const Index3D block_index(1, 2, 3);
+  mapper.tsdf_layer().allocateBlockAtIndex(block_index);
+  mapper.esdf_layer().allocateBlockAtIndex(block_index);
+  mapper.occupancy_layer().allocateBlockAtIndex(block_index);
+  mapper.freespace_layer().allocateBlockAtIndex(block_index);
+  mapper.color_layer().allocateBlockAtIndex(block_index);
+
+  std::shared_ptr<const TsdfLayer> tsdf_snapshot =
+      mapper.createTsdfLayerSnapshot();
+  std::shared_ptr<const EsdfLayer> esdf_snapshot =
+      mapper.createEsdfLayerSnapshot();
+  std::shared_ptr<const OccupancyLayer> occupancy_snapshot =
+      mapper.createOccupancyLayerSnapshot();
+  std::shared_ptr<const FreespaceLayer> freespace_snapshot =
+      mapper.createFreespaceLayerSnapshot();
+  std::shared_ptr<const ColorLayer> color_snapshot =
+      mapper.createColorLayerSnapshot();
+
+  // Getting the GPU hash doesn't copy blocks, unless they're about to be
+  // written.
+  mapper.esdf_layer().getGpuLayerView();
+  EXPECT_TRUE(mapper.esdf_layer().isBlockShared(block_index));
+  mapper.esdf_layer().getWritableGpuLayerView({Index3D(0, 0, 0)});
+  EXPECT_TRUE(mapper.esdf_layer().isBlockShared(block_index));
+  mapper.esdf_layer().getWritableGpuLayerView({block_index});
+  EXPECT_FALSE(mapper.esdf_layer().isBlockShared(block_index));
+
+  // Clear the map.
+  mapper.clearOutsideRadius(Vector3f(100.0f, 100.0f, 100.0f), 1.0f);
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(), 0);
+  EXPECT_TRUE(tsdf_snapshot->isBlockAllocated(block_index));
+  EXPECT_TRUE(esdf_snapshot->isBlockAllocated(block_index));
+  EXPECT_TRUE(occupancy_snapshot->isBlockAllocated(block_index));
+  EXPECT_TRUE(freespace_snapshot->isBlockAllocated(block_index));
+  EXPECT_TRUE(color_snapshot->isBlockAllocated(block_index));
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,226 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/geometry/bounding_boxes.h"
+#include "nvblox/map/accessors.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/map/layer_to_3d_grid.h"
+#include "nvblox/map/unified_3d_grid.h"
+
+using namespace nvblox;
+
+constexpr float kEps = 1e-6;
+
+class LayerToUnifiedGridHostTest : public ::testing::Test {
+ protected:
+  LayerToUnifiedGridHostTest() : esdf_layer_(voxel_size_m_, MemoryType::kHost) {
+    default_voxel_.squared_distance_vox = -1.0;
+  }
+  // Layer to test with
+  const float voxel_size_m_ = 0.05;
+  EsdfLayer esdf_layer_;
+
+  // Default value of voxels in the dense
+  EsdfVoxel default_voxel_;
+};
+
+float globalVoxelIndexToTestValue(const Index3D& global_voxel_idx) {
+  Index3DHash hash;
+  constexpr size_t kMaxValue = 1000;
+  return static_cast<float>(hash(global_voxel_idx) % kMaxValue);
+}
+
+void setLayerToTestValues(EsdfLayer* layer_ptr) {
+  callFunctionOnAllVoxels<EsdfVoxel>(
+      layer_ptr, [](const Index3D& block_index, const Index3D& voxel_index,
+                    EsdfVoxel* voxel) {
+        voxel->squared_distance_vox = globalVoxelIndexToTestValue(
+            block_index * VoxelBlock<bool>::kVoxelsPerSide + voxel_index);
+      });
+}
+
+// Checks a grid (or a tile) against the layer. Returns the number of voxels
+// which were found in the layer.
+int checkGridHasTestValue(const Unified3DGrid<float>& grid,
+                          const EsdfLayer& layer, const float default_value) {
+  int num_in_layer = 0;
+  const Index3D max_index = grid.min_index() + grid.aabb_size();
+  for (int x = grid.min_index().x(); x < max_index.x(); x++) {
+    for (int y = grid.min_index().y(); y < max_index.y(); y++) {
+      for (int z = grid.min_index().z(); z < max_index.z(); z++) {
+        const Index3D global_voxel_idx(x, y, z);
+        Index3D block_idx;
+        Index3D voxel_idx;
+        getBlockAndVoxelIndexFromPositionInLayer(
+            layer.block_size(),
+            (global_voxel_idx.cast<float>() + 0.5f * Vector3f::Ones()) *
+                layer.voxel_size(),
+            &block_idx, &voxel_idx);
+        if (layer.isBlockAllocated(block_idx)) {
+          EXPECT_NEAR(grid(global_voxel_idx),
+                      globalVoxelIndexToTestValue(global_voxel_idx), kEps);
+          num_in_layer++;
+        } else {
+          EXPECT_NEAR(grid(global_voxel_idx), default_value, kEps);
+        }
+      }
+    }
+  }
+  return num_in_layer;
+}
+
+struct ExtractDistanceFunctor {
+  float operator()(const EsdfVoxel& voxel) const {
+    return voxel.squared_distance_vox;
+  }
+};
+
+TEST_F(LayerToUnifiedGridHostTest, WholeLayer) {
+  const std::vector<Index3D> blocks = {
+      Index3D(-1, 0, 0),  // NOLINT
+      Index3D(0, 0, 0),   // NOLINT
+      Index3D(1, 0, 0),   // NOLINT
+      Index3D(1, 0, 1)    // NOLINT
+  };
+  esdf_layer_.allocateBlocksAtIndices(blocks, CudaStreamOwning());
+  setLayerToTestValues(&esdf_layer_);
+  const auto aabb = getAABBOfAllocatedBlocks(esdf_layer_);
+
+  // Identity copy
+  Unified3DGrid<EsdfVoxel> grid(MemoryType::kHost);
+  voxelLayerToDenseVoxelGridInAABB(esdf_layer_, aabb, default_voxel_, &grid);
+  EXPECT_TRUE((grid.aabb_size().array() > 0).all());
+
+  // Extract the distances for checking
+  Unified3DGrid<float> distance_grid(MemoryType::kHost);
+  distance_grid.setAABB(grid.min_index(), grid.aabb_size());
+  for (size_t i = 0; i < grid.data().size(); i++) {
+    distance_grid.data()[i] = grid.data()[i].squared_distance_vox;
+  }
+  EXPECT_GT(checkGridHasTestValue(distance_grid, esdf_layer_,
+                                  default_voxel_.squared_distance_vox),
+            0);
+}
+
+TEST_F(LayerToUnifiedGridHostTest, PartialLayerWithConversion) {
+  const Index3D block_idx_1 = Index3D(0, 0, 0);
+  const Index3D block_idx_2 = Index3D(1, 1, 1);
+  esdf_layer_.allocateBlocksAtIndices({block_idx_1, block_idx_2},
+                                      CudaStreamOwning());
+  setLayerToTestValues(&esdf_layer_);
+
+  // Construct an AABB which is in the middle of two blocks.
+  const Index3D voxel_idx(3, 3, 3);
+  const Vector3f aabb_min = getCenterPositionFromBlockIndexAndVoxelIndex(
+      esdf_layer_.block_size(), block_idx_1, voxel_idx);
+  const Vector3f aabb_max = getCenterPositionFromBlockIndexAndVoxelIndex(
+      esdf_layer_.block_size(), block_idx_2, voxel_idx);
+  const auto aabb = AxisAlignedBoundingBox(aabb_min, aabb_max);
+
+  constexpr float kDefaultValue = -1.0f;
+  Unified3DGrid<float> grid(MemoryType::kHost);
+  voxelLayerToDenseVoxelGridInAABB(esdf_layer_, aabb, kDefaultValue,
+                                   ExtractDistanceFunctor(), &grid);
+  EXPECT_EQ(grid.aabb_size(), Index3D::Constant(9));
+  EXPECT_GT(checkGridHasTestValue(grid, esdf_layer_, kDefaultValue), 0);
+}
+
+TEST_F(LayerToUnifiedGridHostTest, ThreadCountDoesNotChangeResult) {
+  std::vector<Index3D> blocks;
+  for (int x = -2; x < 2; x++) {
+    for (int y = -2; y < 2; y++) {
+      blocks.push_back(Index3D(x, y, x + y));
+    }
+  }
+  esdf_layer_.allocateBlocksAtIndices(blocks, CudaStreamOwning());
+  setLayerToTestValues(&esdf_layer_);
+  const auto aabb = getAABBOfAllocatedBlocks(esdf_layer_);
+
+  constexpr float kDefaultValue = -1.0f;
+  auto distance_op = [](const EsdfVoxel& voxel) {
+    return voxel.squared_distance_vox;
+  };
+  Unified3DGrid<float> grid_single(MemoryType::kHost);
+  voxelLayerToDenseVoxelGridInAABB(esdf_layer_, aabb, kDefaultValue,
+                                   distance_op, &grid_single, 1);
+  Unified3DGrid<float> grid_multi(MemoryType::kHost);
+  voxelLayerToDenseVoxelGridInAABB(esdf_layer_, aabb, kDefaultValue,
+                                   distance_op, &grid_multi, 8);
+
+  EXPECT_EQ(grid_single.min_index(), grid_multi.min_index());
+  EXPECT_EQ(grid_single.aabb_size(), grid_multi.aabb_size());
+  ASSERT_EQ(grid_single.data().size(), grid_multi.data().size());
+  for (size_t i = 0; i < grid_single.data().size(); i++) {
+    EXPECT_EQ(grid_single.data()[i], grid_multi.data()[i]);
+  }
+  EXPECT_GT(checkGridHasTestValue(grid_multi, esdf_layer_, kDefaultValue), 0);
+}
+
+TEST_F(LayerToUnifiedGridHostTest, TiledMatchesFullGrid) {
+  const std::vector<Index3D> blocks = {
+      Index3D(0, 0, 0),   // NOLINT
+      Index3D(2, 1, 0),   // NOLINT
+      Index3D(-1, 0, 3),  // NOLINT
+  };
+  esdf_layer_.allocateBlocksAtIndices(blocks, CudaStreamOwning());
+  setLayerToTestValues(&esdf_layer_);
+  const auto aabb = getAABBOfAllocatedBlocks(esdf_layer_);
+
+  constexpr float kDefaultValue = -1.0f;
+  Unified3DGrid<float> full_grid(MemoryType::kHost);
+  voxelLayerToDenseVoxelGridInAABB(esdf_layer_, aabb, kDefaultValue,
+                                   ExtractDistanceFunctor(), &full_grid);
+
+  // Tiles which don't align with the blocks, to exercise partial blocks and
+  // partial tiles at the boundary.
+  const Index3D tile_size(7, 5, 11);
+  size_t num_tile_voxels = 0;
+  int num_tiles = 0;
+  voxelLayerToDenseVoxelGridInAABBTiled<EsdfVoxel, float>(
+      esdf_layer_, aabb, kDefaultValue, ExtractDistanceFunctor(), tile_size,
+      [&](const Unified3DGrid<float>& tile) {
+        EXPECT_TRUE((tile.aabb_size().array() <= tile_size.array()).all());
+        const Index3D max_index = tile.min_index() + tile.aabb_size();
+        for (int x = tile.min_index().x(); x < max_index.x(); x++) {
+          for (int y = tile.min_index().y(); y < max_index.y(); y++) {
+            for (int z = tile.min_index().z(); z < max_index.z(); z++) {
+              const Index3D idx(x, y, z);
+              ASSERT_TRUE(full_grid.isInsideGrid(idx));
+              EXPECT_EQ(tile(idx), full_grid(idx));
+            }
+          }
+        }
+        num_tile_voxels += tile.data().size();
+        num_tiles++;
+      });
+  // The tiles cover the full grid exactly once.
+  EXPECT_EQ(num_tile_voxels, full_grid.data().size());
+  const Index3D expected_num_tiles =
+      (full_grid.aabb_size() + tile_size - Index3D::Ones()).array() /
+      tile_size.array();
+  EXPECT_EQ(num_tiles, expected_num_tiles.prod());
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -123,6 +123,90 @@ TEST(MapperTest, ClearOutsideSphere) {
   }
 }
 
+TEST(MapperTest, EsdfDistanceSummaries) {
+  const Vector3f sphere_center(0.0f, 0.0f, 5.0f);
+  const float sphere_radius = 2.0f;
+  primitives::Scene scene = getSphereInABoxScene(sphere_center, sphere_radius);
+
+  constexpr float voxel_size_m = 0.1;
+  Mapper mapper(voxel_size_m, MemoryType::kDevice);
+  MapperParams params;
+  params.update_esdf_distance_summaries = true;
+  mapper.setMapperParams(params);
+  EXPECT_TRUE(mapper.update_esdf_distance_summaries());
+  EXPECT_TRUE(mapper.esdf_integrator().track_updated_blocks());
+
+  TsdfLayer tsdf_layer_host(voxel_size_m, MemoryType::kHost);
+  scene.generateLayerFromScene(1.0, &tsdf_layer_host);
+  mapper.tsdf_layer().copyFrom(tsdf_layer_host);
+  mapper.updateEsdf(UpdateFullLayer::kYes);
+
+  // One summary per ESDF block
+  const BlockDistanceSummaryPyramid& summaries =
+      mapper.esdf_distance_summaries();
+  EXPECT_GT(summaries.size(), 0);
+  EXPECT_EQ(summaries.size(), mapper.esdf_layer().numAllocatedBlocks());
+
+  // A robot touching the sphere surface is never reported as free.
+  const Vector3f p_on_surface =
+      sphere_center + Vector3f(sphere_radius, 0.0f, 0.0f);
+  EXPECT_NE(summaries.checkSphere(p_on_surface, 0.2f),
+            CollisionStatus::kFree);
+
+  // Summaries follow deallocation.
+  mapper.clearOutsideRadius(sphere_center, sphere_radius);
+  EXPECT_EQ(summaries.size(), mapper.esdf_layer().numAllocatedBlocks());
+
+  // Disabling clears the summaries.
+  mapper.update_esdf_distance_summaries(false);
+  EXPECT_TRUE(summaries.empty());
+}
+
+TEST(MapperTest, TsdfDistanceSummaries) {
+  primitives::Scene scene;
+  scene.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.0f, 0.0, 1.0), Vector3f(0, 0, -1)));
+  Camera camera(300, 300, 320, 240, 640, 480);
+  DepthImage depth_frame(camera.height(), camera.width(),
+                         MemoryType::kUnified);
+  constexpr float kMaxDist = 10.0f;
+  scene.generateDepthImageFromScene(camera, Transform::Identity(), kMaxDist,
+                                    &depth_frame);
+
+  constexpr float voxel_size_m = 0.1;
+  Mapper mapper(voxel_size_m, MemoryType::kDevice);
+  MapperParams params;
+  params.update_tsdf_distance_summaries = true;
+  mapper.setMapperParams(params);
+  EXPECT_TRUE(mapper.update_tsdf_distance_summaries());
+
+  // The summaries follow the blocks touched by integration.
+  mapper.integrateDepth(depth_frame, Transform::Identity(), camera);
+  EXPECT_GT(mapper.tsdf_layer().numAllocatedBlocks(), 0);
+  // Reading the summaries doesn't update them.
+  EXPECT_TRUE(mapper.tsdf_distance_summaries().empty());
+  mapper.updateTsdfDistanceSummaries();
+  EXPECT_EQ(mapper.tsdf_distance_summaries().size(),
+            mapper.tsdf_layer().numAllocatedBlocks());
+
+  Transform T_L_C = Transform::Identity();
+  T_L_C.translation() = Vector3f(2.0f, 0.0f, 0.0f);
+  mapper.integrateDepth(depth_frame, T_L_C, camera);
+  mapper.updateTsdfDistanceSummaries();
+  EXPECT_EQ(mapper.tsdf_distance_summaries().size(),
+            mapper.tsdf_layer().numAllocatedBlocks());
+
+  // ...and deallocation.
+  mapper.clearOutsideRadius(Vector3f::Zero(), 1.5f);
+  mapper.updateTsdfDistanceSummaries();
+  EXPECT_EQ(mapper.tsdf_distance_summaries().size(),
+            mapper.tsdf_layer().numAllocatedBlocks());
+
+  // Disabling clears the summaries.
+  mapper.update_tsdf_distance_summaries(false);
+  EXPECT_TRUE(mapper.tsdf_distance_summaries().empty());
+}
+
 TEST(MapperTest, GenerateEsdfInFakeObservedAreas) {
   // Scene
   primitives::Scene scene;
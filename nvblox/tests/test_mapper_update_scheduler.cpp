@@ -0,0 +1,283 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "nvblox/map/accessors.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/mapper/mapper_update_scheduler.h"
+#include "nvblox/primitives/scene.h"
+#include "nvblox/tests/integrator_utils.h"
+#include "nvblox/tests/utils.h"
+
+using namespace nvblox;
+
+class MapperUpdateSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scene_ = test_utils::getSphereInBox();
+    // Depth frames on a circle around the sphere, looking at its center.
+    constexpr float kTrajectoryRadius = 4.0f;
+    constexpr float kTrajectoryHeight = 2.0f;
+    const float radians_increment = 2.0f * M_PI / kNumFrames;
+    for (int i = 0; i < kNumFrames; i++) {
+      const float theta = radians_increment * i;
+      const Vector3f position(kTrajectoryRadius * std::cos(theta),
+                              kTrajectoryRadius * std::sin(theta),
+                              kTrajectoryHeight);
+      // The camera has its z axis pointing towards the origin.
+      const Eigen::Quaternionf rotation_base(0.5, 0.5, 0.5, 0.5);
+      const Eigen::Quaternionf rotation_theta(
+          Eigen::AngleAxisf(M_PI + theta, Vector3f::UnitZ()));
+      Transform T_S_C = Transform::Identity();
+      T_S_C.prerotate(rotation_theta * rotation_base);
+      T_S_C.pretranslate(position);
+      poses_.push_back(T_S_C);
+
+      DepthImage depth_frame(camera_.height(), camera_.width(),
+                             MemoryType::kUnified);
+      constexpr float kMaxDist = 10.0f;
+      scene_.generateDepthImageFromScene(camera_, T_S_C, kMaxDist,
+                                         &depth_frame);
+      depth_frames_.push_back(std::move(depth_frame));
+    }
+  }
+
+  static constexpr float kVoxelSizeM = 0.1f;
+  static constexpr int kNumFrames = 12;
+
+  primitives::Scene scene_;
+  Camera camera_{300, 300, 320, 240, 640, 480};
+  std::vector<Transform> poses_;
+  std::vector<DepthImage> depth_frames_;
+};
+
+TEST_F(MapperUpdateSchedulerTest, MatchesSequentialMapper) {
+  // Sequential
+  Mapper sequential_mapper(kVoxelSizeM, MemoryType::kUnified);
+  for (int i = 0; i < kNumFrames; i++) {
+    sequential_mapper.integrateDepth(depth_frames_[i], poses_[i], camera_);
+    sequential_mapper.updateEsdf();
+    sequential_mapper.updateMesh();
+  }
+
+  // Scheduled, with the derived layers updated concurrently with integration.
+  Mapper mapper(kVoxelSizeM, MemoryType::kUnified);
+  {
+    MapperUpdateScheduler scheduler(&mapper);
+    for (int i = 0; i < kNumFrames; i++) {
+      scheduler.integrateDepth(depth_frames_[i], poses_[i], camera_);
+      scheduler.requestEsdfUpdate();
+      scheduler.requestMeshUpdate();
+    }
+    // Pick up the blocks integrated during the last updates.
+    scheduler.waitUntilIdle();
+    scheduler.requestEsdfUpdate();
+    scheduler.requestMeshUpdate();
+    scheduler.waitUntilIdle();
+    EXPECT_NE(scheduler.getSerializedMesh(), nullptr);
+  }
+
+  // The same blocks are allocated.
+  EXPECT_EQ(mapper.tsdf_layer().numAllocatedBlocks(),
+            sequential_mapper.tsdf_layer().numAllocatedBlocks());
+  EXPECT_EQ(mapper.esdf_layer().numAllocatedBlocks(),
+            sequential_mapper.esdf_layer().numAllocatedBlocks());
+  EXPECT_EQ(mapper.mesh_layer().numAllocatedBlocks(),
+            sequential_mapper.mesh_layer().numAllocatedBlocks());
+  EXPECT_GT(mapper.mesh_layer().numAllocatedBlocks(), 0);
+
+  // The ESDF agrees. The updates were batched differently, so we allow for
+  // small differences.
+  int num_voxels = 0;
+  int num_different_voxels = 0;
+  callFunctionOnAllVoxels<EsdfVoxel>(
+      mapper.esdf_layer(), [&](const Index3D& block_index,
+                               const Index3D& voxel_index,
+                               const EsdfVoxel* voxel) {
+        const EsdfBlock::ConstPtr sequential_block =
+            sequential_mapper.esdf_layer().getBlockAtIndex(block_index);
+        ASSERT_TRUE(sequential_block);
+        const EsdfVoxel& sequential_voxel =
+            sequential_block
+                ->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()];
+        if (!voxel->observed || !sequential_voxel.observed) {
+          return;
+        }
+        ++num_voxels;
+        if (std::abs(voxel->squared_distance_vox -
+                     sequential_voxel.squared_distance_vox) > 1.0f) {
+          ++num_different_voxels;
+        }
+      });
+  EXPECT_GT(num_voxels, 0);
+  EXPECT_LT(num_different_voxels, num_voxels / 100 + 1);
+}
+
+TEST_F(MapperUpdateSchedulerTest, Metrics) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kUnified);
+  MapperUpdateScheduler scheduler(&mapper);
+  for (int i = 0; i < kNumFrames; i++) {
+    scheduler.integrateDepth(depth_frames_[i], poses_[i], camera_);
+    scheduler.requestDecay();
+    scheduler.requestEsdfUpdate();
+    scheduler.requestMeshUpdate();
+  }
+  scheduler.waitUntilIdle();
+
+  const MapperStageMetrics integration_metrics =
+      scheduler.getStageMetrics(MapperStage::kIntegrateDepth);
+  EXPECT_EQ(integration_metrics.num_runs, kNumFrames);
+  EXPECT_GT(integration_metrics.mean_duration_ms, 0.0f);
+  EXPECT_GE(integration_metrics.max_latency_ms,
+            integration_metrics.max_duration_ms);
+
+  // Requests are merged while a stage is pending, so each background stage
+  // ran at least once and at most once per request.
+  for (const MapperStage stage :
+       {MapperStage::kDecay, MapperStage::kUpdateEsdf,
+        MapperStage::kUpdateMesh}) {
+    const MapperStageMetrics metrics = scheduler.getStageMetrics(stage);
+    EXPECT_GE(metrics.num_runs, 1);
+    EXPECT_LE(metrics.num_runs, kNumFrames);
+    EXPECT_GE(metrics.mean_latency_ms, metrics.mean_duration_ms);
+  }
+  EXPECT_GT(scheduler.getStageMetrics(MapperStage::kUpdateMesh)
+                .num_blocks_processed,
+            0);
+  EXPECT_EQ(scheduler.getStageMetrics(MapperStage::kIntegrateColor).num_runs,
+            0);
+
+  const std::string metrics_string = scheduler.getMetricsAsString();
+  EXPECT_NE(metrics_string.find("integrate_depth"), std::string::npos);
+  EXPECT_NE(metrics_string.find("update_mesh"), std::string::npos);
+  EXPECT_EQ(metrics_string.find("integrate_color"), std::string::npos);
+  LOG(INFO) << "Scheduler metrics:\n" << metrics_string;
+
+  scheduler.resetMetrics();
+  EXPECT_EQ(scheduler.getStageMetrics(MapperStage::kIntegrateDepth).num_runs,
+            0);
+}
+
+TEST_F(MapperUpdateSchedulerTest, RunExclusive) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kUnified);
+  MapperUpdateScheduler scheduler(&mapper);
+  for (int i = 0; i < kNumFrames; i++) {
+    scheduler.integrateDepth(depth_frames_[i], poses_[i], camera_);
+    scheduler.requestMeshUpdate();
+    if (i == kNumFrames / 2) {
+      // Clearing the map while the mesh is updated in the background.
+      scheduler.runExclusive([](Mapper* mapper) {
+        mapper->clearOutsideRadius(Vector3f(100.0f, 100.0f, 100.0f), 1.0f);
+        EXPECT_EQ(mapper->tsdf_layer().numAllocatedBlocks(), 0);
+        EXPECT_EQ(mapper->mesh_layer().numAllocatedBlocks(), 0);
+      });
+    }
+  }
+  scheduler.waitUntilIdle();
+  scheduler.requestMeshUpdate();
+  scheduler.waitUntilIdle();
+
+  // The mesh only contains blocks which exist in the TSDF.
+  scheduler.runExclusive([](Mapper* mapper) {
+    EXPECT_GT(mapper->mesh_layer().numAllocatedBlocks(), 0);
+    for (const Index3D& block_index :
+         mapper->mesh_layer().getAllBlockIndices()) {
+      EXPECT_TRUE(mapper->tsdf_layer().isBlockAllocated(block_index));
+    }
+  });
+}
+
+TEST_F(MapperUpdateSchedulerTest, IntegrationDoesNotWaitForDerivedLayers) {
+  // With epoch-based decay and block paging, integration deallocates and pages
+  // in blocks. The corresponding writes to the derived layers are left to the
+  // background updates, such that integration doesn't wait for them.
+  const std::string kStoreDirectory = "./scheduler_block_store";
+  std::filesystem::remove_all(kStoreDirectory);
+  // Small voxels, such that a full update is much slower than integration.
+  constexpr float kSmallVoxelSizeM = 0.05f;
+  Mapper mapper(kSmallVoxelSizeM, MemoryType::kUnified,
+                ProjectiveLayerType::kTsdfWithFreespace);
+  mapper.epoch_based_decay(true);
+  mapper.enableBlockPaging(kStoreDirectory);
+  {
+    MapperUpdateScheduler scheduler(&mapper);
+    for (int i = 0; i < kNumFrames; i++) {
+      scheduler.integrateDepth(depth_frames_[i], poses_[i], camera_);
+    }
+    scheduler.requestFreespaceUpdate(Time(0));
+    scheduler.requestEsdfUpdate();
+    scheduler.requestMeshUpdate();
+    scheduler.waitUntilIdle();
+
+    // Evict most of the map, such that integration pages it back in.
+    scheduler.runExclusive([](Mapper* mapper) {
+      mapper->evictOutsideRadius(Vector3f::Zero(), 1.5f);
+      EXPECT_GT(mapper->num_evicted_blocks(), 0);
+    });
+
+    // Integrate while updates of the full map run.
+    scheduler.requestDecay();
+    scheduler.requestEsdfUpdate();
+    scheduler.requestMeshUpdate();
+    scheduler.resetMetrics();
+    for (int i = 0; i < kNumFrames; i++) {
+      scheduler.integrateDepth(depth_frames_[i], poses_[i], camera_);
+    }
+    scheduler.waitUntilIdle();
+
+    // No integration waited for a full ESDF and mesh update.
+    const MapperStageMetrics integration_metrics =
+        scheduler.getStageMetrics(MapperStage::kIntegrateDepth);
+    const MapperStageMetrics esdf_metrics =
+        scheduler.getStageMetrics(MapperStage::kUpdateEsdf);
+    const MapperStageMetrics mesh_metrics =
+        scheduler.getStageMetrics(MapperStage::kUpdateMesh);
+    EXPECT_EQ(integration_metrics.num_runs, kNumFrames);
+    ASSERT_GE(esdf_metrics.num_runs, 1);
+    ASSERT_GE(mesh_metrics.num_runs, 1);
+    EXPECT_LT(integration_metrics.max_latency_ms,
+              esdf_metrics.max_duration_ms + mesh_metrics.max_duration_ms);
+    LOG(INFO) << "Scheduler metrics:\n" << scheduler.getMetricsAsString();
+
+    // The staged writes are applied by the next update.
+    scheduler.requestFreespaceUpdate(Time(1));
+    scheduler.requestEsdfUpdate();
+    scheduler.requestMeshUpdate();
+    scheduler.waitUntilIdle();
+    scheduler.runExclusive([](Mapper* mapper) {
+      EXPECT_GT(mapper->freespace_layer().numAllocatedBlocks(), 0);
+      for (const Index3D& block_index :
+           mapper->freespace_layer().getAllBlockIndices()) {
+        EXPECT_TRUE(mapper->tsdf_layer().isBlockAllocated(block_index));
+      }
+      for (const Index3D& block_index :
+           mapper->mesh_layer().getAllBlockIndices()) {
+        EXPECT_TRUE(mapper->tsdf_layer().isBlockAllocated(block_index));
+      }
+    });
+  }
+  std::filesystem::remove_all(kStoreDirectory);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
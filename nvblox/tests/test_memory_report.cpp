@@ -0,0 +1,222 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/core/memory_report.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/mapper/multi_mapper.h"
+#include "nvblox/primitives/scene.h"
+
+using namespace nvblox;
+
+const MemoryReportItem& getItem(const MemoryReport& report,
+                                const std::string& name) {
+  for (const MemoryReportItem& item : report.items()) {
+    if (item.name == name) {
+      return item;
+    }
+  }
+  LOG(FATAL) << "No item named " << name;
+  return report.items().front();
+}
+
+TEST(MemoryReportTest, MemoryUsage) {
+  MemoryUsage usage;
+  usage.add(MemoryType::kDevice, 1);
+  usage.add(MemoryType::kUnified, 10);
+  usage.add(MemoryType::kHost, 100);
+  usage.host_bytes = 1000;
+  EXPECT_EQ(usage.device_bytes, 1);
+  EXPECT_EQ(usage.unified_bytes, 10);
+  EXPECT_EQ(usage.host_pinned_bytes, 100);
+  EXPECT_EQ(usage.total_bytes(), 1111);
+
+  MemoryUsage other;
+  other.device_bytes = 5;
+  other.host_bytes = 5;
+  const MemoryUsage max_usage = usage.cwiseMax(other);
+  EXPECT_EQ(max_usage.device_bytes, 5);
+  EXPECT_EQ(max_usage.unified_bytes, 10);
+  EXPECT_EQ(max_usage.host_bytes, 1000);
+  usage += other;
+  EXPECT_EQ(usage.total_bytes(), 1121);
+
+  // Vectors count their capacity, not their size.
+  device_vector<float> vector;
+  vector.reserve(100);
+  vector.resize(10);
+  MemoryUsage vector_usage;
+  vector_usage.addVector(vector);
+  EXPECT_EQ(vector_usage.device_bytes, vector.capacity() * sizeof(float));
+  EXPECT_GE(vector_usage.device_bytes, 100 * sizeof(float));
+
+  DepthImage image(48, 64, MemoryType::kHost);
+  MemoryUsage image_usage;
+  image_usage.addImage(image);
+  EXPECT_EQ(image_usage.host_pinned_bytes, 48 * 64 * sizeof(float));
+}
+
+TEST(MemoryReportTest, Report) {
+  MemoryUsage usage;
+  usage.device_bytes = 10;
+  MemoryReport report;
+  report.add("a", usage, 1);
+  report.add("b", usage, 2);
+  MemoryReport parent;
+  parent.add("child/", report);
+  ASSERT_EQ(parent.items().size(), 2);
+  EXPECT_EQ(parent.items()[0].name, "child/a");
+  EXPECT_EQ(parent.items()[1].count, 2);
+  EXPECT_EQ(parent.total().device_bytes, 20);
+  EXPECT_NE(parent.toString().find("child/b"), std::string::npos);
+}
+
+TEST(MemoryReportTest, Layer) {
+  TsdfLayer layer(1.0f, MemoryType::kDevice);
+  constexpr int kNumBlocks = 10;
+  for (int i = 0; i < kNumBlocks; i++) {
+    layer.allocateBlockAtIndex(Index3D(i, 0, 0));
+  }
+  MemoryReport report = layer.getMemoryReport();
+  const MemoryReportItem& blocks = getItem(report, "blocks");
+  EXPECT_EQ(blocks.count, kNumBlocks);
+  EXPECT_EQ(blocks.usage.device_bytes, kNumBlocks * sizeof(TsdfBlock));
+  EXPECT_GT(getItem(report, "block_hash").usage.host_bytes, 0);
+  const MemoryReportItem& pool = getItem(report, "memory_pool");
+  EXPECT_EQ(pool.usage.device_bytes, pool.count * sizeof(TsdfBlock));
+  // The GPU hash is only allocated on request.
+  EXPECT_EQ(getItem(report, "gpu_layer_view").usage.total_bytes(), 0);
+
+  layer.getGpuLayerView();
+  report = layer.getMemoryReport();
+  const MemoryReportItem& gpu_view = getItem(report, "gpu_layer_view");
+  EXPECT_GE(gpu_view.count, kNumBlocks);
+  EXPECT_GT(gpu_view.usage.device_bytes, 0);
+  EXPECT_EQ(gpu_view.usage.host_bytes, 0);
+
+  // The total is the same without building the report.
+  const MemoryUsage usage = layer.getMemoryUsage();
+  EXPECT_EQ(usage.device_bytes, report.total().device_bytes);
+  EXPECT_EQ(usage.host_bytes, report.total().host_bytes);
+}
+
+TEST(MemoryReportTest, MeshLayer) {
+  MeshLayer layer(1.0f, MemoryType::kUnified);
+  MeshBlock::Ptr block = layer.allocateBlockAtIndex(Index3D(0, 0, 0));
+  block->vertices.reserve(100);
+  block->triangles.reserve(300);
+  const MemoryReportItem& blocks =
+      getItem(layer.getMemoryReport(), "blocks");
+  EXPECT_EQ(blocks.count, 1);
+  // The block itself lives on the heap, its vectors in unified memory.
+  EXPECT_EQ(blocks.usage.host_bytes, sizeof(MeshBlock));
+  EXPECT_GE(blocks.usage.unified_bytes,
+            100 * sizeof(Vector3f) + 300 * sizeof(int));
+}
+
+TEST(MemoryReportTest, MapperHighWatermark) {
+  primitives::Scene scene;
+  scene.aabb() = AxisAlignedBoundingBox(Vector3f(-5.0f, -5.0f, -5.0f),
+                                        Vector3f(5.0f, 5.0f, 5.0f));
+  scene.addGroundLevel(-4.0f);
+  scene.addCeiling(4.0f);
+  scene.addPlaneBoundaries(-4.0f, 4.0f, -4.0f, 4.0f);
+  Camera camera(300, 300, 640, 480);
+  Transform T_S_C = Transform::Identity();
+  T_S_C.prerotate(Eigen::Quaternionf(0.5, 0.5, 0.5, 0.5));
+  DepthImage depth_image(480, 640, MemoryType::kUnified);
+  scene.generateDepthImageFromScene(camera, T_S_C, 20.0f, &depth_image);
+
+  Mapper mapper(0.1f, MemoryType::kDevice);
+  const MemorySnapshot empty_snapshot = mapper.getMemorySnapshot();
+  mapper.integrateDepth(depth_image, T_S_C, camera);
+  mapper.updateMesh();
+  mapper.updateEsdf();
+
+  const MemoryReport report = mapper.getMemoryReport();
+  LOG(INFO) << "\n" << report.toString();
+  EXPECT_EQ(getItem(report, "tsdf_layer/blocks").count,
+            mapper.tsdf_layer().numAllocatedBlocks());
+  EXPECT_GT(getItem(report, "tsdf_layer/blocks").usage.device_bytes, 0);
+  EXPECT_GT(getItem(report, "mesh_layer/blocks").usage.total_bytes(), 0);
+  EXPECT_GT(getItem(report, "tsdf_integrator").usage.total_bytes(), 0);
+  EXPECT_GT(getItem(report, "mesh_integrator").usage.total_bytes(), 0);
+  EXPECT_GT(getItem(report, "esdf_integrator").usage.total_bytes(), 0);
+
+  const MemorySnapshot full_snapshot = mapper.getMemorySnapshot();
+  EXPECT_EQ(full_snapshot.current.total_bytes(), report.total().total_bytes());
+  EXPECT_EQ(full_snapshot.current.device_bytes, report.total().device_bytes);
+  EXPECT_EQ(full_snapshot.current.unified_bytes, report.total().unified_bytes);
+  EXPECT_GT(full_snapshot.current.total_bytes(),
+            empty_snapshot.current.total_bytes());
+  EXPECT_EQ(full_snapshot.high_watermark.total_bytes(),
+            full_snapshot.current.total_bytes());
+
+  // Freeing the blocks lowers the usage, but not the high watermark.
+  mapper.tsdf_layer().clear();
+  mapper.mesh_layer().clear();
+  mapper.esdf_layer().clear();
+  const MemorySnapshot cleared_snapshot = mapper.getMemorySnapshot();
+  EXPECT_LT(cleared_snapshot.current.total_bytes(),
+            full_snapshot.current.total_bytes());
+  EXPECT_EQ(cleared_snapshot.high_watermark.total_bytes(),
+            full_snapshot.high_watermark.total_bytes());
+
+  mapper.resetMemoryHighWatermark();
+  EXPECT_EQ(mapper.getMemorySnapshot().high_watermark.total_bytes(),
+            cleared_snapshot.current.total_bytes());
+}
+
+TEST(MemoryReportTest, LoadedMap) {
+  Mapper mapper(0.1f, MemoryType::kDevice);
+  mapper.tsdf_layer().allocateBlockAtIndex(Index3D(0, 0, 0));
+  const std::string filename = "memory_report_test_map.nvblx";
+  ASSERT_TRUE(mapper.saveLayerCake(filename));
+
+  // The loaded map lacks the layers which aren't serialized, such as the
+  // freespace layer.
+  Mapper loaded_mapper(0.1f, MemoryType::kDevice);
+  ASSERT_TRUE(loaded_mapper.loadMap(filename));
+  const MemorySnapshot snapshot = loaded_mapper.getMemorySnapshot();
+  const MemoryReport report = loaded_mapper.getMemoryReport();
+  EXPECT_EQ(getItem(report, "tsdf_layer/blocks").count, 1);
+  EXPECT_EQ(snapshot.current.total_bytes(), report.total().total_bytes());
+}
+
+TEST(MemoryReportTest, MultiMapper) {
+  MultiMapper multi_mapper(0.1f, MappingType::kHumanWithStaticTsdf,
+                           EsdfMode::k3D, MemoryType::kDevice);
+  multi_mapper.unmasked_mapper()->tsdf_layer().allocateBlockAtIndex(
+      Index3D(0, 0, 0));
+  const MemoryReport report = multi_mapper.getMemoryReport();
+  EXPECT_EQ(getItem(report, "unmasked_mapper/tsdf_layer/blocks").count, 1);
+  EXPECT_EQ(getItem(report, "masked_mapper/tsdf_layer/blocks").count, 0);
+  const size_t expected_total_bytes =
+      multi_mapper.unmasked_mapper()->getMemoryReport().total().total_bytes() +
+      multi_mapper.masked_mapper()->getMemoryReport().total().total_bytes() +
+      getItem(report, "images").usage.total_bytes();
+  EXPECT_EQ(report.total().total_bytes(), expected_total_bytes);
+  EXPECT_EQ(multi_mapper.getMemorySnapshot().current.total_bytes(),
+            expected_total_bytes);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include <gtest/gtest.h>
 
+#include "nvblox/core/indexing.h"
 #include "nvblox/datasets/3dmatch.h"
 #include "nvblox/datasets/image_loader.h"
 #include "nvblox/integrators/projective_color_integrator.h"
@@ -219,6 +220,127 @@ TEST(MeshColoringTests, CPUvsGPUon3DMatch) {
       << percentage_different << "%" << std::endl;
 }
 
+// Builds a mesh of a box room and a color layer whose red channel is a
+// linear function of x, which is observed everywhere around the mesh.
+void createColorGradientScene(float voxel_size_m, MeshLayer* mesh_layer,
+                              ColorLayer* color_layer) {
+  TsdfLayer tsdf_layer(voxel_size_m, MemoryType::kUnified);
+  primitives::Scene scene;
+  scene.aabb() = AxisAlignedBoundingBox(Vector3f(-2.0f, -2.0f, 0.0f),
+                                        Vector3f(2.0f, 2.0f, 2.0f));
+  scene.addGroundLevel(0.0f);
+  scene.addPrimitive(
+      std::make_unique<primitives::Sphere>(Vector3f(0.0f, 0.0f, 1.0f), 0.5f));
+  scene.addPlaneBoundaries(-2.0f, 2.0f, -2.0f, 2.0f);
+  scene.generateLayerFromScene(2 * voxel_size_m, &tsdf_layer);
+
+  MeshIntegrator mesh_integrator;
+  EXPECT_TRUE(
+      mesh_integrator.integrateMeshFromDistanceField(tsdf_layer, mesh_layer));
+
+  for (const Index3D& block_idx : tsdf_layer.getAllBlockIndices()) {
+    for (const Index3D& offset :
+         {Index3D(0, 0, 0), Index3D(-1, 0, 0), Index3D(1, 0, 0),
+          Index3D(0, -1, 0), Index3D(0, 1, 0), Index3D(0, 0, -1),
+          Index3D(0, 0, 1)}) {
+      color_layer->allocateBlockAtIndex(block_idx + offset);
+    }
+  }
+  // Also allocate the diagonal neighbors, so every voxel around a vertex
+  // exists.
+  for (const Index3D& block_idx : color_layer->getAllBlockIndices()) {
+    for (int x = -1; x <= 1; x++) {
+      for (int y = -1; y <= 1; y++) {
+        for (int z = -1; z <= 1; z++) {
+          color_layer->allocateBlockAtIndex(block_idx + Index3D(x, y, z));
+        }
+      }
+    }
+  }
+  const float block_size_m = color_layer->block_size();
+  callFunctionOnAllVoxels<ColorVoxel>(
+      color_layer,
+      [block_size_m](const Index3D& block_idx, const Index3D& voxel_idx,
+                     ColorVoxel* voxel) {
+        const Vector3f p_L_V = getCenterPositionFromBlockIndexAndVoxelIndex(
+            block_size_m, block_idx, voxel_idx);
+        voxel->color = Color(static_cast<uint8_t>(127.0f + 50.0f * p_L_V.x()),
+                             0, 0);
+        voxel->weight = 1.0f;
+      });
+}
+
+TEST(MeshColoringTests, CPUColoringIndependentOfThreadCount) {
+  constexpr float kVoxelSizeM = 0.1f;
+  ColorLayer color_layer(kVoxelSizeM, MemoryType::kUnified);
+  MeshLayer mesh_layer_single(voxelSizeToBlockSize(kVoxelSizeM),
+                              MemoryType::kUnified);
+  createColorGradientScene(kVoxelSizeM, &mesh_layer_single, &color_layer);
+  MeshLayer mesh_layer_multi(mesh_layer_single.block_size(),
+                             MemoryType::kUnified);
+  mesh_layer_multi.copyFrom(mesh_layer_single);
+
+  for (const bool trilinear : {false, true}) {
+    MeshIntegrator mesh_integrator;
+    mesh_integrator.color_interpolation_trilinear(trilinear);
+    mesh_integrator.num_color_threads(1);
+    mesh_integrator.colorMeshCPU(color_layer, &mesh_layer_single);
+    mesh_integrator.num_color_threads(4);
+    mesh_integrator.colorMeshCPU(color_layer, &mesh_layer_multi);
+
+    for (const Index3D& block_idx : mesh_layer_single.getAllBlockIndices()) {
+      const MeshBlock::ConstPtr block_single =
+          mesh_layer_single.getBlockAtIndex(block_idx);
+      const MeshBlock::ConstPtr block_multi =
+          mesh_layer_multi.getBlockAtIndex(block_idx);
+      ASSERT_EQ(block_single->colors.size(), block_single->vertices.size());
+      ASSERT_EQ(block_single->colors.size(), block_multi->colors.size());
+      for (size_t i = 0; i < block_single->colors.size(); i++) {
+        EXPECT_EQ(block_single->colors[i], block_multi->colors[i]);
+      }
+    }
+  }
+}
+
+TEST(MeshColoringTests, TrilinearColorInterpolation) {
+  constexpr float kVoxelSizeM = 0.1f;
+  ColorLayer color_layer(kVoxelSizeM, MemoryType::kUnified);
+  MeshLayer mesh_layer(voxelSizeToBlockSize(kVoxelSizeM),
+                       MemoryType::kUnified);
+  createColorGradientScene(kVoxelSizeM, &mesh_layer, &color_layer);
+
+  // The red channel as a function of the position.
+  auto get_expected_red = [](const Vector3f& position) {
+    return 127.0f + 50.0f * position.x();
+  };
+  auto get_max_red_error = [&](const MeshLayer& layer) {
+    float max_error = 0.0f;
+    for (const Index3D& block_idx : layer.getAllBlockIndices()) {
+      const MeshBlock::ConstPtr block = layer.getBlockAtIndex(block_idx);
+      for (size_t i = 0; i < block->vertices.size(); i++) {
+        max_error = std::max(
+            max_error, std::abs(static_cast<float>(block->colors[i].r) -
+                                get_expected_red(block->vertices[i])));
+      }
+    }
+    return max_error;
+  };
+
+  MeshIntegrator mesh_integrator;
+  mesh_integrator.colorMeshCPU(color_layer, &mesh_layer);
+  const float max_error_closest = get_max_red_error(mesh_layer);
+
+  mesh_integrator.color_interpolation_trilinear(true);
+  mesh_integrator.colorMeshCPU(color_layer, &mesh_layer);
+  const float max_error_trilinear = get_max_red_error(mesh_layer);
+
+  std::cout << "Max red error closest: " << max_error_closest
+            << ", trilinear: " << max_error_trilinear << std::endl;
+  // Voxel colors are truncated to integers, and interpolated colors rounded.
+  EXPECT_LT(max_error_trilinear, 1.5f);
+  EXPECT_GT(max_error_closest, max_error_trilinear);
+}
+
 int main(int argc, char** argv) {
   FLAGS_alsologtostderr = true;
   google::InitGoogleLogging(argv[0]);
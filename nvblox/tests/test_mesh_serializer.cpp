@@ -17,6 +17,7 @@ limitations under the License.
 #include <algorithm>
 #include "nvblox/mesh/mesh_integrator.h"
 #include "nvblox/primitives/scene.h"
+#include "nvblox/serialization/compact_mesh_encoding.h"
 #include "nvblox/serialization/mesh_serializer_gpu.h"
 #include "nvblox/tests/utils.h"
 
@@ -199,6 +200,141 @@ TEST(MeshSerializerGpuTest, serializeOneEmptyBlock) {
   serializer.serializeMesh(mesh_layer, {index}, CudaStreamOwning());
 }
 
+void validateDecodedMesh(const SerializedMesh& mesh,
+                         const SerializedMesh& decoded_mesh, float block_size,
+                         int max_color_error) {
+  ASSERT_EQ(decoded_mesh.block_indices, mesh.block_indices);
+  ASSERT_EQ(decoded_mesh.vertices.size(), mesh.vertices.size());
+  ASSERT_EQ(decoded_mesh.triangle_indices.size(),
+            mesh.triangle_indices.size());
+  for (size_t i = 0; i < mesh.vertex_block_offsets.size(); i++) {
+    EXPECT_EQ(decoded_mesh.vertex_block_offsets[i],
+              mesh.vertex_block_offsets[i]);
+    EXPECT_EQ(decoded_mesh.triangle_index_block_offsets[i],
+              mesh.triangle_index_block_offsets[i]);
+  }
+  // Positions are quantized to 16 bits over two block sizes.
+  const float kPositionTolerance = 2.0f * block_size / 65535.0f + 1e-6f;
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    EXPECT_LE((decoded_mesh.vertices[i] - mesh.vertices[i]).cwiseAbs().maxCoeff(),
+              kPositionTolerance);
+  }
+  for (size_t i = 0; i < mesh.triangle_indices.size(); i++) {
+    EXPECT_EQ(decoded_mesh.triangle_indices[i], mesh.triangle_indices[i]);
+  }
+  ASSERT_EQ(decoded_mesh.colors.size(), mesh.colors.size());
+  for (size_t i = 0; i < mesh.colors.size(); i++) {
+    EXPECT_LE(std::abs(decoded_mesh.colors[i].r - mesh.colors[i].r),
+              max_color_error);
+    EXPECT_LE(std::abs(decoded_mesh.colors[i].g - mesh.colors[i].g),
+              max_color_error);
+    EXPECT_LE(std::abs(decoded_mesh.colors[i].b - mesh.colors[i].b),
+              max_color_error);
+  }
+}
+
+TEST_F(MeshSerializerGpuTestFixture, compactRoundTrip) {
+  const std::vector<Index3D> block_indices_to_serialize =
+      mesh_layer_->getAllBlockIndices();
+
+  for (const CompactMeshIndexEncoding index_encoding :
+       {CompactMeshIndexEncoding::k16Bit,
+        CompactMeshIndexEncoding::kVarintDelta}) {
+    for (const CompactMeshColorEncoding color_encoding :
+         {CompactMeshColorEncoding::kRgb565,
+          CompactMeshColorEncoding::kPalette}) {
+      CompactMeshEncodingOptions options;
+      options.index_encoding = index_encoding;
+      options.color_encoding = color_encoding;
+      const std::shared_ptr<const CompactSerializedMesh> compact_mesh =
+          serializer_.serializeMeshCompact(*mesh_layer_,
+                                           block_indices_to_serialize, options,
+                                           CudaStreamOwning());
+      EXPECT_EQ(compact_mesh->block_indices, block_indices_to_serialize);
+      LOG(INFO) << "Compact mesh: " << compact_mesh->data.size()
+                << " bytes, compression ratio: "
+                << compact_mesh->compressionRatio();
+      EXPECT_GT(compact_mesh->compressionRatio(), 2.0f);
+
+      SerializedMesh decoded_mesh;
+      ASSERT_TRUE(decodeCompactMesh(*compact_mesh, &decoded_mesh));
+      // The fixture has at most 256 colors per block, so the palette is
+      // lossless.
+      const int max_color_error =
+          (color_encoding == CompactMeshColorEncoding::kPalette) ? 0 : 4;
+      validateDecodedMesh(*serializer_.getSerializedMesh(), decoded_mesh,
+                          mesh_layer_->block_size(), max_color_error);
+    }
+  }
+}
+
+TEST_F(MeshSerializerGpuTestFixture, compactNormals) {
+  const std::vector<Index3D> block_indices_to_serialize =
+      mesh_layer_->getAllBlockIndices();
+  CompactMeshEncodingOptions options;
+  options.encode_normals = true;
+  options.color_encoding = CompactMeshColorEncoding::kNone;
+  const std::shared_ptr<const CompactSerializedMesh> compact_mesh =
+      serializer_.serializeMeshCompact(*mesh_layer_, block_indices_to_serialize,
+                                       options, CudaStreamOwning());
+
+  SerializedMesh decoded_mesh;
+  std::vector<Vector3f> decoded_normals;
+  ASSERT_TRUE(
+      decodeCompactMesh(*compact_mesh, &decoded_mesh, &decoded_normals));
+  EXPECT_TRUE(decoded_mesh.colors.empty());
+
+  // Octahedral normals with 8 bits per component are within a degree or so.
+  constexpr float kMaxAngleRad = 2.0f * M_PI / 180.0f;
+  size_t normal_idx = 0;
+  for (const Index3D& block_index : block_indices_to_serialize) {
+    const MeshBlock* mesh_block =
+        mesh_layer_->getBlockAtIndex(block_index).get();
+    ASSERT_EQ(mesh_block->normals.size(), mesh_block->vertices.size());
+    for (size_t i = 0; i < mesh_block->normals.size(); i++) {
+      ASSERT_LT(normal_idx, decoded_normals.size());
+      const Vector3f normal = mesh_block->normals[i].normalized();
+      const float cos_angle =
+          std::min(1.0f, normal.dot(decoded_normals[normal_idx]));
+      EXPECT_LT(std::acos(cos_angle), kMaxAngleRad);
+      ++normal_idx;
+    }
+  }
+  EXPECT_EQ(normal_idx, decoded_normals.size());
+}
+
+TEST_F(MeshSerializerGpuTestFixture, compactRejectsCorruptedData) {
+  const std::shared_ptr<const CompactSerializedMesh> compact_mesh =
+      serializer_.serializeMeshCompact(
+          *mesh_layer_, mesh_layer_->getAllBlockIndices(),
+          CompactMeshEncodingOptions(), CudaStreamOwning());
+  SerializedMesh decoded_mesh;
+  ASSERT_TRUE(decodeCompactMesh(*compact_mesh, &decoded_mesh));
+
+  // Truncated
+  std::vector<uint8_t> data = compact_mesh->data;
+  EXPECT_FALSE(
+      decodeCompactMesh(data.data(), data.size() / 2, &decoded_mesh));
+  // Bad magic
+  data[0] ^= 0xFF;
+  EXPECT_FALSE(decodeCompactMesh(data.data(), data.size(), &decoded_mesh));
+  // Empty
+  EXPECT_FALSE(decodeCompactMesh(data.data(), 0, &decoded_mesh));
+}
+
+TEST(MeshSerializerGpuTest, compactEmptyMesh) {
+  MeshLayer mesh_layer(1.f, MemoryType::kDevice);
+  MeshSerializerGpu serializer;
+  const std::shared_ptr<const CompactSerializedMesh> compact_mesh =
+      serializer.serializeMeshCompact(mesh_layer, {},
+                                      CompactMeshEncodingOptions(),
+                                      CudaStreamOwning());
+  SerializedMesh decoded_mesh;
+  ASSERT_TRUE(decodeCompactMesh(*compact_mesh, &decoded_mesh));
+  EXPECT_TRUE(decoded_mesh.block_indices.empty());
+  EXPECT_TRUE(decoded_mesh.vertices.empty());
+}
+
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_alsologtostderr = true;
@@ -0,0 +1,357 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/mesh/mesh_integrator.h"
+#include "nvblox/mesh/mesh_lod.h"
+#include "nvblox/mesh/mesh_simplifier.h"
+#include "nvblox/mesh/mesh_streamer_view_aware.h"
+#include "nvblox/primitives/scene.h"
+#include "nvblox/tests/utils.h"
+
+using namespace nvblox;
+
+class MeshSimplifierTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tsdf_layer_ =
+        std::make_unique<TsdfLayer>(voxel_size_, MemoryType::kUnified);
+    mesh_layer_ = std::make_unique<MeshLayer>(tsdf_layer_->block_size(),
+                                              MemoryType::kUnified);
+    scene_.aabb() = AxisAlignedBoundingBox(Vector3f(-2.0f, -2.0f, -2.0f),
+                                           Vector3f(2.0f, 2.0f, 2.0f));
+  }
+
+  void generateMesh() {
+    scene_.generateLayerFromScene(4 * voxel_size_, tsdf_layer_.get());
+    ASSERT_TRUE(mesh_integrator_.integrateMeshFromDistanceField(
+        *tsdf_layer_, mesh_layer_.get(), DeviceType::kCPU));
+  }
+
+  // A flat square grid of (n-1)^2 quads in the z=0 plane.
+  static void createFlatGrid(int n, float spacing, MeshBlock* block) {
+    std::vector<Vector3f> vertices;
+    std::vector<Vector3f> normals;
+    std::vector<int> triangles;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        vertices.push_back(Vector3f(i * spacing, j * spacing, 0.0f));
+        normals.push_back(Vector3f::UnitZ());
+      }
+    }
+    for (int i = 0; i < n - 1; i++) {
+      for (int j = 0; j < n - 1; j++) {
+        const int a = i * n + j;
+        const int b = (i + 1) * n + j;
+        const int c = (i + 1) * n + j + 1;
+        const int d = i * n + j + 1;
+        triangles.insert(triangles.end(), {a, b, c, a, c, d});
+      }
+    }
+    block->vertices.copyFrom(vertices);
+    block->normals.copyFrom(normals);
+    block->triangles.copyFrom(triangles);
+  }
+
+  static size_t numTriangles(const MeshLayer& mesh_layer) {
+    size_t num_triangles = 0;
+    for (const Index3D& block_idx : mesh_layer.getAllBlockIndices()) {
+      num_triangles += mesh_layer.getBlockAtIndex(block_idx)->triangles.size();
+    }
+    return num_triangles / 3;
+  }
+
+  const float voxel_size_ = 0.05f;
+  std::unique_ptr<TsdfLayer> tsdf_layer_;
+  std::unique_ptr<MeshLayer> mesh_layer_;
+  MeshIntegrator mesh_integrator_;
+  primitives::Scene scene_;
+};
+
+TEST_F(MeshSimplifierTest, FlatGridKeepsBorders) {
+  constexpr int kGridSize = 9;
+  constexpr float kSpacing = 0.05f;
+  MeshBlock input(MemoryType::kHost);
+  createFlatGrid(kGridSize, kSpacing, &input);
+
+  MeshSimplifier simplifier;
+  simplifier.target_triangle_ratio(0.0f);
+  MeshBlock output(MemoryType::kHost);
+  simplifier.simplifyBlock(input, &output);
+
+  // A flat grid reduces to a fan of its border vertices.
+  const int num_border_vertices = 4 * (kGridSize - 1);
+  EXPECT_EQ(output.vertices.size(), num_border_vertices);
+  EXPECT_EQ(output.triangles.size(), 3 * (num_border_vertices - 2));
+  EXPECT_EQ(output.normals.size(), output.vertices.size());
+
+  // All border vertices are preserved.
+  const float max_coordinate = (kGridSize - 1) * kSpacing;
+  for (int i = 0; i < kGridSize; i++) {
+    for (const Vector3f& border_vertex :
+         {Vector3f(i * kSpacing, 0.0f, 0.0f),
+          Vector3f(i * kSpacing, max_coordinate, 0.0f),
+          Vector3f(0.0f, i * kSpacing, 0.0f),
+          Vector3f(max_coordinate, i * kSpacing, 0.0f)}) {
+      bool found = false;
+      for (const Vector3f& vertex : output.vertices) {
+        found |= vertex == border_vertex;
+      }
+      EXPECT_TRUE(found) << border_vertex.transpose();
+    }
+  }
+
+  // No triangle is flipped.
+  for (size_t i = 0; i < output.triangles.size(); i += 3) {
+    const Vector3f& a = output.vertices[output.triangles[i]];
+    const Vector3f& b = output.vertices[output.triangles[i + 1]];
+    const Vector3f& c = output.vertices[output.triangles[i + 2]];
+    EXPECT_GT((b - a).cross(c - a).z(), 0.0f);
+  }
+}
+
+TEST_F(MeshSimplifierTest, TargetTriangleRatio) {
+  MeshBlock input(MemoryType::kHost);
+  createFlatGrid(9, 0.05f, &input);
+
+  MeshSimplifier simplifier;
+  simplifier.target_triangle_ratio(0.5f);
+  MeshBlock output(MemoryType::kHost);
+  simplifier.simplifyBlock(input, &output);
+  const size_t num_input_triangles = input.triangles.size() / 3;
+  const size_t num_output_triangles = output.triangles.size() / 3;
+  EXPECT_LE(num_output_triangles, num_input_triangles / 2);
+  // Each collapse removes two triangles.
+  EXPECT_GE(num_output_triangles + 2, num_input_triangles / 2);
+}
+
+TEST_F(MeshSimplifierTest, EmptyBlock) {
+  MeshBlock input(MemoryType::kHost);
+  MeshBlock output(MemoryType::kHost);
+  MeshSimplifier().simplifyBlock(input, &output);
+  EXPECT_EQ(output.vertices.size(), 0);
+  EXPECT_EQ(output.triangles.size(), 0);
+}
+
+TEST_F(MeshSimplifierTest, PlaneSceneReduction) {
+  scene_.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.02f, 0.0f, 0.0f), Vector3f(-1.0f, 0.0f, 0.0f)));
+  generateMesh();
+
+  MeshLodLayers lods(mesh_layer_->block_size(), MemoryType::kUnified);
+  lods.updateBlocks(*mesh_layer_, mesh_layer_->getAllBlockIndices());
+
+  const size_t num_full_triangles = numTriangles(*mesh_layer_);
+  ASSERT_GT(num_full_triangles, 0);
+  size_t num_previous_triangles = num_full_triangles;
+  for (int lod = 1; lod < lods.num_lods(); lod++) {
+    const size_t num_lod_triangles = numTriangles(lods.getLodLayer(lod));
+    std::cout << "LOD " << lod << ": " << num_lod_triangles << " of "
+              << num_full_triangles << " triangles." << std::endl;
+    EXPECT_LE(num_lod_triangles, num_previous_triangles);
+    num_previous_triangles = num_lod_triangles;
+  }
+  // Flat walls are reduced several-fold.
+  EXPECT_LT(numTriangles(lods.getLodLayer(1)) * 3, num_full_triangles);
+
+  // The simplified vertices stay on the plane.
+  for (int lod = 1; lod < lods.num_lods(); lod++) {
+    const MeshLayer& lod_layer = lods.getLodLayer(lod);
+    EXPECT_EQ(lod_layer.numAllocatedBlocks(),
+              mesh_layer_->numAllocatedBlocks());
+    for (const Index3D& block_idx : lod_layer.getAllBlockIndices()) {
+      const MeshBlock::ConstPtr block = lod_layer.getBlockAtIndex(block_idx);
+      for (const Vector3f& vertex : block->vertices) {
+        EXPECT_NEAR(vertex.x(), 0.02f, 0.1f * voxel_size_);
+      }
+    }
+  }
+}
+
+TEST_F(MeshSimplifierTest, SphereErrorBounded) {
+  const Vector3f center(0.0f, 0.0f, 0.0f);
+  constexpr float kRadius = 1.0f;
+  scene_.addPrimitive(std::make_unique<primitives::Sphere>(center, kRadius));
+  generateMesh();
+
+  constexpr float kMaxErrorM = 0.005f;
+  MeshSimplifier simplifier;
+  simplifier.max_error_m(kMaxErrorM);
+  simplifier.target_triangle_ratio(0.0f);
+  MeshLayer simplified_layer(mesh_layer_->block_size(), MemoryType::kUnified);
+  simplifier.simplifyBlocks(*mesh_layer_, mesh_layer_->getAllBlockIndices(),
+                            &simplified_layer);
+  EXPECT_LT(numTriangles(simplified_layer), numTriangles(*mesh_layer_));
+
+  // The error of the marching cubes mesh itself.
+  float max_input_error_m = 0.0f;
+  for (const Index3D& block_idx : mesh_layer_->getAllBlockIndices()) {
+    for (const Vector3f& vertex :
+         mesh_layer_->getBlockAtIndex(block_idx)->vertices) {
+      max_input_error_m = std::max(max_input_error_m,
+                                   std::abs((vertex - center).norm() - kRadius));
+    }
+  }
+  // Triangle centers of the simplified mesh stay close to the surface.
+  for (const Index3D& block_idx : simplified_layer.getAllBlockIndices()) {
+    const MeshBlock::ConstPtr block =
+        simplified_layer.getBlockAtIndex(block_idx);
+    for (size_t i = 0; i < block->triangles.size(); i += 3) {
+      const Vector3f triangle_center =
+          (block->vertices[block->triangles[i]] +
+           block->vertices[block->triangles[i + 1]] +
+           block->vertices[block->triangles[i + 2]]) /
+          3.0f;
+      EXPECT_LT(std::abs((triangle_center - center).norm() - kRadius),
+                max_input_error_m + kMaxErrorM + 0.1f * voxel_size_);
+    }
+  }
+}
+
+TEST_F(MeshSimplifierTest, SelectLodForDistance) {
+  MeshLodLayers lods(0.4f, MemoryType::kHost, 3);
+  lods.lod_distance_m(2.0f);
+  EXPECT_EQ(lods.num_lods(), 3);
+  EXPECT_EQ(lods.selectLodForDistance(0.0f), 0);
+  EXPECT_EQ(lods.selectLodForDistance(1.9f), 0);
+  EXPECT_EQ(lods.selectLodForDistance(2.0f), 1);
+  EXPECT_EQ(lods.selectLodForDistance(3.9f), 1);
+  EXPECT_EQ(lods.selectLodForDistance(4.0f), 2);
+  EXPECT_EQ(lods.selectLodForDistance(1000.0f), 2);
+  EXPECT_EQ(lods.selectLodForDistance(std::numeric_limits<float>::infinity()),
+            2);
+}
+
+TEST_F(MeshSimplifierTest, StreamerSelectsLodByDistance) {
+  scene_.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.02f, 0.0f, 0.0f), Vector3f(-1.0f, 0.0f, 0.0f)));
+  generateMesh();
+  MeshLodLayers lods(mesh_layer_->block_size(), MemoryType::kUnified);
+  lods.updateBlocks(*mesh_layer_, mesh_layer_->getAllBlockIndices());
+  lods.lod_distance_m(1.0f);
+
+  MeshStreamerViewAware streamer(mesh_layer_->block_size());
+  MeshStreamingViewer viewer;
+  viewer.T_L_C.translation() = Vector3f(-1.5f, 0.0f, 0.0f);
+  streamer.setViewers({viewer});
+  streamer.markIndicesCandidates(mesh_layer_->getAllBlockIndices());
+
+  std::vector<int> block_lods;
+  const std::vector<Index3D> block_indices = streamer.getNBytesOfMeshBlocks(
+      std::numeric_limits<size_t>::max(), *mesh_layer_, lods, &block_lods);
+  ASSERT_EQ(block_indices.size(), mesh_layer_->numAllocatedBlocks());
+  ASSERT_EQ(block_lods.size(), block_indices.size());
+  for (size_t i = 0; i < block_indices.size(); i++) {
+    const float distance_m =
+        (getCenterPositionFromBlockIndex(mesh_layer_->block_size(),
+                                         block_indices[i]) -
+         viewer.T_L_C.translation())
+            .norm();
+    EXPECT_EQ(block_lods[i], lods.selectLodForDistance(distance_m));
+  }
+  EXPECT_EQ(streamer.numPendingRefinements(), 0);
+  EXPECT_EQ(streamer.numCandidates(), 0);
+}
+
+TEST_F(MeshSimplifierTest, StreamerFallsBackToCoarseLodOnBudget) {
+  scene_.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.02f, 0.0f, 0.0f), Vector3f(-1.0f, 0.0f, 0.0f)));
+  generateMesh();
+  MeshLodLayers lods(mesh_layer_->block_size(), MemoryType::kUnified);
+  lods.updateBlocks(*mesh_layer_, mesh_layer_->getAllBlockIndices());
+  // All blocks are wanted at full resolution.
+  lods.lod_distance_m(1000.0f);
+  const int coarsest_lod = lods.num_lods() - 1;
+
+  // A budget which only fits blocks at coarser levels.
+  size_t max_coarse_num_bytes = 0;
+  size_t min_full_num_bytes = std::numeric_limits<size_t>::max();
+  for (const Index3D& block_idx : mesh_layer_->getAllBlockIndices()) {
+    max_coarse_num_bytes = std::max(
+        max_coarse_num_bytes,
+        lods.getBlockAtLod(*mesh_layer_, block_idx, coarsest_lod)
+            ->sizeInBytes());
+    min_full_num_bytes = std::min(
+        min_full_num_bytes,
+        mesh_layer_->getBlockAtIndex(block_idx)->sizeInBytes());
+  }
+  const size_t num_bytes = max_coarse_num_bytes + 1;
+  ASSERT_LT(num_bytes, min_full_num_bytes);
+
+  MeshStreamerViewAware streamer(mesh_layer_->block_size());
+  streamer.setViewers({MeshStreamingViewer()});
+  streamer.markIndicesCandidates(mesh_layer_->getAllBlockIndices());
+  const int num_blocks = streamer.numCandidates();
+
+  std::vector<int> block_lods;
+  std::vector<Index3D> block_indices =
+      streamer.getNBytesOfMeshBlocks(num_bytes, *mesh_layer_, lods, &block_lods);
+  ASSERT_GT(block_indices.size(), 0);
+  for (const int lod : block_lods) {
+    EXPECT_GT(lod, 0);
+  }
+  // The coarse blocks stay candidates for refinement.
+  EXPECT_EQ(streamer.numPendingRefinements(), block_indices.size());
+  EXPECT_EQ(streamer.numCandidates(), num_blocks);
+
+  // With enough budget all blocks are streamed at full resolution.
+  block_indices = streamer.getNBytesOfMeshBlocks(
+      std::numeric_limits<size_t>::max(), *mesh_layer_, lods, &block_lods);
+  EXPECT_EQ(block_indices.size(), num_blocks);
+  for (const int lod : block_lods) {
+    EXPECT_EQ(lod, 0);
+  }
+  EXPECT_EQ(streamer.numPendingRefinements(), 0);
+  EXPECT_EQ(streamer.numCandidates(), 0);
+}
+
+TEST_F(MeshSimplifierTest, SerializedLodMeshIsSmaller) {
+  scene_.addPrimitive(std::make_unique<primitives::Plane>(
+      Vector3f(0.02f, 0.0f, 0.0f), Vector3f(-1.0f, 0.0f, 0.0f)));
+  generateMesh();
+  MeshLodLayers lods(mesh_layer_->block_size(), MemoryType::kUnified);
+  lods.updateBlocks(*mesh_layer_, mesh_layer_->getAllBlockIndices());
+  // All blocks are far away.
+  lods.lod_distance_m(0.01f);
+
+  MeshStreamerViewAware full_streamer(mesh_layer_->block_size());
+  full_streamer.markIndicesCandidates(mesh_layer_->getAllBlockIndices());
+  const size_t num_full_triangle_indices =
+      full_streamer
+          .getNBytesOfSerializedMeshBlocks(std::numeric_limits<size_t>::max(),
+                                           *mesh_layer_, CudaStreamOwning())
+          ->triangle_indices.size();
+
+  MeshStreamerViewAware lod_streamer(mesh_layer_->block_size());
+  lod_streamer.setViewers({MeshStreamingViewer()});
+  lod_streamer.markIndicesCandidates(mesh_layer_->getAllBlockIndices());
+  const std::shared_ptr<const SerializedMesh> lod_mesh =
+      lod_streamer.getNBytesOfSerializedMeshBlocks(
+          std::numeric_limits<size_t>::max(), *mesh_layer_, lods,
+          CudaStreamOwning());
+  EXPECT_EQ(lod_mesh->block_indices.size(), mesh_layer_->numAllocatedBlocks());
+  EXPECT_LT(lod_mesh->triangle_indices.size() * 3, num_full_triangle_indices);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
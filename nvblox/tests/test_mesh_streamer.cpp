@@ -4,8 +4,10 @@
 
 #include "nvblox/core/hash.h"
 #include "nvblox/io/mesh_io.h"
+#include "nvblox/mesh/internal/block_priority_queue.h"
 #include "nvblox/mesh/mesh_integrator.h"
 #include "nvblox/mesh/mesh_streamer.h"
+#include "nvblox/mesh/mesh_streamer_view_aware.h"
 #include "nvblox/primitives/primitives.h"
 #include "nvblox/primitives/scene.h"
 
@@ -32,7 +34,11 @@ class SimpleMeshStreamer : public MeshStreamerBase {
   virtual ~SimpleMeshStreamer() = default;
 
   // To be able to test the internal structure
-  const Index3DSet& mesh_index_set() const { return mesh_index_set_; }
+  Index3DSet mesh_index_set() const {
+    const std::vector<Index3D> block_indices =
+        mesh_block_queue_.getBlockIndices();
+    return Index3DSet(block_indices.begin(), block_indices.end());
+  }
 
  protected:
   // For our test streamer the priority is equal to the x-dimension of the
@@ -145,13 +151,89 @@ void fillWithRandomUniqueIndices(const int num_indices,
       getUniqueIndex3DVectors(num_indices, min_index, max_index));
 }
 
+TEST(MeshStreamerTest, BlockPriorityQueueOrder) {
+  constexpr int kNumBlocks = 1000;
+  const std::vector<Index3D> block_indices = getUniqueIndex3DVectors(kNumBlocks);
+  BlockPriorityQueue queue;
+  for (const Index3D& block_index : block_indices) {
+    queue.push(block_index, static_cast<float>(block_index.x()));
+  }
+  EXPECT_EQ(queue.size(), kNumBlocks);
+
+  // Update the priority of some of the blocks, and remove others.
+  Index3DSet erased_blocks;
+  for (int i = 0; i < kNumBlocks; i += 10) {
+    queue.push(block_indices[i], static_cast<float>(block_indices[i].y()));
+    ASSERT_TRUE(queue.erase(block_indices[i + 1]));
+    erased_blocks.insert(block_indices[i + 1]);
+  }
+  EXPECT_FALSE(queue.erase(block_indices[1]));
+  EXPECT_EQ(queue.size(), kNumBlocks - erased_blocks.size());
+
+  // Blocks come out by decreasing priority.
+  float last_priority = std::numeric_limits<float>::max();
+  int num_popped = 0;
+  while (!queue.empty()) {
+    const float priority = queue.topPriority();
+    const Index3D block_index = queue.pop();
+    EXPECT_LE(priority, last_priority);
+    EXPECT_EQ(erased_blocks.count(block_index), 0);
+    EXPECT_FALSE(queue.contains(block_index));
+    last_priority = priority;
+    ++num_popped;
+  }
+  EXPECT_EQ(num_popped, kNumBlocks - erased_blocks.size());
+}
+
+TEST(MeshStreamerTest, BlockPriorityQueueTies) {
+  // Blocks with equal priorities come out in insertion order.
+  BlockPriorityQueue queue;
+  constexpr int kNumBlocks = 100;
+  for (int i = 0; i < kNumBlocks; i++) {
+    queue.push(Index3D(i, 0, 0), 1.0f);
+  }
+  // Updating a block to the same priority doesn't change its position.
+  queue.push(Index3D(0, 0, 0), 1.0f);
+  for (int i = 0; i < kNumBlocks; i++) {
+    EXPECT_EQ(queue.pop(), Index3D(i, 0, 0));
+  }
+}
+
+TEST(MeshStreamerTest, IncrementalMarking) {
+  // Interleave marking and streaming, and check that we always get the highest
+  // priority blocks among the current candidates.
+  SimpleMeshStreamer mesh_streamer;
+  constexpr int kNumIterations = 20;
+  constexpr int kNumMarkedPerIteration = 100;
+  constexpr int kNumRequestedPerIteration = 30;
+  for (int i = 0; i < kNumIterations; i++) {
+    fillWithRandomIndices(kNumMarkedPerIteration, &mesh_streamer);
+    const Index3DSet candidates_before = mesh_streamer.mesh_index_set();
+    const std::vector<Index3D> streamed_blocks =
+        mesh_streamer.getNMeshBlocks(kNumRequestedPerIteration);
+    ASSERT_EQ(streamed_blocks.size(), kNumRequestedPerIteration);
+    EXPECT_EQ(mesh_streamer.numCandidates(),
+              candidates_before.size() - kNumRequestedPerIteration);
+    // All remaining candidates have priorities no higher than the streamed
+    // ones.
+    const int lowest_streamed_x = streamed_blocks.back().x();
+    for (const Index3D& idx : mesh_streamer.mesh_index_set()) {
+      EXPECT_LE(idx.x(), lowest_streamed_x);
+    }
+  }
+}
+
 class MeshStreamerOldestBlocksTest : public MeshStreamerOldestBlocks {
  public:
   MeshStreamerOldestBlocksTest() = default;
   virtual ~MeshStreamerOldestBlocksTest() = default;
 
   // To be able to test the internal structure
-  const Index3DSet& mesh_index_set() const { return mesh_index_set_; }
+  Index3DSet mesh_index_set() const {
+    const std::vector<Index3D> block_indices =
+        mesh_block_queue_.getBlockIndices();
+    return Index3DSet(block_indices.begin(), block_indices.end());
+  }
 
   const BlockIndexToLastPublishedIndexMap& last_published_map() const {
     return last_published_map_;
@@ -422,6 +504,237 @@ TEST(MeshStreamerTest, ExcludeBlocksOutsideRadius) {
   EXPECT_EQ(mesh_streamer.numCandidates(), 0);
 }
 
+TEST(MeshStreamerTest, ExcludedBlocksArePrunedBelowTheTop) {
+  constexpr float kMeshBlockSizeM = 0.1;
+  MeshStreamerOldestBlocks mesh_streamer;
+  constexpr float kBlockRadiusLimitM = 0.5;
+  mesh_streamer.exclusion_radius_m(kBlockRadiusLimitM);
+
+  constexpr int kCubeSideLengthInBlocks = 10;
+  const std::vector<Index3D> block_indices =
+      getCubeOfBlockIndices(kCubeSideLengthInBlocks);
+  mesh_streamer.markIndicesCandidates(block_indices);
+  const Vector3f exclusion_center_m =
+      (kCubeSideLengthInBlocks / 2.0) * kMeshBlockSizeM * Vector3f::Ones();
+  auto num_inside_radius = [&](const Vector3f& center_m) {
+    return std::count_if(
+        block_indices.begin(), block_indices.end(), [&](const Index3D& idx) {
+          return (getCenterPositionFromBlockIndex(kMeshBlockSizeM, idx) -
+                  center_m)
+                     .norm() <= kBlockRadiusLimitM;
+        });
+  };
+
+  // Streaming a single block drops all excluded candidates, not only the ones
+  // above the streamed block.
+  EXPECT_EQ(mesh_streamer.getNMeshBlocks(1, kMeshBlockSizeM,
+                                         exclusion_center_m)
+                .size(),
+            1);
+  EXPECT_EQ(mesh_streamer.numCandidates(),
+            num_inside_radius(exclusion_center_m) - 1);
+
+  // Moving the center by more than a block prunes again.
+  const int num_candidates = mesh_streamer.numCandidates();
+  const Vector3f moved_center_m =
+      exclusion_center_m + Vector3f(3.0f * kMeshBlockSizeM, 0.0f, 0.0f);
+  mesh_streamer.getNMeshBlocks(0, kMeshBlockSizeM, moved_center_m);
+  EXPECT_LT(mesh_streamer.numCandidates(), num_candidates);
+  EXPECT_LE(mesh_streamer.numCandidates(), num_inside_radius(moved_center_m));
+}
+
+TEST(MeshStreamerTest, ViewAwareStreamsClosestBlocksFirst) {
+  constexpr float kMeshBlockSizeM = 0.1;
+  MeshStreamerViewAware mesh_streamer(kMeshBlockSizeM);
+  // Only distance matters.
+  mesh_streamer.staleness_weight(0.0f);
+
+  // A line of blocks along x, and a viewer at the center of block x = 10.
+  std::vector<Index3D> block_indices;
+  for (int x = -20; x <= 20; x++) {
+    block_indices.push_back(Index3D(x, 0, 0));
+  }
+  mesh_streamer.markIndicesCandidates(block_indices);
+  MeshStreamingViewer viewer;
+  viewer.T_L_C.translation() = Vector3f(1.05f, 0.05f, 0.05f);
+  mesh_streamer.setViewers({viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 1);
+
+  // The closest blocks come out first, in order of distance.
+  const std::vector<Index3D> streamed_blocks = mesh_streamer.getNMeshBlocks(5);
+  ASSERT_EQ(streamed_blocks.size(), 5);
+  float last_distance = 0.0f;
+  for (const Index3D& idx : streamed_blocks) {
+    EXPECT_GE(idx.x(), 8);
+    EXPECT_LE(idx.x(), 12);
+    const float distance =
+        (getCenterPositionFromBlockIndex(kMeshBlockSizeM, idx) -
+         viewer.T_L_C.translation())
+            .norm();
+    EXPECT_GE(distance, last_distance - 1e-4);
+    last_distance = distance;
+  }
+
+  // Moving the viewer to the other end reverses the order.
+  viewer.T_L_C.translation() = Vector3f(-2.0f, 0.05f, 0.05f);
+  mesh_streamer.setViewers({viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 2);
+  const std::vector<Index3D> streamed_blocks_2 =
+      mesh_streamer.getNMeshBlocks(1);
+  ASSERT_EQ(streamed_blocks_2.size(), 1);
+  EXPECT_EQ(streamed_blocks_2[0], Index3D(-20, 0, 0));
+}
+
+TEST(MeshStreamerTest, ViewAwareReprioritizesOnlyOnSignificantMotion) {
+  constexpr float kMeshBlockSizeM = 0.1;
+  MeshStreamerViewAware mesh_streamer(kMeshBlockSizeM);
+  mesh_streamer.reprioritization_distance_m(0.5f);
+  mesh_streamer.markIndicesCandidates(getCubeOfBlockIndices(10));
+
+  MeshStreamingViewer viewer;
+  mesh_streamer.setViewers({viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 1);
+  // Small motion
+  viewer.T_L_C.translation() = Vector3f(0.1f, 0.0f, 0.0f);
+  mesh_streamer.setViewers({viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 1);
+  // Large motion
+  viewer.T_L_C.translation() = Vector3f(1.0f, 0.0f, 0.0f);
+  mesh_streamer.setViewers({viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 2);
+  // Adding a viewer
+  mesh_streamer.setViewers({viewer, viewer});
+  EXPECT_EQ(mesh_streamer.num_reprioritizations(), 3);
+}
+
+TEST(MeshStreamerTest, ViewAwarePrioritizesBlocksInView) {
+  constexpr float kMeshBlockSizeM = 0.1;
+  MeshStreamerViewAware mesh_streamer(kMeshBlockSizeM);
+  mesh_streamer.staleness_weight(0.0f);
+
+  // Two walls of blocks at the same distance, in front of and behind the
+  // camera (which looks along the z axis).
+  std::vector<Index3D> front_blocks;
+  std::vector<Index3D> back_blocks;
+  for (int x = -2; x < 2; x++) {
+    for (int y = -2; y < 2; y++) {
+      front_blocks.push_back(Index3D(x, y, 20));
+      back_blocks.push_back(Index3D(x, y, -21));
+    }
+  }
+  mesh_streamer.markIndicesCandidates(back_blocks);
+  mesh_streamer.markIndicesCandidates(front_blocks);
+
+  MeshStreamingViewer viewer;
+  viewer.camera = Camera(300, 300, 320, 240, 640, 480);
+  mesh_streamer.setViewers({viewer});
+
+  const std::vector<Index3D> streamed_blocks =
+      mesh_streamer.getNMeshBlocks(front_blocks.size());
+  EXPECT_EQ(getSizeOfIntersection(streamed_blocks, front_blocks),
+            front_blocks.size());
+}
+
+TEST(MeshStreamerTest, ViewAwareWithoutViewersStreamsOldestFirst) {
+  constexpr float kMeshBlockSizeM = 0.1;
+  MeshStreamerViewAware mesh_streamer(kMeshBlockSizeM);
+  const std::vector<Index3D> block_indices = getUniqueIndex3DVectors(100);
+  mesh_streamer.markIndicesCandidates(block_indices);
+
+  const std::vector<Index3D> first_half = mesh_streamer.getNMeshBlocks(50);
+  const std::vector<Index3D> second_half = mesh_streamer.getNMeshBlocks(50);
+  EXPECT_EQ(mesh_streamer.numCandidates(), 0);
+
+  // Re-mark in reverse. The older half still comes out first.
+  mesh_streamer.markIndicesCandidates(second_half);
+  mesh_streamer.markIndicesCandidates(first_half);
+  const std::vector<Index3D> first_half_2 = mesh_streamer.getNMeshBlocks(50);
+  EXPECT_EQ(getSizeOfIntersection(first_half, first_half_2), 50);
+}
+
+int getSizeInBytes(const std::vector<Index3D>& block_indices,
+                   const MeshLayer& mesh_layer) {
+  return std::accumulate(
+      block_indices.begin(), block_indices.end(), 0,
+      [&mesh_layer](const int sum, const Index3D block_idx) {
+        return sum + mesh_layer.getBlockAtIndex(block_idx)->sizeInBytes();
+      });
+}
+
+TEST(MeshStreamerTest, MultiClientBudgetsAndVersions) {
+  // Create a test scene and mesh it
+  primitives::Scene scene = test_utils::getSphereInBox();
+  constexpr float kVoxelSizeM = 0.05;
+  constexpr float kMaxDistM = 4 * kVoxelSizeM;
+  TsdfLayer tsdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  scene.generateLayerFromScene(kMaxDistM, &tsdf_layer);
+  MeshIntegrator mesh_integrator;
+  MeshLayer mesh_layer(tsdf_layer.block_size(), MemoryType::kDevice);
+  mesh_integrator.integrateMeshFromDistanceField(tsdf_layer, &mesh_layer);
+  const std::vector<Index3D> all_blocks = mesh_layer.getAllBlockIndices();
+  const int total_bytes = getSizeInBytes(all_blocks, mesh_layer);
+
+  // Two clients with different budgets
+  MultiClientMeshStreamer mesh_streamer(mesh_layer.block_size());
+  mesh_streamer.addClient("slow", total_bytes / 4);
+  mesh_streamer.addClient("fast", total_bytes + 1);
+  MeshStreamingViewer viewer;
+  viewer.T_L_C.translation() = Vector3f(2.0f, 0.0f, 0.0f);
+  mesh_streamer.setClientViewers("slow", {viewer});
+  mesh_streamer.markIndicesCandidates(all_blocks);
+  EXPECT_EQ(mesh_streamer.getBlockVersion(all_blocks[0]), 1);
+
+  // The fast client gets everything, the slow client a quarter.
+  const std::vector<Index3D> fast_blocks =
+      mesh_streamer.getMeshBlocksForClient("fast", mesh_layer);
+  EXPECT_EQ(fast_blocks.size(), all_blocks.size());
+  EXPECT_EQ(mesh_streamer.numCandidates("fast"), 0);
+  const std::vector<Index3D> slow_blocks =
+      mesh_streamer.getMeshBlocksForClient("slow", mesh_layer);
+  EXPECT_LT(getSizeInBytes(slow_blocks, mesh_layer), total_bytes / 4);
+  EXPECT_GT(slow_blocks.size(), 0);
+  EXPECT_EQ(mesh_streamer.numCandidates("slow"),
+            all_blocks.size() - slow_blocks.size());
+  EXPECT_EQ(mesh_streamer.getSentBlockVersion("fast", all_blocks[0]), 1);
+
+  // Re-meshing a block makes it a candidate for both clients again.
+  mesh_streamer.markIndicesCandidates({fast_blocks[0]});
+  EXPECT_EQ(mesh_streamer.getBlockVersion(fast_blocks[0]), 2);
+  EXPECT_EQ(mesh_streamer.getSentBlockVersion("fast", fast_blocks[0]), 1);
+  EXPECT_EQ(mesh_streamer.numCandidates("fast"), 1);
+  EXPECT_EQ(mesh_streamer.getMeshBlocksForClient("fast", mesh_layer).size(),
+            1);
+  EXPECT_EQ(mesh_streamer.getSentBlockVersion("fast", fast_blocks[0]), 2);
+
+  // Deleted blocks are forgotten, and reported once to the clients which were
+  // sent them.
+  const Index3D deleted_block = fast_blocks[1];
+  const bool slow_has_deleted_block =
+      mesh_streamer.getSentBlockVersion("slow", deleted_block) > 0;
+  mesh_streamer.removeBlocks({deleted_block});
+  EXPECT_EQ(mesh_streamer.getBlockVersion(deleted_block), 0);
+  EXPECT_EQ(mesh_streamer.getSentBlockVersion("fast", deleted_block), 0);
+  EXPECT_EQ(mesh_streamer.getDeletedBlocksForClient("fast"),
+            std::vector<Index3D>{deleted_block});
+  EXPECT_TRUE(mesh_streamer.getDeletedBlocksForClient("fast").empty());
+  EXPECT_EQ(mesh_streamer.getDeletedBlocksForClient("slow").size(),
+            slow_has_deleted_block ? 1 : 0);
+  const size_t num_remaining_blocks = all_blocks.size() - 1;
+
+  // A client added late gets all blocks.
+  mesh_streamer.addClient("late", total_bytes + 1);
+  EXPECT_EQ(mesh_streamer.numCandidates("late"), num_remaining_blocks);
+  EXPECT_EQ(mesh_streamer.getClientIds().size(), 3);
+
+  // Resetting a client resends everything.
+  mesh_streamer.resetClient("fast");
+  EXPECT_EQ(mesh_streamer.numCandidates("fast"), num_remaining_blocks);
+  EXPECT_EQ(mesh_streamer.getSentBlockVersion("fast", fast_blocks[0]), 0);
+
+  mesh_streamer.removeClient("late");
+  EXPECT_FALSE(mesh_streamer.hasClient("late"));
+}
+
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_alsologtostderr = true;
@@ -0,0 +1,205 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+
+#include "nvblox/core/morton.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/layer.h"
+#include "nvblox/map/morton_voxel_block.h"
+#include "nvblox/mesh/internal/marching_cubes.h"
+#include "nvblox/tests/block_layout_utils.h"
+
+using namespace nvblox;
+
+constexpr int kVoxelsPerSide = TsdfBlock::kVoxelsPerSide;
+
+TEST(MortonTest, IndexInBlock) {
+  std::set<int> morton_indices;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        const int morton_index = mortonIndexInBlock(x, y, z);
+        EXPECT_GE(morton_index, 0);
+        EXPECT_LT(morton_index, TsdfBlock::kNumVoxels);
+        EXPECT_EQ(voxelIndexFromMortonIndexInBlock(morton_index),
+                  Index3D(x, y, z));
+        morton_indices.insert(morton_index);
+      }
+    }
+  }
+  // A bijection onto [0, 512).
+  EXPECT_EQ(morton_indices.size(), TsdfBlock::kNumVoxels);
+
+  // Aligned cubes are contiguous, with z the fastest running coordinate.
+  EXPECT_EQ(mortonIndexInBlock(0, 0, 1), 1);
+  EXPECT_EQ(mortonIndexInBlock(0, 1, 0), 2);
+  EXPECT_EQ(mortonIndexInBlock(1, 0, 0), 4);
+  EXPECT_EQ(mortonIndexInBlock(1, 1, 1), 7);
+  EXPECT_EQ(mortonIndexInBlock(3, 3, 3), 63);
+  EXPECT_EQ(mortonIndexInBlock(4, 0, 0), 256);
+}
+
+TEST(MortonTest, BlockIndexCodes) {
+  for (const uint32_t value : {0u, 1u, 12345u, 0x1FFFFFu}) {
+    EXPECT_EQ(compactBitsBy3(spreadBitsBy3(value)), value);
+  }
+  // Negative indices are ordered before positive ones.
+  EXPECT_LT(mortonCodeFromBlockIndex(Index3D(-1, -1, -1)),
+            mortonCodeFromBlockIndex(Index3D(0, 0, 0)));
+  EXPECT_LT(mortonCodeFromBlockIndex(Index3D(0, 0, 0)),
+            mortonCodeFromBlockIndex(Index3D(0, 0, 1)));
+  EXPECT_EQ(mortonCodeFromBlockIndex(Index3D(0, 0, 1)) -
+                mortonCodeFromBlockIndex(Index3D(0, 0, 0)),
+            1);
+
+  // The 8 blocks of an aligned 2x2x2 cube are adjacent in the order.
+  std::vector<Index3D> block_indices;
+  for (int x = -2; x < 2; x++) {
+    for (int y = -2; y < 2; y++) {
+      for (int z = -2; z < 2; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  std::reverse(block_indices.begin(), block_indices.end());
+  sortBlockIndicesInMortonOrder(&block_indices);
+  ASSERT_EQ(block_indices.size(), 64);
+  for (size_t i = 0; i < block_indices.size(); i += 8) {
+    const Index3D cube_min = block_indices[i];
+    for (size_t j = i; j < i + 8; j++) {
+      const Index3D offset = block_indices[j] - cube_min;
+      EXPECT_TRUE((offset.array() >= 0).all() && (offset.array() <= 1).all());
+    }
+  }
+}
+
+TEST(MortonTest, LayerIteration) {
+  TsdfLayer layer(0.05f, MemoryType::kHost);
+  std::vector<Index3D> block_indices;
+  for (int x = -3; x < 5; x++) {
+    for (int y = -3; y < 5; y++) {
+      for (int z = 0; z < 4; z++) {
+        block_indices.push_back(Index3D(x, y, z));
+      }
+    }
+  }
+  layer.allocateBlocksAtIndices(block_indices, CudaStreamOwning());
+
+  const std::vector<Index3D> sorted_indices =
+      layer.getAllBlockIndicesInMortonOrder();
+  ASSERT_EQ(sorted_indices.size(), block_indices.size());
+  // The same blocks, sorted by code.
+  const std::vector<Index3D> all_indices = layer.getAllBlockIndices();
+  for (const Index3D& block_index : all_indices) {
+    EXPECT_NE(std::find(sorted_indices.begin(), sorted_indices.end(),
+                        block_index),
+              sorted_indices.end());
+  }
+  for (size_t i = 1; i < sorted_indices.size(); i++) {
+    EXPECT_LT(mortonCodeFromBlockIndex(sorted_indices[i - 1]),
+              mortonCodeFromBlockIndex(sorted_indices[i]));
+  }
+
+  // Consecutive blocks are mostly neighbours.
+  int num_neighbouring_steps = 0;
+  for (size_t i = 1; i < sorted_indices.size(); i++) {
+    const Index3D step = sorted_indices[i] - sorted_indices[i - 1];
+    num_neighbouring_steps += step.cwiseAbs().maxCoeff() <= 1;
+  }
+  EXPECT_GT(num_neighbouring_steps, sorted_indices.size() / 2);
+}
+
+TEST(MortonVoxelBlockTest, Storage) {
+  EXPECT_EQ(sizeof(MortonTsdfBlock), sizeof(TsdfBlock));
+  using MortonBlock =
+      VoxelBlockWithLayout<TsdfVoxel, VoxelBlockLayout::kMortonOrder>;
+  EXPECT_TRUE((std::is_same<MortonBlock, MortonTsdfBlock>::value));
+
+  MortonTsdfBlock block;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        // voxels[x][y][z] is a reference to the voxel in Morton order.
+        const TsdfVoxel* voxel = &block.voxels[x][y][z];
+        EXPECT_EQ(voxel, &block.voxels.array[mortonIndexInBlock(x, y, z)]);
+        EXPECT_EQ(voxel->distance, 0.0f);
+        EXPECT_EQ(voxel->weight, 0.0f);
+      }
+    }
+  }
+
+  TsdfVoxel& voxel = block.voxels[5][6][7];
+  voxel.distance = 0.5f;
+  const MortonTsdfBlock& const_block = block;
+  EXPECT_EQ(const_block.voxels[5][6][7].distance, 0.5f);
+  EXPECT_EQ(block.voxels.array[mortonIndexInBlock(5, 6, 7)].distance, 0.5f);
+}
+
+TEST(MortonVoxelBlockTest, Allocation) {
+  for (const MemoryType memory_type :
+       {MemoryType::kHost, MemoryType::kUnified, MemoryType::kDevice}) {
+    MortonEsdfBlock::Ptr block = MortonEsdfBlock::allocate(memory_type);
+    ASSERT_TRUE(block);
+    const MortonEsdfBlock::Ptr block_host = block.clone(MemoryType::kHost);
+    int num_non_default_voxels = 0;
+    for (const EsdfVoxel& voxel : block_host->voxels.array) {
+      num_non_default_voxels += voxel.squared_distance_vox != 0.0f ||
+                                voxel.parent_direction != Index3D::Zero() ||
+                                voxel.is_inside || voxel.observed ||
+                                voxel.is_site;
+    }
+    EXPECT_EQ(num_non_default_voxels, 0);
+  }
+}
+
+TEST(MortonVoxelBlockTest, MeshingMatches) {
+  constexpr int kNumBlocksPerSide = 4;
+  constexpr float kBlockSize = 0.4f;
+  constexpr float kMinWeight = 0.5f;
+  const test_utils::SphereTsdfBlockGrid<TsdfBlock> grid(kNumBlocksPerSide,
+                                                        kBlockSize);
+  const test_utils::SphereTsdfBlockGrid<MortonTsdfBlock> morton_grid(
+      kNumBlocksPerSide, kBlockSize);
+
+  const std::vector<marching_cubes::PerVoxelMarchingCubesResults> candidates =
+      test_utils::getTriangleCandidatesInGrid(grid, kMinWeight);
+  const std::vector<marching_cubes::PerVoxelMarchingCubesResults>
+      morton_candidates =
+          test_utils::getTriangleCandidatesInGrid(morton_grid, kMinWeight);
+  EXPECT_GT(candidates.size(), 0);
+  ASSERT_EQ(candidates.size(), morton_candidates.size());
+  for (size_t i = 0; i < candidates.size(); i++) {
+    EXPECT_EQ(candidates[i].marching_cubes_table_index,
+              morton_candidates[i].marching_cubes_table_index);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(candidates[i].vertex_sdf[j],
+                morton_candidates[i].vertex_sdf[j]);
+      EXPECT_TRUE(candidates[i].vertex_coords[j] ==
+                  morton_candidates[i].vertex_coords[j]);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,395 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/map/accessors.h"
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/multi_resolution_layer.h"
+#include "nvblox/mapper/multi_resolution_updates.h"
+
+using namespace nvblox;
+
+constexpr float kFineVoxelSizeM = 0.1f;
+constexpr float kEps = 1e-5f;
+
+void setBlockConstant(const float distance, const float weight,
+                      TsdfBlock* block) {
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      block, [&](const Index3D&, TsdfVoxel* voxel) {
+        voxel->distance = distance;
+        voxel->weight = weight;
+      });
+}
+
+void setFineBlockConstant(const Index3D& block_index, const float distance,
+                          const float weight,
+                          MultiResolutionTsdfLayer* layer) {
+  auto block = layer->fine_layer().allocateBlockAtIndex(block_index);
+  if (layer->memory_type() == MemoryType::kDevice) {
+    auto block_host = block.clone(MemoryType::kHost);
+    setBlockConstant(distance, weight, block_host.get());
+    block.copyFrom(block_host);
+  } else {
+    setBlockConstant(distance, weight, block.get());
+  }
+}
+
+// Write the truncated distance to a plane into a (host accessible) block.
+void setBlockPlane(const Index3D& block_index, const Vector3f& normal,
+                   const float offset, TsdfLayer* layer) {
+  const float truncation_distance = 4.0f * layer->voxel_size();
+  auto block = layer->allocateBlockAtIndex(block_index);
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      block.get(), [&](const Index3D& voxel_index, TsdfVoxel* voxel) {
+        const Vector3f p_L = getCenterPositionFromBlockIndexAndVoxelIndex(
+            layer->block_size(), block_index, voxel_index);
+        voxel->distance = std::clamp(normal.dot(p_L) - offset,
+                                     -truncation_distance, truncation_distance);
+        voxel->weight = 1.0f;
+      });
+}
+
+void setEsdfVoxel(const Vector3f& p_L, const float distance_vox,
+                  EsdfLayer* layer) {
+  auto block = layer->allocateBlockAtIndex(
+      getBlockIndexFromPositionInLayer(layer->block_size(), p_L));
+  Index3D block_index;
+  Index3D voxel_index;
+  getBlockAndVoxelIndexFromPositionInLayer(layer->block_size(), p_L,
+                                           &block_index, &voxel_index);
+  EsdfVoxel& voxel =
+      block->voxels[voxel_index.x()][voxel_index.y()][voxel_index.z()];
+  voxel.observed = true;
+  voxel.squared_distance_vox = distance_vox * distance_vox;
+}
+
+TEST(MultiResolutionLayerTest, FineToCoarseBlockIndex) {
+  MultiResolutionTsdfLayer layer(kFineVoxelSizeM, MemoryType::kHost, 4);
+  EXPECT_EQ(layer.getCoarseBlockIndexFromFineBlockIndex(Index3D(0, 0, 0)),
+            Index3D(0, 0, 0));
+  EXPECT_EQ(layer.getCoarseBlockIndexFromFineBlockIndex(Index3D(3, 3, 3)),
+            Index3D(0, 0, 0));
+  EXPECT_EQ(layer.getCoarseBlockIndexFromFineBlockIndex(Index3D(4, 7, 8)),
+            Index3D(1, 1, 2));
+  EXPECT_EQ(layer.getCoarseBlockIndexFromFineBlockIndex(Index3D(-1, -4, -5)),
+            Index3D(-1, -1, -2));
+  EXPECT_NEAR(layer.coarse_voxel_size(), 4.0f * kFineVoxelSizeM, kEps);
+}
+
+TEST(MultiResolutionLayerTest, DownsampleTsdf) {
+  for (const MemoryType memory_type :
+       {MemoryType::kHost, MemoryType::kDevice}) {
+    constexpr int kCoarseningFactor = 2;
+    MultiResolutionTsdfLayer layer(kFineVoxelSizeM, memory_type,
+                                   kCoarseningFactor);
+
+    // The fine block (1,0,0) covers the upper half (in x) of coarse block
+    // (0,0,0).
+    constexpr float kDistance = 0.3f;
+    constexpr float kWeight = 2.0f;
+    setFineBlockConstant(Index3D(1, 0, 0), kDistance, kWeight, &layer);
+
+    const std::vector<Index3D> updated_coarse_blocks =
+        layer.downsampleToCoarseLevel({Index3D(1, 0, 0)}, CudaStreamOwning());
+    ASSERT_EQ(updated_coarse_blocks.size(), 1);
+    EXPECT_EQ(updated_coarse_blocks[0], Index3D(0, 0, 0));
+    EXPECT_EQ(layer.coarse_layer().numAllocatedBlocks(), 1);
+
+    // Check the coarse voxels.
+    TsdfBlock::ConstPtr coarse_block =
+        layer.coarse_layer().getBlockAtIndex(Index3D(0, 0, 0));
+    if (memory_type == MemoryType::kDevice) {
+      coarse_block = coarse_block.clone(MemoryType::kHost);
+    }
+    callFunctionOnAllVoxels<TsdfVoxel>(
+        *coarse_block, [&](const Index3D& voxel_index, const TsdfVoxel* voxel) {
+          if (voxel_index.x() >= TsdfBlock::kVoxelsPerSide / 2) {
+            EXPECT_NEAR(voxel->distance, kDistance, kEps);
+            EXPECT_NEAR(voxel->weight, kWeight, kEps);
+          } else {
+            EXPECT_EQ(voxel->weight, 0.0f);
+          }
+        });
+  }
+}
+
+TEST(MultiResolutionLayerTest, UnobservedVoxelsDoNotOverwrite) {
+  MultiResolutionTsdfLayer layer(kFineVoxelSizeM, MemoryType::kHost, 2);
+
+  // Coarse data from before.
+  auto coarse_block =
+      layer.coarse_layer().allocateBlockAtIndex(Index3D::Zero());
+  setBlockConstant(1.0f, 1.0f, coarse_block.get());
+
+  // A fine block without observations.
+  setFineBlockConstant(Index3D::Zero(), 0.5f, 0.0f, &layer);
+  layer.downsampleToCoarseLevel({Index3D::Zero()}, CudaStreamOwning());
+
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      *coarse_block, [&](const Index3D&, const TsdfVoxel* voxel) {
+        EXPECT_EQ(voxel->distance, 1.0f);
+        EXPECT_EQ(voxel->weight, 1.0f);
+      });
+}
+
+TEST(MultiResolutionLayerTest, DownsampleOccupancyKeepsFreeSpace) {
+  std::vector<OccupancyVoxel> fine_voxels(8);
+  OccupancyVoxel coarse_voxel;
+
+  // Free and unobserved children stay free.
+  for (int i = 1; i < 8; i++) {
+    fine_voxels[i].log_odds = -2.0f;
+  }
+  ASSERT_TRUE(VoxelDownsampler<OccupancyVoxel>::downsample(
+      fine_voxels.data(), fine_voxels.size(), &coarse_voxel));
+  EXPECT_EQ(coarse_voxel.log_odds, -2.0f);
+
+  // A single occupied child occupies the coarse voxel.
+  fine_voxels[3].log_odds = 1.0f;
+  ASSERT_TRUE(VoxelDownsampler<OccupancyVoxel>::downsample(
+      fine_voxels.data(), fine_voxels.size(), &coarse_voxel));
+  EXPECT_EQ(coarse_voxel.log_odds, 1.0f);
+
+  // Only unobserved children.
+  std::vector<OccupancyVoxel> unobserved_voxels(8);
+  EXPECT_FALSE(VoxelDownsampler<OccupancyVoxel>::downsample(
+      unobserved_voxels.data(), unobserved_voxels.size(), &coarse_voxel));
+}
+
+TEST(MultiResolutionLayerTest, MigrateBlocksOutsideFineRegion) {
+  MultiResolutionTsdfLayer layer(kFineVoxelSizeM, MemoryType::kHost, 2);
+  layer.fine_region_radius_m(1.0f);
+
+  // One block near the origin, one far away.
+  const Index3D near_block(0, 0, 0);
+  const Index3D far_block(20, 0, 0);
+  setFineBlockConstant(near_block, 0.1f, 1.0f, &layer);
+  setFineBlockConstant(far_block, 0.2f, 1.0f, &layer);
+  EXPECT_EQ(layer.fine_layer().numAllocatedBlocks(), 2);
+
+  std::vector<Index3D> updated_coarse_blocks;
+  const std::vector<Index3D> migrated_blocks = layer.updateFineRegion(
+      Vector3f::Zero(), CudaStreamOwning(), &updated_coarse_blocks);
+
+  ASSERT_EQ(migrated_blocks.size(), 1);
+  EXPECT_EQ(migrated_blocks[0], far_block);
+  ASSERT_EQ(updated_coarse_blocks.size(), 1);
+  EXPECT_EQ(updated_coarse_blocks[0], Index3D(10, 0, 0));
+  EXPECT_TRUE(layer.fine_layer().isBlockAllocated(near_block));
+  EXPECT_FALSE(layer.fine_layer().isBlockAllocated(far_block));
+  EXPECT_TRUE(layer.coarse_layer().isBlockAllocated(Index3D(10, 0, 0)));
+
+  // Queries fall back to the coarse level.
+  const Vector3f p_far_L = getCenterPositionFromBlockIndex(
+      layer.fine_layer().block_size(), far_block);
+  ResolutionLevel level;
+  auto voxel_and_flag = layer.getVoxel(p_far_L, &level);
+  EXPECT_TRUE(voxel_and_flag.second);
+  EXPECT_EQ(level, ResolutionLevel::kCoarse);
+  EXPECT_NEAR(voxel_and_flag.first.distance, 0.2f, kEps);
+
+  const Vector3f p_near_L = getCenterPositionFromBlockIndex(
+      layer.fine_layer().block_size(), near_block);
+  voxel_and_flag = layer.getVoxel(p_near_L, &level);
+  EXPECT_TRUE(voxel_and_flag.second);
+  EXPECT_EQ(level, ResolutionLevel::kFine);
+  EXPECT_NEAR(voxel_and_flag.first.distance, 0.1f, kEps);
+
+  // The coarse block is outside the fine region and should be meshed.
+  const std::vector<Index3D> coarse_blocks_to_mesh =
+      layer.getCoarseBlocksOutsideFineRegion();
+  ASSERT_EQ(coarse_blocks_to_mesh.size(), 1);
+  EXPECT_EQ(coarse_blocks_to_mesh[0], Index3D(10, 0, 0));
+}
+
+TEST(MultiResolutionLayerTest, UserDefinedFineRegion) {
+  MultiResolutionTsdfLayer layer(kFineVoxelSizeM, MemoryType::kHost, 2);
+  layer.fine_region_radius_m(1.0f);
+
+  const Index3D far_block(20, 0, 0);
+  setFineBlockConstant(far_block, 0.2f, 1.0f, &layer);
+
+  // Keep the far block fine through a user-defined region.
+  const float fine_block_size = layer.fine_layer().block_size();
+  layer.addFineRegion(AxisAlignedBoundingBox(
+      Vector3f(20.5f * fine_block_size, 0.1f, 0.1f),
+      Vector3f(20.6f * fine_block_size, 0.2f, 0.2f)));
+  EXPECT_TRUE(layer.isFineBlockInFineRegion(far_block));
+
+  EXPECT_TRUE(layer.updateFineRegion(Vector3f::Zero(), CudaStreamOwning())
+                  .empty());
+  EXPECT_TRUE(layer.fine_layer().isBlockAllocated(far_block));
+
+  // Once the region is removed the block migrates.
+  layer.clearFineRegions();
+  EXPECT_EQ(
+      layer.updateFineRegion(Vector3f::Zero(), CudaStreamOwning()).size(), 1);
+  EXPECT_FALSE(layer.fine_layer().isBlockAllocated(far_block));
+}
+
+TEST(MultiResolutionLayerTest, UnobservedFineVoxelsFallBackToCoarse) {
+  MultiResolutionTsdfLayer layer(kFineVoxelSizeM, MemoryType::kHost, 2);
+  auto coarse_block =
+      layer.coarse_layer().allocateBlockAtIndex(Index3D::Zero());
+  setBlockConstant(0.3f, 1.0f, coarse_block.get());
+  // The fine block is allocated, but not observed.
+  setFineBlockConstant(Index3D::Zero(), 0.0f, 0.0f, &layer);
+
+  ResolutionLevel level;
+  const auto voxel_and_flag =
+      layer.getVoxel(Vector3f(0.05f, 0.05f, 0.05f), &level);
+  EXPECT_TRUE(voxel_and_flag.second);
+  EXPECT_EQ(level, ResolutionLevel::kCoarse);
+  EXPECT_NEAR(voxel_and_flag.first.distance, 0.3f, kEps);
+}
+
+TEST(MultiResolutionLayerTest, EsdfQueryReturnsClosestLevel) {
+  EsdfLayer fine_esdf_layer(kFineVoxelSizeM, MemoryType::kHost);
+  EsdfLayer coarse_esdf_layer(2.0f * kFineVoxelSizeM, MemoryType::kHost);
+  const Vector3f p_L(0.05f, 0.05f, 0.05f);
+  float distance_m;
+  ResolutionLevel level;
+  EXPECT_FALSE(getMultiResolutionEsdfDistance(
+      fine_esdf_layer, coarse_esdf_layer, p_L, &distance_m, &level));
+
+  // Only the coarse level sees the closer obstacle.
+  setEsdfVoxel(p_L, 10.0f, &fine_esdf_layer);
+  setEsdfVoxel(p_L, 2.0f, &coarse_esdf_layer);
+  EXPECT_TRUE(getMultiResolutionEsdfDistance(
+      fine_esdf_layer, coarse_esdf_layer, p_L, &distance_m, &level));
+  EXPECT_NEAR(distance_m, 0.4f, kEps);
+  EXPECT_EQ(level, ResolutionLevel::kCoarse);
+
+  // The fine level is more precise.
+  setEsdfVoxel(p_L, 3.0f, &fine_esdf_layer);
+  EXPECT_TRUE(getMultiResolutionEsdfDistance(
+      fine_esdf_layer, coarse_esdf_layer, p_L, &distance_m, &level));
+  EXPECT_NEAR(distance_m, 0.3f, kEps);
+  EXPECT_EQ(level, ResolutionLevel::kFine);
+}
+
+// Coarsening factor 2: fine blocks have a side of 0.8m and coarse blocks of
+// 1.6m. The fine region only covers the coarse block (0,0,0).
+class MultiResolutionUpdatesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    layer_.fine_region_radius_m(0.1f);
+    layer_.updateFineRegion(Vector3f(0.8f, 0.8f, 0.8f), CudaStreamOwning());
+    ASSERT_TRUE(layer_.isCoarseBlockInFineRegion(Index3D(0, 0, 0)));
+    ASSERT_FALSE(layer_.isCoarseBlockInFineRegion(Index3D(1, 0, 0)));
+    ASSERT_TRUE(layer_.isCoarseBlockOnFineRegionBoundary(Index3D(0, 0, 0)));
+    for (int x = 0; x < 2; x++) {
+      for (int y = 0; y < 2; y++) {
+        for (int z = 0; z < 2; z++) {
+          fine_blocks_.push_back(Index3D(x, y, z));
+        }
+      }
+    }
+  }
+
+  MultiResolutionTsdfLayer layer_{kFineVoxelSizeM, MemoryType::kUnified, 2};
+  std::vector<Index3D> fine_blocks_;
+};
+
+TEST_F(MultiResolutionUpdatesTest, EsdfSeesCoarseObstaclesAtBoundary) {
+  // Free space in the fine region...
+  for (const Index3D& block_index : fine_blocks_) {
+    setFineBlockConstant(block_index, 4.0f * kFineVoxelSizeM, 1.0f, &layer_);
+  }
+  std::vector<Index3D> coarse_blocks =
+      layer_.downsampleToCoarseLevel(fine_blocks_, CudaStreamOwning());
+  // ...and a wall at x = 1.8m, just outside of it.
+  setBlockPlane(Index3D(1, 0, 0), Vector3f::UnitX(), 1.8f,
+                &layer_.coarse_layer());
+  coarse_blocks.push_back(Index3D(1, 0, 0));
+
+  EsdfIntegrator esdf_integrator;
+  EsdfLayer fine_esdf_layer(layer_.fine_voxel_size(), MemoryType::kUnified);
+  EsdfLayer coarse_esdf_layer(layer_.coarse_voxel_size(),
+                              MemoryType::kUnified);
+  updateMultiResolutionEsdf(layer_, fine_blocks_, coarse_blocks,
+                            &esdf_integrator, &fine_esdf_layer,
+                            &coarse_esdf_layer);
+
+  // A point in the fine region, 0.3m from the wall. The fine level alone
+  // doesn't see the wall.
+  const Vector3f p_L(1.5f, 0.8f, 0.8f);
+  float distance_m;
+  ASSERT_TRUE(getMultiResolutionEsdfDistance(fine_esdf_layer,
+                                             coarse_esdf_layer, p_L,
+                                             &distance_m));
+  EXPECT_LT(distance_m, 0.3f + layer_.coarse_voxel_size());
+}
+
+TEST_F(MultiResolutionUpdatesTest, MeshHasNoCrackAtBoundary) {
+  // A floor at z = 0.6m through both levels.
+  for (const Index3D& block_index : fine_blocks_) {
+    setBlockPlane(block_index, Vector3f::UnitZ(), 0.6f, &layer_.fine_layer());
+  }
+  std::vector<Index3D> coarse_blocks =
+      layer_.downsampleToCoarseLevel(fine_blocks_, CudaStreamOwning());
+  setBlockPlane(Index3D(1, 0, 0), Vector3f::UnitZ(), 0.6f,
+                &layer_.coarse_layer());
+  coarse_blocks.push_back(Index3D(1, 0, 0));
+
+  MeshIntegrator mesh_integrator;
+  MeshLayer fine_mesh_layer(layer_.fine_layer().block_size(),
+                            MemoryType::kUnified);
+  MeshLayer coarse_mesh_layer(layer_.coarse_layer().block_size(),
+                              MemoryType::kUnified);
+  updateMultiResolutionMesh(layer_, fine_blocks_, coarse_blocks,
+                            &mesh_integrator, &fine_mesh_layer,
+                            &coarse_mesh_layer);
+  EXPECT_GT(fine_mesh_layer.numAllocatedBlocks(), 0);
+  EXPECT_TRUE(coarse_mesh_layer.isBlockAllocated(Index3D(1, 0, 0)));
+
+  // The fine mesh ends half a fine voxel before the level boundary at x =
+  // 1.6m, and the coarse mesh outside of the fine region starts half a coarse
+  // voxel after it. The coarse band inside the fine region covers the gap.
+  float max_fine_x = 0.0f;
+  for (const Index3D& block_index : fine_mesh_layer.getAllBlockIndices()) {
+    for (const Vector3f& vertex :
+         fine_mesh_layer.getBlockAtIndex(block_index)->vertices) {
+      max_fine_x = std::max(max_fine_x, vertex.x());
+    }
+  }
+  float min_coarse_x = std::numeric_limits<float>::max();
+  for (const Index3D& block_index : coarse_mesh_layer.getAllBlockIndices()) {
+    for (const Vector3f& vertex :
+         coarse_mesh_layer.getBlockAtIndex(block_index)->vertices) {
+      min_coarse_x = std::min(min_coarse_x, vertex.x());
+    }
+  }
+  EXPECT_LE(min_coarse_x, max_fine_x);
+
+  // Moving the fine region away removes the band.
+  layer_.updateFineRegion(Vector3f(100.0f, 0.0f, 0.0f), CudaStreamOwning());
+  updateMultiResolutionMesh(layer_, {}, {}, &mesh_integrator,
+                            &fine_mesh_layer, &coarse_mesh_layer);
+  EXPECT_EQ(fine_mesh_layer.numAllocatedBlocks(), 0);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,277 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "nvblox/core/log_odds.h"
+#include "nvblox/core/quantized_log_odds.h"
+#include "nvblox/integrators/esdf_integrator.h"
+#include "nvblox/integrators/occupancy_decay_integrator.h"
+#include "nvblox/integrators/projective_occupancy_integrator.h"
+#include "nvblox/interpolation/interpolation_3d.h"
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/primitives/scene.h"
+
+using namespace nvblox;
+
+constexpr float kVoxelSizeM = 0.05f;
+constexpr int kNumFrames = 3;
+
+// Each update rounds the summand to the nearest fixed point value, so the
+// error grows by at most half a fixed point unit per frame.
+constexpr float kMaxLogOddsError =
+    kNumFrames * 0.5f / QuantizedLogOdds::kScale + 1e-6f;
+
+class QuantizedOccupancyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scene_.aabb() = AxisAlignedBoundingBox(Vector3f(-3.0f, -3.0f, -1.0f),
+                                           Vector3f(3.0f, 3.0f, 3.0f));
+    scene_.addGroundLevel(-0.5f);
+    scene_.addCeiling(2.5f);
+    scene_.addPlaneBoundaries(-2.5f, 2.5f, -2.5f, 2.5f);
+    scene_.addPrimitive(std::make_unique<primitives::Sphere>(
+        Vector3f(1.5f, 0.0f, 0.5f), 0.5f));
+    // Camera at the origin looking along the x-axis.
+    T_S_C_ = Transform::Identity();
+    T_S_C_.prerotate(Eigen::Quaternionf(0.5, 0.5, 0.5, 0.5));
+    scene_.generateDepthImageFromScene(camera_, T_S_C_, 10.0f, &depth_image_);
+  }
+
+  primitives::Scene scene_;
+  Camera camera_ = Camera(300, 300, 320, 240, 640, 480);
+  Transform T_S_C_;
+  DepthImage depth_image_ = DepthImage(480, 640, MemoryType::kUnified);
+};
+
+TEST(QuantizedLogOddsTest, Conversion) {
+  // Multiples of the resolution survive the round trip.
+  for (const float value : {0.0f, 1.0f, -2.5f, 0.125f, 7.0f, -7.0f}) {
+    EXPECT_EQ(static_cast<float>(QuantizedLogOdds(value)), value);
+  }
+  // Others are rounded to the nearest fixed point value.
+  for (float value = -7.9f; value < 7.9f; value += 0.0137f) {
+    const float converted = QuantizedLogOdds(value);
+    EXPECT_LE(std::abs(converted - value),
+              0.5f / QuantizedLogOdds::kScale + 1e-7f);
+  }
+  // Out of range values saturate, NaN becomes zero (probability 0.5).
+  EXPECT_EQ(QuantizedLogOdds(100.0f).value(), QuantizedLogOdds::kMaxValue);
+  EXPECT_EQ(QuantizedLogOdds(-100.0f).value(), QuantizedLogOdds::kMinValue);
+  EXPECT_EQ(QuantizedLogOdds(std::numeric_limits<float>::quiet_NaN()).value(),
+            0);
+  // The log odds of all probabilities produced by logOddsFromProbability()
+  // are in range.
+  EXPECT_LT(std::abs(logOddsFromProbability(0.0f)),
+            QuantizedLogOdds::kMaxValue / QuantizedLogOdds::kScale);
+}
+
+TEST(QuantizedLogOddsTest, AddSaturating) {
+  QuantizedLogOdds log_odds(0.0f);
+  log_odds.addSaturating(100, -150, 150);
+  EXPECT_EQ(log_odds.value(), 100);
+  log_odds.addSaturating(100, -150, 150);
+  EXPECT_EQ(log_odds.value(), 150);
+  log_odds.addSaturating(-1000, -150, 150);
+  EXPECT_EQ(log_odds.value(), -150);
+  // No wrap around at the ends of the int16 range.
+  log_odds = QuantizedLogOdds(-100.0f);
+  log_odds.addSaturating(-1000, QuantizedLogOdds::kMinValue,
+                         QuantizedLogOdds::kMaxValue);
+  EXPECT_EQ(log_odds.value(), QuantizedLogOdds::kMinValue);
+}
+
+TEST(QuantizedOccupancyVoxelTest, Size) {
+  EXPECT_EQ(sizeof(QuantizedOccupancyVoxel), 2);
+  EXPECT_EQ(2 * sizeof(QuantizedOccupancyVoxel), sizeof(OccupancyVoxel));
+  EXPECT_EQ(2 * sizeof(QuantizedOccupancyBlock::voxels),
+            sizeof(OccupancyBlock::voxels));
+  EXPECT_EQ(QuantizedOccupancyVoxel().log_odds.value(), 0);
+}
+
+TEST_F(QuantizedOccupancyTest, IntegrateMatchesFullPrecision) {
+  OccupancyLayer occupancy_layer(kVoxelSizeM, MemoryType::kUnified);
+  QuantizedOccupancyLayer quantized_layer(kVoxelSizeM, MemoryType::kUnified);
+
+  ProjectiveOccupancyIntegrator integrator;
+  for (int i = 0; i < kNumFrames; i++) {
+    integrator.integrateFrame(depth_image_, T_S_C_, camera_, &occupancy_layer);
+    integrator.integrateFrame(depth_image_, T_S_C_, camera_, &quantized_layer);
+  }
+  ASSERT_EQ(occupancy_layer.numAllocatedBlocks(),
+            quantized_layer.numAllocatedBlocks());
+  EXPECT_GT(occupancy_layer.numAllocatedBlocks(), 0);
+
+  int num_observed_voxels = 0;
+  float max_log_odds_error = 0.0f;
+  for (const Index3D& block_index : occupancy_layer.getAllBlockIndices()) {
+    const OccupancyBlock::ConstPtr block =
+        occupancy_layer.getBlockAtIndex(block_index);
+    const QuantizedOccupancyBlock::ConstPtr quantized_block =
+        quantized_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(quantized_block);
+    for (int x = 0; x < OccupancyBlock::kVoxelsPerSide; x++) {
+      for (int y = 0; y < OccupancyBlock::kVoxelsPerSide; y++) {
+        for (int z = 0; z < OccupancyBlock::kVoxelsPerSide; z++) {
+          const float log_odds = block->voxels[x][y][z].log_odds;
+          const float quantized_log_odds =
+              quantized_block->voxels[x][y][z].log_odds;
+          num_observed_voxels += log_odds != 0.0f;
+          max_log_odds_error = std::max(
+              max_log_odds_error, std::abs(quantized_log_odds - log_odds));
+        }
+      }
+    }
+  }
+  LOG(INFO) << "Compared " << num_observed_voxels
+            << " observed voxels. Max log odds error: " << max_log_odds_error;
+  EXPECT_GT(num_observed_voxels, 0);
+  EXPECT_LE(max_log_odds_error, kMaxLogOddsError);
+
+  // Interpolation works on both layers.
+  const Vector3f free_point(0.5f, 0.0f, 0.5f);
+  float probability = 0.0f;
+  float quantized_probability = 0.0f;
+  ASSERT_TRUE(interpolation::interpolateOnCPU(free_point, occupancy_layer,
+                                              &probability));
+  ASSERT_TRUE(interpolation::interpolateOnCPU(free_point, quantized_layer,
+                                              &quantized_probability));
+  EXPECT_LT(probability, 0.5f);
+  EXPECT_NEAR(probability, quantized_probability, 1e-3f);
+}
+
+TEST_F(QuantizedOccupancyTest, Esdf) {
+  OccupancyLayer occupancy_layer(kVoxelSizeM, MemoryType::kDevice);
+  QuantizedOccupancyLayer quantized_layer(kVoxelSizeM, MemoryType::kDevice);
+  ProjectiveOccupancyIntegrator integrator;
+  for (int i = 0; i < kNumFrames; i++) {
+    integrator.integrateFrame(depth_image_, T_S_C_, camera_, &occupancy_layer);
+    integrator.integrateFrame(depth_image_, T_S_C_, camera_, &quantized_layer);
+  }
+
+  EsdfIntegrator esdf_integrator;
+  EsdfLayer esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  EsdfLayer quantized_esdf_layer(kVoxelSizeM, MemoryType::kUnified);
+  esdf_integrator.integrateBlocks(occupancy_layer,
+                                  occupancy_layer.getAllBlockIndices(),
+                                  &esdf_layer);
+  esdf_integrator.integrateBlocks(quantized_layer,
+                                  quantized_layer.getAllBlockIndices(),
+                                  &quantized_esdf_layer);
+  int num_sites = 0;
+  int num_differing_sites = 0;
+  for (const Index3D& block_index : esdf_layer.getAllBlockIndices()) {
+    const EsdfBlock::ConstPtr block = esdf_layer.getBlockAtIndex(block_index);
+    const EsdfBlock::ConstPtr quantized_block =
+        quantized_esdf_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(quantized_block);
+    for (int x = 0; x < EsdfBlock::kVoxelsPerSide; x++) {
+      for (int y = 0; y < EsdfBlock::kVoxelsPerSide; y++) {
+        for (int z = 0; z < EsdfBlock::kVoxelsPerSide; z++) {
+          const bool is_site = block->voxels[x][y][z].is_site;
+          num_sites += is_site;
+          num_differing_sites +=
+              is_site != quantized_block->voxels[x][y][z].is_site;
+        }
+      }
+    }
+  }
+  EXPECT_GT(num_sites, 0);
+  EXPECT_LT(num_differing_sites, 0.01f * num_sites);
+}
+
+TEST_F(QuantizedOccupancyTest, Decay) {
+  QuantizedOccupancyLayer quantized_layer(kVoxelSizeM, MemoryType::kUnified);
+  ProjectiveOccupancyIntegrator integrator;
+  integrator.integrateFrame(depth_image_, T_S_C_, camera_, &quantized_layer);
+  const int num_blocks = quantized_layer.numAllocatedBlocks();
+  ASSERT_GT(num_blocks, 0);
+
+  // Decaying repeatedly eventually deallocates all blocks.
+  OccupancyDecayIntegrator decay_integrator(DecayMode::kDecayToDeallocate);
+  CudaStreamOwning cuda_stream;
+  int num_deallocated_blocks = 0;
+  constexpr int kMaxNumDecays = 1000;
+  for (int i = 0;
+       i < kMaxNumDecays && quantized_layer.numAllocatedBlocks() > 0; i++) {
+    num_deallocated_blocks +=
+        decay_integrator
+            .decay(&quantized_layer, std::nullopt, std::nullopt, cuda_stream)
+            .size();
+  }
+  EXPECT_EQ(quantized_layer.numAllocatedBlocks(), 0);
+  EXPECT_EQ(num_deallocated_blocks, num_blocks);
+}
+
+TEST_F(QuantizedOccupancyTest, Mapper) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kDevice,
+                ProjectiveLayerType::kQuantizedOccupancy);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  EXPECT_GT(mapper.quantized_occupancy_layer().numAllocatedBlocks(), 0);
+  EXPECT_EQ(mapper.occupancy_layer().numAllocatedBlocks(), 0);
+
+  mapper.updateEsdf();
+  EXPECT_GT(mapper.esdf_layer().numAllocatedBlocks(), 0);
+
+  // The quantized layer holds half the memory of a full precision one, and
+  // the full precision layer it replaces doesn't preallocate blocks.
+  const MemoryReport report = mapper.getMemoryReport();
+  for (const MemoryReportItem& item : report.items()) {
+    if (item.name == "quantized_occupancy_layer/blocks") {
+      EXPECT_EQ(item.usage.device_bytes,
+                item.count * sizeof(QuantizedOccupancyBlock));
+    }
+    if (item.name == "occupancy_layer/memory_pool") {
+      EXPECT_EQ(item.count, 0);
+    }
+  }
+  // Mappers which don't use the quantized layer don't create it.
+  EXPECT_FALSE(Mapper(kVoxelSizeM, MemoryType::kDevice,
+                      ProjectiveLayerType::kOccupancy)
+                   .layers()
+                   .exists<QuantizedOccupancyLayer>());
+
+  mapper.markUnobservedTsdfFreeInsideRadius(Vector3f::Zero(), 0.5f);
+  mapper.decayOccupancy();
+  mapper.clearOutsideRadius(Vector3f::Zero(), 2.0f);
+  EXPECT_GT(mapper.quantized_occupancy_layer().numAllocatedBlocks(), 0);
+}
+
+TEST_F(QuantizedOccupancyTest, SaveAndLoadMap) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kDevice,
+                ProjectiveLayerType::kQuantizedOccupancy);
+  mapper.integrateDepth(depth_image_, T_S_C_, camera_);
+  const std::string filename = "quantized_occupancy_map.nvblx";
+  ASSERT_TRUE(mapper.saveLayerCake(filename));
+
+  Mapper loaded_mapper(kVoxelSizeM, MemoryType::kDevice,
+                       ProjectiveLayerType::kQuantizedOccupancy);
+  ASSERT_TRUE(loaded_mapper.loadMap(filename));
+  EXPECT_EQ(loaded_mapper.quantized_occupancy_layer().numAllocatedBlocks(),
+            mapper.quantized_occupancy_layer().numAllocatedBlocks());
+  loaded_mapper.updateEsdf();
+  EXPECT_GT(loaded_mapper.esdf_layer().numAllocatedBlocks(), 0);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
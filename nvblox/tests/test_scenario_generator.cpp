@@ -0,0 +1,177 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/mapper/mapper.h"
+#include "nvblox/primitives/scenario_generator.h"
+
+using namespace nvblox;
+
+class ScenarioGeneratorTest
+    : public ::testing::TestWithParam<primitives::ScenarioType> {
+ protected:
+  primitives::ScenarioParams getSmallParams() const {
+    primitives::ScenarioParams params;
+    params.type = GetParam();
+    params.num_cells_x = 2;
+    params.num_cells_y = 2;
+    // Big steps, to keep the test fast.
+    params.sensor_speed_mps = 20.0f;
+    return params;
+  }
+
+  const Camera camera_{300, 300, 320, 240, 640, 480};
+  const Lidar lidar_{512, 16, 0.0f, 100.0f, 30.0f * M_PI / 180.0f};
+};
+
+TEST_P(ScenarioGeneratorTest, Deterministic) {
+  const primitives::ScenarioParams params = getSmallParams();
+  const primitives::Scenario scenario_1 = primitives::createScenario(params);
+  const primitives::Scenario scenario_2 = primitives::createScenario(params);
+  ASSERT_EQ(scenario_1.num_frames(), scenario_2.num_frames());
+  ASSERT_GT(scenario_1.num_frames(), 0);
+
+  // Same poses and the same world, as seen by the sensor.
+  const int frame_idx = scenario_1.num_frames() / 2;
+  EXPECT_TRUE(scenario_1.T_S_B[frame_idx].isApprox(
+      scenario_2.T_S_B[frame_idx]));
+  DepthImage depth_1(camera_.rows(), camera_.cols(), MemoryType::kUnified);
+  DepthImage depth_2(camera_.rows(), camera_.cols(), MemoryType::kUnified);
+  scenario_1.scene.generateDepthImageFromScene(
+      camera_, scenario_1.getCameraPose(frame_idx), scenario_1.max_range_m,
+      &depth_1);
+  scenario_2.scene.generateDepthImageFromScene(
+      camera_, scenario_2.getCameraPose(frame_idx), scenario_2.max_range_m,
+      &depth_2);
+  for (int i = 0; i < depth_1.numel(); i++) {
+    EXPECT_EQ(depth_1(i), depth_2(i));
+  }
+
+  // Another seed, another world.
+  primitives::ScenarioParams other_params = params;
+  other_params.seed = params.seed + 1;
+  const primitives::Scenario scenario_3 =
+      primitives::createScenario(other_params);
+  DepthImage depth_3(camera_.rows(), camera_.cols(), MemoryType::kUnified);
+  int num_different_pixels = 0;
+  constexpr int kFrameStride = 10;
+  for (int frame = 0; frame < scenario_3.num_frames(); frame += kFrameStride) {
+    scenario_1.scene.generateDepthImageFromScene(
+        camera_, scenario_1.getCameraPose(frame), scenario_1.max_range_m,
+        &depth_1);
+    scenario_3.scene.generateDepthImageFromScene(
+        camera_, scenario_3.getCameraPose(frame), scenario_3.max_range_m,
+        &depth_3);
+    for (int i = 0; i < depth_1.numel(); i++) {
+      num_different_pixels += depth_1(i) != depth_3(i);
+    }
+  }
+  EXPECT_GT(num_different_pixels, 0);
+}
+
+TEST_P(ScenarioGeneratorTest, TrajectoryIsFreeAndInBounds) {
+  const primitives::Scenario scenario =
+      primitives::createScenario(getSmallParams());
+  ASSERT_EQ(scenario.timestamps_ms.size(), scenario.T_S_B.size());
+  constexpr float kMinClearanceM = 0.5f;
+  for (int i = 0; i < scenario.num_frames(); i++) {
+    const Vector3f position = scenario.T_S_B[i].translation();
+    EXPECT_TRUE(scenario.scene.aabb().contains(position));
+    EXPECT_GT(scenario.scene.getSignedDistanceToPoint(position, 10.0f),
+              kMinClearanceM)
+        << "Frame " << i << " at " << position.transpose();
+    if (i > 0) {
+      EXPECT_GT(scenario.timestamps_ms[i], scenario.timestamps_ms[i - 1]);
+    }
+  }
+}
+
+TEST_P(ScenarioGeneratorTest, SensorsSeeTheWorld) {
+  const primitives::Scenario scenario =
+      primitives::createScenario(getSmallParams());
+  const int frame_idx = scenario.num_frames() / 3;
+
+  DepthImage depth(camera_.rows(), camera_.cols(), MemoryType::kUnified);
+  scenario.scene.generateDepthImageFromScene(
+      camera_, scenario.getCameraPose(frame_idx), scenario.max_range_m,
+      &depth);
+  int num_valid_pixels = 0;
+  for (int i = 0; i < depth.numel(); i++) {
+    num_valid_pixels += depth(i) > 0.0f;
+  }
+  EXPECT_GT(num_valid_pixels, depth.numel() / 4);
+
+  DepthImage lidar_depth(lidar_.rows(), lidar_.cols(), MemoryType::kUnified);
+  scenario.scene.generateDepthImageFromScene(
+      lidar_, scenario.getLidarPose(frame_idx), scenario.max_range_m,
+      &lidar_depth);
+  num_valid_pixels = 0;
+  for (int i = 0; i < lidar_depth.numel(); i++) {
+    num_valid_pixels += lidar_depth(i) > 0.0f;
+  }
+  EXPECT_GT(num_valid_pixels, 0);
+}
+
+TEST_P(ScenarioGeneratorTest, ScalesWithCellsAndLaps) {
+  primitives::ScenarioParams params = getSmallParams();
+  const primitives::Scenario small = primitives::createScenario(params);
+  params.num_cells_x *= 2;
+  const primitives::Scenario large = primitives::createScenario(params);
+  EXPECT_GT(large.num_frames(), small.num_frames());
+  EXPECT_GT(large.scene.aabb().volume(), small.scene.aabb().volume());
+
+  // The second lap goes back along the first.
+  params.num_laps = 2;
+  const primitives::Scenario two_laps = primitives::createScenario(params);
+  EXPECT_NEAR(two_laps.num_frames(), 2 * large.num_frames(), 2);
+  const float step_m = params.sensor_speed_mps * params.frame_period_s;
+  EXPECT_LT((two_laps.T_S_B.back().translation() -
+             large.T_S_B.front().translation())
+                .norm(),
+            step_m);
+}
+
+TEST_P(ScenarioGeneratorTest, ReplayThroughMapper) {
+  const primitives::Scenario scenario =
+      primitives::createScenario(getSmallParams());
+  Mapper mapper(0.1f, MemoryType::kDevice);
+  DepthImage depth(camera_.rows(), camera_.cols(), MemoryType::kUnified);
+  size_t num_blocks = 0;
+  constexpr int kNumFrames = 5;
+  for (int i = 0; i < std::min(kNumFrames, scenario.num_frames()); i++) {
+    const Transform T_S_C = scenario.getCameraPose(i);
+    scenario.scene.generateDepthImageFromScene(camera_, T_S_C,
+                                               scenario.max_range_m, &depth);
+    mapper.integrateDepth(depth, T_S_C, camera_);
+    // Moving through the world allocates blocks.
+    EXPECT_GE(mapper.tsdf_layer().numAllocatedBlocks(), num_blocks);
+    num_blocks = mapper.tsdf_layer().numAllocatedBlocks();
+  }
+  EXPECT_GT(num_blocks, 0);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    ScenarioTypes, ScenarioGeneratorTest,
+    ::testing::Values(primitives::ScenarioType::kWarehouse,
+                      primitives::ScenarioType::kCityBlocks));
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
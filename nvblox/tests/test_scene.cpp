@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "nvblox/io/image_io.h"
 #include "nvblox/primitives/scene.h"
+#include "nvblox/tests/utils.h"
 
 using namespace nvblox;
 
@@ -141,6 +142,203 @@ TEST_F(SceneTest, PlaneSceneVerticalOffset) {
   }
 }
 
+// Adds the same random primitives to a scene and a list, such that queries
+// through the scene's hierarchy can be checked against testing all primitives.
+void addRandomPrimitives(
+    int num_primitives, primitives::Scene* scene,
+    std::vector<std::unique_ptr<primitives::Primitive>>* primitives) {
+  auto random_position = []() {
+    return Vector3f(test_utils::randomFloatInRange(-3.0f, 3.0f),
+                    test_utils::randomFloatInRange(-3.0f, 3.0f),
+                    test_utils::randomFloatInRange(0.0f, 3.0f));
+  };
+  for (int i = 0; i < num_primitives; i++) {
+    const Vector3f center = random_position();
+    const float size = test_utils::randomFloatInRange(0.05f, 0.3f);
+    for (int copy = 0; copy < 2; copy++) {
+      std::unique_ptr<primitives::Primitive> primitive;
+      switch (i % 3) {
+        case 0:
+          primitive = std::make_unique<primitives::Sphere>(center, size);
+          break;
+        case 1:
+          primitive = std::make_unique<primitives::Cube>(
+              center, Vector3f(size, 2.0f * size, size));
+          break;
+        default:
+          primitive =
+              std::make_unique<primitives::Cylinder>(center, size, 2.0f * size);
+          break;
+      }
+      if (copy == 0) {
+        scene->addPrimitive(std::move(primitive));
+      } else {
+        primitives->push_back(std::move(primitive));
+      }
+    }
+  }
+  scene->addGroundLevel(0.0f);
+  primitives->push_back(std::make_unique<primitives::Plane>(
+      Vector3f(0.0f, 0.0f, 0.0f), Vector3f(0.0f, 0.0f, 1.0f)));
+}
+
+TEST_F(SceneTest, BvhMatchesAllPrimitives) {
+  constexpr int kNumPrimitives = 500;
+  constexpr int kNumQueries = 1000;
+  constexpr float kMaxDist = 10.0f;
+  std::vector<std::unique_ptr<primitives::Primitive>> primitives;
+  addRandomPrimitives(kNumPrimitives, &scene_, &primitives);
+
+  int num_hits = 0;
+  int num_inside = 0;
+  int num_below_ground = 0;
+  for (int i = 0; i < kNumQueries; i++) {
+    // Random points, also below the ground plane, and points inside the
+    // (possibly overlapping) primitives. Where a primitive reaches below the
+    // ground, a point just under the ground is deeper inside the primitive
+    // than inside the ground.
+    Vector3f point(test_utils::randomFloatInRange(-4.0f, 4.0f),
+                   test_utils::randomFloatInRange(-4.0f, 4.0f),
+                   test_utils::randomFloatInRange(-1.0f, 4.0f));
+    AxisAlignedBoundingBox aabb;
+    if (i % 2 == 1 && primitives[i % kNumPrimitives]->getAABB(&aabb)) {
+      point = aabb.center();
+      if (aabb.min().z() < 0.0f && i % 4 == 3) {
+        point.z() = 0.1f * aabb.min().z();
+      }
+    }
+
+    // Distances
+    float expected_dist = kMaxDist;
+    for (const auto& primitive : primitives) {
+      expected_dist =
+          std::min(expected_dist, primitive->getDistanceToPoint(point));
+    }
+    EXPECT_NEAR(scene_.getSignedDistanceToPoint(point, kMaxDist),
+                expected_dist, kFloatEpsilon);
+    if (expected_dist < 0.0f) {
+      ++num_inside;
+      if (point.z() < 0.0f) {
+        ++num_below_ground;
+      }
+    }
+
+    // Rays
+    const Vector3f direction =
+        Vector3f(test_utils::randomFloatInRange(-1.0f, 1.0f),
+                 test_utils::randomFloatInRange(-1.0f, 1.0f),
+                 test_utils::randomFloatInRange(-1.0f, 1.0f))
+            .normalized();
+    bool expected_hit = false;
+    float expected_ray_dist = kMaxDist;
+    for (const auto& primitive : primitives) {
+      Vector3f intersection;
+      float ray_dist;
+      if (primitive->getRayIntersection(point, direction, kMaxDist,
+                                        &intersection, &ray_dist) &&
+          (!expected_hit || ray_dist < expected_ray_dist)) {
+        expected_hit = true;
+        expected_ray_dist = ray_dist;
+      }
+    }
+    Vector3f intersection;
+    float ray_dist;
+    const bool hit = scene_.getRayIntersection(point, direction, kMaxDist,
+                                               &intersection, &ray_dist);
+    EXPECT_EQ(hit, expected_hit);
+    if (hit && expected_hit) {
+      ++num_hits;
+      EXPECT_NEAR(ray_dist, expected_ray_dist, kFloatEpsilon);
+    }
+  }
+  EXPECT_GT(num_hits, 0);
+  EXPECT_GT(num_inside, 0);
+  EXPECT_GT(num_below_ground, 0);
+}
+
+TEST_F(SceneTest, MultiThreadedGenerationMatchesSingleThreaded) {
+  std::vector<std::unique_ptr<primitives::Primitive>> primitives;
+  addRandomPrimitives(100, &scene_, &primitives);
+  constexpr float kMaxDist = 10.0f;
+  Transform T_S_C = Transform::Identity();
+  T_S_C.pretranslate(Vector3f(0.0f, 0.0f, 5.0f));
+  T_S_C.prerotate(
+      Eigen::AngleAxisf(M_PI, Vector3f::UnitX()).toRotationMatrix());
+
+  scene_.num_threads(1);
+  DepthImage single_threaded_frame(camera_.height(), camera_.width(),
+                                   MemoryType::kUnified);
+  scene_.generateDepthImageFromScene(camera_, T_S_C, kMaxDist,
+                                     &single_threaded_frame);
+  TsdfLayer single_threaded_layer(0.1f, MemoryType::kUnified);
+  scene_.generateLayerFromScene(1.0f, &single_threaded_layer);
+
+  scene_.num_threads(4);
+  DepthImage multi_threaded_frame(camera_.height(), camera_.width(),
+                                  MemoryType::kUnified);
+  scene_.generateDepthImageFromScene(camera_, T_S_C, kMaxDist,
+                                     &multi_threaded_frame);
+  TsdfLayer multi_threaded_layer(0.1f, MemoryType::kUnified);
+  scene_.generateLayerFromScene(1.0f, &multi_threaded_layer);
+
+  int num_valid_pixels = 0;
+  for (int lin_idx = 0; lin_idx < single_threaded_frame.numel(); lin_idx++) {
+    EXPECT_EQ(multi_threaded_frame(lin_idx), single_threaded_frame(lin_idx));
+    num_valid_pixels += single_threaded_frame(lin_idx) > 0.0f;
+  }
+  EXPECT_GT(num_valid_pixels, 0);
+
+  ASSERT_EQ(multi_threaded_layer.numAllocatedBlocks(),
+            single_threaded_layer.numAllocatedBlocks());
+  for (const Index3D& block_index :
+       single_threaded_layer.getAllBlockIndices()) {
+    const TsdfBlock::ConstPtr single_threaded_block =
+        single_threaded_layer.getBlockAtIndex(block_index);
+    const TsdfBlock::ConstPtr multi_threaded_block =
+        multi_threaded_layer.getBlockAtIndex(block_index);
+    ASSERT_TRUE(multi_threaded_block);
+    const TsdfVoxel* single_threaded_voxels =
+        &single_threaded_block->voxels[0][0][0];
+    const TsdfVoxel* multi_threaded_voxels =
+        &multi_threaded_block->voxels[0][0][0];
+    for (int i = 0; i < TsdfBlock::kNumVoxels; i++) {
+      EXPECT_EQ(multi_threaded_voxels[i].distance,
+                single_threaded_voxels[i].distance);
+      EXPECT_EQ(multi_threaded_voxels[i].weight,
+                single_threaded_voxels[i].weight);
+    }
+  }
+}
+
+TEST_F(SceneTest, LidarInBox) {
+  // A lidar in the middle of a 6x6x3 box.
+  scene_.addGroundLevel(0.0f);
+  scene_.addCeiling(3.0f);
+  scene_.addPlaneBoundaries(-3.0f, 3.0f, -3.0f, 3.0f);
+  const Lidar lidar(1024, 16, 0.0f, 100.0f, 30.0f * M_PI / 180.0f);
+  Transform T_S_C = Transform::Identity();
+  T_S_C.pretranslate(Vector3f(0.0f, 0.0f, 1.5f));
+
+  DepthImage depth_frame(lidar.num_elevation_divisions(),
+                         lidar.num_azimuth_divisions(), MemoryType::kUnified);
+  scene_.generateDepthImageFromScene(lidar, T_S_C, 10.0f, &depth_frame);
+
+  // Every beam hits a wall, such that the point lies on the box.
+  for (int row = 0; row < depth_frame.rows(); row++) {
+    for (int col = 0; col < depth_frame.cols(); col++) {
+      const float range = depth_frame(row, col);
+      ASSERT_GT(range, 0.0f);
+      const Vector3f p_S =
+          T_S_C * lidar.unprojectFromPixelIndices(Index2D(col, row), range);
+      const bool on_wall = std::abs(std::abs(p_S.x()) - 3.0f) < 1e-3 ||
+                           std::abs(std::abs(p_S.y()) - 3.0f) < 1e-3;
+      const bool on_floor_or_ceiling =
+          std::abs(p_S.z()) < 1e-3 || std::abs(p_S.z() - 3.0f) < 1e-3;
+      EXPECT_TRUE(on_wall || on_floor_or_ceiling) << p_S.transpose();
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_alsologtostderr = true;
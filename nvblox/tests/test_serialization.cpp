@@ -241,6 +241,133 @@ TEST_F(SerializationTest, SerializeDeviceBlock) {
   }
 }
 
+TEST_F(SerializationTest, BatchedMultiThreadedLoad) {
+  // A TSDF and a color layer with more blocks than a load batch.
+  cake_ = LayerCake::create<TsdfLayer, ColorLayer>(voxel_size_m_,
+                                                   MemoryType::kHost);
+  scene_.generateLayerFromScene(truncation_distance, cake_.getPtr<TsdfLayer>());
+  ColorLayer* color_layer = cake_.getPtr<ColorLayer>();
+  for (const Index3D& index : cake_.get<TsdfLayer>().getAllBlockIndices()) {
+    color_layer->allocateBlockAtIndex(index);
+  }
+  callFunctionOnAllVoxels<ColorVoxel>(
+      color_layer,
+      [](const Index3D& block_index, const Index3D& voxel_index,
+         ColorVoxel* voxel) {
+        voxel->color =
+            Color(static_cast<uint8_t>(block_index.x() + voxel_index.x()),
+                  static_cast<uint8_t>(block_index.y() + voxel_index.y()),
+                  static_cast<uint8_t>(block_index.z() + voxel_index.z()));
+        voxel->weight = 1.0f;
+      });
+  const std::string filename = "batched_load_test_layer.nvblx";
+  EXPECT_TRUE(io::writeLayerCakeToFile(filename, cake_));
+
+  constexpr int kBatchSize = 100;
+  ASSERT_GT(cake_.get<TsdfLayer>().numAllocatedBlocks(), 3 * kBatchSize);
+
+  for (const MemoryType memory_type :
+       {MemoryType::kHost, MemoryType::kUnified, MemoryType::kDevice}) {
+    Serializer serializer(filename, std::ios::in);
+    ASSERT_TRUE(serializer.valid());
+    serializer.load_batch_size(kBatchSize);
+    serializer.num_load_threads(4);
+    LayerCake cake_loaded =
+        serializer.loadLayerCake(memory_type, CudaStreamOwning());
+    serializer.close();
+
+    // Compare on the host.
+    TsdfLayer tsdf_loaded(voxel_size_m_, MemoryType::kHost);
+    tsdf_loaded.copyFrom(cake_loaded.get<TsdfLayer>());
+    ColorLayer color_loaded(voxel_size_m_, MemoryType::kHost);
+    color_loaded.copyFrom(cake_loaded.get<ColorLayer>());
+    ASSERT_EQ(tsdf_loaded.numAllocatedBlocks(),
+              cake_.get<TsdfLayer>().numAllocatedBlocks());
+    ASSERT_EQ(color_loaded.numAllocatedBlocks(),
+              color_layer->numAllocatedBlocks());
+
+    for (const Index3D& index : tsdf_loaded.getAllBlockIndices()) {
+      auto tsdf_block = cake_.get<TsdfLayer>().getBlockAtIndex(index);
+      auto tsdf_block_loaded = tsdf_loaded.getBlockAtIndex(index);
+      auto color_block = color_layer->getBlockAtIndex(index);
+      auto color_block_loaded = color_loaded.getBlockAtIndex(index);
+      ASSERT_NE(tsdf_block, nullptr);
+      ASSERT_NE(color_block_loaded, nullptr);
+      for (int x = 0; x < TsdfBlock::kVoxelsPerSide; x++) {
+        for (int y = 0; y < TsdfBlock::kVoxelsPerSide; y++) {
+          for (int z = 0; z < TsdfBlock::kVoxelsPerSide; z++) {
+            EXPECT_EQ(tsdf_block->voxels[x][y][z].distance,
+                      tsdf_block_loaded->voxels[x][y][z].distance);
+            EXPECT_EQ(tsdf_block->voxels[x][y][z].weight,
+                      tsdf_block_loaded->voxels[x][y][z].weight);
+            EXPECT_EQ(color_block->voxels[x][y][z].color,
+                      color_block_loaded->voxels[x][y][z].color);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_F(SerializationTest, BlockHeaderSerialization) {
+  // Compact freespace blocks store their time base in the block header.
+  CompactFreespaceBlock::Ptr block =
+      CompactFreespaceBlock::allocate(MemoryType::kHost);
+  block->time_base_ms = Time(123456);
+  block->voxels[1][2][3].last_occupied_offset_ms = 42;
+  const CompactFreespaceBlock::ConstPtr const_block = block;
+  CudaStreamOwning serialization_stream;
+  std::vector<Byte> bytes = serializeBlock(const_block, serialization_stream);
+  serialization_stream.synchronize();
+  EXPECT_EQ(bytes.size(), serializedBlockSize<CompactFreespaceVoxel>());
+
+  for (const MemoryType memory_type :
+       {MemoryType::kHost, MemoryType::kUnified, MemoryType::kDevice}) {
+    CompactFreespaceBlock::Ptr deserialized_block =
+        CompactFreespaceBlock::allocate(memory_type);
+    CudaStreamOwning cuda_stream;
+    EXPECT_TRUE(deserializeBlock(bytes, deserialized_block, cuda_stream));
+    cuda_stream.synchronize();
+    auto deserialized_block_host = deserialized_block.clone(MemoryType::kHost);
+    EXPECT_EQ(deserialized_block_host->time_base_ms, Time(123456));
+    EXPECT_EQ(
+        deserialized_block_host->voxels[1][2][3].last_occupied_offset_ms, 42);
+  }
+
+  // Blobs of the wrong size are rejected.
+  bytes.pop_back();
+  CompactFreespaceBlock::Ptr deserialized_block =
+      CompactFreespaceBlock::allocate(MemoryType::kHost);
+  EXPECT_FALSE(
+      deserializeBlock(bytes, deserialized_block, CudaStreamOwning()));
+  EXPECT_EQ(deserialized_block->time_base_ms, Time(0));
+}
+
+TEST_F(SerializationTest, CorruptBlockFailsLoad) {
+  cake_ = LayerCake::create<TsdfLayer>(voxel_size_m_, MemoryType::kHost);
+  scene_.generateLayerFromScene(truncation_distance, cake_.getPtr<TsdfLayer>());
+  const std::string filename = "corrupt_block_test_layer.nvblx";
+  EXPECT_TRUE(io::writeLayerCakeToFile(filename, cake_));
+
+  // Add a block with a truncated blob.
+  {
+    Serializer serializer(filename, std::ios::in | std::ios::out);
+    ASSERT_TRUE(serializer.valid());
+    EXPECT_TRUE(serializer.addLayerData("tsdf_layer", Index3D(1000, 0, 0),
+                                        std::vector<Byte>(10)));
+    serializer.close();
+  }
+
+  // Loading fails rather than aborting.
+  Serializer serializer(filename, std::ios::in);
+  ASSERT_TRUE(serializer.valid());
+  LayerCake cake_loaded =
+      serializer.loadLayerCake(MemoryType::kHost, CudaStreamOwning());
+  EXPECT_TRUE(cake_loaded.empty());
+  EXPECT_TRUE(
+      io::loadLayerCakeFromFile(filename, MemoryType::kDevice).empty());
+}
+
 TEST_F(SerializationTest, OverwriteTest) {
   // Idea here is to save twice. If overwriting is working, only the blocks from
   // the second save will show up in the reloaded map.
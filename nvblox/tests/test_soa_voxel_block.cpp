@@ -0,0 +1,194 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include "nvblox/map/common_names.h"
+#include "nvblox/map/soa_voxel_block.h"
+#include "nvblox/mesh/internal/marching_cubes.h"
+#include "nvblox/tests/block_layout_utils.h"
+
+using namespace nvblox;
+
+constexpr int kVoxelsPerSide = TsdfBlock::kVoxelsPerSide;
+
+bool voxelsEqual(const TsdfVoxel& voxel_1, const TsdfVoxel& voxel_2) {
+  return voxel_1.distance == voxel_2.distance &&
+         voxel_1.weight == voxel_2.weight;
+}
+
+bool voxelsEqual(const EsdfVoxel& voxel_1, const EsdfVoxel& voxel_2) {
+  return voxel_1.squared_distance_vox == voxel_2.squared_distance_vox &&
+         voxel_1.parent_direction == voxel_2.parent_direction &&
+         voxel_1.is_inside == voxel_2.is_inside &&
+         voxel_1.observed == voxel_2.observed &&
+         voxel_1.is_site == voxel_2.is_site;
+}
+
+template <typename BlockType1, typename BlockType2>
+int numMismatchingVoxels(const BlockType1& block_1, const BlockType2& block_2) {
+  using VoxelType = typename BlockType1::VoxelType;
+  int num_mismatches = 0;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        num_mismatches += !voxelsEqual(VoxelType(block_1.voxels[x][y][z]),
+                                       VoxelType(block_2.voxels[x][y][z]));
+      }
+    }
+  }
+  return num_mismatches;
+}
+
+TEST(SoaVoxelBlockTest, Size) {
+  // The TSDF and occupancy fields are all floats, so there is no padding to
+  // remove. ESDF voxels lose their padding.
+  EXPECT_EQ(sizeof(SoaTsdfBlock), sizeof(TsdfBlock));
+  EXPECT_EQ(sizeof(SoaOccupancyBlock), sizeof(OccupancyBlock));
+  EXPECT_LT(sizeof(SoaEsdfBlock), sizeof(EsdfBlock));
+  using AosBlock =
+      VoxelBlockWithLayout<TsdfVoxel, VoxelBlockLayout::kArrayOfStructs>;
+  using SoaBlock =
+      VoxelBlockWithLayout<TsdfVoxel, VoxelBlockLayout::kStructOfArrays>;
+  EXPECT_TRUE((std::is_same<AosBlock, TsdfBlock>::value));
+  EXPECT_TRUE((std::is_same<SoaBlock, SoaTsdfBlock>::value));
+}
+
+TEST(SoaVoxelBlockTest, Contiguity) {
+  SoaTsdfBlock block;
+  for (int x = 0; x < kVoxelsPerSide; x++) {
+    for (int y = 0; y < kVoxelsPerSide; y++) {
+      for (int z = 0; z < kVoxelsPerSide; z++) {
+        const int linear_index = SoaTsdfBlock::linearIndex(x, y, z);
+        EXPECT_EQ(&block.voxels[x][y][z].distance,
+                  &block.voxels.distance[linear_index]);
+        EXPECT_EQ(&block.voxels[x][y][z].weight,
+                  &block.voxels.weight[linear_index]);
+      }
+      // Rows along z are contiguous.
+      EXPECT_EQ(&block.voxels[x][y][kVoxelsPerSide - 1].distance -
+                    &block.voxels[x][y][0].distance,
+                kVoxelsPerSide - 1);
+    }
+  }
+}
+
+TEST(SoaVoxelBlockTest, Proxies) {
+  SoaTsdfBlock block;
+  EXPECT_EQ(block.voxels[1][2][3].distance, 0.0f);
+  EXPECT_EQ(block.voxels[1][2][3].weight, 0.0f);
+
+  // Field access.
+  block.voxels[1][2][3].distance = 0.5f;
+  block.voxels[1][2][3].weight += 2.0f;
+  EXPECT_EQ(block.voxels.distance[SoaTsdfBlock::linearIndex(1, 2, 3)], 0.5f);
+  EXPECT_EQ(block.voxels.weight[SoaTsdfBlock::linearIndex(1, 2, 3)], 2.0f);
+
+  // Conversion to and assignment from voxels.
+  TsdfVoxel voxel = block.voxels[1][2][3];
+  EXPECT_EQ(voxel.distance, 0.5f);
+  EXPECT_EQ(voxel.weight, 2.0f);
+  voxel.distance = -0.25f;
+  block.voxels[4][5][6] = voxel;
+  EXPECT_TRUE(voxelsEqual(block.voxels[4][5][6], voxel));
+
+  // Assigning one proxy to another copies the voxel, not the references.
+  block.voxels[0][0][0] = block.voxels[4][5][6];
+  EXPECT_TRUE(voxelsEqual(block.voxels[0][0][0], voxel));
+  block.voxels[4][5][6].distance = 1.0f;
+  EXPECT_EQ(block.voxels[0][0][0].distance, -0.25f);
+
+  // Const access.
+  const SoaTsdfBlock& const_block = block;
+  EXPECT_EQ(const_block.voxels[4][5][6].distance, 1.0f);
+  EXPECT_TRUE(voxelsEqual(const_block.voxels[0][0][0], voxel));
+
+  // ESDF voxels.
+  SoaEsdfBlock esdf_block;
+  EsdfVoxel esdf_voxel;
+  esdf_voxel.squared_distance_vox = 9.0f;
+  esdf_voxel.parent_direction = Index3D(0, -3, 0);
+  esdf_voxel.observed = true;
+  esdf_block.voxels[7][0][7] = esdf_voxel;
+  EXPECT_TRUE(voxelsEqual(esdf_block.voxels[7][0][7], esdf_voxel));
+  EXPECT_TRUE(voxelsEqual(esdf_block.voxels[0][0][0], EsdfVoxel()));
+  esdf_block.voxels[7][0][7].parent_direction.y() = 3;
+  EXPECT_EQ(esdf_block.voxels[7][0][7].parent_direction, Index3D(0, 3, 0));
+}
+
+TEST(SoaVoxelBlockTest, Allocation) {
+  for (const MemoryType memory_type :
+       {MemoryType::kHost, MemoryType::kUnified, MemoryType::kDevice}) {
+    SoaEsdfBlock::Ptr block = SoaEsdfBlock::allocate(memory_type);
+    ASSERT_TRUE(block);
+    const SoaEsdfBlock::Ptr block_host = block.clone(MemoryType::kHost);
+    EXPECT_EQ(numMismatchingVoxels(*block_host, EsdfBlock()), 0);
+  }
+}
+
+TEST(SoaVoxelBlockTest, Conversion) {
+  TsdfBlock block;
+  test_utils::setTsdfBlockVoxelsPseudoRandom(0, &block);
+  SoaTsdfBlock soa_block;
+  copyVoxelBlock(block, &soa_block);
+  EXPECT_EQ(numMismatchingVoxels(block, soa_block), 0);
+  TsdfBlock round_trip_block;
+  copyVoxelBlock(soa_block, &round_trip_block);
+  EXPECT_EQ(numMismatchingVoxels(block, round_trip_block), 0);
+
+  EsdfBlock esdf_block;
+  esdf_block.voxels[1][2][3].squared_distance_vox = 4.0f;
+  esdf_block.voxels[1][2][3].parent_direction = Index3D(2, 0, 0);
+  esdf_block.voxels[1][2][3].is_inside = true;
+  esdf_block.voxels[3][2][1].is_site = true;
+  SoaEsdfBlock soa_esdf_block;
+  copyVoxelBlock(esdf_block, &soa_esdf_block);
+  EXPECT_EQ(numMismatchingVoxels(esdf_block, soa_esdf_block), 0);
+}
+
+TEST(SoaVoxelBlockTest, MeshingMatches) {
+  constexpr int kNumBlocksPerSide = 4;
+  constexpr float kBlockSize = 0.4f;
+  constexpr float kMinWeight = 0.5f;
+  const test_utils::SphereTsdfBlockGrid<TsdfBlock> grid(kNumBlocksPerSide,
+                                                        kBlockSize);
+  const test_utils::SphereTsdfBlockGrid<SoaTsdfBlock> soa_grid(
+      kNumBlocksPerSide, kBlockSize);
+
+  const std::vector<marching_cubes::PerVoxelMarchingCubesResults> candidates =
+      test_utils::getTriangleCandidatesInGrid(grid, kMinWeight);
+  const std::vector<marching_cubes::PerVoxelMarchingCubesResults>
+      soa_candidates = test_utils::getTriangleCandidatesInGrid(soa_grid,
+                                                               kMinWeight);
+  EXPECT_GT(candidates.size(), 0);
+  ASSERT_EQ(candidates.size(), soa_candidates.size());
+  for (size_t i = 0; i < candidates.size(); i++) {
+    EXPECT_EQ(candidates[i].marching_cubes_table_index,
+              soa_candidates[i].marching_cubes_table_index);
+    for (int j = 0; j < 8; j++) {
+      EXPECT_EQ(candidates[i].vertex_sdf[j], soa_candidates[i].vertex_sdf[j]);
+      EXPECT_TRUE(candidates[i].vertex_coords[j] ==
+                  soa_candidates[i].vertex_coords[j]);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -524,6 +524,8 @@ TEST_F(SphereTracingTest, GettersAndSetters) {
   EXPECT_EQ(sphere_tracer.maximum_steps(), 1);
   EXPECT_EQ(sphere_tracer.maximum_ray_length_m(), 2.0f);
   EXPECT_EQ(sphere_tracer.surface_distance_epsilon_vox(), 3.0f);
+  sphere_tracer.num_cpu_threads(4);
+  EXPECT_EQ(sphere_tracer.num_cpu_threads(), 4);
 }
 
 // Generates a grid of voxels centers falling with a 2D bounding box at a
@@ -672,6 +674,129 @@ TEST_F(SphereTracingTest, CastingFromPositiveAndNegative) {
   EXPECT_LT(mean_error, voxel_size);
 }
 
+TEST_F(SphereTracingTest, CpuRenderMatchesGpuRender) {
+  // Ground truth distance field, on the host for the CPU tracer and on the
+  // device for the GPU tracer.
+  primitives::Scene scene = getSphereInBoxScene();
+  TsdfLayer layer_host(voxel_size_m_, MemoryType::kHost);
+  scene.generateLayerFromScene(truncation_distance_m_, &layer_host);
+  layer_->copyFrom(layer_host);
+
+  SphereTracer sphere_tracer;
+  DepthImage depth_image_gpu(MemoryType::kUnified);
+  DepthImage depth_image_cpu(MemoryType::kHost);
+
+  for (const int subsampling_factor : {1, 4}) {
+    for (const int num_threads : {1, 0}) {
+      sphere_tracer.num_cpu_threads(num_threads);
+      const Transform T_S_C = getRandomViewpointInSphereInBoxScene();
+      sphere_tracer.renderImageOnGPU(
+          *camera_ptr_, T_S_C, *layer_, truncation_distance_m_,
+          &depth_image_gpu, MemoryType::kUnified, subsampling_factor);
+      sphere_tracer.renderImageOnCPU(*camera_ptr_, T_S_C, layer_host,
+                                     truncation_distance_m_, &depth_image_cpu,
+                                     subsampling_factor);
+      ASSERT_EQ(depth_image_cpu.rows(),
+                camera_ptr_->rows() / subsampling_factor);
+      ASSERT_EQ(depth_image_cpu.cols(),
+                camera_ptr_->cols() / subsampling_factor);
+      EXPECT_EQ(depth_image_cpu.memory_type(), MemoryType::kHost);
+
+      // The tracers take the same steps, so they only differ by floating
+      // point rounding.
+      int num_mismatches = 0;
+      for (int i = 0; i < depth_image_cpu.numel(); i++) {
+        const bool gpu_success = depth_image_gpu(i) > 0.0f;
+        const bool cpu_success = depth_image_cpu(i) > 0.0f;
+        if (gpu_success != cpu_success ||
+            (gpu_success &&
+             std::abs(depth_image_gpu(i) - depth_image_cpu(i)) > 1e-3f)) {
+          ++num_mismatches;
+        }
+      }
+      constexpr float kMaxMismatchPercentage = 0.1f;
+      EXPECT_LT(num_mismatches * 100.0f / depth_image_cpu.numel(),
+                kMaxMismatchPercentage);
+    }
+  }
+}
+
+TEST_F(SphereTracingTest, CpuRenderRgbd) {
+  primitives::Scene scene = getSphereInBoxScene();
+  TsdfLayer tsdf_layer(voxel_size_m_, MemoryType::kHost);
+  scene.generateLayerFromScene(truncation_distance_m_, &tsdf_layer);
+
+  // A color layer, colored red, covering the TSDF layer.
+  ColorLayer color_layer(voxel_size_m_, MemoryType::kHost);
+  for (const Index3D& block_idx : tsdf_layer.getAllBlockIndices()) {
+    color_layer.allocateBlockAtIndex(block_idx);
+  }
+  callFunctionOnAllVoxels<ColorVoxel>(
+      &color_layer, [](const Index3D&, const Index3D&, ColorVoxel* voxel) {
+        voxel->color = Color(255, 0, 0);
+      });
+
+  SphereTracer sphere_tracer;
+  const Transform T_S_C = getRandomViewpointInSphereInBoxScene();
+  DepthImage depth_image(MemoryType::kHost);
+  DepthImage depth_image_rgbd(MemoryType::kHost);
+  ColorImage color_image(MemoryType::kHost);
+  sphere_tracer.renderImageOnCPU(*camera_ptr_, T_S_C, tsdf_layer,
+                                 truncation_distance_m_, &depth_image, 2);
+  sphere_tracer.renderRgbdImageOnCPU(*camera_ptr_, T_S_C, tsdf_layer,
+                                     color_layer, truncation_distance_m_,
+                                     &depth_image_rgbd, &color_image, 2);
+  ASSERT_EQ(color_image.rows(), camera_ptr_->rows() / 2);
+  ASSERT_EQ(color_image.cols(), camera_ptr_->cols() / 2);
+
+  int num_converged = 0;
+  for (int i = 0; i < depth_image.numel(); i++) {
+    EXPECT_EQ(depth_image(i), depth_image_rgbd(i));
+    if (depth_image_rgbd(i) > 0.0f) {
+      ++num_converged;
+      EXPECT_EQ(color_image(i), Color(255, 0, 0));
+    } else {
+      EXPECT_EQ(color_image(i), Color(0, 0, 0));
+    }
+  }
+  // In the groundtruth distance field we expect all rays to converge
+  EXPECT_GT(num_converged * 100.0f / depth_image.numel(), 99.5f);
+}
+
+TEST_F(SphereTracingTest, CpuRenderMaximumSteps) {
+  primitives::Scene scene = getSphereInBoxScene();
+  TsdfLayer tsdf_layer(voxel_size_m_, MemoryType::kHost);
+  scene.generateLayerFromScene(truncation_distance_m_, &tsdf_layer);
+
+  // Away from all surfaces, looking at the sphere.
+  Transform T_S_C = Transform::Identity();
+  T_S_C.prerotate(Eigen::Quaternionf(0.5, 0.5, 0.5, 0.5));
+  T_S_C.prerotate(Eigen::AngleAxisf(M_PI, Vector3f::UnitZ()));
+  T_S_C.pretranslate(Vector3f(4.0f, 0.0f, 2.5f));
+
+  // A single step never reaches a surface.
+  SphereTracer sphere_tracer;
+  sphere_tracer.maximum_steps(1);
+  DepthImage depth_image(MemoryType::kHost);
+  sphere_tracer.renderImageOnCPU(*camera_ptr_, T_S_C, tsdf_layer,
+                                 truncation_distance_m_, &depth_image, 4);
+  for (int i = 0; i < depth_image.numel(); i++) {
+    EXPECT_EQ(depth_image(i), -1.0f);
+  }
+
+  // With enough steps, all rays converge.
+  sphere_tracer.maximum_steps(100);
+  sphere_tracer.renderImageOnCPU(*camera_ptr_, T_S_C, tsdf_layer,
+                                 truncation_distance_m_, &depth_image, 4);
+  int num_converged = 0;
+  for (int i = 0; i < depth_image.numel(); i++) {
+    if (depth_image(i) > 0.0f) {
+      ++num_converged;
+    }
+  }
+  EXPECT_GT(num_converged * 100.0f / depth_image.numel(), 99.5f);
+}
+
 int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_alsologtostderr = true;
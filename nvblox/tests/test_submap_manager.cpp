@@ -0,0 +1,337 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <filesystem>
+
+#include "nvblox/core/indexing.h"
+#include "nvblox/map/accessors.h"
+#include "nvblox/mapper/submap_manager.h"
+#include "nvblox/primitives/scene.h"
+#include "nvblox/tests/integrator_utils.h"
+#include "nvblox/tests/utils.h"
+
+using namespace nvblox;
+
+class SubmapManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scene_ = test_utils::getSphereInBox();
+    // Depth frames on a circle around the sphere, looking at its center.
+    constexpr float kTrajectoryRadius = 4.0f;
+    constexpr float kTrajectoryHeight = 2.0f;
+    const float radians_increment = 2.0f * M_PI / kNumFrames;
+    for (int i = 0; i < kNumFrames; i++) {
+      const float theta = radians_increment * i;
+      const Vector3f position(kTrajectoryRadius * std::cos(theta),
+                              kTrajectoryRadius * std::sin(theta),
+                              kTrajectoryHeight);
+      // The camera has its z axis pointing towards the origin.
+      const Eigen::Quaternionf rotation_base(0.5, 0.5, 0.5, 0.5);
+      const Eigen::Quaternionf rotation_theta(
+          Eigen::AngleAxisf(M_PI + theta, Vector3f::UnitZ()));
+      Transform T_S_C = Transform::Identity();
+      T_S_C.prerotate(rotation_theta * rotation_base);
+      T_S_C.pretranslate(position);
+      poses_.push_back(T_S_C);
+
+      DepthImage depth_frame(camera_.height(), camera_.width(),
+                             MemoryType::kUnified);
+      constexpr float kMaxDist = 10.0f;
+      scene_.generateDepthImageFromScene(camera_, T_S_C, kMaxDist,
+                                         &depth_frame);
+      depth_frames_.push_back(std::move(depth_frame));
+    }
+  }
+
+  void integrateAllFrames(SubmapManager* submap_manager,
+                          int64_t frame_period_ms = 100) {
+    for (int i = 0; i < kNumFrames; i++) {
+      submap_manager->integrateDepth(depth_frames_[i], poses_[i], camera_,
+                                     Time(i * frame_period_ms));
+    }
+  }
+
+  static constexpr float kVoxelSizeM = 0.1f;
+  static constexpr int kNumFrames = 12;
+
+  primitives::Scene scene_;
+  Camera camera_{300, 300, 320, 240, 640, 480};
+  std::vector<Transform> poses_;
+  std::vector<DepthImage> depth_frames_;
+};
+
+TEST_F(SubmapManagerTest, NewSubmapOnDistance) {
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  // Consecutive poses are ~2m apart.
+  submap_manager.submap_distance_m(3.0f);
+  integrateAllFrames(&submap_manager);
+  EXPECT_GT(submap_manager.num_submaps(), 1);
+
+  // Each submap starts within the distance of the previous submap's frames.
+  const std::vector<SubmapInfo> infos = submap_manager.getSubmapInfos();
+  ASSERT_EQ(static_cast<int>(infos.size()), submap_manager.num_submaps());
+  int num_frames = 0;
+  for (size_t i = 0; i < infos.size(); i++) {
+    EXPECT_EQ(infos[i].id, static_cast<int>(i));
+    EXPECT_GT(infos[i].num_integrated_frames, 0);
+    num_frames += infos[i].num_integrated_frames;
+  }
+  EXPECT_EQ(num_frames, kNumFrames);
+  EXPECT_EQ(infos.back().state, SubmapState::kActive);
+  submap_manager.waitForBackgroundWork();
+}
+
+TEST_F(SubmapManagerTest, NewSubmapOnDuration) {
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.submap_distance_m(100.0f);
+  submap_manager.submap_duration_s(0.25f);
+  // Frames at 100ms, so a new submap every 3 frames.
+  integrateAllFrames(&submap_manager, 100);
+  EXPECT_EQ(submap_manager.num_submaps(), kNumFrames / 3);
+  for (const SubmapInfo& info : submap_manager.getSubmapInfos()) {
+    EXPECT_EQ(info.num_integrated_frames, 3);
+    EXPECT_LE(static_cast<int64_t>(info.end_time_ms - info.start_time_ms),
+              250);
+  }
+  submap_manager.waitForBackgroundWork();
+}
+
+TEST_F(SubmapManagerTest, FreezeAndFuse) {
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.submap_distance_m(3.0f);
+  integrateAllFrames(&submap_manager);
+  submap_manager.finishActiveSubmap();
+  EXPECT_EQ(submap_manager.active_mapper(), nullptr);
+  submap_manager.waitForBackgroundWork();
+
+  size_t max_num_blocks = 0;
+  for (const SubmapInfo& info : submap_manager.getSubmapInfos()) {
+    EXPECT_EQ(info.state, SubmapState::kFrozen);
+    EXPECT_TRUE(info.fused);
+    EXPECT_GT(info.num_tsdf_blocks, 0);
+    EXPECT_FALSE(info.aabb.isEmpty());
+    max_num_blocks = std::max(max_num_blocks, info.num_tsdf_blocks);
+  }
+
+  // The global layers contain all submaps.
+  submap_manager.runWithFusedLayers(
+      [&](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        EXPECT_EQ(tsdf_layer.memory_type(), MemoryType::kHost);
+        EXPECT_GE(tsdf_layer.numAllocatedBlocks(), max_num_blocks);
+      });
+}
+
+TEST_F(SubmapManagerTest, FusedWeightsAreClamped) {
+  constexpr float kMaxWeight = 2.0f;
+  MapperParams params;
+  params.projective_integrator_max_weight = kMaxWeight;
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.setMapperParams(params);
+  // A submap per frame, so the overlapping submaps sum to more than the max.
+  submap_manager.submap_distance_m(0.5f);
+  integrateAllFrames(&submap_manager);
+  submap_manager.finishActiveSubmap();
+  submap_manager.waitForBackgroundWork();
+  EXPECT_EQ(submap_manager.num_submaps(), kNumFrames);
+
+  submap_manager.runWithFusedLayers(
+      [&](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        int num_saturated_voxels = 0;
+        callFunctionOnAllVoxels<TsdfVoxel>(
+            tsdf_layer,
+            [&](const Index3D&, const Index3D&, const TsdfVoxel* voxel) {
+              EXPECT_LE(voxel->weight, kMaxWeight);
+              if (voxel->weight == kMaxWeight) {
+                ++num_saturated_voxels;
+              }
+            });
+        EXPECT_GT(num_saturated_voxels, 0);
+      });
+}
+
+TEST_F(SubmapManagerTest, QueriesMatchSingleMapper) {
+  Mapper mapper(kVoxelSizeM, MemoryType::kUnified);
+  for (int i = 0; i < kNumFrames; i++) {
+    mapper.integrateDepth(depth_frames_[i], poses_[i], camera_);
+  }
+
+  // The observed voxel centers.
+  std::vector<Vector3f> positions_L;
+  std::vector<TsdfVoxel> expected_voxels;
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      mapper.tsdf_layer(),
+      [&](const Index3D& block_index, const Index3D& voxel_index,
+          const TsdfVoxel* voxel) {
+        if (voxel->weight <= 0.0f) {
+          return;
+        }
+        positions_L.push_back(getCenterPositionFromBlockIndexAndVoxelIndex(
+            mapper.tsdf_layer().block_size(), block_index, voxel_index));
+        expected_voxels.push_back(*voxel);
+      });
+  ASSERT_GT(positions_L.size(), 0);
+
+  // A single submap, queried while active and after being fused.
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.submap_distance_m(100.0f);
+  integrateAllFrames(&submap_manager);
+  EXPECT_EQ(submap_manager.num_submaps(), 1);
+
+  auto check_voxels = [&]() {
+    std::vector<TsdfVoxel> voxels;
+    std::vector<bool> success_flags;
+    submap_manager.getTsdfVoxels(positions_L, &voxels, &success_flags);
+    ASSERT_EQ(voxels.size(), positions_L.size());
+    for (size_t i = 0; i < positions_L.size(); i++) {
+      EXPECT_TRUE(success_flags[i]);
+      EXPECT_NEAR(voxels[i].distance, expected_voxels[i].distance, 1e-4);
+      EXPECT_NEAR(voxels[i].weight, expected_voxels[i].weight, 1e-4);
+    }
+  };
+  check_voxels();
+  submap_manager.finishActiveSubmap();
+  submap_manager.waitForBackgroundWork();
+  check_voxels();
+
+  // Unobserved space isn't found.
+  std::vector<TsdfVoxel> voxels;
+  std::vector<bool> success_flags;
+  submap_manager.getTsdfVoxels({Vector3f(100.0f, 100.0f, 100.0f)}, &voxels,
+                               &success_flags);
+  EXPECT_FALSE(success_flags[0]);
+}
+
+TEST_F(SubmapManagerTest, Offloading) {
+  const std::string directory = "./submap_manager_test_offload";
+  std::filesystem::create_directories(directory);
+
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.submap_distance_m(3.0f);
+  submap_manager.fuse_frozen_submaps(false);
+  submap_manager.enableOffloading(directory);
+  integrateAllFrames(&submap_manager);
+  submap_manager.finishActiveSubmap();
+  submap_manager.waitForBackgroundWork();
+
+  for (const SubmapInfo& info : submap_manager.getSubmapInfos()) {
+    EXPECT_EQ(info.state, SubmapState::kOffloaded);
+    EXPECT_FALSE(info.fused);
+    EXPECT_TRUE(std::filesystem::exists(info.filepath));
+
+    // The offloaded layers come back with the frozen blocks.
+    LayerCake cake = submap_manager.loadOffloadedSubmap(info.id);
+    ASSERT_TRUE(cake.exists<TsdfLayer>());
+    EXPECT_EQ(cake.getPtr<TsdfLayer>()->numAllocatedBlocks(),
+              info.num_tsdf_blocks);
+  }
+
+  // Nothing fused, so the global layers are empty.
+  submap_manager.runWithFusedLayers(
+      [](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        EXPECT_EQ(tsdf_layer.numAllocatedBlocks(), 0);
+      });
+  std::filesystem::remove_all(directory);
+}
+
+TEST_F(SubmapManagerTest, FusedLayersArePagedByRegion) {
+  // Reference without paging.
+  SubmapManager reference_manager(kVoxelSizeM, MemoryType::kUnified);
+  reference_manager.submap_distance_m(3.0f);
+  integrateAllFrames(&reference_manager);
+  reference_manager.finishActiveSubmap();
+  reference_manager.waitForBackgroundWork();
+  std::vector<Vector3f> positions_L;
+  std::vector<TsdfVoxel> expected_voxels;
+  reference_manager.runWithFusedLayers(
+      [&](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        callFunctionOnAllVoxels<TsdfVoxel>(
+            tsdf_layer,
+            [&](const Index3D& block_index, const Index3D& voxel_index,
+                const TsdfVoxel* voxel) {
+              if (voxel->weight <= 0.0f) {
+                return;
+              }
+              positions_L.push_back(
+                  getCenterPositionFromBlockIndexAndVoxelIndex(
+                      tsdf_layer.block_size(), block_index, voxel_index));
+              expected_voxels.push_back(*voxel);
+            });
+      });
+  ASSERT_GT(positions_L.size(), 0);
+
+  const std::string directory = "./submap_manager_test_fused_paging";
+  std::filesystem::create_directories(directory);
+  SubmapManager submap_manager(kVoxelSizeM, MemoryType::kUnified);
+  submap_manager.submap_distance_m(3.0f);
+  submap_manager.fused_region_radius_m(1.0f);
+  submap_manager.enableOffloading(directory);
+  integrateAllFrames(&submap_manager);
+  submap_manager.finishActiveSubmap();
+  submap_manager.waitForBackgroundWork();
+
+  // Only the region around the last submap stays in memory.
+  size_t num_resident_blocks = 0;
+  submap_manager.runWithFusedLayers(
+      [&](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        num_resident_blocks = tsdf_layer.numAllocatedBlocks();
+      });
+  reference_manager.runWithFusedLayers(
+      [&](const TsdfLayer& tsdf_layer, const ColorLayer&) {
+        EXPECT_LT(num_resident_blocks, tsdf_layer.numAllocatedBlocks());
+      });
+
+  // Queries page the fused blocks back in.
+  std::vector<TsdfVoxel> voxels;
+  std::vector<bool> success_flags;
+  submap_manager.getTsdfVoxels(positions_L, &voxels, &success_flags);
+  for (size_t i = 0; i < positions_L.size(); i++) {
+    EXPECT_TRUE(success_flags[i]);
+    EXPECT_NEAR(voxels[i].distance, expected_voxels[i].distance, 1e-4);
+    EXPECT_NEAR(voxels[i].weight, expected_voxels[i].weight, 1e-4);
+  }
+  std::filesystem::remove_all(directory);
+}
+
+TEST(SubmapManagerParamsTest, GettersAndSetters) {
+  SubmapManager submap_manager(0.05f, MemoryType::kHost);
+  EXPECT_EQ(submap_manager.submap_distance_m(),
+            SubmapManager::kDefaultSubmapDistanceM);
+  EXPECT_EQ(submap_manager.submap_duration_s(),
+            SubmapManager::kDefaultSubmapDurationS);
+  EXPECT_EQ(submap_manager.fuse_frozen_submaps(),
+            SubmapManager::kDefaultFuseFrozenSubmaps);
+  EXPECT_EQ(submap_manager.num_submaps(), 0);
+  EXPECT_EQ(submap_manager.active_mapper(), nullptr);
+
+  submap_manager.submap_distance_m(5.0f);
+  EXPECT_EQ(submap_manager.submap_distance_m(), 5.0f);
+  submap_manager.submap_duration_s(10.0f);
+  EXPECT_EQ(submap_manager.submap_duration_s(), 10.0f);
+  submap_manager.fuse_frozen_submaps(false);
+  EXPECT_FALSE(submap_manager.fuse_frozen_submaps());
+  EXPECT_EQ(submap_manager.fused_region_radius_m(),
+            SubmapManager::kDefaultFusedRegionRadiusM);
+  submap_manager.fused_region_radius_m(2.0f);
+  EXPECT_EQ(submap_manager.fused_region_radius_m(), 2.0f);
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
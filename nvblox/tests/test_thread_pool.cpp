@@ -0,0 +1,242 @@
+/*
+Copyright 2024 NVIDIA CORPORATION
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "nvblox/map/blocks_to_update_tracker.h"
+#include "nvblox/utils/thread_pool.h"
+
+using namespace nvblox;
+
+class ParameterizedThreadPoolTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(ParameterizedThreadPoolTest, ParallelForCoversAllItems) {
+  ThreadPool thread_pool(GetParam());
+  EXPECT_EQ(thread_pool.num_threads(), GetParam());
+
+  constexpr int kNumItems = 10000;
+  std::vector<int> num_calls(kNumItems, 0);
+  thread_pool.parallelFor(kNumItems, [&](int i) { num_calls[i]++; });
+  for (int i = 0; i < kNumItems; i++) {
+    EXPECT_EQ(num_calls[i], 1);
+  }
+
+  // Nothing to do.
+  thread_pool.parallelFor(0, [&](int) { FAIL(); });
+}
+
+TEST_P(ParameterizedThreadPoolTest, MaxParallelism) {
+  ThreadPool thread_pool(GetParam());
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  thread_pool.parallelFor(
+      1000,
+      [&](int) {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_ids.insert(std::this_thread::get_id());
+      },
+      1);
+  // Serial on the calling thread.
+  ASSERT_EQ(thread_ids.size(), 1);
+  EXPECT_EQ(*thread_ids.begin(), std::this_thread::get_id());
+
+  EXPECT_EQ(thread_pool.numWorkers(0, 1000), GetParam() + 1);
+  EXPECT_EQ(thread_pool.numWorkers(0, 1), 1);
+  EXPECT_EQ(thread_pool.numWorkers(1000, 1000), GetParam() + 1);
+  EXPECT_EQ(thread_pool.numWorkers(2, 1000), 2);
+  EXPECT_EQ(thread_pool.numWorkers(-1, 0), 1);
+}
+
+TEST_P(ParameterizedThreadPoolTest, NestedParallelFor) {
+  ThreadPool thread_pool(GetParam());
+  constexpr int kNumOuter = 16;
+  constexpr int kNumInner = 100;
+  std::atomic<int> num_calls{0};
+  thread_pool.parallelFor(kNumOuter, [&](int) {
+    thread_pool.parallelFor(kNumInner, [&](int) { num_calls++; });
+  });
+  EXPECT_EQ(num_calls, kNumOuter * kNumInner);
+}
+
+TEST_P(ParameterizedThreadPoolTest, SubmitAndWaitInsideTasks) {
+  ThreadPool thread_pool(GetParam());
+  // Each task waits for a task submitted after it. With all workers waiting,
+  // this only finishes if waiting workers run queued tasks.
+  constexpr int kNumTasks = 32;
+  std::vector<std::future<int>> futures;
+  for (int i = 0; i < kNumTasks; i++) {
+    futures.push_back(thread_pool.submit([&thread_pool, i]() {
+      std::future<int> inner = thread_pool.submit([i]() { return 2 * i; });
+      thread_pool.wait(inner);
+      return inner.get() + 1;
+    }));
+  }
+  for (int i = 0; i < kNumTasks; i++) {
+    thread_pool.wait(futures[i]);
+    EXPECT_EQ(futures[i].get(), 2 * i + 1);
+  }
+}
+
+TEST_P(ParameterizedThreadPoolTest, TaskGraphOrder) {
+  ThreadPool thread_pool(GetParam());
+  std::mutex mutex;
+  std::vector<int> order;
+  auto record = [&](int task) {
+    return [&, task]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(task);
+    };
+  };
+
+  // A diamond: 0 -> {1, 2} -> 3.
+  TaskGraph graph;
+  const TaskGraph::TaskId first = graph.addTask(record(0));
+  const TaskGraph::TaskId left = graph.addTask(record(1), {first});
+  const TaskGraph::TaskId right = graph.addTask(record(2), {first});
+  graph.addTask(record(3), {left, right});
+  EXPECT_EQ(graph.size(), 4);
+
+  for (int run = 0; run < 3; run++) {
+    order.clear();
+    graph.run(&thread_pool);
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_EQ(order.front(), 0);
+    EXPECT_EQ(order.back(), 3);
+  }
+}
+
+TEST_P(ParameterizedThreadPoolTest, TaskGraphInsideTask) {
+  ThreadPool thread_pool(GetParam());
+  std::atomic<int> num_calls{0};
+  std::future<void> future = thread_pool.submit([&]() {
+    TaskGraph graph;
+    const TaskGraph::TaskId first = graph.addTask([&]() { num_calls++; });
+    for (int i = 0; i < 8; i++) {
+      graph.addTask(
+          [&]() {
+            thread_pool.parallelFor(10, [&](int) { num_calls++; });
+          },
+          {first});
+    }
+    graph.run(&thread_pool);
+  });
+  thread_pool.wait(future);
+  EXPECT_EQ(num_calls, 1 + 8 * 10);
+}
+
+TEST_P(ParameterizedThreadPoolTest, Stats) {
+  ThreadPool thread_pool(GetParam());
+  constexpr int kNumTasks = 10;
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < kNumTasks; i++) {
+    futures.push_back(thread_pool.submit([]() {}));
+  }
+  for (auto& future : futures) {
+    thread_pool.wait(future);
+  }
+  thread_pool.parallelFor(100, [](int) {});
+
+  const ThreadPoolStats stats = thread_pool.getStats();
+  EXPECT_EQ(stats.num_threads, GetParam());
+  EXPECT_EQ(stats.num_parallel_runs, 1);
+  EXPECT_GE(stats.num_tasks_submitted, kNumTasks);
+  EXPECT_LE(stats.num_tasks_executed + stats.num_helpers_skipped,
+            stats.num_tasks_submitted);
+}
+
+INSTANTIATE_TEST_CASE_P(NumThreads, ParameterizedThreadPoolTest,
+                        ::testing::Values(1, 2, 4));
+
+TEST(ThreadPoolTest, DefaultPool) {
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::getDefault();
+  ASSERT_TRUE(thread_pool);
+  EXPECT_EQ(thread_pool, ThreadPool::getDefault());
+  EXPECT_GE(thread_pool->num_threads(), 1);
+  EXPECT_FALSE(thread_pool->isWorkerThread());
+  std::future<bool> future =
+      thread_pool->submit([&]() { return thread_pool->isWorkerThread(); });
+  EXPECT_TRUE(future.get());
+}
+
+TEST(ThreadPoolTest, PinnedThreads) {
+  ThreadPool thread_pool(2, true);
+  EXPECT_TRUE(thread_pool.pin_threads_to_cores());
+  std::atomic<int> num_calls{0};
+  thread_pool.parallelFor(100, [&](int) { num_calls++; });
+  EXPECT_EQ(num_calls, 100);
+}
+
+TEST(ThreadPoolTest, DestructorRunsQueuedTasks) {
+  std::atomic<int> num_calls{0};
+  {
+    ThreadPool thread_pool(1);
+    for (int i = 0; i < 100; i++) {
+      thread_pool.post([&]() { num_calls++; });
+    }
+  }
+  EXPECT_EQ(num_calls, 100);
+}
+
+TEST(ThreadPoolTest, BlocksToUpdateTrackerDoesNotWaitForPool) {
+  // Occupy all threads of the default pool until the tracker is done.
+  std::shared_ptr<ThreadPool> default_pool = ThreadPool::getDefault();
+  std::atomic<bool> tracker_done{false};
+  std::atomic<int> num_blocked{0};
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < default_pool->num_threads(); i++) {
+    futures.push_back(default_pool->submit([&]() {
+      num_blocked++;
+      while (!tracker_done) {
+        std::this_thread::yield();
+      }
+    }));
+  }
+  while (num_blocked < default_pool->num_threads()) {
+    std::this_thread::yield();
+  }
+
+  // The tracker queues its modifications on the busy pool, but waiting for
+  // them runs them on the waiting thread.
+  BlocksToUpdateTracker tracker(ProjectiveLayerType::kTsdf);
+  tracker.addBlocksToUpdate({Index3D(0, 0, 0), Index3D(1, 0, 0)});
+  EXPECT_EQ(tracker.getBlocksToUpdate(BlocksToUpdateType::kMesh).size(), 2);
+  tracker.markBlocksAsUpdated(BlocksToUpdateType::kMesh);
+  tracker.addBlocksToUpdate({Index3D(2, 0, 0)});
+
+  // Moving waits for the pending modification of the moved-from tracker.
+  BlocksToUpdateTracker moved_tracker(std::move(tracker));
+  EXPECT_EQ(moved_tracker.getBlocksToUpdate(BlocksToUpdateType::kMesh).size(),
+            1);
+  moved_tracker.removeBlocksToUpdate({Index3D(2, 0, 0)});
+  EXPECT_TRUE(
+      moved_tracker.getBlocksToUpdate(BlocksToUpdateType::kMesh).empty());
+  tracker_done = true;
+  for (std::future<void>& future : futures) {
+    future.wait();
+  }
+}
+
+int main(int argc, char** argv) {
+  FLAGS_alsologtostderr = true;
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
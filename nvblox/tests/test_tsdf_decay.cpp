@@ -232,6 +232,126 @@ std::pair<int, int> countObservedVoxels(const TsdfLayer& tsdf_layer) {
   return {observed_count, unobserved_count};
 }
 
+// Test that lazily applied epochs give the same result as eager decay
+TEST_F(TsdfDecayIntegratorTest, EpochDecayMatchesEagerDecay) {
+  constexpr float kDecayFactor{0.5};
+  constexpr float kDecayedWeightThreshold{0.1};
+  constexpr int kNumEpochs{6};
+
+  TsdfLayer layer_eager(kVoxelSizeM, MemoryType::kHost);
+  layer_eager.copyFrom(layer_);
+
+  TsdfDecayIntegrator eager_integrator;
+  TsdfDecayIntegrator epoch_integrator;
+  for (TsdfDecayIntegrator* integrator :
+       {&eager_integrator, &epoch_integrator}) {
+    integrator->deallocate_decayed_blocks(false);
+    integrator->decay_factor(kDecayFactor);
+    integrator->decayed_weight_threshold(kDecayedWeightThreshold);
+  }
+
+  for (int i = 0; i < kNumEpochs; i++) {
+    eager_integrator.decay(&layer_eager, CudaStreamOwning());
+    epoch_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                                nullptr);
+  }
+  EXPECT_EQ(epoch_integrator.epoch_tracker().epoch(), kNumEpochs);
+
+  // Bring all blocks up to date and compare.
+  epoch_integrator.applyPendingDecay(&layer_, layer_.getAllBlockIndices(),
+                                     CudaStreamOwning(), nullptr);
+  for (const Index3D& block_index : layer_.getAllBlockIndices()) {
+    EXPECT_EQ(epoch_integrator.epoch_tracker().numPendingEpochs(block_index),
+              0);
+  }
+  int num_voxels_checked = 0;
+  callFunctionOnAllVoxels<TsdfVoxel>(
+      layer_, [&](const Index3D& block_index, const Index3D& voxel_index,
+                  const TsdfVoxel* voxel_ptr) {
+        const TsdfVoxel& eager_voxel =
+            layer_eager.getBlockAtIndex(block_index)
+                ->voxels[voxel_index(0)][voxel_index(1)][voxel_index(2)];
+        EXPECT_NEAR(voxel_ptr->weight, eager_voxel.weight, 1.0E-6);
+        EXPECT_NEAR(voxel_ptr->distance, eager_voxel.distance, 1.0E-6);
+        ++num_voxels_checked;
+      });
+  EXPECT_GT(num_voxels_checked, 0);
+}
+
+// Test that epochs only touch the blocks in which voxels become fully decayed
+TEST_F(TsdfDecayIntegratorTest, EpochDecayOnlyReportsChangedBlocks) {
+  // With these parameters, observed voxels (weight 1.0) are fully decayed in
+  // the 4th epoch: 1.0 -> 0.5 -> 0.25 -> 0.125 -> 0.1.
+  TsdfDecayIntegrator decay_integrator;
+  decay_integrator.deallocate_decayed_blocks(false);
+  decay_integrator.decay_factor(0.5);
+  decay_integrator.decayed_weight_threshold(0.1);
+
+  const std::vector<Index3D> all_blocks = layer_.getAllBlockIndices();
+  std::vector<Index3D> changed_blocks;
+  for (int i = 0; i < 3; i++) {
+    decay_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                                &changed_blocks);
+    EXPECT_TRUE(changed_blocks.empty());
+  }
+  // Only the first epoch was applied. The other ones are pending.
+  EXPECT_EQ(decay_integrator.epoch_tracker().numPendingEpochs(all_blocks[0]),
+            2);
+  EXPECT_TRUE(isAtLeastOneVoxelAboveWeight(layer_, 0.4));
+
+  decay_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                              &changed_blocks);
+  EXPECT_GT(changed_blocks.size(), 0);
+  EXPECT_LE(changed_blocks.size(), all_blocks.size());
+  EXPECT_FALSE(isAtLeastOneVoxelAboveWeight(layer_, 0.1));
+
+  // Fully decayed blocks are not visited anymore.
+  decay_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                              &changed_blocks);
+  EXPECT_TRUE(changed_blocks.empty());
+}
+
+// Test that all blocks eventually decay with epoch-based decay
+TEST_F(TsdfDecayIntegratorTest, EpochDecayUntilRemoved) {
+  TsdfDecayIntegrator decay_integrator;
+  constexpr size_t kMaxNumEpochs{1000};
+  size_t num_epochs = 0;
+  const int num_allocated_blocks = layer_.numAllocatedBlocks();
+  int num_dellocated_blocks = 0;
+  while (layer_.numAllocatedBlocks() > 0 && num_epochs < kMaxNumEpochs) {
+    num_dellocated_blocks +=
+        decay_integrator
+            .decayEpoch(&layer_, std::nullopt, CudaStreamOwning(), nullptr)
+            .size();
+    ++num_epochs;
+  }
+
+  EXPECT_GT(num_epochs, 0);
+  EXPECT_EQ(layer_.numAllocatedBlocks(), 0);
+  EXPECT_EQ(num_allocated_blocks, num_dellocated_blocks);
+  EXPECT_EQ(decay_integrator.epoch_tracker().numTrackedBlocks(), 0);
+}
+
+// Test that excluded blocks lag behind by the excluded epochs
+TEST_F(TsdfDecayIntegratorTest, EpochDecayWithExclusionList) {
+  TsdfDecayIntegrator decay_integrator;
+  decay_integrator.deallocate_decayed_blocks(false);
+
+  const std::vector<Index3D> all_blocks = layer_.getAllBlockIndices();
+  DecayBlockExclusionOptions exclusion_options;
+  exclusion_options.block_indices_to_exclude = {all_blocks[0]};
+
+  decay_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                              nullptr);
+  decay_integrator.decayEpoch(&layer_, exclusion_options, CudaStreamOwning(),
+                              nullptr);
+  decay_integrator.decayEpoch(&layer_, std::nullopt, CudaStreamOwning(),
+                              nullptr);
+  const DecayEpochTracker& tracker = decay_integrator.epoch_tracker();
+  EXPECT_EQ(tracker.numPendingEpochs(all_blocks[0]),
+            tracker.numPendingEpochs(all_blocks[1]) - 1);
+}
+
 TEST_F(TsdfDecayIntegratorTest, TsdfDecayToFree) {
   TsdfDecayIntegrator decay_integrator;
   constexpr size_t kMaxNumIterations{1000};